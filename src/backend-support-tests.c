@@ -1,4 +1,7 @@
 #include "backend-support-tests.h"
+#if defined(__ARM_FEATURE_SVE) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
 
 int sg_cuda_support()
 {
@@ -37,3 +40,61 @@ int sg_serial_support()
     return 0;
 #endif
 }
+
+// Checks both that the kernels were compiled in and that the CPU we are
+// running on can execute them.
+int sg_simd_support(enum sg_simd isa)
+{
+    switch (isa) {
+    case SIMD_SCALAR:
+        return 1;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && defined USE_OPENMP
+    case SIMD_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(__ARM_FEATURE_SVE) && defined(__linux__) && defined USE_OPENMP
+    case SIMD_SVE:
+        return (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+// The CONFLICT accumulate scatter uses AVX-512CD, independently of --simd
+int sg_conflict_support()
+{
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && defined USE_OPENMP
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+#else
+    return 0;
+#endif
+}
+
+// Turn SIMD_AUTO into the widest supported ISA
+enum sg_simd sg_simd_resolve(enum sg_simd isa)
+{
+    if (isa != SIMD_AUTO)
+        return isa;
+    if (sg_simd_support(SIMD_SVE))
+        return SIMD_SVE;
+    if (sg_simd_support(SIMD_AVX512))
+        return SIMD_AVX512;
+    if (sg_simd_support(SIMD_AVX2))
+        return SIMD_AVX2;
+    return SIMD_SCALAR;
+}
+
+const char *sg_simd_name(enum sg_simd isa)
+{
+    switch (isa) {
+    case SIMD_SCALAR: return "SCALAR";
+    case SIMD_AUTO:   return "AUTO";
+    case SIMD_AVX2:   return "AVX2";
+    case SIMD_AVX512: return "AVX512";
+    case SIMD_SVE:    return "SVE";
+    default:          return "INVALID";
+    }
+}
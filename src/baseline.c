@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "baseline.h"
+#include "output.h"
+#include "measure.h"
+#include "json.h"
+
+struct sp_base
+{
+    char name[STRING_SIZE];
+    uint64_t key;     /**< hash of the config keys of the record */
+    double *time_ms;
+    size_t runs;
+    size_t bytes;
+};
+
+static struct sp_base *base;
+static int nbase;
+
+static const json_value *member(const json_value *obj, const char *name)
+{
+    for (unsigned int i = 0; i < obj->u.object.length; i++)
+        if (!strcmp(obj->u.object.values[i].name, name))
+            return obj->u.object.values[i].value;
+    return NULL;
+}
+
+static double number(const json_value *v)
+{
+    return v->type == json_integer ? (double)v->u.integer : v->type == json_double ? v->u.dbl : 0;
+}
+
+// One run record: the config keys run from "kernel" up to the results
+static int read_record(char *line, size_t len, struct sp_base *b)
+{
+    char *from = strstr(line, "\"kernel\":");
+    char *to = from ? strstr(from, ",\"bytes\":") : NULL;
+    if (!to)
+        return 0;
+    json_value *rec = json_parse((json_char *)line, len);
+    if (!rec || rec->type != json_object) {
+        json_value_free(rec);
+        return 0;
+    }
+    const json_value *name = member(rec, "name");
+    const json_value *bytes = member(rec, "bytes");
+    const json_value *times = member(rec, "time_s");
+    int ok = name && name->type == json_string && bytes && times && times->type == json_array && times->u.array.length > 0;
+    if (ok) {
+        snprintf(b->name, sizeof(b->name), "%s", name->u.string.ptr);
+        b->key = sp_output_hash(from, to - from);
+        b->bytes = (size_t)number(bytes);
+        b->runs = times->u.array.length;
+        b->time_ms = (double *)malloc(sizeof(double) * b->runs);
+        for (size_t i = 0; i < b->runs; i++)
+            b->time_ms[i] = number(times->u.array.values[i]) * 1000.;
+    }
+    json_value_free(rec);
+    return ok;
+}
+
+int sp_baseline_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int size = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (strncmp(line, "{\"type\":\"run\"", 13))
+            continue;
+        if (nbase == size) {
+            size = size ? 2 * size : 64;
+            base = (struct sp_base *)realloc(base, sizeof(struct sp_base) * size);
+        }
+        if (read_record(line, len, &base[nbase]))
+            nbase++;
+    }
+    free(line);
+    fclose(f);
+    return nbase;
+}
+
+void sp_baseline_free(void)
+{
+    for (int i = 0; i < nbase; i++)
+        free(base[i].time_ms);
+    free(base);
+    base = NULL;
+    nbase = 0;
+}
+
+// The record of the same config, or else the only record of the same name
+static const struct sp_base *find(const struct run_config *rc, int *match)
+{
+    size_t len;
+    char *text = sp_output_config_json(rc, &len);
+    int keyed = text != NULL;
+    uint64_t key = keyed ? sp_output_hash(text, len) : 0;
+    free(text);
+
+    const struct sp_base *named = NULL;
+    int nnamed = 0;
+    for (int i = 0; i < nbase; i++) {
+        if (keyed && base[i].key == key) {
+            *match = 1;
+            return &base[i];
+        }
+        if (!strcmp(base[i].name, rc->name)) {
+            named = &base[i];
+            nnamed++;
+        }
+    }
+    *match = nnamed == 1 ? 2 : 0;
+    return nnamed == 1 ? named : NULL;
+}
+
+// Mean bandwidth in MB/s and the relative half-width of its 95% CI
+static double mean_bw(const double *time_ms, size_t n, size_t bytes, double *ci)
+{
+    struct sp_run_stats st;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += time_ms[i] > 0 ? bytes / time_ms[i] / 1000. : 0;
+    sp_run_stats(time_ms, n, &st);
+    *ci = st.ci;
+    return n ? sum / n : 0;
+}
+
+void sp_baseline_compare(const struct run_config *rc, size_t bytes, double tolerance, struct sp_baseline_cmp *cmp)
+{
+    memset(cmp, 0, sizeof(*cmp));
+    const struct sp_base *b = find(rc, &cmp->match);
+    if (!b || rc->nruns == 0)
+        return;
+
+    double base_ci, now_ci;
+    cmp->base_mbs = mean_bw(b->time_ms, b->runs, b->bytes, &base_ci);
+    cmp->now_mbs = mean_bw(rc->time_ms, rc->nruns, bytes, &now_ci);
+    if (cmp->base_mbs <= 0)
+        return;
+    cmp->change = cmp->now_mbs / cmp->base_mbs - 1;
+    cmp->ci = sqrt(base_ci * base_ci + now_ci * now_ci);
+    cmp->significant = fabs(cmp->change) > cmp->ci;
+    cmp->regression = cmp->significant && cmp->change < -tolerance;
+}
@@ -0,0 +1,84 @@
+#include <string.h>
+#include "box.h"
+
+static const char *face_names[] = { "x-", "x+", "y-", "y+", "z-", "z+" };
+
+int sp_box_face_parse(const char *s) {
+    for (int f = 0; f < 6; f++) {
+        if (!strcmp(s, face_names[f]))
+            return f;
+    }
+    return -1;
+}
+
+const char *sp_box_face_name(int face) {
+    return face >= 0 && face < 6 ? face_names[face] : "";
+}
+
+size_t sp_box_cells(const struct sp_box *b) {
+    return b->dim[0] * b->dim[1] * b->dim[2];
+}
+
+size_t sp_box_elems(const struct sp_box *b) {
+    return sp_box_cells(b) * b->cell;
+}
+
+size_t sp_box_len(const struct sp_box *b) {
+    if (b->face < 0)
+        return sp_box_elems(b);
+    return sp_box_elems(b) / b->dim[b->face / 2];
+}
+
+void sp_box_rows(const struct sp_box *b, struct sp_box_rows *r) {
+    size_t nx = b->dim[0], ny = b->dim[1], nz = b->dim[2];
+    size_t row = nx * b->cell;   // a row of cells along x
+    size_t plane = ny * row;     // a plane of rows along y
+    int side = b->face % 2;
+
+    // An x face is a cell from every row, a y face one row from every
+    // plane and a z face one whole plane
+    switch (b->face / 2) {
+    case 0:
+        r->off = side ? (nx - 1) * b->cell : 0;
+        r->run = b->cell;
+        r->n1 = ny;
+        r->s1 = row;
+        r->n2 = nz;
+        r->s2 = plane;
+        break;
+    case 1:
+        r->off = side ? (ny - 1) * row : 0;
+        r->run = row;
+        r->n1 = 1;
+        r->s1 = 0;
+        r->n2 = nz;
+        r->s2 = plane;
+        break;
+    default:
+        r->off = side ? (nz - 1) * plane : 0;
+        r->run = plane;
+        r->n1 = 1;
+        r->s1 = 0;
+        r->n2 = 1;
+        r->s2 = 0;
+        break;
+    }
+}
+
+void sp_box_pattern(const struct sp_box *b, ssize_t *pat) {
+    if (b->face < 0) {
+        size_t cells = sp_box_cells(b);
+        for (size_t e = 0; e < b->cell; e++)
+            for (size_t c = 0; c < cells; c++)
+                pat[e * cells + c] = c * b->cell + e;
+        return;
+    }
+
+    struct sp_box_rows r;
+    sp_box_rows(b, &r);
+    size_t j = 0;
+    for (size_t o = 0; o < r.n2; o++)
+        for (size_t k = 0; k < r.n1; k++)
+            for (size_t e = 0; e < r.run; e++)
+                pat[j++] = r.off + o * r.s2 + k * r.s1 + e;
+}
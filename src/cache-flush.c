@@ -0,0 +1,189 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "cache-flush.h"
+#include "traffic.h"
+#include "sp_alloc.h"
+#include "parse-args.h" //error
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+static volatile uint64_t *evict_buf;
+static size_t evict_bytes;
+static int evict_mapped;
+
+// Size of the unified or data cache at level from sysfs, 0 if unknown
+static size_t sysfs_cache_size(int level)
+{
+    char path[64], type[16];
+    for (int i = 0; i < 8; i++) {
+        unsigned int lvl;
+        size_t kb;
+        FILE *f;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        if (!(f = fopen(path, "r")))
+            break;
+        int ok = fscanf(f, "%u", &lvl) == 1;
+        fclose(f);
+        if (!ok || (int)lvl != level)
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        if (!(f = fopen(path, "r")))
+            continue;
+        ok = fscanf(f, "%15s", type) == 1;
+        fclose(f);
+        if (!ok || type[0] == 'I')
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if (!(f = fopen(path, "r")))
+            continue;
+        ok = fscanf(f, "%zuK", &kb) == 1;
+        fclose(f);
+        if (ok)
+            return kb << 10;
+    }
+    return 0;
+}
+
+static size_t cache_size(int level, long sc)
+{
+    if (sc >= 0) {
+        long size = sysconf(sc);
+        if (size > 0)
+            return (size_t)size;
+    }
+    return sysfs_cache_size(level);
+}
+
+size_t sp_llc_size(void)
+{
+    size_t size = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = cache_size(3, _SC_LEVEL3_CACHE_SIZE);
+#else
+    size = cache_size(3, -1);
+#endif
+    if (size == 0)
+        size = sp_l2_size();
+    return size ? size : (size_t)32 << 20;
+}
+
+size_t sp_l2_size(void)
+{
+    size_t size = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    size = cache_size(2, _SC_LEVEL2_CACHE_SIZE);
+#else
+    size = cache_size(2, -1);
+#endif
+    return size ? size : (size_t)1 << 20;
+}
+
+size_t sp_evict_init(int threads)
+{
+    size_t bytes = 2 * (sp_llc_size() + (size_t)threads * sp_l2_size());
+    size_t page = 4096;
+    bytes = (bytes + page - 1) / page * page;
+
+    evict_mapped = 0;
+#if defined(__linux__)
+    void *ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED) {
+#ifdef MADV_NOHUGEPAGE
+        madvise(ptr, bytes, MADV_NOHUGEPAGE);
+#endif
+        evict_buf = (volatile uint64_t *)ptr;
+        evict_mapped = 1;
+    }
+#endif
+    if (!evict_mapped)
+        evict_buf = (volatile uint64_t *)sp_malloc(1, bytes, page);
+    evict_bytes = bytes;
+
+    // First touch by the threads that will stream through it
+    size_t n = bytes / sizeof(uint64_t);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+        evict_buf[i] = i;
+    return bytes;
+}
+
+void sp_evict_free(void)
+{
+    if (!evict_buf)
+        return;
+#if defined(__linux__)
+    if (evict_mapped)
+        munmap((void *)evict_buf, evict_bytes);
+    else
+#endif
+    sp_free((void *)evict_buf);
+    evict_buf = NULL;
+    evict_bytes = 0;
+}
+
+void sp_evict(void)
+{
+    size_t stride = sp_line_size() / sizeof(uint64_t);
+    size_t n = evict_bytes / sizeof(uint64_t);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i += stride)
+        evict_buf[i] += 1;
+}
+
+#if defined( __x86_64__ )
+__attribute__((target("clflushopt")))
+static void flush_lines_opt(const char *p, const char *end, size_t line)
+{
+    for (; p < end; p += line)
+        _mm_clflushopt((void *)p);
+}
+
+static int have_clflushopt(void)
+{
+    static int have = -1;
+    if (have < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        // CPUID 7.0 EBX bit 23: CLFLUSHOPT
+        have = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 23));
+    }
+    return have;
+}
+#endif
+
+int sp_flush_range(const void *p, size_t bytes)
+{
+    if (!p || bytes == 0)
+        return 1;
+    size_t line = sp_line_size();
+    const char *c = (const char *)((uintptr_t)p & ~(uintptr_t)(line - 1));
+    const char *end = (const char *)p + bytes;
+#if defined( __x86_64__ )
+    if (have_clflushopt())
+        flush_lines_opt(c, end, line);
+    else
+        for (; c < end; c += line)
+            _mm_clflush(c);
+    _mm_mfence();
+    return 1;
+#elif defined( __aarch64__ )
+    for (; c < end; c += line)
+        __asm__ volatile("dc civac, %0" :: "r"(c) : "memory");
+    __asm__ volatile("dsb ish" ::: "memory");
+    return 1;
+#else
+    (void)c;
+    (void)end;
+    return 0;
+#endif
+}
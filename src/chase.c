@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "chase.h"
+#include "sp_rand.h"
+#include "sp_alloc.h"
+
+// The slot visited k-th
+static size_t *visit_order(const struct run_config *rc)
+{
+    size_t n = rc->generic_len;
+    size_t *v = (size_t *)sp_malloc(sizeof(size_t), n, ALIGN_CACHE);
+
+    if (rc->ro_order) {
+        for (size_t k = 0; k < n; k++)
+            v[k] = rc->ro_order[k];
+    } else {
+        for (size_t k = 0; k < n; k++)
+            v[k] = k;
+    }
+
+    if (rc->random_seed >= 1) {
+        sp_rand_shuffle(v, n, rc->random_seed);
+    }
+    return v;
+}
+
+void sp_chase_prepare(struct sp_chase *ch, sgData_t *source, const struct run_config *rc, int threads)
+{
+    size_t n = rc->generic_len;
+    int chains = (int)rc->chains;
+    size_t delta = rc->delta;
+    ssize_t link = rc->pattern[0];
+    size_t *v = visit_order(rc);
+
+    ch->threads = threads;
+    ch->chains = chains;
+    ch->head = (size_t *)sp_malloc(sizeof(size_t), (size_t)threads * chains, ALIGN_CACHE);
+    ch->len = (size_t *)sp_malloc(sizeof(size_t), (size_t)threads * chains, ALIGN_CACHE);
+    ch->hops = 0;
+
+    for (int t = 0; t < threads; t++) {
+        size_t b0 = n * t / threads;
+        size_t m = n * (t + 1) / threads - b0;
+        for (int c = 0; c < chains; c++) {
+            size_t k0 = b0 + m * c / chains;
+            size_t k1 = b0 + m * (c + 1) / chains;
+            size_t i = (size_t)t * chains + c;
+
+            // The offsets are stored bit for bit in sgData_t slots
+            for (size_t k = k0; k < k1; k++) {
+                uint64_t next = delta * v[k + 1 < k1 ? k + 1 : k0];
+                memcpy(&source[delta * v[k] + link], &next, sizeof(next));
+            }
+            ch->head[i] = k1 > k0 ? delta * v[k0] : 0;
+            ch->len[i] = k1 - k0;
+            if (ch->len[i] > ch->hops)
+                ch->hops = ch->len[i];
+        }
+    }
+    free(v);
+}
+
+void sp_chase_release(struct sp_chase *ch)
+{
+    free(ch->head);
+    free(ch->len);
+    ch->head = ch->len = NULL;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config-bin.h"
+#include "sp_alloc.h"
+#include "chase.h"
+#include "graph.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+static uint64_t spb_align(uint64_t off) {
+    return (off + SPB_ALIGN - 1) / SPB_ALIGN * SPB_ALIGN;
+}
+
+int spb_is_binary(const char *file) {
+    char magic[8];
+    FILE *fp = fopen(file, "rb");
+    if (!fp)
+        return 0;
+    size_t n = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == sizeof(magic) && !memcmp(magic, SPB_MAGIC, sizeof(magic));
+}
+
+// Reserve room for an array in the layout, returns its descriptor
+static struct spb_array spb_place(uint64_t *off, const void *ptr, size_t len) {
+    struct spb_array a = {0, 0};
+    if (ptr && len) {
+        *off = spb_align(*off);
+        a.offset = *off;
+        a.len = len;
+        *off += sizeof(ssize_t) * len;
+    }
+    return a;
+}
+
+static void spb_put(FILE *fp, struct spb_array a, const void *ptr) {
+    static const char zeros[SPB_ALIGN] = {0};
+    if (!a.len)
+        return;
+    long pos = ftell(fp);
+    if (fwrite(zeros, 1, a.offset - pos, fp) != a.offset - pos ||
+        fwrite(ptr, sizeof(ssize_t), a.len, fp) != a.len)
+        error("Unable to write binary config", ERROR);
+}
+
+void spb_write(const char *file, struct run_config *rc, int nrc) {
+    FILE *fp = fopen(file, "wb");
+    if (!fp)
+        error("Unable to open binary config for writing", ERROR);
+
+    struct spb_header h;
+    memcpy(h.magic, SPB_MAGIC, sizeof(h.magic));
+    h.version = SPB_VERSION;
+    h.nconfigs = nrc;
+    h.idx_size = sizeof(ssize_t);
+    h.record_size = sizeof(struct spb_config);
+
+    struct spb_config *recs = (struct spb_config *)calloc(nrc, sizeof(struct spb_config));
+    uint64_t off = sizeof(h) + sizeof(struct spb_config) * nrc;
+
+    for (int i = 0; i < nrc; i++) {
+        struct run_config *r = &rc[i];
+        struct spb_config *c = &recs[i];
+        c->kernel = r->kernel;
+        c->op = r->op;
+        c->store = r->store;
+        c->prefetch_hint = r->prefetch_hint;
+        c->prefetch_line = r->prefetch_line;
+        c->index_bits = r->index_bits;
+        c->elem = r->elem;
+        c->elem_size = r->elem_size;
+        c->type = r->type;
+        c->type_gather = r->type_gather;
+        c->type_scatter = r->type_scatter;
+        c->stride_kernel = r->stride_kernel;
+        c->ro_morton = r->ro_morton;
+        c->ro_hilbert = r->ro_hilbert;
+        c->ro_block = r->ro_block;
+        c->graph = r->graph;
+        c->random_dist = r->random_dist;
+        c->random_param[0] = r->random_param[0];
+        c->random_param[1] = r->random_param[1];
+        c->box_op = r->box_op;
+        c->box_face = r->box.face;
+        for (int d = 0; d < 3; d++)
+            c->box_dim[d] = r->box.dim[d];
+        c->box_cell = r->box.cell;
+        c->shmem = r->shmem;
+        c->boundary = r->boundary;
+        c->delta = r->delta;
+        c->delta_gather = r->delta_gather;
+        c->delta_scatter = r->delta_scatter;
+        c->pattern_size = r->pattern_size;
+        c->generic_len = r->generic_len;
+        c->wrap = r->wrap;
+        c->nruns = r->nruns;
+        c->random_seed = r->random_seed;
+        c->omp_threads = r->omp_threads;
+        c->vector_len = r->vector_len;
+        c->local_work_size = r->local_work_size;
+        c->trace_chunk = r->trace_chunk;
+        c->chains = r->chains;
+        c->prefetch_distance = r->prefetch_distance;
+        c->gs_tile = r->gs_tile;
+        c->cuda_async = r->cuda_async;
+        c->pattern = spb_place(&off, r->pattern, r->pattern_len);
+        c->pattern_gather = spb_place(&off, r->pattern_gather, r->pattern_gather_len);
+        c->pattern_scatter = spb_place(&off, r->pattern_scatter, r->pattern_scatter_len);
+        c->deltas = spb_place(&off, r->deltas, r->deltas_len);
+        c->deltas_ps = spb_place(&off, r->deltas_ps, r->deltas_len);
+        c->deltas_gather = spb_place(&off, r->deltas_gather, r->deltas_gather_len);
+        c->deltas_gather_ps = spb_place(&off, r->deltas_gather_ps, r->deltas_gather_len);
+        c->deltas_scatter = spb_place(&off, r->deltas_scatter, r->deltas_scatter_len);
+        c->deltas_scatter_ps = spb_place(&off, r->deltas_scatter_ps, r->deltas_scatter_len);
+        snprintf(c->name, STRING_SIZE, "%s", r->name);
+        snprintf(c->pattern_file, STRING_SIZE, "%s", r->pattern_file);
+    }
+
+    if (fwrite(&h, sizeof(h), 1, fp) != 1 ||
+        fwrite(recs, sizeof(struct spb_config), nrc, fp) != (size_t)nrc)
+        error("Unable to write binary config", ERROR);
+
+    for (int i = 0; i < nrc; i++) {
+        spb_put(fp, recs[i].pattern, rc[i].pattern);
+        spb_put(fp, recs[i].pattern_gather, rc[i].pattern_gather);
+        spb_put(fp, recs[i].pattern_scatter, rc[i].pattern_scatter);
+        spb_put(fp, recs[i].deltas, rc[i].deltas);
+        spb_put(fp, recs[i].deltas_ps, rc[i].deltas_ps);
+        spb_put(fp, recs[i].deltas_gather, rc[i].deltas_gather);
+        spb_put(fp, recs[i].deltas_gather_ps, rc[i].deltas_gather_ps);
+        spb_put(fp, recs[i].deltas_scatter, rc[i].deltas_scatter);
+        spb_put(fp, recs[i].deltas_scatter_ps, rc[i].deltas_scatter_ps);
+    }
+
+    free(recs);
+    if (fclose(fp) != 0)
+        error("Unable to write binary config", ERROR);
+}
+
+// Patterns are used in place, the mapping is private so in-place remapping
+// by main only copies the pages it changes
+static ssize_t *spb_map_array(char *map, size_t size, struct spb_array a) {
+    if (!a.len)
+        return NULL;
+    if (a.offset % sizeof(ssize_t) || a.offset > size || a.len > (size - a.offset) / sizeof(ssize_t))
+        error("Corrupt binary config: array out of bounds", ERROR);
+    return (ssize_t *)(map + a.offset);
+}
+
+// Deltas are small and freed with the config, so they are copied
+static size_t *spb_copy_array(char *map, size_t size, struct spb_array a) {
+    ssize_t *src = spb_map_array(map, size, a);
+    if (!src)
+        return NULL;
+    size_t *dst = (size_t *)sp_malloc(sizeof(size_t), a.len, ALIGN_CACHE);
+    memcpy(dst, src, sizeof(size_t) * a.len);
+    return dst;
+}
+
+int spb_read(const char *file, struct run_config **rc) {
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+        error("Unable to open binary config", ERROR);
+    size_t size = st.st_size;
+    if (size < sizeof(struct spb_header))
+        error("Corrupt binary config: file too small", ERROR);
+
+    char *map = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        error("Unable to mmap binary config", ERROR);
+
+    struct spb_header *h = (struct spb_header *)map;
+    if (memcmp(h->magic, SPB_MAGIC, sizeof(h->magic)))
+        error("Not a binary config file", ERROR);
+    if (h->version != SPB_VERSION || h->idx_size != sizeof(ssize_t) || h->record_size != sizeof(struct spb_config))
+        error("Binary config was written by an incompatible version of Spatter, regenerate it with --write-config", ERROR);
+    if (h->nconfigs == 0 || (size - sizeof(*h)) / sizeof(struct spb_config) < h->nconfigs)
+        error("Corrupt binary config: truncated records", ERROR);
+
+    int nrc = h->nconfigs;
+    struct spb_config *recs = (struct spb_config *)(map + sizeof(*h));
+    *rc = (struct run_config *)sp_calloc(sizeof(struct run_config), nrc, ALIGN_CACHE);
+
+#ifdef USE_OPENMP
+    size_t max_threads = omp_get_max_threads();
+#endif
+
+    for (int i = 0; i < nrc; i++) {
+        struct spb_config *c = &recs[i];
+        struct run_config *r = &(*rc)[i];
+        r->kernel = (enum sg_kernel)c->kernel;
+        r->op = (enum sg_op)c->op;
+        r->store = (enum sg_store)c->store;
+        r->prefetch_hint = (enum sg_prefetch)c->prefetch_hint;
+        r->prefetch_line = c->prefetch_line;
+        r->index_bits = c->index_bits;
+        r->elem = (enum sg_elem)c->elem;
+        r->elem_size = c->elem_size;
+        r->type = (enum idx_type)c->type;
+        r->type_gather = (enum idx_type)c->type_gather;
+        r->type_scatter = (enum idx_type)c->type_scatter;
+        r->stride_kernel = c->stride_kernel;
+        r->ro_morton = c->ro_morton;
+        r->ro_hilbert = c->ro_hilbert;
+        r->ro_block = c->ro_block;
+        r->graph = c->graph;
+        r->random_dist = (enum sg_random_dist)c->random_dist;
+        r->random_param[0] = c->random_param[0];
+        r->random_param[1] = c->random_param[1];
+        r->box_op = (enum sp_box_op)c->box_op;
+        r->box.face = c->box_face;
+        for (int d = 0; d < 3; d++)
+            r->box.dim[d] = c->box_dim[d];
+        r->box.cell = c->box_cell;
+        r->shmem = c->shmem;
+        r->boundary = c->boundary;
+        r->delta = c->delta;
+        r->delta_gather = c->delta_gather;
+        r->delta_scatter = c->delta_scatter;
+        r->pattern_size = c->pattern_size;
+        r->generic_len = c->generic_len;
+        r->wrap = c->wrap;
+        r->nruns = c->nruns;
+        r->random_seed = c->random_seed;
+        r->omp_threads = c->omp_threads;
+        r->vector_len = c->vector_len;
+        r->local_work_size = c->local_work_size;
+        r->trace_chunk = c->trace_chunk;
+        r->chains = c->chains;
+        r->prefetch_distance = c->prefetch_distance;
+        r->gs_tile = c->gs_tile;
+        r->cuda_async = c->cuda_async;
+
+        r->pattern = spb_map_array(map, size, c->pattern);
+        r->pattern_len = c->pattern.len;
+        r->pattern_gather = spb_map_array(map, size, c->pattern_gather);
+        r->pattern_gather_len = c->pattern_gather.len;
+        r->pattern_scatter = spb_map_array(map, size, c->pattern_scatter);
+        r->pattern_scatter_len = c->pattern_scatter.len;
+        r->pattern_mapped = 1;
+
+        r->deltas = spb_copy_array(map, size, c->deltas);
+        r->deltas_ps = spb_copy_array(map, size, c->deltas_ps);
+        // A single delta given without a list is written with no array
+        r->deltas_len = c->deltas.len ? c->deltas.len : r->delta >= 0;
+        r->deltas_gather = spb_copy_array(map, size, c->deltas_gather);
+        r->deltas_gather_ps = spb_copy_array(map, size, c->deltas_gather_ps);
+        r->deltas_gather_len = c->deltas_gather.len ? c->deltas_gather.len : r->delta_gather >= 0;
+        r->deltas_scatter = spb_copy_array(map, size, c->deltas_scatter);
+        r->deltas_scatter_ps = spb_copy_array(map, size, c->deltas_scatter_ps);
+        r->deltas_scatter_len = c->deltas_scatter.len ? c->deltas_scatter.len : r->delta_scatter >= 0;
+
+        snprintf(r->name, STRING_SIZE, "%.*s", STRING_SIZE - 1, c->name);
+        snprintf(r->pattern_file, STRING_SIZE, "%.*s", STRING_SIZE - 1, c->pattern_file);
+
+        if (r->kernel < SCATTER || r->kernel > CHASE)
+            error("Corrupt binary config: unknown kernel", ERROR);
+        if (r->kernel == CHASE && (r->chains < 1 || r->chains > SP_MAX_CHAINS))
+            error("Corrupt binary config: chains out of range", ERROR);
+        if (r->store < STORE_PLAIN || r->store >= INVALID_STORE)
+            error("Corrupt binary config: unknown store type", ERROR);
+        if (r->prefetch_hint < PREFETCH_T0 || r->prefetch_hint >= INVALID_PREFETCH)
+            error("Corrupt binary config: unknown prefetch hint", ERROR);
+        if (r->random_dist < RANDOM_UNIFORM || r->random_dist >= INVALID_RANDOM_DIST)
+            error("Corrupt binary config: unknown random distribution", ERROR);
+        if (r->graph < GRAPH_NONE || r->graph > GRAPH_SPMV || (r->graph && r->type != TRACE))
+            error("Corrupt binary config: unknown graph algorithm", ERROR);
+        if (r->index_bits != 16 && r->index_bits != 32 && r->index_bits != 64)
+            error("Corrupt binary config: unknown index width", ERROR);
+        if (r->elem < ELEM_F64 || r->elem >= INVALID_ELEM || r->elem_size > SP_MAX_ELEM_BYTES)
+            error("Corrupt binary config: unknown element type", ERROR);
+        if (r->kernel != GS && !r->pattern)
+            error("Corrupt binary config: pattern missing", ERROR);
+        if (r->box_op < BOX_NONE || r->box_op > BOX_TRANSPOSE || (r->box_op != BOX_NONE &&
+            (r->box.face < -1 || r->box.face > 5 || sp_box_elems(&r->box) == 0 || r->pattern_len != sp_box_len(&r->box))))
+            error("Corrupt binary config: box does not match its pattern", ERROR);
+
+#ifdef USE_OPENMP
+        if (r->omp_threads > max_threads || r->omp_threads == 0)
+            r->omp_threads = max_threads;
+#else
+        r->omp_threads = 1;
+#endif
+    }
+
+    return nrc;
+}
@@ -18,6 +18,81 @@ void create_dev_buffers_cuda(sgDataBuf* source)
     }
 }
 
+// Give the device access to the host data of buf in the way --gpu-mem
+// asks for. Only device memory is a copy: managed memory starts out on the
+// host and migrates on demand, and pinned and system memory stay on the
+// host, so the kernels read them over the host link.
+void create_src_buffer_cuda(sgDataBuf *buf, enum sg_gpu_mem mode, enum sg_gpu_hint hint, int dev)
+{
+    cudaError_t ret = cudaSuccess;
+    sgData_t *pinned;
+    int attr = 0;
+
+    switch (mode) {
+        case GPU_MEM_MANAGED:
+            ret = cudaMallocManaged((void **)&buf->dev_ptr_cuda, buf->size, cudaMemAttachGlobal);
+            if (ret == cudaSuccess)
+                memcpy(buf->dev_ptr_cuda, buf->host_ptr, buf->size);
+            break;
+        case GPU_MEM_PINNED:
+            ret = cudaHostAlloc((void **)&pinned, buf->size, cudaHostAllocMapped);
+            if (ret == cudaSuccess) {
+                memcpy(pinned, buf->host_ptr, buf->size);
+                ret = cudaHostGetDevicePointer((void **)&buf->dev_ptr_cuda, pinned, 0);
+            }
+            break;
+        case GPU_MEM_SYSTEM:
+            cudaDeviceGetAttribute(&attr, cudaDevAttrPageableMemoryAccess, dev);
+            if (!attr) {
+                printf("--gpu-mem=system needs a device that can access pageable host memory (HMM or ATS)\n");
+                exit(1);
+            }
+            buf->dev_ptr_cuda = buf->host_ptr;
+            break;
+        default:
+            create_dev_buffers_cuda(buf);
+            cudaMemcpy(buf->dev_ptr_cuda, buf->host_ptr, buf->size, cudaMemcpyHostToDevice);
+            return;
+    }
+    if (ret != cudaSuccess) {
+        printf("Could not allocate the source buffer (%zu bytes): %s\n", buf->size, cudaGetErrorName(ret));
+        exit(1);
+    }
+
+    if (hint == GPU_HINT_READMOSTLY) {
+        ret = cudaMemAdvise(buf->dev_ptr_cuda, buf->size, cudaMemAdviseSetReadMostly, dev);
+    } else if (hint == GPU_HINT_HOST) {
+        ret = cudaMemAdvise(buf->dev_ptr_cuda, buf->size, cudaMemAdviseSetPreferredLocation, cudaCpuDeviceId);
+        if (ret == cudaSuccess)
+            ret = cudaMemAdvise(buf->dev_ptr_cuda, buf->size, cudaMemAdviseSetAccessedBy, dev);
+    }
+    if (ret == cudaSuccess && (hint == GPU_HINT_PREFETCH || hint == GPU_HINT_READMOSTLY))
+        ret = cudaMemPrefetchAsync(buf->dev_ptr_cuda, buf->size, dev, 0);
+    if (ret != cudaSuccess) {
+        printf("Could not apply the --gpu-mem hint: %s\n", cudaGetErrorName(ret));
+        exit(1);
+    }
+    cudaDeviceSynchronize();
+}
+
+// Copy the host data of buf to each of devs. The copy on devs[0] is the
+// buffer create_dev_buffers_cuda already made.
+void create_dev_replicas_cuda(sgDataBuf *buf, double **replicas, int ndevs, const int *devs)
+{
+    cudaError_t ret;
+    replicas[0] = buf->dev_ptr_cuda;
+    for (int d = 1; d < ndevs; d++) {
+        cudaSetDevice(devs[d]);
+        ret = cudaMalloc((void **)&replicas[d], buf->size);
+        if (ret != cudaSuccess) {
+            printf("Could not allocate gpu memory on device %d (%zu bytes): %s\n", devs[d], buf->size, cudaGetErrorName(ret));
+            exit(1);
+        }
+        cudaMemcpy(replicas[d], buf->host_ptr, buf->size, cudaMemcpyHostToDevice);
+    }
+    cudaSetDevice(devs[0]);
+}
+
 int find_device_cuda(char *name) {
     if (!name) {
         return -1;
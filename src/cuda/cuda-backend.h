@@ -1,6 +1,6 @@
 #ifndef CUDA_BACKEND_H
 #define CUDA_BACKEND_H
-#include <cuda_runtime.h>
+#include "sp-gpu.h"
 #include <stdint.h>
 #include "../include/parse-args.h"
 #include "sgbuf.h"
@@ -13,12 +13,24 @@ extern float cuda_sg_wrapper(enum sg_kernel kernel,
                        double* target, double *source,
                        long* ti, long* si, unsigned int shmem);
 
+/** @brief Upload the pattern (and reorder or --random-dist base) arrays of
+ *  rc before its timed runs. The cuda_block_* wrappers and the graph only launch.
+ *  Gathers also get the prefix sums of their deltas in deltas_dev.
+ */
+extern void cuda_prepare_config(struct run_config *rc,
+        sgIdx_t *pat_dev,
+        sgIdx_t *pat_gath_dev,
+        sgIdx_t *pat_scat_dev,
+        uint32_t *order_dev,
+        size_t *deltas_dev);
+extern void cuda_prepare_multidev(int ndevs, const int *devs, sgIdx_t **pat_dev, ssize_t *pat, size_t pat_len);
 extern float cuda_block_multiscatter_wrapper(long unsigned dim, long unsigned* grid, long unsigned* block,
         double *source,
         double *target,
         struct run_config* rc,
         sgIdx_t* outer_pat,
         sgIdx_t* inner_pat,
+        uint32_t *order_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -31,6 +43,7 @@ extern float cuda_block_multigather_wrapper(long unsigned dim, long unsigned* gr
         struct run_config* rc,
         sgIdx_t* outer_pat,
         sgIdx_t* inner_pat,
+        size_t *deltas_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -42,6 +55,7 @@ extern float cuda_block_sg_wrapper(long unsigned dim, long unsigned* grid, long
         struct run_config* rc,
         sgIdx_t* pat_gath_dev,
         sgIdx_t* pat_scat_dev,
+        uint32_t *order_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -58,20 +72,80 @@ extern float cuda_block_wrapper(long unsigned dim, long unsigned* grid, long uns
         size_t delta,
         size_t n,
         size_t wrap, int wpt, size_t morton, uint32_t *order, uint32_t *order_dev, int stride,
+        size_t *deltas_dev, size_t deltas_len,
+        size_t prefetch_distance, int prefetch_line, size_t elem_size,
         int *final_block_idx,
         int *final_thread_idx,
         double *final_gather_data,
         int atomic_flag,
         char validate);
+extern float cuda_block_multidev_wrapper(int ndevs, const int *devs, int nstreams,
+        unsigned long local_work_size,
+        enum sg_kernel kernel,
+        double **source,
+        double **target,
+        sgIdx_t **pat_dev,
+        ssize_t *pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        int atomic_flag,
+        char validate,
+        float *dev_time_ms);
+/** @brief A Gather/Scatter launch captured into a CUDA Graph (--cuda-graph) */
+struct sp_cuda_graph;
+extern struct sp_cuda_graph *cuda_graph_create(unsigned long local_work_size,
+        enum sg_kernel kernel,
+        double *source,
+        double *target,
+        sgIdx_t *pat_dev,
+        ssize_t *pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        int atomic_flag,
+        char validate);
+extern float cuda_graph_launch(struct sp_cuda_graph *g, int *final_block_idx, int *final_thread_idx);
+extern void cuda_graph_destroy(struct sp_cuda_graph *g);
 extern float cuda_block_random_wrapper(long unsigned dim, long unsigned* grid, long unsigned* block,
         enum sg_kernel kernel,
         double *source,
+        double *target,
         sgIdx_t* pat_dev,
         ssize_t* pat,
         size_t pat_len,
         size_t delta,
         size_t n,
-        size_t wrap, int wpt, size_t seed);
+        size_t wrap, int wpt, size_t seed,
+        const uint32_t *bases_dev);
+extern float cuda_block_async_wrapper(enum sg_kernel kernel,
+        double *source,
+        double *target,
+        sgIdx_t *pat_dev,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        size_t local_work_size,
+        int wpt,
+        int *final_block_idx,
+        int *final_thread_idx,
+        char validate);
+/** @brief Time a PACK or UNPACK of the face given by rows, or a TRANSPOSE
+ *  of boxes of cells cells of cell elements, see box.h
+ */
+extern float cuda_box_wrapper(enum sp_box_op op,
+        double *source,
+        double *target,
+        const struct sp_box_rows *rows,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        size_t local_work_size);
 extern float cuda_new_wrapper(long unsigned dim, long unsigned* grid, long unsigned* block,
         enum sg_kernel kernel,
         double *source,
@@ -83,6 +157,8 @@ extern float cuda_new_wrapper(long unsigned dim, long unsigned* grid, long unsig
         size_t wrap, int wpt);
 
 void create_dev_buffers_cuda(sgDataBuf *source);
+void create_src_buffer_cuda(sgDataBuf *buf, enum sg_gpu_mem mode, enum sg_gpu_hint hint, int dev);
+void create_dev_replicas_cuda(sgDataBuf *buf, double **replicas, int ndevs, const int *devs);
 
 int find_device_cuda(char *name);
 #endif
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "sp-gpu.h"
+#ifdef USE_HIP
+#include <hip/hiprtc.h>
+#define nvrtcProgram            hiprtcProgram
+#define NVRTC_SUCCESS           HIPRTC_SUCCESS
+#define nvrtcCreateProgram      hiprtcCreateProgram
+#define nvrtcCompileProgram     hiprtcCompileProgram
+#define nvrtcDestroyProgram     hiprtcDestroyProgram
+#define nvrtcGetProgramLog      hiprtcGetProgramLog
+#define nvrtcGetProgramLogSize  hiprtcGetProgramLogSize
+#define nvrtcGetCUBIN           hiprtcGetCode
+#define nvrtcGetCUBINSize       hiprtcGetCodeSize
+#else
+#include <nvrtc.h>
+#endif
+#include "cuda-jit.h"
+#include "../include/parse-args.h"
+
+// Bodies of the V-templated kernels of my_kernel.cu, with V a macro so
+// every entry point has a plain C name. Validation is not compiled in:
+// the final_*_dev symbols live in my_kernel.cu's module.
+static const char *jit_source =
+"extern \"C\" __global__ void gather_block_morton(double *src, double *target, long *idx, unsigned long idx_len, unsigned long delta, unsigned long wrap, int wpb, unsigned int *order, char validate)\n"
+"{\n"
+"    __shared__ int idx_shared[V];\n"
+"    int tid = threadIdx.x;\n"
+"    int bid = blockIdx.x;\n"
+"    if (tid < V)\n"
+"        idx_shared[tid] = idx[tid];\n"
+"    __syncthreads();\n"
+"    int ngatherperblock = blockDim.x / V;\n"
+"    int gatherid = tid / V;\n"
+"    double *src_loc = src + (bid*ngatherperblock+order[gatherid])*delta;\n"
+"    target[tid%V + V*((bid*ngatherperblock+gatherid)%wrap)] = src_loc[idx_shared[tid%V]];\n"
+"}\n"
+"extern \"C\" __global__ void gather_block_multidelta(double *src, double *target, long *idx, unsigned long idx_len, const unsigned long *deltas_ps, unsigned long deltas_len, unsigned long n, unsigned long wrap, int wpb, int stride, char validate)\n"
+"{\n"
+"    __shared__ int idx_shared[V];\n"
+"    __shared__ unsigned long base_shared[(1024 + V - 1) / V];\n"
+"    int tid = threadIdx.x;\n"
+"    int ngatherperblock = blockDim.x / V;\n"
+"    int gatherid = tid / V;\n"
+"    unsigned long first = (unsigned long)blockIdx.x * ngatherperblock;\n"
+"    if (tid < V)\n"
+"        idx_shared[tid] = stride >= 0 ? stride * tid : idx[tid];\n"
+"    if (tid < ngatherperblock) {\n"
+"        unsigned long i = first + tid;\n"
+"        base_shared[tid] = i / deltas_len * deltas_ps[deltas_len - 1] + deltas_ps[i % deltas_len] - deltas_ps[0];\n"
+"    }\n"
+"    __syncthreads();\n"
+"    if (gatherid >= ngatherperblock || first + gatherid >= n)\n"
+"        return;\n"
+"    double *src_loc = src + base_shared[gatherid];\n"
+"    target[tid%V + V*((first+gatherid)%wrap)] = src_loc[idx_shared[tid%V]];\n"
+"}\n"
+"extern \"C\" __global__ void multigather_block_multidelta(double *source, double *target, unsigned long *outer_pat, unsigned long *inner_pat, unsigned long pat_len, const unsigned long *deltas_ps, unsigned long deltas_len, unsigned long n, unsigned long wrap, int wpt, char validate)\n"
+"{\n"
+"    __shared__ int idx_shared[V];\n"
+"    __shared__ unsigned long base_shared[(1024 + V - 1) / V];\n"
+"    int tid = threadIdx.x;\n"
+"    int ngatherperblock = blockDim.x / V;\n"
+"    int gatherid = tid / V;\n"
+"    unsigned long first = (unsigned long)blockIdx.x * ngatherperblock;\n"
+"    if (tid < V)\n"
+"        idx_shared[tid] = outer_pat[inner_pat[tid]];\n"
+"    if (tid < ngatherperblock) {\n"
+"        unsigned long i = first + tid;\n"
+"        base_shared[tid] = i / deltas_len * deltas_ps[deltas_len - 1] + deltas_ps[i % deltas_len] - deltas_ps[0];\n"
+"    }\n"
+"    __syncthreads();\n"
+"    if (gatherid >= ngatherperblock || first + gatherid >= n)\n"
+"        return;\n"
+"    double *source_loc = source + base_shared[gatherid];\n"
+"    target[tid%V + V*((first+gatherid)%wrap)] = source_loc[idx_shared[tid%V]];\n"
+"}\n";
+
+#define JIT_MAX_KERNELS 64
+
+struct jit_kernel {
+    char name[64];
+    size_t V;
+    int device;
+    CUmodule module;
+    CUfunction func;
+};
+
+static struct jit_kernel jit_kernels[JIT_MAX_KERNELS];
+static int jit_nkernels = 0;
+
+// FNV-1a of the kernel source, so a changed source does not load a stale
+// cache entry
+static unsigned int source_hash(void)
+{
+    unsigned int h = 2166136261u;
+    for (const char *c = jit_source; *c; c++)
+        h = (h ^ (unsigned char)*c) * 16777619u;
+    return h;
+}
+
+static void cache_path(char *path, size_t len, const char *kernel, size_t V, const char *arch)
+{
+    const char *dir = getenv("SPATTER_JIT_CACHE");
+    char home_dir[STRING_SIZE];
+    if (!dir) {
+        const char *home = getenv("HOME");
+        snprintf(home_dir, sizeof(home_dir), "%s/.cache", home ? home : "/tmp");
+        mkdir(home_dir, 0755);
+        strncat(home_dir, "/spatter-jit", sizeof(home_dir) - strlen(home_dir) - 1);
+        dir = home_dir;
+    }
+    mkdir(dir, 0755);
+    snprintf(path, len, "%s/%s_V%zu_%s_%08x.cubin", dir, kernel, V, arch, source_hash());
+}
+
+static char *read_cache(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = (char *)malloc(len > 0 ? len : 1);
+    if (len <= 0 || fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return buf;
+}
+
+static char *compile(size_t V, const char *arch_opt, size_t *size)
+{
+    nvrtcProgram prog;
+    if (nvrtcCreateProgram(&prog, jit_source, "spatter_jit.cu", 0, NULL, NULL) != NVRTC_SUCCESS)
+        return NULL;
+
+    char def[32];
+    snprintf(def, sizeof(def), "-DV=%zu", V);
+#ifdef USE_HIP
+    const char *opts[] = {arch_opt, def};
+#else
+    const char *opts[] = {arch_opt, def, "-default-device"};
+#endif
+
+    if (nvrtcCompileProgram(prog, sizeof(opts) / sizeof(opts[0]), opts) != NVRTC_SUCCESS) {
+        size_t log_len;
+        nvrtcGetProgramLogSize(prog, &log_len);
+        char *log = (char *)malloc(log_len);
+        nvrtcGetProgramLog(prog, log);
+        fprintf(stderr, "NVRTC compilation of V=%zu failed:\n%s\n", V, log);
+        free(log);
+        nvrtcDestroyProgram(&prog);
+        return NULL;
+    }
+
+    nvrtcGetCUBINSize(prog, size);
+    char *cubin = (char *)malloc(*size);
+    nvrtcGetCUBIN(prog, cubin);
+    nvrtcDestroyProgram(&prog);
+    return cubin;
+}
+
+static CUfunction jit_function(const char *kernel, size_t V)
+{
+    int device;
+    cudaGetDevice(&device);
+
+    for (int i = 0; i < jit_nkernels; i++)
+        if (jit_kernels[i].V == V && jit_kernels[i].device == device && !strcmp(jit_kernels[i].name, kernel))
+            return jit_kernels[i].func;
+
+    if (jit_nkernels == JIT_MAX_KERNELS)
+        return NULL;
+
+    char arch[64], arch_opt[96];
+#ifdef USE_HIP
+    // gcnArchName is e.g. gfx90a:sramecc+:xnack-, the code object is only
+    // keyed by the target
+    hipDeviceProp_t prop;
+    hipGetDeviceProperties(&prop, device);
+    snprintf(arch, sizeof(arch), "%s", prop.gcnArchName);
+    arch[strcspn(arch, ":")] = '\0';
+    snprintf(arch_opt, sizeof(arch_opt), "--offload-arch=%s", prop.gcnArchName);
+#else
+    int major, minor;
+    cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device);
+    cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device);
+    snprintf(arch, sizeof(arch), "sm%d%d", major, minor);
+    snprintf(arch_opt, sizeof(arch_opt), "--gpu-architecture=sm_%d%d", major, minor);
+#endif
+
+    // Both kernels come from the same program, the cache has one file per V
+    char path[2 * STRING_SIZE];
+    cache_path(path, sizeof(path), "gather_block", V, arch);
+
+    size_t size;
+    char *cubin = read_cache(path, &size);
+    if (!cubin) {
+        cubin = compile(V, arch_opt, &size);
+        if (!cubin)
+            return NULL;
+        FILE *f = fopen(path, "wb");
+        if (f) {
+            fwrite(cubin, 1, size, f);
+            fclose(f);
+        }
+    }
+
+    struct jit_kernel *k = &jit_kernels[jit_nkernels];
+    CUresult ret = cuModuleLoadData(&k->module, cubin);
+    free(cubin);
+    if (ret != CUDA_SUCCESS || cuModuleGetFunction(&k->func, k->module, kernel) != CUDA_SUCCESS)
+        return NULL;
+
+    strncpy(k->name, kernel, sizeof(k->name) - 1);
+    k->V = V;
+    k->device = device;
+    jit_nkernels++;
+    return k->func;
+}
+
+int cuda_jit_launch(const char *kernel, size_t V, dim3 grid_dim, dim3 block_dim, void **args)
+{
+    CUfunction f = jit_function(kernel, V);
+    if (!f)
+        return -1;
+    if (cuLaunchKernel(f, grid_dim.x, grid_dim.y, grid_dim.z, block_dim.x, block_dim.y, block_dim.z, 0, 0, args, NULL) != CUDA_SUCCESS)
+        return -1;
+    return 0;
+}
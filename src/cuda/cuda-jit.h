@@ -0,0 +1,16 @@
+#ifndef CUDA_JIT_H
+#define CUDA_JIT_H
+#include "sp-gpu.h"
+
+/** @brief Launch kernel<V> for a pattern length without a built-in
+ *  instantiation, compiling it with NVRTC the first time.
+ *
+ *  Supported kernels are gather_block_morton, gather_block_multidelta and
+ *  multigather_block_multidelta, with the same arguments as the templates
+ *  in my_kernel.cu. Compiled kernels
+ *  are cached on disk, keyed by kernel, V and the device's compute
+ *  capability, in $SPATTER_JIT_CACHE or ~/.cache/spatter-jit.
+ *  @return 0 on success, -1 if the kernel could not be built or launched
+ */
+int cuda_jit_launch(const char *kernel, size_t V, dim3 grid_dim, dim3 block_dim, void **args);
+#endif
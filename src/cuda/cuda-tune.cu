@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "cuda-tune.h"
+
+// Timed runs of each candidate launch, after one warm-up run
+#define TUNE_RUNS 3
+
+static const int tune_threads[] = {64, 128, 256, 512, 1024};
+static const int tune_wpt[] = {1, 2, 4, 8};
+static const unsigned int tune_shmem[] = {0, 8 << 10, 16 << 10, 32 << 10, 48 << 10};
+
+#define NELEMS(a) (sizeof(a) / sizeof((a)[0]))
+
+static void cache_path(char *path, size_t len)
+{
+    const char *file = getenv("SPATTER_TUNE_CACHE");
+    if (file) {
+        snprintf(path, len, "%s", file);
+        return;
+    }
+    const char *home = getenv("HOME");
+    snprintf(path, len, "%s/.cache", home ? home : "/tmp");
+    mkdir(path, 0755);
+    strncat(path, "/spatter-tune", len - strlen(path) - 1);
+}
+
+// The device name with its blanks replaced, so a cache line splits on
+// whitespace
+static void device_key(char *key, size_t len)
+{
+    int device;
+    struct cudaDeviceProp prop;
+    cudaGetDevice(&device);
+    cudaGetDeviceProperties(&prop, device);
+    snprintf(key, len, "%s", prop.name);
+    for (char *c = key; *c; c++)
+        if (isspace((unsigned char)*c))
+            *c = '_';
+}
+
+// Lines are "<device> <kernel> <pat_len> <threads> <wpt> <shmem>", the
+// last match wins
+static int cache_lookup(const char *dev, const char *kernel, size_t pat_len, struct sp_cuda_launch *launch)
+{
+    char path[2 * STRING_SIZE], line[2 * STRING_SIZE], d[STRING_SIZE], k[STRING_SIZE];
+    size_t p;
+    struct sp_cuda_launch l;
+    int found = 0;
+
+    cache_path(path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%255s %255s %zu %d %d %u", d, k, &p, &l.threads, &l.wpt, &l.shmem) == 6 &&
+                !strcmp(d, dev) && !strcmp(k, kernel) && p == pat_len && l.threads > 0 && l.wpt > 0) {
+            *launch = l;
+            found = 1;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+static void cache_store(const char *dev, const char *kernel, size_t pat_len, const struct sp_cuda_launch *launch)
+{
+    char path[2 * STRING_SIZE];
+    cache_path(path, sizeof(path));
+    FILE *f = fopen(path, "a");
+    if (!f)
+        return;
+    fprintf(f, "%s %s %zu %d %d %u\n", dev, kernel, pat_len, launch->threads, launch->wpt, launch->shmem);
+    fclose(f);
+}
+
+static float time_launch(struct run_config *rc, double *source, double *target, sgIdx_t *pat_dev, const struct sp_cuda_launch *launch)
+{
+    float best = 0;
+    for (int i = -1; i < TUNE_RUNS; i++) {
+        float ms = cuda_tuned_wrapper(rc->kernel, source, target, pat_dev, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, launch);
+        if (i == 0 || (i > 0 && ms < best))
+            best = ms;
+    }
+    return best;
+}
+
+void cuda_autotune(struct run_config *rc, double *source, double *target, sgIdx_t *pat_dev, struct sp_cuda_tune *tune)
+{
+    char dev[STRING_SIZE];
+    const char *kernel = rc->kernel == GATHER ? "Gather" : "Scatter";
+    struct sp_cuda_launch l;
+    int device, nsm, max_threads;
+
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&nsm, cudaDevAttrMultiProcessorCount, device);
+    cudaDeviceGetAttribute(&max_threads, cudaDevAttrMaxThreadsPerBlock, device);
+    device_key(dev, sizeof(dev));
+
+    tune->tuned = 1;
+    cuda_default_launch(rc, &tune->launch);
+    tune->default_ms = time_launch(rc, source, target, pat_dev, &tune->launch);
+
+    tune->cached = cache_lookup(dev, kernel, rc->pattern_len, &tune->launch);
+    if (tune->cached)
+        return;
+
+    float best_ms = tune->default_ms;
+    size_t total = rc->pattern_len * rc->generic_len;
+    for (size_t t = 0; t < NELEMS(tune_threads); t++) {
+        if (tune_threads[t] > max_threads)
+            break;
+        l.threads = tune_threads[t];
+        for (size_t w = 0; w < NELEMS(tune_wpt); w++) {
+            l.wpt = tune_wpt[w];
+            // Too few blocks to keep every multiprocessor busy
+            size_t per_block = (size_t)l.threads * l.wpt;
+            if (w > 0 && (total + per_block - 1) / per_block < (size_t)nsm)
+                break;
+            int last_occ = -1;
+            for (size_t s = 0; s < NELEMS(tune_shmem); s++) {
+                l.shmem = tune_shmem[s];
+                int occ = cuda_tuned_occupancy(rc->kernel, &l);
+                if (occ == 0)
+                    break;
+                if (occ == last_occ)
+                    continue;
+                last_occ = occ;
+                float ms = time_launch(rc, source, target, pat_dev, &l);
+                if (ms > 0 && ms < best_ms) {
+                    best_ms = ms;
+                    tune->launch = l;
+                }
+            }
+        }
+    }
+    cache_store(dev, kernel, rc->pattern_len, &tune->launch);
+}
@@ -0,0 +1,61 @@
+#ifndef CUDA_TUNE_H
+#define CUDA_TUNE_H
+#include "sp-gpu.h"
+#include "../include/parse-args.h"
+
+/** @brief Launch parameters of the generic Gather and Scatter kernels
+ *  (--autotune)
+ */
+struct sp_cuda_launch
+{
+    int threads;        /**< Threads per block */
+    int wpt;            /**< Pattern entries per thread */
+    unsigned int shmem; /**< Dummy dynamic shared memory per block, in bytes */
+};
+
+/** @brief Result of --autotune for one config
+ */
+struct sp_cuda_tune
+{
+    int tuned;                    /**< 0 if the config can not be tuned */
+    int cached;                   /**< launch came from the cache file */
+    struct sp_cuda_launch launch; /**< Fastest launch */
+    float default_ms;             /**< Best time of the default launch */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief The launch cuda_block_wrapper uses for a plain Gather or Scatter */
+void cuda_default_launch(const struct run_config *rc, struct sp_cuda_launch *launch);
+
+/** @brief Blocks of the launch that fit on one multiprocessor, 0 if none */
+int cuda_tuned_occupancy(enum sg_kernel kernel, const struct sp_cuda_launch *launch);
+
+/** @brief Time one plain Gather or Scatter run with the given launch */
+float cuda_tuned_wrapper(enum sg_kernel kernel,
+        double *source,
+        double *target,
+        sgIdx_t *pat_dev,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        const struct sp_cuda_launch *launch);
+
+/** @brief Find the fastest launch of a plain Gather or Scatter config.
+ *
+ *  Sweeps threads per block, pattern entries per thread and dummy shared
+ *  memory. Shared memory sizes that leave the blocks per multiprocessor
+ *  (cudaOccupancyMaxActiveBlocksPerMultiprocessor) unchanged, and grids
+ *  with fewer blocks than multiprocessors, are skipped. The best launch is
+ *  cached per device, kernel and pattern length in $SPATTER_TUNE_CACHE or
+ *  ~/.cache/spatter-tune, so later runs only time the default launch.
+ */
+void cuda_autotune(struct run_config *rc, double *source, double *target, sgIdx_t *pat_dev, struct sp_cuda_tune *tune);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
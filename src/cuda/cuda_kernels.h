@@ -1,6 +1,6 @@
 #ifndef SG_CUDA_H
 #define SG_CUDA_H
-#include <cuda.h>
+#include "sp-gpu.h"
 __global__ void my_kernel();
 __global__ void scatter(double* target, double* source, long* ti, long* si);
 #endif
@@ -1,8 +1,13 @@
 #include <stdio.h>
 #include "cuda_kernels.h"
+#include "cuda-jit.h"
+#include "cuda-tune.h"
 #include "../include/parse-args.h"
 
-#include <curand_kernel.h>
+#include "../include/sp_rand.h"
+#ifndef USE_HIP
+#include <cuda/pipeline>
+#endif
 
 #define typedef uint unsigned long
 
@@ -103,6 +108,27 @@ INSTANTIATE(1024);
 INSTANTIATE(2048);
 INSTANTIATE(4096);
 
+// Threads per block of the generic kernels, which index by global thread
+// id and so work with any block size: one thread per pattern entry, up to
+// the local work size. AMD GPUs issue whole 64-wide wavefronts, so there
+// a short pattern is rounded up to full wavefronts rather than leaving
+// most lanes of each one idle.
+static int block_size(size_t pat_len, size_t local_work_size)
+{
+    size_t threads = pat_len < 1024 ? pat_len : 1024;
+    if (threads > local_work_size)
+        threads = local_work_size;
+#ifdef USE_HIP
+    int dev, warp;
+    hipGetDevice(&dev);
+    hipDeviceGetAttribute(&warp, hipDeviceAttributeWarpSize, dev);
+    threads = (threads + warp - 1) / warp * warp;
+    if (threads > 1024)
+        threads = 1024;
+#endif
+    return (int)threads;
+}
+
 extern "C" int translate_args(unsigned int dim, unsigned int* grid, unsigned int* block, dim3 *grid_dim, dim3 *block_dim){
     if (!grid || !block || dim == 0 || dim > 3) {
         return 1;
@@ -291,6 +317,51 @@ __global__ void cuda_scatter(const ssize_t* pattern, double *sparse, double *den
         sparse[pattern[j] + delta * i] = dense[j + pattern_length * (i % wrap)];
 }
 
+// --morton and --hilbert: Scatter i goes to offset order[i]
+__global__ void cuda_scatter_morton(const ssize_t* pattern, double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, const uint32_t *order, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    if (i < count)
+        sparse[pattern[j] + delta * order[i]] = dense[j + pattern_length * (i % wrap)];
+}
+
+// --prefetch-distance: before its own element, thread (i, j) prefetches
+// element j of Gather/Scatter i + distance into L2, or only element 0
+// of it with line_only
+__device__ __forceinline__ void prefetch_l2(const double *p)
+{
+#ifndef USE_HIP
+    asm volatile("prefetch.global.L2 [%0];" :: "l"(p));
+#endif
+}
+
+__global__ void cuda_scatter_prefetch(const ssize_t* pattern, double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, const size_t distance, const int line_only, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    if (i + distance < count && (j == 0 || !line_only))
+        prefetch_l2(&sparse[pattern[j] + delta * (i + distance)]);
+    if (i < count)
+        sparse[pattern[j] + delta * i] = dense[j + pattern_length * (i % wrap)];
+}
+
 //assume block size >= index buffer size
 //assume index buffer size divides block size
 template<int V>
@@ -324,41 +395,62 @@ __global__ void scatter_block(double *src, ssize_t* idx, size_t idx_len, size_t
     //}
 }
 
-//assume block size >= index buffer size
-//assume index buffer size divides block size
-template<int V>
-__global__ void scatter_block_random(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, size_t seed, size_t n)
-{
-    __shared__ int idx_shared[V];
-
-    int tid  = threadIdx.x;
-    int bid  = blockIdx.x;
-    int ngatherperblock = blockDim.x / V;
-    int gatherid = tid / V;
+__global__ void cuda_gather(const ssize_t* pattern, const double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
 
-    unsigned long long sequence = blockIdx.x; //all thread blocks can use same sequence
-    unsigned long long offset = gatherid;
-    curandState_t state;
-    curand_init(seed, sequence, offset, &state);//everyone with same gather id should get same src_loc
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
 
-    int random_gatherid = (int)(n * curand_uniform(&state));
+    if (i < count)
+        dense[j + pattern_length * (i % wrap)] = sparse[pattern[j] + delta * i];
+}
 
+__global__ void cuda_gather_prefetch(const ssize_t* pattern, const double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, const size_t distance, const int line_only, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
 
-    if (tid < V) {
-        idx_shared[tid] = idx[tid];
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
     }
+    #endif
 
+    if (i + distance < count && (j == 0 || !line_only))
+        prefetch_l2(&sparse[pattern[j] + delta * (i + distance)]);
+    if (i < count)
+        dense[j + pattern_length * (i % wrap)] = sparse[pattern[j] + delta * i];
+}
 
-    double *src_loc = src + (bid*ngatherperblock+random_gatherid)*delta;
+// --elem: cuda_gather and cuda_scatter on 4-byte (float) and 16-byte
+// (double2) elements, the buffers are reinterpreted as arrays of T. 8-byte
+// elements move the same bytes as the double kernels and use those.
+template<typename T>
+__global__ void cuda_gather_elem(const ssize_t* pattern, const T *sparse, T *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
 
-    //for (int i = 0; i < wpb; i++) {
-        src_loc[idx_shared[tid%V]] = idx_shared[tid%V];
-        //src_loc[idx_shared[tid%V]] = 1337.;
-        //src_loc += delta;
-    //}
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    if (i < count)
+        dense[j + pattern_length * (i % wrap)] = sparse[pattern[j] + delta * i];
 }
 
-__global__ void cuda_gather(const ssize_t* pattern, const double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, char validate) {
+template<typename T>
+__global__ void cuda_scatter_elem(const ssize_t* pattern, T *sparse, const T *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, char validate) {
     size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
     size_t j = total_id % pattern_length; // pat_idx
     size_t i = total_id / pattern_length; // count_idx
@@ -370,15 +462,129 @@ __global__ void cuda_gather(const ssize_t* pattern, const double *sparse, double
     }
     #endif
 
-    double x;
+    if (i < count)
+        sparse[pattern[j] + delta * i] = dense[j + pattern_length * (i % wrap)];
+}
+
+// --autotune: cuda_gather and cuda_scatter with wpt pattern entries per
+// thread. Consecutive threads still take consecutive entries, each thread
+// strides over the grid, so every warp stays coalesced.
+__global__ void cuda_gather_wpt(const ssize_t* pattern, const double *sparse, double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, const int wpt) {
+    size_t nthreads = (size_t)gridDim.x * blockDim.x;
+    size_t total = pattern_length * count;
+    size_t t = (size_t)blockDim.x * blockIdx.x + threadIdx.x;
+    for (int k = 0; k < wpt && t < total; k++, t += nthreads) {
+        size_t j = t % pattern_length;
+        size_t i = t / pattern_length;
+        dense[j + pattern_length * (i % wrap)] = sparse[pattern[j] + delta * i];
+    }
+}
+
+__global__ void cuda_scatter_wpt(const ssize_t* pattern, double *sparse, const double *dense, const size_t pattern_length, const size_t delta, const size_t wrap, const size_t count, const int wpt) {
+    size_t nthreads = (size_t)gridDim.x * blockDim.x;
+    size_t total = pattern_length * count;
+    size_t t = (size_t)blockDim.x * blockIdx.x + threadIdx.x;
+    for (int k = 0; k < wpt && t < total; k++, t += nthreads) {
+        size_t j = t % pattern_length;
+        size_t i = t / pattern_length;
+        sparse[pattern[j] + delta * i] = dense[j + pattern_length * (i % wrap)];
+    }
+}
+
+#ifndef USE_HIP
+// --cuda-async: each block runs wpt rounds of blockDim.x consecutive
+// (Gather, pattern entry) pairs, in the order of cuda_gather. The sparse
+// load of round r + 1 is issued with cuda::memcpy_async into the other
+// half of a double buffer in shared memory before round r is stored, so
+// the loads of the next round are in flight while the current one drains
+// and none of them is held in a register. On sm_80 and later the copies
+// are cp.async, before that they are plain loads and stores. Every thread
+// only reads the slots it copied itself, so its own pipeline is enough
+// and no barrier is needed between rounds.
+template<int V>
+__global__ void gather_block_async(const ssize_t* pattern, const double *sparse, double *dense, const size_t delta, const size_t wrap, const size_t count, const int wpt, char validate)
+{
+    __shared__ ssize_t idx_shared[V];
+    extern __shared__ double stage[]; // two rounds of blockDim.x
+
+    int tid = threadIdx.x;
+    for (int j = tid; j < V; j += blockDim.x)
+        idx_shared[j] = pattern[j];
+    __syncthreads();
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    cuda::pipeline<cuda::thread_scope_thread> pipe = cuda::make_pipeline();
+    size_t total = count * V;
+    size_t t = (size_t)blockIdx.x * wpt * blockDim.x + tid;
+
+    pipe.producer_acquire();
+    if (t < total)
+        cuda::memcpy_async(&stage[tid], &sparse[idx_shared[t % V] + delta * (t / V)], cuda::aligned_size_t<sizeof(double)>(sizeof(double)), pipe);
+    pipe.producer_commit();
+
+    for (int r = 0; r < wpt; r++, t += blockDim.x) {
+        size_t next = t + blockDim.x;
+        pipe.producer_acquire();
+        if (r + 1 < wpt && next < total)
+            cuda::memcpy_async(&stage[((r + 1) & 1) * blockDim.x + tid], &sparse[idx_shared[next % V] + delta * (next / V)], cuda::aligned_size_t<sizeof(double)>(sizeof(double)), pipe);
+        pipe.producer_commit();
+
+        pipe.consumer_wait();
+        if (t < total)
+            dense[t % V + V * ((t / V) % wrap)] = stage[(r & 1) * blockDim.x + tid];
+        pipe.consumer_release();
+    }
+}
+
+// The same for Scatters: the reads of the dense side are staged, the
+// stores to the sparse side are made from shared memory
+template<int V>
+__global__ void scatter_block_async(const ssize_t* pattern, double *sparse, const double *dense, const size_t delta, const size_t wrap, const size_t count, const int wpt, char validate)
+{
+    __shared__ ssize_t idx_shared[V];
+    extern __shared__ double stage[];
+
+    int tid = threadIdx.x;
+    for (int j = tid; j < V; j += blockDim.x)
+        idx_shared[j] = pattern[j];
+    __syncthreads();
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
 
-    if (i < count) {
-        // dense[j + pattern_length * (i % wrap)] = sparse[pattern[j] + delta * i]; // configuration 1
-        x = sparse[pattern[j] + delta * i]; // configuration 2
-        if (x == 0.5)
-            dense[0] = x;
+    cuda::pipeline<cuda::thread_scope_thread> pipe = cuda::make_pipeline();
+    size_t total = count * V;
+    size_t t = (size_t)blockIdx.x * wpt * blockDim.x + tid;
+
+    pipe.producer_acquire();
+    if (t < total)
+        cuda::memcpy_async(&stage[tid], &dense[t % V + V * ((t / V) % wrap)], cuda::aligned_size_t<sizeof(double)>(sizeof(double)), pipe);
+    pipe.producer_commit();
+
+    for (int r = 0; r < wpt; r++, t += blockDim.x) {
+        size_t next = t + blockDim.x;
+        pipe.producer_acquire();
+        if (r + 1 < wpt && next < total)
+            cuda::memcpy_async(&stage[((r + 1) & 1) * blockDim.x + tid], &dense[next % V + V * ((next / V) % wrap)], cuda::aligned_size_t<sizeof(double)>(sizeof(double)), pipe);
+        pipe.producer_commit();
+
+        pipe.consumer_wait();
+        if (t < total)
+            sparse[idx_shared[t % V] + delta * (t / V)] = stage[(r & 1) * blockDim.x + tid];
+        pipe.consumer_release();
     }
 }
+#endif
 
 //V2 = 8
 //assume block size >= index buffer size
@@ -427,7 +633,7 @@ __global__ void gather_block(double *src, ssize_t* idx, size_t idx_len, size_t d
 }
 
 template<int V>
-__global__ void gather_block_morton(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, uint32_t *order, char validate)
+__global__ void gather_block_morton(double *src, double *target, ssize_t* idx, size_t idx_len, size_t delta, size_t wrap, int wpb, uint32_t *order, char validate)
 {
     __shared__ int idx_shared[V];
 
@@ -457,87 +663,142 @@ __global__ void gather_block_morton(double *src, ssize_t* idx, size_t idx_len, s
     }
     #endif
 
-    double x;
-
-    //for (int i = 0; i < wpb; i++) {
-        x = src_loc[idx_shared[tid%V]];
-        //src_loc[idx_shared[tid%V]] = 1337.;
-        //src_loc += delta;
-    //}
-
-    if (x==0.5) src[0] = x;
-
+    target[tid%V + V*((bid*ngatherperblock+gatherid)%wrap)] = src_loc[idx_shared[tid%V]];
 }
 
+// Most Gathers one block of up to 1024 threads holds
+#define SP_BLOCK_GATHERS(V) ((1024 + (V) - 1) / (V))
+
+// Gathers with multiple deltas, as the CPU backends take them: Gather i
+// starts at (i / D) * ps[D-1] + ps[i % D] - ps[0], with ps the D prefix-summed
+// deltas. A single delta is ps = {delta}. The first threads of a block
+// work out the bases of its Gathers into shared memory, every thread of a
+// Gather then reads its base from there. With stride >= 0 entry j of the
+// pattern is stride * j (--stride).
 template<int V>
-__global__ void gather_block_stride(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, int stride, char validate)
+__global__ void gather_block_multidelta(double *src, double *target, ssize_t* idx, size_t idx_len, const size_t *deltas_ps, size_t deltas_len, size_t n, size_t wrap, int wpb, int stride, char validate)
 {
-    int tid  = threadIdx.x;
-    int bid  = blockIdx.x;
-
-    #ifdef VALIDATE
-    if (validate) {
-        final_block_idx_dev = blockIdx.x;
-        final_thread_idx_dev = threadIdx.x;
-    }
-    #endif
+    __shared__ int idx_shared[V];
+    __shared__ size_t base_shared[SP_BLOCK_GATHERS(V)];
 
+    int tid  = threadIdx.x;
     int ngatherperblock = blockDim.x / V;
     int gatherid = tid / V;
+    size_t first = (size_t)blockIdx.x * ngatherperblock;
 
-    double *src_loc = src + (bid*ngatherperblock+gatherid)*delta;
+    if (tid < V) {
+        idx_shared[tid] = stride >= 0 ? stride * tid : idx[tid];
+    }
+    if (tid < ngatherperblock) {
+        size_t i = first + tid;
+        base_shared[tid] = i / deltas_len * deltas_ps[deltas_len - 1] + deltas_ps[i % deltas_len] - deltas_ps[0];
+    }
+    __syncthreads();
+    if (gatherid >= ngatherperblock || first + gatherid >= n)
+        return;
+
+    double *src_loc = src + base_shared[gatherid];
 
     #ifdef VALIDATE
     if (validate) {
-        final_gather_data_dev = src_loc[stride*(tid%V)];
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+        final_gather_data_dev = src_loc[idx_shared[tid%V]];
     }
     #endif
 
-    double x;
-
-    //for (int i = 0; i < wpb; i++) {
-    x = src_loc[stride*(tid%V)];
-    //src_loc[idx_shared[tid%V]] = 1337.;
-    //src_loc += delta;
-    //}
-
-    if (x==0.5) src[0] = x;
-
+    target[tid%V + V*((first+gatherid)%wrap)] = src_loc[idx_shared[tid%V]];
 }
 
-template<int V>
-__global__ void gather_block_random(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, size_t seed, size_t n)
+// One thread per pattern entry of each Gather or Scatter, in a grid-stride
+// loop, so the pattern may be longer than a block. The i-th Gather or
+// Scatter goes to the base drawn from (seed, i) by the stateless hash of
+// sp_rand.h: there is no generator state to set up in the timed kernel,
+// and the bases are the ones the CPU backends use for the same seed.
+// With --random-dist they are read from the bases drawn on the host, in
+// the order buffer.
+// The dense side is the wrap-slotted target, as in cuda_gather.
+__global__ void gather_random(double *src, double *target, const ssize_t* idx, size_t idx_len, size_t delta, size_t wrap, size_t seed, size_t n, const uint32_t *bases)
 {
+    size_t total = n * idx_len;
+    size_t stride = (size_t)gridDim.x * blockDim.x;
+    for (size_t t = (size_t)blockIdx.x * blockDim.x + threadIdx.x; t < total; t += stride) {
+        size_t base = (bases ? bases[t / idx_len] : sp_rand_bounded(seed, t / idx_len, (uint32_t)n)) * delta;
+        target[t % idx_len + idx_len * ((t / idx_len) % wrap)] = src[base + idx[t % idx_len]];
+    }
+}
 
-    __shared__ int idx_shared[V];
-
-    int tid  = threadIdx.x;
-    int bid  = blockIdx.x;
-    int ngatherperblock = blockDim.x / V;
-    int gatherid = tid / V;
-
-    unsigned long long sequence = blockIdx.x; //all thread blocks can use same sequence
-    unsigned long long offset = gatherid;
-    curandState_t state;
-    curand_init(seed, sequence, offset, &state);//everyone with same gather id should get same src_loc
-    int random_gatherid = (int)(n * curand_uniform(&state));
-
-
-    if (tid < V) {
-        idx_shared[tid] = idx[tid];
+__global__ void scatter_random(double *src, const double *target, const ssize_t* idx, size_t idx_len, size_t delta, size_t wrap, size_t seed, size_t n, const uint32_t *bases)
+{
+    size_t total = n * idx_len;
+    size_t stride = (size_t)gridDim.x * blockDim.x;
+    for (size_t t = (size_t)blockIdx.x * blockDim.x + threadIdx.x; t < total; t += stride) {
+        size_t base = (bases ? bases[t / idx_len] : sp_rand_bounded(seed, t / idx_len, (uint32_t)n)) * delta;
+        src[base + idx[t % idx_len]] = target[t % idx_len + idx_len * ((t / idx_len) % wrap)];
     }
+}
 
-    double *src_loc = src + (bid*ngatherperblock+random_gatherid)*delta;
-    double x;
+// PACK and UNPACK of the face of each box given by the rows of
+// struct sp_box_rows, see box.h. The blocks stride over the boxes and
+// the threads of a block over the elements of the face, so consecutive
+// threads touch consecutive elements of a row. The dense side is the
+// wrap-slotted target, as in cuda_gather.
+__global__ void pack_box(const double *src, double *target, size_t off, size_t run, size_t n1, size_t s1, size_t s2, size_t face_len, size_t delta, size_t wrap, size_t n)
+{
+    for (size_t b = blockIdx.x; b < n; b += gridDim.x) {
+        const double *box = src + b * delta + off;
+        double *slot = target + face_len * (b % wrap);
+        for (size_t t = threadIdx.x; t < face_len; t += blockDim.x) {
+            size_t row = t / run;
+            slot[t] = box[(row / n1) * s2 + (row % n1) * s1 + t % run];
+        }
+    }
+}
 
-    //for (int i = 0; i < wpb; i++) {
-        x = src_loc[idx_shared[tid%V]];
-        //src_loc[idx_shared[tid%V]] = 1337.;
-        //src_loc += delta;
-    //}
+__global__ void unpack_box(double *src, const double *target, size_t off, size_t run, size_t n1, size_t s1, size_t s2, size_t face_len, size_t delta, size_t wrap, size_t n)
+{
+    for (size_t b = blockIdx.x; b < n; b += gridDim.x) {
+        double *box = src + b * delta + off;
+        const double *slot = target + face_len * (b % wrap);
+        for (size_t t = threadIdx.x; t < face_len; t += blockDim.x) {
+            size_t row = t / run;
+            box[(row / n1) * s2 + (row % n1) * s1 + t % run] = slot[t];
+        }
+    }
+}
 
-    if (x==0.5) src[0] = x;
+#define SP_BOX_TILE 1024
 
+// TRANSPOSE of each box from AoS into SoA through shared memory. A tile is
+// tc cells by te elements: it is loaded along the elements of each cell,
+// which for te == cell is one contiguous run, and stored along the cells
+// of each element, so both sides of the transpose are coalesced.
+__global__ void transpose_box(const double *src, double *target, size_t cells, size_t cell, size_t tc, size_t te, size_t delta, size_t wrap, size_t n)
+{
+    __shared__ double tile[SP_BOX_TILE];
+    size_t tiles_c = (cells + tc - 1) / tc;
+    size_t tiles_e = (cell + te - 1) / te;
+    size_t per_box = tiles_c * tiles_e;
+    for (size_t t = blockIdx.x; t < n * per_box; t += gridDim.x) {
+        size_t b = t / per_box;
+        size_t c0 = (t % per_box) / tiles_e * tc;
+        size_t e0 = (t % per_box) % tiles_e * te;
+        const double *box = src + b * delta;
+        double *slot = target + cells * cell * (b % wrap);
+
+        for (size_t i = threadIdx.x; i < tc * te; i += blockDim.x) {
+            size_t c = c0 + i / te, e = e0 + i % te;
+            if (c < cells && e < cell)
+                tile[i] = box[c * cell + e];
+        }
+        __syncthreads();
+        for (size_t i = threadIdx.x; i < tc * te; i += blockDim.x) {
+            size_t c = c0 + i % tc, e = e0 + i / tc;
+            if (c < cells && e < cell)
+                slot[e * cells + c] = tile[(i % tc) * te + i / tc];
+        }
+        __syncthreads();
+    }
 }
 
 //todo -- add WRAP
@@ -594,11 +855,9 @@ __global__ void gather_new(double* source,
 #define INSTANTIATE2(V)\
 template __global__ void gather_new<V>(double* source, sgIdx_t* idx, size_t delta, int dummy, int wpt); \
 template __global__ void gather_block<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, char validate);\
-template __global__ void gather_block_morton<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, uint32_t *order, char validate);\
-template __global__ void gather_block_stride<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, int stride, char validate);\
-template __global__ void scatter_block<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, char validate); \
-template __global__ void gather_block_random<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, size_t seed, size_t n); \
-template __global__ void scatter_block_random<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, size_t seed, size_t n);
+template __global__ void gather_block_morton<V>(double *src, double *target, ssize_t* idx, size_t idx_len, size_t delta, size_t wrap, int wpb, uint32_t *order, char validate);\
+template __global__ void gather_block_multidelta<V>(double *src, double *target, ssize_t* idx, size_t idx_len, const size_t *deltas_ps, size_t deltas_len, size_t n, size_t wrap, int wpb, int stride, char validate);\
+template __global__ void scatter_block<V>(double *src, ssize_t* idx, size_t idx_len, size_t delta, int wpb, char validate);
 
 //INSTANTIATE2(1);
 //INSTANTIATE2(2);
@@ -616,6 +875,114 @@ INSTANTIATE2(1024);
 INSTANTIATE2(2048);
 INSTANTIATE2(4096);
 
+// The pattern lengths the block kernels are instantiated for, other
+// lengths are JIT-compiled (cuda-jit.cu)
+static const size_t block_lengths[] = {8, 16, 32, 64, 73, 128, 256, 512, 1024, 2048, 4096};
+#define BLOCK_KERNELS(kernel) { (const void *)kernel<8>, (const void *)kernel<16>, (const void *)kernel<32>, \
+    (const void *)kernel<64>, (const void *)kernel<73>, (const void *)kernel<128>, (const void *)kernel<256>, \
+    (const void *)kernel<512>, (const void *)kernel<1024>, (const void *)kernel<2048>, (const void *)kernel<4096> }
+
+// Launch the instantiation of a block kernel (one of kernels, in the order
+// of block_lengths) for pattern length V, or the JIT-compiled kernel name.
+// args are its arguments, which both take alike.
+static void launch_block(const char *name, const void *const *kernels, size_t V, dim3 grid_dim, dim3 block_dim, void **args)
+{
+    for (size_t k = 0; k < sizeof(block_lengths) / sizeof(block_lengths[0]); k++) {
+        if (block_lengths[k] == V) {
+            cudaLaunchKernel(kernels[k], grid_dim, block_dim, args, 0, 0);
+            return;
+        }
+    }
+    if (cuda_jit_launch(name, V, grid_dim, block_dim, args)) {
+        printf("ERROR NOT SUPPORTED: %zu\n", V);
+        exit(1);
+    }
+}
+
+// Blocks of whole Gathers of V entries for n Gathers, at most
+// local_work_size threads each
+static void multidelta_dims(size_t V, size_t n, size_t local_work_size, dim3 *grid_dim, dim3 *block_dim)
+{
+    size_t threads = local_work_size < 1024 ? local_work_size : 1024;
+    if (V > threads) {
+        printf("ERROR: multiple deltas and --stride need a pattern of at most the local work size (%zu > %zu)\n", V, threads);
+        exit(1);
+    }
+    size_t per_block = threads / V;
+    *block_dim = dim3((unsigned)(per_block * V));
+    *grid_dim = dim3((unsigned)((n + per_block - 1) / per_block));
+}
+
+// One pair of timing events for all runs instead of two new ones per run
+static void timing_events(cudaEvent_t *start, cudaEvent_t *stop)
+{
+    static cudaEvent_t start_ev, stop_ev;
+    static int created = 0;
+    if (!created) {
+        cudaEventCreate(&start_ev);
+        cudaEventCreate(&stop_ev);
+        created = 1;
+    }
+    *start = start_ev;
+    *stop = stop_ev;
+}
+
+// Upload the index arrays of rc once, before its timed runs. The
+// cuda_block_* wrappers only launch. Which of the device buffers are used
+// depends on the kernel, as in the wrappers.
+extern "C" void cuda_prepare_config(struct run_config *rc,
+        sgIdx_t *pat_dev,
+        sgIdx_t *pat_gath_dev,
+        sgIdx_t *pat_scat_dev,
+        uint32_t *order_dev,
+        size_t *deltas_dev)
+{
+    // The block Gathers base gather i on the prefix sums of the deltas, a
+    // single delta is uploaded as a one-element table
+    if (rc->kernel == GATHER || rc->kernel == MULTIGATHER) {
+        if (rc->deltas_len > 1)
+            cudaMemcpy(deltas_dev, rc->deltas_ps, sizeof(size_t)*rc->deltas_len, cudaMemcpyHostToDevice);
+        else
+            cudaMemcpy(deltas_dev, &rc->delta, sizeof(size_t), cudaMemcpyHostToDevice);
+    }
+
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        cudaMemcpy(pat_dev, rc->pattern, sizeof(sgIdx_t)*rc->pattern_len, cudaMemcpyHostToDevice);
+        if ((rc->ro_morton || rc->ro_hilbert) && rc->ro_order)
+            cudaMemcpy(order_dev, rc->ro_order, sizeof(uint32_t)*rc->generic_len, cudaMemcpyHostToDevice);
+        if (rc->random_bases)
+            cudaMemcpy(order_dev, rc->random_bases, sizeof(uint32_t)*rc->generic_len, cudaMemcpyHostToDevice);
+        break;
+    case GS:
+        cudaMemcpy(pat_gath_dev, rc->pattern_gather, sizeof(sgIdx_t)*rc->pattern_gather_len, cudaMemcpyHostToDevice);
+        cudaMemcpy(pat_scat_dev, rc->pattern_scatter, sizeof(sgIdx_t)*rc->pattern_scatter_len, cudaMemcpyHostToDevice);
+        break;
+    case MULTISCATTER:
+        cudaMemcpy(pat_dev, rc->pattern, sizeof(sgIdx_t)*rc->pattern_len, cudaMemcpyHostToDevice);
+        cudaMemcpy(pat_scat_dev, rc->pattern_scatter, sizeof(sgIdx_t)*rc->pattern_scatter_len, cudaMemcpyHostToDevice);
+        break;
+    case MULTIGATHER:
+        cudaMemcpy(pat_dev, rc->pattern, sizeof(sgIdx_t)*rc->pattern_len, cudaMemcpyHostToDevice);
+        cudaMemcpy(pat_gath_dev, rc->pattern_gather, sizeof(sgIdx_t)*rc->pattern_gather_len, cudaMemcpyHostToDevice);
+        break;
+    default:
+        break;
+    }
+    cudaDeviceSynchronize();
+}
+
+// The same for the copies of the pattern on each device of --devices
+extern "C" void cuda_prepare_multidev(int ndevs, const int *devs, sgIdx_t **pat_dev, ssize_t *pat, size_t pat_len)
+{
+    for (int d = 0; d < ndevs; d++) {
+        cudaSetDevice(devs[d]);
+        cudaMemcpy(pat_dev[d], pat, sizeof(sgIdx_t)*pat_len, cudaMemcpyHostToDevice);
+    }
+    cudaSetDevice(devs[0]);
+}
+
 extern "C" float cuda_block_wrapper(uint dim, uint* grid, uint* block,
         enum sg_kernel kernel,
         double *source,
@@ -631,6 +998,11 @@ extern "C" float cuda_block_wrapper(uint dim, uint* grid, uint* block,
         uint32_t *order,
         uint32_t *order_dev,
         int stride,
+        size_t *deltas_dev,
+        size_t deltas_len,
+        size_t prefetch_distance,
+        int prefetch_line,
+        size_t elem_size,
         int *final_block_idx,
         int *final_thread_idx,
         double *final_gather_data,
@@ -643,76 +1015,32 @@ extern "C" float cuda_block_wrapper(uint dim, uint* grid, uint* block,
 
     if(translate_args(dim, grid, block, &grid_dim, &block_dim)) return 0;
 
-    int threads_per_block = min(pat_len, (size_t)1024);
-    threads_per_block = min(threads_per_block, block[0]);
+    int threads_per_block = block_size(pat_len, block[0]);
     int blocks_per_grid = ((pat_len * n) + threads_per_block - 1) / threads_per_block;
 
-    cudaMemcpy(pat_dev, pat, sizeof(sgIdx_t)*pat_len, cudaMemcpyHostToDevice);
-    cudaMemcpy(order_dev, order, sizeof(uint32_t)*n, cudaMemcpyHostToDevice);
 
-    cudaEventCreate(&start);
-    cudaEventCreate(&stop);
+    timing_events(&start, &stop);
 
     cudaDeviceSynchronize();
     cudaEventRecord(start);
     // KERNEL
     if (kernel == GATHER) {
-        if (morton) {
-            if (pat_len == 8) {
-                gather_block_morton<8><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 16) {
-                gather_block_morton<16><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 32) {
-                gather_block_morton<32><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 64) {
-                gather_block_morton<64><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 73) {
-                gather_block_morton<73><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 128) {
-                gather_block_morton<128><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 256) {
-                gather_block_morton<256><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 512) {
-                gather_block_morton<512><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 1024) {
-                gather_block_morton<1024><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 2048) {
-                gather_block_morton<2048><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else if (pat_len == 4096) {
-                gather_block_morton<4096><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, order_dev, validate);
-            }else {
-                printf("ERROR NOT SUPPORTED: %zu\n", pat_len);
-                exit(1);
-            }
-
-        } else if (stride >= 0) {
-            if (pat_len == 8) {
-                gather_block_stride<8><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 16) {
-                gather_block_stride<16><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 32) {
-                gather_block_stride<32><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 64) {
-                gather_block_stride<64><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 73) {
-                gather_block_stride<73><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 128) {
-                gather_block_stride<128><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 256) {
-                gather_block_stride<256><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 512) {
-                gather_block_stride<512><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 1024) {
-                gather_block_stride<1024><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 2048) {
-                gather_block_stride<2048><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else if (pat_len == 4096) {
-                gather_block_stride<4096><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, stride, validate);
-            }else {
-                printf("ERROR NOT SUPPORTED: %zu\n", pat_len);
-                exit(1);
-            }
-
+        if (deltas_len > 1 || stride >= 0) {
+            static const void *const kernels[] = BLOCK_KERNELS(gather_block_multidelta);
+            dim3 md_grid, md_block;
+            multidelta_dims(pat_len, n, block[0], &md_grid, &md_block);
+            void *args[] = {&source, &target, &pat_dev, &pat_len, &deltas_dev, &deltas_len, &n, &wrap, &wpt, &stride, &validate};
+            launch_block("gather_block_multidelta", kernels, pat_len, md_grid, md_block, args);
+        } else if (morton) {
+            static const void *const kernels[] = BLOCK_KERNELS(gather_block_morton);
+            void *args[] = {&source, &target, &pat_dev, &pat_len, &delta, &wrap, &wpt, &order_dev, &validate};
+            launch_block("gather_block_morton", kernels, pat_len, grid_dim, block_dim, args);
+        } else if (elem_size == 4) {
+            cuda_gather_elem<float><<<blocks_per_grid, threads_per_block>>>(pat_dev, (float *)source, (float *)target, pat_len, delta, wrap, n, validate);
+        } else if (elem_size == 16) {
+            cuda_gather_elem<double2><<<blocks_per_grid, threads_per_block>>>(pat_dev, (double2 *)source, (double2 *)target, pat_len, delta, wrap, n, validate);
+        } else if (prefetch_distance > 0) {
+            cuda_gather_prefetch<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, prefetch_distance, prefetch_line, validate);
         } else {
             cuda_gather<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
             /*
@@ -745,7 +1073,15 @@ extern "C" float cuda_block_wrapper(uint dim, uint* grid, uint* block,
         }
         //cudaMemcpyFromSymbol(final_gather_data, final_gather_data_dev, sizeof(double), 0, cudaMemcpyDeviceToHost);
     } else if (kernel == SCATTER) {
-        if (atomic_flag == 0)
+        if (morton)
+            cuda_scatter_morton<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, order_dev, validate);
+        else if (elem_size == 4)
+            cuda_scatter_elem<float><<<blocks_per_grid, threads_per_block>>>(pat_dev, (float *)source, (float *)target, pat_len, delta, wrap, n, validate);
+        else if (elem_size == 16)
+            cuda_scatter_elem<double2><<<blocks_per_grid, threads_per_block>>>(pat_dev, (double2 *)source, (double2 *)target, pat_len, delta, wrap, n, validate);
+        else if (prefetch_distance > 0)
+            cuda_scatter_prefetch<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, prefetch_distance, prefetch_line, validate);
+        else if (atomic_flag == 0)
             cuda_scatter<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
         else
             cuda_scatter_atomic<<<blocks_per_grid, threads_per_block>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
@@ -792,78 +1128,247 @@ extern "C" float cuda_block_wrapper(uint dim, uint* grid, uint* block,
 
 }
 
+// Run n Gathers/Scatters split across ndevs devices and nstreams streams
+// per device. Every device has its own copy of the buffers, so device d
+// only needs the sparse slice its iterations touch. Each device is timed
+// with events on its default stream, which waits for the other (blocking)
+// streams; the aggregate time is the slowest device.
+extern "C" float cuda_block_multidev_wrapper(int ndevs, const int *devs, int nstreams,
+        unsigned long local_work_size,
+        enum sg_kernel kernel,
+        double **source,
+        double **target,
+        ssize_t **pat_dev,
+        ssize_t *pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        int atomic_flag,
+        char validate,
+        float *dev_time_ms)
+{
+    cudaEvent_t start[SP_MAX_CUDA_DEVICES], stop[SP_MAX_CUDA_DEVICES];
+    cudaStream_t *streams = (cudaStream_t*)malloc(sizeof(cudaStream_t) * ndevs * nstreams);
+
+    int threads_per_block = block_size(pat_len, local_work_size);
+
+    for (int d = 0; d < ndevs; d++) {
+        cudaSetDevice(devs[d]);
+        cudaEventCreate(&start[d]);
+        cudaEventCreate(&stop[d]);
+        for (int s = 0; s < nstreams; s++)
+            cudaStreamCreate(&streams[d * nstreams + s]);
+        cudaDeviceSynchronize();
+    }
+
+    // Launch everything before waiting on anything so the devices overlap
+    size_t nchunks = (size_t)ndevs * nstreams;
+    for (int d = 0; d < ndevs; d++) {
+        cudaSetDevice(devs[d]);
+        cudaEventRecord(start[d]);
+        for (int s = 0; s < nstreams; s++) {
+            size_t c = (size_t)d * nstreams + s;
+            size_t lo = n * c / nchunks;
+            size_t cnt = n * (c + 1) / nchunks - lo;
+            if (cnt == 0)
+                continue;
+            int blocks_per_grid = ((pat_len * cnt) + threads_per_block - 1) / threads_per_block;
+            double *sparse = source[d] + delta * lo;
+            cudaStream_t st = streams[c];
+            if (kernel == GATHER)
+                cuda_gather<<<blocks_per_grid, threads_per_block, 0, st>>>(pat_dev[d], sparse, target[d], pat_len, delta, wrap, cnt, validate);
+            else if (atomic_flag == 0)
+                cuda_scatter<<<blocks_per_grid, threads_per_block, 0, st>>>(pat_dev[d], sparse, target[d], pat_len, delta, wrap, cnt, validate);
+            else
+                cuda_scatter_atomic<<<blocks_per_grid, threads_per_block, 0, st>>>(pat_dev[d], sparse, target[d], pat_len, delta, wrap, cnt, validate);
+        }
+        cudaEventRecord(stop[d]);
+    }
+
+    float time_ms = 0;
+    for (int d = 0; d < ndevs; d++) {
+        cudaSetDevice(devs[d]);
+        cudaEventSynchronize(stop[d]);
+        cudaEventElapsedTime(&dev_time_ms[d], start[d], stop[d]);
+        if (dev_time_ms[d] > time_ms)
+            time_ms = dev_time_ms[d];
+        for (int s = 0; s < nstreams; s++)
+            cudaStreamDestroy(streams[d * nstreams + s]);
+        cudaEventDestroy(start[d]);
+        cudaEventDestroy(stop[d]);
+    }
+    cudaSetDevice(devs[0]);
+    free(streams);
+
+    return time_ms;
+}
+
+// A Gather or Scatter launch captured into a CUDA Graph, replayed once
+// per run. The pattern has already been uploaded by cuda_prepare_config, so
+// a timed run is one graph launch.
+struct sp_cuda_graph {
+    cudaStream_t stream;
+    cudaGraph_t graph;
+    cudaGraphExec_t exec;
+    cudaEvent_t start, stop;
+};
+
+extern "C" struct sp_cuda_graph *cuda_graph_create(unsigned long local_work_size,
+        enum sg_kernel kernel,
+        double *source,
+        double *target,
+        ssize_t *pat_dev,
+        ssize_t *pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        int atomic_flag,
+        char validate)
+{
+    struct sp_cuda_graph *g = (struct sp_cuda_graph*)malloc(sizeof(struct sp_cuda_graph));
+
+    int threads_per_block = block_size(pat_len, local_work_size);
+    int blocks_per_grid = ((pat_len * n) + threads_per_block - 1) / threads_per_block;
+
+    cudaStreamCreateWithFlags(&g->stream, cudaStreamNonBlocking);
+    cudaEventCreate(&g->start);
+    cudaEventCreate(&g->stop);
+
+    cudaStreamBeginCapture(g->stream, cudaStreamCaptureModeThreadLocal);
+    if (kernel == GATHER)
+        cuda_gather<<<blocks_per_grid, threads_per_block, 0, g->stream>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
+    else if (atomic_flag == 0)
+        cuda_scatter<<<blocks_per_grid, threads_per_block, 0, g->stream>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
+    else
+        cuda_scatter_atomic<<<blocks_per_grid, threads_per_block, 0, g->stream>>>(pat_dev, source, target, pat_len, delta, wrap, n, validate);
+    cudaStreamEndCapture(g->stream, &g->graph);
+
+    cudaError_t ret = cudaGraphInstantiate(&g->exec, g->graph, NULL, NULL, 0);
+    if (ret != cudaSuccess) {
+        printf("Could not instantiate CUDA graph: %s\n", cudaGetErrorName(ret));
+        exit(1);
+    }
+    // Upload the graph so the first timed launch does not pay for it
+    cudaGraphLaunch(g->exec, g->stream);
+    cudaStreamSynchronize(g->stream);
+    return g;
+}
+
+extern "C" float cuda_graph_launch(struct sp_cuda_graph *g, int *final_block_idx, int *final_thread_idx)
+{
+    cudaEventRecord(g->start, g->stream);
+    cudaGraphLaunch(g->exec, g->stream);
+    cudaEventRecord(g->stop, g->stream);
+    cudaEventSynchronize(g->stop);
+
+    cudaMemcpyFromSymbol(final_block_idx, final_block_idx_dev, sizeof(int), 0, cudaMemcpyDeviceToHost);
+    cudaMemcpyFromSymbol(final_thread_idx, final_thread_idx_dev, sizeof(int), 0, cudaMemcpyDeviceToHost);
+
+    float time_ms = 0;
+    cudaEventElapsedTime(&time_ms, g->start, g->stop);
+    return time_ms;
+}
+
+extern "C" void cuda_graph_destroy(struct sp_cuda_graph *g)
+{
+    cudaGraphExecDestroy(g->exec);
+    cudaGraphDestroy(g->graph);
+    cudaEventDestroy(g->start);
+    cudaEventDestroy(g->stop);
+    cudaStreamDestroy(g->stream);
+    free(g);
+}
+
+extern "C" void cuda_default_launch(const struct run_config *rc, struct sp_cuda_launch *launch)
+{
+    launch->threads = block_size(rc->pattern_len, rc->local_work_size);
+    launch->wpt = 1;
+    launch->shmem = 0;
+}
+
+// With one entry per thread these are the kernels cuda_block_wrapper runs
+static const void *tuned_kernel(enum sg_kernel kernel, int wpt)
+{
+    if (kernel == GATHER)
+        return wpt == 1 ? (const void *)cuda_gather : (const void *)cuda_gather_wpt;
+    return wpt == 1 ? (const void *)cuda_scatter : (const void *)cuda_scatter_wpt;
+}
+
+extern "C" int cuda_tuned_occupancy(enum sg_kernel kernel, const struct sp_cuda_launch *launch)
+{
+    int blocks = 0;
+    if (cudaOccupancyMaxActiveBlocksPerMultiprocessor(&blocks, tuned_kernel(kernel, launch->wpt), launch->threads, launch->shmem) != cudaSuccess)
+        return 0;
+    return blocks;
+}
+
+extern "C" float cuda_tuned_wrapper(enum sg_kernel kernel,
+        double *source,
+        double *target,
+        sgIdx_t *pat_dev,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        const struct sp_cuda_launch *launch)
+{
+    cudaEvent_t start, stop;
+    const ssize_t *pat = (const ssize_t *)pat_dev;
+    size_t per_block = (size_t)launch->threads * launch->wpt;
+    size_t blocks_per_grid = (pat_len * n + per_block - 1) / per_block;
+
+    timing_events(&start, &stop);
+
+    cudaDeviceSynchronize();
+    cudaEventRecord(start);
+    if (kernel == GATHER && launch->wpt == 1)
+        cuda_gather<<<blocks_per_grid, launch->threads, launch->shmem>>>(pat, source, target, pat_len, delta, wrap, n, 0);
+    else if (kernel == GATHER)
+        cuda_gather_wpt<<<blocks_per_grid, launch->threads, launch->shmem>>>(pat, source, target, pat_len, delta, wrap, n, launch->wpt);
+    else if (launch->wpt == 1)
+        cuda_scatter<<<blocks_per_grid, launch->threads, launch->shmem>>>(pat, source, target, pat_len, delta, wrap, n, 0);
+    else
+        cuda_scatter_wpt<<<blocks_per_grid, launch->threads, launch->shmem>>>(pat, source, target, pat_len, delta, wrap, n, launch->wpt);
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    float time_ms = 0;
+    cudaEventElapsedTime(&time_ms, start, stop);
+    return time_ms;
+}
+
 extern "C" float cuda_block_random_wrapper(uint dim, uint* grid, uint* block,
         enum sg_kernel kernel,
         double *source,
+        double *target,
         ssize_t* pat_dev,
         ssize_t* pat,
         size_t pat_len,
         size_t delta,
         size_t n,
         size_t wrap,
-        int wpt, size_t seed)
+        int wpt, size_t seed,
+        const uint32_t *bases_dev)
 {
     dim3 grid_dim, block_dim;
     cudaEvent_t start, stop;
 
     if(translate_args(dim, grid, block, &grid_dim, &block_dim)) return 0;
-    cudaMemcpy(pat_dev, pat, sizeof(sgIdx_t)*pat_len, cudaMemcpyHostToDevice);
+    // The kernels loop over the Gathers, at least one block runs them all
+    if (grid_dim.x == 0)
+        grid_dim.x = 1;
 
-    cudaEventCreate(&start);
-    cudaEventCreate(&stop);
+    timing_events(&start, &stop);
 
     cudaDeviceSynchronize();
     cudaEventRecord(start);
     // KERNEL
     if (kernel == GATHER) {
-        if (pat_len == 8) {
-            gather_block_random<8><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 16) {
-            gather_block_random<16><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 32) {
-            gather_block_random<32><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 64) {
-            gather_block_random<64><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 128) {
-            gather_block_random<128><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len ==256) {
-            gather_block_random<256><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 512) {
-            gather_block_random<512><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 1024) {
-            gather_block_random<1024><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 2048) {
-            gather_block_random<2048><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len ==4096) {
-            gather_block_random<4096><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else {
-            printf("ERROR NOT SUPPORTED: %zu\n", pat_len);
-        }
+        gather_random<<<grid_dim, block_dim>>>(source, target, pat_dev, pat_len, delta, wrap, seed, n, bases_dev);
     } else if (kernel == SCATTER) {
-        if (pat_len == 8) {
-            scatter_block_random<8><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 16) {
-            scatter_block_random<16><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 32) {
-            scatter_block_random<32><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 64) {
-            scatter_block_random<64><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 128) {
-            scatter_block_random<128><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len ==256) {
-            scatter_block_random<256><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 512) {
-            scatter_block_random<512><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 1024) {
-            scatter_block_random<1024><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len == 2048) {
-            scatter_block_random<2048><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else if (pat_len ==4096) {
-            scatter_block_random<4096><<<grid_dim, block_dim>>>(source, pat_dev, pat_len, delta, wpt, seed, n);
-        }else {
-            printf("ERROR NOT SUPPORTED, %zu\n", pat_len);
-        }
-
+        scatter_random<<<grid_dim, block_dim>>>(source, target, pat_dev, pat_len, delta, wrap, seed, n, bases_dev);
     }
     cudaEventRecord(stop);
     cudaEventSynchronize(stop);
@@ -876,6 +1381,113 @@ extern "C" float cuda_block_random_wrapper(uint dim, uint* grid, uint* block,
 
 }
 
+// PACK, UNPACK and TRANSPOSE: blocks of the local work size, at most 1024
+// threads, striding over the boxes, or for TRANSPOSE over their tiles
+extern "C" float cuda_box_wrapper(enum sp_box_op op,
+        double *source,
+        double *target,
+        const struct sp_box_rows *rows,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        size_t local_work_size)
+{
+    cudaEvent_t start, stop;
+    size_t threads = local_work_size < 1024 ? local_work_size : 1024;
+    size_t te = cell < 32 ? cell : 32;
+    size_t tc = SP_BOX_TILE / te;
+    size_t work = op == BOX_TRANSPOSE ? n * ((cells + tc - 1) / tc) * ((cell + te - 1) / te) : n;
+    unsigned blocks = work < (1u << 20) ? (unsigned)work : (1u << 20);
+    if (blocks == 0)
+        blocks = 1;
+
+    timing_events(&start, &stop);
+
+    cudaDeviceSynchronize();
+    cudaEventRecord(start);
+    if (op == BOX_PACK) {
+        size_t face_len = rows->n2 * rows->n1 * rows->run;
+        pack_box<<<blocks, threads>>>(source, target, rows->off, rows->run, rows->n1, rows->s1, rows->s2, face_len, delta, wrap, n);
+    } else if (op == BOX_UNPACK) {
+        size_t face_len = rows->n2 * rows->n1 * rows->run;
+        unpack_box<<<blocks, threads>>>(source, target, rows->off, rows->run, rows->n1, rows->s1, rows->s2, face_len, delta, wrap, n);
+    } else if (op == BOX_TRANSPOSE) {
+        transpose_box<<<blocks, threads>>>(source, target, cells, cell, tc, te, delta, wrap, n);
+    }
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    float time_ms = 0;
+    cudaEventElapsedTime(&time_ms, start, stop);
+    return time_ms;
+}
+
+// --cuda-async: blocks of the default size, each running wpt rounds, and
+// two rounds of doubles of shared memory per thread
+extern "C" float cuda_block_async_wrapper(enum sg_kernel kernel,
+        double *source,
+        double *target,
+        sgIdx_t *pat_dev,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t wrap,
+        size_t local_work_size,
+        int wpt,
+        int *final_block_idx,
+        int *final_thread_idx,
+        char validate)
+{
+    float time_ms = 0;
+#ifndef USE_HIP
+    cudaEvent_t start, stop;
+    const ssize_t *pat = (const ssize_t *)pat_dev;
+    int threads = block_size(pat_len, local_work_size);
+    size_t per_block = (size_t)threads * wpt;
+    size_t blocks_per_grid = (pat_len * n + per_block - 1) / per_block;
+    size_t shmem = 2 * threads * sizeof(double);
+
+    timing_events(&start, &stop);
+
+    cudaDeviceSynchronize();
+    cudaEventRecord(start);
+    switch (pat_len) {
+#define ASYNC_CASE(V) \
+    case V: \
+        if (kernel == GATHER) \
+            gather_block_async<V><<<blocks_per_grid, threads, shmem>>>(pat, source, target, delta, wrap, n, wpt, validate); \
+        else \
+            scatter_block_async<V><<<blocks_per_grid, threads, shmem>>>(pat, source, target, delta, wrap, n, wpt, validate); \
+        break;
+    ASYNC_CASE(8)
+    ASYNC_CASE(16)
+    ASYNC_CASE(32)
+    ASYNC_CASE(64)
+    ASYNC_CASE(73)
+    ASYNC_CASE(128)
+    ASYNC_CASE(256)
+    ASYNC_CASE(512)
+    ASYNC_CASE(1024)
+    ASYNC_CASE(2048)
+    ASYNC_CASE(4096)
+#undef ASYNC_CASE
+    default:
+        printf("ERROR NOT SUPPORTED: %zu\n", pat_len);
+        exit(1);
+    }
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    cudaMemcpyFromSymbol(final_block_idx, final_block_idx_dev, sizeof(int), 0, cudaMemcpyDeviceToHost);
+    cudaMemcpyFromSymbol(final_thread_idx, final_thread_idx_dev, sizeof(int), 0, cudaMemcpyDeviceToHost);
+
+    cudaEventElapsedTime(&time_ms, start, stop);
+#endif
+    return time_ms;
+}
+
 extern "C" float cuda_new_wrapper(uint dim, uint* grid, uint* block,
         enum sg_kernel kernel,
         double *source,
@@ -1065,6 +1677,26 @@ __global__ void cuda_scatter_gather(const size_t *pattern_scatter,
         sparse_scatter[pattern_scatter[j] + delta_scatter * i] = sparse_gather[pattern_gather[j] + delta_gather * i];
 }
 
+__global__ void cuda_scatter_gather_morton(const size_t *pattern_scatter,
+    double *sparse_scatter, const size_t *pattern_gather,
+    double *sparse_gather, const size_t pattern_length,
+    const size_t delta_scatter, const size_t delta_gather, const size_t wrap,
+    const size_t count, const uint32_t *order, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    if (i < count)
+        sparse_scatter[pattern_scatter[j] + delta_scatter * order[i]] = sparse_gather[pattern_gather[j] + delta_gather * order[i]];
+}
+
 template<int V>
 __global__ void sg_block(double *source, double* target, sgIdx_t* pat_gath, sgIdx_t* pat_scat, spSize_t pat_len, size_t delta_gather, size_t delta_scatter, int wpt, char validate)
 {
@@ -1130,6 +1762,7 @@ extern "C" float cuda_block_sg_wrapper(uint dim, uint* grid, uint* block,
         struct run_config* rc,
         sgIdx_t* pat_gath_dev,
         sgIdx_t* pat_scat_dev,
+        uint32_t *order_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -1150,19 +1783,17 @@ extern "C" float cuda_block_sg_wrapper(uint dim, uint* grid, uint* block,
     size_t n = rc->generic_len;
     size_t wrap = rc->wrap;
 
-    int threads_per_block = min(pat_len, (size_t)1024);
-    threads_per_block = min(threads_per_block, block[0]);
+    int threads_per_block = block_size(pat_len, block[0]);
     int blocks_per_grid = ((pat_len * n) + threads_per_block - 1) / threads_per_block;
 
-    cudaMemcpy(pat_gath_dev, rc->pattern_gather, sizeof(sgIdx_t)*rc->pattern_gather_len, cudaMemcpyHostToDevice);
-    cudaMemcpy(pat_scat_dev, rc->pattern_scatter, sizeof(sgIdx_t)*rc->pattern_scatter_len, cudaMemcpyHostToDevice);
-    cudaEventCreate(&start);
-    cudaEventCreate(&stop);
+    timing_events(&start, &stop);
 
     cudaDeviceSynchronize();
     cudaEventRecord(start);
 
-    if (atomic_flag == 0)
+    if (rc->ro_morton || rc->ro_hilbert)
+        cuda_scatter_gather_morton<<<blocks_per_grid, threads_per_block>>>(pat_scat_dev, target, pat_gath_dev, source, pat_len, delta_scatter, delta_gather, wrap, n, order_dev, validate);
+    else if (atomic_flag == 0)
         cuda_scatter_gather<<<blocks_per_grid, threads_per_block>>>(pat_scat_dev, target, pat_gath_dev, source, pat_len, delta_scatter, delta_gather, wrap, n, validate);   
     else
         cuda_scatter_gather_atomic<<<blocks_per_grid, threads_per_block>>>(pat_scat_dev, target, pat_gath_dev, source, pat_len, delta_scatter, delta_gather, wrap, n, validate);
@@ -1249,6 +1880,25 @@ __global__ void cuda_multi_scatter(const size_t *pattern,
         sparse[pattern[pattern_scatter[j]] + delta * i] = dense[j + pattern_length * (i % wrap)];
 }
 
+__global__ void cuda_multi_scatter_morton(const size_t *pattern,
+    const size_t *pattern_scatter, double *sparse, double *dense,
+    const size_t pattern_length, const size_t delta, const size_t wrap,
+    const size_t count, const uint32_t *order, char validate) {
+    size_t total_id = (size_t)((size_t)blockDim.x * (size_t)blockIdx.x + (size_t)threadIdx.x);
+    size_t j = total_id % pattern_length; // pat_idx
+    size_t i = total_id / pattern_length; // count_idx
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+    }
+    #endif
+
+    if (i < count)
+        sparse[pattern[pattern_scatter[j]] + delta * order[i]] = dense[j + pattern_length * (i % wrap)];
+}
+
 template<int V>
 __global__ void multiscatter_block(double *source, double* target, sgIdx_t* outer_pat, sgIdx_t* inner_pat, spSize_t pat_len, size_t delta, int wpt, char validate)
 {
@@ -1311,6 +1961,7 @@ extern "C" float cuda_block_multiscatter_wrapper(uint dim, uint* grid, uint* blo
         struct run_config* rc,
         sgIdx_t* outer_pat,
         sgIdx_t* inner_pat,
+        uint32_t *order_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -1329,20 +1980,18 @@ extern "C" float cuda_block_multiscatter_wrapper(uint dim, uint* grid, uint* blo
     size_t n = rc->generic_len;
     size_t wrap = rc->wrap;
 
-    int threads_per_block = min(pat_len, (size_t)1024);
-    threads_per_block = min(threads_per_block, block[0]);
+    int threads_per_block = block_size(pat_len, block[0]);
     int blocks_per_grid = ((pat_len * n) + threads_per_block - 1) / threads_per_block;
 
-    cudaMemcpy(outer_pat, rc->pattern, sizeof(sgIdx_t)*rc->pattern_len, cudaMemcpyHostToDevice);
-    cudaMemcpy(inner_pat, rc->pattern_scatter, sizeof(sgIdx_t)*rc->pattern_scatter_len, cudaMemcpyHostToDevice);
 
-    cudaEventCreate(&start);
-    cudaEventCreate(&stop);
+    timing_events(&start, &stop);
 
     cudaDeviceSynchronize();
     cudaEventRecord(start);
 
-    if (atomic_flag == 0)
+    if (rc->ro_morton || rc->ro_hilbert)
+        cuda_multi_scatter_morton<<<blocks_per_grid, threads_per_block>>>(outer_pat, inner_pat, source, target, pat_len, delta, wrap, n, order_dev, validate);
+    else if (atomic_flag == 0)
         cuda_multi_scatter<<<blocks_per_grid, threads_per_block>>>(outer_pat, inner_pat, source, target, pat_len, delta, wrap, n, validate);
     else
         cuda_multi_scatter_atomic<<<blocks_per_grid, threads_per_block>>>(outer_pat, inner_pat, source, target, pat_len, delta, wrap, n, validate);
@@ -1407,15 +2056,8 @@ __global__ void cuda_multi_gather(const size_t *pattern,
     }
     #endif
 
-    double x;
-
-    if (i < count) {
-        // dense[j + pattern_length * (i % wrap)] =
-        // sparse[pattern[pattern_gather[j]] + delta * i];
-        x = sparse[pattern[pattern_gather[j]] + delta * i];
-        if (x == 0.5)
-            dense[0] = x;
-    }
+    if (i < count)
+        dense[j + pattern_length * (i % wrap)] = sparse[pattern[pattern_gather[j]] + delta * i];
 }
 
 template<int V>
@@ -1455,8 +2097,46 @@ __global__ void multigather_block(double *source, double* target, sgIdx_t* outer
     target[tid%V] = source_loc[idx[idx_gath[tid%V]]];
 }
 
+// MultiGathers with multiple deltas, based as in gather_block_multidelta.
+// The inner pattern is resolved through the outer one once per block.
+template<int V>
+__global__ void multigather_block_multidelta(double *source, double* target, sgIdx_t* outer_pat, sgIdx_t* inner_pat, spSize_t pat_len, const size_t *deltas_ps, size_t deltas_len, size_t n, size_t wrap, int wpt, char validate)
+{
+    __shared__ int idx_shared[V];
+    __shared__ size_t base_shared[SP_BLOCK_GATHERS(V)];
+
+    int tid  = threadIdx.x;
+    int ngatherperblock = blockDim.x / V;
+    int gatherid = tid / V;
+    size_t first = (size_t)blockIdx.x * ngatherperblock;
+
+    if (tid < V) {
+        idx_shared[tid] = outer_pat[inner_pat[tid]];
+    }
+    if (tid < ngatherperblock) {
+        size_t i = first + tid;
+        base_shared[tid] = i / deltas_len * deltas_ps[deltas_len - 1] + deltas_ps[i % deltas_len] - deltas_ps[0];
+    }
+    __syncthreads();
+    if (gatherid >= ngatherperblock || first + gatherid >= n)
+        return;
+
+    double *source_loc = source + base_shared[gatherid];
+
+    #ifdef VALIDATE
+    if (validate) {
+        final_block_idx_dev = blockIdx.x;
+        final_thread_idx_dev = threadIdx.x;
+        final_gather_data_dev = source_loc[idx_shared[tid%V]];
+    }
+    #endif
+
+    target[tid%V + V*((first+gatherid)%wrap)] = source_loc[idx_shared[tid%V]];
+}
+
 #define INSTANTIATE5(V)\
-template __global__ void multigather_block<V>(double* source, double* target, sgIdx_t* outer_pat, sgIdx_t* inner_pat, spSize_t pat_len, size_t delta, int wpt, char validate);
+template __global__ void multigather_block<V>(double* source, double* target, sgIdx_t* outer_pat, sgIdx_t* inner_pat, spSize_t pat_len, size_t delta, int wpt, char validate);\
+template __global__ void multigather_block_multidelta<V>(double* source, double* target, sgIdx_t* outer_pat, sgIdx_t* inner_pat, spSize_t pat_len, const size_t *deltas_ps, size_t deltas_len, size_t n, size_t wrap, int wpt, char validate);
    
 //INSTANTIATE5(1);
 //INSTANTIATE5(2);
@@ -1480,6 +2160,7 @@ extern "C" float cuda_block_multigather_wrapper(uint dim, uint* grid, uint* bloc
         struct run_config* rc,
         sgIdx_t* outer_pat,
         sgIdx_t* inner_pat,
+        size_t *deltas_dev,
         int wpt,
         int *final_block_idx,
         int *final_thread_idx,
@@ -1497,20 +2178,25 @@ extern "C" float cuda_block_multigather_wrapper(uint dim, uint* grid, uint* bloc
 
     if(translate_args(dim, grid, block, &grid_dim, &block_dim)) return 0;
 
-    int threads_per_block = min(pat_len, (size_t)1024);
-    threads_per_block = min(threads_per_block, block[0]);
+    int threads_per_block = block_size(pat_len, block[0]);
     int blocks_per_grid = ((pat_len * n) + threads_per_block - 1) / threads_per_block;
 
-    cudaMemcpy(outer_pat, rc->pattern, sizeof(sgIdx_t)*rc->pattern_len, cudaMemcpyHostToDevice);
-    cudaMemcpy(inner_pat, rc->pattern_gather, sizeof(sgIdx_t)*rc->pattern_gather_len, cudaMemcpyHostToDevice);
 
-    cudaEventCreate(&start);
-    cudaEventCreate(&stop);
+    timing_events(&start, &stop);
 
     cudaDeviceSynchronize();
     cudaEventRecord(start);
 
-    cuda_multi_gather<<<blocks_per_grid, threads_per_block>>>(outer_pat, inner_pat, source, target, pat_len, delta, wrap, n, validate);
+    if (rc->deltas_len > 1) {
+        static const void *const kernels[] = BLOCK_KERNELS(multigather_block_multidelta);
+        size_t deltas_len = rc->deltas_len;
+        dim3 md_grid, md_block;
+        multidelta_dims(pat_len, n, block[0], &md_grid, &md_block);
+        void *args[] = {&source, &target, &outer_pat, &inner_pat, &pat_len, &deltas_dev, &deltas_len, &n, &wrap, &wpt, &validate};
+        launch_block("multigather_block_multidelta", kernels, pat_len, md_grid, md_block, args);
+    } else {
+        cuda_multi_gather<<<blocks_per_grid, threads_per_block>>>(outer_pat, inner_pat, source, target, pat_len, delta, wrap, n, validate);
+    }
 
  /*   
     // KERNEL
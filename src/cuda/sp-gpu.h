@@ -0,0 +1,84 @@
+#ifndef SP_GPU_H
+#define SP_GPU_H
+/* The CUDA backend sources build unchanged for AMD GPUs with HIP
+ * (-DBACKEND=hip). This header maps the CUDA runtime, driver, NVRTC and
+ * cuRAND names they use onto HIP, HIPRTC and hipRAND, and includes the
+ * CUDA headers otherwise.
+ */
+#ifdef USE_HIP
+#include <hip/hip_runtime.h>
+
+#define cudaError_t                         hipError_t
+#define cudaSuccess                         hipSuccess
+#define cudaGetErrorName                    hipGetErrorName
+#define cudaGetErrorString                  hipGetErrorString
+#define cudaGetLastError                    hipGetLastError
+
+#define cudaDeviceProp                      hipDeviceProp_t
+#define cudaGetDeviceProperties             hipGetDeviceProperties
+#define cudaGetDeviceCount                  hipGetDeviceCount
+#define cudaGetDevice                       hipGetDevice
+#define cudaSetDevice                       hipSetDevice
+#define cudaDeviceGetAttribute              hipDeviceGetAttribute
+#define cudaDeviceSynchronize               hipDeviceSynchronize
+#define cudaOccupancyMaxActiveBlocksPerMultiprocessor hipOccupancyMaxActiveBlocksPerMultiprocessor
+#define cudaLaunchKernel                    hipLaunchKernel
+
+#define cudaMalloc                          hipMalloc
+#define cudaMemcpy                          hipMemcpy
+#define cudaMemcpyHostToDevice              hipMemcpyHostToDevice
+#define cudaMemcpyDeviceToHost              hipMemcpyDeviceToHost
+#define cudaMemcpyFromSymbol(dst, sym, ...) hipMemcpyFromSymbol(dst, HIP_SYMBOL(sym), __VA_ARGS__)
+#define cudaMallocManaged                   hipMallocManaged
+#define cudaMemAttachGlobal                 hipMemAttachGlobal
+#define cudaHostAlloc                       hipHostMalloc
+#define cudaHostAllocMapped                 hipHostMallocMapped
+#define cudaHostGetDevicePointer            hipHostGetDevicePointer
+#define cudaMemAdvise                       hipMemAdvise
+#define cudaMemAdviseSetReadMostly          hipMemAdviseSetReadMostly
+#define cudaMemAdviseSetPreferredLocation   hipMemAdviseSetPreferredLocation
+#define cudaMemAdviseSetAccessedBy          hipMemAdviseSetAccessedBy
+#define cudaMemPrefetchAsync                hipMemPrefetchAsync
+#define cudaCpuDeviceId                     hipCpuDeviceId
+#define cudaDevAttrPageableMemoryAccess     hipDeviceAttributePageableMemoryAccess
+#define cudaDevAttrMultiProcessorCount      hipDeviceAttributeMultiprocessorCount
+#define cudaDevAttrMaxThreadsPerBlock       hipDeviceAttributeMaxThreadsPerBlock
+
+#define cudaEvent_t                         hipEvent_t
+#define cudaEventCreate                     hipEventCreate
+#define cudaEventDestroy                    hipEventDestroy
+#define cudaEventRecord                     hipEventRecord
+#define cudaEventSynchronize                hipEventSynchronize
+#define cudaEventElapsedTime                hipEventElapsedTime
+
+#define cudaStream_t                        hipStream_t
+#define cudaStreamCreate                    hipStreamCreate
+#define cudaStreamCreateWithFlags           hipStreamCreateWithFlags
+#define cudaStreamNonBlocking               hipStreamNonBlocking
+#define cudaStreamDestroy                   hipStreamDestroy
+#define cudaStreamSynchronize               hipStreamSynchronize
+#define cudaStreamBeginCapture              hipStreamBeginCapture
+#define cudaStreamEndCapture                hipStreamEndCapture
+#define cudaStreamCaptureModeThreadLocal    hipStreamCaptureModeThreadLocal
+
+#define cudaGraph_t                         hipGraph_t
+#define cudaGraphExec_t                     hipGraphExec_t
+#define cudaGraphInstantiate                hipGraphInstantiate
+#define cudaGraphLaunch                     hipGraphLaunch
+#define cudaGraphDestroy                    hipGraphDestroy
+#define cudaGraphExecDestroy                hipGraphExecDestroy
+
+// Module API, used by cuda-jit.cu
+#define CUresult                            hipError_t
+#define CUDA_SUCCESS                        hipSuccess
+#define CUmodule                            hipModule_t
+#define CUfunction                          hipFunction_t
+#define cuModuleLoadData                    hipModuleLoadData
+#define cuModuleGetFunction                 hipModuleGetFunction
+#define cuLaunchKernel                      hipModuleLaunchKernel
+
+#else
+#include <cuda.h>
+#include <cuda_runtime.h>
+#endif
+#endif
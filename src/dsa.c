@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dsa.h"
+
+int sp_dsa_parse(const char *arg, char *wq, size_t wq_len, size_t *submitters)
+{
+    const char *colon = strrchr(arg, ':');
+    size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+    if (len == 0 || len >= wq_len)
+        return -1;
+    memcpy(wq, arg, len);
+    wq[len] = '\0';
+
+    *submitters = 1;
+    if (colon) {
+        char *end;
+        long t = strtol(colon + 1, &end, 10);
+        if (*end || t < 1)
+            return -1;
+        *submitters = (size_t)t;
+    }
+    return 0;
+}
+
+#ifdef USE_DSA
+#include <fcntl.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <immintrin.h>
+#include "sp_alloc.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+#else
+#define omp_get_thread_num() 0
+#endif
+
+#define PORTAL_SIZE 4096
+
+// Read one value of the sysfs directory of a work queue or device
+static int sysfs_read(const char *dev, const char *attr, char *buf, size_t len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/bus/dsa/devices/%s/%s", dev, attr);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    int ok = fgets(buf, len, f) != NULL;
+    fclose(f);
+    if (!ok)
+        return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+void sp_dsa_open(struct sp_dsa *dsa, const char *wq, size_t submitters)
+{
+    memset(dsa, 0, sizeof(*dsa));
+    dsa->submitters = submitters;
+
+    char path[256], name[64], buf[64];
+    snprintf(path, sizeof(path), "%s", wq);
+    snprintf(name, sizeof(name), "%s", basename(path));
+    unsigned dev, q;
+    if (sscanf(name, "wq%u.%u", &dev, &q) != 2)
+        error("--dsa takes the character device of a work queue, e.g. /dev/dsa/wq0.0", ERROR);
+
+    if (sysfs_read(name, "mode", buf, sizeof(buf)))
+        error("DSA: unable to read the mode of the work queue from sysfs", ERROR);
+    dsa->shared = !strcmp(buf, "shared");
+    if (sysfs_read(name, "size", buf, sizeof(buf)) || (dsa->wq_size = strtoul(buf, NULL, 10)) == 0)
+        error("DSA: unable to read the size of the work queue from sysfs", ERROR);
+    char devname[32];
+    snprintf(devname, sizeof(devname), "dsa%u", dev);
+    if (sysfs_read(devname, "max_batch_size", buf, sizeof(buf)) || (dsa->max_batch = strtoul(buf, NULL, 10)) < 2)
+        error("DSA: unable to read the batch size of the device from sysfs", ERROR);
+
+    dsa->fd = open(wq, O_RDWR);
+    if (dsa->fd < 0)
+        error("DSA: unable to open the work queue, is it enabled and are its permissions set?", ERROR);
+    dsa->portal = mmap(NULL, PORTAL_SIZE, PROT_WRITE, MAP_SHARED | MAP_POPULATE, dsa->fd, 0);
+    if (dsa->portal == MAP_FAILED)
+        error("DSA: unable to map the portal of the work queue", ERROR);
+}
+
+// Append the moves of one Gather or Scatter, a descriptor per contiguous
+// run of the pattern
+static size_t add_moves(struct dsa_hw_desc *d, const ssize_t *pat, size_t len, sgData_t *sparse, sgData_t *dense, int gather)
+{
+    size_t n = 0;
+    for (size_t j = 0; j < len; ) {
+        size_t k = j + 1;
+        while (k < len && pat[k] == pat[k - 1] + 1)
+            k++;
+        if (d) {
+            memset(&d[n], 0, sizeof(d[n]));
+            d[n].opcode = DSA_OPCODE_MEMMOVE;
+            // The destination lands in the cache, as a core's stores do
+            d[n].flags = IDXD_OP_FLAG_CC;
+            d[n].src_addr = (uintptr_t)(gather ? sparse + pat[j] : dense + j);
+            d[n].dst_addr = (uintptr_t)(gather ? dense + j : sparse + pat[j]);
+            d[n].xfer_size = (uint32_t)((k - j) * sizeof(sgData_t));
+        }
+        n++;
+        j = k;
+    }
+    return n;
+}
+
+void sp_dsa_prepare(struct sp_dsa *dsa, struct run_config *rc, sgDataBuf *source, sgDataBuf *target)
+{
+    int gather = rc->kernel == GATHER;
+    sgData_t *dense = target->host_ptrs[0];
+    size_t per = add_moves(NULL, rc->pattern, rc->pattern_len, NULL, NULL, gather);
+
+    dsa->ndescs = per * rc->generic_len;
+    dsa->nbatches = (dsa->ndescs + dsa->max_batch - 1) / dsa->max_batch;
+    dsa->descs = (struct dsa_hw_desc *)sp_malloc(sizeof(struct dsa_hw_desc), dsa->ndescs, ALIGN_CACHE);
+    dsa->batches = (struct dsa_hw_desc *)sp_malloc(sizeof(struct dsa_hw_desc), dsa->nbatches, ALIGN_CACHE);
+    dsa->comps = (struct dsa_completion_record *)sp_malloc(sizeof(struct dsa_completion_record), dsa->nbatches, ALIGN_CACHE);
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < rc->generic_len; i++)
+        add_moves(dsa->descs + i * per, rc->pattern, rc->pattern_len, source->host_ptr + rc->delta * i,
+                dense + rc->pattern_len * (i % rc->wrap), gather);
+
+    // A batch of one descriptor is invalid, the last one may go alone
+    for (size_t b = 0; b < dsa->nbatches; b++) {
+        size_t first = b * dsa->max_batch;
+        size_t count = dsa->ndescs - first < dsa->max_batch ? dsa->ndescs - first : dsa->max_batch;
+        struct dsa_hw_desc *d = &dsa->batches[b];
+        if (count == 1) {
+            *d = dsa->descs[first];
+        } else {
+            memset(d, 0, sizeof(*d));
+            d->opcode = DSA_OPCODE_BATCH;
+            d->desc_list_addr = (uintptr_t)&dsa->descs[first];
+            d->desc_count = (uint32_t)count;
+        }
+        d->flags |= IDXD_OP_FLAG_RCR | IDXD_OP_FLAG_CRAV;
+        d->completion_addr = (uintptr_t)&dsa->comps[b];
+    }
+}
+
+static void movdir64b(void *portal, const void *desc)
+{
+    __asm__ volatile(".byte 0x66, 0x0f, 0x38, 0xf8, 0x02" : : "a"(portal), "d"(desc) : "memory");
+}
+
+// 1 if the shared queue was full and the descriptor must be sent again
+static int enqcmd(void *portal, const void *desc)
+{
+    uint8_t retry;
+    __asm__ volatile(".byte 0xf2, 0x0f, 0x38, 0xf8, 0x02\n\t"
+            "setz %0" : "=r"(retry) : "a"(portal), "d"(desc) : "memory");
+    return retry;
+}
+
+static void wait_comp(struct dsa_completion_record *c)
+{
+    while (c->status == 0)
+        _mm_pause();
+    if ((c->status & DSA_COMP_STATUS_MASK) != DSA_COMP_SUCCESS) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "DSA: a batch completed with status 0x%x, at address 0x%lx",
+                c->status & DSA_COMP_STATUS_MASK, (unsigned long)c->fault_addr);
+        error(msg, ERROR);
+    }
+}
+
+void sp_dsa_run(struct sp_dsa *dsa)
+{
+    size_t nsub = dsa->submitters;
+    // The queue is split between the submitters, each keeps depth of its
+    // batches in flight and waits for the oldest before the next
+    size_t depth = dsa->wq_size / nsub;
+    if (depth < 1)
+        depth = 1;
+    memset(dsa->comps, 0, sizeof(struct dsa_completion_record) * dsa->nbatches);
+    _mm_sfence();
+
+    #pragma omp parallel num_threads(nsub)
+    {
+        size_t t = omp_get_thread_num();
+        size_t sent = 0;
+        for (size_t b = t; b < dsa->nbatches; b += nsub, sent++) {
+            if (sent >= depth)
+                wait_comp(&dsa->comps[b - depth * nsub]);
+            if (dsa->shared) {
+                while (enqcmd(dsa->portal, &dsa->batches[b]))
+                    _mm_pause();
+            } else {
+                movdir64b(dsa->portal, &dsa->batches[b]);
+            }
+        }
+        size_t first = sent > depth ? sent - depth : 0;
+        for (size_t k = first; k < sent; k++)
+            wait_comp(&dsa->comps[t + k * nsub]);
+    }
+}
+
+void sp_dsa_release(struct sp_dsa *dsa)
+{
+    sp_free(dsa->descs);
+    sp_free(dsa->batches);
+    sp_free(dsa->comps);
+    dsa->descs = dsa->batches = NULL;
+    dsa->comps = NULL;
+}
+
+void sp_dsa_close(struct sp_dsa *dsa)
+{
+    munmap(dsa->portal, PORTAL_SIZE);
+    close(dsa->fd);
+}
+#endif
@@ -0,0 +1,275 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include "energy.h"
+#include "parse-args.h" //error
+
+#ifdef USE_NVML
+#include <nvml.h>
+#endif
+
+#define SP_ENERGY_MAX_ZONES 32
+#define SP_ENERGY_MAX_GPUS 16
+
+#define SP_POWERCAP "/sys/class/powercap"
+
+// Intel RAPL MSRs, see the Intel SDM vol. 4
+#define SP_MSR_RAPL_POWER_UNIT   0x606
+#define SP_MSR_PKG_ENERGY_STATUS 0x611
+#define SP_MSR_DRAM_ENERGY_STATUS 0x619
+
+// One RAPL counter: a powercap energy_uj file, or an MSR read through
+// /dev/cpu/N/msr. Both wrap around, at range joules.
+struct zone
+{
+    enum sp_energy_domain domain;
+    int fd;
+    int msr;       // MSR address, 0 for a powercap file
+    double unit;   // joules per count
+    double range;  // joules at which the counter wraps
+    uint64_t start;
+};
+
+static struct zone zones[SP_ENERGY_MAX_ZONES];
+static int nzones = 0;
+static int available[SP_ENERGY_DOMAINS];
+
+#ifdef USE_NVML
+static nvmlDevice_t gpus[SP_ENERGY_MAX_GPUS];
+static unsigned long long gpu_start[SP_ENERGY_MAX_GPUS];
+static int ngpu = 0;
+#endif
+
+static int read_zone(const struct zone *z, uint64_t *v)
+{
+    if (z->msr) {
+        return pread(z->fd, v, sizeof(*v), z->msr) == sizeof(*v) ? 0 : -1;
+    }
+    char buf[32];
+    ssize_t len = pread(z->fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    *v = strtoull(buf, NULL, 10);
+    return 0;
+}
+
+static int add_zone(enum sp_energy_domain d, int fd, int msr, double unit, double range)
+{
+    if (nzones == SP_ENERGY_MAX_ZONES) {
+        close(fd);
+        return -1;
+    }
+    struct zone *z = &zones[nzones];
+    z->domain = d;
+    z->fd = fd;
+    z->msr = msr;
+    z->unit = unit;
+    z->range = range;
+    uint64_t v;
+    if (read_zone(z, &v)) {
+        close(fd);
+        return -1;
+    }
+    nzones++;
+    available[d] = 1;
+    return 0;
+}
+
+static int read_line(const char *path, char *buf, size_t len)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+    int ok = fgets(buf, (int)len, fp) != NULL;
+    fclose(fp);
+    if (!ok)
+        return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// Packages are intel-rapl:N, their DRAM a subzone intel-rapl:N:M named
+// "dram". Core, uncore and psys zones overlap the package and are skipped.
+static void init_powercap(void)
+{
+    DIR *dir = opendir(SP_POWERCAP);
+    if (!dir)
+        return;
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (strncmp(ent->d_name, "intel-rapl:", 11))
+            continue;
+
+        // Room for any zone name and the longest file name below
+        char path[sizeof(SP_POWERCAP) + NAME_MAX + 32];
+        char name[STRING_SIZE];
+        snprintf(path, sizeof(path), SP_POWERCAP "/%s/name", ent->d_name);
+        if (read_line(path, name, sizeof(name)))
+            continue;
+
+        enum sp_energy_domain d;
+        if (!strncmp(name, "package", 7))
+            d = SP_ENERGY_PKG;
+        else if (!strcmp(name, "dram"))
+            d = SP_ENERGY_DRAM;
+        else
+            continue;
+
+        char range[STRING_SIZE];
+        snprintf(path, sizeof(path), SP_POWERCAP "/%s/max_energy_range_uj", ent->d_name);
+        if (read_line(path, range, sizeof(range)))
+            continue;
+
+        snprintf(path, sizeof(path), SP_POWERCAP "/%s/energy_uj", ent->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            continue;
+        add_zone(d, fd, 0, 1e-6, strtoull(range, NULL, 10) * 1e-6);
+    }
+    closedir(dir);
+}
+
+// One CPU of every package reads the package and DRAM energy status MSRs.
+// The counters are 32 bits wide, in the energy unit of the power unit MSR.
+static void init_msr(void)
+{
+    int seen[SP_ENERGY_MAX_ZONES] = {0};
+    for (int cpu = 0; ; cpu++) {
+        char path[STRING_SIZE];
+        char id[STRING_SIZE];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        if (read_line(path, id, sizeof(id)))
+            break;
+        int pkg = atoi(id);
+        if (pkg < 0 || pkg >= SP_ENERGY_MAX_ZONES || seen[pkg])
+            continue;
+        seen[pkg] = 1;
+
+        snprintf(path, sizeof(path), "/dev/cpu/%d/msr", cpu);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        uint64_t units;
+        if (pread(fd, &units, sizeof(units), SP_MSR_RAPL_POWER_UNIT) != sizeof(units)) {
+            close(fd);
+            return;
+        }
+        double unit = 1.0 / (double)(1ULL << ((units >> 8) & 0x1f));
+        double range = unit * 4294967296.0;
+
+        int dram_fd = dup(fd);
+        add_zone(SP_ENERGY_PKG, fd, SP_MSR_PKG_ENERGY_STATUS, unit, range);
+        if (dram_fd >= 0)
+            add_zone(SP_ENERGY_DRAM, dram_fd, SP_MSR_DRAM_ENERGY_STATUS, unit, range);
+    }
+}
+
+int sp_energy_init(const char *const *gpu_bus_ids, int ngpus)
+{
+    memset(available, 0, sizeof(available));
+    init_powercap();
+    if (nzones == 0)
+        init_msr();
+
+#ifdef USE_NVML
+    if (ngpus > 0 && nvmlInit() == NVML_SUCCESS) {
+        for (int g = 0; g < ngpus && ngpu < SP_ENERGY_MAX_GPUS; g++) {
+            nvmlDevice_t dev;
+            unsigned long long mj;
+            if (nvmlDeviceGetHandleByPciBusId(gpu_bus_ids[g], &dev) != NVML_SUCCESS ||
+                    nvmlDeviceGetTotalEnergyConsumption(dev, &mj) != NVML_SUCCESS)
+                continue;
+            gpus[ngpu++] = dev;
+        }
+        if (ngpu > 0)
+            available[SP_ENERGY_GPU] = 1;
+        else
+            nvmlShutdown();
+    }
+#else
+    (void)gpu_bus_ids;
+    (void)ngpus;
+#endif
+
+    int n = 0;
+    for (int d = 0; d < SP_ENERGY_DOMAINS; d++)
+        n += available[d];
+    return n;
+}
+
+int sp_energy_available(enum sp_energy_domain d)
+{
+    return available[d];
+}
+
+const char *sp_energy_name(enum sp_energy_domain d)
+{
+    static const char *names[] = {"pkg(J)", "dram(J)", "gpu(J)"};
+    return names[d];
+}
+
+void sp_energy_start(void)
+{
+    for (int i = 0; i < nzones; i++)
+        read_zone(&zones[i], &zones[i].start);
+#ifdef USE_NVML
+    for (int g = 0; g < ngpu; g++)
+        nvmlDeviceGetTotalEnergyConsumption(gpus[g], &gpu_start[g]);
+#endif
+}
+
+void sp_energy_stop(struct sp_energy *e)
+{
+    memset(e, 0, sizeof(*e));
+    for (int i = 0; i < nzones; i++) {
+        uint64_t v;
+        if (read_zone(&zones[i], &v))
+            continue;
+        if (zones[i].msr)
+            v &= 0xffffffffULL;
+        uint64_t s = zones[i].msr ? zones[i].start & 0xffffffffULL : zones[i].start;
+        double j = ((double)v - (double)s) * zones[i].unit;
+        if (v < s)
+            j += zones[i].range;
+        e->joules[zones[i].domain] += j;
+    }
+#ifdef USE_NVML
+    for (int g = 0; g < ngpu; g++) {
+        unsigned long long mj;
+        if (nvmlDeviceGetTotalEnergyConsumption(gpus[g], &mj) == NVML_SUCCESS)
+            e->joules[SP_ENERGY_GPU] += (mj - gpu_start[g]) * 1e-3;
+    }
+#endif
+}
+
+double sp_energy_total(const struct sp_energy *e)
+{
+    double j = 0;
+    for (int d = 0; d < SP_ENERGY_DOMAINS; d++)
+        if (available[d])
+            j += e->joules[d];
+    return j;
+}
+
+void sp_energy_finalize(void)
+{
+    for (int i = 0; i < nzones; i++) {
+        close(zones[i].fd);
+    }
+    nzones = 0;
+#ifdef USE_NVML
+    if (ngpu > 0)
+        nvmlShutdown();
+    ngpu = 0;
+#endif
+    memset(available, 0, sizeof(available));
+}
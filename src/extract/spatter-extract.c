@@ -0,0 +1,430 @@
+// spatter-extract: mine the recurring Gather/Scatter patterns of binary
+// traces (the .idx.gz files of -pTRACE) into a Spatter JSON suite.
+//
+// A trace is cut into windows of --pattern-len indices, one per Gather or
+// Scatter. Each window becomes a pattern, its indices less its smallest
+// one, and a delta, the distance from the smallest index of the window
+// before. The threads count the (pattern, delta) pairs of their share of
+// each chunk in their own hash table, the tables are merged at the end of
+// the trace, and the most frequent pairs become the configs of the suite,
+// with count set to the number of windows they cover.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "trace-stream.h"
+#include "parse-args.h" //error
+
+// Indices handed to the threads at a time
+#define EXTRACT_CHUNK (1 << 21)
+// Most slots of the table of one thread, and of the merged table. When a
+// table fills up, the pairs seen least often are dropped, so the counts are
+// approximate for traces with more distinct pairs than this.
+#define EXTRACT_THREAD_SLOTS (1 << 18)
+#define EXTRACT_MERGED_SLOTS (1 << 22)
+
+extern FILE *err_file;
+
+struct pat_table {
+    size_t V;
+    size_t cap;     // slots, a power of two
+    size_t limit;   // most slots
+    size_t n;       // pairs held
+    uint64_t *hash;
+    int64_t *delta;
+    uint64_t *count; // 0 marks an empty slot
+    int64_t *pat;    // V indices per slot
+};
+
+static uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t pat_hash(const int64_t *pat, size_t V, int64_t delta)
+{
+    uint64_t h = mix64((uint64_t)delta);
+    for (size_t j = 0; j < V; j++)
+        h = mix64(h ^ (uint64_t)pat[j]);
+    return h;
+}
+
+static void table_alloc(struct pat_table *t, size_t V, size_t cap, size_t limit)
+{
+    t->V = V;
+    t->cap = cap;
+    t->limit = limit;
+    t->n = 0;
+    t->hash = (uint64_t *)malloc(cap * sizeof(uint64_t));
+    t->delta = (int64_t *)malloc(cap * sizeof(int64_t));
+    t->count = (uint64_t *)calloc(cap, sizeof(uint64_t));
+    t->pat = (int64_t *)malloc(cap * V * sizeof(int64_t));
+    if (!t->hash || !t->delta || !t->count || !t->pat)
+        error("Unable to allocate the pattern table", ERROR);
+}
+
+static void table_free(struct pat_table *t)
+{
+    free(t->hash);
+    free(t->delta);
+    free(t->count);
+    free(t->pat);
+}
+
+// Add count to the pair, which is new if it is not in the table yet
+static void table_put(struct pat_table *t, uint64_t h, const int64_t *pat, int64_t delta, uint64_t count)
+{
+    size_t V = t->V;
+    for (size_t s = h & (t->cap - 1);; s = (s + 1) & (t->cap - 1)) {
+        if (!t->count[s]) {
+            t->hash[s] = h;
+            t->delta[s] = delta;
+            t->count[s] = count;
+            memcpy(t->pat + s * V, pat, V * sizeof(int64_t));
+            t->n++;
+            return;
+        }
+        if (t->hash[s] == h && t->delta[s] == delta && !memcmp(t->pat + s * V, pat, V * sizeof(int64_t))) {
+            t->count[s] += count;
+            return;
+        }
+    }
+}
+
+// Move the pairs seen more than min_count times into a table of cap slots
+static void table_rebuild(struct pat_table *t, size_t cap, uint64_t min_count)
+{
+    struct pat_table old = *t;
+    table_alloc(t, old.V, cap, old.limit);
+    for (size_t s = 0; s < old.cap; s++)
+        if (old.count[s] > min_count)
+            table_put(t, old.hash[s], old.pat + s * old.V, old.delta[s], old.count[s]);
+    table_free(&old);
+}
+
+// Make room for one more pair: double the table, or once it is at its
+// limit, drop the rarest pairs until at most a quarter of the slots is used
+static void table_reserve(struct pat_table *t)
+{
+    if ((t->n + 1) * 2 <= t->cap)
+        return;
+    if (t->cap < t->limit) {
+        table_rebuild(t, t->cap * 2, 0);
+        return;
+    }
+    uint64_t min_count = 1;
+    for (;;) {
+        size_t keep = 0;
+        for (size_t s = 0; s < t->cap; s++)
+            keep += t->count[s] > min_count;
+        if (keep * 4 <= t->cap)
+            break;
+        min_count *= 2;
+    }
+    table_rebuild(t, t->cap, min_count);
+}
+
+static void table_add(struct pat_table *t, const int64_t *pat, int64_t delta, uint64_t count)
+{
+    table_reserve(t);
+    table_put(t, pat_hash(pat, t->V, delta), pat, delta, count);
+}
+
+// The windows of one chunk, shared by the threads
+struct extract_job {
+    const uint64_t *idx;
+    size_t nwin;
+    size_t V;
+    int have_prev;     // whether prev_base holds the base of the window before idx
+    uint64_t prev_base;
+    int done;
+};
+
+struct extract_worker {
+    pthread_t thread;
+    int id;
+    int nthreads;
+    struct extract_job *job;
+    pthread_barrier_t *barrier;
+    struct pat_table table;
+};
+
+static uint64_t window_min(const uint64_t *w, size_t V)
+{
+    uint64_t m = w[0];
+    for (size_t j = 1; j < V; j++)
+        if (w[j] < m)
+            m = w[j];
+    return m;
+}
+
+static void count_windows(struct extract_worker *w)
+{
+    struct extract_job *job = w->job;
+    size_t V = job->V;
+    size_t a = job->nwin * w->id / w->nthreads;
+    size_t b = job->nwin * (w->id + 1) / w->nthreads;
+    int64_t pat[V];
+
+    int have_prev = a > 0 || job->have_prev;
+    uint64_t prev = a > 0 ? window_min(job->idx + (a - 1) * V, V) : job->prev_base;
+    for (size_t i = a; i < b; i++) {
+        const uint64_t *win = job->idx + i * V;
+        uint64_t base = window_min(win, V);
+        for (size_t j = 0; j < V; j++)
+            pat[j] = (int64_t)(win[j] - base);
+        // The first window of the trace has no delta. A window below the
+        // one before counts with the same stride forward.
+        if (have_prev)
+            table_add(&w->table, pat, base >= prev ? (int64_t)(base - prev) : (int64_t)(prev - base), 1);
+        prev = base;
+        have_prev = 1;
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    struct extract_worker *w = (struct extract_worker *)arg;
+    for (;;) {
+        pthread_barrier_wait(w->barrier);
+        if (w->job->done)
+            return NULL;
+        count_windows(w);
+        pthread_barrier_wait(w->barrier);
+    }
+}
+
+struct pat_entry {
+    uint64_t count;
+    int64_t delta;
+    const int64_t *pat;
+};
+
+static size_t sort_V;
+
+// Most frequent first, ties by delta and then pattern
+static int entry_cmp(const void *a, const void *b)
+{
+    const struct pat_entry *x = (const struct pat_entry *)a;
+    const struct pat_entry *y = (const struct pat_entry *)b;
+    if (x->count != y->count)
+        return x->count > y->count ? -1 : 1;
+    if (x->delta != y->delta)
+        return x->delta < y->delta ? -1 : 1;
+    for (size_t j = 0; j < sort_V; j++)
+        if (x->pat[j] != y->pat[j])
+            return x->pat[j] < y->pat[j] ? -1 : 1;
+    return 0;
+}
+
+// Kernel of a trace named <rank>.<n>.R.idx.gz (Gather) or .W. (Scatter)
+static const char *trace_kernel(const char *file, const char *fallback)
+{
+    char *copy = strdup(file);
+    const char *base = basename(copy);
+    const char *kernel = fallback;
+    if (strstr(base, ".R."))
+        kernel = "Gather";
+    else if (strstr(base, ".W."))
+        kernel = "Scatter";
+    free(copy);
+    return kernel;
+}
+
+// Mine one trace and write its top configs to out
+static void extract_trace(const char *file, const char *kernel, size_t V, int nconfigs,
+        struct extract_worker *workers, int nthreads, struct extract_job *job,
+        pthread_barrier_t *barrier, FILE *out, int *first)
+{
+    struct sp_trace_stream *s = sp_trace_open(file, EXTRACT_CHUNK);
+    uint64_t *work = (uint64_t *)malloc((EXTRACT_CHUNK + V) * sizeof(uint64_t));
+    size_t carry = 0, total_win = 0, n;
+    const uint64_t *chunk;
+
+    for (int t = 0; t < nthreads; t++)
+        table_alloc(&workers[t].table, V, 1024, EXTRACT_THREAD_SLOTS);
+
+    job->V = V;
+    job->have_prev = 0;
+    while ((n = sp_trace_next(s, &chunk))) {
+        memcpy(work + carry, chunk, n * sizeof(uint64_t));
+        size_t len = carry + n;
+        job->idx = work;
+        job->nwin = len / V;
+        pthread_barrier_wait(barrier);
+        pthread_barrier_wait(barrier);
+        if (job->nwin > 0) {
+            job->prev_base = window_min(work + (job->nwin - 1) * V, V);
+            job->have_prev = 1;
+        }
+        total_win += job->nwin;
+        carry = len - job->nwin * V;
+        memmove(work, work + job->nwin * V, carry * sizeof(uint64_t));
+    }
+    sp_trace_close(s);
+    free(work);
+
+    struct pat_table merged;
+    table_alloc(&merged, V, 1024, EXTRACT_MERGED_SLOTS);
+    for (int t = 0; t < nthreads; t++) {
+        struct pat_table *tt = &workers[t].table;
+        for (size_t k = 0; k < tt->cap; k++)
+            if (tt->count[k])
+                table_add(&merged, tt->pat + k * V, tt->delta[k], tt->count[k]);
+        table_free(tt);
+    }
+
+    struct pat_entry *e = (struct pat_entry *)malloc((merged.n + 1) * sizeof(struct pat_entry));
+    size_t ne = 0;
+    uint64_t counted = 0;
+    for (size_t k = 0; k < merged.cap; k++) {
+        if (merged.count[k]) {
+            e[ne].count = merged.count[k];
+            e[ne].delta = merged.delta[k];
+            e[ne].pat = merged.pat + k * V;
+            counted += e[ne].count;
+            ne++;
+        }
+    }
+    sort_V = V;
+    qsort(e, ne, sizeof(struct pat_entry), entry_cmp);
+
+    char *copy = strdup(file);
+    char *name = basename(copy);
+    char *ext = strstr(name, ".idx");
+    if (ext)
+        *ext = '\0';
+
+    uint64_t covered = 0;
+    for (size_t c = 0; c < ne && c < (size_t)nconfigs; c++) {
+        fprintf(out, "%s\n  {\"name\": \"%s:%zu\", \"kernel\": \"%s\", \"pattern\": [", *first ? "" : ",", name, c, kernel);
+        for (size_t j = 0; j < V; j++)
+            fprintf(out, "%s%lld", j ? ", " : "", (long long)e[c].pat[j]);
+        fprintf(out, "], \"delta\": %lld, \"count\": %llu}", (long long)e[c].delta, (unsigned long long)e[c].count);
+        covered += e[c].count;
+        *first = 0;
+    }
+
+    fprintf(stderr, "%s: %zu windows of %zu, %zu distinct (pattern, delta), %d configs cover %.1f%%\n",
+            file, total_win, V, ne, ne < (size_t)nconfigs ? (int)ne : nconfigs,
+            counted ? 100.0 * covered / counted : 0.0);
+
+    free(copy);
+    free(e);
+    table_free(&merged);
+}
+
+static void usage(void)
+{
+    printf("Usage: spatter-extract [-k <kernel>] [-v <n>] [-n <n>] [-t <n>] [-o <file>] <trace> [<trace> ...]\n");
+    printf(" -k, --kernel=<kernel>        Kernel of traces named without .R. or .W. [Default: Gather, Options: Gather, Scatter]\n");
+    printf(" -v, --pattern-len=<n>        Indices per Gather or Scatter. [Default: 8]\n");
+    printf(" -n, --configs=<n>            Configs per trace, the most frequent (pattern, delta) pairs. [Default: 8]\n");
+    printf(" -t, --threads=<n>            Threads mining each trace. [Default: all CPUs]\n");
+    printf(" -o, --output=<file>          JSON suite to write. [Default: stdout]\n");
+}
+
+int main(int argc, char **argv)
+{
+    static struct option long_opts[] = {
+        {"kernel", required_argument, 0, 'k'},
+        {"pattern-len", required_argument, 0, 'v'},
+        {"configs", required_argument, 0, 'n'},
+        {"threads", required_argument, 0, 't'},
+        {"output", required_argument, 0, 'o'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    const char *kernel = "Gather";
+    const char *out_path = NULL;
+    long V = 8, nconfigs = 8, nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    int c;
+
+    err_file = stderr;
+    while ((c = getopt_long(argc, argv, "k:v:n:t:o:h", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 'k':
+                if (!strcasecmp(optarg, "gather"))
+                    kernel = "Gather";
+                else if (!strcasecmp(optarg, "scatter"))
+                    kernel = "Scatter";
+                else
+                    error("--kernel must be Gather or Scatter", ERROR);
+                break;
+            case 'v':
+                V = atol(optarg);
+                break;
+            case 'n':
+                nconfigs = atol(optarg);
+                break;
+            case 't':
+                nthreads = atol(optarg);
+                break;
+            case 'o':
+                out_path = optarg;
+                break;
+            case 'h':
+                usage();
+                return EXIT_SUCCESS;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (V < 1 || V > 4096)
+        error("--pattern-len must be between 1 and 4096", ERROR);
+    if (nconfigs < 1)
+        error("--configs must be positive", ERROR);
+    if (nthreads < 1)
+        nthreads = 1;
+
+    FILE *out = stdout;
+    if (out_path && !(out = fopen(out_path, "w")))
+        error("Unable to open the output file", ERROR);
+
+    struct extract_job job;
+    pthread_barrier_t barrier;
+    struct extract_worker *workers = (struct extract_worker *)calloc(nthreads, sizeof(struct extract_worker));
+    memset(&job, 0, sizeof(job));
+    pthread_barrier_init(&barrier, NULL, nthreads + 1);
+    for (int t = 0; t < nthreads; t++) {
+        workers[t].id = t;
+        workers[t].nthreads = nthreads;
+        workers[t].job = &job;
+        workers[t].barrier = &barrier;
+        if (pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]))
+            error("Unable to start the extraction threads", ERROR);
+    }
+
+    int first = 1;
+    fprintf(out, "[");
+    for (int f = optind; f < argc; f++)
+        extract_trace(argv[f], trace_kernel(argv[f], kernel), V, nconfigs, workers, nthreads, &job, &barrier, out, &first);
+    fprintf(out, "\n]\n");
+
+    job.done = 1;
+    pthread_barrier_wait(&barrier);
+    for (int t = 0; t < nthreads; t++)
+        pthread_join(workers[t].thread, NULL);
+    pthread_barrier_destroy(&barrier);
+    free(workers);
+    if (out != stdout)
+        fclose(out);
+    return EXIT_SUCCESS;
+}
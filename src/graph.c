@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graph.h"
+#include "mtx.h"
+#include "sp_alloc.h"
+#include "parse-args.h" //error
+
+// Ranges of a stream or of the vertices worked on as a unit, more than the
+// threads so that uneven degrees even out
+#define GRAPH_BLOCKS 256
+
+#define UNVISITED UINT64_MAX
+
+enum sp_graph_algo sp_graph_algo_parse(const char *name)
+{
+    if (!strcasecmp(name, "bfs"))
+        return GRAPH_BFS;
+    if (!strcasecmp(name, "pagerank"))
+        return GRAPH_PAGERANK;
+    if (!strcasecmp(name, "spmv"))
+        return GRAPH_SPMV;
+    return GRAPH_NONE;
+}
+
+const char *sp_graph_algo_name(enum sp_graph_algo algo)
+{
+    switch (algo) {
+    case GRAPH_BFS:      return "bfs";
+    case GRAPH_PAGERANK: return "pagerank";
+    case GRAPH_SPMV:     return "spmv";
+    default:             return "none";
+    }
+}
+
+// Map the file and point csr into the mapping
+static void *graph_map(const char *file, struct sp_csr *csr, size_t *size)
+{
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+        error("GRAPH: unable to open the graph file", ERROR);
+    *size = st.st_size;
+    uint64_t h[3];
+    if (*size < 8 + sizeof(h))
+        error("GRAPH: not a binary CSR file", ERROR);
+    char *map = (char *)mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        error("GRAPH: unable to mmap the graph file", ERROR);
+    if (memcmp(map, SP_CSR_MAGIC, 8))
+        error("GRAPH: not a binary CSR file", ERROR);
+
+    memcpy(h, map + 8, sizeof(h));
+    csr->nrows = h[0];
+    csr->ncols = h[1];
+    csr->nnz = h[2];
+    if (h[0] > *size / 8 || h[2] > *size / 8 || 8 + (4 + h[0] + h[2]) * 8 != *size)
+        error("GRAPH: binary CSR file size does not match its header", ERROR);
+    if (csr->nrows != csr->ncols)
+        error("GRAPH: the adjacency matrix must be square", ERROR);
+    csr->rowptr = (uint64_t *)(map + 8 + sizeof(h));
+    csr->col = csr->rowptr + csr->nrows + 1;
+    return map;
+}
+
+size_t sp_graph_vertices(const char *file)
+{
+    struct sp_csr csr;
+    size_t size;
+    void *map = graph_map(file, &csr, &size);
+    munmap(map, size);
+    return csr.nrows;
+}
+
+static void graph_check(const struct sp_csr *g)
+{
+    if (g->rowptr[0] != 0 || g->rowptr[g->nrows] != g->nnz)
+        error("GRAPH: binary CSR row offsets do not cover the edges", ERROR);
+    int bad = 0;
+    #pragma omp parallel for reduction(|:bad)
+    for (size_t v = 0; v < g->nrows; v++) {
+        bad |= g->rowptr[v + 1] < g->rowptr[v];
+        // Only read the columns of rows whose offsets are sane
+        if (g->rowptr[v + 1] >= g->rowptr[v] && g->rowptr[v + 1] <= g->nnz)
+            for (uint64_t k = g->rowptr[v]; k < g->rowptr[v + 1]; k++)
+                bad |= (g->col[k] >= g->ncols) << 1;
+    }
+    if (bad & 1)
+        error("GRAPH: binary CSR row offsets decrease", ERROR);
+    if (bad)
+        error("GRAPH: binary CSR column out of range", ERROR);
+}
+
+// The columns in row order, x[col[k]] of y = A x
+static void graph_spmv(const struct sp_csr *g, uint64_t *out)
+{
+    #pragma omp parallel for
+    for (size_t b = 0; b < GRAPH_BLOCKS; b++) {
+        size_t lo = g->nnz * b / GRAPH_BLOCKS, hi = g->nnz * (b + 1) / GRAPH_BLOCKS;
+        memcpy(out + lo, g->col + lo, (hi - lo) * sizeof(uint64_t));
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// The rows of the transpose in order: each vertex pulls the contributions
+// of the sources of its in-edges
+static void graph_pagerank(const struct sp_csr *g, uint64_t *out)
+{
+    size_t n = g->nrows;
+    uint64_t *tptr = (uint64_t *)calloc(n + 1, sizeof(uint64_t));
+    uint64_t *fill = (uint64_t *)malloc((n + 1) * sizeof(uint64_t));
+
+    #pragma omp parallel for
+    for (size_t k = 0; k < g->nnz; k++)
+        __atomic_add_fetch(&tptr[g->col[k] + 1], 1, __ATOMIC_RELAXED);
+    for (size_t v = 0; v < n; v++)
+        tptr[v + 1] += tptr[v];
+    memcpy(fill, tptr, (n + 1) * sizeof(uint64_t));
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t u = 0; u < n; u++)
+        for (uint64_t k = g->rowptr[u]; k < g->rowptr[u + 1]; k++)
+            out[__atomic_fetch_add(&fill[g->col[k]], 1, __ATOMIC_RELAXED)] = u;
+    // Sources in order, whichever thread placed them
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < n; v++)
+        qsort(out + tptr[v], tptr[v + 1] - tptr[v], sizeof(uint64_t), compare_u64);
+
+    free(tptr);
+    free(fill);
+}
+
+// Top-down BFS, one frontier at a time. The out-neighbours of the frontier
+// are copied to the stream in frontier order; a vertex joins the next
+// frontier at its first place in them, so the stream is that of a serial
+// BFS whatever the threads.
+static size_t graph_bfs(const struct sp_csr *g, uint64_t root, uint64_t *out, struct sp_graph_summary *sum)
+{
+    size_t n = g->nrows;
+    // 1 + the place in the stream that reached a vertex, 0 for the root
+    uint64_t *claim = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t *front = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t *next = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t *off = (uint64_t *)malloc((n + 1) * sizeof(uint64_t));
+    size_t found[GRAPH_BLOCKS + 1];
+
+    #pragma omp parallel for
+    for (size_t v = 0; v < n; v++)
+        claim[v] = UNVISITED;
+    claim[root] = 0;
+    front[0] = root;
+    size_t nfront = 1, pos = 0, reached = 1, levels = 0;
+
+    while (nfront) {
+        off[0] = 0;
+        for (size_t i = 0; i < nfront; i++)
+            off[i + 1] = off[i] + g->rowptr[front[i] + 1] - g->rowptr[front[i]];
+        size_t len = off[nfront];
+        uint64_t *level = out + pos;
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < nfront; i++)
+            memcpy(level + off[i], g->col + g->rowptr[front[i]], (off[i + 1] - off[i]) * sizeof(uint64_t));
+
+        // Vertices reached before this frontier keep their smaller claim
+        #pragma omp parallel for
+        for (size_t k = 0; k < len; k++) {
+            uint64_t *c = &claim[level[k]], mine = pos + k + 1;
+            uint64_t cur = __atomic_load_n(c, __ATOMIC_RELAXED);
+            while (cur > mine && !__atomic_compare_exchange_n(c, &cur, mine, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                ;
+        }
+
+        // The next frontier in the order of the claims, block by block
+        #pragma omp parallel for
+        for (size_t b = 0; b < GRAPH_BLOCKS; b++) {
+            size_t cnt = 0;
+            for (size_t k = len * b / GRAPH_BLOCKS; k < len * (b + 1) / GRAPH_BLOCKS; k++)
+                cnt += claim[level[k]] == pos + k + 1;
+            found[b + 1] = cnt;
+        }
+        found[0] = 0;
+        for (size_t b = 0; b < GRAPH_BLOCKS; b++)
+            found[b + 1] += found[b];
+        #pragma omp parallel for
+        for (size_t b = 0; b < GRAPH_BLOCKS; b++) {
+            size_t j = found[b];
+            for (size_t k = len * b / GRAPH_BLOCKS; k < len * (b + 1) / GRAPH_BLOCKS; k++)
+                if (claim[level[k]] == pos + k + 1)
+                    next[j++] = level[k];
+        }
+
+        uint64_t *t = front;
+        front = next;
+        next = t;
+        nfront = found[GRAPH_BLOCKS];
+        reached += nfront;
+        pos += len;
+        levels++;
+    }
+
+    sum->reached = reached;
+    sum->levels = levels;
+    free(claim);
+    free(front);
+    free(next);
+    free(off);
+    return pos;
+}
+
+size_t sp_graph_stream(const char *file, enum sp_graph_algo algo, uint64_t **idx, struct sp_graph_summary *sum)
+{
+    struct sp_csr g;
+    size_t size;
+    void *map = graph_map(file, &g, &size);
+    graph_check(&g);
+    if (g.nnz == 0)
+        error("GRAPH: the graph has no edges", ERROR);
+
+    struct sp_graph_summary s = {g.nrows, g.nnz, 0, g.nrows, 1, 0};
+    uint64_t *out = (uint64_t *)sp_malloc(sizeof(uint64_t), g.nnz, ALIGN_PAGE);
+    switch (algo) {
+    case GRAPH_BFS:
+        for (size_t v = 1; v < g.nrows; v++)
+            if (g.rowptr[v + 1] - g.rowptr[v] > g.rowptr[s.root + 1] - g.rowptr[s.root])
+                s.root = v;
+        s.len = graph_bfs(&g, s.root, out, &s);
+        break;
+    case GRAPH_PAGERANK:
+        graph_pagerank(&g, out);
+        s.len = g.nnz;
+        break;
+    case GRAPH_SPMV:
+        graph_spmv(&g, out);
+        s.len = g.nnz;
+        break;
+    default:
+        error("GRAPH: unknown algorithm", ERROR);
+    }
+    munmap(map, size);
+
+    *idx = out;
+    if (sum)
+        *sum = s;
+    return s.len;
+}
+
+struct sp_trace_stream *sp_graph_open(const char *file, enum sp_graph_algo algo, size_t chunk)
+{
+    uint64_t *idx;
+    size_t len = sp_graph_stream(file, algo, &idx, NULL);
+    return sp_trace_open_mem(idx, len, chunk);
+}
@@ -0,0 +1,127 @@
+// Hilbert orders for --hilbert. The coordinates of each point are
+// computed from its distance along the curve with Skilling's
+// transpose-to-axes (J. Skilling, "Programming the Hilbert curve", 2004),
+// so no curve description is needed and any dimension works.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hilbert.h"
+#include "morton.h"
+#include "sp_alloc.h"
+
+#define HILBERT_VERBOSE 1
+
+void hilbert_axes(uint64_t h, int bits, int n, uint64_t *X)
+{
+    uint64_t N = (uint64_t)1 << bits, t;
+
+    // Transpose: bit k of h, counted from the top, is bit bits-1-k/n of
+    // X[k%n]
+    for (int i = 0; i < n; i++)
+        X[i] = 0;
+    for (int k = 0; k < bits * n; k++)
+        X[k % n] |= ((h >> (bits * n - 1 - k)) & 1) << (bits - 1 - k / n);
+
+    // Gray decode
+    t = X[n-1] >> 1;
+    for (int i = n - 1; i > 0; i--)
+        X[i] ^= X[i-1];
+    X[0] ^= t;
+
+    // Undo the rotations and reflections of the subcurves
+    for (uint64_t Q = 2; Q < N; Q <<= 1) {
+        uint64_t P = Q - 1;
+        for (int i = n - 1; i >= 0; i--) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+}
+
+// The points of a dim^n grid along the curve over the enclosing 2^k grid.
+// Points outside of the grid are skipped, like in _z_order_2d.
+static uint32_t *_h_order(uint64_t dim, int n)
+{
+    uint64_t total = 1, X[3];
+    int bits = (int)next_pow2(dim);
+    uint32_t *list = NULL;
+
+    for (int i = 0; i < n; i++)
+        total *= dim;
+
+    list = (uint32_t*)sp_malloc(sizeof(uint32_t), total, ALIGN_PAGE);
+
+    if (!list) {
+#if HILBERT_VERBOSE
+        printf("Failed to allocate space for the ordering\n");
+#endif
+        return NULL;
+    }
+
+    uint64_t idx = 0;
+    for (uint64_t h = 0; idx < total; h++) {
+        hilbert_axes(h, bits, n, X);
+        uint64_t off = 0;
+        int i;
+        for (i = 0; i < n && X[i] < dim; i++)
+            off = off * dim + X[i];
+        if (i == n)
+            list[idx++] = (uint32_t)off;
+    }
+
+    return list;
+}
+
+static uint32_t *h_order(uint64_t dim, uint64_t block, int n, uint64_t max_bits)
+{
+    uint32_t *list = NULL;
+
+    if (dim == 0) {
+#if HILBERT_VERBOSE
+        printf("Error: dim must be positive\n");
+#endif
+        return NULL;
+    }
+
+    if (next_pow2(dim) > max_bits) {
+#if HILBERT_VERBOSE
+        printf("Error: The dimension is too big for a %dd Hilbert order\n", n);
+#endif
+        return NULL;
+    }
+
+    if (block <= 0) {
+#if HILBERT_VERBOSE
+        printf("Error: The block size must be positive\n");
+#endif
+        return NULL;
+    }
+
+    if ((dim/block)*block != dim) {
+#if HILBERT_VERBOSE
+        printf("Error: The block size must divide the dimension length\n");
+#endif
+        return NULL;
+    }
+
+    list = _h_order(dim/block, n);
+    if (list && block > 1)
+        list = n == 2 ? _z_block_2d(list, dim, block) : _z_block_3d(list, dim, block);
+
+    return list;
+}
+
+uint32_t *h_order_2d(uint64_t dim, uint64_t block)
+{
+    return h_order(dim, block, 2, 16);
+}
+
+uint32_t *h_order_3d(uint64_t dim, uint64_t block)
+{
+    return h_order(dim, block, 3, 10);
+}
@@ -1,7 +1,12 @@
 #ifndef BACKEND_SUPPORT_TESTS_H
 #define BACKEND_SUPPORT_TESTS_H
+#include "parse-args.h"
 int sg_cuda_support();
 int sg_opencl_support();
 int sg_openmp_support();
 int sg_serial_support();
+int sg_simd_support(enum sg_simd isa);
+int sg_conflict_support();
+enum sg_simd sg_simd_resolve(enum sg_simd isa);
+const char *sg_simd_name(enum sg_simd isa);
 #endif
@@ -0,0 +1,40 @@
+/** @file baseline.h
+ *  @brief Regression check against an earlier --output=json file
+ *  (--baseline). Each config is matched to a run record of the baseline
+ *  by its config keys, or else by its name if only one record has it, and
+ *  its mean bandwidth is compared with the 95% confidence intervals of
+ *  both.
+ */
+#ifndef BASELINE_H
+#define BASELINE_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief Default --baseline-tolerance, relative */
+#define SP_BASELINE_TOLERANCE 0.05
+
+/** @brief Exit status of a run with a regression past the tolerance */
+#define SP_EXIT_REGRESSION 2
+
+/** @brief A config compared with its baseline */
+struct sp_baseline_cmp
+{
+    int match;       /**< 0 no record, 1 matched on the config, 2 on the name */
+    double base_mbs; /**< mean bandwidth of the baseline runs */
+    double now_mbs;  /**< mean bandwidth of the runs of the config */
+    double change;   /**< now over base, minus 1 */
+    double ci;       /**< half-width of the 95% CI of the change */
+    int significant; /**< |change| is outside the CI */
+    int regression;  /**< significant and slower by more than the tolerance */
+};
+
+/** @brief Read the run records of a JSON Lines file
+ *  @return The number of records, or -1 if the file can not be read
+ */
+int sp_baseline_load(const char *path);
+void sp_baseline_free(void);
+
+/** @brief Compare the timed runs of rc, of bytes each, with its baseline */
+void sp_baseline_compare(const struct run_config *rc, size_t bytes, double tolerance, struct sp_baseline_cmp *cmp);
+
+#endif
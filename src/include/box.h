@@ -0,0 +1,75 @@
+/** @file box.h
+ *  @brief 3D boxes of cells for the PACK, UNPACK and TRANSPOSE kernels
+ *  (-pBOX). A box of nx * ny * nz cells of `cell` elements each is stored
+ *  AoS with x fastest: element e of cell (x, y, z) is at
+ *  ((z * ny + y) * nx + x) * cell + e. Box i starts at delta * i.
+ *
+ *  PACK gathers one face of each box into its slot of the dense buffer,
+ *  UNPACK scatters the slot back into the face, and TRANSPOSE gathers a
+ *  whole box into SoA order, element e of every cell in turn. The kernels
+ *  compute their indices from the box, the pattern generated here is the
+ *  same stream and only sizes the buffers and feeds --validate, --traffic
+ *  and the other analyses.
+ */
+#ifndef BOX_H
+#define BOX_H
+#include <stddef.h>
+#include <sys/types.h>
+
+/** @brief Most cells along a side of a box, and elements per cell */
+#define SP_BOX_MAX_DIM 65536
+/** @brief Most elements of a box */
+#define SP_BOX_MAX_ELEMS (1ull << 40)
+
+enum sp_box_op
+{
+    BOX_NONE,
+    BOX_PACK,      /**< Gather a face into the dense buffer */
+    BOX_UNPACK,    /**< Scatter the dense buffer into a face */
+    BOX_TRANSPOSE  /**< Gather a whole box from AoS into SoA */
+};
+
+struct sp_box
+{
+    size_t dim[3]; /**< cells along x, y and z */
+    size_t cell;   /**< elements per cell */
+    int face;      /**< 2 * axis + side, x- is 0 and z+ is 5, -1 for the whole box */
+};
+
+/** @brief A face as n2 * n1 rows of run contiguous elements. Row (o, r)
+ *  starts at off + o * s2 + r * s1, and rows are visited o-major.
+ */
+struct sp_box_rows
+{
+    size_t off;
+    size_t run;
+    size_t n1, s1;
+    size_t n2, s2;
+};
+
+/** @brief Parse a face name (x-, x+, y-, y+, z- or z+), -1 if invalid */
+int sp_box_face_parse(const char *s);
+
+/** @brief The name of a face, "" for the whole box */
+const char *sp_box_face_name(int face);
+
+/** @brief Cells of a box */
+size_t sp_box_cells(const struct sp_box *b);
+
+/** @brief Elements of a whole box */
+size_t sp_box_elems(const struct sp_box *b);
+
+/** @brief Elements a PACK, UNPACK or TRANSPOSE of one box moves: the
+ *  face, or the whole box if there is none
+ */
+size_t sp_box_len(const struct sp_box *b);
+
+/** @brief The rows of the face of b */
+void sp_box_rows(const struct sp_box *b, struct sp_box_rows *r);
+
+/** @brief Fill pat with the sp_box_len(b) indices of the face of b in row
+ *  order, or, for the whole box, the SoA order: entry e * cells + c is
+ *  element e of cell c.
+ */
+void sp_box_pattern(const struct sp_box *b, ssize_t *pat);
+#endif
@@ -0,0 +1,45 @@
+/** @file cache-flush.h
+ *  @brief Cold-cache runs (--cache). Before each timed run, either stream
+ *  through an eviction buffer larger than the caches, which also replaces
+ *  the TLB entries of the benchmark buffers, or flush the lines of the
+ *  buffers a config touches.
+ */
+#ifndef CACHE_FLUSH_H
+#define CACHE_FLUSH_H
+#include <stddef.h>
+
+/** @brief State of the caches at the start of each timed run (--cache) */
+enum sp_cache
+{
+    CACHE_WARM,  /**< left by the previous run, the default */
+    CACHE_COLD,  /**< evicted by streaming through the eviction buffer */
+    CACHE_FLUSH, /**< the touched buffers flushed line by line */
+    INVALID_CACHE
+};
+
+/** @brief Size of the last level cache and of the per-core L2, in bytes.
+ *  From sysconf, then sysfs, 32 MiB and 1 MiB if neither knows.
+ */
+size_t sp_llc_size(void);
+size_t sp_l2_size(void);
+
+/** @brief Allocate the eviction buffer for CACHE_COLD: twice the LLC plus
+ *  twice the L2 of each of threads threads, on 4 KiB pages so that
+ *  streaming through it also takes over the TLB. Returns its size.
+ */
+size_t sp_evict_init(int threads);
+void sp_evict_free(void);
+
+/** @brief Read and write one word of every line of the eviction buffer,
+ *  split over the OpenMP threads so that their private caches are evicted
+ *  too
+ */
+void sp_evict(void);
+
+/** @brief Write back and invalidate every cache line of [p, p + bytes):
+ *  clflushopt, or clflush without it, on x86-64 and dc civac on AArch64.
+ *  Returns 0 without a flush instruction.
+ */
+int sp_flush_range(const void *p, size_t bytes);
+
+#endif
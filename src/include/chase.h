@@ -0,0 +1,33 @@
+/** @file chase.h
+ *  @brief Chains of dependent Gathers for the CHASE kernel. Each slot
+ *  (delta * i) of the source holds, at pattern[0], the offset of the next
+ *  slot of its chain, so every Gather has to wait for the load of the one
+ *  before. The slots are visited in order, in the --morton/--hilbert order,
+ *  or in a random permutation with --random. Each thread gets a contiguous
+ *  part of the visit order and splits it into --chains chains, which it
+ *  follows in lockstep to expose memory-level parallelism.
+ */
+#ifndef CHASE_H
+#define CHASE_H
+#include <stddef.h>
+#include "parse-args.h"
+#include "sgtype.h"
+
+/** @brief Most chains per thread (--chains) */
+#define SP_MAX_CHAINS 64
+
+struct sp_chase
+{
+    int threads;
+    int chains;   /**< per thread */
+    size_t *head; /**< first slot offset of chain c of thread t, at [t * chains + c] */
+    size_t *len;  /**< Gathers per chain, same layout */
+    size_t hops;  /**< Gathers of the longest chain */
+};
+
+/** @brief Link the n = rc->generic_len slots of source into threads *
+ *  rc->chains cyclic chains. Overwrites source[delta * i + pattern[0]].
+ */
+void sp_chase_prepare(struct sp_chase *ch, sgData_t *source, const struct run_config *rc, int threads);
+void sp_chase_release(struct sp_chase *ch);
+#endif
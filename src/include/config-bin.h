@@ -0,0 +1,101 @@
+/** @file config-bin.h
+ *  @brief A binary run-config format (.spb) that can be loaded without
+ *  parsing. The file is a header, one fixed size record per config, then the
+ *  raw ssize_t pattern and delta arrays. Patterns are used in place from a
+ *  private mapping of the file, so loading time does not depend on their
+ *  length. Write one from any JSON suite with
+ *  `spatter -pFILE=suite.json --write-config=suite.spb`.
+ */
+#ifndef CONFIG_BIN_H
+#define CONFIG_BIN_H
+
+#include <stdint.h>
+#include "parse-args.h"
+
+#define SPB_MAGIC   "SPATTERB"
+#define SPB_VERSION 11
+/** @brief Arrays are aligned to this many bytes from the start of the file */
+#define SPB_ALIGN   64
+
+struct spb_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t nconfigs;
+    uint32_t idx_size;    /**< sizeof(ssize_t) of the writer */
+    uint32_t record_size; /**< sizeof(struct spb_config) of the writer */
+};
+
+/** @brief An array stored in the file */
+struct spb_array {
+    uint64_t offset;  /**< Byte offset from the start of the file, 0 if absent */
+    uint64_t len;     /**< Number of ssize_t entries */
+};
+
+struct spb_config {
+    int32_t kernel;
+    int32_t op;
+    int32_t store;
+    int32_t prefetch_hint;
+    int32_t prefetch_line;
+    int32_t index_bits;
+    int32_t elem;
+    int32_t type;
+    int32_t type_gather;
+    int32_t type_scatter;
+    int32_t stride_kernel;
+    int32_t ro_morton;
+    int32_t ro_hilbert;
+    int32_t ro_block;
+    int32_t graph;
+    int32_t random_dist;
+    int32_t box_op;
+    int32_t box_face;
+    uint32_t shmem;
+    int64_t boundary;
+    int64_t delta;
+    int64_t delta_gather;
+    int64_t delta_scatter;
+    uint64_t pattern_size;
+    uint64_t generic_len;
+    uint64_t wrap;
+    uint64_t nruns;
+    uint64_t random_seed;
+    uint64_t omp_threads;
+    uint64_t vector_len;
+    uint64_t local_work_size;
+    uint64_t trace_chunk;
+    uint64_t chains;
+    uint64_t prefetch_distance;
+    uint64_t gs_tile;
+    uint64_t cuda_async;
+    uint64_t elem_size;
+    uint64_t box_dim[3];
+    uint64_t box_cell;
+    double random_param[2];
+    struct spb_array pattern;
+    struct spb_array pattern_gather;
+    struct spb_array pattern_scatter;
+    struct spb_array deltas;
+    struct spb_array deltas_ps;
+    struct spb_array deltas_gather;
+    struct spb_array deltas_gather_ps;
+    struct spb_array deltas_scatter;
+    struct spb_array deltas_scatter_ps;
+    char name[STRING_SIZE];
+    char pattern_file[STRING_SIZE];
+};
+
+/** @brief Check the magic of a config file */
+int spb_is_binary(const char *file);
+
+/** @brief Write nrc parsed configs to file. Exits on error. */
+void spb_write(const char *file, struct run_config *rc, int nrc);
+
+/** @brief Load the configs of a binary config file. Exits on error.
+ *  @param rc Set to a newly allocated array of configs. Their patterns point
+ *            into a private mapping of the file (pattern_mapped is set).
+ *  @return The number of configs
+ */
+int spb_read(const char *file, struct run_config **rc);
+
+#endif
@@ -0,0 +1,60 @@
+/** @file dsa.h
+ *  @brief Gathers and Scatters offloaded to an Intel Data Streaming
+ *  Accelerator work queue (--dsa).
+ *
+ *  The contiguous runs of the pattern of every Gather or Scatter of a config
+ *  become DSA memory-move descriptors, grouped into batch descriptors of up
+ *  to the device's batch size, all built before the timed runs. A run is
+ *  the submission of every batch, from a few threads with a bounded number
+ *  of batches in flight each, until the last completion record is written.
+ *  Gathers copy source + delta * i + pattern[j] to slot i % wrap of the
+ *  first dense buffer, Scatters the other way. The work queue is opened
+ *  through the idxd driver's character device, e.g. /dev/dsa/wq0.0, and
+ *  its mode and size read from sysfs.
+ */
+#ifndef DSA_H
+#define DSA_H
+#include <stddef.h>
+
+/** @brief Parse the value of --dsa, <wq>[:<threads>]
+ *  @return 0 on success, -1 if it is malformed
+ */
+int sp_dsa_parse(const char *arg, char *wq, size_t wq_len, size_t *submitters);
+
+#ifdef USE_DSA
+#include <linux/idxd.h>
+#include "parse-args.h"
+#include "sgbuf.h"
+
+struct sp_dsa
+{
+    int fd;
+    void *portal;          /**< Submission portal of the work queue */
+    int shared;            /**< ENQCMD to a shared queue, else MOVDIR64B */
+    size_t wq_size;        /**< Descriptors the queue holds */
+    size_t max_batch;      /**< Descriptors per batch the device takes */
+    size_t submitters;     /**< Threads submitting the batches */
+    struct dsa_hw_desc *descs;  /**< Memory moves of the current config */
+    struct dsa_hw_desc *batches; /**< What is submitted: batches, or single moves */
+    struct dsa_completion_record *comps; /**< One per entry of batches */
+    size_t ndescs, nbatches;
+};
+
+/** @brief Open and map the work queue. Exits with an error if it can not. */
+void sp_dsa_open(struct sp_dsa *dsa, const char *wq, size_t submitters);
+
+/** @brief Build the descriptors of rc over the source and target buffers */
+void sp_dsa_prepare(struct sp_dsa *dsa, struct run_config *rc, sgDataBuf *source, sgDataBuf *target);
+
+/** @brief One run: submit every batch and wait for all of them. Exits with
+ *  an error if one does not complete successfully.
+ */
+void sp_dsa_run(struct sp_dsa *dsa);
+
+/** @brief Free what sp_dsa_prepare built */
+void sp_dsa_release(struct sp_dsa *dsa);
+
+/** @brief Unmap and close the work queue */
+void sp_dsa_close(struct sp_dsa *dsa);
+#endif
+#endif
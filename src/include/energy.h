@@ -0,0 +1,48 @@
+/** @file energy.h
+ *  @brief Energy counters sampled around each timed run (--energy).
+ *  CPU package and DRAM energy come from RAPL, through the powercap sysfs
+ *  interface or, if that can not be read, the RAPL MSRs. GPU board energy
+ *  comes from NVML when Spatter is built with USE_NVML.
+ */
+#ifndef ENERGY_H
+#define ENERGY_H
+
+enum sp_energy_domain
+{
+    SP_ENERGY_PKG,  /**< CPU packages, summed over sockets */
+    SP_ENERGY_DRAM, /**< DRAM attached to the packages */
+    SP_ENERGY_GPU,  /**< GPU boards of the CUDA devices in use */
+    SP_ENERGY_DOMAINS
+};
+
+/** @brief Joules one timed run used in each domain */
+struct sp_energy
+{
+    double joules[SP_ENERGY_DOMAINS];
+};
+
+/** @brief Find the energy counters of this machine.
+ *  @param gpu_bus_ids PCI bus ids of the GPUs to sample, may be NULL
+ *  @param ngpus Number of entries in gpu_bus_ids
+ *  @return The number of domains that can be sampled
+ */
+int sp_energy_init(const char *const *gpu_bus_ids, int ngpus);
+
+/** @brief Whether domain d can be sampled, after sp_energy_init */
+int sp_energy_available(enum sp_energy_domain d);
+
+/** @brief Column name of domain d */
+const char *sp_energy_name(enum sp_energy_domain d);
+
+/** @brief Sample every counter at the start of a run */
+void sp_energy_start(void);
+
+/** @brief Sample again and store the joules used since sp_energy_start */
+void sp_energy_stop(struct sp_energy *e);
+
+/** @brief Sum of the joules of every available domain */
+double sp_energy_total(const struct sp_energy *e);
+
+void sp_energy_finalize(void);
+
+#endif
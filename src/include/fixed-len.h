@@ -0,0 +1,24 @@
+/** @file fixed-len.h
+ *  @brief Helpers for generating kernels specialized on a compile-time
+ *  pattern length. The CPU backends stamp out one kernel per length in
+ *  SP_FOREACH_FIXED_LEN and fall back to the runtime-length kernel otherwise.
+ */
+#ifndef FIXED_LEN_H
+#define FIXED_LEN_H
+
+// Pattern lengths with a specialized kernel. 16 and 73 cover most of the
+// app traces in standard-suite/app-traces, 27 is a 3x3x3 stencil.
+#define SP_FOREACH_FIXED_LEN(X) X(8) X(16) X(27) X(32) X(64) X(73)
+
+// Ask for the constant-trip-count inner loop to be fully unrolled
+#if defined __clang__
+#define SP_UNROLL _Pragma("unroll")
+#elif defined __GNUC__ && !defined __INTEL_COMPILER && !defined __CRAYC__
+#define SP_UNROLL _Pragma("GCC unroll 128")
+#elif defined __INTEL_COMPILER || defined __CRAYC__
+#define SP_UNROLL _Pragma("unroll")
+#else
+#define SP_UNROLL
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+/** @file graph.h
+ *  @brief Index streams of graph kernels (-pGRAPH). The vertices a kernel
+ *  gathers from, in the order it visits them, are generated in parallel
+ *  from a binary CSR graph (see mtx.h for the format) and streamed to the
+ *  Gather and Scatter kernels like a trace. Row v of the graph lists the
+ *  targets of the out-edges of v.
+ */
+#ifndef GRAPH_H
+#define GRAPH_H
+#include <stddef.h>
+#include <stdint.h>
+#include "trace-stream.h"
+
+enum sp_graph_algo
+{
+    GRAPH_NONE,
+    GRAPH_BFS,      /**< top-down BFS: the out-neighbours of each frontier */
+    GRAPH_PAGERANK, /**< pull PageRank: the in-neighbours of each vertex */
+    GRAPH_SPMV      /**< SpMV with the graph as the matrix: its columns */
+};
+
+struct sp_graph_summary
+{
+    size_t vertices, edges;
+    size_t len;      /**< indices in the stream */
+    size_t reached;  /**< vertices the stream visits */
+    size_t levels;   /**< BFS frontiers, 1 otherwise */
+    uint64_t root;   /**< BFS source */
+};
+
+/** @brief The algorithm named bfs, pagerank or spmv, GRAPH_NONE for others */
+enum sp_graph_algo sp_graph_algo_parse(const char *name);
+const char *sp_graph_algo_name(enum sp_graph_algo algo);
+
+/** @brief The number of vertices of a graph file. Exits with an error if it
+ *  is not a binary CSR file of a square matrix.
+ */
+size_t sp_graph_vertices(const char *file);
+
+/** @brief Generate the index stream of algo on the graph in file. BFS starts
+ *  from the vertex of highest out-degree, the first of them on ties.
+ *  @param idx Set to the stream, from sp_malloc
+ *  @param sum Filled in if not NULL
+ *  @return The number of indices in the stream
+ */
+size_t sp_graph_stream(const char *file, enum sp_graph_algo algo, uint64_t **idx, struct sp_graph_summary *sum);
+
+/** @brief sp_graph_stream handed to sp_trace_open_mem */
+struct sp_trace_stream *sp_graph_open(const char *file, enum sp_graph_algo algo, size_t chunk);
+
+#endif
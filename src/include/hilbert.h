@@ -0,0 +1,20 @@
+#ifndef HILBERT_H
+#define HILBERT_H
+
+#include <stdint.h>
+
+/** @brief Coordinates X[0..n-1] of the point at distance h along the
+ *  n-dimensional Hilbert curve with 2^bits points per side
+ */
+void hilbert_axes(uint64_t h, int bits, int n, uint64_t *X);
+
+/** @brief The dim*dim points of a square in Hilbert order, as offsets
+ *  x*dim + y. The curve steps over block*block squares, which are
+ *  visited row by row, as in z_order_2d.
+ */
+uint32_t *h_order_2d(uint64_t dim, uint64_t block);
+
+/** @brief The dim*dim*dim points of a cube in Hilbert order, as in
+ *  h_order_2d */
+uint32_t *h_order_3d(uint64_t dim, uint64_t block);
+#endif
@@ -0,0 +1,47 @@
+/** @file lat-hist.h
+ *  @brief Log-linear latency histograms, in the style of HdrHistogram:
+ *  exact below 64, then 32 buckets per power of two, so every value is
+ *  kept to within 3% in a fixed 15 KiB. Each thread fills its own, without
+ *  atomics, and they are merged once the runs are over (--rate).
+ */
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define SP_HIST_SUB_BITS 5
+#define SP_HIST_BUCKETS (64 + 58 * 32)
+
+struct sp_hist
+{
+    uint64_t count[SP_HIST_BUCKETS];
+    uint64_t n;
+    uint64_t max;
+};
+
+static inline size_t sp_hist_bucket(uint64_t v)
+{
+    if (v < 64)
+        return (size_t)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - SP_HIST_SUB_BITS;
+    return 64 + (size_t)(shift - 1) * 32 + (size_t)((v >> shift) - 32);
+}
+
+static inline void sp_hist_add(struct sp_hist *h, uint64_t v)
+{
+    h->count[sp_hist_bucket(v)]++;
+    h->n++;
+    if (v > h->max)
+        h->max = v;
+}
+
+void sp_hist_clear(struct sp_hist *h);
+
+/** @brief Add the counts of src to dst */
+void sp_hist_merge(struct sp_hist *dst, const struct sp_hist *src);
+
+/** @brief The value at quantile q in [0, 1], the middle of its bucket */
+uint64_t sp_hist_quantile(const struct sp_hist *h, double q);
+
+#endif
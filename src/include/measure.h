@@ -0,0 +1,61 @@
+/** @file measure.h
+ *  @brief Adaptive repetition of the timed runs (--target-ci). Instead of
+ *  -R runs, a config is run until its times are stable (warm-up), and then
+ *  until the 95% confidence interval of its mean bandwidth is within the
+ *  target, the time budget is spent or --max-runs is reached.
+ */
+#ifndef MEASURE_H
+#define MEASURE_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief Default --time-budget, in seconds per config */
+#define SP_TIME_BUDGET 10.0
+
+/** @brief Default --max-runs */
+#define SP_MAX_RUNS 1000
+
+/** @brief Runs kept after the warm-up before the CI is checked */
+#define SP_MIN_RUNS 5
+
+/** @brief The warm-up ends once SP_WARMUP_WINDOW consecutive runs are
+ *  within SP_WARMUP_TOL of each other, or after SP_MAX_WARMUP runs
+ */
+#define SP_WARMUP_WINDOW 3
+#define SP_WARMUP_TOL 0.05
+#define SP_MAX_WARMUP 20
+
+/** @brief Summary of the runs of one config */
+struct sp_run_stats
+{
+    double median_ms; /**< median time */
+    double ci;        /**< half-width of the 95% CI of the mean bandwidth, relative to it */
+    int outliers;     /**< runs outside 1.5 times the interquartile range */
+};
+
+/** @brief Turn on adaptive repetition.
+ *  @param target_ci Relative CI half-width to reach, e.g. 0.01 for 1%
+ *  @param budget_s  Seconds each config may take
+ *  @param max_runs  Most timed runs per config
+ */
+void sp_measure_set(double target_ci, double budget_s, size_t max_runs);
+int  sp_measure_adaptive(void);
+
+/** @brief Number of runs to allocate time_ms (and papi_ctr) for */
+size_t sp_measure_slots(const struct run_config *rc);
+
+/** @brief The loop condition of the timed runs of rc:
+ *
+ *      for (int i = -1; sp_measure_more(rc, i); i++)
+ *
+ *  i < 0 are untimed warm-up runs, and run i >= 0 stores its time in
+ *  rc->time_ms[i]. Without --target-ci this is i < rc->nruns. Otherwise,
+ *  once it returns 0 the adaptive warm-up runs have been dropped from
+ *  time_ms, and rc->nruns and rc->warmup_runs are set. With MPI, rank 0
+ *  decides for all ranks.
+ */
+int sp_measure_more(struct run_config *rc, int i);
+
+/** @brief Median, CI and outliers of n run times */
+void sp_run_stats(const double *time_ms, size_t n, struct sp_run_stats *s);
+#endif
@@ -11,4 +11,9 @@ uint32_t *z_order_3d(uint64_t dim, uint64_t block);
 
 uint64_t next_pow2(uint64_t x);
 uint32_t *get_cube(uint64_t, uint64_t);
+
+// Expand an order of the (dim/block)^n blocks into one of the points,
+// visiting each block row by row. old_list is freed.
+uint32_t *_z_block_2d(uint32_t* old_list, uint64_t dim, uint64_t block);
+uint32_t *_z_block_3d(uint32_t* old_list, uint64_t dim, uint64_t block);
 #endif
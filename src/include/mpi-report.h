@@ -0,0 +1,28 @@
+/** @file mpi-report.h
+ *  @brief Helpers for splitting work over MPI ranks and reading the
+ *  per-rank timings back. They do not call MPI themselves, so they build
+ *  (and are tested) without it.
+ */
+#ifndef MPI_REPORT_H
+#define MPI_REPORT_H
+#include <stddef.h>
+
+/** @brief Default --straggler threshold, as a multiple of the median rank time */
+#define SP_STRAGGLER_THRESHOLD 1.2
+
+/** @brief Most stragglers listed per config, the rest are only counted */
+#define SP_MAX_STRAGGLERS 8
+
+/** @brief Share of rank of n Gathers or Scatters split over nranks
+ *  (--mpi-partition). The shares differ by at most one and sum to n.
+ */
+size_t sp_mpi_share(size_t n, int rank, int nranks);
+
+/** @brief Find the ranks slower than threshold times the median of time.
+ *
+ *  The first max_ranks of them, in rank order, are written to ranks.
+ *  @param median Set to the median of time
+ *  @return The number of stragglers, which may exceed max_ranks
+ */
+int sp_find_stragglers(const double *time, int nranks, double threshold, double *median, int *ranks, int max_ranks);
+#endif
@@ -0,0 +1,46 @@
+/** @file mpi-rma.h
+ *  @brief Gathers and Scatters on the source buffer of other ranks, exposed
+ *  as an MPI window (--rma).
+ *
+ *  Every rank allocates a window with the same layout as the local source
+ *  buffer. Gather i of rank r reads the pattern at offset delta * i of the
+ *  window of rank (r + 1 + i % (P - 1)) % P, so consecutive Gathers go to
+ *  the other P - 1 ranks in turn and never to r itself (a single rank uses
+ *  its own window). Scatters write the same locations. The gathered data
+ *  lands in a local buffer of rma_batch Gathers per destination, and the
+ *  window is flushed after every (P - 1) * rma_batch Gathers.
+ */
+#ifndef MPI_RMA_H
+#define MPI_RMA_H
+#ifdef USE_MPI
+#include <mpi.h>
+#include "parse-args.h"
+#include "sgbuf.h"
+
+struct sp_rma
+{
+    MPI_Win win;
+    sgData_t *base;        /**< This rank's part of the window */
+    size_t len;            /**< Elements in base */
+    sgData_t *scratch;     /**< Landing buffer of the current batch */
+    MPI_Datatype pattern;  /**< The pattern of one Gather, in elements */
+    MPI_Datatype batch[3]; /**< Full batch and the two tail counts of RMA_AGGREGATE */
+    size_t batch_count[3];
+};
+
+/** @brief Allocate the window and copy the source buffer into it. Collective. */
+void sp_rma_create(struct sp_rma *rma, sgDataBuf *source);
+
+/** @brief Build the datatypes and landing buffer of rc. */
+void sp_rma_prepare(struct sp_rma *rma, struct run_config *rc, enum sg_rma mode, size_t batch);
+
+/** @brief One run of rc: issue, and complete, all of its Gets or Puts */
+void sp_rma_run(struct sp_rma *rma, struct run_config *rc, enum sg_rma mode, size_t batch);
+
+/** @brief Free what sp_rma_prepare built */
+void sp_rma_release(struct sp_rma *rma);
+
+/** @brief Free the window. Collective. */
+void sp_rma_destroy(struct sp_rma *rma);
+#endif
+#endif
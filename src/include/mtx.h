@@ -0,0 +1,70 @@
+/** @file mtx.h
+ *  @brief Gather patterns from sparse matrices (-pMTX). The SpMV gather
+ *  x[col[k]] of each block of rows is one Gather: its pattern is the
+ *  columns of the block less the smallest one, its delta the distance from
+ *  the smallest column of the block before. The most frequent (pattern,
+ *  delta) pairs of the matrix become configs, as spatter-extract does for
+ *  traces.
+ *
+ *  Matrices are read from Matrix Market coordinate files, parsed by all
+ *  threads from a private mapping, or from binary CSR files: the magic
+ *  SP_CSR_MAGIC, then uint64_t nrows, ncols and nnz, nrows + 1 row
+ *  offsets and nnz 0-based columns, all little-endian uint64_t.
+ */
+#ifndef MTX_H
+#define MTX_H
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define SP_CSR_MAGIC "SPCSR001"
+
+/** @brief Configs made from a matrix when -pMTX does not give a number */
+#define SP_MTX_CONFIGS 8
+
+struct sp_csr
+{
+    size_t nrows, ncols, nnz;
+    uint64_t *rowptr; /**< nrows + 1 offsets into col */
+    uint64_t *col;    /**< columns of each row, sorted */
+};
+
+/** @brief One recurring block of rows */
+struct sp_mtx_config
+{
+    ssize_t *pattern;
+    size_t len;
+    size_t delta;
+    size_t count; /**< blocks with this pattern and delta */
+};
+
+struct sp_mtx_summary
+{
+    size_t blocks;   /**< non-empty blocks of rows */
+    size_t distinct; /**< distinct (pattern, delta) pairs among them */
+    double covered;  /**< share of the nonzeros in the returned configs */
+};
+
+/** @brief Read a Matrix Market or binary CSR file into csr. Symmetric,
+ *  skew-symmetric and hermitian matrices are expanded to both triangles.
+ *  Exits with an error if the file can not be read or is malformed.
+ */
+void sp_mtx_read(const char *file, struct sp_csr *csr);
+void sp_csr_free(struct sp_csr *csr);
+
+/** @brief The at most nconf most frequent blocks of rowblock rows of csr,
+ *  most frequent first, into out
+ *  @return The number of configs
+ */
+int sp_mtx_configs(const struct sp_csr *csr, size_t rowblock, int nconf, struct sp_mtx_config *out, struct sp_mtx_summary *sum);
+void sp_mtx_configs_free(struct sp_mtx_config *c, int n);
+
+/** @brief A copy of argv with the -p argument at index parg replaced by the
+ *  pattern of c, and its -d, -l and --name added. Release with
+ *  sp_mtx_argv_free.
+ *  @param argc Set to the length of the copy
+ */
+char **sp_mtx_argv(int *argc, char **argv, int parg, const struct sp_mtx_config *c, const char *name);
+void sp_mtx_argv_free(int argc, char **argv);
+
+#endif
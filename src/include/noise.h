@@ -0,0 +1,49 @@
+/** @file noise.h
+ *  @brief Background memory traffic (--noise). Threads pinned to their own
+ *  CPUs run a STREAM kernel on buffers larger than the caches, throttled to
+ *  a target bandwidth, while the timed runs of each config go on, so that
+ *  gathers and scatters can be measured under a co-located streaming load.
+ */
+#ifndef NOISE_H
+#define NOISE_H
+#include <stddef.h>
+
+enum sp_noise_kernel
+{
+    NOISE_NONE,
+    NOISE_TRIAD, /**< a[i] = b[i] + s * c[i], 24 bytes per element */
+    NOISE_COPY,  /**< c[i] = a[i], 16 bytes per element */
+    NOISE_NT     /**< a[i] = s with non-temporal stores, 8 bytes per element */
+};
+
+struct sp_noise_spec
+{
+    enum sp_noise_kernel kernel;
+    int threads;
+    double gbs; /**< target over all noise threads, 0 for as fast as they go */
+};
+
+/** @brief Parse the value of --noise, <kernel>:<threads>[:<GB/s>] with
+ *  kernel stream, copy or nt
+ *  @return 0 on success, -1 if it is malformed
+ */
+int sp_noise_parse(const char *arg, struct sp_noise_spec *spec);
+
+/** @brief Start the noise threads, idle, on the last spec->threads CPUs
+ *  the process may run on, each with its own buffers
+ *  @return The first CPU they are pinned to, -1 if they could not be pinned
+ */
+int sp_noise_start(const struct sp_noise_spec *spec);
+
+/** @brief Start the traffic */
+void sp_noise_begin(void);
+
+/** @brief Idle the threads again
+ *  @return The bandwidth they moved since sp_noise_begin, in GB/s
+ */
+double sp_noise_end(void);
+
+/** @brief Join the threads and free their buffers */
+void sp_noise_stop(void);
+
+#endif
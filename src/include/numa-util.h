@@ -0,0 +1,67 @@
+/** @file numa-util.h
+ *  @brief Page placement helpers used by --numa. These talk to the kernel
+ *  directly (mbind, move_pages, getcpu) so that no NUMA library is needed.
+ *  On systems without NUMA support they report a single node and do nothing.
+ */
+#ifndef NUMA_UTIL_H
+#define NUMA_UTIL_H
+
+#include <stddef.h>
+
+#define SP_MAX_NUMA_NODES 64
+
+/** @brief Number of NUMA nodes that may hold memory (highest online node + 1) */
+int  sp_numa_num_nodes(void);
+
+/** @brief NUMA node of the CPU the calling thread is running on */
+int  sp_numa_current_node(void);
+
+/** @brief CPU the calling thread is running on, -1 if unknown
+ *  @param node If not NULL, set to the NUMA node of that CPU (0 if unknown)
+ */
+int  sp_numa_current_cpu(int *node);
+
+/** @brief Interleave the (not yet touched) pages of [ptr, ptr+size) over all nodes */
+void sp_numa_interleave(void *ptr, size_t size);
+
+/** @brief Bind the (not yet touched) pages of [ptr, ptr+size) to one node */
+void sp_numa_bind(void *ptr, size_t size, int node);
+
+/** @brief Sample the physical placement of [ptr, ptr+size).
+ *  @param counts Filled with the number of sampled pages found on each node,
+ *                must hold SP_MAX_NUMA_NODES entries
+ *  @return The number of pages that were sampled
+ */
+size_t sp_numa_page_nodes(void *ptr, size_t size, size_t *counts);
+
+/** @brief Split of a buffer's pages over memory tiers (--tier), a weight
+ *  for each NUMA node the pages go to
+ */
+struct sp_tier
+{
+    int n;                             /**< nodes in the split, 0 for none */
+    int node[SP_MAX_NUMA_NODES];
+    double weight[SP_MAX_NUMA_NODES];
+};
+
+/** @brief Parse the value of --tier, "interleave" for an equal split over
+ *  every node or a list of <node>:<weight>, e.g. 0:70,2:30
+ *  @return 0 on success, -1 if it is malformed
+ */
+int sp_tier_parse(const char *arg, struct sp_tier *tier);
+
+/** @brief Move the (already touched) pages of [ptr, ptr+size) to the nodes
+ *  of tier, page by page in proportion to their weights
+ *  @return 0 on success, -1 if the pages could not be moved
+ */
+int sp_numa_split(void *ptr, size_t size, const struct sp_tier *tier);
+
+/** @brief The node of every page of [ptr, ptr+size), SP_NUMA_UNKNOWN for
+ *  pages that are not mapped or could not be queried
+ *  @param npages Set to the number of entries of the returned map
+ *  @return A map the caller frees
+ */
+#define SP_NUMA_UNKNOWN 0xff
+unsigned char *sp_numa_page_map(void *ptr, size_t size, size_t *npages);
+
+#endif
@@ -0,0 +1,92 @@
+/** @file output.h
+ *  @brief Machine-readable results (--output=json:<file> or csv:<file>).
+ *  Every record is written and flushed as soon as its config has finished,
+ *  so a suite that crashes keeps the results of the configs before it.
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "parse-args.h"
+#include "traffic.h"
+#include "reuse.h"
+
+#define SP_OUTPUT_MAX_EVENTS 32
+
+enum sp_output_format
+{
+    OUTPUT_NONE,
+    OUTPUT_JSON, /**< JSON Lines: a "meta" object, then one "run" object per config */
+    OUTPUT_CSV   /**< A header row, then one row per timed run */
+};
+
+/** @brief Host and device the results were measured on, copied by
+ *  sp_output_open */
+struct sp_output_meta
+{
+    const char *version;
+    const char *compiler;
+    const char *backend;
+    const char *device;
+    const char *simd;
+    int mpi_ranks;
+    int npapi;
+    const char *const *papi_events;
+};
+
+/** @brief Parse the value of --output, format:file
+ *  @return 0 on success, -1 if the format is unknown or the file missing
+ */
+int sp_output_parse(const char *arg, enum sp_output_format *fmt, char *path, size_t len);
+
+/** @brief Open path and write the header (the meta object or the CSV
+ *  column names)
+ *  @param append Add to the end of an existing file instead of replacing it
+ *  @return 0 on success, -1 if the file can not be opened
+ */
+int sp_output_open(enum sp_output_format fmt, const char *path, int append, const struct sp_output_meta *meta);
+
+/** @brief Write the records to an open stream f instead, the header first
+ *  @param meta NULL to keep the meta of the last open or attach
+ */
+void sp_output_attach(FILE *f, enum sp_output_format fmt, const struct sp_output_meta *meta);
+
+/** @brief Write the record of config idx: the config, every timed run and
+ *  its PAPI counters and energy, and the bandwidth of each run
+ *  @param tr Traffic model of the config, NULL without --traffic
+ *  @param ps Pattern analysis of the config, NULL without --analyze
+ *  @param ru Reuse profile of the config, NULL without --analyze-reuse
+ */
+void sp_output_run(int idx, const struct run_config *rc, size_t bytes, const struct sp_traffic *tr, const struct sp_pattern_stats *ps,
+        const struct sp_reuse *ru);
+
+/** @brief Write an "error" record in place of the record of a config that
+ *  could not be run (JSON Lines only)
+ */
+void sp_output_error(const char *what);
+
+/** @brief Close the stream, or flush it if it is stdout, but keep the meta
+ *  for the next sp_output_attach
+ */
+void sp_output_detach(void);
+
+void sp_output_close(void);
+
+/** @brief The config keys of the JSON record of rc, from "kernel" up to
+ *  the results, in a malloc'd string of len bytes
+ */
+char *sp_output_config_json(const struct run_config *rc, size_t *len);
+
+/** @brief FNV-1a hash of n bytes of s, to match the config keys of a
+ *  record with those of a config */
+uint64_t sp_output_hash(const char *s, size_t n);
+
+/** @brief Name of kernel as accepted by -k */
+const char *sp_kernel_name(enum sg_kernel kernel);
+
+/** @brief Name of the kernel of rc as accepted by -k, Pack, Unpack and
+ *  Transpose for the box kernels that run as Gathers or Scatters */
+const char *sp_config_kernel_name(const struct run_config *rc);
+
+#endif
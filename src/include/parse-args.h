@@ -12,10 +12,12 @@
 
 #define STRING_SIZE 256
 #define MAX_PATTERN_LEN 16777216
+#define SP_MAX_CUDA_DEVICES 16
 
 #include <sgtype.h>
 #include <stdint.h>
 #include <sys/types.h>
+#include "box.h"
 
 /** @brief Supported benchmark backends
  */
@@ -35,16 +37,115 @@ enum sg_kernel
     GATHER,
     GS,
     MULTISCATTER,
-    MULTIGATHER
+    MULTIGATHER,
+    CHASE          /**< Gathers whose base is loaded by the previous Gather */
 };
 
 enum sg_op
 {
     OP_COPY,
-    OP_ACCUM,
+    OP_ACCUM,          /**< Scatter with +=, updates from different threads may race */
+    OP_ACCUM_ATOMIC,   /**< Scatter with an omp atomic += */
+    OP_ACCUM_CONFLICT, /**< Scatter with +=, duplicate indices within a vector resolved with AVX-512CD */
     INVALID_OP
 };
 
+/** @brief How the OpenMP Gather, Scatter and GS kernels write (--store)
+ */
+enum sg_store
+{
+    STORE_PLAIN, /**< Ordinary stores, each written line is first read for ownership */
+    STORE_NT,    /**< Non-temporal stores to the dense side of Gathers and the sparse side of Scatters */
+    INVALID_STORE
+};
+
+/** @brief Cache hint of the software prefetches (--prefetch-hint)
+ */
+enum sg_prefetch
+{
+    PREFETCH_T0,  /**< Into all cache levels */
+    PREFETCH_NTA, /**< Close to the core with minimal pollution of the outer levels */
+    INVALID_PREFETCH
+};
+
+/** @brief Instruction set used by the hand-written CPU kernels
+ */
+enum sg_simd
+{
+    SIMD_SCALAR, /**< Plain C kernels, vectorized by the compiler if at all */
+    SIMD_AUTO,   /**< Best ISA supported by this CPU and build */
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_SVE,
+    INVALID_SIMD
+};
+
+/** @brief Page placement policy for the data buffers
+ */
+enum sg_numa
+{
+    NUMA_DEFAULT,    /**< Whatever the init loops and the OS do */
+    NUMA_FIRSTTOUCH, /**< Touch pages with the kernels' static schedule */
+    NUMA_INTERLEAVE, /**< Interleave source pages over all nodes */
+    NUMA_REPLICATE,  /**< One copy of the source per node */
+    INVALID_NUMA
+};
+
+/** @brief Where the CUDA backend keeps the source buffer (--gpu-mem)
+ */
+enum sg_gpu_mem
+{
+    GPU_MEM_DEVICE,  /**< cudaMalloc, copied from the host before the runs */
+    GPU_MEM_MANAGED, /**< cudaMallocManaged, migrated on demand */
+    GPU_MEM_PINNED,  /**< cudaHostAlloc, read in place over the host link */
+    GPU_MEM_SYSTEM,  /**< The malloc'd host buffer itself, through HMM or ATS */
+    INVALID_GPU_MEM
+};
+
+/** @brief Placement hint for managed and system source buffers (--gpu-mem)
+ */
+enum sg_gpu_hint
+{
+    GPU_HINT_NONE,       /**< Leave it to the driver */
+    GPU_HINT_PREFETCH,   /**< cudaMemPrefetchAsync to the device before the runs */
+    GPU_HINT_READMOSTLY, /**< cudaMemAdviseSetReadMostly */
+    GPU_HINT_HOST,       /**< Preferred location on the host, accessed by the device */
+    INVALID_GPU_HINT
+};
+
+/** @brief How Gathers and Scatters reach another rank's source window (--rma)
+ */
+enum sg_rma
+{
+    RMA_NONE,      /**< Local memory only */
+    RMA_ELEMENT,   /**< One MPI_Get/MPI_Put per pattern index */
+    RMA_GATHER,    /**< One MPI_Get/MPI_Put per Gather or Scatter, with an indexed datatype */
+    RMA_AGGREGATE, /**< One MPI_Get/MPI_Put per destination rank for each batch of Gathers or Scatters */
+    INVALID_RMA
+};
+
+/** @brief How the Gathers or Scatters of a config are split across the
+ *  OpenMP threads (--schedule)
+ */
+enum sg_schedule
+{
+    SCHED_STATIC,  /**< One contiguous block per thread, like schedule(static) */
+    SCHED_DYNAMIC, /**< Chunks taken from a shared counter */
+    SCHED_GUIDED,  /**< Chunks shrinking with the remaining work, down to the chunk size */
+    SCHED_STEAL,   /**< Per-thread ranges of chunks, idle threads steal half of another thread's range */
+    INVALID_SCHED
+};
+
+/** @brief Distribution of the base offsets drawn by --random (--random-dist)
+ */
+enum sg_random_dist
+{
+    RANDOM_UNIFORM, /**< Every base equally likely */
+    RANDOM_ZIPF,    /**< The base of rank k with probability ~ 1 / (k + 1)^s */
+    RANDOM_HOTSET,  /**< A hot fraction of the bases drawn with a given probability */
+    INVALID_RANDOM_DIST
+};
+
 //Specifies the indexing or offset type
 enum idx_type
 {
@@ -54,6 +155,8 @@ enum idx_type
     CUSTOM,
     CONFIG_FILE,
     XKP,
+    TRACE,
+    BOX,
     INVALID_IDX
 };
 
@@ -72,6 +175,7 @@ struct run_config
     ssize_t *pattern;
     ssize_t *pattern_gather;
     ssize_t *pattern_scatter;
+    int pattern_mapped; /**< patterns point into a binary config mapping, not freed */
     size_t *deltas;
     size_t *deltas_ps;
     size_t *deltas_gather;
@@ -96,17 +200,40 @@ struct run_config
     spSize_t generic_len;
     size_t wrap;
     size_t nruns;
+    size_t warmup_runs; // timed runs dropped as warm-up with --target-ci
+    size_t inner_reps;  // kernel repetitions in each timed run with --min-sample, 0 or 1 for one
     char pattern_file[STRING_SIZE];
+    size_t trace_chunk;
+    int graph; /**< enum sp_graph_algo of a -pGRAPH stream, GRAPH_NONE for a trace file */
     char *generator;
     char name[STRING_SIZE];
     size_t random_seed;
+    enum sg_random_dist random_dist;
+    double random_param[2]; // s of zipf, the fraction and probability of hotset
+    uint32_t *random_bases; // the base of each Gather or Scatter with --random-dist, NULL for uniform
     size_t omp_threads;
+    size_t chains; // interleaved CHASE chains per thread
     enum sg_op op;
+    enum sg_store store;
+    size_t prefetch_distance; // prefetch for Gather/Scatter i + distance, 0 for none
+    size_t gs_tile; // bytes of the GS staging tile of each thread, 0 for the default
+    size_t cuda_async; // rounds of Gathers/Scatters per block of the async CUDA kernels, 0 for off
+    enum sg_prefetch prefetch_hint;
+    int prefetch_line; // prefetch only the first line of each Gather/Scatter
+    int index_bits; // width of the pattern indices the kernels read, 16, 32 or 64
+    void *pattern_narrow; // int16_t/int32_t copies of the patterns for index_bits < 64
+    void *pattern_gather_narrow;
+    void *pattern_scatter_narrow;
+    ssize_t *inner_stream; // generic_len inner patterns of a Multi kernel, with --inner-stream
+    enum sg_elem elem; // element type of --elem
+    size_t elem_size;  // bytes per element, 0 for sizeof(sgData_t)
     size_t vector_len;
     unsigned int shmem;
     size_t local_work_size;
     double *time_ms;
     long long **papi_ctr;
+    long long *papi_thread; // per-thread sums over the runs, omp_threads rows of papi_nevents
+    struct sp_energy *energy; // joules of each run, with --energy
     int papi_counters;
     int stride_kernel;
     // Reorder based kernels
@@ -115,6 +242,9 @@ struct run_config
     int ro_block;
     uint32_t *ro_order;
     uint32_t *ro_order_dev;
+    // PACK, UNPACK and TRANSPOSE run as Gathers or Scatters of a -pBOX box
+    enum sp_box_op box_op;
+    struct sp_box box;
 };
 
 struct backend_config
@@ -130,11 +260,25 @@ struct backend_config
 
 };
 
+/** @brief Largest --elem=bytes:N */
+#define SP_MAX_ELEM_BYTES 4096
+
+/** @brief Bytes per element of rc, see --elem */
+static inline size_t sp_elem_size(const struct run_config *rc)
+{
+    return rc->elem_size ? rc->elem_size : sizeof(sgData_t);
+}
+
 /** @brief Read command-line arguments and populate global variables.
  *  @param argc Value passed to main
  *  @param argv Value passed to main
  */
 void parse_args(int argc, char **argv, int *nrc, struct run_config **rc);
+/** @brief Parse the text of a json run-configuration file, an array of
+ *  config objects, into *nrc configs
+ *  @return 0 on success, -1 if text is not a json array
+ */
+int parse_json_text(char *text, size_t len, int *nrc, struct run_config **rc);
 struct run_config *parse_runs(int arrr, char **argv);
 void error (char* what, int code);
 void print_run_config(struct run_config rc);
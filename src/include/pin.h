@@ -0,0 +1,60 @@
+/** @file pin.h
+ *  @brief Thread-count sweeps (--thread-sweep). Each config is also run
+ *  with fewer threads of the same OpenMP team, each thread pinned to one
+ *  CPU of the process, so that the bandwidth at every count is measured
+ *  on the same placement. The runtime keeps its threads between parallel
+ *  regions, the ones above the current count wait in its pool, where
+ *  OMP_WAIT_POLICY=passive puts them to sleep instead of spinning.
+ *
+ *  The CPUs are taken in the order of a policy: compact fills the cores of
+ *  one socket before the next, spread takes a core of each socket in
+ *  turn. Either way the second hardware threads of the cores come last.
+ */
+#ifndef PIN_H
+#define PIN_H
+#include <stddef.h>
+
+/** @brief Most thread counts of a sweep */
+#define SP_MAX_THREAD_SWEEP 64
+
+/** @brief The knee of a sweep is the fewest threads that reach this
+ *  fraction of the best bandwidth of the sweep */
+#define SP_KNEE_FRACTION 0.9
+
+enum sp_pin_policy
+{
+    PIN_NONE,
+    PIN_COMPACT, /**< socket by socket */
+    PIN_SPREAD   /**< a core of each socket in turn */
+};
+
+struct sp_thread_sweep
+{
+    enum sp_pin_policy policy;
+    int n;                                /**< thread counts, ascending */
+    size_t threads[SP_MAX_THREAD_SWEEP];
+};
+
+/** @brief Parse the value of --thread-sweep, <counts>[:<policy>]. counts
+ *  is a comma-separated list of thread counts and max, the CPUs of the
+ *  process, where .. continues the progression of the two counts before
+ *  it up to the one after it, e.g. 1,2,..,max or 4,8,..,64. The policy is
+ *  compact (the default) or spread.
+ *  @return 0 on success, -1 if it is malformed
+ */
+int sp_thread_sweep_parse(const char *arg, struct sp_thread_sweep *sweep);
+
+/** @brief CPUs threads can be pinned to, those the process may run on */
+int sp_pin_cpus(void);
+
+/** @brief Index of the knee of a sweep of n bandwidths, see
+ *  SP_KNEE_FRACTION */
+int sp_thread_sweep_knee(const double *mbs, int n);
+
+#ifdef USE_OPENMP
+/** @brief Pin thread t of a team of nthreads to the t-th CPU of the policy.
+ *  The runtime runs the next regions of as many threads on the same ones.
+ */
+void sp_pin_team(enum sp_pin_policy policy, int nthreads);
+#endif
+#endif
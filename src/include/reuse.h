@@ -0,0 +1,67 @@
+/** @file reuse.h
+ *  @brief Reuse-distance profiles of configs (--analyze-reuse). The
+ *  addresses one thread of a config touches, in the order its kernel
+ *  touches them, go through a sampled stack-distance algorithm (SHARDS):
+ *  only the lines whose hash falls below a threshold are tracked, and the
+ *  distances between them are scaled up by the sampling rate. The
+ *  threshold is lowered whenever more than SP_REUSE_TRACKED lines are
+ *  tracked, so small footprints are profiled in full and large ones in
+ *  bounded memory.
+ *
+ *  A reference misses in a fully associative LRU cache of C lines when
+ *  more than C other lines were touched since its line was last touched.
+ *  That gives the miss ratio of each level of this machine, with the TLB
+ *  as a cache of SP_TLB_ENTRIES pages.
+ */
+#ifndef REUSE_H
+#define REUSE_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief Most lines (and pages) tracked at once */
+#define SP_REUSE_TRACKED (1 << 16)
+
+/** @brief Most references profiled per config. A config with fewer is
+ *  streamed twice and profiled on the second pass, as the timed runs that
+ *  follow the warm-up see it. A longer one is profiled over its first
+ *  ones, from cold caches.
+ */
+#define SP_REUSE_REFS ((size_t)1 << 26)
+
+/** @brief Bins of the histogram: 0, then [2^(b-1), 2^b) lines for bin b.
+ *  The last bin also takes the longer distances.
+ */
+#define SP_REUSE_BINS 32
+
+/** @brief Entries of the last-level TLB, which can not be read from the
+ *  system. Common for the second-level TLBs of server cores.
+ */
+#define SP_TLB_ENTRIES 1536
+
+enum sp_reuse_level
+{
+    REUSE_L1,
+    REUSE_L2,
+    REUSE_LLC, /**< the share of one thread of the config */
+    REUSE_TLB,
+    SP_REUSE_LEVELS
+};
+
+struct sp_reuse
+{
+    double refs;                 /**< references profiled, 0 if the config was not */
+    double rate;                 /**< final sampling rate of the lines */
+    double hist[SP_REUSE_BINS];  /**< fraction of the references at each reuse distance, in lines */
+    double cold;                 /**< fraction of the references to lines not touched before */
+    double miss[SP_REUSE_LEVELS]; /**< predicted miss ratio of each level */
+};
+
+/** @brief Profile rc. TRACE and CHASE configs are not profiled. */
+void sp_reuse_analyze(const struct run_config *rc, struct sp_reuse *r);
+
+/** @brief Capacity of level in lines, or pages for REUSE_TLB, for a
+ *  config of threads threads
+ */
+size_t sp_reuse_capacity(enum sp_reuse_level level, size_t threads);
+
+#endif
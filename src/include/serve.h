@@ -0,0 +1,22 @@
+/** @file serve.h
+ *  @brief Server mode (--serve). The buffers are allocated and first
+ *  touched once, for the configs given on the command line, then json
+ *  configs are read one line at a time and a JSON Lines record is written
+ *  for each as soon as it has run, so a sweep driver pays for neither a
+ *  process nor an allocation per config.
+ */
+#ifndef SERVE_H
+#define SERVE_H
+#include "spatter.h"
+#include "output.h"
+
+/** @brief Serve configs until the input ends or a line reads quit.
+ *  @param addr stdin, or unix:<path> to accept connections on a UNIX
+ *  socket, one after the other, each answered on itself
+ *  @param sizes The configs the buffers are sized for
+ *  @param meta Written at the start of every stream
+ *  @return 0, or -1 if the socket can not be opened
+ */
+int sp_serve(const char *addr, const struct sp_suite *sizes, const struct sp_output_meta *meta);
+
+#endif
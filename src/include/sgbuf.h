@@ -29,6 +29,7 @@ typedef struct sgDataBuf_t{
     size_t len;         /**< The length of the buffers (in blocks) */
     size_t size;        /**< The size of the buffer (in bytes) */
     size_t nptrs;       /**< The number of host pointers in **host_ptrs */
+    size_t capacity;    /**< The allocated size of each host buffer (in bytes) */
 }sgDataBuf;
 
 /** @brief Describes a buffer object describing how data will be scattered/gathered */
@@ -48,11 +49,27 @@ typedef struct sgIndexBuf_t{
     size_t stride;
 }sgIndexBuf;
 
-/** @brief Fill buf with random values.
+/** @brief Fill buf with random values. The values do not depend on
+ *  nthreads, see sp_rand_fill.
  *  @param buf Data buffer to be filled, should be pre-allocated
  *  @param len Length of buf
+ *  @param nthreads OpenMP threads that fill (and first-touch) buf
  */
-void random_data(sgData_t *buf, size_t len);
+void random_data(sgData_t *buf, size_t len, int nthreads);
+
+/** @brief Buffers more than this many times larger than needed are shrunk */
+#define SGBUF_SHRINK_FACTOR 4
+
+/** @brief Resize the host buffers of buf (host_ptr, or every one of host_ptrs
+ *  if nptrs > 0) to hold size bytes. They are only reallocated when too small
+ *  or more than SGBUF_SHRINK_FACTOR times too large, so that a large config
+ *  does not fix the page footprint of the small configs that follow it.
+ *  @param buf Data buffer allocated with sp_data_malloc
+ *  @param size The size needed (in bytes)
+ *  @param align The alignment of each host buffer
+ *  @return 1 if the buffers were reallocated and need to be refilled, else 0
+ */
+int sgbuf_reserve(sgDataBuf *buf, size_t size, size_t align);
 
 /** @brief Fill an index buffer with the indices [0:len-1] 
  *  @param idx The index buffer
@@ -73,7 +90,15 @@ void wrap_indices(sgIdx_t *idx, size_t len, size_t worksets, size_t stride, size
 void ms1_indices(sgIdx_t *idx, size_t len, size_t worksets, size_t run, size_t gap);
 //TODO: Remove trace_indices. No longer used.
 //size_t trace_indices( sgIdx_t *idx, size_t len, struct trace tr);
-void compress_indices( ssize_t *idx, size_t len);
+/** @brief Remove the pages no index touches (--compress): the pages of
+ *  idx are renumbered 0, 1, ... in the order of their first access, and
+ *  each index keeps its offset within its page. Runs in O(len) with one
+ *  OpenMP thread per contiguous part of idx.
+ *  @param elem Bytes per element, page must be a multiple of it
+ *  @param page Page size in bytes, a power of two
+ *  @return The number of distinct pages
+ */
+size_t compress_indices(ssize_t *idx, size_t len, size_t elem, size_t page);
 #ifdef USE_OPENCL
 //TODO: why is it a void*? 
 cl_mem clCreateBufferSafe(cl_context context, cl_mem_flags flags, size_t size, void *host_ptr);
@@ -6,8 +6,39 @@
 #define SGTIME_H
 
 #include <time.h>
+#include <stdint.h>
+
+/** @brief Clock behind sg_zero_time and sg_get_time_ms (--timer) */
+enum sg_timer
+{
+    TIMER_CLOCK, /**< clock_gettime(CLOCK_MONOTONIC) */
+    TIMER_TSC,   /**< rdtscp on x86-64 with an invariant TSC, cntvct_el0 on AArch64 */
+    INVALID_TIMER
+};
 
 void   sg_zero_time(void);
 double sg_get_time_ms(void);
 
+/** @brief Switch the clock. The TSC is calibrated against CLOCK_MONOTONIC
+ *  first. Returns 0, and keeps CLOCK_MONOTONIC, if the CPU has no usable
+ *  counter.
+ */
+int sg_set_timer(enum sg_timer timer);
+enum sg_timer sg_get_timer(void);
+
+/** @brief The counter behind TIMER_TSC, for code that paces or times
+ *  itself in ticks
+ */
+uint64_t sg_ticks(void);
+
+/** @brief Length of a tick of sg_ticks in ns, calibrated on the first
+ *  call. 0 if the CPU has no usable counter.
+ */
+double sg_tick_ns(void);
+
+/** @brief Smallest time between sg_zero_time and sg_get_time_ms, in ms,
+ *  measured once and cached
+ */
+double sg_timer_overhead_ms(void);
+
 #endif
@@ -6,6 +6,7 @@
 #ifndef SGTYPE_H
 #define SGTYPE_H
 #include <assert.h>
+#include <stddef.h>
 
 #ifdef USE_OPENCL
 #include "cl-helper.h"
@@ -26,4 +27,21 @@ typedef long sgsIdx_t;
 typedef size_t spSize_t;
 #define SPS "%zu"
 
+/** @brief Element type moved by the Gather and Scatter kernels (--elem).
+ *  The buffers are still allocated as sgData_t, the kernels view them as
+ *  arrays of the chosen element.
+ */
+enum sg_elem
+{
+    ELEM_F64,   /**< sgData_t */
+    ELEM_F32,
+    ELEM_I32,
+    ELEM_I64,
+    ELEM_C64,   /**< Complex of two f64, 16 bytes */
+    ELEM_BYTES, /**< An opaque struct of elem_size bytes */
+    INVALID_ELEM
+};
+
+typedef struct { double re, im; } sgC64_t;
+
 #endif //endif SGTYPE
@@ -0,0 +1,39 @@
+/** @file shard.h
+ *  @brief Splitting a suite across jobs (--shard) and skipping the configs
+ *  an interrupted job already wrote (--resume).
+ *
+ *  Every job parses the whole suite and keeps its own share of it: the
+ *  configs are dealt out largest first, each to the shard with the least
+ *  work so far, where the work of a config is its pattern length times its
+ *  count. The deal only depends on the suite, so the jobs of a sweep agree
+ *  on it without talking to each other. A resumed job then drops the
+ *  configs that have a run record in its --output=json file.
+ */
+#ifndef SHARD_H
+#define SHARD_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief Parse the value of --shard, <i>/<n> with 0 <= i < n
+ *  @return 0 on success, -1 if it is malformed
+ */
+int sp_shard_parse(const char *arg, int *shard, int *nshards);
+
+/** @brief Set keep[k] to 1 for the configs of rc that go to shard, 0 for
+ *  the others */
+void sp_shard_select(const struct run_config *rc, int nrc, int shard, int nshards, char *keep);
+
+/** @brief Read the run records of a JSON Lines file. A file that does not
+ *  exist yet has none.
+ *  @return The number of records, or -1 if the file can not be read
+ */
+int sp_resume_load(const char *path);
+void sp_resume_free(void);
+
+/** @brief 1 if a record of the file has the name and config keys of rc.
+ *  Each record accounts for one config, so a config listed twice in the
+ *  suite runs again if the file holds only one record of it.
+ */
+int sp_resume_done(const struct run_config *rc);
+
+#endif
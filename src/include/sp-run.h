@@ -0,0 +1,61 @@
+/** @file sp-run.h
+ *  @brief Setup and one run of a config on the CPU backends, shared by the
+ *  spatter CLI and libspatter
+ */
+#ifndef SP_RUN_H
+#define SP_RUN_H
+#include <stddef.h>
+#include <stdint.h>
+#include "parse-args.h"
+#include "sgbuf.h"
+#include "trace-stream.h"
+#include "chase.h"
+
+/** @brief Remap the indices of pattern at or beyond boundary (-1 for the
+ *  largest that fits nrc configs) and return the largest index
+ */
+spIdx_t remap_pattern(const int nrc, ssize_t *pattern, const spSize_t pattern_len, ssize_t boundary);
+uint64_t isqrt(uint64_t x);
+uint64_t icbrt(uint64_t x);
+
+/** @brief Compress (--compress) and remap the patterns of rc, one of nrc
+ *  configs, and return the bytes of its source and of each target. Also
+ *  builds its --morton/--hilbert order, its --index-bits patterns and its
+ *  --inner-stream.
+ */
+void sp_prepare_config(struct run_config *rc, int nrc, size_t *source_size, size_t *target_size);
+
+/** @brief Bytes one run of rc gathers or scatters */
+size_t sp_config_bytes(const struct run_config *rc);
+
+/** @brief Offset into the sparse buffer of the i-th of n Gathers or
+ *  Scatters of rc, in elements, with delta the delta of its side (for GS)
+ */
+size_t sp_config_base(const struct run_config *rc, size_t delta, size_t i, size_t n);
+
+/** @brief Fill the source with random data and first-touch the targets,
+ *  following --numa
+ */
+void sp_fill_source(sgDataBuf *source, size_t nthreads);
+void sp_fill_targets(sgDataBuf *target);
+
+/** @brief Fill a source from sp_reserve (--sparse-source) for rc: drop the
+ *  pages of the config before and back only the elements rc touches,
+ *  streaming trace once for a TRACE config
+ */
+void sp_fill_sparse_source(sgDataBuf *source, const struct run_config *rc, struct sp_trace_stream *trace, size_t nthreads);
+
+/** @brief An int16_t or int32_t copy of pat for --index-bits */
+void *sp_narrow_pattern(const ssize_t *pat, size_t len, int bits);
+
+/** @brief One run of rc on the Serial or OpenMP backend. The source
+ *  replicas are used if source->host_ptrs is set. trace is the open stream
+ *  of a TRACE config, chase the chains of a CHASE config.
+ */
+void sp_run_serial_kernel(struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase);
+void sp_run_omp_kernel(struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase);
+
+/** @brief Either of the above */
+typedef void (*sp_run_fn)(struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase);
+
+#endif
@@ -1,12 +1,61 @@
 #ifndef SP_ALLOC_H
 #define SP_ALLOC_H
+#include <stddef.h>
 #ifndef SP_MAX_ALLOC
   //65GB
   #define SP_MAX_ALLOC (65ll * 1000 * 1000 * 1000)
 #endif
+#ifndef SP_MAX_RESERVE
+  //32TiB of address space
+  #define SP_MAX_RESERVE (1ll << 45)
+#endif
 #define ALIGN_CACHE 64
 #define ALIGN_PAGE  4096
+
+/** @brief Allocators that the data buffers can be taken from (--alloc)
+ */
+enum sp_pool
+{
+    SP_POOL_DEFAULT,     /**< aligned_alloc/posix_memalign */
+    SP_POOL_THP,         /**< 2 MiB aligned and madvise(MADV_HUGEPAGE) */
+    SP_POOL_HUGETLB_2M,  /**< mmap(MAP_HUGETLB) with 2 MiB pages */
+    SP_POOL_HUGETLB_1G,  /**< mmap(MAP_HUGETLB) with 1 GiB pages */
+    SP_POOL_LIBNUMA,     /**< numa_alloc_local, needs USE_LIBNUMA */
+    SP_POOL_MEMKIND,     /**< memkind high-bandwidth memory, needs USE_MEMKIND */
+    SP_NPOOLS
+};
+
 void *sp_malloc (size_t size, size_t count, size_t align);
 void *sp_calloc (size_t size, size_t count, size_t align);
 long long get_mem_used();
+
+/** @brief Select the pool used by sp_data_malloc. Exits if the pool is not
+ *  available in this build.
+ */
+void sp_set_data_pool(enum sp_pool pool);
+enum sp_pool sp_get_data_pool(void);
+const char *sp_pool_name(enum sp_pool pool);
+
+/** @brief Allocate a data buffer from the selected pool. Must be released
+ *  with sp_free.
+ */
+void *sp_data_malloc (size_t size, size_t count, size_t align);
+
+/** @brief Reserve size bytes of address space (--sparse-source), of which
+ *  only the pages written are ever backed. Base pages unless the pool is
+ *  SP_POOL_THP, so that one write backs 4 KiB and not 2 MiB. Does not count
+ *  towards SP_MAX_ALLOC, must be released with sp_free.
+ */
+void *sp_reserve (size_t size);
+
+/** @brief Hand the backed pages of a reservation back to the system, they
+ *  read as zeros again
+ */
+void sp_reserve_reset (void *ptr, size_t size);
+
+/** @brief Release memory from sp_data_malloc, sp_reserve (or plain sp_malloc) */
+void sp_free (void *ptr);
+
+/** @brief Bytes currently held by data buffers from one pool */
+long long get_pool_mem_used(enum sp_pool pool);
 #endif
@@ -0,0 +1,36 @@
+/** @file sp_arena.h
+ *  @brief A bump allocator for short-lived parse-time objects. Everything
+ *  taken from an arena is released at once with sp_arena_reset, which keeps
+ *  the first chunk around so that parsing the next config does not have to
+ *  go back to malloc.
+ */
+#ifndef SP_ARENA_H
+#define SP_ARENA_H
+
+#include <stddef.h>
+
+#define SP_ARENA_CHUNK (64 * 1024)
+
+struct sp_arena_chunk {
+    struct sp_arena_chunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+struct sp_arena {
+    struct sp_arena_chunk *head;
+};
+
+/** @brief Allocate size * count bytes aligned to align (a power of two).
+ *  Requests larger than SP_ARENA_CHUNK get a chunk of their own.
+ */
+void *sp_arena_alloc(struct sp_arena *arena, size_t size, size_t count, size_t align);
+
+/** @brief Release everything but the first chunk */
+void sp_arena_reset(struct sp_arena *arena);
+
+/** @brief Release every chunk */
+void sp_arena_destroy(struct sp_arena *arena);
+
+#endif
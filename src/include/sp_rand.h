@@ -0,0 +1,86 @@
+/** @file sp_rand.h
+ *  @brief Random numbers that depend only on a seed and a position, never
+ *  on the thread that draws them. Buffers are filled in blocks of
+ *  SP_RAND_BLOCK elements, each from its own PCG stream (the block number),
+ *  and the random kernels (CPU and GPU) draw the i-th base offset with a
+ *  counter-based hash of (seed, i). Both give the same values for any thread count or
+ *  schedule.
+ */
+#ifndef SP_RAND_H
+#define SP_RAND_H
+#include <stddef.h>
+#include <stdint.h>
+#include "sgtype.h"
+
+/** @brief Elements per PCG stream, 8 pages of sgData_t, so that the static
+ *  chunks of sp_rand_fill start on page boundaries
+ */
+#define SP_RAND_BLOCK 4096
+
+// The hash is also used by the CUDA and HIP random kernels
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define SP_RAND_HD __host__ __device__
+#else
+#define SP_RAND_HD
+#endif
+
+/** @brief The i-th 64-bit value of the stream of seed (SplitMix64 of the
+ *  counter, offset by the seed)
+ */
+static inline SP_RAND_HD uint64_t sp_rand_at(uint64_t seed, uint64_t i)
+{
+    uint64_t z = seed * 0x9e3779b97f4a7c15ULL + (i + 1) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/** @brief The i-th value of the stream of seed in [0, bound), bound < 2^32 */
+static inline SP_RAND_HD uint32_t sp_rand_bounded(uint64_t seed, uint64_t i, uint32_t bound)
+{
+    return (uint32_t)(((sp_rand_at(seed, i) >> 32) * bound) >> 32);
+}
+
+/** @brief One column of an alias table (Vose). Column j keeps j when the
+ *  low 32 bits of the draw are below cut, and gives alias otherwise.
+ */
+struct sp_alias_entry
+{
+    uint32_t cut;
+    uint32_t alias;
+};
+
+/** @brief The i-th value of the stream of seed in [0, n), drawn from the
+ *  alias table t of n columns. The table is only read, so any number of
+ *  threads draw from it without locks, and the values do not depend on them.
+ */
+static inline SP_RAND_HD uint32_t sp_rand_alias(const struct sp_alias_entry *t, uint64_t seed, uint64_t i, uint32_t n)
+{
+    uint64_t r = sp_rand_at(seed, i);
+    uint32_t j = (uint32_t)(((r >> 32) * n) >> 32);
+    return (uint32_t)r < t[j].cut ? j : t[j].alias;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Fill buf with integers in [0, range) from seed, with nthreads
+ *  OpenMP threads splitting the blocks statically: the pages of each thread
+ *  are the ones it first-touches, like the kernels' static schedule.
+ */
+void sp_rand_fill(sgData_t *buf, size_t len, uint64_t seed, uint32_t range, int nthreads);
+
+/** @brief Fisher-Yates shuffle of v from seed */
+void sp_rand_shuffle(size_t *v, size_t n, uint64_t seed);
+
+/** @brief Build the alias table t of the weights w of n values, n < 2^32.
+ *  The weights need not be normalized.
+ */
+void sp_alias_build(struct sp_alias_entry *t, const double *w, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,70 @@
+/** @file spatter.h
+ *  @brief libspatter: run Spatter configs in-process. Configs are parsed
+ *  once from spatter's own arguments, and the source and targets stay
+ *  allocated and warm between runs, so many configs can be timed without
+ *  a process, a parse and a first touch each (OpenMP and Serial backends).
+ *
+ *      struct sp_suite *s = sp_config_parse(argc, argv);
+ *      struct sp_buffers *b = sp_buffers_create(s);
+ *      for (int k = 0; k < sp_config_count(s); k++)
+ *          sp_run(b, s, k, INVALID_BACKEND, &result);
+ *      sp_buffers_destroy(b);
+ *      sp_config_free(s);
+ *
+ *  Options that are not per config (--numa, --schedule, --simd, ...) are
+ *  process-wide, set by the last parse that gives them. Invalid arguments
+ *  exit the process, as they do in spatter.
+ */
+#ifndef SPATTER_H
+#define SPATTER_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief The configs of one parse */
+struct sp_suite;
+
+/** @brief A source and one target per thread, sized for a suite */
+struct sp_buffers;
+
+/** @brief Times of one sp_run */
+struct sp_result
+{
+    size_t bytes;     /**< bytes gathered or scattered by one run */
+    size_t runs;      /**< timed runs, -R or as chosen by --target-ci */
+    double min_ms;    /**< fastest run */
+    double median_ms; /**< median run */
+    double max_ms;    /**< slowest run */
+    double bw_mbs;    /**< bandwidth of the fastest run, in MB/s */
+};
+
+/** @brief Parse spatter arguments, argv[0] included, into configs.
+ *  Returns NULL if no config was parsed.
+ */
+struct sp_suite *sp_config_parse(int argc, char **argv);
+
+/** @brief Parse json configs, an array of config objects as in a -pFILE
+ *  json file or a single object. Returns NULL if text is not json.
+ */
+struct sp_suite *sp_config_parse_json(const char *text);
+
+/** @brief Take over nrc configs from parse_args */
+struct sp_suite *sp_config_adopt(struct run_config *rc, int nrc);
+
+int sp_config_count(const struct sp_suite *suite);
+const struct run_config *sp_config_get(const struct sp_suite *suite, int k);
+void sp_config_free(struct sp_suite *suite);
+
+/** @brief Allocate and fill buffers large enough for every config of suite
+ *  and its threads
+ */
+struct sp_buffers *sp_buffers_create(const struct sp_suite *suite);
+void sp_buffers_destroy(struct sp_buffers *bufs);
+
+/** @brief One untimed warm-up run of config k of suite on bufs, then its
+ *  timed runs. backend is OPENMP or SERIAL, INVALID_BACKEND for the one
+ *  the arguments chose. Returns 0, or -1 if the backend is not built in or
+ *  the config does not fit the buffers.
+ */
+int sp_run(struct sp_buffers *bufs, struct sp_suite *suite, int k, enum sg_backend backend, struct sp_result *result);
+
+#endif
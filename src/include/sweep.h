@@ -0,0 +1,30 @@
+/** @file sweep.h
+ *  @brief Parameter sweeps on the command line. Any argument may hold
+ *  brace groups that stand for several values:
+ *
+ *  - {a,b,c}            the listed values
+ *  - {s..e}             s, s+1, ..., e
+ *  - {s..e:+n} {s..e:n} s, s+n, ... up to e
+ *  - {s..e:xn}          s, s*n, ... up to e
+ *
+ *  Numbers may be written b^e. When both ends of a range are powers of the
+ *  same base and no step is given, the step is xb, so {2^16..2^28} is the
+ *  powers of two from 2^16 to 2^28. Every combination of the groups is one
+ *  config; the last group varies fastest.
+ */
+#ifndef SWEEP_H
+#define SWEEP_H
+#include <stddef.h>
+
+/** @brief Most configs a sweep may expand to */
+#define SP_MAX_SWEEP (1 << 20)
+
+/** @brief Number of configs argv expands to: 1 without brace groups */
+size_t sp_sweep_count(int argc, char **argv);
+
+/** @brief A copy of argv with every brace group replaced by its value for
+ *  config k < sp_sweep_count(). Release with sp_sweep_free.
+ */
+char **sp_sweep_argv(int argc, char **argv, size_t k);
+void sp_sweep_free(int argc, char **argv);
+#endif
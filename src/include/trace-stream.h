@@ -0,0 +1,47 @@
+/** @file trace-stream.h
+ *  @brief Streams the 64-bit indices of a binary trace (-pTRACE:<file>) in
+ *  fixed size chunks, so that traces much larger than memory can be replayed.
+ *
+ *  Gzip'd traces are decompressed on a helper thread into one of two buffers
+ *  while the kernels consume the other. Uncompressed traces are mmap'ed and
+ *  handed out in place, as are streams generated in memory (-pGRAPH).
+ */
+#ifndef TRACE_STREAM_H
+#define TRACE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Default number of indices per chunk (matches gz_read's NBUFS) */
+#define SP_TRACE_CHUNK (1 << 18)
+
+/** @brief Default source length (in elements) that indices are wrapped to
+ *  when no --boundary is given
+ */
+#define SP_TRACE_SOURCE_LEN (1 << 24)
+
+struct sp_trace_stream;
+
+/** @brief Open a trace and start streaming from its beginning. Exits on error.
+ *  @param file A gzip'd or raw file of native endian uint64_t indices
+ *  @param chunk The number of indices handed out per call to sp_trace_next
+ */
+struct sp_trace_stream *sp_trace_open(const char *file, size_t chunk);
+
+/** @brief Stream indices already in memory, as a trace file would be
+ *  @param idx len indices from sp_malloc, released by sp_trace_close
+ */
+struct sp_trace_stream *sp_trace_open_mem(uint64_t *idx, size_t len, size_t chunk);
+
+/** @brief Get the next chunk of indices.
+ *  @param chunk Set to the indices, valid until the next call
+ *  @return The number of indices in the chunk, 0 at the end of the trace
+ */
+size_t sp_trace_next(struct sp_trace_stream *s, const uint64_t **chunk);
+
+/** @brief Restart the stream from the beginning of the trace */
+void sp_trace_rewind(struct sp_trace_stream *s);
+
+void sp_trace_close(struct sp_trace_stream *s);
+
+#endif
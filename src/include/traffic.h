@@ -0,0 +1,90 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+#include <stddef.h>
+#include "parse-args.h"
+
+/** @brief Number of sparse-buffer index positions simulated per config.
+ *  Configs with more gathers/scatters than fit are extrapolated from the
+ *  first ones.
+ */
+#define SP_TRAFFIC_SAMPLE (1 << 20)
+
+/** @brief Bytes one timed run of a config moves, at three levels (--traffic)
+ */
+struct sp_traffic
+{
+    size_t useful; /**< elements gathered/scattered * sizeof(sgData_t), the "bytes" column */
+    size_t index;  /**< index bytes read: the pattern once at --index-bits, or every entry of a TRACE */
+    size_t lines;  /**< estimated cache-line bytes between the caches and memory */
+    double pages;  /**< pages of the sparse buffer touched, for the --papi dtlb/page metric */
+};
+
+/** @brief Cache line size of this machine, 64 if it can not be found */
+size_t sp_line_size(void);
+
+/** @brief L1 data cache size of this machine, 32 KiB if it can not be found */
+size_t sp_l1_size(void);
+
+/** @brief Estimate the traffic of one run of rc.
+ *
+ *  Lines counts the distinct cache lines of the sparse buffer that the
+ *  config touches, assuming the dense buffer and the pattern stay in cache.
+ *  Scatters count every line twice (write-allocate read plus write-back),
+ *  once with --store=nt. Gathers with --store=nt also count their dense
+ *  target writes, which then go to memory.
+ *  Random configs are counted without reuse between gathers, TRACE configs
+ *  as one line per index.
+ */
+void sp_traffic_model(const struct run_config *rc, struct sp_traffic *t);
+
+/** @brief Distinct pages of page bytes the sparse buffer of one run of rc
+ *  touches, counted like the lines of sp_traffic_model. 0 for TRACE configs.
+ */
+double sp_traffic_pages(const struct run_config *rc, size_t page);
+
+/** @brief Gathers/Scatters sampled per config by sp_pattern_analyze, in
+ *  pattern entries
+ */
+#define SP_ANALYZE_SAMPLE (1 << 16)
+
+/** @brief How the pattern of a config maps onto the memory system
+ *  (--analyze), from its indices alone. Counts are per Gather or Scatter,
+ *  summed over both sides of a GS.
+ */
+struct sp_pattern_stats
+{
+    double lines;      /**< distinct cache lines */
+    double sectors;    /**< distinct 32-byte sectors */
+    double warp_lines; /**< distinct 128-byte lines per 32-thread warp, one entry per thread as the CUDA kernels run */
+    double pages;      /**< distinct pages */
+    double reuse;      /**< fraction of the lines of Gather/Scatter i + 1 that i also touched */
+    double efficiency; /**< useful bytes over the bytes of the lines touched */
+};
+
+/** @brief Analyze the pattern of rc over its first Gathers or Scatters.
+ *  TRACE configs are left at 0.
+ */
+void sp_pattern_analyze(const struct run_config *rc, struct sp_pattern_stats *s);
+
+/** @brief The NUMA node of every page of a buffer (--tier)
+ */
+struct sp_page_map
+{
+    const unsigned char *node; /**< from sp_numa_page_map */
+    size_t npages;
+    size_t page;               /**< page size */
+    size_t offset;             /**< of the buffer into its first page */
+};
+
+/** @brief Bytes one run of rc gathers from or scatters to each node.
+ *
+ *  Every sparse element is counted on the node of its page, the source for
+ *  all kernels but the scatter side of GS, which is in target. The dense
+ *  side is assumed to stay in cache, as for the lines of sp_traffic_model,
+ *  so the nodes add up to the "bytes" column. Gathers are sampled evenly
+ *  over the run, random configs counted as if they were not. TRACE configs
+ *  and pages of unknown node count nowhere.
+ *  @param bytes Filled for every node, must hold SP_MAX_NUMA_NODES entries
+ */
+void sp_traffic_nodes(const struct run_config *rc, const struct sp_page_map *source, const struct sp_page_map *target, double *bytes);
+#endif
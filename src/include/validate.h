@@ -0,0 +1,51 @@
+/** @file validate.h
+ *  @brief Result checks of the CPU backends (--validate). After the timed
+ *  runs of a config, one more run, outside the timed region, writes every
+ *  slot of fresh buffers once (wrap is the count), and a checksum reduced
+ *  from what it wrote is compared with one computed on the host from the
+ *  source and the pattern.
+ *
+ *  The checksums are sums over the written positions of a hash of the
+ *  position and the element there, so they do not depend on the order in
+ *  which the threads summed or wrote them. A Gather checks the target slot
+ *  of every element it read. A Scatter reads dense values that depend only
+ *  on the position they go to, so overlapping Scatters agree, and checks
+ *  every position of the sparse buffer, touched or not.
+ */
+#ifndef VALIDATE_H
+#define VALIDATE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-run.h"
+
+/** @brief Exit status of a run in which a config failed its check */
+#define SP_EXIT_INVALID 3
+
+/** @brief Largest dense buffers of a check, the count of the check run is
+ *  cut to fit them
+ */
+#define SP_VALIDATE_BYTES ((size_t)64 << 20)
+
+enum sp_check_status
+{
+    CHECK_SKIPPED,
+    CHECK_PASSED,
+    CHECK_FAILED
+};
+
+struct sp_check
+{
+    enum sp_check_status status;
+    size_t count;      /**< Gathers or Scatters of the check run */
+    uint64_t expected; /**< checksum from the source and the pattern */
+    uint64_t actual;   /**< checksum of what the kernel wrote */
+    const char *why;   /**< why the config was skipped, NULL if not run */
+};
+
+/** @brief Check rc with one more run of its kernel through run (the
+ *  OpenMP or Serial one), on the buffers of its timed runs. A Scatter
+ *  writes into the source, which is refilled afterwards.
+ */
+void sp_validate(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_check *check);
+
+#endif
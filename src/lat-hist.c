@@ -0,0 +1,47 @@
+#include <string.h>
+#include "lat-hist.h"
+
+void sp_hist_clear(struct sp_hist *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void sp_hist_merge(struct sp_hist *dst, const struct sp_hist *src)
+{
+    for (size_t b = 0; b < SP_HIST_BUCKETS; b++)
+        dst->count[b] += src->count[b];
+    dst->n += src->n;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+// Smallest value of bucket b and its width
+static uint64_t bucket_low(size_t b, uint64_t *width)
+{
+    if (b < 64) {
+        *width = 1;
+        return b;
+    }
+    int shift = (int)(b - 64) / 32 + 1;
+    *width = (uint64_t)1 << shift;
+    return (uint64_t)((b - 64) % 32 + 32) << shift;
+}
+
+uint64_t sp_hist_quantile(const struct sp_hist *h, double q)
+{
+    if (h->n == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->n);
+    if (rank >= h->n)
+        rank = h->n - 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < SP_HIST_BUCKETS; b++) {
+        seen += h->count[b];
+        if (seen > rank) {
+            uint64_t width, low = bucket_low(b, &width);
+            uint64_t mid = low + width / 2;
+            return mid < h->max ? mid : h->max;
+        }
+    }
+    return h->max;
+}
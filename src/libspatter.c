@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spatter.h"
+#include "sp-run.h"
+#include "sgtime.h"
+#include "sp_alloc.h"
+#include "measure.h"
+#include "graph.h"
+
+#if defined( USE_OPENMP )
+	#include <omp.h>
+	#include "openmp/omp-sched.h"
+#endif
+
+extern enum sg_backend backend;
+extern enum sg_schedule sched_kind;
+extern size_t sched_chunk;
+
+struct sp_suite
+{
+    struct run_config *rc;
+    int nrc;
+    size_t *source_size; /**< bytes of the source of each config */
+    size_t *target_size; /**< bytes of each target of each config */
+};
+
+struct sp_buffers
+{
+    sgDataBuf source;
+    sgDataBuf target;
+};
+
+struct sp_suite *sp_config_parse(int argc, char **argv)
+{
+    struct run_config *rc;
+    int nrc = 0;
+    parse_args(argc, argv, &nrc, &rc);
+#ifdef USE_OPENMP
+    sp_sched_set(sched_kind, sched_chunk);
+#endif
+    return sp_config_adopt(rc, nrc);
+}
+
+struct sp_suite *sp_config_parse_json(const char *text)
+{
+    // A single config object is read as an array of one
+    while (*text == ' ' || *text == '\t')
+        text++;
+    size_t len = strlen(text);
+    int object = *text == '{';
+    char *json = (char *)malloc(len + 3);
+    snprintf(json, len + 3, object ? "[%s]" : "%s", text);
+
+    struct run_config *rc;
+    int nrc = 0;
+    int err = parse_json_text(json, strlen(json), &nrc, &rc);
+    free(json);
+    if (err)
+        return NULL;
+    if (nrc <= 0) {
+        free(rc);
+        return NULL;
+    }
+    return sp_config_adopt(rc, nrc);
+}
+
+struct sp_suite *sp_config_adopt(struct run_config *rc, int nrc)
+{
+    if (nrc <= 0)
+        return NULL;
+    struct sp_suite *s = (struct sp_suite *)calloc(1, sizeof(struct sp_suite));
+    s->rc = rc;
+    s->nrc = nrc;
+    s->source_size = (size_t *)malloc(sizeof(size_t) * s->nrc);
+    s->target_size = (size_t *)malloc(sizeof(size_t) * s->nrc);
+    for (int k = 0; k < s->nrc; k++) {
+        s->rc[k].time_ms = (double *)malloc(sizeof(double) * sp_measure_slots(&s->rc[k]));
+        sp_prepare_config(&s->rc[k], s->nrc, &s->source_size[k], &s->target_size[k]);
+    }
+    return s;
+}
+
+int sp_config_count(const struct sp_suite *suite)
+{
+    return suite ? suite->nrc : 0;
+}
+
+const struct run_config *sp_config_get(const struct sp_suite *suite, int k)
+{
+    return suite && k >= 0 && k < suite->nrc ? &suite->rc[k] : NULL;
+}
+
+void sp_config_free(struct sp_suite *suite)
+{
+    if (!suite)
+        return;
+    for (int k = 0; k < suite->nrc; k++) {
+        free(suite->rc[k].time_ms);
+        free(suite->rc[k].pattern_narrow);
+        free(suite->rc[k].pattern_gather_narrow);
+        free(suite->rc[k].pattern_scatter_narrow);
+        if (suite->rc[k].ro_order)
+            sp_free(suite->rc[k].ro_order);
+        if (suite->rc[k].inner_stream)
+            sp_free(suite->rc[k].inner_stream);
+        if (suite->rc[k].random_bases)
+            sp_free(suite->rc[k].random_bases);
+    }
+    free(suite->rc);
+    free(suite->source_size);
+    free(suite->target_size);
+    free(suite);
+}
+
+struct sp_buffers *sp_buffers_create(const struct sp_suite *suite)
+{
+    struct sp_buffers *b = (struct sp_buffers *)calloc(1, sizeof(struct sp_buffers));
+    size_t source_size = 0, target_size = 0, nptrs = 1;
+    for (int k = 0; k < suite->nrc; k++) {
+        if (suite->source_size[k] > source_size)
+            source_size = suite->source_size[k];
+        if (suite->target_size[k] > target_size)
+            target_size = suite->target_size[k];
+        if (suite->rc[k].omp_threads > nptrs)
+            nptrs = suite->rc[k].omp_threads;
+    }
+
+    b->source.size = b->source.capacity = source_size;
+    b->source.len = source_size / sizeof(sgData_t);
+    b->source.host_ptr = (sgData_t *)sp_data_malloc(source_size, 1, ALIGN_CACHE);
+
+    b->target.size = b->target.capacity = target_size;
+    b->target.len = target_size / sizeof(sgData_t);
+    b->target.nptrs = nptrs;
+    b->target.host_ptrs = (sgData_t **)sp_malloc(sizeof(sgData_t *), nptrs, ALIGN_CACHE);
+    for (size_t t = 0; t < nptrs; t++)
+        b->target.host_ptrs[t] = (sgData_t *)sp_data_malloc(target_size, 1, ALIGN_PAGE);
+    b->target.host_ptr = b->target.host_ptrs[0];
+
+    sp_fill_targets(&b->target);
+    sp_fill_source(&b->source, nptrs);
+    return b;
+}
+
+void sp_buffers_destroy(struct sp_buffers *bufs)
+{
+    if (!bufs)
+        return;
+    sp_free(bufs->source.host_ptr);
+    for (size_t t = 0; t < bufs->target.nptrs; t++)
+        sp_free(bufs->target.host_ptrs[t]);
+    sp_free(bufs->target.host_ptrs);
+    free(bufs);
+}
+
+int sp_run(struct sp_buffers *bufs, struct sp_suite *suite, int k, enum sg_backend be, struct sp_result *result)
+{
+    if (!bufs || !suite || k < 0 || k >= suite->nrc)
+        return -1;
+    struct run_config *rc = &suite->rc[k];
+    if (suite->source_size[k] > bufs->source.size || suite->target_size[k] > bufs->target.size ||
+            rc->omp_threads > bufs->target.nptrs)
+        return -1;
+
+    void (*run)(struct run_config *, sgDataBuf *, sgDataBuf *, struct sp_trace_stream *, struct sp_chase *) = NULL;
+    if (be == INVALID_BACKEND)
+        be = backend;
+#ifdef USE_OPENMP
+    if (be == OPENMP) {
+        omp_set_num_threads(rc->omp_threads);
+        run = sp_run_omp_kernel;
+    }
+#endif
+#ifdef USE_SERIAL
+    if (be == SERIAL)
+        run = sp_run_serial_kernel;
+#endif
+    if (!run)
+        return -1;
+    enum sg_backend parsed = backend;
+    backend = be;
+
+    struct sp_trace_stream *trace = NULL;
+    if (rc->type == TRACE && rc->graph)
+        trace = sp_graph_open(rc->pattern_file, (enum sp_graph_algo)rc->graph, rc->trace_chunk);
+    else if (rc->type == TRACE)
+        trace = sp_trace_open(rc->pattern_file, rc->trace_chunk);
+    // CHASE links its chains through the source, refilled afterwards
+    struct sp_chase chase = {0};
+    if (rc->kernel == CHASE)
+        sp_chase_prepare(&chase, bufs->source.host_ptr, rc, be == OPENMP ? (int)rc->omp_threads : 1);
+
+    for (int i = -1; sp_measure_more(rc, i); i++) {
+        if (trace && i != -1) sp_trace_rewind(trace);
+        if (i != -1) sg_zero_time();
+        run(rc, &bufs->source, &bufs->target, trace, &chase);
+        if (i != -1) rc->time_ms[i] = sg_get_time_ms();
+    }
+
+    if (trace)
+        sp_trace_close(trace);
+    if (rc->kernel == CHASE) {
+        sp_chase_release(&chase);
+        sp_fill_source(&bufs->source, bufs->target.nptrs);
+    }
+    backend = parsed;
+
+    struct sp_run_stats stats;
+    sp_run_stats(rc->time_ms, rc->nruns, &stats);
+    memset(result, 0, sizeof(*result));
+    result->bytes = sp_config_bytes(rc);
+    result->runs = rc->nruns;
+    result->median_ms = stats.median_ms;
+    for (size_t i = 0; i < rc->nruns; i++) {
+        if (i == 0 || rc->time_ms[i] < result->min_ms)
+            result->min_ms = rc->time_ms[i];
+        if (rc->time_ms[i] > result->max_ms)
+            result->max_ms = rc->time_ms[i];
+    }
+    if (result->min_ms > 0)
+        result->bw_mbs = result->bytes / result->min_ms / 1000.;
+    return 0;
+}
@@ -5,15 +5,39 @@
 #include <ctype.h>
 #include <assert.h>
 #include <math.h>
+#include <unistd.h>
 //#include "ocl-kernel-gen.h"
 #include "parse-args.h"
 #include "sgtype.h"
 #include "sgbuf.h"
 #include "sgtime.h"
 #include "sp_alloc.h"
+#include "sp_rand.h"
 #include "morton.h"
-#include "hilbert3d.h"
+#include "hilbert.h"
 #include "unused.h"
+#include "backend-support-tests.h"
+#include "numa-util.h"
+#include "trace-stream.h"
+#include "graph.h"
+#include "traffic.h"
+#include "mpi-report.h"
+#include "mpi-rma.h"
+#include "dsa.h"
+#include "measure.h"
+#include "chase.h"
+#include "energy.h"
+#include "output.h"
+#include "cache-flush.h"
+#include "sp-run.h"
+#include "serve.h"
+#include "baseline.h"
+#include "shard.h"
+#include "pin.h"
+#include "noise.h"
+#include "lat-hist.h"
+#include "validate.h"
+#include "reuse.h"
 
 #if defined( USE_OPENCL )
 	#include "../opencl/ocl-backend.h"
@@ -22,10 +46,13 @@
 	#include <omp.h>
 	#include "openmp/omp-backend.h"
 	#include "openmp/openmp_kernels.h"
+	#include "openmp/openmp_simd_kernels.h"
+	#include "openmp/omp-sched.h"
 #endif
 #if defined ( USE_CUDA )
-    #include <cuda.h>
+    #include "cuda/sp-gpu.h"
     #include "cuda/cuda-backend.h"
+    #include "cuda/cuda-tune.h"
 #endif
 #if defined( USE_SERIAL )
 	#include "serial/serial-kernels.h"
@@ -49,6 +76,14 @@ const char* SPATTER_VERSION="1.0";
 
 //SGBench specific enums
 extern enum sg_backend backend;
+extern enum sg_simd simd_isa;
+extern enum sg_numa numa_mode;
+extern enum sg_rma rma_mode;
+extern size_t rma_batch;
+extern char dsa_wq[STRING_SIZE];
+extern size_t dsa_submitters;
+extern enum sg_schedule sched_kind;
+extern size_t sched_chunk;
 
 //Strings defining program behavior
 extern char platform_string[STRING_SIZE];
@@ -57,10 +92,44 @@ extern char kernel_file[STRING_SIZE];
 extern char kernel_name[STRING_SIZE];
 
 extern int cuda_dev;
+extern int cuda_devs[SP_MAX_CUDA_DEVICES];
+extern int cuda_ndevs;
+extern int cuda_streams;
+extern int cuda_graph_flag;
+extern int autotune_flag;
+extern enum sg_gpu_mem gpu_mem;
+extern enum sg_gpu_hint gpu_hint;
 extern int validate_flag;
 extern int quiet_flag;
 extern int aggregate_flag;
 extern int compress_flag;
+extern size_t compress_page;
+extern int resize_flag;
+extern int sparse_source_flag;
+extern int traffic_flag;
+extern int analyze_flag;
+extern int analyze_reuse_flag;
+extern int busy_flag;
+extern int corun_flag;
+extern int compose_flag;
+extern int inner_stream_flag;
+extern double min_sample_ms;
+extern enum sp_cache cache_mode;
+extern char serve_addr[STRING_SIZE];
+extern char baseline_file[STRING_SIZE];
+extern double baseline_tolerance;
+extern struct sp_noise_spec noise_spec;
+extern double rate_mgs;
+extern struct sp_tier source_tier;
+extern struct sp_tier target_tier;
+extern int energy_flag;
+extern enum sp_output_format output_format;
+extern char output_file[STRING_SIZE];
+extern int shard_index;
+extern int shard_count;
+extern char resume_file[STRING_SIZE];
+extern struct sp_thread_sweep thread_sweep;
+extern double straggler_threshold;
 extern int papi_nevents;
 extern int stride_kernel;
 extern int atomic_flag;
@@ -70,6 +139,54 @@ extern char papi_event_names[PAPI_MAX_COUNTERS][STRING_SIZE];
 int papi_event_codes[PAPI_MAX_COUNTERS];
 long long papi_event_values[PAPI_MAX_COUNTERS];
 extern const char* const papi_ctr_str[];
+static struct papi_sets papi_sets;
+
+// Derived metrics of the --papi events. Each uses the first of its events
+// that is in the list (native names may carry a PMU prefix), mlp divides
+// its first event by its second.
+struct papi_metric {
+    const char *col;
+    const char *events[5];
+    const char *div;
+};
+static const struct papi_metric papi_metrics[] = {
+    { "l1_miss/elem",  { "PAPI_L1_DCM", "L1D:REPLACEMENT", NULL }, NULL },
+    { "l2_miss/elem",  { "PAPI_L2_DCM", "PAPI_L2_TCM", "L2_RQSTS:MISS", NULL }, NULL },
+    { "llc_miss/elem", { "PAPI_L3_TCM", "PAPI_L3_DCM", "LLC_MISSES", "LONGEST_LAT_CACHE:MISS", NULL }, NULL },
+    { "dtlb/page",     { "PAPI_TLB_DM", "DTLB_LOAD_MISSES:MISS_CAUSES_A_WALK", "DTLB_LOAD_MISSES:WALK_COMPLETED", NULL }, NULL },
+    { "mlp",           { "L1D_PEND_MISS:PENDING", NULL }, "L1D_PEND_MISS:PENDING_CYCLES" },
+    { "ld_sect/req",   { "l1tex__t_sectors_pipe_lsu_mem_global_op_ld.sum", NULL }, "l1tex__t_requests_pipe_lsu_mem_global_op_ld.sum" },
+    { "st_sect/req",   { "l1tex__t_sectors_pipe_lsu_mem_global_op_st.sum", NULL }, "l1tex__t_requests_pipe_lsu_mem_global_op_st.sum" },
+};
+#define PAPI_NMETRICS (sizeof(papi_metrics) / sizeof(papi_metrics[0]))
+#define PAPI_METRIC_DTLB 3
+
+// The event may carry a PMU prefix, and a CUDA metric its device, as in
+// cuda:::<metric>:device=0
+static int papi_event_index(const char *event) {
+    size_t len = strlen(event);
+    for (int i = 0; i < papi_nevents; i++) {
+        const char *name = papi_event_names[i];
+        for (const char *p = strstr(name, event); p; p = strstr(p + 1, event))
+            if ((p == name || p[-1] == ':') && (p[len] == '\0' || !strncmp(p + len, ":device=", 8)))
+                return i;
+    }
+    return -1;
+}
+
+// Index of the event metric m reads, -1 if the list has none of them
+static int papi_metric_event(const struct papi_metric *m) {
+    for (int j = 0; m->events[j]; j++) {
+        int i = papi_event_index(m->events[j]);
+        if (i >= 0)
+            return i;
+    }
+    return -1;
+}
+
+static int papi_metric_available(const struct papi_metric *m) {
+    return papi_metric_event(m) >= 0 && (!m->div || papi_event_index(m->div) >= 0);
+}
 #endif
 
 void print_papi_names() {
@@ -97,30 +214,492 @@ void print_system_info(){
 
     if(backend == OPENMP) printf("OPENMP\n");
     if(backend == OPENCL) printf("OPENCL\n");
+#ifdef USE_HIP
+    if(backend == CUDA) printf("HIP\n");
+#else
     if(backend == CUDA) printf("CUDA\n");
+#endif
 
 
     printf("Aggregate Results? %s\n", aggregate_flag ? "YES" : "NO");
+    if (backend == OPENMP) {
+        printf("SIMD: %s\n", sg_simd_name(simd_isa));
+#ifdef USE_OPENMP
+        if (sp_sched_get() == SCHED_STATIC)
+            printf("Schedule: static\n");
+        else
+            printf("Schedule: %s, chunk %zu\n", sp_sched_name(sp_sched_get()), sp_sched_chunk());
+#endif
+    }
+    printf("Allocator: %s\n", sp_pool_name(sp_get_data_pool()));
+    for (int p = 0; p < SP_NPOOLS; p++) {
+        if (get_pool_mem_used((enum sp_pool)p) > 0) {
+            printf("  %s pool: %.1f MB\n", sp_pool_name((enum sp_pool)p), get_pool_mem_used((enum sp_pool)p) / 1e6);
+        }
+    }
+#ifdef USE_OPENCL
+    if (backend == OPENCL) {
+        char name[STRING_SIZE];
+        clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL);
+        printf("Device: %s\n", name);
+    }
+#endif
 #ifdef USE_CUDA
     if (backend == CUDA) {
         struct cudaDeviceProp prop;
         cudaGetDeviceProperties(&prop, cuda_dev);
         printf("Device: %s\n", prop.name);
+        for (int d = 1; d < cuda_ndevs; d++) {
+            cudaGetDeviceProperties(&prop, cuda_devs[d]);
+            printf("Device: %s\n", prop.name);
+        }
+        if (cuda_ndevs > 1 || cuda_streams > 1)
+            printf("Devices: %d, streams per device: %d\n", cuda_ndevs, cuda_streams);
+    }
+#endif
+#ifdef USE_MPI
+    int nranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    printf("MPI Ranks: %d\n", nranks);
+    if (rma_mode != RMA_NONE) {
+        const char *rma_names[] = {"none", "element", "gather", "aggregate"};
+        printf("RMA: %s, batch %zu\n", rma_names[rma_mode], rma_batch);
     }
 #endif
+    if (dsa_wq[0])
+        printf("DSA: %s, %zu submitting thread%s\n", dsa_wq, dsa_submitters, dsa_submitters > 1 ? "s" : "");
     print_papi_names();
 
     printf("\n");
 }
 
+/** The host and device of the run, for --output and --serve. The device
+ *  is the GPU or OpenCL device, or the CPU model from /proc/cpuinfo.
+ */
+static struct sp_output_meta output_meta(int mpi_ranks) {
+    static char device[STRING_SIZE] = "unknown";
+    const char *name = "OPENMP";
+    if (backend == OPENCL) name = "OPENCL";
+#ifdef USE_HIP
+    if (backend == CUDA) name = "HIP";
+#else
+    if (backend == CUDA) name = "CUDA";
+#endif
+    if (backend == SERIAL) name = "SERIAL";
+
+#ifdef USE_OPENCL
+    if (backend == OPENCL)
+        clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(device), device, NULL);
+#endif
+#ifdef USE_CUDA
+    if (backend == CUDA) {
+        struct cudaDeviceProp prop;
+        cudaGetDeviceProperties(&prop, cuda_dev);
+        snprintf(device, sizeof(device), "%s", prop.name);
+    }
+#endif
+    if (backend == OPENMP || backend == SERIAL) {
+        FILE *fp = fopen("/proc/cpuinfo", "r");
+        char line[STRING_SIZE];
+        while (fp && fgets(line, sizeof(line), fp)) {
+            char *colon = strchr(line, ':');
+            if (!strncmp(line, "model name", 10) && colon) {
+                line[strcspn(line, "\n")] = '\0';
+                snprintf(device, sizeof(device), "%s", colon + 2);
+                break;
+            }
+        }
+        if (fp)
+            fclose(fp);
+    }
+
+    struct sp_output_meta meta = {SPATTER_VERSION, xstr(SPAT_C_NAME) " " xstr(SPAT_C_VER), name, device,
+        backend == OPENMP ? sg_simd_name(simd_isa) : "none", mpi_ranks, 0, NULL};
+#ifdef USE_PAPI
+    static const char *events[PAPI_MAX_COUNTERS];
+    for (int e = 0; e < papi_nevents; e++)
+        events[e] = papi_event_names[e];
+    meta.npapi = papi_nevents;
+    meta.papi_events = events;
+#endif
+    return meta;
+}
+
+/** Open the --output file and write the host and device of the run. A
+ *  resumed job adds its records to the file it resumes. */
+static void open_output(int mpi_ranks) {
+    struct sp_output_meta meta = output_meta(mpi_ranks);
+    if (sp_output_open(output_format, output_file, resume_file[0] && !strcmp(resume_file, output_file), &meta))
+        error("Could not open the --output file", ERROR);
+}
+
+/** Free what parsing allocated for a config */
+static void free_config(struct run_config *rc) {
+    if (rc->pattern && !rc->pattern_mapped) free(rc->pattern);
+    if (rc->deltas) free(rc->deltas);
+    if (rc->deltas_ps) free(rc->deltas_ps);
+    if (rc->ro_order) free(rc->ro_order);
+    free(rc->pattern_narrow);
+    free(rc->pattern_gather_narrow);
+    free(rc->pattern_scatter_narrow);
+    if (rc->inner_stream) sp_free(rc->inner_stream);
+    if (rc->random_bases) sp_free(rc->random_bases);
+}
+
+/** Keep the configs of this --shard that the --resume file has no record
+ *  of, in suite order, and set suite_idx to their index in the suite.
+ *  Returns how many are left. */
+static int select_configs(struct run_config *rc, int nrc, int *suite_idx) {
+    char *keep = (char*)malloc(nrc);
+    memset(keep, 1, nrc);
+    if (shard_count > 0)
+        sp_shard_select(rc, nrc, shard_index, shard_count, keep);
+    int ndone = 0;
+    if (resume_file[0]) {
+        if (sp_resume_load(resume_file) < 0)
+            error("Could not read the --resume file", ERROR);
+        for (int k = 0; k < nrc; k++)
+            if (keep[k] && sp_resume_done(&rc[k])) {
+                keep[k] = 0;
+                ndone++;
+            }
+        sp_resume_free();
+    }
+
+    int n = 0;
+    for (int k = 0; k < nrc; k++) {
+        if (!keep[k]) {
+            free_config(&rc[k]);
+            continue;
+        }
+        if (n != k)
+            rc[n] = rc[k];
+        suite_idx[n++] = k;
+    }
+    free(keep);
+    if (quiet_flag < 1 && shard_count > 0)
+        printf("Shard %d of %d: %d configs\n", shard_index, shard_count, n + ndone);
+    if (quiet_flag < 1 && resume_file[0])
+        printf("Resuming from %s: %d configs done, %d left\n", resume_file, ndone, n);
+    return n;
+}
+
+static void print_placement(const char *what, void *ptr, size_t size) {
+    size_t counts[SP_MAX_NUMA_NODES];
+    size_t total = sp_numa_page_nodes(ptr, size, counts);
+    printf("%s pages:", what);
+    for (int n = 0; n < sp_numa_num_nodes(); n++) {
+        printf(" node%d %.1f%%", n, total ? 100. * counts[n] / total : 0.);
+    }
+    printf("\n");
+}
+
+void print_numa_info(sgDataBuf *source, sgDataBuf *target, sgData_t **replicas) {
+    const char *mode[] = {"DEFAULT", "FIRSTTOUCH", "INTERLEAVE", "REPLICATE"};
+    printf("NUMA: %s, %d node(s)\n", mode[numa_mode], sp_numa_num_nodes());
+    if (numa_mode == NUMA_DEFAULT && !source_tier.n && !target_tier.n) {
+        return;
+    }
+    if (replicas) {
+        for (int n = 0; n < sp_numa_num_nodes(); n++) {
+            char what[STRING_SIZE];
+            snprintf(what, STRING_SIZE, "Source replica %d", n);
+            print_placement(what, replicas[n], source->size);
+        }
+    } else {
+        print_placement("Source", source->host_ptr, source->size);
+    }
+    for (size_t t = 0; t < target->nptrs; t++) {
+        char what[STRING_SIZE];
+        snprintf(what, STRING_SIZE, "Target %zu", t);
+        print_placement(what, target->host_ptrs[t], target->size);
+    }
+    printf("\n");
+}
+
+#ifdef USE_OPENMP
+// --compose only replaces the plain MultiGather and MultiScatter kernels
+static int composable(const struct run_config *rc) {
+    return (rc->kernel == MULTIGATHER || rc->kernel == MULTISCATTER) && rc->op == OP_COPY &&
+        !rc->inner_stream && rc->random_seed < 1 && !rc->ro_morton && !rc->ro_hilbert &&
+        rc->deltas_len <= 1 && rc->index_bits != 16 && rc->index_bits != 32;
+}
+
+/** --compose: the inner pattern of a Multi kernel is the same for every
+ *  Gather or Scatter, so outer[inner[j]] can be composed once and run by
+ *  the single-level kernel. Returns the best of nruns timed runs after a
+ *  warm-up run.
+ */
+static double run_composed(struct run_config *rc, sgDataBuf *source, sgDataBuf *target) {
+    size_t len = rc->kernel == MULTIGATHER ? rc->pattern_gather_len : rc->pattern_scatter_len;
+    ssize_t *inner = rc->kernel == MULTIGATHER ? rc->pattern_gather : rc->pattern_scatter;
+    ssize_t *pat = (ssize_t*) sp_malloc(sizeof(ssize_t), len, ALIGN_CACHE);
+    for (size_t j = 0; j < len; j++)
+        pat[j] = rc->pattern[inner[j]];
+
+    double best_ms = 0;
+    for (int i = -1; i < (int)rc->nruns; i++) {
+        sg_zero_time();
+        if (rc->kernel == MULTIGATHER)
+            gather_smallbuf(target->host_ptrs, source->host_ptr, pat, len, rc->delta, rc->generic_len, rc->wrap);
+        else
+            scatter_smallbuf(source->host_ptr, target->host_ptrs, pat, len, rc->delta, rc->generic_len, rc->wrap);
+        double ms = sg_get_time_ms();
+        if (i == 0 || (i > 0 && ms < best_ms))
+            best_ms = ms;
+    }
+    sp_free(pat);
+    return best_ms;
+}
+
+/** --co-run: run all configs at the same time. Config k runs on its own
+ *  nested team of omp_threads threads under the k-th thread of an outer
+ *  team, with its own source and targets, filled by that team. A team that
+ *  is done with its nruns timed runs keeps running untimed until all teams
+ *  are done, so that every timed run sees the load of all the others.
+ *  Stores the best time of each config in best_ms, 0 if it did not run.
+ */
+static void co_run(struct run_config *rc, int nrc, const size_t *source_size, const size_t *target_size, double *best_ms) {
+    sgDataBuf *src = (sgDataBuf*)calloc(nrc, sizeof(sgDataBuf));
+    sgDataBuf *tgt = (sgDataBuf*)calloc(nrc, sizeof(sgDataBuf));
+    for (int k = 0; k < nrc; k++) {
+        src[k].size = src[k].capacity = source_size[k];
+        src[k].len = source_size[k] / sizeof(sgData_t);
+        src[k].host_ptr = (sgData_t*) sp_data_malloc(src[k].size, 1, ALIGN_CACHE);
+
+        tgt[k].size = tgt[k].capacity = target_size[k];
+        tgt[k].len = target_size[k] / sizeof(sgData_t);
+        tgt[k].nptrs = rc[k].omp_threads;
+        tgt[k].host_ptrs = (sgData_t**) sp_malloc(sizeof(sgData_t*), tgt[k].nptrs, ALIGN_CACHE);
+        for (size_t t = 0; t < tgt[k].nptrs; t++)
+            tgt[k].host_ptrs[t] = (sgData_t*) sp_data_malloc(tgt[k].size, 1, ALIGN_PAGE);
+        tgt[k].host_ptr = tgt[k].host_ptrs[0];
+        best_ms[k] = 0;
+    }
+
+    int levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+    int done = 0;
+    #pragma omp parallel num_threads(nrc) proc_bind(spread)
+    {
+        int k = omp_get_thread_num();
+        int teams = omp_get_num_threads();
+        omp_set_num_threads(rc[k].omp_threads);
+        sp_fill_source(&src[k], rc[k].omp_threads);
+        sp_fill_targets(&tgt[k]);
+        struct sp_chase chase = {0};
+        if (rc[k].kernel == CHASE)
+            sp_chase_prepare(&chase, src[k].host_ptr, &rc[k], (int)rc[k].omp_threads);
+
+        #pragma omp barrier
+        int nruns = (int)rc[k].nruns;
+        for (int i = -1; ; i++) {
+            int all_done;
+            #pragma omp atomic read
+            all_done = done;
+            if (i >= nruns && all_done == teams)
+                break;
+
+            double t0 = omp_get_wtime();
+            sp_run_omp_kernel(&rc[k], &src[k], &tgt[k], NULL, &chase);
+            double ms = (omp_get_wtime() - t0) * 1000.;
+            if (i >= 0 && i < nruns && (i == 0 || ms < best_ms[k]))
+                best_ms[k] = ms;
+            if (i == nruns - 1) {
+                #pragma omp atomic
+                done++;
+            }
+        }
+
+        if (rc[k].kernel == CHASE)
+            sp_chase_release(&chase);
+    }
+    omp_set_max_active_levels(levels);
+
+    for (int k = 0; k < nrc; k++) {
+        sp_free(src[k].host_ptr);
+        for (size_t t = 0; t < tgt[k].nptrs; t++)
+            sp_free(tgt[k].host_ptrs[t]);
+        free(tgt[k].host_ptrs);
+    }
+    free(src);
+    free(tgt);
+}
+#endif
+
+#if defined( USE_OPENMP ) || defined( USE_SERIAL )
+// Most repetitions of one timed run with --min-sample
+#define SP_MAX_INNER_REPS ((size_t)1 << 24)
+
+#ifdef USE_OPENMP
+// Plain Gather and Scatter copies on the default kernels have a variant that
+// keeps one parallel region for all the repetitions of a run
+static int persistent_reps(const struct run_config *rc, const sgDataBuf *source) {
+    return backend == OPENMP && (rc->kernel == GATHER || rc->kernel == SCATTER) && rc->type != TRACE &&
+        rc->op == OP_COPY && rc->random_seed < 1 && !rc->ro_morton && !rc->ro_hilbert && rc->deltas_len <= 1 &&
+        rc->elem == ELEM_F64 && rc->index_bits != 16 && rc->index_bits != 32 && rc->prefetch_distance == 0 &&
+        rc->store == STORE_PLAIN && !source->host_ptrs && simd_isa == SIMD_SCALAR &&
+        sched_kind == SCHED_STATIC && !busy_flag;
+}
+#endif
+
+// One timed run of rc with --min-sample, rc->inner_reps repetitions of run
+static void run_reps(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase) {
+#ifdef USE_OPENMP
+    if (persistent_reps(rc, source)) {
+        if (rc->kernel == GATHER)
+            gather_smallbuf_reps(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->inner_reps);
+        else
+            scatter_smallbuf_reps(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->inner_reps);
+        return;
+    }
+#endif
+    for (size_t r = 0; r < rc->inner_reps; r++)
+        run(rc, source, target, trace, chase);
+}
+
+/** --min-sample: the repetitions that make one timed run of rc last at
+ *  least min_sample_ms, net of the timer overhead. The count grows
+ *  towards the estimate from the last run, at least doubling and at most
+ *  tenfold, so the first runs also warm the caches. With MPI all ranks use
+ *  the largest count.
+ */
+static size_t calibrate_reps(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_chase *chase) {
+    double overhead = sg_timer_overhead_ms();
+    size_t reps = 1;
+    for (;;) {
+        rc->inner_reps = reps;
+        sg_zero_time();
+        run_reps(run, rc, source, target, NULL, chase);
+        double ms = sg_get_time_ms() - overhead;
+        if (ms >= min_sample_ms || reps >= SP_MAX_INNER_REPS)
+            break;
+        size_t next = ms > 0 ? (size_t)(reps * min_sample_ms * 1.2 / ms) + 1 : 10 * reps;
+        if (next < 2 * reps)
+            next = 2 * reps;
+        if (next > 10 * reps)
+            next = 10 * reps;
+        reps = next < SP_MAX_INNER_REPS ? next : SP_MAX_INNER_REPS;
+    }
+#ifdef USE_MPI
+    unsigned long most = reps;
+    MPI_Allreduce(MPI_IN_PLACE, &most, 1, MPI_UNSIGNED_LONG, MPI_MAX, MPI_COMM_WORLD);
+    reps = most;
+#endif
+    return reps;
+}
+
+// The time of one repetition of the run that was just timed
+static double run_time_ms(const struct run_config *rc) {
+    double ms = sg_get_time_ms();
+    if (rc->inner_reps > 0)
+        ms = (ms - sg_timer_overhead_ms()) / rc->inner_reps;
+    return ms;
+}
+
+/** --cache: evict the caches before a timed run, or flush the source,
+ *  targets and patterns of rc, source_size and target_size bytes of each
+ *  buffer
+ */
+static void clear_caches(const struct run_config *rc, sgDataBuf *source, sgDataBuf *target, size_t source_size, size_t target_size) {
+    if (cache_mode == CACHE_COLD) {
+        sp_evict();
+        return;
+    }
+    size_t nt = rc->omp_threads < target->nptrs ? rc->omp_threads : target->nptrs;
+    if (nt == 0)
+        nt = 1;
+    sp_flush_range(source->host_ptr, source_size);
+    for (size_t t = 0; t < nt; t++) {
+        if (source->host_ptrs)
+            sp_flush_range(source->host_ptrs[t], source_size);
+        sp_flush_range(target->host_ptrs[t], target_size);
+    }
+    sp_flush_range(rc->pattern, rc->pattern_len * sizeof(ssize_t));
+    sp_flush_range(rc->pattern_gather, rc->pattern_gather_len * sizeof(ssize_t));
+    sp_flush_range(rc->pattern_scatter, rc->pattern_scatter_len * sizeof(ssize_t));
+}
+
+// --cache: the best of nruns back-to-back runs of rc after the cold ones,
+// with the caches left warm by the previous run
+static double run_warm(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase) {
+    double best_ms = 0;
+    for (int i = -1; i < (int)rc->nruns; i++) {
+        if (trace) sp_trace_rewind(trace);
+        sg_zero_time();
+        run(rc, source, target, trace, chase);
+        double ms = sg_get_time_ms();
+        if (i == 0 || (i > 0 && ms < best_ms))
+            best_ms = ms;
+    }
+    return best_ms;
+}
+
+#ifdef USE_OPENMP
+// --thread-sweep: the bandwidth of the best warm run of rc at each count of
+// the sweep, on the first threads of its team, then the whole team again
+static void run_thread_sweep(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase, double *mbs) {
+    size_t team = rc->omp_threads;
+    double bytes = sp_config_bytes(rc);
+    for (int s = 0; s < thread_sweep.n; s++) {
+        rc->omp_threads = thread_sweep.threads[s];
+        omp_set_num_threads(rc->omp_threads);
+        sp_pin_team(thread_sweep.policy, rc->omp_threads);
+        double ms = run_warm(run, rc, source, target, trace, chase);
+        mbs[s] = ms > 0 ? bytes / ms / 1000. : 0;
+    }
+    rc->omp_threads = team;
+    omp_set_num_threads(team);
+}
+#endif
+#endif
+
+#ifdef USE_PAPI
+// Uncore memory controller CAS counters count one cache line per event
+// Bytes per count of a DRAM event: a CAS moves a 64-byte line, the CUDA
+// component's dram__bytes metrics count bytes. 0 for other events.
+static long long dram_event_bytes(const char *name) {
+    if (strstr(name, "CAS_COUNT"))
+        return 64;
+    if (strstr(name, "dram__bytes"))
+        return 1;
+    return 0;
+}
+#endif
+
+static int have_dram_events() {
+#ifdef USE_PAPI
+    for (int i = 0; i < papi_nevents; i++)
+        if (dram_event_bytes(papi_event_names[i]))
+            return 1;
+#endif
+    return 0;
+}
+
 void print_header(){
     //printf("kernel op time source_size target_size idx_len bytes_moved actual_bandwidth omp_threads vector_len block_dim shmem\n");
     printf("%-7s %-12s %-12s %-12s", "config", "bytes", "time(s)","bw(MB/s)");
+    if (analyze_flag)
+        printf(" %-9s %-9s %-10s %-9s %-7s %-10s", "lines", "sectors", "warp_lines", "pages", "reuse", "efficiency");
+    if (traffic_flag) {
+        printf(" %-12s %-12s %-13s", "idx_bytes", "line_bytes", "line_bw(MB/s)");
+        if (have_dram_events())
+            printf(" %-12s %-13s", "dram_bytes", "dram_bw(MB/s)");
+    }
+    if (energy_flag) {
+        for (int d = 0; d < SP_ENERGY_DOMAINS; d++)
+            if (sp_energy_available((enum sp_energy_domain)d))
+                printf(" %-12s", sp_energy_name((enum sp_energy_domain)d));
+        printf(" %-12s", "GB/s/W");
+    }
 
 #ifdef USE_PAPI
     for (int i = 0; i < papi_nevents; i++) {
         printf(" %-12s", papi_ctr_str[i]);
     }
+    for (size_t m = 0; m < PAPI_NMETRICS; m++)
+        if (papi_metric_available(&papi_metrics[m]))
+            printf(" %-13s", papi_metrics[m].col);
 #endif
     printf("\n");
 
@@ -134,30 +713,54 @@ int compare (const void * a, const void * b)
 }
 
 /** Time reported in seconds, sizes reported in bytes, bandwidth reported in mib/s"
+ *  tr is the traffic model of the config, only used with --traffic
+ *  ps is the pattern analysis of the config, only used with --analyze
  */
-double report_time(int ii, double time,  struct run_config rc, int idx){
+double report_time(int ii, double time,  struct run_config rc, int idx, const struct sp_traffic *tr, const struct sp_pattern_stats *ps){
     if (time == 0.0) {
         error("Time is zero", ERROR);
     }
-    size_t bytes_moved = 0;
-    double actual_bandwidth = 0;
-
-    if (rc.kernel == GS) {
-        bytes_moved = sizeof(sgData_t) * (rc.pattern_scatter_len + rc.pattern_gather_len) * rc.generic_len;
-        actual_bandwidth = bytes_moved / time / 1000. / 1000.;
+    size_t bytes_moved = sp_config_bytes(&rc);
+    double actual_bandwidth = bytes_moved / time / 1000. / 1000.;
+    printf("%-7d %-12zu %-12.4g %-12f", ii, bytes_moved, time, actual_bandwidth);
+    if (analyze_flag)
+        printf(" %-9.4g %-9.4g %-10.4g %-9.4g %-7.3f %-10.3f", ps->lines, ps->sectors, ps->warp_lines, ps->pages, ps->reuse, ps->efficiency);
+    if (traffic_flag) {
+        size_t est = tr->lines + tr->index;
+        printf(" %-12zu %-12zu %-13f", tr->index, est, est / time / 1000. / 1000.);
+#ifdef USE_PAPI
+        if (have_dram_events()) {
+            long long dram = 0;
+            for (int i = 0; i < papi_nevents; i++)
+                dram += rc.papi_ctr[idx][i] * dram_event_bytes(papi_event_names[i]);
+            printf(" %-12lld %-13f", dram, dram / time / 1000. / 1000.);
+        }
+#endif
     }
-    else {
-        bytes_moved = sizeof(sgData_t) * rc.pattern_len * rc.generic_len;
-        actual_bandwidth = bytes_moved / time / 1000. / 1000.;
+    if (energy_flag) {
+        // Bytes per joule is bandwidth per watt
+        const struct sp_energy *e = &rc.energy[idx];
+        for (int d = 0; d < SP_ENERGY_DOMAINS; d++)
+            if (sp_energy_available((enum sp_energy_domain)d))
+                printf(" %-12.4g", e->joules[d]);
+        double joules = sp_energy_total(e);
+        printf(" %-12.4g", joules > 0 ? bytes_moved / joules / 1e9 : 0.);
     }
-    printf("%-7d %-12zu %-12.4g %-12f", ii, bytes_moved, time, actual_bandwidth);
 #ifdef USE_PAPI
     for (int i = 0; i < papi_nevents; i++) {
         printf(" %-12lld", rc.papi_ctr[idx][i]);
     }
-#else
-    idx=0;
-    UNUSED_VAR(idx);
+    // Per gathered or scattered element, per page of the sparse buffer
+    double elems = (double)bytes_moved / (rc.kernel == GS ? sizeof(sgData_t) : sp_elem_size(&rc));
+    for (size_t m = 0; m < PAPI_NMETRICS; m++) {
+        const struct papi_metric *pm = &papi_metrics[m];
+        if (!papi_metric_available(pm))
+            continue;
+        double v = rc.papi_ctr[idx][papi_metric_event(pm)];
+        double per = pm->div ? rc.papi_ctr[idx][papi_event_index(pm->div)] :
+            m == PAPI_METRIC_DTLB ? tr->pages : elems;
+        printf(" %-13.4g", per > 0 ? v / per : 0.);
+    }
 #endif
     printf("\n");
     return actual_bandwidth;
@@ -168,6 +771,17 @@ void report_time2(struct run_config* rc, int nrc) {
     double *bw = (double*)malloc(sizeof(double)*nrc);
     assert(bw);
     for (int k = 0; k < nrc; k++) {
+        struct sp_traffic tr = {0};
+        if (traffic_flag)
+            sp_traffic_model(&rc[k], &tr);
+        struct sp_pattern_stats ps = {0};
+        if (analyze_flag)
+            sp_pattern_analyze(&rc[k], &ps);
+#ifdef USE_PAPI
+        if (papi_metric_available(&papi_metrics[PAPI_METRIC_DTLB]))
+            tr.pages = sp_traffic_pages(&rc[k], (size_t)sysconf(_SC_PAGESIZE));
+#endif
+
         if (aggregate_flag) {
             double min_time_ms = rc[k].time_ms[0];
             int min_idx = 0;
@@ -177,11 +791,11 @@ void report_time2(struct run_config* rc, int nrc) {
                     min_idx = i;
                 }
             }
-            bw[k] = report_time(k, min_time_ms/1000., rc[k], min_idx);
+            bw[k] = report_time(k, min_time_ms/1000., rc[k], min_idx, &tr, &ps);
         }
         else {
             for (int i = 0; i < rc[k].nruns; i++) {
-                report_time(k, rc[k].time_ms[i]/1000., rc[k], i);
+                report_time(k, rc[k].time_ms[i]/1000., rc[k], i, &tr, &ps);
             }
         }
     }
@@ -241,10 +855,493 @@ void report_time2(struct run_config* rc, int nrc) {
         printf("%.3lf\t%.3lf\n", hmean, stddev);
         */
     }
+    if (sp_measure_adaptive()) {
+        printf("\n%-7s %-7s %-7s %-12s %-12s %-10s %-8s\n", "config", "runs", "warmup", "median(s)", "bw_med(MB/s)", "ci95(%)", "outliers");
+        for (int k = 0; k < nrc; k++) {
+            struct sp_run_stats st;
+            sp_run_stats(rc[k].time_ms, rc[k].nruns, &st);
+            double med = st.median_ms / 1000.;
+            printf("%-7d %-7zu %-7zu %-12.4g %-12f %-10.3f %-8d\n", k, rc[k].nruns, rc[k].warmup_runs, med,
+                    med > 0 ? sp_config_bytes(&rc[k]) / med / 1000. / 1000. : 0, st.ci * 100, st.outliers);
+        }
+    }
     free(bw);
 
 }
 
+/** Latency of the CHASE configs in their best run. Each chain does
+ *  generic_len / (threads * chains) dependent Gathers, one after the other,
+ *  so ns/access is the load-to-load latency seen by one chain. With more
+ *  chains the accesses overlap, and the drop in ns/access shows the
+ *  memory-level parallelism.
+ */
+void report_chase(struct run_config *rc, int nrc) {
+    int any = 0;
+    for (int k = 0; k < nrc; k++)
+        if (rc[k].kernel == CHASE)
+            any = 1;
+    if (!any)
+        return;
+
+    printf("\n%-7s %-7s %-7s %-12s %-12s\n", "config", "threads", "chains", "hops", "ns/access");
+    for (int k = 0; k < nrc; k++) {
+        if (rc[k].kernel != CHASE || rc[k].nruns == 0)
+            continue;
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        size_t threads = backend == OPENMP ? rc[k].omp_threads : 1;
+        double hops = (double)rc[k].generic_len / (threads * rc[k].chains);
+        printf("%-7d %-7zu %-7zu %-12.0f %-12.3f\n", k, threads, rc[k].chains, hops, best_ms * 1e6 / hops);
+    }
+}
+
+/** Reuse profile of each config (--analyze-reuse): the miss ratio its
+ *  reuse distances predict at each level, the LLC shared by the threads of
+ *  the config, then the histogram of the distances, in cache lines, where
+ *  the fraction of the references is not 0.
+ */
+void report_reuse(struct run_config *rc, int nrc, struct sp_reuse *reuse) {
+    // The LLC is shared, each config gets the share of its threads
+    printf("\nReuse profile, %zu-line L1, %zu-line L2, %zu-page TLB\n", sp_reuse_capacity(REUSE_L1, 1),
+            sp_reuse_capacity(REUSE_L2, 1), sp_reuse_capacity(REUSE_TLB, 1));
+    printf("%-7s %-12s %-9s %-9s %-9s %-12s %-9s %-9s\n", "config", "refs", "rate", "L1 miss", "L2 miss", "LLC lines", "LLC miss", "TLB miss");
+    for (int k = 0; k < nrc; k++) {
+        struct sp_reuse *r = &reuse[k];
+        if (r->refs == 0) {
+            printf("%-7d %-12s\n", k, "-");
+            continue;
+        }
+        printf("%-7d %-12.0f %-9.4g %-9.4f %-9.4f %-12zu %-9.4f %-9.4f\n", k, r->refs, r->rate,
+                r->miss[REUSE_L1], r->miss[REUSE_L2], sp_reuse_capacity(REUSE_LLC, rc[k].omp_threads),
+                r->miss[REUSE_LLC], r->miss[REUSE_TLB]);
+    }
+    printf("\n%-7s %s\n", "config", "reuse distance(lines):fraction");
+    for (int k = 0; k < nrc; k++) {
+        struct sp_reuse *r = &reuse[k];
+        if (r->refs == 0)
+            continue;
+        printf("%-7d", k);
+        for (int b = 0; b < SP_REUSE_BINS; b++) {
+            if (r->hist[b] < 0.0005)
+                continue;
+            if (b == 0 || b == 1)
+                printf(" %d:%.3f", b, r->hist[b]);
+            else if (b == SP_REUSE_BINS - 1)
+                printf(" %zu+:%.3f", (size_t)1 << (b - 1), r->hist[b]);
+            else
+                printf(" %zu-%zu:%.3f", (size_t)1 << (b - 1), ((size_t)1 << b) - 1, r->hist[b]);
+        }
+        if (r->cold >= 0.0005)
+            printf(" cold:%.3f", r->cold);
+        printf("\n");
+    }
+}
+
+#ifdef USE_OPENMP
+/** Bandwidth of each config alone, in its best run above, and in its best
+ *  run of --co-run with all the others. The ratio is the share of its
+ *  standalone bandwidth a config keeps under contention.
+ */
+void report_corun(struct run_config *rc, int nrc, double *corun_ms) {
+    printf("\n%-7s %-7s %-14s %-14s %-7s\n", "config", "threads", "alone(MB/s)", "co-run(MB/s)", "ratio");
+    double total = 0;
+    for (int k = 0; k < nrc; k++) {
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bytes = sp_config_bytes(&rc[k]);
+        double alone = best_ms > 0 ? bytes / best_ms / 1000. : 0;
+        double co = corun_ms[k] > 0 ? bytes / corun_ms[k] / 1000. : 0;
+        total += co;
+        printf("%-7d %-7zu %-14f %-14f %-7.3f\n", k, rc[k].omp_threads, alone, co, alone > 0 ? co / alone : 0);
+    }
+    printf("%-7s %-7s %-14s %-14f\n", "all", "", "", total);
+}
+
+/** Bandwidth of each MultiGather or MultiScatter config with its nested
+ *  kernel, in its best run above, and with the composed pattern. The
+ *  ratio is composed over nested.
+ */
+void report_compose(struct run_config *rc, int nrc, double *compose_ms) {
+    printf("\n%-7s %-14s %-14s %-7s\n", "config", "nested(MB/s)", "composed(MB/s)", "ratio");
+    for (int k = 0; k < nrc; k++) {
+        if (compose_ms[k] <= 0)
+            continue;
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bytes = sp_config_bytes(&rc[k]);
+        double nested = best_ms > 0 ? bytes / best_ms / 1000. : 0;
+        double composed = bytes / compose_ms[k] / 1000.;
+        printf("%-7d %-14f %-14f %-7.3f\n", k, nested, composed, nested > 0 ? composed / nested : 0);
+    }
+}
+
+/** Bandwidth of each config at each thread count of --thread-sweep, and
+ *  the knee, the fewest threads within SP_KNEE_FRACTION of the best. The
+ *  bandwidth past the knee is what the memory system, not the cores, gives.
+ */
+void report_thread_sweep(struct run_config *rc, int nrc, double *sweep_mbs) {
+    printf("\nThread sweep (%s), bw(MB/s) by threads\n%-7s", thread_sweep.policy == PIN_SPREAD ? "spread" : "compact", "config");
+    for (int s = 0; s < thread_sweep.n; s++)
+        printf(" %-12zu", thread_sweep.threads[s]);
+    printf(" %-7s\n", "knee");
+    for (int k = 0; k < nrc; k++) {
+        double *mbs = &sweep_mbs[k * thread_sweep.n];
+        printf("%-7d", k);
+        for (int s = 0; s < thread_sweep.n; s++)
+            printf(" %-12f", mbs[s]);
+        printf(" %-7zu\n", thread_sweep.threads[sp_thread_sweep_knee(mbs, thread_sweep.n)]);
+    }
+}
+
+/** Paced Gathers of each config (--rate). The achieved rate is over all
+ *  threads and timed runs, it falls short of the target times the threads
+ *  once a Gather takes longer than the interval. The percentiles are of the
+ *  time of a single Gather, from the histogram of every thread.
+ */
+void report_rate(struct run_config *rc, int nrc, struct sp_hist *hist) {
+    double tick = sg_tick_ns();
+    printf("\n%-7s %-12s %-13s %-12s %-9s %-9s %-9s %-9s %-9s\n", "config", "target(M/s)", "achieved(M/s)", "bw(MB/s)",
+            "p50(ns)", "p90(ns)", "p99(ns)", "p99.9(ns)", "max(ns)");
+    for (int k = 0; k < nrc; k++) {
+        double total_ms = 0;
+        for (size_t i = 0; i < rc[k].nruns; i++)
+            total_ms += rc[k].time_ms[i];
+        double achieved = total_ms > 0 ? hist[k].n / total_ms / 1000. : 0;
+        double bw = total_ms > 0 ? sp_config_bytes(&rc[k]) * rc[k].nruns / total_ms / 1000. : 0;
+        printf("%-7d %-12g %-13.3f %-12.2f %-9.0f %-9.0f %-9.0f %-9.0f %-9.0f\n", k, rate_mgs * rc[k].omp_threads, achieved, bw,
+                sp_hist_quantile(&hist[k], 0.5) * tick, sp_hist_quantile(&hist[k], 0.9) * tick,
+                sp_hist_quantile(&hist[k], 0.99) * tick, sp_hist_quantile(&hist[k], 0.999) * tick, hist[k].max * tick);
+    }
+}
+#endif
+
+#if defined( USE_OPENMP ) || defined( USE_SERIAL )
+/** Repetitions of each config inside one timed run with --min-sample. The
+ *  times above are per repetition, net of the timer overhead printed here.
+ */
+void report_reps(struct run_config *rc, int nrc) {
+    printf("\n%-7s %-10s %-12s %-14s %-12s\n", "config", "reps", "rep time(s)", "sample time(s)", "overhead(s)");
+    for (int k = 0; k < nrc; k++) {
+        if (rc[k].inner_reps == 0)
+            continue;
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        printf("%-7d %-10zu %-12.4g %-14.4g %-12.4g\n", k, rc[k].inner_reps, best_ms / 1000.,
+            best_ms * rc[k].inner_reps / 1000., sg_timer_overhead_ms() / 1000.);
+    }
+}
+
+/** Result check of each config (--validate): the checksum of what its
+ *  check run wrote against the one computed from the source and the
+ *  pattern. Returns the number of configs that failed.
+ */
+int report_validate(struct run_config *rc, int nrc, struct sp_check *checks) {
+    int failed = 0;
+    printf("\n%-7s %-12s %-18s %-18s %s\n", "config", "count", "expected", "actual", "check");
+    for (int k = 0; k < nrc; k++) {
+        struct sp_check *c = &checks[k];
+        if (c->status == CHECK_SKIPPED) {
+            printf("%-7d %-12s %-18s %-18s skipped, %s\n", k, "-", "-", "-", c->why ? c->why : "not run on the CPU backends");
+            continue;
+        }
+        failed += c->status == CHECK_FAILED;
+        printf("%-7d %-12zu %016llx   %016llx   %s\n", k, c->count, (unsigned long long)c->expected,
+                (unsigned long long)c->actual, c->status == CHECK_PASSED ? "passed" : "FAILED");
+    }
+    if (failed)
+        printf("%d of %d configs failed validation\n", failed, nrc);
+    return failed;
+}
+
+/** Bandwidth of each config in its best cold run above (--cache) and in
+ *  its best warm run. The ratio is cold over warm.
+ */
+void report_cache(struct run_config *rc, int nrc, double *warm_ms) {
+    printf("\n%-7s %-14s %-14s %-7s\n", "config", "warm(MB/s)", cache_mode == CACHE_COLD ? "cold(MB/s)" : "flush(MB/s)", "ratio");
+    for (int k = 0; k < nrc; k++) {
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bytes = sp_config_bytes(&rc[k]);
+        double cold = best_ms > 0 ? bytes / best_ms / 1000. : 0;
+        double warm = warm_ms[k] > 0 ? bytes / warm_ms[k] / 1000. : 0;
+        printf("%-7d %-14f %-14f %-7.3f\n", k, warm, cold, warm > 0 ? cold / warm : 0);
+    }
+}
+
+/** Bandwidth of the --noise threads while each config ran, next to the
+ *  best bandwidth of the config under that load and the noise target.
+ */
+void report_noise(struct run_config *rc, int nrc, double *noise_gbs) {
+    printf("\n%-7s %-14s %-12s %-12s\n", "config", "bw(MB/s)", "noise(GB/s)", "target(GB/s)");
+    for (int k = 0; k < nrc; k++) {
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bw = best_ms > 0 ? sp_config_bytes(&rc[k]) / best_ms / 1000. : 0;
+        char target[32] = "max";
+        if (noise_spec.gbs > 0)
+            snprintf(target, sizeof(target), "%g", noise_spec.gbs);
+        printf("%-7d %-14f %-12.3f %-12s\n", k, bw, noise_gbs[k], target);
+    }
+}
+
+// The pages of buf in a map for sp_traffic_nodes, freed by the caller
+static struct sp_page_map page_map(void *buf, size_t size) {
+    struct sp_page_map m;
+    m.page = (size_t)sysconf(_SC_PAGESIZE);
+    m.offset = (uintptr_t)buf % m.page;
+    m.node = sp_numa_page_map(buf, size, &m.npages);
+    return m;
+}
+
+/** Bandwidth each NUMA node served in the best run of each config, from
+ *  the node of every sparse element (--tier). The nodes add up to the
+ *  bw(MB/s) column. TRACE configs, whose elements are not known up front,
+ *  are left out.
+ */
+void report_tier(struct run_config *rc, int nrc, sgDataBuf *source, sgDataBuf *target) {
+    struct sp_page_map src = page_map(source->host_ptr, source->size);
+    struct sp_page_map tgt = page_map(target->host_ptrs[0], target->size);
+    int nodes = sp_numa_num_nodes();
+
+    printf("\n%-7s %-14s", "config", "bw(MB/s)");
+    for (int n = 0; n < nodes; n++) {
+        char col[32];
+        snprintf(col, sizeof(col), "node%d(MB/s)", n);
+        printf(" %-14s", col);
+    }
+    printf("\n");
+    for (int k = 0; k < nrc; k++) {
+        if (rc[k].type == TRACE)
+            continue;
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bytes[SP_MAX_NUMA_NODES];
+        sp_traffic_nodes(&rc[k], &src, &tgt, bytes);
+        printf("%-7d %-14f", k, best_ms > 0 ? sp_config_bytes(&rc[k]) / best_ms / 1000. : 0);
+        for (int n = 0; n < nodes; n++)
+            printf(" %-14f", best_ms > 0 ? bytes[n] / best_ms / 1000. : 0);
+        printf("\n");
+    }
+    free((void*)src.node);
+    free((void*)tgt.node);
+}
+#endif
+
+/** Each config against its record in the --baseline file: the mean
+ *  bandwidth of both, the change and the half-width of its 95% CI.
+ *  Returns the number of regressions past the tolerance.
+ */
+int report_baseline(struct run_config *rc, int nrc) {
+    int regressions = 0;
+    printf("\n%-7s %-7s %-14s %-14s %-9s %-8s %s\n", "config", "match", "base(MB/s)", "now(MB/s)", "change", "ci", "verdict");
+    for (int k = 0; k < nrc; k++) {
+        struct sp_baseline_cmp cmp;
+        sp_baseline_compare(&rc[k], sp_config_bytes(&rc[k]), baseline_tolerance, &cmp);
+        if (!cmp.match) {
+            printf("%-7d %-7s\n", k, "none");
+            continue;
+        }
+        const char *verdict = cmp.regression ? "REGRESSION" : !cmp.significant ? "same" : cmp.change < 0 ? "slower" : "faster";
+        char change[32], ci[32];
+        snprintf(change, sizeof(change), "%+.2f%%", cmp.change * 100);
+        snprintf(ci, sizeof(ci), "%.2f%%", cmp.ci * 100);
+        printf("%-7d %-7s %-14f %-14f %-9s %-8s %s\n", k, cmp.match == 1 ? "config" : "name", cmp.base_mbs,
+            cmp.now_mbs, change, ci, verdict);
+        regressions += cmp.regression;
+    }
+    if (regressions)
+        printf("%d of %d configs are more than %g%% slower than the baseline\n", regressions, nrc, baseline_tolerance * 100);
+    return regressions;
+}
+
+#ifdef USE_CUDA
+/** Best time of each device with --devices/--streams. Each device ran
+ *  its share of the generic_len Gathers or Scatters, the aggregate is the
+ *  row printed by report_time2.
+ */
+void report_device_times(struct run_config *rc, int nrc, float *dev_time_ms) {
+    printf("\n%-7s %-7s %-12s %-12s %-12s\n", "config", "device", "bytes", "time(s)", "bw(MB/s)");
+    for (int k = 0; k < nrc; k++) {
+        for (int d = 0; d < cuda_ndevs; d++) {
+            size_t n = rc[k].generic_len * (d + 1) / cuda_ndevs - rc[k].generic_len * d / cuda_ndevs;
+            size_t bytes = sp_elem_size(&rc[k]) * rc[k].pattern_len * n;
+            double time = dev_time_ms[k * cuda_ndevs + d] / 1000.;
+            printf("%-7d %-7d %-12zu %-12.4g %-12f\n", k, cuda_devs[d], bytes, time, time > 0 ? bytes / time / 1000. / 1000. : 0);
+        }
+    }
+}
+
+/** Launch parameters --autotune picked for each config, with the best
+ *  bandwidth of the default launch during tuning and of the tuned launch
+ *  in the timed runs. Configs that can not be tuned are left out.
+ */
+void report_autotune(struct run_config *rc, int nrc, struct sp_cuda_tune *tune) {
+    printf("\n%-7s %-8s %-5s %-8s %-7s %-14s %-14s %-7s\n", "config", "threads", "wpt", "shmem", "cached", "default(MB/s)", "tuned(MB/s)", "speedup");
+    for (int k = 0; k < nrc; k++) {
+        if (!tune[k].tuned)
+            continue;
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        double bytes = sp_config_bytes(&rc[k]);
+        double def = tune[k].default_ms > 0 ? bytes / tune[k].default_ms / 1000. : 0;
+        double tuned = best_ms > 0 ? bytes / best_ms / 1000. : 0;
+        printf("%-7d %-8d %-5d %-8u %-7s %-14f %-14f %-7.3f\n", k, tune[k].launch.threads, tune[k].launch.wpt,
+                tune[k].launch.shmem, tune[k].cached ? "yes" : "no", def, tuned, def > 0 ? tuned / def : 0);
+    }
+}
+#endif
+
+#ifdef USE_OPENMP
+/** Per-thread stats of the OpenMP kernels with --busy-times, the mean over
+ *  the runs of each config (including the warm-up runs of --target-ci). A thread is busy from its first to its last
+ *  iteration range and then waits at the barrier for the slowest one. An
+ *  imbalance (slowest thread over the mean) near 1 with a low bandwidth
+ *  points at memory rather than at the schedule. Configs whose kernel does
+ *  not go through the scheduler (traces, CHASE) have no threads.
+ */
+void report_thread_stats(struct run_config *rc, int nrc, struct sp_thread_stats *stats, int *stats_nt, int max_threads) {
+    printf("\n%-7s %-7s %-12s %-12s %-12s %-12s %-10s %-7s\n", "config", "threads", "time(s)",
+            "busy_min(s)", "busy_avg(s)", "busy_max(s)", "imbalance", "slowest");
+    for (int k = 0; k < nrc; k++) {
+        struct sp_thread_stats *st = &stats[k * max_threads];
+        double time = 0;
+        for (int i = 0; i < rc[k].nruns; i++)
+            time += rc[k].time_ms[i] / 1000. / rc[k].nruns;
+        if (stats_nt[k] == 0) {
+            printf("%-7d %-7d %-12.4g %-12s %-12s %-12s %-10s %-7s\n", k, 0, time, "-", "-", "-", "-", "-");
+            continue;
+        }
+
+        int slowest = 0;
+        double min = st[0].busy_ms, max = st[0].busy_ms, avg = 0;
+        for (int t = 0; t < stats_nt[k]; t++) {
+            if (st[t].busy_ms < min)
+                min = st[t].busy_ms;
+            if (st[t].busy_ms > max) {
+                max = st[t].busy_ms;
+                slowest = t;
+            }
+            avg += st[t].busy_ms / stats_nt[k];
+        }
+        double scale = 1000. * (rc[k].nruns + rc[k].warmup_runs);
+        printf("%-7d %-7d %-12.4g %-12.4g %-12.4g %-12.4g %-10.3f %-7d\n", k, stats_nt[k], time,
+                min / scale, avg / scale, max / scale, avg > 0 ? max / avg : 1., slowest);
+    }
+
+    printf("\n%-7s %-7s %-5s %-5s %-6s %-12s %-12s %-12s %-14s %-12s\n", "config", "thread", "cpu", "node", "moves",
+            "start(s)", "busy(s)", "wait(s)", "bytes", "bw(MB/s)");
+    for (int k = 0; k < nrc; k++) {
+        double bytes_per_iter = rc[k].generic_len ? (double)sp_config_bytes(&rc[k]) / rc[k].generic_len : 0;
+        size_t runs = rc[k].nruns + rc[k].warmup_runs;
+        double scale = 1000. * runs;
+        for (int t = 0; t < stats_nt[k]; t++) {
+            struct sp_thread_stats *st = &stats[k * max_threads + t];
+            double bytes = st->iters * bytes_per_iter / runs;
+            double busy = st->busy_ms / scale;
+            printf("%-7d %-7d %-5d %-5d %-6d %-12.4g %-12.4g %-12.4g %-14.0f %-12f\n", k, t, st->cpu, st->node, st->moves,
+                    st->start_ms / scale, busy, st->wait_ms / scale, bytes, busy > 0 ? bytes / busy / 1000. / 1000. : 0);
+        }
+    }
+}
+#endif
+
+#if defined( USE_OPENMP ) && defined( USE_PAPI )
+/** The --papi counters of each OpenMP thread, the mean over the runs of
+ *  each config (including the warm-up runs of --target-ci). Events that
+ *  are not counted per thread (uncore, ...) are shown on thread 0.
+ */
+void report_papi_threads(struct run_config *rc, int nrc) {
+    printf("\n%-7s %-7s", "config", "thread");
+    for (int i = 0; i < papi_nevents; i++)
+        printf(" %-12s", papi_ctr_str[i]);
+    printf("\n");
+    for (int k = 0; k < nrc; k++) {
+        size_t runs = rc[k].nruns + rc[k].warmup_runs;
+        for (size_t t = 0; t < rc[k].omp_threads; t++) {
+            printf("%-7d %-7zu", k, t);
+            for (int i = 0; i < papi_nevents; i++)
+                printf(" %-12lld", rc[k].papi_thread[t * papi_nevents + i] / (long long)runs);
+            printf("\n");
+        }
+    }
+}
+#endif
+
+#ifdef USE_MPI
+/** Reduce every config over the MPI ranks and print it on rank 0. The
+ *  runs are separated by barriers, so the time of a run is that of the
+ *  slowest rank and the bandwidth is the bytes of all ranks over it. The
+ *  bandwidth of each rank's own best run gives the min, max and sum.
+ */
+void report_mpi(struct run_config *rc, int nrc) {
+    int rank, nranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+    double *rank_ms = NULL;
+    if (rank == 0) {
+        rank_ms = (double*)malloc(sizeof(double) * nranks);
+        printf("\n%-7s %-7s %-14s %-12s %-12s %-12s %-12s %-12s %-10s\n", "config", "ranks", "bytes", "time(s)", "bw(MB/s)",
+                "rank_min", "rank_max", "rank_sum", "stragglers");
+    }
+
+    for (int k = 0; k < nrc; k++) {
+        double *slowest_ms = (double*)malloc(sizeof(double) * rc[k].nruns);
+        MPI_Reduce(rc[k].time_ms, slowest_ms, rc[k].nruns, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        double best_ms = rc[k].time_ms[0];
+        for (int i = 1; i < rc[k].nruns; i++)
+            if (rc[k].time_ms[i] < best_ms)
+                best_ms = rc[k].time_ms[i];
+        MPI_Gather(&best_ms, 1, MPI_DOUBLE, rank_ms, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+        unsigned long long bytes = sp_config_bytes(&rc[k]), total_bytes;
+        double bw = bytes / (best_ms / 1000.) / 1000. / 1000.;
+        double bw_min, bw_max, bw_sum;
+        MPI_Reduce(&bytes, &total_bytes, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&bw, &bw_min, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&bw, &bw_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&bw, &bw_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            double time_ms = slowest_ms[0];
+            for (int i = 1; i < rc[k].nruns; i++)
+                if (slowest_ms[i] < time_ms)
+                    time_ms = slowest_ms[i];
+
+            double median;
+            int slow[SP_MAX_STRAGGLERS];
+            int nslow = sp_find_stragglers(rank_ms, nranks, straggler_threshold, &median, slow, SP_MAX_STRAGGLERS);
+
+            printf("%-7d %-7d %-14llu %-12.4g %-12f %-12f %-12f %-12f %-10d\n", k, nranks, total_bytes, time_ms / 1000.,
+                    total_bytes / (time_ms / 1000.) / 1000. / 1000., bw_min, bw_max, bw_sum, nslow);
+            for (int s = 0; s < nslow && s < SP_MAX_STRAGGLERS; s++)
+                printf("    straggler: rank %d took %.4g s, %.2fx the median\n", slow[s], rank_ms[slow[s]] / 1000., rank_ms[slow[s]] / median);
+            if (nslow > SP_MAX_STRAGGLERS)
+                printf("    ... and %d more\n", nslow - SP_MAX_STRAGGLERS);
+        }
+        free(slowest_ms);
+    }
+    free(rank_ms);
+}
+#endif
+
 void print_data(double *buf, size_t len){
     for (size_t i = 0; i < len; i++){
         printf("%.0lf ", buf[i]);
@@ -259,10 +1356,6 @@ void print_sizet(size_t *buf, size_t len){
 }
 
 void emit_configs(struct run_config *rc, int nconfigs);
-uint64_t isqrt(uint64_t x);
-uint64_t icbrt(uint64_t x);
-
-spIdx_t remap_pattern(const int nrc, ssize_t *pattern, const spSize_t pattern_len, ssize_t boundary);
  
 
 int main(int argc, char **argv)
@@ -282,9 +1375,8 @@ int main(int argc, char **argv)
 
     // OpenCL Specific
     #ifdef USE_OPENCL
-    size_t global_work_size = 1;
-    char   *kernel_string;
-    cl_uint work_dim = 1;
+    char   *kernel_string = NULL;
+    struct ocl_patterns ocl_pats;
     #endif
 
     // =======================================
@@ -299,21 +1391,50 @@ int main(int argc, char **argv)
         error("No run configurations parsed", ERROR);
     }
 
-    // If indices span many pages, compress them so that there are no
-    // pages in the address space which are never accessed
-    // Pages are assumed to be 4KiB
-    if (compress_flag) {
-        for (int i = 0; i < nrc; i++) {
-            compress_indices(rc[i].pattern, rc[i].pattern_len);
-            
-            if (rc[i].kernel == GS || rc[i].kernel == MULTISCATTER) {
-                compress_indices(rc[i].pattern_scatter, rc[i].pattern_scatter_len);
-            }
-       
-            if (rc[i].kernel == GS || rc[i].kernel == MULTIGATHER) {
-                compress_indices(rc[i].pattern_gather, rc[i].pattern_gather_len);
-            }
-        }
+    // Only rank 0 prints, the other ranks' results are reduced onto it
+    int mpi_rank = 0;
+    int mpi_ranks = 1;
+#ifdef USE_MPI
+    MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &mpi_ranks);
+    if (mpi_rank != 0)
+        quiet_flag = 3;
+#endif
+
+#ifdef USE_OPENMP
+    sp_sched_set(sched_kind, sched_chunk);
+#endif
+
+    // This job's share of the suite, less what an earlier job wrote
+    int *suite_idx = (int*)malloc(sizeof(int) * nrc);
+    nrc = select_configs(rc, nrc, suite_idx);
+    if (nrc == 0) {
+        free(rc);
+        free(suite_idx);
+#ifdef USE_MPI
+        MPI_Finalize();
+#endif
+        return 0;
+    }
+
+    if (baseline_file[0]) {
+        int nbase = sp_baseline_load(baseline_file);
+        if (nbase < 0)
+            error("Could not read the --baseline file", ERROR);
+        if (nbase == 0)
+            error("The --baseline file has no run records, write it with --output=json", ERROR);
+    }
+
+    if (serve_addr[0]) {
+        struct sp_suite *sizes = sp_config_adopt(rc, nrc);
+        struct sp_output_meta meta = output_meta(mpi_ranks);
+        if (sp_serve(serve_addr, sizes, &meta))
+            error("Could not open the --serve socket", ERROR);
+        sp_config_free(sizes);
+#ifdef USE_MPI
+        MPI_Finalize();
+#endif
+        return 0;
     }
 
     struct run_config *rc2 = rc;
@@ -321,12 +1442,15 @@ int main(int argc, char **argv)
     // Allocate space for timing and papi counter information
 
     for (int i = 0; i < nrc; i++) {
-        rc2[i].time_ms = (double*)malloc(sizeof(double) * rc2[i].nruns);
+        rc2[i].time_ms = (double*)malloc(sizeof(double) * sp_measure_slots(&rc2[i]));
+        if (energy_flag)
+            rc2[i].energy = (struct sp_energy*)calloc(sp_measure_slots(&rc2[i]), sizeof(struct sp_energy));
 #ifdef USE_PAPI
-        rc2[i].papi_ctr = (long long **)malloc(sizeof(long long *) * rc2[i].nruns);
-        for (int j = 0; j < rc2[i].nruns; j++){
+        rc2[i].papi_ctr = (long long **)malloc(sizeof(long long *) * sp_measure_slots(&rc2[i]));
+        for (int j = 0; j < sp_measure_slots(&rc2[i]); j++){
             rc2[i].papi_ctr[j] = (long long*)malloc(sizeof(long long) * papi_nevents);
         }
+        rc2[i].papi_thread = (long long*)calloc(rc2[i].omp_threads * papi_nevents + 1, sizeof(long long));
 #endif
     }
 
@@ -352,11 +1476,14 @@ int main(int argc, char **argv)
         papi_err(PAPI_event_name_to_code(papi_event_names[i],&papi_event_codes[i]), __LINE__, __FILE__);
     }
 
-    int EventSet = PAPI_NULL;
-    papi_err(PAPI_create_eventset(&EventSet), __LINE__, __FILE__);
-    for (int i = 0; i < papi_nevents; i++) {
-        papi_err(PAPI_add_event(EventSet, papi_event_codes[i]), __LINE__, __FILE__);
-    }
+    // Every OpenMP thread counts its own events
+    int papi_threads = 1;
+    for (int i = 0; i < nrc; i++)
+        if (backend == OPENMP && (int)rc2[i].omp_threads > papi_threads)
+            papi_threads = rc2[i].omp_threads;
+    papi_sets_init(&papi_sets, papi_event_codes, papi_nevents, papi_threads);
+    if (papi_sets.multiplex && quiet_flag < 1)
+        printf("PAPI events are multiplexed\n");
 
 #endif
 
@@ -372,74 +1499,47 @@ int main(int argc, char **argv)
     #endif
 
     // =======================================
-    // Compute Buffer Sizes
-    // =======================================
-
-    if (rc2[0].kernel != GATHER && rc2[0].kernel != SCATTER && rc2[0].kernel != GS && rc2[0].kernel != MULTISCATTER && rc2[0].kernel != MULTIGATHER) {
-        printf("Error: Unsupported kernel\n");
-        exit(1);
-    }
-
-    size_t max_source_size = 0;
-    size_t max_target_size = 0;
-    size_t max_pat_len = 0;
-    size_t max_ptrs = 0;
-    size_t max_ro_len = 0;
-
-    for (int i = 0; i < nrc; i++) {
-        spIdx_t max_pattern_val;
-        ssize_t pattern_delta;
-
-        if (rc2[i].kernel == MULTISCATTER) {
-            spIdx_t max_pattern_val_outer = remap_pattern(nrc, rc2[i].pattern, rc2[i].pattern_len, rc2[i].boundary);
-            spIdx_t max_pattern_val_inner = remap_pattern(nrc, rc2[i].pattern_scatter, rc2[i].pattern_scatter_len, rc2[i].boundary);
-
-            assert(rc2[i].pattern_len > max_pattern_val_inner);
-
-            max_pattern_val = max_pattern_val_outer >= max_pattern_val_inner ? max_pattern_val_outer : max_pattern_val_inner;
-            pattern_delta = rc2[i].delta >= rc2[i].delta_scatter ? rc2[i].delta : rc2[i].delta_scatter;
-        }
-        else if (rc2[i].kernel == MULTIGATHER) {
-            spIdx_t max_pattern_val_outer = remap_pattern(nrc, rc2[i].pattern, rc2[i].pattern_len, rc2[i].boundary);
-            spIdx_t max_pattern_val_inner = remap_pattern(nrc, rc2[i].pattern_gather, rc2[i].pattern_gather_len, rc2[i].boundary);
-
-            assert(rc2[i].pattern_len > max_pattern_val_inner);
-
-            max_pattern_val = max_pattern_val_outer >= max_pattern_val_inner ? max_pattern_val_outer : max_pattern_val_inner;
-            pattern_delta = rc2[i].delta >= rc2[i].delta_gather ? rc2[i].delta : rc2[i].delta_gather;
-        }
-        else if (rc2[i].kernel == GS) {
-            spIdx_t max_pattern_val_gather = remap_pattern(nrc, rc2[i].pattern_gather, rc2[i].pattern_gather_len, rc2[i].boundary);
-            spIdx_t max_pattern_val_scatter = remap_pattern(nrc, rc2[i].pattern_scatter, rc2[i].pattern_scatter_len, rc2[i].boundary);
-            max_pattern_val = max_pattern_val_gather >= max_pattern_val_scatter ? max_pattern_val_gather : max_pattern_val_scatter;
-        
-            pattern_delta = rc2[i].delta_gather >= rc2[i].delta_scatter ? rc2[i].delta_gather : rc2[i].delta_scatter;
-        }
-        else {
-            max_pattern_val = remap_pattern(nrc, rc2[i].pattern, rc2[i].pattern_len, rc2[i].boundary);
-            
-            pattern_delta = rc2[i].delta;
-        }
-        //printf("count: %zu, delta: %zu, %zu\n", rc2[i].generic_len, rc2[i].delta, rc2[i].generic_len*rc2[i].delta);
+    // Compute Buffer Sizes
+    // =======================================
 
-        size_t cur_source_size = (size_t)(((size_t)max_pattern_val + 1) + (rc2[i].generic_len-1)*pattern_delta) * sizeof(sgData_t);
-        //printf("max_pattern_val: %zu, source_size %zu\n", max_pattern_val, cur_source_size);
-        //printf("\n");
+    if (rc2[0].kernel != GATHER && rc2[0].kernel != SCATTER && rc2[0].kernel != GS && rc2[0].kernel != MULTISCATTER && rc2[0].kernel != MULTIGATHER && rc2[0].kernel != CHASE) {
+        printf("Error: Unsupported kernel\n");
+        exit(1);
+    }
 
-	if (cur_source_size > max_source_size) {
-            max_source_size = cur_source_size;
+#ifdef USE_OPENMP
+    if (corun_flag) {
+        size_t corun_threads = 0;
+        for (int i = 0; i < nrc; i++) {
+            if (rc2[i].type == TRACE)
+                error("--co-run does not support TRACE patterns", ERROR);
+            corun_threads += rc2[i].omp_threads;
         }
+        if (nrc > SP_MAX_TEAMS)
+            error("--co-run supports at most 64 configs", ERROR);
+        if (corun_threads > (size_t)omp_get_num_procs())
+            error("--co-run needs more threads than there are CPUs, the teams will share CPUs", WARN);
+        if (omp_get_proc_bind() == omp_proc_bind_false)
+            error("--co-run without OMP_PROC_BIND set, the teams are not pinned to disjoint CPUs (try OMP_PLACES=cores OMP_PROC_BIND=spread,close)", WARN);
+    }
+#endif
 
-        size_t cur_target_size;
-        if (rc2[i].kernel == GS) {
-            cur_target_size = ((max_pattern_val + 1) + (rc2[i].generic_len-1)*pattern_delta) * sizeof(sgData_t);
-        }
-        else {
-            cur_target_size = rc2[i].pattern_len * sizeof(sgData_t) * rc2[i].wrap;
+    size_t max_source_size = 0;
+    size_t max_target_size = 0;
+    size_t max_pat_len = 0;
+    size_t max_ptrs = 0;
+    size_t max_ro_len = 0;
+    size_t max_deltas_len = 1;
+    size_t *cfg_source_size = (size_t*)malloc(sizeof(size_t) * nrc);
+    size_t *cfg_target_size = (size_t*)malloc(sizeof(size_t) * nrc);
+
+    for (int i = 0; i < nrc; i++) {
+        sp_prepare_config(&rc2[i], nrc, &cfg_source_size[i], &cfg_target_size[i]);
+        if (cfg_source_size[i] > max_source_size) {
+            max_source_size = cfg_source_size[i];
         }
-        
-        if (cur_target_size > max_target_size) {
-            max_target_size = cur_target_size;
+        if (cfg_target_size[i] > max_target_size) {
+            max_target_size = cfg_target_size[i];
         }
 
         if (rc2[i].omp_threads > max_ptrs) {
@@ -463,10 +1563,12 @@ int main(int argc, char **argv)
             }
         }
         else if (rc2[i].kernel == GS) {
-            assert(rc2[i].pattern_gather_len == rc2[i].pattern_scatter_len);
             if (rc2[i].pattern_gather_len > max_pat_len) {
                 max_pat_len = rc2[i].pattern_gather_len;
             }
+            if (rc2[i].pattern_scatter_len > max_pat_len) {
+                max_pat_len = rc2[i].pattern_scatter_len;
+            }
         }
         else {
             if (rc2[i].pattern_len > max_pat_len) {
@@ -474,40 +1576,26 @@ int main(int argc, char **argv)
             }
         }
 
-
-        if (rc2[i].ro_morton == 1) {
-            rc2[i].ro_order = z_order_1d(rc2[i].generic_len, rc2[i].ro_block);
-        } else if (rc2[i].ro_morton == 2) {
-            rc2[i].ro_order = z_order_2d(isqrt(rc2[i].generic_len), rc2[i].ro_block);
-        } else if (rc2[i].ro_morton == 3) {
-            rc2[i].ro_order = z_order_3d(icbrt(rc2[i].generic_len), rc2[i].ro_block);
-        }
-
-        if (rc2[i].ro_hilbert == 1) {
-            //yes, use z order function
-            rc2[i].ro_order = z_order_1d(rc2[i].generic_len, rc2[i].ro_block);
-        } else if (rc2[i].ro_hilbert == 2) {
-            error ("Not yet implemented", ERROR);
-        } else if (rc2[i].ro_hilbert == 3) {
-            rc2[i].ro_order = h_order_3d(icbrt(rc2[i].generic_len), rc2[i].ro_block);
-        }
-
-        if ((rc2[i].ro_hilbert || rc2[i].ro_morton) && !rc2[i].ro_order) {
-            error("Unable to generate reorder pattern.", ERROR);
+        if (rc2[i].deltas_len > max_deltas_len) {
+            max_deltas_len = rc2[i].deltas_len;
         }
 
-        if (rc2[i].ro_morton || rc[i].ro_morton) {
+        if (rc2[i].ro_morton || rc2[i].ro_hilbert || rc2[i].random_bases) {
             if (rc2[i].generic_len > max_ro_len) {
                 max_ro_len = rc2[i].generic_len;
             }
         }
     }
 
-    source.size = max_source_size;
+    // With --resize-buffers the buffers start out sized for the first config
+    // and follow each config from there
+    source.size = resize_flag ? cfg_source_size[0] : max_source_size;
     source.len = source.size / sizeof(sgData_t);
+    source.capacity = source.size;
 
-    target.size = max_target_size;
+    target.size = resize_flag ? cfg_target_size[0] : max_target_size;
     target.len = target.size / sizeof(sgData_t);
+    target.capacity = target.size;
 
     target.nptrs = max_ptrs;
 
@@ -516,47 +1604,79 @@ int main(int argc, char **argv)
     // =======================================
     #ifdef USE_OPENCL
     if (backend == OPENCL) {
-        //kernel_string = ocl_kernel_gen(index_len, vector_len, kernel);
+        // Built per pattern length when each config runs
         kernel_string = read_file(kernel_file);
-        sgp = kernel_from_string(context, kernel_string, kernel_name, NULL);
-        if (kernel_string) {
-            free(kernel_string);
-        }
     }
     #endif
 
     // =======================================
     // Create Host Buffers, Fill With Data
     // =======================================
-    source.host_ptr = (sgData_t*) sp_malloc(source.size, 1, ALIGN_CACHE);
+    // A sparse source is backed one config at a time, as each runs
+    if (sparse_source_flag)
+        source.host_ptr = (sgData_t*) sp_reserve(source.size);
+    else
+        source.host_ptr = (sgData_t*) sp_data_malloc(source.size, 1, ALIGN_CACHE);
+    source.host_ptrs = NULL;
+    source.nptrs = 0;
 
     // replicate the target space for every thread
     target.host_ptrs = (sgData_t**) sp_malloc(sizeof(sgData_t*), target.nptrs, ALIGN_CACHE);
     for (size_t i = 0; i < target.nptrs; i++) {
-        target.host_ptrs[i] = (sgData_t*) sp_malloc(target.size, 1, ALIGN_PAGE);
-        #ifdef VALIDATE
-        if (validate_flag) { // Fill target buffer with data for validation purposes
-            random_data(target.host_ptrs[i], target.len);
-        }
-        #endif
+        target.host_ptrs[i] = (sgData_t*) sp_data_malloc(target.size, 1, ALIGN_PAGE);
     }
     target.host_ptr = target.host_ptrs[0];
     //    printf("-- here -- \n");
 
-    // Populate buffers on host
-    #pragma omp parallel for
-    for (size_t i = 0; i < source.len; i++) {
-        source.host_ptr[i] = i % (source.len / 64);
+    sp_fill_targets(&target);
+    if (!sparse_source_flag)
+        sp_fill_source(&source, target.nptrs);
+
+    // One copy of the source per NUMA node, each thread reads the copy on
+    // the node it runs on
+    sgData_t **source_replicas = NULL;
+#ifdef USE_OPENMP
+    if (numa_mode == NUMA_REPLICATE) {
+        int nodes = sp_numa_num_nodes();
+        if (omp_get_proc_bind() == omp_proc_bind_false) {
+            error("--numa=replicate without OMP_PROC_BIND set, threads may migrate away from their replica", WARN);
+        }
+        source_replicas = (sgData_t**) sp_malloc(sizeof(sgData_t*), nodes, ALIGN_CACHE);
+        for (int n = 0; n < nodes; n++) {
+            source_replicas[n] = (sgData_t*) sp_data_malloc(source.size, 1, ALIGN_PAGE);
+            sp_numa_bind(source_replicas[n], source.size, n);
+            memcpy(source_replicas[n], source.host_ptr, source.size);
+        }
+        source.nptrs = target.nptrs;
+        source.host_ptrs = (sgData_t**) sp_malloc(sizeof(sgData_t*), source.nptrs, ALIGN_CACHE);
+        #pragma omp parallel num_threads(source.nptrs)
+        {
+            int node = sp_numa_current_node();
+            source.host_ptrs[omp_get_thread_num()] = source_replicas[node < nodes ? node : 0];
+        }
+    }
+#endif
+
+#ifdef USE_MPI
+    // The source of every rank, exposed to the others
+    struct sp_rma rma;
+    if (rma_mode != RMA_NONE) {
+        sp_rma_create(&rma, &source);
     }
-    random_data(source.host_ptr, source.len);
+#endif
+#ifdef USE_DSA
+    struct sp_dsa dsa;
+    if (dsa_wq[0])
+        sp_dsa_open(&dsa, dsa_wq, dsa_submitters);
+#endif
 
     // =======================================
     // Create Device Buffers, Transfer Data
     // =======================================
     #ifdef USE_OPENCL
     if (backend == OPENCL) {
-        //TODO: Rewrite to not take index buffers
-        //create_dev_buffers_ocl(&source, &target, &si, &ti);
+        create_dev_buffers_ocl(&source, &target);
+        create_pattern_buffers_ocl(&ocl_pats, max_pat_len);
     }
     #endif
 
@@ -565,23 +1685,115 @@ int main(int argc, char **argv)
     sgIdx_t *pat_gath_dev;
     sgIdx_t *pat_scat_dev;
     uint32_t *order_dev;
+    size_t *deltas_dev;
     if (backend == CUDA) {
         //TODO: Rewrite to not take index buffers
-        create_dev_buffers_cuda(&source);
+        create_src_buffer_cuda(&source, gpu_mem, gpu_hint, cuda_dev);
         create_dev_buffers_cuda(&target);
         cudaMalloc((void**)&pat_dev, sizeof(sgIdx_t) * max_pat_len);
         cudaMalloc((void**)&pat_gath_dev, sizeof(sgIdx_t) * max_pat_len);
         cudaMalloc((void**)&pat_scat_dev, sizeof(sgIdx_t) * max_pat_len);
         cudaMalloc((void**)&order_dev, sizeof(uint32_t) * max_ro_len);
-        cudaMemcpy(source.dev_ptr_cuda, source.host_ptr, source.size, cudaMemcpyHostToDevice);
+        cudaMalloc((void**)&deltas_dev, sizeof(size_t) * max_deltas_len);
         cudaMemcpy(target.dev_ptr_cuda, target.host_ptr, target.size, cudaMemcpyHostToDevice);
         cudaDeviceSynchronize();
     }
+
+    // Every device gets its own copy of the buffers and the pattern
+    int multidev = backend == CUDA && (cuda_ndevs > 1 || cuda_streams > 1);
+    double *source_devs[SP_MAX_CUDA_DEVICES];
+    double *target_devs[SP_MAX_CUDA_DEVICES];
+    sgIdx_t *pat_devs[SP_MAX_CUDA_DEVICES];
+    float dev_time_ms[SP_MAX_CUDA_DEVICES];
+    float *dev_best_ms = NULL;
+    if (multidev) {
+        create_dev_replicas_cuda(&source, source_devs, cuda_ndevs, cuda_devs);
+        create_dev_replicas_cuda(&target, target_devs, cuda_ndevs, cuda_devs);
+        pat_devs[0] = pat_dev;
+        for (int d = 1; d < cuda_ndevs; d++) {
+            cudaSetDevice(cuda_devs[d]);
+            cudaMalloc((void**)&pat_devs[d], sizeof(sgIdx_t) * max_pat_len);
+        }
+        cudaSetDevice(cuda_devs[0]);
+        dev_best_ms = (float*)calloc(nrc * cuda_ndevs, sizeof(float));
+    }
+    struct sp_cuda_tune *tunes = autotune_flag ? (struct sp_cuda_tune*)calloc(nrc, sizeof(struct sp_cuda_tune)) : NULL;
     int final_block_idx = -1;
     int final_thread_idx = -1;
     double final_gather_data = -1;
     #endif
 
+    #ifdef USE_OPENMP
+    // Stats of every thread for each config (--busy-times)
+    struct sp_thread_stats *thread_stats = NULL;
+    int *stats_nt = NULL;
+    if (busy_flag) {
+        thread_stats = (struct sp_thread_stats*)calloc(nrc * max_ptrs, sizeof(struct sp_thread_stats));
+        stats_nt = (int*)calloc(nrc, sizeof(int));
+        sp_sched_instrument(1);
+    }
+    // Best time of each config with its composed pattern (--compose)
+    double *compose_ms = compose_flag ? (double*)calloc(nrc, sizeof(double)) : NULL;
+
+    // Bandwidth of each config at each count of --thread-sweep
+    double *sweep_mbs = thread_sweep.policy != PIN_NONE ? (double*)calloc(nrc * thread_sweep.n, sizeof(double)) : NULL;
+
+    // Times of the paced Gathers of each thread, merged per config (--rate)
+    struct sp_hist *rate_hists = NULL, *rate_hist = NULL;
+    uint64_t rate_ticks = 0;
+    if (rate_mgs > 0) {
+        rate_hists = (struct sp_hist*)sp_malloc(sizeof(struct sp_hist), max_ptrs, ALIGN_PAGE);
+        rate_hist = (struct sp_hist*)calloc(nrc, sizeof(struct sp_hist));
+        rate_ticks = (uint64_t)(1000. / rate_mgs / sg_tick_ns());
+    }
+    #endif
+
+    #if defined( USE_OPENMP ) || defined( USE_SERIAL )
+    // Best warm time of each config with --cache=cold or flush
+    double *warm_ms = cache_mode != CACHE_WARM ? (double*)calloc(nrc, sizeof(double)) : NULL;
+    if (cache_mode == CACHE_COLD)
+        sp_evict_init(backend == OPENMP ? (int)max_ptrs : 1);
+
+    // Result check of each config (--validate)
+    struct sp_check *checks = validate_flag ? (struct sp_check*)calloc(nrc, sizeof(struct sp_check)) : NULL;
+
+    // Bandwidth of the --noise threads during the runs of each config
+    double *noise_gbs = NULL;
+    if (noise_spec.kernel != NOISE_NONE) {
+        noise_gbs = (double*)calloc(nrc, sizeof(double));
+        int config_cpus = backend == OPENMP ? (int)max_ptrs : 1;
+        if (sp_noise_start(&noise_spec) < 0)
+            error("--noise could not pin its threads, they may share CPUs with the config", WARN);
+        else if (noise_spec.threads + config_cpus > sysconf(_SC_NPROCESSORS_ONLN))
+            error("--noise and the config need more threads than there are CPUs, they will share CPUs", WARN);
+    }
+    #endif
+
+
+    // Reuse profile of each config (--analyze-reuse)
+    struct sp_reuse *reuse = analyze_reuse_flag ? (struct sp_reuse*)calloc(nrc, sizeof(struct sp_reuse)) : NULL;
+
+    // Energy counters of the CPU packages and of the GPUs in use
+    if (energy_flag) {
+        const char *gpu_ids[SP_MAX_CUDA_DEVICES];
+        int ngpus = 0;
+#if defined( USE_CUDA ) && !defined( USE_HIP )
+        char gpu_bus[SP_MAX_CUDA_DEVICES][32];
+        if (backend == CUDA) {
+            for (int d = 0; d < cuda_ndevs; d++) {
+                if (cudaDeviceGetPCIBusId(gpu_bus[d], sizeof(gpu_bus[d]), cuda_devs[d]) == cudaSuccess)
+                    gpu_ids[ngpus++] = gpu_bus[d];
+            }
+        }
+#endif
+        if (sp_energy_init(gpu_ids, ngpus) == 0) {
+            error("--energy found no readable RAPL or NVML counters, energy is not reported", WARN);
+            energy_flag = 0;
+        }
+    }
+
+    if (output_format != OUTPUT_NONE && mpi_rank == 0)
+        open_output(mpi_ranks);
 
     // =======================================
     // Execute Benchmark
@@ -599,6 +1811,7 @@ int main(int argc, char **argv)
     //PATRICK
     if (quiet_flag < 1) {
         print_system_info();
+        print_numa_info(&source, &target, source_replicas);
     }
     if (quiet_flag < 2) {
         emit_configs(rc2, nrc);
@@ -612,6 +1825,29 @@ int main(int argc, char **argv)
     // Print config info
 
     for (int k = 0; k < nrc; k++) {
+        if (resize_flag) {
+            if (sgbuf_reserve(&source, cfg_source_size[k], ALIGN_CACHE)) {
+                sp_fill_source(&source, target.nptrs);
+            }
+            if (sgbuf_reserve(&target, cfg_target_size[k], ALIGN_PAGE)) {
+                sp_fill_targets(&target);
+            }
+        }
+        struct sp_trace_stream *trace = NULL;
+        if (rc2[k].type == TRACE) {
+            if (rc2[k].graph)
+                trace = sp_graph_open(rc2[k].pattern_file, (enum sp_graph_algo)rc2[k].graph, rc2[k].trace_chunk);
+            else
+                trace = sp_trace_open(rc2[k].pattern_file, rc2[k].trace_chunk);
+        }
+        if (sparse_source_flag) {
+            sp_fill_sparse_source(&source, &rc2[k], trace, target.nptrs);
+        }
+        // CHASE links its chains through the source, refilled afterwards
+        struct sp_chase chase = {0};
+        if (rc2[k].kernel == CHASE) {
+            sp_chase_prepare(&chase, source.host_ptr, &rc2[k], backend == OPENMP ? (int)rc2[k].omp_threads : 1);
+        }
 #ifdef USE_MPI
 	MPI_Barrier(MPI_COMM_WORLD);
 #endif
@@ -619,7 +1855,16 @@ int main(int argc, char **argv)
         // Time OpenCL Kernel
         #ifdef USE_OPENCL
         if (backend == OPENCL) {
-
+            cl_kernel knl = ocl_kernel_for(kernel_string, &rc2[k]);
+            ocl_prepare_config(&rc2[k], &ocl_pats);
+            // Start at -1 to do a warm-up run
+            for (int i = -1; sp_measure_more(&rc2[k], i); i++) {
+#ifdef USE_MPI
+                MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                double time_ms = ocl_run_config(knl, &rc2[k], &source, &target, &ocl_pats);
+                if (i >= 0) rc2[k].time_ms[i] = time_ms;
+            }
         }
         #endif // USE_OPENCL
 
@@ -628,9 +1873,59 @@ int main(int argc, char **argv)
         int wpt = 1;
         if (backend == CUDA) {
             float time_ms = 2;
-            for (int i = -10; i < (int) rc2[k].nruns; i++) {
+            if (multidev && ((rc2[k].kernel != GATHER && rc2[k].kernel != SCATTER) || rc2[k].random_seed != 0 || rc2[k].ro_morton || rc2[k].ro_hilbert || rc2[k].stride_kernel != -1 || rc2[k].deltas_len > 1 || rc2[k].prefetch_distance > 0 || rc2[k].elem != ELEM_F64 || rc2[k].cuda_async > 0 || rc2[k].box_op != BOX_NONE)) {
+                error("--devices and --streams only support Gather and Scatter without --random, --morton, --hilbert, --stride, multiple deltas, --prefetch-distance, --elem, --cuda-async or -pBOX", ERROR);
+            }
+            if (rc2[k].cuda_async > 0 && atomic_flag)
+                error("--cuda-async can not be combined with --atomic-writes", ERROR);
+            if (rc2[k].deltas_len > 1 && rc2[k].kernel != GATHER && rc2[k].kernel != MULTIGATHER)
+                error("The CUDA backend only supports multiple deltas for Gather and MultiGather", ERROR);
+            if (multidev)
+                cuda_prepare_multidev(cuda_ndevs, cuda_devs, pat_devs, rc2[k].pattern, rc2[k].pattern_len);
+            else
+                cuda_prepare_config(&rc2[k], pat_dev, pat_gath_dev, pat_scat_dev, order_dev, deltas_dev);
+
+            // Plain Gather and Scatter can be replayed from a CUDA Graph,
+            // everything else goes through the wrappers
+            struct sp_cuda_graph *graph = NULL;
+            if (cuda_graph_flag) {
+                if ((rc2[k].kernel == GATHER || rc2[k].kernel == SCATTER) && rc2[k].random_seed == 0 && !rc2[k].ro_morton && !rc2[k].ro_hilbert && rc2[k].stride_kernel == -1 && rc2[k].deltas_len <= 1 && rc2[k].prefetch_distance == 0 && rc2[k].elem == ELEM_F64 && rc2[k].cuda_async == 0 && rc2[k].box_op == BOX_NONE) {
+                    graph = cuda_graph_create(rc2[k].local_work_size, rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, atomic_flag, validate_flag);
+                } else {
+                    error("--cuda-graph only supports Gather and Scatter without --random, --morton, --hilbert, --stride, multiple deltas, --prefetch-distance, --elem, --cuda-async or -pBOX, launching this config directly", WARN);
+                }
+            }
+            if (tunes) {
+                if ((rc2[k].kernel == GATHER || rc2[k].kernel == SCATTER) && rc2[k].random_seed == 0 && !rc2[k].ro_morton && !rc2[k].ro_hilbert && rc2[k].stride_kernel == -1 && rc2[k].deltas_len <= 1 && rc2[k].prefetch_distance == 0 && rc2[k].elem == ELEM_F64 && rc2[k].cuda_async == 0 && rc2[k].box_op == BOX_NONE && atomic_flag == 0) {
+                    cuda_autotune(&rc2[k], source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, &tunes[k]);
+                } else {
+                    error("--autotune only supports Gather and Scatter without --random, --morton, --hilbert, --stride, multiple deltas, --prefetch-distance, --elem, --cuda-async, -pBOX or --atomic-writes, launching this config with the default parameters", WARN);
+                }
+            }
+            for (int i = -10; sp_measure_more(&rc2[k], i); i++) {
 #define arr_len (1)
-                if (rc2[k].kernel == MULTISCATTER) {
+                if (energy_flag && i>=0) sp_energy_start();
+#ifdef USE_PAPI
+                if (i>=0) papi_sets_start(&papi_sets, 1);
+#endif
+                if (graph) {
+#ifdef USE_MPI
+                  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                  time_ms = cuda_graph_launch(graph, &final_block_idx, &final_thread_idx);
+                }
+                else if (multidev) {
+#ifdef USE_MPI
+                  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                  time_ms = cuda_block_multidev_wrapper(cuda_ndevs, cuda_devs, cuda_streams, rc2[k].local_work_size, rc2[k].kernel, source_devs, target_devs, pat_devs, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, atomic_flag, validate_flag, dev_time_ms);
+                  for (int d = 0; d < cuda_ndevs && i >= 0; d++) {
+                      float *best = &dev_best_ms[k * cuda_ndevs + d];
+                      if (i == 0 || dev_time_ms[d] < *best)
+                          *best = dev_time_ms[d];
+                  }
+                }
+                else if (rc2[k].kernel == MULTISCATTER) {
                   unsigned long global_work_size = rc2[k].generic_len / wpt * rc2[k].pattern_scatter_len;
                   unsigned long local_work_size = rc2[k].local_work_size;
                   unsigned long grid[arr_len] = {global_work_size/local_work_size};
@@ -639,7 +1934,7 @@ int main(int argc, char **argv)
 #ifdef USE_MPI
                   MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                  time_ms = cuda_block_multiscatter_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_dev, pat_scat_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
+                  time_ms = cuda_block_multiscatter_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_dev, pat_scat_dev, order_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
                 }
                 else if (rc2[k].kernel == MULTIGATHER) {
                   unsigned long global_work_size = rc2[k].generic_len / wpt * rc2[k].pattern_gather_len;
@@ -650,7 +1945,7 @@ int main(int argc, char **argv)
 #ifdef USE_MPI
                   MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                  time_ms = cuda_block_multigather_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_dev, pat_gath_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, validate_flag);
+                  time_ms = cuda_block_multigather_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_dev, pat_gath_dev, deltas_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, validate_flag);
                 }
                 else if (rc2[k].kernel == GS) {
                     unsigned long global_work_size = rc2[k].generic_len / wpt * rc2[k].pattern_gather_len;
@@ -663,169 +1958,176 @@ int main(int argc, char **argv)
 #ifdef USE_MPI
                     MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                    time_ms = cuda_block_sg_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_gath_dev, pat_scat_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
+                    time_ms = cuda_block_sg_wrapper(arr_len, grid, block, source.dev_ptr_cuda, target.dev_ptr_cuda, &rc2[k], pat_gath_dev, pat_scat_dev, order_dev, wpt, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
                 } else {
                     unsigned long global_work_size = rc2[k].generic_len / wpt * rc2[k].pattern_len;
                     unsigned long local_work_size = rc2[k].local_work_size;
                     unsigned long grid[arr_len]  = {global_work_size/local_work_size};
                     unsigned long block[arr_len] = {local_work_size};
 
-                    if (rc2[k].random_seed == 0) { 
+                    if (rc2[k].box_op != BOX_NONE) {
+                        struct sp_box_rows rows = {0};
+                        if (rc2[k].box_op != BOX_TRANSPOSE)
+                            sp_box_rows(&rc2[k].box, &rows);
+#ifdef USE_MPI
+                        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                        time_ms = cuda_box_wrapper(rc2[k].box_op, source.dev_ptr_cuda, target.dev_ptr_cuda, &rows, sp_box_cells(&rc2[k].box), rc2[k].box.cell, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].local_work_size);
+                    } else if (rc2[k].cuda_async > 0) {
 #ifdef USE_MPI
                         MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                        time_ms = cuda_block_wrapper(arr_len, grid, block, rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, wpt, rc2[k].ro_morton, rc2[k].ro_order, order_dev, rc[k].stride_kernel, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
+                        time_ms = cuda_block_async_wrapper(rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].local_work_size, rc2[k].cuda_async, &final_block_idx, &final_thread_idx, validate_flag);
+                    } else if (tunes && tunes[k].tuned) {
+#ifdef USE_MPI
+                        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                        time_ms = cuda_tuned_wrapper(rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, &tunes[k].launch);
+                    } else if (rc2[k].random_seed == 0) { 
+#ifdef USE_MPI
+                        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+                        time_ms = cuda_block_wrapper(arr_len, grid, block, rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, wpt, rc2[k].ro_morton || rc2[k].ro_hilbert, rc2[k].ro_order, order_dev, rc[k].stride_kernel, deltas_dev, rc2[k].deltas_len > 1 ? rc2[k].deltas_len : 1, rc2[k].prefetch_distance, rc2[k].prefetch_line, rc2[k].elem_size, &final_block_idx, &final_thread_idx, &final_gather_data, atomic_flag, validate_flag);
                     } else {
-                        if (rc2[k].pattern_len > rc2[k].local_work_size) {
-                            error("Pattern length cannot exceed local_work_size", ERROR);
-                        }
-
-                        if (rc2[k].pattern_len > 1024 || rc2[k].local_work_size > 1024) {
-                            error("Pattern length cannot exceed 1024 on GPU", ERROR);
+                        if (rc2[k].local_work_size > 1024) {
+                            error("local_work_size cannot exceed 1024 on GPU", ERROR);
                         }
 #ifdef USE_MPI
                         MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                        time_ms = cuda_block_random_wrapper(arr_len, grid, block, rc2[k].kernel, source.dev_ptr_cuda, pat_dev, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, wpt, rc2[k].random_seed);
+                        time_ms = cuda_block_random_wrapper(arr_len, grid, block, rc2[k].kernel, source.dev_ptr_cuda, target.dev_ptr_cuda, pat_dev, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, wpt, rc2[k].random_seed, rc2[k].random_bases ? order_dev : NULL);
                     }
                 }
 
+#ifdef USE_PAPI
+                if (i>=0) papi_sets_stop(&papi_sets, 1, papi_nevents, rc2[k].papi_ctr[i], rc2[k].papi_thread);
+#endif
+                if (energy_flag && i>=0) sp_energy_stop(&rc2[k].energy[i]);
                 if (i>=0) rc2[k].time_ms[i] = time_ms;
             }
+            if (graph)
+                cuda_graph_destroy(graph);
 
 
         }
 
         #endif // USE_CUDA
 
+        // Time remote Gathers and Scatters
+        #ifdef USE_MPI
+        if (rma_mode != RMA_NONE) {
+            if ((rc2[k].kernel != GATHER && rc2[k].kernel != SCATTER) || rc2[k].type == TRACE || rc2[k].random_seed >= 1 ||
+                    rc2[k].deltas_len > 1 || rc2[k].ro_morton || rc2[k].ro_hilbert || rc2[k].op != OP_COPY) {
+                error("--rma only supports Gather and Scatter with a single delta, without --random, --morton, --hilbert, traces or accumulate ops", ERROR);
+            }
+            sp_rma_prepare(&rma, &rc2[k], rma_mode, rma_batch);
+
+            // Start at -1 to do a warm-up run
+            for (int i = -1; sp_measure_more(&rc2[k], i); i++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                if (i!=-1) sg_zero_time();
+                if (energy_flag && i!=-1) sp_energy_start();
+                sp_rma_run(&rma, &rc2[k], rma_mode, rma_batch);
+                MPI_Barrier(MPI_COMM_WORLD);
+                if (energy_flag && i!=-1) sp_energy_stop(&rc2[k].energy[i]);
+                if (i!=-1) rc2[k].time_ms[i] = sg_get_time_ms();
+            }
+            sp_rma_release(&rma);
+        }
+        #endif // USE_MPI
+
+        // Time Gathers and Scatters offloaded to DSA
+        #ifdef USE_DSA
+        if (dsa_wq[0]) {
+            if ((rc2[k].kernel != GATHER && rc2[k].kernel != SCATTER) || rc2[k].type == TRACE || rc2[k].random_seed >= 1 ||
+                    rc2[k].deltas_len > 1 || rc2[k].ro_morton || rc2[k].ro_hilbert || rc2[k].op != OP_COPY || rc2[k].elem != ELEM_F64 ||
+                    rc2[k].store != STORE_PLAIN || rc2[k].prefetch_distance > 0 || rc2[k].index_bits != 64 || numa_mode == NUMA_REPLICATE) {
+                error("--dsa only supports copy Gathers and Scatters with a single delta, without --random, --morton, --hilbert, --elem, --store, --prefetch-distance, --index-bits, --numa=replicate or traces", ERROR);
+            }
+            sp_dsa_prepare(&dsa, &rc2[k], &source, &target);
+
+            // Start at -1 to do a warm-up run
+            for (int i = -1; sp_measure_more(&rc2[k], i); i++) {
+                if (i!=-1 && cache_mode != CACHE_WARM) clear_caches(&rc2[k], &source, &target, cfg_source_size[k], cfg_target_size[k]);
+                if (i!=-1) sg_zero_time();
+                if (energy_flag && i!=-1) sp_energy_start();
+                sp_dsa_run(&dsa);
+                if (energy_flag && i!=-1) sp_energy_stop(&rc2[k].energy[i]);
+                if (i!=-1) rc2[k].time_ms[i] = sg_get_time_ms();
+            }
+            sp_dsa_release(&dsa);
+        }
+        #endif // USE_DSA
+
         // Time OpenMP Kernel
         #ifdef USE_OPENMP
-        if (backend == OPENMP) {
+        if (backend == OPENMP && rma_mode == RMA_NONE && !dsa_wq[0]) {
             omp_set_num_threads(rc2[k].omp_threads);
+            if (sweep_mbs)
+                sp_pin_team(thread_sweep.policy, rc2[k].omp_threads);
+            if (min_sample_ms > 0 && !trace)
+                rc2[k].inner_reps = calibrate_reps(sp_run_omp_kernel, &rc2[k], &source, &target, &chase);
+            if (rate_hists) {
+                if (rc2[k].kernel != GATHER || trace || rc2[k].random_seed >= 1 || rc2[k].deltas_len > 1 || rc2[k].ro_morton ||
+                        rc2[k].ro_hilbert || rc2[k].elem != ELEM_F64 || rc2[k].index_bits == 16 || rc2[k].index_bits == 32 ||
+                        rc2[k].prefetch_distance > 0 || rc2[k].op != OP_COPY || rc2[k].store != STORE_PLAIN || numa_mode == NUMA_REPLICATE)
+                    error("--rate only supports copy Gathers with a single delta, without --random, --morton, --hilbert, --elem, --index-bits, --prefetch-distance, --store, --numa=replicate or traces", ERROR);
+                for (size_t t = 0; t < max_ptrs; t++)
+                    sp_hist_clear(&rate_hists[t]);
+            }
 
             // Start at -1 to do a cache warm
-            for (int i = -1; i < (int) rc2[k].nruns; i++) {
+            if (noise_gbs) sp_noise_begin();
+            for (int i = -1; sp_measure_more(&rc2[k], i); i++) {
+                if (trace && i!=-1) sp_trace_rewind(trace);
+                if (i == 0) sp_thread_stats_reset();
+                if (i!=-1 && cache_mode != CACHE_WARM) clear_caches(&rc2[k], &source, &target, cfg_source_size[k], cfg_target_size[k]);
                 if (i!=-1) sg_zero_time();
+                if (energy_flag && i!=-1) sp_energy_start();
 #ifdef USE_PAPI
-                if (i!=-1) profile_start(EventSet, __LINE__, __FILE__);
-#endif
-
-                switch (rc2[k].kernel) {
-                    case MULTISCATTER:
-                      if (rc2[k].random_seed >= 1) {
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multiscatter_smallbuf_random(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_scatter, rc2[k].pattern_scatter_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].random_seed);
-                      }
-                      else if (rc2[k].op == OP_COPY) {
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multiscatter_smallbuf(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_scatter, rc2[k].pattern_scatter_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                      }
-                      break;
-                    case MULTIGATHER:
-                      if (rc2[k].random_seed >= 1) {
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multigather_smallbuf_random(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_gather, rc2[k].pattern_gather_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].random_seed);
-                      }
-                      else if (rc2[k].deltas_len <= 1) {
-                        if (rc2[k].ro_morton || rc2[k].ro_hilbert) {
-#ifdef USE_MPI
-                          MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                          multigather_smallbuf_morton(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_gather, rc2[k].pattern_gather_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].ro_order);
-                        }
-                        else {
-#ifdef USE_MPI
-                          MPI_Barrier(MPI_COMM_WORLD);
+                if (i!=-1) papi_sets_start(&papi_sets, rc2[k].omp_threads);
 #endif
-                          multigather_smallbuf(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_gather, rc2[k].pattern_gather_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                        }
-                      }
-                      else {
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multigather_smallbuf_multidelta(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_gather, rc2[k].pattern_gather_len, rc2[k].deltas_ps, rc2[k].generic_len, rc2[k].wrap, rc2[k].deltas_len);
-                      }
-                      break;
-                    case GS:
-                        /*
-                        if (rc2[k].op == OP_COPY) {
-                            //sg_omp (target.host_ptr, ti.host_ptr, source.host_ptr, si.host_ptr,index_len);
-                        } else {
-                            //sg_accum_omp (target.host_ptr, ti.host_ptr, source.host_ptr, si.host_ptr, index_len);
-                        }
-                        */
-                        assert(rc2[k].pattern_gather_len == rc2[k].pattern_scatter_len);
 
 #ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        sg_smallbuf(source.host_ptr, target.host_ptr, rc2[k].pattern_gather, rc2[k].pattern_scatter, rc2[k].pattern_gather_len, rc2[k].delta_gather, rc2[k].delta_scatter, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    case SCATTER:
-                        if (rc2[k].random_seed >= 1) {
-#ifdef USE_MPI
-                            MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                            scatter_smallbuf_random(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].random_seed);
-                        }
-                        else if (rc2[k].op == OP_COPY) {
-#ifdef USE_MPI
-                            MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                            scatter_smallbuf(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                            // scatter_omp (target.host_ptr, ti.host_ptr, source.host_ptr, si.host_ptr, index_len);
-                        } else {
-                            // scatter_accum_omp (target.host_ptr, ti.host_ptr, source.host_ptr, si.host_ptr, index_len);
-                        }
-                        break;
-                    case GATHER:
-                        if (rc2[k].random_seed >= 1) {
-#ifdef USE_MPI
-                            MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                            gather_smallbuf_random(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].random_seed);
-                        }
-                        else if (rc2[k].deltas_len <= 1) {
-                            if (rc2[k].ro_morton || rc2[k].ro_hilbert) {
-#ifdef USE_MPI
-                                MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                                gather_smallbuf_morton(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap, rc2[k].ro_order);
-                            } else {
-#ifdef USE_MPI
-                                MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                                gather_smallbuf(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                            }
-                        } else {
-#ifdef USE_MPI
-                            MPI_Barrier(MPI_COMM_WORLD);
+                MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                            gather_smallbuf_multidelta(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].deltas_ps, rc2[k].generic_len, rc2[k].wrap, rc2[k].deltas_len);
-                        }
-                        break;
-                    default:
-                        printf("Error: Unable to determine kernel\n");
-                        break;
-                }
+                if (rate_hists)
+                    gather_smallbuf_paced(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta,
+                        rc2[k].generic_len, rc2[k].wrap, rate_ticks, i != -1 ? rate_hists : NULL);
+                else if (rc2[k].inner_reps > 0)
+                    run_reps(sp_run_omp_kernel, &rc2[k], &source, &target, trace, &chase);
+                else
+                sp_run_omp_kernel(&rc2[k], &source, &target, trace, &chase);
 
 #ifdef USE_PAPI
-                if (i!= -1) profile_stop(EventSet, rc2[k].papi_ctr[i], __LINE__, __FILE__);
+                if (i!= -1) papi_sets_stop(&papi_sets, rc2[k].omp_threads, papi_nevents, rc2[k].papi_ctr[i], rc2[k].papi_thread);
 #endif
 
 #ifdef USE_MPI
                 MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                if (i!= -1) rc2[k].time_ms[i] = sg_get_time_ms();
+                if (energy_flag && i!=-1) sp_energy_stop(&rc2[k].energy[i]);
+                if (i!= -1) rc2[k].time_ms[i] = run_time_ms(&rc2[k]);
 
             }
+            if (noise_gbs) noise_gbs[k] = sp_noise_end();
+            for (size_t t = 0; rate_hists && t < rc2[k].omp_threads; t++)
+                sp_hist_merge(&rate_hist[k], &rate_hists[t]);
+
+            if (busy_flag)
+                stats_nt[k] = sp_thread_stats(&thread_stats[k * max_ptrs], max_ptrs);
+
+            if (compose_flag && composable(&rc2[k]))
+                compose_ms[k] = run_composed(&rc2[k], &source, &target);
+
+            if (cache_mode != CACHE_WARM)
+                warm_ms[k] = run_warm(sp_run_omp_kernel, &rc2[k], &source, &target, trace, &chase);
+
+            if (sweep_mbs)
+                run_thread_sweep(sp_run_omp_kernel, &rc2[k], &source, &target, trace, &chase, &sweep_mbs[k * thread_sweep.n]);
+
+            if (checks)
+                sp_validate(sp_run_omp_kernel, &rc2[k], &source, &target, &checks[k]);
 
             //report_time2(rc2, nrc);
         }
@@ -833,80 +2135,193 @@ int main(int argc, char **argv)
 
         // Time Serial Kernel
         #ifdef USE_SERIAL
-        if (backend == SERIAL) {
+        if (backend == SERIAL && rma_mode == RMA_NONE) {
+            if (min_sample_ms > 0 && !trace)
+                rc2[k].inner_reps = calibrate_reps(sp_run_serial_kernel, &rc2[k], &source, &target, &chase);
 
-            for (int i = -1; i < (int) rc2[k].nruns; i++) {
+            if (noise_gbs) sp_noise_begin();
+            for (int i = -1; sp_measure_more(&rc2[k], i); i++) {
 
+                if (trace && i!=-1) sp_trace_rewind(trace);
+                if (i!=-1 && cache_mode != CACHE_WARM) clear_caches(&rc2[k], &source, &target, cfg_source_size[k], cfg_target_size[k]);
                 if (i!=-1) sg_zero_time();
+                if (energy_flag && i!=-1) sp_energy_start();
 #ifdef USE_PAPI
-                if (i!=-1) profile_start(EventSet, __LINE__, __FILE__);
-#endif
-
-                switch (rc2[k].kernel) {
-                    case MULTISCATTER:
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multiscatter_smallbuf_serial(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_scatter, rc2[k].pattern_scatter_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    case MULTIGATHER:
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        multigather_smallbuf_serial(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_gather, rc2[k].pattern_gather_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    case SCATTER:
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
-#endif
-                        scatter_smallbuf_serial(source.host_ptr, target.host_ptrs, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    case GATHER:
-#ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
+                if (i!=-1) papi_sets_start(&papi_sets, 1);
 #endif
-                        gather_smallbuf_serial(target.host_ptrs, source.host_ptr, rc2[k].pattern, rc2[k].pattern_len, rc2[k].delta, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    case GS:
-                        assert(rc2[k].pattern_gather_len == rc2[k].pattern_scatter_len);
 
 #ifdef USE_MPI
-                        MPI_Barrier(MPI_COMM_WORLD);
+                MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                        sg_smallbuf_serial(target.host_ptr, source.host_ptr, rc2[k].pattern_gather, rc2[k].pattern_scatter, rc2[k].pattern_gather_len, rc2[k].delta_gather, rc2[k].delta_scatter, rc2[k].generic_len, rc2[k].wrap);
-                        break;
-                    default:
-                        printf("Error: Unable to determine kernel\n");
-                        break;
-                }
+                if (rc2[k].inner_reps > 0)
+                    run_reps(sp_run_serial_kernel, &rc2[k], &source, &target, trace, &chase);
+                else
+                sp_run_serial_kernel(&rc2[k], &source, &target, trace, &chase);
 
                 //double time_ms = sg_get_time_ms();
                 //if (i!=0) report_time(k, time_ms/1000., rc2[k], i);
 #ifdef USE_PAPI
-                if (i!= -1) profile_stop(EventSet, rc2[k].papi_ctr[i], __LINE__, __FILE__);
+                if (i!= -1) papi_sets_stop(&papi_sets, 1, papi_nevents, rc2[k].papi_ctr[i], rc2[k].papi_thread);
 #endif
 
 #ifdef USE_MPI
                 MPI_Barrier(MPI_COMM_WORLD);
 #endif
-                if (i!= -1) rc2[k].time_ms[i] = sg_get_time_ms();
+                if (energy_flag && i!=-1) sp_energy_stop(&rc2[k].energy[i]);
+                if (i!= -1) rc2[k].time_ms[i] = run_time_ms(&rc2[k]);
             }
+            if (noise_gbs) noise_gbs[k] = sp_noise_end();
+
+            if (cache_mode != CACHE_WARM)
+                warm_ms[k] = run_warm(sp_run_serial_kernel, &rc2[k], &source, &target, trace, &chase);
+
+            if (checks)
+                sp_validate(sp_run_serial_kernel, &rc2[k], &source, &target, &checks[k]);
         }
         #endif // USE_SERIAL
+
+        // Only rank 0 reports the profile
+        if (reuse && mpi_rank == 0)
+            sp_reuse_analyze(&rc2[k], &reuse[k]);
+
+        if (output_format != OUTPUT_NONE && mpi_rank == 0) {
+            struct sp_traffic tr = {0};
+            if (traffic_flag)
+                sp_traffic_model(&rc2[k], &tr);
+            struct sp_pattern_stats ps = {0};
+            if (analyze_flag)
+                sp_pattern_analyze(&rc2[k], &ps);
+            sp_output_run(suite_idx[k], &rc2[k], sp_config_bytes(&rc2[k]), traffic_flag ? &tr : NULL, analyze_flag ? &ps : NULL,
+                    reuse ? &reuse[k] : NULL);
+        }
+
+        if (trace) {
+            sp_trace_close(trace);
+        }
+        if (rc2[k].kernel == CHASE) {
+            sp_chase_release(&chase);
+            sp_fill_source(&source, target.nptrs);
+        }
+    }
+
+#ifdef USE_OPENMP
+    double *corun_ms = NULL;
+    if (corun_flag) {
+        corun_ms = (double*)calloc(nrc, sizeof(double));
+        sp_sched_instrument(0);
+#ifdef USE_MPI
+        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+        co_run(rc2, nrc, cfg_source_size, cfg_target_size, corun_ms);
     }
+#endif
 
 #ifdef USE_MPI
     MPI_Barrier(MPI_COMM_WORLD);
 #endif
 
-    report_time2(rc2, nrc);
+    int regressions = 0;
+    int invalid = 0;
+    if (mpi_rank == 0) {
+        report_time2(rc2, nrc);
+        report_chase(rc2, nrc);
+        if (baseline_file[0])
+            regressions = report_baseline(rc2, nrc);
+    }
+    if (reuse) {
+        if (mpi_rank == 0)
+            report_reuse(rc2, nrc, reuse);
+        free(reuse);
+    }
+#ifdef USE_OPENMP
+    if (corun_flag) {
+        if (mpi_rank == 0)
+            report_corun(rc2, nrc, corun_ms);
+        free(corun_ms);
+    }
+    if (compose_flag) {
+        if (mpi_rank == 0)
+            report_compose(rc2, nrc, compose_ms);
+    }
+    free(compose_ms);
+    if (sweep_mbs) {
+        if (mpi_rank == 0)
+            report_thread_sweep(rc2, nrc, sweep_mbs);
+        free(sweep_mbs);
+    }
+    if (rate_hists) {
+        if (mpi_rank == 0)
+            report_rate(rc2, nrc, rate_hist);
+        sp_free(rate_hists);
+        free(rate_hist);
+    }
+#endif
+#if defined( USE_OPENMP ) || defined( USE_SERIAL )
+    if (min_sample_ms > 0 && mpi_rank == 0)
+        report_reps(rc2, nrc);
+    if (cache_mode != CACHE_WARM) {
+        if (mpi_rank == 0)
+            report_cache(rc2, nrc, warm_ms);
+        sp_evict_free();
+    }
+    free(warm_ms);
+    if (noise_gbs) {
+        sp_noise_stop();
+        if (mpi_rank == 0)
+            report_noise(rc2, nrc, noise_gbs);
+        free(noise_gbs);
+    }
+    if ((source_tier.n || target_tier.n) && mpi_rank == 0)
+        report_tier(rc2, nrc, &source, &target);
+    if (checks) {
+        if (mpi_rank == 0)
+            invalid = report_validate(rc2, nrc, checks);
+        free(checks);
+    }
+#endif
+#ifdef USE_CUDA
+    if (multidev) {
+        if (mpi_rank == 0)
+            report_device_times(rc2, nrc, dev_best_ms);
+        free(dev_best_ms);
+    }
+    if (tunes) {
+        if (mpi_rank == 0)
+            report_autotune(rc2, nrc, tunes);
+        free(tunes);
+    }
+#endif
+#ifdef USE_OPENMP
+    if (busy_flag) {
+        if (mpi_rank == 0)
+            report_thread_stats(rc2, nrc, thread_stats, stats_nt, max_ptrs);
+        free(thread_stats);
+        free(stats_nt);
+    }
+#endif
+#if defined( USE_OPENMP ) && defined( USE_PAPI )
+    if (backend == OPENMP && rma_mode == RMA_NONE && !dsa_wq[0] && papi_nevents > 0 && mpi_rank == 0)
+        report_papi_threads(rc2, nrc);
+#endif
+#ifdef USE_MPI
+    if (mpi_ranks > 1)
+        report_mpi(rc2, nrc);
+#endif
 
 #ifdef USE_CUDA
-    cudaMemcpy(source.host_ptr, source.dev_ptr_cuda, source.size, cudaMemcpyDeviceToHost);
+    if (source.dev_ptr_cuda != source.host_ptr)
+        cudaMemcpy(source.host_ptr, source.dev_ptr_cuda, source.size, cudaMemcpyDeviceToHost);
+#endif
+#ifdef USE_OPENCL
+    if (backend == OPENCL) {
+        CALL_CL_GUARDED(clEnqueueReadBuffer, (queue, source.dev_ptr_opencl, CL_TRUE, 0, source.size, source.host_ptr, 0, NULL, NULL));
+        free(kernel_string);
+    }
 #endif
     int good = 0;
     int bad  = 0;
-    for (size_t i = 0; i < source.len; i++) {
+    // Reading all of a sparse source would map every page of it
+    for (size_t i = 0; i < source.len && !sparse_source_flag; i++) {
         if (source.host_ptr[i] == 1337.) {
             good++;
         }else {
@@ -921,68 +2336,38 @@ int main(int argc, char **argv)
     // =======================================
     #ifdef VALIDATE
     if(validate_flag) {
-        // Validate that the last item written to buffer is actually there
+        // Validate that the last item written to buffer is actually there.
+        // The CPU backends are checked in full by sp_validate above.
         // Supported kernels for this last write validation are:
-        // 
-        // OPENMP:
-        // scatter_smallbuf
-        // gather_smallbuf
-        // gather_smallbuf_morton
         //
         // CUDA:
         // scatter_block
+        // cuda_scatter_morton
         // gather_block
         // gather_block_morton
-        // gather_block_stride
-
-        #ifdef USE_OPENMP
-            if (backend == OPENMP) {
-                // use the last run config
-                struct run_config *rc_final = rc2 + (nrc - 1);
-                if (rc_final->op == OP_COPY) { //accum kernel validation currently not supported
-                    char is_written_data_missing = 1; //
-                    sgData_t *source_data_ptr = source.host_ptr + rc_final->delta * (rc_final->generic_len - 1);
-                    if (rc_final->ro_morton || rc_final->ro_hilbert) {
-                        source_data_ptr = source.host_ptr + rc_final->delta * rc_final->ro_order[rc_final->generic_len - 1];
-                    } else {
-                        source_data_ptr = source.host_ptr + rc_final->delta * (rc_final->generic_len - 1);
-                    }
-                    // we don't know which thread wrote the data, so check all targets
-                    for (int t = 0; t < rc_final->omp_threads; t++) {
-                        sgData_t *target_data_ptr = target.host_ptrs[t] + rc_final->pattern_len * ((rc_final->generic_len - 1) % rc_final->wrap);
-                        //check that all data in the pattern is written
-                        char matches_pattern = 1;
-                        for (int d = 0; d < rc_final->pattern_len; d++) { 
-                            if (source_data_ptr[rc_final->pattern[d]] != target_data_ptr[d]) {
-                                matches_pattern = 0;
-                                break;
-                            }
-                        }
-                        if (matches_pattern) {
-                            is_written_data_missing = 0;
-                            break;
-                        }
-                    }
-                    if (is_written_data_missing) {
-                        printf("VALIDATION ERROR: The data that was supposed to be last written to buffer is missing\n");
-                    }
-                }
-            }
-        #endif
+        // gather_block_multidelta
 
         #ifdef USE_CUDA
-                if (backend == CUDA) {
+                // A multi-device run has no single last-written element,
+                // and the box kernels do not record theirs
+                if (backend == CUDA && !multidev && rc2[nrc - 1].box_op == BOX_NONE) {
                     char is_written_data_missing = 1;
                     struct run_config *rc_final = rc2 + (nrc - 1);
                     size_t V = rc_final->pattern_len;
                     double src = (source.host_ptr + (final_block_idx * (rc_final->local_work_size / V) + final_thread_idx / V) * rc_final->delta)[rc_final->pattern[final_thread_idx % V]];
                     if (rc_final->kernel == SCATTER) {
+                        if (rc_final->ro_morton || rc_final->ro_hilbert) {
+                            src = (source.host_ptr + rc_final->ro_order[final_block_idx * (rc_final->local_work_size / V) + final_thread_idx / V] * rc_final->delta)[rc_final->pattern[final_thread_idx % V]];
+                        }
                         is_written_data_missing = src != rc_final->pattern[final_thread_idx % V];
                     } else if (rc_final->kernel == GATHER) {
-                        if (rc_final->ro_morton) {
+                        if (rc_final->ro_morton || rc_final->ro_hilbert) {
                             src = (source.host_ptr + (final_block_idx * (rc_final->local_work_size / V) + rc_final->ro_order[final_thread_idx / V]) * rc_final->delta)[rc_final->pattern[final_thread_idx % V]];
-                        } else if (rc_final->stride_kernel >= 0) {
-                            src = (source.host_ptr + (final_block_idx * (rc_final->local_work_size / V) + final_thread_idx / V) * rc_final->delta)[rc_final->pattern[rc_final->stride_kernel * (final_thread_idx % V)]];
+                        } else if (rc_final->deltas_len > 1 || rc_final->stride_kernel >= 0) {
+                            size_t g = final_block_idx * (rc_final->local_work_size / V) + final_thread_idx / V;
+                            size_t j = final_thread_idx % V;
+                            ssize_t off = rc_final->stride_kernel >= 0 ? (ssize_t)rc_final->stride_kernel * j : rc_final->pattern[j];
+                            src = (source.host_ptr + sp_config_base(rc_final, rc_final->delta, g, rc_final->generic_len))[off];
                         }
                         is_written_data_missing = src != final_gather_data;
                     }
@@ -995,36 +2380,59 @@ int main(int argc, char **argv)
     #endif
 
     // Free Memory
-    free(source.host_ptr);
+    free(cfg_source_size);
+    free(cfg_target_size);
+    sp_free(source.host_ptr);
     for (size_t i = 0; i < target.nptrs; i++) {
-      free(target.host_ptrs[i]);
+      sp_free(target.host_ptrs[i]);
     }
     if (target.nptrs != 0) {
       free(target.host_ptrs);
     }
+    if (source_replicas) {
+        for (int n = 0; n < sp_numa_num_nodes(); n++) {
+            sp_free(source_replicas[n]);
+        }
+        free(source_replicas);
+        free(source.host_ptrs);
+    }
 
     for (int i = 0; i < nrc; i++) {
-        if (rc2[i].pattern) free(rc2[i].pattern);
-        if (rc2[i].deltas) free(rc2[i].deltas);
-        if (rc2[i].deltas_ps) free(rc2[i].deltas_ps);
-        if (rc2[i].ro_order) {
-            free(rc2[i].ro_order);
-        }
+        free_config(&rc2[i]);
         free(rc2[i].time_ms);
+        free(rc2[i].energy);
 #ifdef USE_PAPI
-        for (int j = 0; j < rc2[i].nruns; j++){
+        for (int j = 0; j < sp_measure_slots(&rc2[i]); j++){
             free(rc2[i].papi_ctr[j]);
         }
         free(rc2[i].papi_ctr);
+        free(rc2[i].papi_thread);
 #endif
     }
+#ifdef USE_PAPI
+    papi_sets_destroy(&papi_sets);
+#endif
 
   free(rc);
+  free(suite_idx);
+  if (energy_flag)
+      sp_energy_finalize();
+  sp_output_close();
+  sp_baseline_free();
   //printf("Mem used: %lld MiB\n", get_mem_used()/1024/1024);
  
+#ifdef USE_DSA
+  if (dsa_wq[0])
+      sp_dsa_close(&dsa);
+#endif
 #ifdef USE_MPI 
+  if (rma_mode != RMA_NONE)
+      sp_rma_destroy(&rma);
   MPI_Finalize();
 #endif
+  if (invalid)
+      return SP_EXIT_INVALID;
+  return regressions ? SP_EXIT_REGRESSION : 0;
 } //end main
 
 void emit_configs(struct run_config *rc, int nconfigs)
@@ -1044,20 +2452,9 @@ void emit_configs(struct run_config *rc, int nconfigs)
         printf("\'name\':\'%s\', ", rc[i].name);
 
         // Kernel
-        switch (rc[i].kernel) {
-        case GATHER:
-            printf("\'kernel\':\'Gather\', ");
-            break;
-        case SCATTER:
-            printf("\'kernel\':\'Scatter\', ");
-            break;
-        case GS:
-            printf("\'kernel\':\'GS\', ");
-            break;
-        case INVALID_KERNEL:
+        if (rc[i].kernel == INVALID_KERNEL)
             error ("Invalid kernel sent to emit_configs", ERROR);
-            break;
-        }
+        printf("\'kernel\':\'%s\', ", sp_config_kernel_name(&rc[i]));
 
         // Pattern
         printf("\'pattern\':[");
@@ -1182,72 +2579,37 @@ void emit_configs(struct run_config *rc, int nconfigs)
             printf(", \'roblock\':%d", rc[i].ro_block);
         }
 
-        printf("}");
-
-        if (i != nconfigs-1) {
-            printf(",\n");
+        if (rc[i].kernel == CHASE) {
+            printf(", \'chains\':%zu", rc[i].chains);
         }
 
-    }
-    printf(" ]\n\n");
-}
-
-// From http://www.codecodex.com/wiki/Calculate_an_integer_square_root
-uint64_t isqrt(uint64_t x)
-{
-    uint64_t op, res, one;
-
-    op = x;
-    res = 0;
+        if (rc[i].store == STORE_NT) {
+            printf(", \'store\':'nt'");
+        }
 
-    /* "one" starts at the highest power of four <= than the argument. */
-    one = 1 << 30;  /* second-to-top bit set */
-    while (one > op) one >>= 2;
+        if (rc[i].elem != ELEM_F64) {
+            const char *elems[] = {"f64", "f32", "i32", "i64", "c64"};
+            if (rc[i].elem == ELEM_BYTES)
+                printf(", \'elem\':'bytes:%zu'", rc[i].elem_size);
+            else
+                printf(", \'elem\':'%s'", elems[rc[i].elem]);
+        }
 
-    while (one != 0) {
+        if (rc[i].index_bits == 16 || rc[i].index_bits == 32) {
+            printf(", \'index-bits\':%d", rc[i].index_bits);
+        }
 
-        if (op >= res + one) {
-            op -= res + one;
-            res += one << 1;  // <-- faster than 2 * one
+        if (rc[i].prefetch_distance > 0) {
+            printf(", \'prefetch-distance\':%zu, \'prefetch-hint\':'%s', \'prefetch-scope\':'%s'", rc[i].prefetch_distance,
+                    rc[i].prefetch_hint == PREFETCH_NTA ? "nta" : "t0", rc[i].prefetch_line ? "line" : "pattern");
         }
-        res >>= 1;
-        one >>= 2;
-    }
-    return res;
-}
 
-// From https://gist.github.com/anonymous/729557
-uint64_t icbrt(uint64_t x) {
-    int s;
-    uint64_t y;
-    uint64_t b;
-    y = 0;
-    for (s = 63; s >= 0; s -= 3) {
-        y += y;
-        b = 3*y*((uint64_t) y + 1) + 1;
-        if ((x >> s) >= b) {
-                x -= b << s;
-                y++;
-        }
-    }
-    return y;
-}
+        printf("}");
 
-// Remap large pattern with heap accesses to fit within Spatter 
-spIdx_t remap_pattern(const int nrc, ssize_t *pattern, const spSize_t pattern_len, ssize_t boundary) {
-    if (boundary == -1)
-        boundary = (((SP_MAX_ALLOC - 1) / sizeof(sgData_t)) / nrc) / 2;  
-  
-    for (size_t j = 0; j < pattern_len; ++j) {
-        pattern[j] = pattern[j] % boundary;
-    }
-    
-    spIdx_t max_pattern_val = pattern[0];
-    for (size_t j = 0; j < pattern_len; j++) {
-        if (pattern[j] > max_pattern_val) {
-            max_pattern_val = pattern[j];
+        if (i != nconfigs-1) {
+            printf(",\n");
         }
-    }
 
-    return max_pattern_val;
+    }
+    printf(" ]\n\n");
 }
@@ -0,0 +1,183 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "measure.h"
+#include "energy.h"
+
+#if defined( USE_MPI )
+#include "mpi.h"
+#endif
+
+static struct
+{
+    double target_ci; // 0 without --target-ci
+    double budget_ms;
+    size_t max_runs;
+
+    // State of the config being measured
+    double start_ms;
+    size_t warm;
+    int warmed;
+} measure = { 0, SP_TIME_BUDGET * 1000, SP_MAX_RUNS };
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void sp_measure_set(double target_ci, double budget_s, size_t max_runs)
+{
+    measure.target_ci = target_ci;
+    measure.budget_ms = budget_s * 1000;
+    measure.max_runs = max_runs;
+}
+
+int sp_measure_adaptive(void)
+{
+    return measure.target_ci > 0;
+}
+
+size_t sp_measure_slots(const struct run_config *rc)
+{
+    return sp_measure_adaptive() ? measure.max_runs : rc->nruns;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Two-sided 95% quantiles of Student's t for 1 to 30 degrees of freedom
+static const double t95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+// Half-width of the 95% CI of the mean bandwidth over its mean. The bytes
+// are the same in every run, so 1/time stands in for the bandwidth.
+static double rel_ci(const double *time_ms, size_t n)
+{
+    if (n < 2)
+        return INFINITY;
+    double mean = 0, var = 0;
+    for (size_t i = 0; i < n; i++)
+        mean += 1. / time_ms[i];
+    mean /= n;
+    for (size_t i = 0; i < n; i++)
+        var += (1. / time_ms[i] - mean) * (1. / time_ms[i] - mean);
+    var /= n - 1;
+    double t = n - 1 <= 30 ? t95[n - 2] : 1.96;
+    return t * sqrt(var / n) / mean;
+}
+
+static int stable(const double *time_ms, size_t n)
+{
+    double min = time_ms[0], max = time_ms[0];
+    for (size_t i = 1; i < n; i++) {
+        if (time_ms[i] < min)
+            min = time_ms[i];
+        if (time_ms[i] > max)
+            max = time_ms[i];
+    }
+    return max - min <= SP_WARMUP_TOL * min;
+}
+
+// Decide on the times of rank 0 and tell the other ranks, so that they
+// all do the same number of runs
+static void share_decision(int *more, size_t *warm)
+{
+#if defined( USE_MPI )
+    int init = 0;
+    MPI_Initialized(&init);
+    if (init) {
+        long long d[2] = {*more, (long long)*warm};
+        MPI_Bcast(d, 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        *more = (int)d[0];
+        *warm = (size_t)d[1];
+    }
+#else
+    (void)more;
+    (void)warm;
+#endif
+}
+
+int sp_measure_more(struct run_config *rc, int i)
+{
+    if (!sp_measure_adaptive())
+        return i < (int)rc->nruns;
+    if (i < 0)
+        return 1;
+
+    size_t n = (size_t)i;
+    if (n == 0) {
+        measure.start_ms = now_ms();
+        measure.warm = 0;
+        measure.warmed = 0;
+        return 1;
+    }
+
+    if (!measure.warmed && n >= SP_WARMUP_WINDOW) {
+        measure.warm = n - SP_WARMUP_WINDOW;
+        if (stable(&rc->time_ms[measure.warm], SP_WARMUP_WINDOW) || measure.warm >= SP_MAX_WARMUP)
+            measure.warmed = 1;
+    }
+
+    int more = 1;
+    if (n >= measure.max_runs || now_ms() - measure.start_ms >= measure.budget_ms)
+        more = 0;
+    else if (measure.warmed && n - measure.warm >= SP_MIN_RUNS &&
+            rel_ci(&rc->time_ms[measure.warm], n - measure.warm) <= measure.target_ci)
+        more = 0;
+
+    size_t warm = measure.warm;
+    share_decision(&more, &warm);
+    if (more)
+        return 1;
+
+    // Drop the warm-up runs
+    rc->warmup_runs = warm;
+    rc->nruns = n - warm;
+    memmove(rc->time_ms, rc->time_ms + warm, sizeof(double) * rc->nruns);
+    if (rc->energy)
+        memmove(rc->energy, rc->energy + warm, sizeof(*rc->energy) * rc->nruns);
+#ifdef USE_PAPI
+    // Rotate rather than copy, every counter array is freed at the end
+    for (size_t w = 0; w < warm; w++) {
+        long long *first = rc->papi_ctr[0];
+        memmove(rc->papi_ctr, rc->papi_ctr + 1, sizeof(long long *) * (measure.max_runs - 1));
+        rc->papi_ctr[measure.max_runs - 1] = first;
+    }
+#endif
+    return 0;
+}
+
+void sp_run_stats(const double *time_ms, size_t n, struct sp_run_stats *s)
+{
+    memset(s, 0, sizeof(*s));
+    if (n == 0)
+        return;
+
+    double *sorted = (double *)malloc(sizeof(double) * n);
+    memcpy(sorted, time_ms, sizeof(double) * n);
+    qsort(sorted, n, sizeof(double), compare_double);
+
+    s->median_ms = n % 2 ? sorted[n/2] : (sorted[n/2 - 1] + sorted[n/2]) / 2;
+    s->ci = n > 1 ? rel_ci(time_ms, n) : 0;
+
+    double q1 = sorted[n/4];
+    double q3 = sorted[3*n/4];
+    double iqr = q3 - q1;
+    for (size_t i = 0; i < n; i++)
+        if (sorted[i] < q1 - 1.5 * iqr || sorted[i] > q3 + 1.5 * iqr)
+            s->outliers++;
+    free(sorted);
+}
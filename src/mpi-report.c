@@ -0,0 +1,34 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mpi-report.h"
+
+size_t sp_mpi_share(size_t n, int rank, int nranks)
+{
+    return n * (rank + 1) / nranks - n * rank / nranks;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int sp_find_stragglers(const double *time, int nranks, double threshold, double *median, int *ranks, int max_ranks)
+{
+    double *sorted = (double *)malloc(sizeof(double) * nranks);
+    memcpy(sorted, time, sizeof(double) * nranks);
+    qsort(sorted, nranks, sizeof(double), compare_double);
+    *median = nranks % 2 ? sorted[nranks/2] : (sorted[nranks/2 - 1] + sorted[nranks/2]) / 2;
+    free(sorted);
+
+    int n = 0;
+    for (int r = 0; r < nranks; r++) {
+        if (time[r] > threshold * *median) {
+            if (n < max_ranks)
+                ranks[n] = r;
+            n++;
+        }
+    }
+    return n;
+}
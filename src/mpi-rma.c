@@ -0,0 +1,146 @@
+#ifdef USE_MPI
+#include <stdlib.h>
+#include <string.h>
+#include "mpi-rma.h"
+
+// Ranks a Gather can go to, and the g-th of them seen from rank
+static int num_dests(int nranks)
+{
+    return nranks > 1 ? nranks - 1 : 1;
+}
+
+static int dest_rank(int rank, int nranks, int g)
+{
+    return (rank + 1 + g) % nranks;
+}
+
+static MPI_Datatype element_type(void)
+{
+    static MPI_Datatype elem = MPI_DATATYPE_NULL;
+    if (elem == MPI_DATATYPE_NULL) {
+        MPI_Type_contiguous(sizeof(sgData_t), MPI_BYTE, &elem);
+        MPI_Type_commit(&elem);
+    }
+    return elem;
+}
+
+void sp_rma_create(struct sp_rma *rma, sgDataBuf *source)
+{
+    memset(rma, 0, sizeof(*rma));
+    rma->len = source->len;
+    rma->pattern = MPI_DATATYPE_NULL;
+    for (int t = 0; t < 3; t++)
+        rma->batch[t] = MPI_DATATYPE_NULL;
+
+    MPI_Win_allocate((MPI_Aint)source->size, sizeof(sgData_t), MPI_INFO_NULL, MPI_COMM_WORLD, &rma->base, &rma->win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, rma->win);
+    memcpy(rma->base, source->host_ptr, source->size);
+    MPI_Win_sync(rma->win);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void sp_rma_prepare(struct sp_rma *rma, struct run_config *rc, enum sg_rma mode, size_t batch)
+{
+    int nranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    size_t ndest = num_dests(nranks);
+    MPI_Datatype elem = element_type();
+
+    int *disp = (int *)malloc(sizeof(int) * rc->pattern_len);
+    for (size_t j = 0; j < rc->pattern_len; j++)
+        disp[j] = (int)rc->pattern[j];
+    MPI_Type_create_indexed_block(rc->pattern_len, 1, disp, elem, &rma->pattern);
+    MPI_Type_commit(&rma->pattern);
+    free(disp);
+
+    // The Gathers of one batch that go to the same rank are ndest apart
+    if (mode == RMA_AGGREGATE) {
+        size_t tail = rc->generic_len % (batch * ndest);
+        rma->batch_count[0] = batch;
+        rma->batch_count[1] = tail / ndest;
+        rma->batch_count[2] = tail / ndest + 1;
+        for (int t = 0; t < 3; t++) {
+            if (rma->batch_count[t] == 0)
+                continue;
+            MPI_Type_create_hvector(rma->batch_count[t], 1, (MPI_Aint)(rc->delta * ndest * sizeof(sgData_t)), rma->pattern, &rma->batch[t]);
+            MPI_Type_commit(&rma->batch[t]);
+        }
+    }
+
+    rma->scratch = (sgData_t *)malloc(sizeof(sgData_t) * batch * ndest * rc->pattern_len);
+}
+
+static MPI_Datatype batch_type(struct sp_rma *rma, size_t count)
+{
+    for (int t = 0; t < 3; t++)
+        if (rma->batch_count[t] == count)
+            return rma->batch[t];
+    return MPI_DATATYPE_NULL;
+}
+
+// Get or Put count elements of origin according to type at disp
+static void transfer(int get, sgData_t *origin, int count, int dest, MPI_Aint disp, MPI_Datatype type, MPI_Win win)
+{
+    if (get)
+        MPI_Get(origin, count, element_type(), dest, disp, 1, type, win);
+    else
+        MPI_Put(origin, count, element_type(), dest, disp, 1, type, win);
+}
+
+void sp_rma_run(struct sp_rma *rma, struct run_config *rc, enum sg_rma mode, size_t batch)
+{
+    int rank, nranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+    size_t ndest = num_dests(nranks);
+    size_t n = rc->generic_len;
+    size_t len = rc->pattern_len;
+    size_t block = batch * ndest;
+    int get = rc->kernel == GATHER;
+
+    for (size_t i0 = 0; i0 < n; i0 += block) {
+        size_t iend = i0 + block < n ? i0 + block : n;
+
+        if (mode == RMA_AGGREGATE) {
+            size_t rem = iend - i0;
+            for (size_t g = 0; g < ndest && g < rem; g++) {
+                size_t count = (rem - g + ndest - 1) / ndest;
+                transfer(get, rma->scratch + g * batch * len, count * len, dest_rank(rank, nranks, g),
+                        (MPI_Aint)(rc->delta * (i0 + g)), batch_type(rma, count), rma->win);
+            }
+        } else {
+            for (size_t i = i0; i < iend; i++) {
+                int dest = dest_rank(rank, nranks, i % ndest);
+                sgData_t *origin = rma->scratch + (i - i0) * len;
+                MPI_Aint disp = (MPI_Aint)(rc->delta * i);
+                if (mode == RMA_GATHER) {
+                    transfer(get, origin, len, dest, disp, rma->pattern, rma->win);
+                } else {
+                    for (size_t j = 0; j < len; j++)
+                        transfer(get, origin + j, 1, dest, disp + rc->pattern[j], element_type(), rma->win);
+                }
+            }
+        }
+        MPI_Win_flush_all(rma->win);
+    }
+}
+
+void sp_rma_release(struct sp_rma *rma)
+{
+    if (rma->pattern != MPI_DATATYPE_NULL)
+        MPI_Type_free(&rma->pattern);
+    for (int t = 0; t < 3; t++) {
+        if (rma->batch[t] != MPI_DATATYPE_NULL)
+            MPI_Type_free(&rma->batch[t]);
+        rma->batch_count[t] = 0;
+    }
+    free(rma->scratch);
+    rma->scratch = NULL;
+}
+
+void sp_rma_destroy(struct sp_rma *rma)
+{
+    MPI_Win_unlock_all(rma->win);
+    MPI_Win_free(&rma->win);
+}
+#endif
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mtx.h"
+#include "parse-args.h" //error
+
+// Byte ranges of the entries parsed on their own, more than the threads
+// so that uneven lines even out
+#define MTX_CHUNKS 256
+
+// Entries of one byte range, 0-based
+struct mtx_chunk
+{
+    uint64_t *row, *col;
+    size_t n, cap;
+    int bad; /**< an entry was malformed or out of range */
+};
+
+static void chunk_push(struct mtx_chunk *c, uint64_t r, uint64_t col)
+{
+    if (c->n == c->cap) {
+        c->cap = c->cap ? 2 * c->cap : 1024;
+        c->row = (uint64_t *)realloc(c->row, c->cap * sizeof(uint64_t));
+        c->col = (uint64_t *)realloc(c->col, c->cap * sizeof(uint64_t));
+    }
+    c->row[c->n] = r;
+    c->col[c->n] = col;
+    c->n++;
+}
+
+// A decimal at *p, skipping blanks, without reading past end
+static int read_u64(const char **p, const char *end, uint64_t *v)
+{
+    const char *s = *p;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    if (s == end || !isdigit((unsigned char)*s))
+        return 0;
+    uint64_t x = 0;
+    while (s < end && isdigit((unsigned char)*s))
+        x = x * 10 + (uint64_t)(*s++ - '0');
+    *p = s;
+    *v = x;
+    return 1;
+}
+
+static const char *next_line(const char *s, const char *end)
+{
+    const char *nl = (const char *)memchr(s, '\n', end - s);
+    return nl ? nl + 1 : end;
+}
+
+// Parse the entry lines of [s, end), 1-based, mirrored if symmetric
+static void parse_chunk(const char *s, const char *end, size_t nrows, size_t ncols, int symmetric, struct mtx_chunk *c)
+{
+    while (s < end) {
+        const char *line = s;
+        s = next_line(s, end);
+        uint64_t i, j;
+        const char *p = line;
+        while (p < s && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        if (p == s || *p == '\n' || *p == '%')
+            continue;
+        if (!read_u64(&p, s, &i) || !read_u64(&p, s, &j) || i < 1 || i > nrows || j < 1 || j > ncols) {
+            c->bad = 1;
+            return;
+        }
+        chunk_push(c, i - 1, j - 1);
+        if (symmetric && i != j)
+            chunk_push(c, j - 1, i - 1);
+    }
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void read_mm(const char *file, const char *map, size_t size, struct sp_csr *csr)
+{
+    const char *end = map + size;
+    const char *s = next_line(map, end);
+    char first[STRING_SIZE], header[5][32] = {{0}};
+    size_t flen = (size_t)(s - map) < sizeof(first) ? (size_t)(s - map) : sizeof(first) - 1;
+    memcpy(first, map, flen);
+    first[flen] = '\0';
+    if (sscanf(first, "%31s %31s %31s %31s %31s", header[0], header[1], header[2], header[3], header[4]) != 5 ||
+            strcasecmp(header[0], "%%MatrixMarket") || strcasecmp(header[1], "matrix"))
+        error("MTX: not a Matrix Market or binary CSR file", ERROR);
+    if (strcasecmp(header[2], "coordinate"))
+        error("MTX: only coordinate Matrix Market files hold sparse matrices", ERROR);
+    int symmetric = strcasecmp(header[4], "general") != 0;
+
+    // Comments, then the size line
+    while (s < end && (*s == '%' || *s == '\n' || *s == '\r'))
+        s = next_line(s, end);
+    uint64_t nrows, ncols, nnz;
+    const char *p = s;
+    s = next_line(s, end);
+    if (!read_u64(&p, s, &nrows) || !read_u64(&p, s, &ncols) || !read_u64(&p, s, &nnz))
+        error("MTX: size line not parsed", ERROR);
+
+    // Every chunk starts at the line its byte range starts in or after
+    const char *start[MTX_CHUNKS + 1];
+    size_t len = end - s;
+    for (int k = 0; k < MTX_CHUNKS; k++) {
+        const char *b = s + len * k / MTX_CHUNKS;
+        start[k] = b > s && b[-1] != '\n' ? next_line(b, end) : b;
+    }
+    start[MTX_CHUNKS] = end;
+
+    struct mtx_chunk *chunks = (struct mtx_chunk *)calloc(MTX_CHUNKS, sizeof(struct mtx_chunk));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int k = 0; k < MTX_CHUNKS; k++) {
+        const char *e = start[k + 1] > start[k] ? start[k + 1] : start[k];
+        parse_chunk(start[k], e, nrows, ncols, symmetric, &chunks[k]);
+    }
+
+    size_t entries = 0, lines = 0;
+    int bad = 0;
+    for (int k = 0; k < MTX_CHUNKS; k++) {
+        entries += chunks[k].n;
+        bad |= chunks[k].bad;
+    }
+    if (!bad && !symmetric)
+        lines = entries;
+    else if (!bad)
+        for (int k = 0; k < MTX_CHUNKS; k++)
+            for (size_t e = 0; e < chunks[k].n; e++)
+                lines += chunks[k].row[e] >= chunks[k].col[e];
+    if (bad || lines != nnz) {
+        printf("MTX: %s has %zu entries for %llu on its size line\n", file, lines, (unsigned long long)nnz);
+        error("MTX: malformed entries or an entry out of range", ERROR);
+    }
+
+    csr->nrows = nrows;
+    csr->ncols = ncols;
+    csr->nnz = entries;
+    csr->rowptr = (uint64_t *)calloc(nrows + 1, sizeof(uint64_t));
+    csr->col = (uint64_t *)malloc((entries + 1) * sizeof(uint64_t));
+    for (int k = 0; k < MTX_CHUNKS; k++)
+        for (size_t e = 0; e < chunks[k].n; e++)
+            csr->rowptr[chunks[k].row[e] + 1]++;
+    for (size_t r = 0; r < nrows; r++)
+        csr->rowptr[r + 1] += csr->rowptr[r];
+    uint64_t *fill = (uint64_t *)malloc((nrows + 1) * sizeof(uint64_t));
+    memcpy(fill, csr->rowptr, (nrows + 1) * sizeof(uint64_t));
+    for (int k = 0; k < MTX_CHUNKS; k++) {
+        for (size_t e = 0; e < chunks[k].n; e++)
+            csr->col[fill[chunks[k].row[e]]++] = chunks[k].col[e];
+        free(chunks[k].row);
+        free(chunks[k].col);
+    }
+    free(fill);
+    free(chunks);
+}
+
+static void read_csr(const char *map, size_t size, struct sp_csr *csr)
+{
+    uint64_t h[3];
+    if (size < 8 + sizeof(h))
+        error("MTX: binary CSR header cut short", ERROR);
+    memcpy(h, map + 8, sizeof(h));
+    csr->nrows = h[0];
+    csr->ncols = h[1];
+    csr->nnz = h[2];
+    if (h[0] > size / 8 || h[2] > size / 8 || 8 + (4 + h[0] + h[2]) * 8 != size)
+        error("MTX: binary CSR file size does not match its header", ERROR);
+
+    csr->rowptr = (uint64_t *)malloc((csr->nrows + 1) * sizeof(uint64_t));
+    csr->col = (uint64_t *)malloc((csr->nnz + 1) * sizeof(uint64_t));
+    memcpy(csr->rowptr, map + 8 + sizeof(h), (csr->nrows + 1) * sizeof(uint64_t));
+    memcpy(csr->col, map + 8 + sizeof(h) + (csr->nrows + 1) * sizeof(uint64_t), csr->nnz * sizeof(uint64_t));
+    if (csr->rowptr[0] != 0 || csr->rowptr[csr->nrows] != csr->nnz)
+        error("MTX: binary CSR row offsets do not cover the nonzeros", ERROR);
+    for (size_t r = 0; r < csr->nrows; r++)
+        if (csr->rowptr[r + 1] < csr->rowptr[r])
+            error("MTX: binary CSR row offsets decrease", ERROR);
+    for (size_t k = 0; k < csr->nnz; k++)
+        if (csr->col[k] >= csr->ncols)
+            error("MTX: binary CSR column out of range", ERROR);
+}
+
+void sp_mtx_read(const char *file, struct sp_csr *csr)
+{
+    memset(csr, 0, sizeof(*csr));
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+        error("MTX: unable to open the matrix file", ERROR);
+    if (st.st_size == 0)
+        error("MTX: matrix file is empty", ERROR);
+    const char *map = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        error("MTX: unable to mmap the matrix file", ERROR);
+
+    if ((size_t)st.st_size >= 8 && !memcmp(map, SP_CSR_MAGIC, 8))
+        read_csr(map, st.st_size, csr);
+    else
+        read_mm(file, map, st.st_size, csr);
+    munmap((void *)map, st.st_size);
+
+    // Columns of a row in order, as SpMV on CSR reads them
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t r = 0; r < csr->nrows; r++)
+        qsort(csr->col + csr->rowptr[r], csr->rowptr[r + 1] - csr->rowptr[r], sizeof(uint64_t), compare_u64);
+}
+
+void sp_csr_free(struct sp_csr *csr)
+{
+    free(csr->rowptr);
+    free(csr->col);
+    memset(csr, 0, sizeof(*csr));
+}
+
+static uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// A block of rows: its columns col[a, b) and their smallest
+struct mtx_block
+{
+    uint64_t a, b, base, delta, hash, count;
+};
+
+static int same_block(const struct sp_csr *csr, const struct mtx_block *x, const struct mtx_block *y)
+{
+    if (x->hash != y->hash || x->delta != y->delta || x->b - x->a != y->b - y->a)
+        return 0;
+    for (uint64_t j = 0; j < x->b - x->a; j++)
+        if (csr->col[x->a + j] - x->base != csr->col[y->a + j] - y->base)
+            return 0;
+    return 1;
+}
+
+// Most frequent first, ties by the first block
+static int block_cmp(const void *p, const void *q)
+{
+    const struct mtx_block *x = *(const struct mtx_block * const *)p;
+    const struct mtx_block *y = *(const struct mtx_block * const *)q;
+    if (x->count != y->count)
+        return x->count > y->count ? -1 : 1;
+    return (x->a > y->a) - (x->a < y->a);
+}
+
+int sp_mtx_configs(const struct sp_csr *csr, size_t rowblock, int nconf, struct sp_mtx_config *out, struct sp_mtx_summary *sum)
+{
+    size_t nblocks = (csr->nrows + rowblock - 1) / rowblock;
+    struct mtx_block *blk = (struct mtx_block *)calloc(nblocks + 1, sizeof(struct mtx_block));
+
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t i = 0; i < nblocks; i++) {
+        struct mtx_block *k = &blk[i];
+        size_t r0 = i * rowblock, r1 = r0 + rowblock < csr->nrows ? r0 + rowblock : csr->nrows;
+        k->a = csr->rowptr[r0];
+        k->b = csr->rowptr[r1];
+        k->base = UINT64_MAX;
+        for (size_t r = r0; r < r1; r++)
+            if (csr->rowptr[r + 1] > csr->rowptr[r] && csr->col[csr->rowptr[r]] < k->base)
+                k->base = csr->col[csr->rowptr[r]];
+        k->hash = mix64(k->b - k->a);
+        for (uint64_t j = k->a; j < k->b; j++)
+            k->hash = mix64(k->hash ^ (csr->col[j] - k->base));
+    }
+
+    // Empty blocks gather nothing. A block below the one before counts
+    // with the same stride forward, as in spatter-extract.
+    size_t n = 0;
+    uint64_t prev = 0;
+    for (size_t i = 0; i < nblocks; i++) {
+        if (blk[i].b == blk[i].a)
+            continue;
+        blk[n] = blk[i];
+        blk[n].delta = blk[n].base >= prev ? blk[n].base - prev : prev - blk[n].base;
+        blk[n].hash = mix64(blk[n].hash ^ blk[n].delta);
+        prev = blk[n].base;
+        n++;
+    }
+
+    // Count the pairs in an open-addressed table of pointers to the first
+    // block of each
+    size_t cap = 16;
+    while (cap < 2 * n)
+        cap *= 2;
+    struct mtx_block **slot = (struct mtx_block **)calloc(cap, sizeof(struct mtx_block *));
+    size_t distinct = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t s = blk[i].hash & (cap - 1);
+        while (slot[s] && !same_block(csr, slot[s], &blk[i]))
+            s = (s + 1) & (cap - 1);
+        if (!slot[s]) {
+            slot[s] = &blk[i];
+            distinct++;
+        }
+        slot[s]->count++;
+    }
+
+    struct mtx_block **top = (struct mtx_block **)malloc((distinct + 1) * sizeof(struct mtx_block *));
+    size_t m = 0;
+    for (size_t s = 0; s < cap; s++)
+        if (slot[s])
+            top[m++] = slot[s];
+    qsort(top, m, sizeof(struct mtx_block *), block_cmp);
+
+    int nout = m < (size_t)nconf ? (int)m : nconf;
+    double covered = 0;
+    for (int c = 0; c < nout; c++) {
+        struct mtx_block *k = top[c];
+        out[c].len = k->b - k->a;
+        out[c].pattern = (ssize_t *)malloc(out[c].len * sizeof(ssize_t));
+        for (size_t j = 0; j < out[c].len; j++)
+            out[c].pattern[j] = (ssize_t)(csr->col[k->a + j] - k->base);
+        out[c].delta = k->delta;
+        out[c].count = k->count;
+        covered += (double)k->count * out[c].len;
+    }
+
+    if (sum) {
+        sum->blocks = n;
+        sum->distinct = distinct;
+        sum->covered = csr->nnz ? covered / csr->nnz : 0;
+    }
+    free(top);
+    free(slot);
+    free(blk);
+    return nout;
+}
+
+void sp_mtx_configs_free(struct sp_mtx_config *c, int n)
+{
+    for (int k = 0; k < n; k++)
+        free(c[k].pattern);
+}
+
+char **sp_mtx_argv(int *argc, char **argv, int parg, const struct sp_mtx_config *c, const char *name)
+{
+    char **copy = (char **)malloc((*argc + 4) * sizeof(char *));
+    for (int i = 0; i < *argc; i++)
+        copy[i] = strdup(argv[i]);
+
+    // -pMTX:..., --pattern=MTX:... or MTX:... after a separate -p
+    size_t len = 16 + 21 * c->len;
+    char *p = (char *)malloc(len);
+    size_t at = strncmp(argv[parg], "MTX:", 4) ? (size_t)snprintf(p, len, "-p") : 0;
+    for (size_t j = 0; j < c->len; j++)
+        at += snprintf(p + at, len - at, j ? ",%zd" : "%zd", c->pattern[j]);
+    free(copy[parg]);
+    copy[parg] = p;
+
+    char arg[STRING_SIZE];
+    snprintf(arg, STRING_SIZE, "-d%zu", c->delta);
+    copy[(*argc)++] = strdup(arg);
+    snprintf(arg, STRING_SIZE, "-l%zu", c->count);
+    copy[(*argc)++] = strdup(arg);
+    snprintf(arg, STRING_SIZE, "--name=%s", name);
+    copy[(*argc)++] = strdup(arg);
+    copy[*argc] = NULL;
+    return copy;
+}
+
+void sp_mtx_argv_free(int argc, char **argv)
+{
+    for (int i = 0; i < argc; i++)
+        free(argv[i]);
+    free(argv);
+}
@@ -0,0 +1,251 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "noise.h"
+#include "cache-flush.h"
+#include "sp_alloc.h"
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+// Elements per chunk, the unit the throttle paces
+#define NOISE_CHUNK 4096
+
+enum { NOISE_IDLE, NOISE_RUN, NOISE_EXIT };
+
+struct noise_thread
+{
+    pthread_t thread;
+    int cpu;
+    double *a, *b, *c;
+    size_t n;
+    size_t bytes;  /**< moved since sp_noise_begin */
+    int active;    /**< inside a run of traffic */
+    char pad[64];
+};
+
+static struct sp_noise_spec noise;
+static struct noise_thread *workers;
+static int state = NOISE_IDLE;
+static int ready;
+static double begin_ns;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int load_state(void)
+{
+    return __atomic_load_n(&state, __ATOMIC_SEQ_CST);
+}
+
+int sp_noise_parse(const char *arg, struct sp_noise_spec *spec)
+{
+    char kernel[16];
+    int threads = 0, used = 0;
+    double gbs = 0;
+    if (sscanf(arg, "%15[^:]:%d%n", kernel, &threads, &used) < 2 || threads < 1)
+        return -1;
+    if (arg[used] == ':' && (sscanf(arg + used + 1, "%lf", &gbs) != 1 || gbs < 0))
+        return -1;
+    if (arg[used] && arg[used] != ':')
+        return -1;
+
+    if (!strcasecmp(kernel, "stream") || !strcasecmp(kernel, "triad"))
+        spec->kernel = NOISE_TRIAD;
+    else if (!strcasecmp(kernel, "copy"))
+        spec->kernel = NOISE_COPY;
+    else if (!strcasecmp(kernel, "nt"))
+        spec->kernel = NOISE_NT;
+    else
+        return -1;
+    spec->threads = threads;
+    spec->gbs = gbs;
+    return 0;
+}
+
+// One chunk of the kernel from element i, returns the bytes it moved
+static size_t noise_chunk(struct noise_thread *w, size_t i)
+{
+    size_t end = i + NOISE_CHUNK < w->n ? i + NOISE_CHUNK : w->n;
+    double *restrict a = w->a, *restrict b = w->b, *restrict c = w->c;
+    switch (noise.kernel) {
+    case NOISE_TRIAD:
+        for (size_t j = i; j < end; j++)
+            a[j] = b[j] + 3.0 * c[j];
+        return (end - i) * 3 * sizeof(double);
+    case NOISE_COPY:
+        for (size_t j = i; j < end; j++)
+            c[j] = a[j];
+        return (end - i) * 2 * sizeof(double);
+    default:
+#if defined( __x86_64__ )
+        for (size_t j = i; j < end; j++)
+            _mm_stream_si64((long long *)&a[j], (long long)j);
+        _mm_sfence();
+#else
+        for (size_t j = i; j < end; j++)
+            a[j] = (double)j;
+#endif
+        return (end - i) * sizeof(double);
+    }
+}
+
+// Run the kernel until the state leaves NOISE_RUN, sleeping or spinning
+// between chunks to stay at this thread's share of the target
+static void noise_run(struct noise_thread *w)
+{
+    double rate = noise.gbs / noise.threads; // bytes per ns
+    double start = now_ns();
+    size_t bytes = 0, i = 0;
+
+    while (load_state() == NOISE_RUN) {
+        bytes += noise_chunk(w, i);
+        i = i + NOISE_CHUNK < w->n ? i + NOISE_CHUNK : 0;
+        __atomic_store_n(&w->bytes, bytes, __ATOMIC_RELEASE);
+        if (rate <= 0)
+            continue;
+        double due = start + bytes / rate;
+        for (double t = now_ns(); t < due && load_state() == NOISE_RUN; t = now_ns()) {
+            // Sleep in at most 1 ms steps to notice sp_noise_end soon
+            if (due - t > 100e3) {
+                struct timespec ts = {0, (long)(due - t - 50e3 < 1e6 ? due - t - 50e3 : 1e6)};
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+}
+
+static void *noise_main(void *arg)
+{
+    struct noise_thread *w = (struct noise_thread *)arg;
+
+    // First touch from the pinned thread, so the buffers are local to it
+    w->a = (double *)sp_malloc(sizeof(double), w->n, ALIGN_PAGE);
+    w->b = (double *)sp_malloc(sizeof(double), w->n, ALIGN_PAGE);
+    w->c = (double *)sp_malloc(sizeof(double), w->n, ALIGN_PAGE);
+    for (size_t i = 0; i < w->n; i++) {
+        w->a[i] = 1.0;
+        w->b[i] = 2.0;
+        w->c[i] = 0.5;
+    }
+    __atomic_add_fetch(&ready, 1, __ATOMIC_RELEASE);
+
+    for (int s; (s = load_state()) != NOISE_EXIT;) {
+        if (s == NOISE_RUN) {
+            // Active before the state is checked again, so sp_noise_end
+            // either sees it or this thread sees the end
+            __atomic_store_n(&w->active, 1, __ATOMIC_SEQ_CST);
+            noise_run(w);
+            __atomic_store_n(&w->active, 0, __ATOMIC_RELEASE);
+        } else {
+            struct timespec ts = {0, 50000};
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+int sp_noise_start(const struct sp_noise_spec *spec)
+{
+    noise = *spec;
+    workers = (struct noise_thread *)calloc(noise.threads, sizeof(struct noise_thread));
+    state = NOISE_IDLE;
+    ready = 0;
+
+    // The last CPUs of the process, or of the machine if the main thread
+    // has already been bound to fewer by the OpenMP runtime
+    int ncpus = 0, cpus[CPU_SETSIZE];
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > noise.threads) {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &set))
+                cpus[ncpus++] = c;
+    } else {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int c = 0; c < online && c < CPU_SETSIZE; c++)
+            cpus[ncpus++] = c;
+    }
+    int pinned = ncpus >= noise.threads;
+
+    // Each thread streams through three arrays of at least the LLC over
+    // the threads, so that together they do not fit in it
+    size_t n = sp_llc_size() / noise.threads / sizeof(double);
+    if (n < ((size_t)4 << 20) / sizeof(double))
+        n = ((size_t)4 << 20) / sizeof(double);
+
+    for (int t = 0; t < noise.threads; t++) {
+        struct noise_thread *w = &workers[t];
+        w->n = n;
+        w->cpu = pinned ? cpus[ncpus - noise.threads + t] : -1;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pinned) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(w->cpu, &one);
+            pthread_attr_setaffinity_np(&attr, sizeof(one), &one);
+        }
+        if (pthread_create(&w->thread, &attr, noise_main, w) != 0) {
+            w->cpu = -1;
+            pthread_create(&w->thread, NULL, noise_main, w);
+        }
+        pthread_attr_destroy(&attr);
+    }
+    while (__atomic_load_n(&ready, __ATOMIC_ACQUIRE) < noise.threads)
+        sched_yield();
+    return workers[0].cpu;
+}
+
+void sp_noise_begin(void)
+{
+    if (!workers)
+        return;
+    for (int t = 0; t < noise.threads; t++)
+        __atomic_store_n(&workers[t].bytes, 0, __ATOMIC_RELEASE);
+    begin_ns = now_ns();
+    __atomic_store_n(&state, NOISE_RUN, __ATOMIC_RELEASE);
+}
+
+double sp_noise_end(void)
+{
+    if (!workers)
+        return 0;
+    __atomic_store_n(&state, NOISE_IDLE, __ATOMIC_SEQ_CST);
+    for (int t = 0; t < noise.threads; t++)
+        while (__atomic_load_n(&workers[t].active, __ATOMIC_SEQ_CST))
+            sched_yield();
+    double elapsed = now_ns() - begin_ns;
+
+    size_t bytes = 0;
+    for (int t = 0; t < noise.threads; t++)
+        bytes += __atomic_load_n(&workers[t].bytes, __ATOMIC_ACQUIRE);
+    return elapsed > 0 ? bytes / elapsed : 0;
+}
+
+void sp_noise_stop(void)
+{
+    if (!workers)
+        return;
+    __atomic_store_n(&state, NOISE_EXIT, __ATOMIC_RELEASE);
+    for (int t = 0; t < noise.threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+        sp_free(workers[t].a);
+        sp_free(workers[t].b);
+        sp_free(workers[t].c);
+    }
+    free(workers);
+    workers = NULL;
+}
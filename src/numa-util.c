@@ -0,0 +1,270 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <strings.h>
+#include <unistd.h>
+#include "numa-util.h"
+#include "parse-args.h" //error
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#define SP_HAVE_NUMA_SYSCALLS
+#endif
+
+// From linux/mempolicy.h
+#define SP_MPOL_BIND       2
+#define SP_MPOL_INTERLEAVE 3
+
+// From linux/mempolicy.h
+#define SP_MPOL_MF_MOVE (1 << 1)
+
+// Only sample this many pages when reporting placement
+#define SP_NUMA_MAX_SAMPLES 4096
+
+// Pages per move_pages call of --tier
+#define SP_NUMA_BATCH 4096
+
+static int numa_nodes = 0;
+
+int sp_numa_num_nodes(void)
+{
+    if (numa_nodes > 0)
+        return numa_nodes;
+
+    numa_nodes = 1;
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    // The file holds a list of ranges, e.g. "0-1" or "0,2-3"
+    FILE *fp = fopen("/sys/devices/system/node/has_memory", "r");
+    if (!fp)
+        fp = fopen("/sys/devices/system/node/online", "r");
+    if (fp) {
+        char buf[STRING_SIZE];
+        if (fgets(buf, STRING_SIZE, fp)) {
+            int max = 0;
+            char *tok = strtok(buf, ",\n");
+            while (tok) {
+                char *dash = strchr(tok, '-');
+                int hi = atoi(dash ? dash + 1 : tok);
+                if (hi > max)
+                    max = hi;
+                tok = strtok(NULL, ",\n");
+            }
+            numa_nodes = max + 1;
+        }
+        fclose(fp);
+    }
+    if (numa_nodes > SP_MAX_NUMA_NODES)
+        numa_nodes = SP_MAX_NUMA_NODES;
+#endif
+    return numa_nodes;
+}
+
+int sp_numa_current_node(void)
+{
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < SP_MAX_NUMA_NODES)
+        return (int)node;
+#endif
+    return 0;
+}
+
+int sp_numa_current_cpu(int *node)
+{
+    if (node)
+        *node = 0;
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    unsigned int c = 0, n = 0;
+    if (syscall(SYS_getcpu, &c, &n, NULL) == 0) {
+        if (node && n < SP_MAX_NUMA_NODES)
+            *node = (int)n;
+        return (int)c;
+    }
+#endif
+    return -1;
+}
+
+#ifdef SP_HAVE_NUMA_SYSCALLS
+static int numa_mbind(void *ptr, size_t size, int mode, unsigned long *mask)
+{
+    // mbind needs a page aligned start
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(page - 1);
+    size_t len = size + ((uintptr_t)ptr - start);
+    return (int)syscall(SYS_mbind, (void*)start, len, mode, mask, SP_MAX_NUMA_NODES + 1, 0);
+}
+#endif
+
+void sp_numa_interleave(void *ptr, size_t size)
+{
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    unsigned long mask[SP_MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+    int nodes = sp_numa_num_nodes();
+    for (int i = 0; i < nodes; i++)
+        mask[i / (8 * sizeof(unsigned long))] |= 1ul << (i % (8 * sizeof(unsigned long)));
+    if (nodes > 1 && numa_mbind(ptr, size, SP_MPOL_INTERLEAVE, mask) != 0)
+        error("mbind(MPOL_INTERLEAVE) failed, placement left to first touch", WARN);
+#else
+    (void)ptr; (void)size;
+#endif
+}
+
+void sp_numa_bind(void *ptr, size_t size, int node)
+{
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    unsigned long mask[SP_MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    if (sp_numa_num_nodes() > 1 && numa_mbind(ptr, size, SP_MPOL_BIND, mask) != 0)
+        error("mbind(MPOL_BIND) failed, placement left to first touch", WARN);
+#else
+    (void)ptr; (void)size; (void)node;
+#endif
+}
+
+size_t sp_numa_page_nodes(void *ptr, size_t size, size_t *counts)
+{
+    memset(counts, 0, sizeof(size_t) * SP_MAX_NUMA_NODES);
+    if (size == 0)
+        return 0;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)(page - 1);
+    size_t npages = (size + ((uintptr_t)ptr - start) + page - 1) / page;
+    size_t nsamples = npages < SP_NUMA_MAX_SAMPLES ? npages : SP_NUMA_MAX_SAMPLES;
+    size_t step = npages / nsamples;
+
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    void **pages = (void**)malloc(sizeof(void*) * nsamples);
+    int *status = (int*)malloc(sizeof(int) * nsamples);
+    for (size_t i = 0; i < nsamples; i++)
+        pages[i] = (void*)(start + i * step * page);
+
+    // A NULL node list only queries the node of each page
+    size_t found = 0;
+    if (syscall(SYS_move_pages, 0, nsamples, pages, NULL, status, 0) == 0) {
+        for (size_t i = 0; i < nsamples; i++) {
+            if (status[i] >= 0 && status[i] < SP_MAX_NUMA_NODES) {
+                counts[status[i]]++;
+                found++;
+            }
+        }
+    }
+    free(pages);
+    free(status);
+    if (found)
+        return found;
+#endif
+    counts[0] = nsamples;
+    return nsamples;
+}
+
+int sp_tier_parse(const char *arg, struct sp_tier *tier)
+{
+    memset(tier, 0, sizeof(*tier));
+    if (!strcasecmp(arg, "interleave")) {
+        tier->n = sp_numa_num_nodes();
+        for (int i = 0; i < tier->n; i++) {
+            tier->node[i] = i;
+            tier->weight[i] = 1;
+        }
+        return 0;
+    }
+
+    const char *p = arg;
+    while (*p) {
+        int node, used = 0;
+        double weight;
+        if (tier->n == SP_MAX_NUMA_NODES || sscanf(p, "%d:%lf%n", &node, &weight, &used) != 2 ||
+                node < 0 || node >= SP_MAX_NUMA_NODES || weight <= 0)
+            return -1;
+        for (int i = 0; i < tier->n; i++)
+            if (tier->node[i] == node)
+                return -1;
+        tier->node[tier->n] = node;
+        tier->weight[tier->n] = weight;
+        tier->n++;
+        p += used;
+        if (*p == ',' && p[1])
+            p++;
+        else if (*p)
+            return -1;
+    }
+    return tier->n > 0 ? 0 : -1;
+}
+
+int sp_numa_split(void *ptr, size_t size, const struct sp_tier *tier)
+{
+    if (size == 0 || tier->n == 0 || sp_numa_num_nodes() == 1)
+        return 0;
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)(page - 1);
+    size_t npages = (size + ((uintptr_t)ptr - start) + page - 1) / page;
+
+    double total = 0, credit[SP_MAX_NUMA_NODES] = {0};
+    for (int i = 0; i < tier->n; i++)
+        total += tier->weight[i];
+
+    void **pages = (void**)malloc(sizeof(void*) * SP_NUMA_BATCH);
+    int *nodes = (int*)malloc(sizeof(int) * SP_NUMA_BATCH);
+    int *status = (int*)malloc(sizeof(int) * SP_NUMA_BATCH);
+    int err = 0;
+    for (size_t p0 = 0; p0 < npages && !err; p0 += SP_NUMA_BATCH) {
+        size_t count = npages - p0 < SP_NUMA_BATCH ? npages - p0 : SP_NUMA_BATCH;
+        for (size_t i = 0; i < count; i++) {
+            // Smooth weighted round robin, so that every run of pages is
+            // split close to the weights and not only the whole buffer
+            int best = 0;
+            for (int k = 0; k < tier->n; k++) {
+                credit[k] += tier->weight[k];
+                if (credit[k] > credit[best])
+                    best = k;
+            }
+            credit[best] -= total;
+            pages[i] = (void*)(start + (p0 + i) * page);
+            nodes[i] = tier->node[best];
+        }
+        if (syscall(SYS_move_pages, 0, count, pages, nodes, status, SP_MPOL_MF_MOVE) < 0)
+            err = -1;
+    }
+    free(pages);
+    free(nodes);
+    free(status);
+    return err;
+#else
+    (void)ptr;
+    return -1;
+#endif
+}
+
+unsigned char *sp_numa_page_map(void *ptr, size_t size, size_t *npages)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)(page - 1);
+    *npages = size ? (size + ((uintptr_t)ptr - start) + page - 1) / page : 0;
+    unsigned char *map = (unsigned char*)malloc(*npages + 1);
+    memset(map, 0, *npages);
+
+#ifdef SP_HAVE_NUMA_SYSCALLS
+    void **pages = (void**)malloc(sizeof(void*) * SP_NUMA_BATCH);
+    int *status = (int*)malloc(sizeof(int) * SP_NUMA_BATCH);
+    for (size_t p0 = 0; p0 < *npages; p0 += SP_NUMA_BATCH) {
+        size_t count = *npages - p0 < SP_NUMA_BATCH ? *npages - p0 : SP_NUMA_BATCH;
+        for (size_t i = 0; i < count; i++)
+            pages[i] = (void*)(start + (p0 + i) * page);
+        // A NULL node list only queries the node of each page
+        // Without NUMA support in the kernel everything is on node 0
+        if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0)
+            continue;
+        for (size_t i = 0; i < count; i++)
+            map[p0 + i] = status[i] >= 0 && status[i] < SP_MAX_NUMA_NODES ? (unsigned char)status[i] : SP_NUMA_UNKNOWN;
+    }
+    free(pages);
+    free(status);
+#endif
+    return map;
+}
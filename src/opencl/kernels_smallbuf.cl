@@ -0,0 +1,116 @@
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+
+// The same Gather/Scatter semantics as the CPU smallbuf kernels: work-item
+// i moves one pattern's worth of data between the sparse buffer, at offset
+// delta*i, and slot i%wrap of the small dense buffer.
+//
+// V (the pattern length) is defined when the program is built, so the
+// inner loops are fully unrolled. One program is built per pattern length.
+
+#ifndef V
+#error "Build with -DV=<pattern length>"
+#endif
+
+__kernel void gather_smallbuf(__global const double* restrict sparse,
+                              __global double* restrict dense,
+                              __global const long* restrict pat,
+                              ulong delta,
+                              ulong n,
+                              ulong wrap)
+{
+    size_t i = get_global_id(0);
+    if (i >= n)
+        return;
+
+    __global const double *sl = sparse + delta * i;
+    __global double *tl = dense + V * (i % wrap);
+
+    #pragma unroll
+    for (int j = 0; j < V; j++) {
+        tl[j] = sl[pat[j]];
+    }
+}
+
+__kernel void scatter_smallbuf(__global double* restrict sparse,
+                               __global const double* restrict dense,
+                               __global const long* restrict pat,
+                               ulong delta,
+                               ulong n,
+                               ulong wrap)
+{
+    size_t i = get_global_id(0);
+    if (i >= n)
+        return;
+
+    __global double *tl = sparse + delta * i;
+    __global const double *sl = dense + V * (i % wrap);
+
+    #pragma unroll
+    for (int j = 0; j < V; j++) {
+        tl[pat[j]] = sl[j];
+    }
+}
+
+__kernel void sg_smallbuf(__global const double* restrict gather,
+                          __global double* restrict scatter,
+                          __global const long* restrict gather_pat,
+                          __global const long* restrict scatter_pat,
+                          ulong delta_gather,
+                          ulong delta_scatter,
+                          ulong n)
+{
+    size_t i = get_global_id(0);
+    if (i >= n)
+        return;
+
+    __global const double *sl = gather + delta_gather * i;
+    __global double *tl = scatter + delta_scatter * i;
+
+    #pragma unroll
+    for (int j = 0; j < V; j++) {
+        tl[scatter_pat[j]] = sl[gather_pat[j]];
+    }
+}
+
+// For the Multi kernels V is the length of the inner pattern
+__kernel void multigather_smallbuf(__global const double* restrict sparse,
+                                   __global double* restrict dense,
+                                   __global const long* restrict outer_pat,
+                                   __global const long* restrict inner_pat,
+                                   ulong delta,
+                                   ulong n,
+                                   ulong wrap)
+{
+    size_t i = get_global_id(0);
+    if (i >= n)
+        return;
+
+    __global const double *sl = sparse + delta * i;
+    __global double *tl = dense + V * (i % wrap);
+
+    #pragma unroll
+    for (int j = 0; j < V; j++) {
+        tl[j] = sl[outer_pat[inner_pat[j]]];
+    }
+}
+
+__kernel void multiscatter_smallbuf(__global double* restrict sparse,
+                                    __global const double* restrict dense,
+                                    __global const long* restrict outer_pat,
+                                    __global const long* restrict inner_pat,
+                                    ulong delta,
+                                    ulong n,
+                                    ulong wrap)
+{
+    size_t i = get_global_id(0);
+    if (i >= n)
+        return;
+
+    __global double *tl = sparse + delta * i;
+    __global const double *sl = dense + V * (i % wrap);
+
+    #pragma unroll
+    for (int j = 0; j < V; j++) {
+        tl[outer_pat[inner_pat[j]]] = sl[j];
+    }
+}
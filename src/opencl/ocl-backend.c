@@ -4,8 +4,29 @@
  \brief Source file for the OpenCL backend
  */
 
+#include <string.h>
 #include "ocl-backend.h"
 
+cl_context context;
+cl_command_queue queue;
+cl_device_id device;
+cl_mem_flags flags;
+cl_kernel sgp;
+
+cl_event e;
+
+#define OCL_MAX_KERNELS 64
+
+// Kernels already built, one per kernel type and pattern length
+struct ocl_kernel {
+    enum sg_kernel kernel;
+    size_t V;
+    cl_kernel knl;
+};
+
+static struct ocl_kernel ocl_kernels[OCL_MAX_KERNELS];
+static int ocl_nkernels = 0;
+
 void initialize_dev_ocl(char* platform_string, char* device_string)
 {
 	create_context_on(platform_string, device_string, 0, 
@@ -13,15 +34,140 @@ void initialize_dev_ocl(char* platform_string, char* device_string)
 
 }
 
-void create_dev_buffers_ocl(sgDataBuf *source, sgDataBuf *target, sgIndexBuf *si, sgIndexBuf *ti)
+void create_dev_buffers_ocl(sgDataBuf *source, sgDataBuf *target)
 {
 
-        flags = CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_WRITE_ONLY;
+        flags = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR;
         source->dev_ptr_opencl = clCreateBufferSafe(context, flags, source->size, source->host_ptr);
-        si->dev_ptr_opencl = clCreateBufferSafe(context, flags, si->size, si->host_ptr);
-        ti->dev_ptr_opencl = clCreateBufferSafe(context, flags, ti->size, ti->host_ptr);
+        target->dev_ptr_opencl = clCreateBufferSafe(context, flags, target->size, target->host_ptr);
+
+}
+
+void create_pattern_buffers_ocl(struct ocl_patterns *p, size_t max_pat_len)
+{
+    size_t size = sizeof(sgIdx_t) * (max_pat_len ? max_pat_len : 1);
+    p->pat      = clCreateBufferSafe(context, CL_MEM_READ_ONLY, size, NULL);
+    p->pat_gath = clCreateBufferSafe(context, CL_MEM_READ_ONLY, size, NULL);
+    p->pat_scat = clCreateBufferSafe(context, CL_MEM_READ_ONLY, size, NULL);
+}
+
+static const char *ocl_kernel_name(enum sg_kernel kernel)
+{
+    switch (kernel) {
+    case GATHER:       return "gather_smallbuf";
+    case SCATTER:      return "scatter_smallbuf";
+    case GS:           return "sg_smallbuf";
+    case MULTIGATHER:  return "multigather_smallbuf";
+    case MULTISCATTER: return "multiscatter_smallbuf";
+    default:           return NULL;
+    }
+}
+
+// Length of the pattern the kernel loops over
+static size_t ocl_vector_len(struct run_config *rc)
+{
+    switch (rc->kernel) {
+    case GS:           return rc->pattern_gather_len;
+    case MULTIGATHER:  return rc->pattern_gather_len;
+    case MULTISCATTER: return rc->pattern_scatter_len;
+    default:           return rc->pattern_len;
+    }
+}
+
+cl_kernel ocl_kernel_for(const char *src, struct run_config *rc)
+{
+    const char *name = ocl_kernel_name(rc->kernel);
+    if (!name)
+        error("Unsupported kernel for the OpenCL backend", ERROR);
+    if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->deltas_len > 1)
+        error("The OpenCL backend does not support traces, --random, --morton, --hilbert or multiple deltas", ERROR);
+    if (rc->op != OP_COPY)
+        error("The OpenCL backend only supports -o COPY", ERROR);
+    if (rc->kernel == GS && rc->pattern_gather_len != rc->pattern_scatter_len)
+        error("GS needs gather and scatter patterns of the same length", ERROR);
+
+    size_t V = ocl_vector_len(rc);
+    for (int i = 0; i < ocl_nkernels; i++)
+        if (ocl_kernels[i].kernel == rc->kernel && ocl_kernels[i].V == V)
+            return ocl_kernels[i].knl;
+
+    if (ocl_nkernels == OCL_MAX_KERNELS)
+        error("Too many distinct OpenCL kernels", ERROR);
+
+    char options[64];
+    snprintf(options, sizeof(options), "-DV=%zu", V);
+    struct ocl_kernel *k = &ocl_kernels[ocl_nkernels++];
+    k->kernel = rc->kernel;
+    k->V = V;
+    k->knl = kernel_from_string(context, src, name, options);
+    return k->knl;
+}
+
+void ocl_prepare_config(struct run_config *rc, struct ocl_patterns *p)
+{
+    switch (rc->kernel) {
+    case GS:
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat_gath, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_gather_len, rc->pattern_gather, 0, NULL, NULL));
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat_scat, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_scatter_len, rc->pattern_scatter, 0, NULL, NULL));
+        break;
+    case MULTIGATHER:
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_len, rc->pattern, 0, NULL, NULL));
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat_gath, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_gather_len, rc->pattern_gather, 0, NULL, NULL));
+        break;
+    case MULTISCATTER:
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_len, rc->pattern, 0, NULL, NULL));
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat_scat, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_scatter_len, rc->pattern_scatter, 0, NULL, NULL));
+        break;
+    default:
+        CALL_CL_GUARDED(clEnqueueWriteBuffer, (queue, p->pat, CL_TRUE, 0, sizeof(sgIdx_t) * rc->pattern_len, rc->pattern, 0, NULL, NULL));
+        break;
+    }
+}
+
+double ocl_run_config(cl_kernel knl, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct ocl_patterns *p)
+{
+    cl_ulong delta = rc->delta;
+    cl_ulong n = rc->generic_len;
+    cl_ulong wrap = rc->wrap;
+
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        SET_6_KERNEL_ARGS(knl, source->dev_ptr_opencl, target->dev_ptr_opencl, p->pat, delta, n, wrap);
+        break;
+    case GS: {
+        cl_ulong delta_gather = rc->delta_gather;
+        cl_ulong delta_scatter = rc->delta_scatter;
+        SET_7_KERNEL_ARGS(knl, source->dev_ptr_opencl, target->dev_ptr_opencl, p->pat_gath, p->pat_scat, delta_gather, delta_scatter, n);
+        break;
+    }
+    case MULTIGATHER:
+        SET_7_KERNEL_ARGS(knl, source->dev_ptr_opencl, target->dev_ptr_opencl, p->pat, p->pat_gath, delta, n, wrap);
+        break;
+    case MULTISCATTER:
+        SET_7_KERNEL_ARGS(knl, source->dev_ptr_opencl, target->dev_ptr_opencl, p->pat, p->pat_scat, delta, n, wrap);
+        break;
+    default:
+        return 0;
+    }
+
+    // Round the global size up to a whole number of work-groups, the
+    // kernels ignore the work-items past n
+    size_t local = rc->local_work_size;
+    size_t max_local;
+    CALL_CL_GUARDED(clGetKernelWorkGroupInfo, (knl, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_local), &max_local, NULL));
+    if (local == 0 || local > max_local)
+        local = max_local;
+    size_t global = (rc->generic_len + local - 1) / local * local;
+
+    cl_event ev;
+    CALL_CL_GUARDED(clEnqueueNDRangeKernel, (queue, knl, 1, NULL, &global, &local, 0, NULL, &ev));
+    CALL_CL_GUARDED(clWaitForEvents, (1, &ev));
 
-        flags = CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY;
-        target->dev_ptr_opencl = clCreateBufferSafe(context, flags, target->size, NULL); 
+    cl_ulong start, end;
+    CALL_CL_GUARDED(clGetEventProfilingInfo, (ev, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL));
+    CALL_CL_GUARDED(clGetEventProfilingInfo, (ev, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL));
+    CALL_CL_GUARDED(clReleaseEvent, (ev));
 
+    return (end - start) / 1e6;
 }
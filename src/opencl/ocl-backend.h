@@ -10,17 +10,47 @@
 #include "cl-helper.h"
 #include "sgtype.h"
 #include "sgbuf.h"
+#include "parse-args.h"
 
-    cl_context context;
-    cl_command_queue queue;
-    cl_device_id device;
-    cl_mem_flags flags; 
-    cl_kernel sgp;
+    extern cl_context context;
+    extern cl_command_queue queue;
+    extern cl_device_id device;
+    extern cl_mem_flags flags; 
+    extern cl_kernel sgp;
     
-    cl_event e;
+    extern cl_event e;
 
 void initialize_dev_ocl(char* platform_string, char* device_string);
 
-void create_dev_buffers_ocl(sgDataBuf *source, sgDataBuf *target, sgIndexBuf *si, sgIndexBuf *ti);
+/** @brief Create the device copies of source and target and copy the host
+ *  data to them. Both are read-write: Scatter writes the source buffer and
+ *  GS the target.
+ */
+void create_dev_buffers_ocl(sgDataBuf *source, sgDataBuf *target);
+
+/** @brief Device buffers for the patterns of a config, sized for the
+ *  longest pattern of the suite
+ */
+struct ocl_patterns {
+    cl_mem pat;      /**< pattern, or the outer pattern of the Multi kernels */
+    cl_mem pat_gath; /**< gather pattern of GS and MultiGather */
+    cl_mem pat_scat; /**< scatter pattern of GS and MultiScatter */
+};
+
+void create_pattern_buffers_ocl(struct ocl_patterns *p, size_t max_pat_len);
+
+/** @brief Kernel for rc, built from the program source src with V set to
+ *  the pattern length rc needs. Programs are built once per length.
+ *  Exits through error() for configs the OpenCL backend does not support.
+ */
+cl_kernel ocl_kernel_for(const char *src, struct run_config *rc);
+
+/** @brief Upload the patterns of rc, once before its timed runs */
+void ocl_prepare_config(struct run_config *rc, struct ocl_patterns *p);
+
+/** @brief Run rc once and return the kernel time in ms, from the event's
+ *  profiling counters
+ */
+double ocl_run_config(cl_kernel knl, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct ocl_patterns *p);
 
 #endif //end OCL_BACKEND
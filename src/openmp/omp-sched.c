@@ -0,0 +1,318 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "omp-sched.h"
+#include "../include/sp_alloc.h"
+#include "../include/numa-util.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#define omp_get_num_threads() 1
+#define omp_get_level() 0
+#define omp_get_ancestor_thread_num(l) 0
+#endif
+
+// Per-thread state, one cache line each. range holds the [lo, hi) chunks
+// still owned by the thread for steal, lo in the upper 32 bits.
+struct sp_slot
+{
+    alignas(64) _Atomic uint64_t range;
+    int started;
+    int first_cpu;
+    double first_ms;
+    double last_ms;
+    struct sp_thread_stats st;
+};
+
+static struct
+{
+    enum sg_schedule kind;
+    size_t chunk;    // as selected, 0 for the default
+    int instrument;
+} sched = { SCHED_STATIC, 0 };
+
+// The loop state of one team. Only --co-run has more than one, the nested
+// team of each config.
+struct sp_team
+{
+    size_t n;
+    size_t step;     // chunk of the current loop
+    int nthreads;
+    int stats_threads;
+    int pending;     // the stats of the last loop still have to get their wait times
+    double reset_ms;
+    struct sp_slot *slots;
+    int nslots;
+    alignas(64) _Atomic size_t next;
+};
+
+static struct sp_team teams[SP_MAX_TEAMS];
+
+// Team of the caller, by the outer thread it descends from. in_region is
+// 1 in the kernels' parallel region and 0 outside of it.
+static struct sp_team *team_of(int in_region)
+{
+    int level = omp_get_level() - in_region;
+    int id = level >= 1 ? omp_get_ancestor_thread_num(1) : 0;
+    return &teams[id < SP_MAX_TEAMS ? id : 0];
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t pack(uint64_t lo, uint64_t hi)
+{
+    return lo << 32 | hi;
+}
+
+void sp_sched_set(enum sg_schedule kind, size_t chunk)
+{
+    sched.kind = kind;
+    sched.chunk = chunk;
+}
+
+enum sg_schedule sp_sched_get(void)
+{
+    return sched.kind;
+}
+
+size_t sp_sched_chunk(void)
+{
+    if (sched.chunk)
+        return sched.chunk;
+    return sched.kind == SCHED_STEAL ? SP_STEAL_CHUNK : 1;
+}
+
+const char *sp_sched_name(enum sg_schedule kind)
+{
+    switch (kind) {
+    case SCHED_STATIC:  return "static";
+    case SCHED_DYNAMIC: return "dynamic";
+    case SCHED_GUIDED:  return "guided";
+    case SCHED_STEAL:   return "steal";
+    default:            return "invalid";
+    }
+}
+
+void sp_sched_instrument(int on)
+{
+    sched.instrument = on;
+}
+
+static void clear_stats(struct sp_thread_stats *st)
+{
+    memset(st, 0, sizeof(*st));
+    st->cpu = -1;
+}
+
+// Threads that finish early wait at the barrier that ends the parallel
+// region until the last one gets there
+static void add_wait_times(struct sp_team *tm)
+{
+    if (!tm->pending)
+        return;
+    tm->pending = 0;
+
+    struct sp_slot *slots = tm->slots;
+    double end = 0;
+    for (int t = 0; t < tm->nthreads; t++)
+        if (slots[t].started && slots[t].last_ms > end)
+            end = slots[t].last_ms;
+    for (int t = 0; t < tm->nthreads; t++)
+        if (slots[t].started)
+            slots[t].st.wait_ms += end - slots[t].last_ms;
+}
+
+void sp_sched_reset(size_t n)
+{
+    struct sp_team *tm = team_of(0);
+    add_wait_times(tm);
+
+    int nt = omp_get_max_threads();
+    if (nt > tm->nslots) {
+        struct sp_slot *s = (struct sp_slot *)sp_malloc(sizeof(struct sp_slot), nt, ALIGN_CACHE);
+        for (int t = 0; t < nt; t++) {
+            if (t < tm->nslots)
+                s[t].st = tm->slots[t].st;
+            else
+                clear_stats(&s[t].st);
+        }
+        free(tm->slots);
+        tm->slots = s;
+        tm->nslots = nt;
+    }
+
+    tm->n = n;
+    tm->nthreads = nt;
+    tm->step = sp_sched_chunk();
+    if (sched.instrument) {
+        if (nt > tm->stats_threads)
+            tm->stats_threads = nt;
+        tm->pending = 1;
+        tm->reset_ms = now_ms();
+    }
+    atomic_store(&tm->next, 0);
+
+    // The chunk indices of steal have to fit in 32 bits
+    if (sched.kind == SCHED_STEAL && n / tm->step >= UINT32_MAX)
+        tm->step = n / UINT32_MAX + 1;
+    size_t nchunks = (n + tm->step - 1) / tm->step;
+
+    for (int t = 0; t < nt; t++) {
+        tm->slots[t].started = 0;
+        uint64_t lo = nchunks * t / nt;
+        uint64_t hi = nchunks * (t + 1) / nt;
+        atomic_store(&tm->slots[t].range, sched.kind == SCHED_STEAL ? pack(lo, hi) : 0);
+    }
+}
+
+// Thread t's block of the static schedule, split the way libgomp does it
+static int next_static(struct sp_team *tm, int t, size_t *i0, size_t *i1)
+{
+    size_t nt = omp_get_num_threads();
+    size_t q = tm->n / nt;
+    size_t r = tm->n % nt;
+    size_t ut = (size_t)t;
+    *i0 = ut * q + (ut < r ? ut : r);
+    *i1 = *i0 + q + (ut < r);
+    return *i0 < *i1;
+}
+
+static int next_dynamic(struct sp_team *tm, size_t *i0, size_t *i1)
+{
+    size_t b = atomic_fetch_add(&tm->next, tm->step);
+    if (b >= tm->n)
+        return 0;
+    *i0 = b;
+    *i1 = b + tm->step < tm->n ? b + tm->step : tm->n;
+    return 1;
+}
+
+static int next_guided(struct sp_team *tm, size_t *i0, size_t *i1)
+{
+    size_t b = atomic_load(&tm->next);
+    while (b < tm->n) {
+        size_t len = (tm->n - b) / (2 * tm->nthreads);
+        if (len < tm->step)
+            len = tm->step;
+        size_t e = b + len < tm->n ? b + len : tm->n;
+        if (atomic_compare_exchange_weak(&tm->next, &b, e)) {
+            *i0 = b;
+            *i1 = e;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The owner takes chunks off the bottom of its range, thieves take the top
+// half of another thread's range and make it their own. Every change is a
+// CAS on the whole range, so each chunk is handed out exactly once.
+static int next_steal(struct sp_team *tm, int t, size_t *i0, size_t *i1)
+{
+    uint64_t c;
+    _Atomic uint64_t *own = &tm->slots[t].range;
+    uint64_t r = atomic_load(own);
+    for (;;) {
+        uint64_t lo = r >> 32, hi = r & UINT32_MAX;
+        if (lo >= hi)
+            break;
+        if (atomic_compare_exchange_weak(own, &r, pack(lo + 1, hi))) {
+            c = lo;
+            goto found;
+        }
+    }
+
+    for (int v = 1; v < tm->nthreads; v++) {
+        _Atomic uint64_t *victim = &tm->slots[(t + v) % tm->nthreads].range;
+        r = atomic_load(victim);
+        for (;;) {
+            uint64_t lo = r >> 32, hi = r & UINT32_MAX;
+            if (lo >= hi)
+                break;
+            uint64_t mid = hi - (hi - lo + 1) / 2;
+            if (atomic_compare_exchange_weak(victim, &r, pack(lo, mid))) {
+                atomic_store(own, pack(mid + 1, hi));
+                c = mid;
+                goto found;
+            }
+        }
+    }
+    return 0;
+
+found:
+    *i0 = c * tm->step;
+    *i1 = *i0 + tm->step < tm->n ? *i0 + tm->step : tm->n;
+    return 1;
+}
+
+int sp_sched_next(int t, size_t *i0, size_t *i1)
+{
+    struct sp_team *tm = team_of(1);
+    struct sp_slot *s = &tm->slots[t];
+    int first = !s->started;
+    if (first) {
+        s->started = 1;
+        if (sched.instrument) {
+            s->first_ms = now_ms();
+            s->first_cpu = sp_numa_current_cpu(NULL);
+            s->st.start_ms += s->first_ms - tm->reset_ms;
+        }
+    }
+
+    int more = 0;
+    switch (sched.kind) {
+    case SCHED_STATIC:  more = first && next_static(tm, t, i0, i1); break;
+    case SCHED_DYNAMIC: more = next_dynamic(tm, i0, i1); break;
+    case SCHED_GUIDED:  more = next_guided(tm, i0, i1); break;
+    case SCHED_STEAL:   more = next_steal(tm, t, i0, i1); break;
+    default:            break;
+    }
+
+    if (!sched.instrument)
+        return more;
+
+    if (more) {
+        s->st.iters += *i1 - *i0;
+    }
+    else {
+        s->last_ms = now_ms();
+        s->st.busy_ms += s->last_ms - s->first_ms;
+        int cpu = sp_numa_current_cpu(&s->st.node);
+        if (cpu != s->first_cpu || (s->st.cpu >= 0 && s->first_cpu != s->st.cpu))
+            s->st.moves++;
+        s->st.cpu = cpu;
+    }
+    return more;
+}
+
+void sp_thread_stats_reset(void)
+{
+    struct sp_team *tm = team_of(0);
+    add_wait_times(tm);
+    for (int t = 0; t < tm->nslots; t++)
+        clear_stats(&tm->slots[t].st);
+    tm->stats_threads = 0;
+}
+
+int sp_thread_stats(struct sp_thread_stats *st, int max)
+{
+    struct sp_team *tm = team_of(0);
+    add_wait_times(tm);
+    int nt = tm->stats_threads < max ? tm->stats_threads : max;
+    for (int t = 0; t < nt; t++)
+        st[t] = tm->slots[t].st;
+    return nt;
+}
@@ -0,0 +1,79 @@
+#ifndef OMP_SCHED_H
+#define OMP_SCHED_H
+#include <stddef.h>
+#include "../include/parse-args.h"
+
+/* Loop scheduling for the OpenMP kernels (--schedule). The kernels do not
+ * use "omp for"; every thread of the parallel region instead asks for
+ * iteration ranges until there are none left:
+ *
+ *     sp_sched_reset(n);
+ *     #pragma omp parallel
+ *     {
+ *         int t = omp_get_thread_num();
+ *         size_t i0, i1;
+ *         while (sp_sched_next(t, &i0, &i1))
+ *         for (size_t i = i0; i < i1; i++) { ... }
+ *     }
+ *
+ * Every schedule is implemented here, so that steal does not depend on the
+ * OpenMP runtime. With sp_sched_instrument, the scheduler also records when
+ * and where each thread ran (--busy-times).
+ *
+ * The kernels may also run in nested teams, one for each thread of an
+ * outer parallel region (--co-run). Each of these teams has its own loop
+ * state and stats, and the calls above apply to the team of the caller.
+ */
+
+/** @brief Default chunk of the steal schedule, in iterations */
+#define SP_STEAL_CHUNK 64
+
+/** @brief Most nested teams with their own schedule */
+#define SP_MAX_TEAMS 64
+
+/** @brief Select the schedule of the following kernels. A chunk of 0
+ *  picks the default: 1 for dynamic and guided, SP_STEAL_CHUNK for steal.
+ *  Static ignores the chunk.
+ */
+void sp_sched_set(enum sg_schedule kind, size_t chunk);
+enum sg_schedule sp_sched_get(void);
+size_t sp_sched_chunk(void);
+const char *sp_sched_name(enum sg_schedule kind);
+
+/** @brief Prepare the schedule of n iterations for the next parallel
+ *  region. Must be called outside of it.
+ */
+void sp_sched_reset(size_t n);
+
+/** @brief Next range [*i0, *i1) of thread t, or 0 once the thread is done.
+ *  Once a thread got 0 it must not call again before the next reset.
+ */
+int sp_sched_next(int t, size_t *i0, size_t *i1);
+
+/** @brief What one thread did in the loops since sp_thread_stats_reset.
+ *  Times are in ms and summed over the loops.
+ */
+struct sp_thread_stats
+{
+    double start_ms; /**< from sp_sched_reset to the thread's first range */
+    double busy_ms;  /**< from the first range to the thread's last call */
+    double wait_ms;  /**< from the last call until the slowest thread's, at the barrier */
+    size_t iters;    /**< iterations handed to the thread */
+    int cpu;         /**< CPU at the end of the last loop, -1 if unknown */
+    int node;        /**< NUMA node of that CPU */
+    int moves;       /**< loops that ended on another CPU than they, or the loop before, started on */
+};
+
+/** @brief Record the stats of each thread in the following loops. Off by
+ *  default, as it reads the clock and the CPU in every loop.
+ */
+void sp_sched_instrument(int on);
+
+/** @brief Clear the stats of all threads */
+void sp_thread_stats_reset(void);
+
+/** @brief Copy the stats of up to max threads into st. Returns the number
+ *  of threads that ran a loop since the last sp_thread_stats_reset.
+ */
+int sp_thread_stats(struct sp_thread_stats *st, int max);
+#endif
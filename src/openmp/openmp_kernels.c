@@ -1,12 +1,21 @@
-#include "pcg_basic.h"
+#include "sp_rand.h"
 #include "openmp_kernels.h"
+#include "omp-sched.h"
+#include "fixed-len.h"
+#include "chase.h"
+#include "sgtime.h"
 #include <stdlib.h>
+#include <string.h>
 
 #include <stdio.h>
+#if defined( __x86_64__ )
+#include <emmintrin.h>
+#endif
 #define SIMD 8
 
 #if !defined( USE_OPENMP )
 #define omp_get_thread_num() 0
+#define omp_get_num_threads() 1
 #endif
 
 void multigather_smallbuf(
@@ -18,6 +27,7 @@ void multigather_smallbuf(
         size_t delta,
         size_t n,
         size_t target_len) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -32,8 +42,9 @@ void multigather_smallbuf(
 #ifdef __INTEL_COMPILER
     #pragma ivdep
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
            sgData_t *sl = source + delta * i;
            sgData_t *tl = target[t] + pat_len*(i%target_len);
 #ifdef __CRAYC__
@@ -59,6 +70,7 @@ void multigather_smallbuf_morton(
         size_t n,
         size_t target_len,
         uint32_t *order) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -73,8 +85,9 @@ void multigather_smallbuf_morton(
 #ifdef __INTEL_COMPILER
     #pragma ivdep
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
            sgData_t *sl = source + delta * order[i];
            sgData_t *tl = target[t] + pat_len*(i%target_len);
 #ifdef __CRAYC__
@@ -99,6 +112,7 @@ void multiscatter_smallbuf(
         size_t delta,
         size_t n,
         size_t source_len) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -113,8 +127,9 @@ void multiscatter_smallbuf(
 #ifdef __INTEL_COMPILER
     #pragma ivdep
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
            sgData_t *tl = target + delta * i;
            sgData_t *sl = source[t] + pat_len*(i%source_len);
 #ifdef __CRAYC__
@@ -130,6 +145,120 @@ void multiscatter_smallbuf(
     }
 }
 
+void multiscatter_smallbuf_morton(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * order[i];
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[outer_pat[inner_pat[j]]] = sl[j];
+           }
+        }
+    }
+}
+
+// --inner-stream: Gather or Scatter i reads its own inner pattern,
+// inner_stream[pat_len*i .. pat_len*(i+1)), so the inner indices are a
+// stream from memory rather than a few cached lines
+void multigather_smallbuf_stream(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_stream,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+           ssize_t *inner = inner_stream + pat_len * i;
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[j] = sl[outer_pat[inner[j]]];
+           }
+        }
+    }
+}
+
+void multiscatter_smallbuf_stream(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_stream,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+           ssize_t *inner = inner_stream + pat_len * i;
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[outer_pat[inner[j]]] = sl[j];
+           }
+        }
+    }
+}
+
 void multigather_smallbuf_random(
         sgData_t** restrict target,
         sgData_t* const restrict source,
@@ -140,6 +269,7 @@ void multigather_smallbuf_random(
         size_t n,
         size_t target_len,
         long initstate) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -147,17 +277,15 @@ void multigather_smallbuf_random(
 #endif
     {
         int t = omp_get_thread_num();
-        pcg32_random_t rng;
-        pcg32_srandom_r(&rng, initstate, t);
-
 
 #ifdef __CRAYC__
     #pragma concurrent
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
             //long r = ()%n;
-           uint32_t r = pcg32_boundedrand_r(&rng, (uint32_t)n);
+           uint32_t r = sp_rand_bounded(initstate, i, (uint32_t)n);
            sgData_t *sl = source + delta * r;
            sgData_t *tl = target[t] + pat_len*(i%target_len);
 #ifdef __CRAYC__
@@ -182,6 +310,7 @@ void multiscatter_smallbuf_random(
         size_t source_len,
         long initstate) {
     if (n > 1ll<<32) {printf("n too big for rng, exiting.\n"); exit(1);}
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -189,15 +318,14 @@ void multiscatter_smallbuf_random(
 #endif
     {
         int t = omp_get_thread_num();
-        pcg32_random_t rng;
-        pcg32_srandom_r(&rng, initstate, t);
 
 #ifdef __CRAYC__
     #pragma concurrent
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           uint32_t r = pcg32_boundedrand_r(&rng, (uint32_t)n);
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           uint32_t r = sp_rand_bounded(initstate, i, (uint32_t)n);
            sgData_t *tl = target + delta * r;
            sgData_t *sl = source[t] + pat_len*(i%source_len);
 #ifdef __CRAYC__
@@ -222,6 +350,7 @@ void multigather_smallbuf_multidelta(
         size_t n,
         size_t target_len,
         size_t delta_len) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -233,8 +362,9 @@ void multigather_smallbuf_multidelta(
     #pragma concurrent
 #endif
         //taget_len is in multiples of pat_len
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
            sgData_t *sl = source + (i/delta_len)*delta[delta_len-1] + delta[i%delta_len] - delta[0];
            sgData_t *tl = target[t] + pat_len*(i%target_len);
            //sgData_t *sl = source;
@@ -262,6 +392,7 @@ void sg_smallbuf(
         size_t delta_scatter,
         size_t n,
         size_t wrap) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -276,8 +407,9 @@ void sg_smallbuf(
 #ifdef __INTEL_COMPILER
     #pragma ivdep
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
             sgData_t *tl = scatter + delta_scatter * i;
             sgData_t *sl = gather + delta_gather * i;
 #ifdef __CRAYC__
@@ -293,15 +425,18 @@ void sg_smallbuf(
     }
 }
 
-void gather_smallbuf(
-        sgData_t** restrict target,
-        sgData_t* const restrict source,
-        ssize_t* const restrict pat,
+void sg_smallbuf_morton(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
         size_t pat_len,
-        size_t delta,
+        size_t delta_gather,
+        size_t delta_scatter,
         size_t n,
-        size_t target_len) {
-
+        size_t wrap,
+        uint32_t *order) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -312,69 +447,161 @@ void gather_smallbuf(
 
 #ifdef __CRAYC__
     #pragma concurrent
-#elif defined __INTEL_COMPILER
+#endif
+#ifdef __INTEL_COMPILER
     #pragma ivdep
 #endif
-
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           sgData_t *sl = source + delta * i;
-           sgData_t *tl = target[t] + pat_len*(i%target_len);
-
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *tl = scatter + delta_scatter * order[i];
+            sgData_t *sl = gather + delta_gather * order[i];
 #ifdef __CRAYC__
     #pragma concurrent
-#elif defined __CRAYC__ || defined __INTEL_COMPILER
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
     #pragma vector always,unaligned
-#elif defined __GNUC__
-    #pragma omp simd   // or: #pragma GCC ivdep
 #endif
-           for (size_t j = 0; j < pat_len; j++) {
-               tl[j] = sl[pat[j]];
-           }
+            for (size_t j = 0; j < pat_len; j++) {
+                tl[scatter_pat[j]] = sl[gather_pat[j]];
+            }
         }
     }
 }
 
-void gather_smallbuf_morton(
-        sgData_t** restrict target,
-        sgData_t* const restrict source,
-        ssize_t* const restrict pat,
+// Non-temporal stores for --store=nt. They reach memory through the
+// write-combining buffers without a read for ownership, so a line that is
+// written in full moves once instead of twice.
+static inline void stream_store(sgData_t *p, sgData_t v)
+{
+#if defined( __x86_64__ )
+    if (sizeof(sgData_t) == sizeof(long long)) {
+        long long bits;
+        memcpy(&bits, &v, sizeof(bits));
+        _mm_stream_si64((long long *)p, bits);
+        return;
+    }
+#elif defined( __clang__ )
+    __builtin_nontemporal_store(v, p);
+    return;
+#endif
+    *p = v;
+}
+
+// Stream row[j] = src[pat[j]], or src[j] without a pattern, with 16-byte
+// stores where the row is aligned
+static inline void stream_row(sgData_t *restrict row, const sgData_t *restrict src, const ssize_t *restrict pat, size_t len)
+{
+    size_t j = 0;
+#if defined( __x86_64__ )
+    if (sizeof(sgData_t) == sizeof(double)) {
+        if (((uintptr_t)row & 15) && len) {
+            stream_store(row, pat ? src[pat[0]] : src[0]);
+            j = 1;
+        }
+        for (; j + 2 <= len; j += 2)
+            _mm_stream_pd((double *)(row + j), pat ? _mm_set_pd(src[pat[j + 1]], src[pat[j]]) : _mm_loadu_pd((const double *)(src + j)));
+    }
+#endif
+    for (; j < len; j++)
+        stream_store(row + j, pat ? src[pat[j]] : src[j]);
+}
+
+// Streaming stores are weakly ordered, make them visible before the barrier
+// that ends the kernel
+static inline void stream_fence(void)
+{
+#if defined( __x86_64__ )
+    _mm_sfence();
+#endif
+}
+
+void sg_smallbuf_nt(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
         size_t pat_len,
-        size_t delta,
+        size_t delta_gather,
+        size_t delta_scatter,
         size_t n,
-        size_t target_len,
-        uint32_t *order) {
-#ifdef __GNUC__
-    #pragma omp parallel
-#else
-    #pragma omp parallel shared(pat)
-#endif
+        size_t wrap) {
+    sp_sched_reset(n);
+#pragma omp parallel
     {
         int t = omp_get_thread_num();
 
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#ifdef __INTEL_COMPILER
-    #pragma ivdep
-#endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           sgData_t *sl = source + delta * order[i];
-           sgData_t *tl = target[t] + pat_len*(i%target_len);
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#if defined __CRAYC__ || defined __INTEL_COMPILER
-    #pragma vector always,unaligned
-#endif
-           for (size_t j = 0; j < pat_len; j++) {
-               tl[j] = sl[pat[j]];
-           }
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *tl = scatter + delta_scatter * i;
+            sgData_t *sl = gather + delta_gather * i;
+            for (size_t j = 0; j < pat_len; j++) {
+                stream_store(&tl[scatter_pat[j]], sl[gather_pat[j]]);
+            }
         }
+        stream_fence();
     }
 }
-void gather_smallbuf_rdm(
+
+void sg_smallbuf_staged(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t gather_len,
+        size_t scatter_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t tile) {
+    size_t rows = tile / (gather_len * sizeof(sgData_t));
+    if (rows < 1)
+        rows = 1;
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        sgData_t *cur = (sgData_t *)malloc(2 * rows * gather_len * sizeof(sgData_t));
+        sgData_t *next = cur + rows * gather_len;
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1)) {
+            size_t cnt = i1 - i0 < rows ? i1 - i0 : rows;
+            for (size_t r = 0; r < cnt; r++)
+                for (size_t j = 0; j < gather_len; j++)
+                    cur[r * gather_len + j] = gather[delta_gather * (i0 + r) + gather_pat[j]];
+
+            // Gather tile k + 1 into next while scattering tile k from cur,
+            // row by row, so that the loads of one overlap the stores of
+            // the other
+            for (size_t k = i0; cnt; ) {
+                size_t kn = k + cnt;
+                size_t cntn = kn >= i1 ? 0 : i1 - kn < rows ? i1 - kn : rows;
+                for (size_t r = 0; r < cnt; r++) {
+                    if (r < cntn) {
+                        const sgData_t *sl = gather + delta_gather * (kn + r);
+                        sgData_t *nl = next + r * gather_len;
+                        for (size_t j = 0; j < gather_len; j++)
+                            nl[j] = sl[gather_pat[j]];
+                    }
+                    sgData_t *tl = scatter + delta_scatter * (k + r);
+                    const sgData_t *cl = cur + r * gather_len;
+                    for (size_t j = 0, g = 0; j < scatter_len; j++, g = g + 1 == gather_len ? 0 : g + 1)
+                        tl[scatter_pat[j]] = cl[g];
+                }
+                sgData_t *swap = cur;
+                cur = next;
+                next = swap;
+                k = kn;
+                cnt = cntn;
+            }
+        }
+        free(cur < next ? cur : next);
+    }
+}
+
+void gather_smallbuf_nt(
         sgData_t** restrict target,
         sgData_t* const restrict source,
         ssize_t* const restrict pat,
@@ -382,38 +609,23 @@ void gather_smallbuf_rdm(
         size_t delta,
         size_t n,
         size_t target_len) {
-#ifdef __GNUC__
-    #pragma omp parallel
-#else
-    #pragma omp parallel shared(pat)
-#endif
+    sp_sched_reset(n);
+#pragma omp parallel
     {
         int t = omp_get_thread_num();
 
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#ifdef __INTEL_COMPILER
-    #pragma ivdep
-#endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           sgData_t *sl = source + rand()%((n-1)*delta);
-           sgData_t *tl = target[t] + pat_len*(i%target_len);
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#if defined __CRAYC__ || defined __INTEL_COMPILER
-    #pragma vector always,unaligned
-#endif
-           for (size_t j = 0; j < pat_len; j++) {
-               tl[j] = sl[pat[j]];
-           }
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            stream_row(target[t] + pat_len*(i%target_len), source + delta * i, pat, pat_len);
         }
+        stream_fence();
     }
 }
 
-void scatter_smallbuf(
+// A pattern of consecutive indices is streamed as one row, so that the
+// stores of a full line are issued back to back
+void scatter_smallbuf_nt(
         sgData_t* restrict target,
         sgData_t** const restrict source,
         ssize_t* const restrict pat,
@@ -421,38 +633,58 @@ void scatter_smallbuf(
         size_t delta,
         size_t n,
         size_t source_len) {
-#ifdef __GNUC__
-    #pragma omp parallel
-#else
-    #pragma omp parallel shared(pat)
-#endif
+    int dense = pat_len > 0;
+    for (size_t j = 1; j < pat_len; j++)
+        if (pat[j] != pat[j - 1] + 1)
+            dense = 0;
+
+    sp_sched_reset(n);
+#pragma omp parallel
     {
         int t = omp_get_thread_num();
 
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#ifdef __INTEL_COMPILER
-    #pragma ivdep
-#endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           sgData_t *tl = target + delta * i;
-           sgData_t *sl = source[t] + pat_len*(i%source_len);
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#if defined __CRAYC__ || defined __INTEL_COMPILER
-    #pragma vector always,unaligned
-#endif
-           for (size_t j = 0; j < pat_len; j++) {
-               tl[pat[j]] = sl[j];
-           }
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *tl = target + delta * i;
+            sgData_t *sl = source[t] + pat_len*(i%source_len);
+            if (dense) {
+                stream_row(tl + pat[0], sl, NULL, pat_len);
+            } else {
+                for (size_t j = 0; j < pat_len; j++)
+                    stream_store(&tl[pat[j]], sl[j]);
+            }
         }
+        stream_fence();
     }
 }
 
-void gather_smallbuf_random(
+// Software prefetch for --prefetch-distance. __builtin_prefetch needs its
+// write and locality arguments as constants.
+#define SP_PREFETCH(p, rw, nta) \
+    do { \
+        if (nta) \
+            __builtin_prefetch((p), (rw), 0); \
+        else \
+            __builtin_prefetch((p), (rw), 3); \
+    } while (0)
+
+// The pattern indices to prefetch: the first index of every run of the
+// pattern within one 64-byte line, or only pat[0] for --prefetch-scope=line
+static size_t prefetch_offsets(const ssize_t *pat, size_t pat_len, int line_only, ssize_t *pf)
+{
+    const ssize_t elems = 64 / sizeof(sgData_t);
+    size_t m = 0;
+    for (size_t j = 0; j < pat_len; j++) {
+        if (m && line_only)
+            break;
+        if (!m || pat[j] < pf[m - 1] || pat[j] >= pf[m - 1] + elems)
+            pf[m++] = pat[j];
+    }
+    return m;
+}
+
+void gather_smallbuf_prefetch(
         sgData_t** restrict target,
         sgData_t* const restrict source,
         ssize_t* const restrict pat,
@@ -460,25 +692,967 @@ void gather_smallbuf_random(
         size_t delta,
         size_t n,
         size_t target_len,
-        long initstate) {
-#ifdef __GNUC__
-    #pragma omp parallel
-#else
-    #pragma omp parallel shared(pat)
-#endif
+        size_t distance,
+        int line_only,
+        int nta) {
+    ssize_t *pf = (ssize_t *)malloc(sizeof(ssize_t) * (pat_len ? pat_len : 1));
+    size_t pf_len = prefetch_offsets(pat, pat_len, line_only, pf);
+
+    sp_sched_reset(n);
+#pragma omp parallel
     {
         int t = omp_get_thread_num();
-        pcg32_random_t rng;
-        pcg32_srandom_r(&rng, initstate, t);
 
-
-#ifdef __CRAYC__
-    #pragma concurrent
-#endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            if (i + distance < n) {
+                sgData_t *pl = source + delta * (i + distance);
+                for (size_t k = 0; k < pf_len; k++)
+                    SP_PREFETCH(pl + pf[k], 0, nta);
+            }
+            sgData_t *sl = source + delta * i;
+            sgData_t *tl = target[t] + pat_len*(i%target_len);
+            for (size_t j = 0; j < pat_len; j++) {
+                tl[j] = sl[pat[j]];
+            }
+        }
+    }
+    free(pf);
+}
+
+void scatter_smallbuf_prefetch(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t distance,
+        int line_only,
+        int nta) {
+    ssize_t *pf = (ssize_t *)malloc(sizeof(ssize_t) * (pat_len ? pat_len : 1));
+    size_t pf_len = prefetch_offsets(pat, pat_len, line_only, pf);
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            if (i + distance < n) {
+                sgData_t *pl = target + delta * (i + distance);
+                for (size_t k = 0; k < pf_len; k++)
+                    SP_PREFETCH(pl + pf[k], 1, nta);
+            }
+            sgData_t *tl = target + delta * i;
+            sgData_t *sl = source[t] + pat_len*(i%source_len);
+            for (size_t j = 0; j < pat_len; j++) {
+                tl[pat[j]] = sl[j];
+            }
+        }
+    }
+    free(pf);
+}
+
+// Gather, Scatter, MultiGather and MultiScatter with int32_t or int16_t
+// patterns for --index-bits, so that each index costs 4 or 2 bytes of
+// cache instead of 8
+#define NARROW_SMALLBUF(T, W) \
+void gather_smallbuf_i##W( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + pat_len*(i%target_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[j] = sl[pat[j]]; \
+           } \
+        } \
+    } \
+} \
+void scatter_smallbuf_i##W( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *tl = target + delta * i; \
+           sgData_t *sl = source[t] + pat_len*(i%source_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[pat[j]] = sl[j]; \
+           } \
+        } \
+    } \
+} \
+void multigather_smallbuf_i##W( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        const T* restrict outer_pat, \
+        const T* restrict inner_pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + pat_len*(i%target_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[j] = sl[outer_pat[inner_pat[j]]]; \
+           } \
+        } \
+    } \
+} \
+void multiscatter_smallbuf_i##W( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        const T* restrict outer_pat, \
+        const T* restrict inner_pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *tl = target + delta * i; \
+           sgData_t *sl = source[t] + pat_len*(i%source_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[outer_pat[inner_pat[j]]] = sl[j]; \
+           } \
+        } \
+    } \
+}
+
+NARROW_SMALLBUF(int32_t, 32)
+NARROW_SMALLBUF(int16_t, 16)
+
+// Gather and Scatter of the --elem types. The buffers are viewed as arrays
+// of T, the pattern and delta count elements of T.
+#define ELEM_SMALLBUF(T, NAME) \
+static void gather_elem_##NAME( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           const T *sl = (const T *)source + delta * i; \
+           T *tl = (T *)target[t] + pat_len*(i%target_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[j] = sl[pat[j]]; \
+           } \
+        } \
+    } \
+} \
+static void scatter_elem_##NAME( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           T *tl = (T *)target + delta * i; \
+           const T *sl = (const T *)source[t] + pat_len*(i%source_len); \
+           for (size_t j = 0; j < pat_len; j++) { \
+               tl[pat[j]] = sl[j]; \
+           } \
+        } \
+    } \
+}
+
+ELEM_SMALLBUF(float, f32)
+ELEM_SMALLBUF(int32_t, i32)
+ELEM_SMALLBUF(int64_t, i64)
+ELEM_SMALLBUF(sgC64_t, c64)
+
+// --elem=bytes:N moves opaque N-byte elements
+static void gather_elem_bytes(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t size) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            const char *sl = (const char *)source + delta * i * size;
+            char *tl = (char *)target[t] + pat_len*(i%target_len) * size;
+            for (size_t j = 0; j < pat_len; j++) {
+                memcpy(tl + j * size, sl + pat[j] * size, size);
+            }
+        }
+    }
+}
+
+static void scatter_elem_bytes(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t size) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            char *tl = (char *)target + delta * i * size;
+            const char *sl = (const char *)source[t] + pat_len*(i%source_len) * size;
+            for (size_t j = 0; j < pat_len; j++) {
+                memcpy(tl + pat[j] * size, sl + j * size, size);
+            }
+        }
+    }
+}
+
+void gather_smallbuf_elem(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    switch (elem) {
+        case ELEM_F32:
+            gather_elem_f32(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_I32:
+            gather_elem_i32(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_I64:
+            gather_elem_i64(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_C64:
+            gather_elem_c64(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_BYTES:
+            gather_elem_bytes(target, source, pat, pat_len, delta, n, target_len, elem_size);
+            return;
+        default:
+            gather_smallbuf(target, source, pat, pat_len, delta, n, target_len);
+            return;
+    }
+}
+
+void scatter_smallbuf_elem(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    switch (elem) {
+        case ELEM_F32:
+            scatter_elem_f32(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_I32:
+            scatter_elem_i32(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_I64:
+            scatter_elem_i64(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_C64:
+            scatter_elem_c64(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_BYTES:
+            scatter_elem_bytes(target, source, pat, pat_len, delta, n, source_len, elem_size);
+            return;
+        default:
+            scatter_smallbuf(target, source, pat, pat_len, delta, n, source_len);
+            return;
+    }
+}
+
+// Gather and scatter kernels specialized on the pattern length. The pattern
+// is copied into a fixed-size local array so that it can live in registers
+// and the inner loop has a constant trip count.
+#define GATHER_SMALLBUF_FIXED(V) \
+static void gather_smallbuf_##V( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        ssize_t p[V]; \
+        for (size_t j = 0; j < V; j++) \
+            p[j] = pat[j]; \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + V*(i%target_len); \
+           SP_UNROLL \
+           for (size_t j = 0; j < V; j++) { \
+               tl[j] = sl[p[j]]; \
+           } \
+        } \
+    } \
+}
+
+#define SCATTER_SMALLBUF_FIXED(V) \
+static void scatter_smallbuf_##V( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        ssize_t p[V]; \
+        for (size_t j = 0; j < V; j++) \
+            p[j] = pat[j]; \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *tl = target + delta * i; \
+           sgData_t *sl = source[t] + V*(i%source_len); \
+           SP_UNROLL \
+           for (size_t j = 0; j < V; j++) { \
+               tl[p[j]] = sl[j]; \
+           } \
+        } \
+    } \
+}
+
+SP_FOREACH_FIXED_LEN(GATHER_SMALLBUF_FIXED)
+SP_FOREACH_FIXED_LEN(SCATTER_SMALLBUF_FIXED)
+
+void gather_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+
+    switch (pat_len) {
+#define GATHER_SMALLBUF_CASE(V) \
+    case V: \
+        gather_smallbuf_##V(target, source, pat, delta, n, target_len); \
+        return;
+    SP_FOREACH_FIXED_LEN(GATHER_SMALLBUF_CASE)
+#undef GATHER_SMALLBUF_CASE
+    default:
+        break;
+    }
+
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#elif defined __INTEL_COMPILER
+    #pragma ivdep
+#endif
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#elif defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#elif defined __GNUC__
+    #pragma omp simd   // or: #pragma GCC ivdep
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[j] = sl[pat[j]];
+           }
+        }
+    }
+}
+
+// --min-sample: reps Gathers of the whole config inside one parallel
+// region, so the fork and join are paid once per sample instead of once
+// per repetition. Each thread keeps its static block and waits at a
+// barrier after every repetition.
+void gather_smallbuf_reps(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t reps) {
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t i0 = n * t / nt, i1 = n * (t + 1) / nt;
+
+        for (size_t r = 0; r < reps; r++) {
+            for (size_t i = i0; i < i1; i++) {
+               sgData_t *sl = source + delta * i;
+               sgData_t *tl = target[t] + pat_len*(i%target_len);
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#elif defined __GNUC__
+    #pragma omp simd
+#endif
+               for (size_t j = 0; j < pat_len; j++) {
+                   tl[j] = sl[pat[j]];
+               }
+            }
+#pragma omp barrier
+        }
+    }
+}
+
+void scatter_smallbuf_reps(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t reps) {
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t i0 = n * t / nt, i1 = n * (t + 1) / nt;
+
+        for (size_t r = 0; r < reps; r++) {
+            for (size_t i = i0; i < i1; i++) {
+               sgData_t *tl = target + delta * i;
+               sgData_t *sl = source[t] + pat_len*(i%source_len);
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+               for (size_t j = 0; j < pat_len; j++) {
+                   tl[pat[j]] = sl[j];
+               }
+            }
+#pragma omp barrier
+        }
+    }
+}
+
+// --rate: each thread issues its static block of Gathers one at a time,
+// spinning on the tick counter until the next one is due, and records
+// the ticks each Gather took in its own histogram. A thread that falls
+// behind issues back to back until it has caught up.
+void gather_smallbuf_paced(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint64_t interval,
+        struct sp_hist *hists) {
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int nt = omp_get_num_threads();
+        size_t i0 = n * t / nt, i1 = n * (t + 1) / nt;
+        uint64_t next = sg_ticks();
+
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *sl = source + delta * i;
+            sgData_t *tl = target[t] + pat_len*(i%target_len);
+
+            uint64_t t0;
+            while ((t0 = sg_ticks()) < next)
+                ;
+            next += interval;
+            for (size_t j = 0; j < pat_len; j++) {
+                tl[j] = sl[pat[j]];
+            }
+            uint64_t t1 = sg_ticks();
+            if (hists)
+                sp_hist_add(&hists[t], t1 - t0);
+        }
+    }
+}
+
+void gather_smallbuf_replicated(
+        sgData_t** restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+        sgData_t *src = source[t];
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = src + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[j] = sl[pat[j]];
+           }
+        }
+    }
+}
+
+void scatter_smallbuf_replicated(
+        sgData_t** restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+        sgData_t *dst = target[t];
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = dst + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[pat[j]] = sl[j];
+           }
+        }
+    }
+}
+
+void gather_smallbuf_morton(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint32_t *order) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * order[i];
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[j] = sl[pat[j]];
+           }
+        }
+    }
+}
+
+void scatter_smallbuf_morton(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * order[i];
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[pat[j]] = sl[j];
+           }
+        }
+    }
+}
+void gather_smallbuf_rdm(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + rand()%((n-1)*delta);
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[j] = sl[pat[j]];
+           }
+        }
+    }
+}
+
+void scatter_smallbuf(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+
+    switch (pat_len) {
+#define SCATTER_SMALLBUF_CASE(V) \
+    case V: \
+        scatter_smallbuf_##V(target, source, pat, delta, n, source_len); \
+        return;
+    SP_FOREACH_FIXED_LEN(SCATTER_SMALLBUF_CASE)
+#undef SCATTER_SMALLBUF_CASE
+    default:
+        break;
+    }
+
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#ifdef __INTEL_COMPILER
+    #pragma ivdep
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+#if defined __CRAYC__ || defined __INTEL_COMPILER
+    #pragma vector always,unaligned
+#endif
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[pat[j]] = sl[j];
+           }
+        }
+    }
+}
+
+// No ivdep here, a pattern may repeat an index
+void scatter_smallbuf_accum(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           for (size_t j = 0; j < pat_len; j++) {
+               tl[pat[j]] += sl[j];
+           }
+        }
+    }
+}
+
+void scatter_smallbuf_atomic(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           for (size_t j = 0; j < pat_len; j++) {
+#pragma omp atomic
+               tl[pat[j]] += sl[j];
+           }
+        }
+    }
+}
+
+void gather_stream(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t source_len,
+        size_t target_len) {
+    // Traces are usually wrapped to a power of two, avoid the division
+    int pow2 = (source_len & (source_len - 1)) == 0;
+    uint64_t mask = source_len - 1;
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        sgData_t *tl = target[t];
+        if (pow2) {
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++) {
+                tl[i % target_len] = source[idx[i] & mask];
+            }
+        } else {
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++) {
+                tl[i % target_len] = source[idx[i] % source_len];
+            }
+        }
+    }
+}
+
+void scatter_stream(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t target_len,
+        size_t source_len) {
+    int pow2 = (target_len & (target_len - 1)) == 0;
+    uint64_t mask = target_len - 1;
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        sgData_t *sl = source[t];
+        if (pow2) {
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++) {
+                target[idx[i] & mask] = sl[i % source_len];
+            }
+        } else {
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; i++) {
+                target[idx[i] % target_len] = sl[i % source_len];
+            }
+        }
+    }
+}
+
+void gather_smallbuf_random(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        long initstate,
+        const uint32_t *bases) {
+    sp_sched_reset(n);
+#ifdef __GNUC__
+    #pragma omp parallel
+#else
+    #pragma omp parallel shared(pat)
+#endif
+    {
+        int t = omp_get_thread_num();
+
+#ifdef __CRAYC__
+    #pragma concurrent
+#endif
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
             //long r = ()%n;
-           uint32_t r = pcg32_boundedrand_r(&rng, (uint32_t)n);
+           uint32_t r = bases ? bases[i] : sp_rand_bounded(initstate, i, (uint32_t)n);
            sgData_t *sl = source + delta * r;
            sgData_t *tl = target[t] + pat_len*(i%target_len);
 #ifdef __CRAYC__
@@ -500,8 +1674,10 @@ void scatter_smallbuf_random(
         size_t delta,
         size_t n,
         size_t source_len,
-        long initstate) {
+        long initstate,
+        const uint32_t *bases) {
     if (n > 1ll<<32) {printf("n too big for rng, exiting.\n"); exit(1);}
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -509,15 +1685,14 @@ void scatter_smallbuf_random(
 #endif
     {
         int t = omp_get_thread_num();
-        pcg32_random_t rng;
-        pcg32_srandom_r(&rng, initstate, t);
 
 #ifdef __CRAYC__
     #pragma concurrent
 #endif
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
-           uint32_t r = pcg32_boundedrand_r(&rng, (uint32_t)n);
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           uint32_t r = bases ? bases[i] : sp_rand_bounded(initstate, i, (uint32_t)n);
            sgData_t *tl = target + delta * r;
            sgData_t *sl = source[t] + pat_len*(i%source_len);
 #ifdef __CRAYC__
@@ -541,6 +1716,7 @@ void gather_smallbuf_multidelta(
         size_t n,
         size_t target_len,
         size_t delta_len) {
+    sp_sched_reset(n);
 #ifdef __GNUC__
     #pragma omp parallel
 #else
@@ -552,8 +1728,9 @@ void gather_smallbuf_multidelta(
     #pragma concurrent
 #endif
         //taget_len is in multiples of pat_len
-#pragma omp for
-        for (size_t i = 0; i < n; i++) {
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
            sgData_t *sl = source + (i/delta_len)*delta[delta_len-1] + delta[i%delta_len] - delta[0];
            sgData_t *tl = target[t] + pat_len*(i%target_len);
            //sgData_t *sl = source;
@@ -571,3 +1748,131 @@ void gather_smallbuf_multidelta(
     }
 }
 
+
+void chase_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t target_len,
+        const size_t* restrict head,
+        const size_t* restrict len,
+        int threads,
+        int chains) {
+    // Not scheduled, each chain is one dependent sequence
+    #pragma omp parallel num_threads(threads)
+    {
+        for (int t = omp_get_thread_num(); t < threads; t += omp_get_num_threads()) {
+            const size_t *h = head + (size_t)t * chains;
+            const size_t *l = len + (size_t)t * chains;
+            size_t b[SP_MAX_CHAINS];
+            size_t hops = 0;
+            for (int c = 0; c < chains; c++) {
+                b[c] = h[c];
+                if (l[c] > hops)
+                    hops = l[c];
+            }
+
+            size_t w = 0;
+            for (size_t s = 0; s < hops; s++) {
+                for (int c = 0; c < chains; c++) {
+                    if (s >= l[c])
+                        continue;
+                    sgData_t *sl = source + b[c];
+                    sgData_t *tl = target[t] + pat_len*w;
+                    if (++w == target_len)
+                        w = 0;
+                    for (size_t j = 0; j < pat_len; j++) {
+                        tl[j] = sl[pat[j]];
+                    }
+                    // The next base is the one loaded, not computed
+                    memcpy(&b[c], &sl[pat[0]], sizeof(size_t));
+                }
+            }
+        }
+    }
+}
+
+void pack_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = r->n2 * r->n1 * r->run;
+    sp_sched_reset(n);
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *sl = source + delta * i + r->off;
+            sgData_t *tl = target[t] + len*(i%target_len);
+            for (size_t o = 0; o < r->n2; o++) {
+                for (size_t k = 0; k < r->n1; k++) {
+                    const sgData_t *row = sl + o * r->s2 + k * r->s1;
+                    for (size_t e = 0; e < r->run; e++)
+                        tl[e] = row[e];
+                    tl += r->run;
+                }
+            }
+        }
+    }
+}
+
+void unpack_smallbuf(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    size_t len = r->n2 * r->n1 * r->run;
+    sp_sched_reset(n);
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *tl = target + delta * i + r->off;
+            const sgData_t *sl = source[t] + len*(i%source_len);
+            for (size_t o = 0; o < r->n2; o++) {
+                for (size_t k = 0; k < r->n1; k++) {
+                    sgData_t *row = tl + o * r->s2 + k * r->s1;
+                    for (size_t e = 0; e < r->run; e++)
+                        row[e] = sl[e];
+                    sl += r->run;
+                }
+            }
+        }
+    }
+}
+
+void transpose_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = cells * cell;
+    sp_sched_reset(n);
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            const sgData_t *sl = source + delta * i;
+            sgData_t *tl = target[t] + len*(i%target_len);
+            // Stores stream along each field, loads stride by the cell
+            for (size_t e = 0; e < cell; e++)
+                for (size_t c = 0; c < cells; c++)
+                    tl[e * cells + c] = sl[c * cell + e];
+        }
+    }
+}
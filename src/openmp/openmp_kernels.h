@@ -7,6 +7,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include "../include/sgtype.h"
+#include "../include/lat-hist.h"
+#include "../include/box.h"
 
 void sg_omp(
             sgData_t* restrict target,
@@ -112,6 +114,38 @@ void multiscatter_smallbuf(
         size_t n,
         size_t source_len);
 
+/** @brief multiscatter_smallbuf with Scatter i at offset order[i] */
+void multiscatter_smallbuf_morton(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order);
+
+void multigather_smallbuf_stream(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_stream,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+
+void multiscatter_smallbuf_stream(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_stream,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
 void multigather_smallbuf_random(
         sgData_t** restrict target,
         sgData_t* restrict source,
@@ -157,6 +191,194 @@ void sg_smallbuf(
         size_t n,
         size_t wrap);
 
+/** @brief sg_smallbuf with both sides of GS i at offset order[i] */
+void sg_smallbuf_morton(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t pat_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t wrap,
+        uint32_t *order);
+
+/** @brief GS with gather_len and scatter_len elements per GS i. Each thread
+ *  gathers the rows of up to tile bytes of GS into a staging tile, and
+ *  scatters them from there while it gathers the next tile into a second
+ *  one, as pack/unpack and halo exchange codes do. Scatter element j of GS
+ *  i takes gathered element j % gather_len.
+ */
+void sg_smallbuf_staged(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t gather_len,
+        size_t scatter_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t tile);
+
+/** @brief --store=nt variants of sg_smallbuf, gather_smallbuf and
+ *  scatter_smallbuf. The Gathers stream their dense target rows, the
+ *  Scatters and GS the sparse target, with non-temporal stores.
+ */
+void sg_smallbuf_nt(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t pat_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t wrap);
+void gather_smallbuf_nt(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_nt(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief --prefetch-distance variants of gather_smallbuf and
+ *  scatter_smallbuf. Gather or Scatter i first prefetches the sparse lines
+ *  of i + distance, all of them or only the first with line_only, with a
+ *  T0 or (nta) NTA hint.
+ */
+void gather_smallbuf_prefetch(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t distance,
+        int line_only,
+        int nta);
+void scatter_smallbuf_prefetch(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t distance,
+        int line_only,
+        int nta);
+
+/** @brief --index-bits=32 and 16 variants of gather_smallbuf,
+ *  scatter_smallbuf, multigather_smallbuf and multiscatter_smallbuf, which
+ *  read int32_t or int16_t patterns.
+ */
+void gather_smallbuf_i32(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_i32(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+void multigather_smallbuf_i32(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int32_t* restrict outer_pat,
+        const int32_t* restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void multiscatter_smallbuf_i32(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int32_t* restrict outer_pat,
+        const int32_t* restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+void gather_smallbuf_i16(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_i16(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+void multigather_smallbuf_i16(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int16_t* restrict outer_pat,
+        const int16_t* restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void multiscatter_smallbuf_i16(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int16_t* restrict outer_pat,
+        const int16_t* restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief gather_smallbuf and scatter_smallbuf for the --elem types. The
+ *  buffers hold elements of elem_size bytes, which the pattern, delta and
+ *  wrap count. ELEM_F64 runs the plain kernels.
+ */
+void gather_smallbuf_elem(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_elem(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
 void gather_smallbuf(
         sgData_t** restrict target,
         sgData_t* restrict source,
@@ -166,6 +388,114 @@ void gather_smallbuf(
         size_t n,
         size_t target_len);
 
+/** @brief gather_smallbuf and scatter_smallbuf repeated reps times in one
+ *  parallel region, with a static split and a barrier after every
+ *  repetition (--min-sample)
+ */
+void gather_smallbuf_reps(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t reps);
+
+void scatter_smallbuf_reps(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t reps);
+
+/** @brief gather_smallbuf with a static split, each thread issuing one
+ *  Gather every interval ticks of sg_ticks and adding the ticks each took
+ *  to hists[t], unless hists is NULL (--rate)
+ */
+void gather_smallbuf_paced(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint64_t interval,
+        struct sp_hist *hists);
+
+/** @brief gather_smallbuf reading from a per-thread copy of the source,
+ *  source[t] is the replica on the NUMA node of thread t.
+ */
+void gather_smallbuf_replicated(
+        sgData_t** restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+
+/** @brief scatter_smallbuf writing into a per-thread copy of the sparse
+ *  buffer, target[t] is the replica on the NUMA node of thread t.
+ */
+void scatter_smallbuf_replicated(
+        sgData_t** restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief Gather for a streamed trace chunk (-pTRACE): thread t gathers
+ *  source[idx[i] % source_len] into slot i % target_len of target[t].
+ */
+void gather_stream(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t source_len,
+        size_t target_len);
+
+/** @brief Scatter for a streamed trace chunk (-pTRACE): target[idx[i] %
+ *  target_len] is written from slot i % source_len of source[t].
+ */
+void scatter_stream(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t target_len,
+        size_t source_len);
+
+/** @brief scatter_smallbuf with target[delta*i + pat[j]] += instead of =.
+ *  Updates to the same element from different threads are not protected,
+ *  so the result is only exact if the scatters do not overlap.
+ */
+void scatter_smallbuf_accum(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief scatter_smallbuf_accum with every update an omp atomic */
+void scatter_smallbuf_atomic(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
 void gather_smallbuf_morton(
         sgData_t** restrict target,
         sgData_t* restrict source,
@@ -176,6 +506,17 @@ void gather_smallbuf_morton(
         size_t target_len,
         uint32_t *order);
 
+/** @brief scatter_smallbuf with Scatter i at offset order[i] */
+void scatter_smallbuf_morton(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order);
+
 void scatter_smallbuf(
         sgData_t* restrict target,
         sgData_t** restrict source,
@@ -193,7 +534,8 @@ void gather_smallbuf_random(
         size_t delta,
         size_t n,
         size_t target_len,
-        long initstate);
+        long initstate,
+        const uint32_t *bases);
 
 void scatter_smallbuf_random(
         sgData_t* restrict target,
@@ -203,7 +545,8 @@ void scatter_smallbuf_random(
         size_t delta,
         size_t n,
         size_t source_len,
-        long initstate);
+        long initstate,
+        const uint32_t *bases);
 
 void gather_smallbuf_multidelta(
         sgData_t** restrict target,
@@ -215,6 +558,46 @@ void gather_smallbuf_multidelta(
         size_t target_len,
         size_t delta_len);
 
+// Chains of dependent Gathers, see chase.h. Thread t follows chains
+// [t * chains, (t + 1) * chains) of head and len.
+void chase_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t target_len,
+        const size_t* restrict head,
+        const size_t* restrict len,
+        int threads,
+        int chains);
 
+// PACK and UNPACK of the face r of box i, at source + delta * i, to and
+// from slot i % target_len of the dense buffer. The indices are computed
+// from the rows of the face, no pattern is read.
+void pack_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void unpack_smallbuf(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+// TRANSPOSE of box i, cells of cell elements each, from AoS at
+// source + delta * i to SoA in slot i % target_len
+void transpose_smallbuf(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len);
 
 #endif
@@ -0,0 +1,781 @@
+#include "openmp_simd_kernels.h"
+#include "openmp_kernels.h"
+#include "omp-sched.h"
+#include "../include/backend-support-tests.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if !defined( USE_OPENMP )
+#define omp_get_thread_num() 0
+#endif
+
+// The vector kernels are compiled with function-level target attributes so
+// that the default build (no -march flags) still contains every x86 variant.
+// Which one runs is decided at runtime, see sg_simd_support().
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SP_X86_SIMD
+#include <immintrin.h>
+#define SP_TARGET_AVX2   __attribute__((target("avx2")))
+#define SP_TARGET_AVX512 __attribute__((target("avx512f")))
+#define SP_TARGET_AVX512CD __attribute__((target("avx512f,avx512cd")))
+#endif
+
+#if defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#endif
+
+#ifdef SP_X86_SIMD
+SP_TARGET_AVX2
+static void gather_smallbuf_avx2(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    // 4 doubles per vector
+    size_t vec_len = pat_len & ~(size_t)3;
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+
+           size_t j = 0;
+           for (; j < vec_len; j += 4) {
+               __m256i idx = _mm256_loadu_si256((__m256i const *)(pat + j));
+               __m256d v   = _mm256_i64gather_pd(sl, idx, sizeof(sgData_t));
+               _mm256_storeu_pd(tl + j, v);
+           }
+           for (; j < pat_len; j++) {
+               tl[j] = sl[pat[j]];
+           }
+        }
+    }
+}
+
+// AVX2 has no scatter instruction: the dense side is read with a vector
+// load and the lanes are stored one at a time.
+SP_TARGET_AVX2
+static void scatter_smallbuf_avx2(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    size_t vec_len = pat_len & ~(size_t)3;
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           size_t j = 0;
+           for (; j < vec_len; j += 4) {
+               __m256d v  = _mm256_loadu_pd(sl + j);
+               __m128d lo = _mm256_castpd256_pd128(v);
+               __m128d hi = _mm256_extractf128_pd(v, 1);
+               _mm_storel_pd(tl + pat[j],   lo);
+               _mm_storeh_pd(tl + pat[j+1], lo);
+               _mm_storel_pd(tl + pat[j+2], hi);
+               _mm_storeh_pd(tl + pat[j+3], hi);
+           }
+           for (; j < pat_len; j++) {
+               tl[pat[j]] = sl[j];
+           }
+        }
+    }
+}
+
+SP_TARGET_AVX512
+static void gather_smallbuf_avx512(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    // 8 doubles per vector, the tail is handled with a masked gather
+    size_t vec_len = pat_len & ~(size_t)7;
+    __mmask8 tail = (__mmask8)((1u << (pat_len - vec_len)) - 1);
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+
+           size_t j = 0;
+           for (; j < vec_len; j += 8) {
+               __m512i idx = _mm512_loadu_si512((void const *)(pat + j));
+               __m512d v   = _mm512_i64gather_pd(idx, sl, sizeof(sgData_t));
+               _mm512_storeu_pd(tl + j, v);
+           }
+           if (tail) {
+               __m512i idx = _mm512_maskz_loadu_epi64(tail, (void const *)(pat + j));
+               __m512d v   = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), tail, idx, sl, sizeof(sgData_t));
+               _mm512_mask_storeu_pd(tl + j, tail, v);
+           }
+        }
+    }
+}
+
+SP_TARGET_AVX512
+static void scatter_smallbuf_avx512(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    size_t vec_len = pat_len & ~(size_t)7;
+    __mmask8 tail = (__mmask8)((1u << (pat_len - vec_len)) - 1);
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           size_t j = 0;
+           for (; j < vec_len; j += 8) {
+               __m512i idx = _mm512_loadu_si512((void const *)(pat + j));
+               __m512d v   = _mm512_loadu_pd(sl + j);
+               _mm512_i64scatter_pd(tl, idx, v, sizeof(sgData_t));
+           }
+           if (tail) {
+               __m512i idx = _mm512_maskz_loadu_epi64(tail, (void const *)(pat + j));
+               __m512d v   = _mm512_maskz_loadu_pd(tail, sl + j);
+               _mm512_mask_i64scatter_pd(tl, tail, idx, v, sizeof(sgData_t));
+           }
+        }
+    }
+}
+
+SP_TARGET_AVX512CD
+static void scatter_smallbuf_conflict_avx512(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    size_t vec_len = pat_len & ~(size_t)7;
+    __mmask8 tail = (__mmask8)((1u << (pat_len - vec_len)) - 1);
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           for (size_t j = 0; j < pat_len; j += 8) {
+               __mmask8 todo = j < vec_len ? 0xff : tail;
+               __m512i idx  = _mm512_maskz_loadu_epi64(todo, (void const *)(pat + j));
+               __m512d v    = _mm512_maskz_loadu_pd(todo, sl + j);
+               // Bit k of lane l is set if lane k < l has the same index
+               __m512i conf = _mm512_conflict_epi64(idx);
+
+               // Each round updates the lanes that no pending lane before
+               // them collides with, so the common case is a single round
+               while (todo) {
+                   __mmask8 ready = _mm512_mask_testn_epi64_mask(todo, conf, _mm512_set1_epi64(todo));
+                   __m512d old = _mm512_mask_i64gather_pd(_mm512_setzero_pd(), ready, idx, tl, sizeof(sgData_t));
+                   _mm512_mask_i64scatter_pd(tl, ready, idx, _mm512_add_pd(old, v), sizeof(sgData_t));
+                   todo &= ~ready;
+               }
+           }
+        }
+    }
+}
+
+// Narrow index kernels for --index-bits. The indices are widened to 32
+// bits and used with the i32 forms of the gathers and scatters, which
+// read half (or a quarter) of the index bytes of the i64 forms.
+SP_TARGET_AVX2
+static inline __m128i load_idx4_i32(const int32_t *p) { return _mm_loadu_si128((__m128i const *)p); }
+SP_TARGET_AVX2
+static inline __m128i load_idx4_i16(const int16_t *p) { return _mm_cvtepi16_epi32(_mm_loadl_epi64((__m128i const *)p)); }
+SP_TARGET_AVX512
+static inline __m256i load_idx8_i32(const int32_t *p) { return _mm256_loadu_si256((__m256i const *)p); }
+SP_TARGET_AVX512
+static inline __m256i load_idx8_i16(const int16_t *p) { return _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i const *)p)); }
+
+#define NARROW_SIMD(T, W) \
+SP_TARGET_AVX2 \
+static void gather_smallbuf_i##W##_avx2( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    size_t vec_len = pat_len & ~(size_t)3; \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + pat_len*(i%target_len); \
+           size_t j = 0; \
+           for (; j < vec_len; j += 4) \
+               _mm256_storeu_pd(tl + j, _mm256_i32gather_pd(sl, load_idx4_i##W(pat + j), sizeof(sgData_t))); \
+           for (; j < pat_len; j++) \
+               tl[j] = sl[pat[j]]; \
+        } \
+    } \
+} \
+SP_TARGET_AVX512 \
+static void gather_smallbuf_i##W##_avx512( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    size_t vec_len = pat_len & ~(size_t)7; \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + pat_len*(i%target_len); \
+           size_t j = 0; \
+           for (; j < vec_len; j += 8) \
+               _mm512_storeu_pd(tl + j, _mm512_i32gather_pd(load_idx8_i##W(pat + j), sl, sizeof(sgData_t))); \
+           for (; j < pat_len; j++) \
+               tl[j] = sl[pat[j]]; \
+        } \
+    } \
+} \
+SP_TARGET_AVX512 \
+static void scatter_smallbuf_i##W##_avx512( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    size_t vec_len = pat_len & ~(size_t)7; \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *tl = target + delta * i; \
+           sgData_t *sl = source[t] + pat_len*(i%source_len); \
+           size_t j = 0; \
+           for (; j < vec_len; j += 8) \
+               _mm512_i32scatter_pd(tl, load_idx8_i##W(pat + j), _mm512_loadu_pd(sl + j), sizeof(sgData_t)); \
+           for (; j < pat_len; j++) \
+               tl[pat[j]] = sl[j]; \
+        } \
+    } \
+}
+
+NARROW_SIMD(int32_t, 32)
+NARROW_SIMD(int16_t, 16)
+#endif // SP_X86_SIMD
+
+#if defined(__ARM_FEATURE_SVE)
+static void gather_smallbuf_sve(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *sl = source + delta * i;
+           sgData_t *tl = target[t] + pat_len*(i%target_len);
+
+           for (size_t j = 0; j < pat_len; j += svcntd()) {
+               svbool_t pg    = svwhilelt_b64_u64(j, pat_len);
+               svint64_t idx  = svld1_s64(pg, (int64_t const *)(pat + j));
+               svfloat64_t v  = svld1_gather_s64index_f64(pg, sl, idx);
+               svst1_f64(pg, tl + j, v);
+           }
+        }
+    }
+}
+
+static void scatter_smallbuf_sve(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[t] + pat_len*(i%source_len);
+
+           for (size_t j = 0; j < pat_len; j += svcntd()) {
+               svbool_t pg    = svwhilelt_b64_u64(j, pat_len);
+               svint64_t idx  = svld1_s64(pg, (int64_t const *)(pat + j));
+               svfloat64_t v  = svld1_f64(pg, sl + j);
+               svst1_scatter_s64index_f64(pg, tl, idx, v);
+           }
+        }
+    }
+}
+
+// svld1sw/svld1sh load the narrow indices sign-extended into 64-bit lanes
+#define NARROW_SVE(T, W, LD) \
+static void gather_smallbuf_i##W##_sve( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *sl = source + delta * i; \
+           sgData_t *tl = target[t] + pat_len*(i%target_len); \
+           for (size_t j = 0; j < pat_len; j += svcntd()) { \
+               svbool_t pg = svwhilelt_b64_u64(j, pat_len); \
+               svst1_f64(pg, tl + j, svld1_gather_s64index_f64(pg, sl, LD(pg, pat + j))); \
+           } \
+        } \
+    } \
+} \
+static void scatter_smallbuf_i##W##_sve( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        const T* restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    sp_sched_reset(n); \
+    _Pragma("omp parallel") \
+    { \
+        int t = omp_get_thread_num(); \
+        size_t i0, i1; \
+        while (sp_sched_next(t, &i0, &i1)) \
+        for (size_t i = i0; i < i1; i++) { \
+           sgData_t *tl = target + delta * i; \
+           sgData_t *sl = source[t] + pat_len*(i%source_len); \
+           for (size_t j = 0; j < pat_len; j += svcntd()) { \
+               svbool_t pg = svwhilelt_b64_u64(j, pat_len); \
+               svst1_scatter_s64index_f64(pg, tl, LD(pg, pat + j), svld1_f64(pg, sl + j)); \
+           } \
+        } \
+    } \
+}
+
+NARROW_SVE(int32_t, 32, svld1sw_s64)
+NARROW_SVE(int16_t, 16, svld1sh_s64)
+#endif // __ARM_FEATURE_SVE
+
+#ifdef SP_X86_SIMD
+// Groups of four rows of run < 4 elements are run vectors. Lane l of
+// vector v is element (4v + l) % run of row (4v + l) / run, at an offset
+// from the first row that is the same for every group.
+SP_TARGET_AVX2
+static void pack_smallbuf_avx2(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = r->n2 * r->n1 * r->run;
+    size_t groups = r->n1 & ~(size_t)3;
+    __m256i idx[3];
+    for (size_t v = 0; v < r->run; v++) {
+        long long off[4];
+        for (size_t l = 0; l < 4; l++)
+            off[l] = (long long)(((4*v + l) / r->run) * r->s1 + (4*v + l) % r->run);
+        idx[v] = _mm256_setr_epi64x(off[0], off[1], off[2], off[3]);
+    }
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            sgData_t *sl = source + delta * i + r->off;
+            sgData_t *tl = target[t] + len*(i%target_len);
+            for (size_t o = 0; o < r->n2; o++) {
+                const sgData_t *plane = sl + o * r->s2;
+                size_t k = 0;
+                for (; k < groups; k += 4) {
+                    for (size_t v = 0; v < r->run; v++)
+                        _mm256_storeu_pd(tl + 4*v, _mm256_i64gather_pd(plane + k * r->s1, idx[v], sizeof(sgData_t)));
+                    tl += 4 * r->run;
+                }
+                for (; k < r->n1; k++) {
+                    for (size_t e = 0; e < r->run; e++)
+                        tl[e] = plane[k * r->s1 + e];
+                    tl += r->run;
+                }
+            }
+        }
+    }
+}
+
+// Four cells at a time: the cell elements are loaded as cell vectors and
+// permuted into one vector per field
+SP_TARGET_AVX2
+static void transpose_smallbuf_avx2(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = cells * cell;
+    size_t vec = cells & ~(size_t)3;
+
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++) {
+            const sgData_t *sl = source + delta * i;
+            sgData_t *tl = target[t] + len*(i%target_len);
+            size_t c = 0;
+            if (cell == 2) {
+                for (; c < vec; c += 4) {
+                    // [x0 y0 x1 y1] [x2 y2 x3 y3]
+                    __m256d a = _mm256_loadu_pd(sl + 2*c);
+                    __m256d b = _mm256_loadu_pd(sl + 2*c + 4);
+                    _mm256_storeu_pd(tl + c, _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8));
+                    _mm256_storeu_pd(tl + cells + c, _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8));
+                }
+            } else if (cell == 3) {
+                for (; c < vec; c += 4) {
+                    // [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+                    __m256d a = _mm256_loadu_pd(sl + 3*c);
+                    __m256d b = _mm256_loadu_pd(sl + 3*c + 4);
+                    __m256d d = _mm256_loadu_pd(sl + 3*c + 8);
+                    // [x0 y0 z2 x3] and [z0 x1 y3 z3]
+                    __m256d u = _mm256_permute2f128_pd(a, d, 0x20);
+                    __m256d w = _mm256_permute2f128_pd(a, d, 0x31);
+                    __m256d x = _mm256_blend_pd(_mm256_blend_pd(u, w, 0x2), b, 0x4);
+                    __m256d y = _mm256_shuffle_pd(_mm256_blend_pd(u, b, 0xC), _mm256_blend_pd(b, w, 0xC), 0x5);
+                    __m256d z = _mm256_blend_pd(_mm256_blend_pd(w, b, 0x2), u, 0x4);
+                    _mm256_storeu_pd(tl + c, x);
+                    _mm256_storeu_pd(tl + cells + c, y);
+                    _mm256_storeu_pd(tl + 2*cells + c, z);
+                }
+            } else if (cell == 4) {
+                for (; c < vec; c += 4) {
+                    __m256d a = _mm256_loadu_pd(sl + 4*c);
+                    __m256d b = _mm256_loadu_pd(sl + 4*c + 4);
+                    __m256d d = _mm256_loadu_pd(sl + 4*c + 8);
+                    __m256d e = _mm256_loadu_pd(sl + 4*c + 12);
+                    __m256d t0 = _mm256_unpacklo_pd(a, b);
+                    __m256d t1 = _mm256_unpackhi_pd(a, b);
+                    __m256d t2 = _mm256_unpacklo_pd(d, e);
+                    __m256d t3 = _mm256_unpackhi_pd(d, e);
+                    _mm256_storeu_pd(tl + c, _mm256_permute2f128_pd(t0, t2, 0x20));
+                    _mm256_storeu_pd(tl + cells + c, _mm256_permute2f128_pd(t1, t3, 0x20));
+                    _mm256_storeu_pd(tl + 2*cells + c, _mm256_permute2f128_pd(t0, t2, 0x31));
+                    _mm256_storeu_pd(tl + 3*cells + c, _mm256_permute2f128_pd(t1, t3, 0x31));
+                }
+            }
+            for (; c < cells; c++)
+                for (size_t e = 0; e < cell; e++)
+                    tl[e * cells + c] = sl[c * cell + e];
+        }
+    }
+}
+#endif
+
+void gather_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX2:
+            gather_smallbuf_avx2(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case SIMD_AVX512:
+            gather_smallbuf_avx512(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            gather_smallbuf_sve(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+        default:
+            gather_smallbuf(target, source, pat, pat_len, delta, n, target_len);
+            return;
+    }
+}
+
+void scatter_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX2:
+            scatter_smallbuf_avx2(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case SIMD_AVX512:
+            scatter_smallbuf_avx512(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            scatter_smallbuf_sve(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+        default:
+            scatter_smallbuf(target, source, pat, pat_len, delta, n, source_len);
+            return;
+    }
+}
+
+void gather_smallbuf_i32_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX2:
+            gather_smallbuf_i32_avx2(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case SIMD_AVX512:
+            gather_smallbuf_i32_avx512(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            gather_smallbuf_i32_sve(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+        default:
+            gather_smallbuf_i32(target, source, pat, pat_len, delta, n, target_len);
+            return;
+    }
+}
+
+// AVX2 has no scatter instruction, it runs the plain C kernel
+void scatter_smallbuf_i32_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX512:
+            scatter_smallbuf_i32_avx512(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            scatter_smallbuf_i32_sve(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+        default:
+            scatter_smallbuf_i32(target, source, pat, pat_len, delta, n, source_len);
+            return;
+    }
+}
+
+void gather_smallbuf_i16_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX2:
+            gather_smallbuf_i16_avx2(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case SIMD_AVX512:
+            gather_smallbuf_i16_avx512(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            gather_smallbuf_i16_sve(target, source, pat, pat_len, delta, n, target_len);
+            return;
+#endif
+        default:
+            gather_smallbuf_i16(target, source, pat, pat_len, delta, n, target_len);
+            return;
+    }
+}
+
+// AVX2 has no scatter instruction, it runs the plain C kernel
+void scatter_smallbuf_i16_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    switch (isa) {
+#ifdef SP_X86_SIMD
+        case SIMD_AVX512:
+            scatter_smallbuf_i16_avx512(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+#if defined(__ARM_FEATURE_SVE)
+        case SIMD_SVE:
+            scatter_smallbuf_i16_sve(target, source, pat, pat_len, delta, n, source_len);
+            return;
+#endif
+        default:
+            scatter_smallbuf_i16(target, source, pat, pat_len, delta, n, source_len);
+            return;
+    }
+}
+
+void scatter_smallbuf_conflict(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+#ifdef SP_X86_SIMD
+    if (sg_conflict_support()) {
+        scatter_smallbuf_conflict_avx512(target, source, pat, pat_len, delta, n, source_len);
+        return;
+    }
+#endif
+    scatter_smallbuf_accum(target, source, pat, pat_len, delta, n, source_len);
+}
+
+void pack_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+#ifdef SP_X86_SIMD
+    if ((isa == SIMD_AVX2 || isa == SIMD_AVX512) && r->run < 4 && r->n1 >= 4) {
+        pack_smallbuf_avx2(target, source, r, delta, n, target_len);
+        return;
+    }
+#endif
+    pack_smallbuf(target, source, r, delta, n, target_len);
+}
+
+void transpose_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+#ifdef SP_X86_SIMD
+    if ((isa == SIMD_AVX2 || isa == SIMD_AVX512) && cell >= 2 && cell <= 4) {
+        transpose_smallbuf_avx2(target, source, cells, cell, delta, n, target_len);
+        return;
+    }
+#endif
+    transpose_smallbuf(target, source, cells, cell, delta, n, target_len);
+}
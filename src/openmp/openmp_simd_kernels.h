@@ -0,0 +1,112 @@
+#ifndef OMP_SIMD_KERNELS_H
+#define OMP_SIMD_KERNELS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "../include/sgtype.h"
+#include "../include/parse-args.h"
+
+/** @brief Hand-written vector versions of gather_smallbuf/scatter_smallbuf.
+ *  The isa argument must be a resolved ISA (not SIMD_AUTO), see
+ *  sg_simd_resolve(). SIMD_SCALAR falls through to the plain C kernels.
+ */
+void gather_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+
+void scatter_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief Vector versions of the --index-bits kernels gather_smallbuf_i32,
+ *  scatter_smallbuf_i32 and their 16-bit forms, with AVX2 and AVX-512 i32
+ *  gathers and scatters or SVE sign-extending index loads.
+ */
+void gather_smallbuf_i32_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_i32_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int32_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+void gather_smallbuf_i16_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void scatter_smallbuf_i16_simd(
+        enum sg_simd isa,
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const int16_t* restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief scatter_smallbuf_accum vectorized with AVX-512CD: indices that
+ *  repeat within one vector are found with vpconflictq and their lanes are
+ *  added in turn. Like scatter_smallbuf_accum, threads are not synchronized.
+ *  Needs sg_conflict_support(), otherwise runs scatter_smallbuf_accum.
+ */
+void scatter_smallbuf_conflict(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+/** @brief pack_smallbuf and transpose_smallbuf with AVX2 permutes. Faces
+ *  whose rows are shorter than a vector are packed four rows at a time
+ *  with gathers from computed offsets, boxes of 2, 3 or 4 element cells
+ *  are transposed four cells at a time in registers. Other boxes, and
+ *  ISAs other than AVX2 and AVX-512, run the plain C kernels.
+ */
+void pack_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void transpose_smallbuf_simd(
+        enum sg_simd isa,
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+
+#endif
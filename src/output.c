@@ -0,0 +1,399 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "output.h"
+#include "energy.h"
+#include "graph.h"
+
+static FILE *out = NULL;
+static enum sp_output_format out_fmt = OUTPUT_NONE;
+static struct sp_output_meta out_meta;
+static char host[STRING_SIZE];
+static char backend[STRING_SIZE];
+static char device[STRING_SIZE];
+static const char *papi_events[SP_OUTPUT_MAX_EVENTS];
+
+const char *sp_kernel_name(enum sg_kernel kernel)
+{
+    switch (kernel) {
+    case SCATTER:      return "Scatter";
+    case GATHER:       return "Gather";
+    case GS:           return "GS";
+    case MULTISCATTER: return "MultiScatter";
+    case MULTIGATHER:  return "MultiGather";
+    case CHASE:        return "Chase";
+    default:           return "Invalid";
+    }
+}
+
+const char *sp_config_kernel_name(const struct run_config *rc)
+{
+    switch (rc->box_op) {
+    case BOX_PACK:      return "Pack";
+    case BOX_UNPACK:    return "Unpack";
+    case BOX_TRANSPOSE: return "Transpose";
+    default:            return sp_kernel_name(rc->kernel);
+    }
+}
+
+static const char *op_name(enum sg_op op)
+{
+    const char *names[] = {"COPY", "ACCUM", "ATOMIC", "CONFLICT"};
+    return op < INVALID_OP ? names[op] : "INVALID";
+}
+
+static void elem_name(const struct run_config *rc, char *buf, size_t len)
+{
+    const char *names[] = {"f64", "f32", "i32", "i64", "c64"};
+    if (rc->elem == ELEM_BYTES)
+        snprintf(buf, len, "bytes:%zu", rc->elem_size);
+    else
+        snprintf(buf, len, "%s", rc->elem < ELEM_BYTES ? names[rc->elem] : "f64");
+}
+
+// A JSON string, escaping quotes, backslashes and control characters
+static void json_str(const char *s)
+{
+    fputc('"', out);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// A CSV field, quoted if it holds a separator, quote or newline
+static void csv_str(const char *s)
+{
+    if (!s)
+        s = "";
+    if (!strpbrk(s, ",\"\n")) {
+        fputs(s, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"')
+            fputc('"', out);
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void json_idx_array(const char *key, const ssize_t *v, size_t n)
+{
+    fprintf(out, ",\"%s\":[", key);
+    for (size_t j = 0; j < n; j++)
+        fprintf(out, j ? ",%zd" : "%zd", v[j]);
+    fputc(']', out);
+}
+
+int sp_output_parse(const char *arg, enum sp_output_format *fmt, char *path, size_t len)
+{
+    const char *colon = strchr(arg, ':');
+    if (!colon || !colon[1])
+        return -1;
+    if (!strncasecmp(arg, "json", colon - arg) && colon - arg == 4)
+        *fmt = OUTPUT_JSON;
+    else if (!strncasecmp(arg, "csv", colon - arg) && colon - arg == 3)
+        *fmt = OUTPUT_CSV;
+    else
+        return -1;
+    snprintf(path, len, "%s", colon + 1);
+    return 0;
+}
+
+int sp_output_open(enum sp_output_format fmt, const char *path, int append, const struct sp_output_meta *meta)
+{
+    FILE *f = fopen(path, append ? "a" : "w");
+    if (!f)
+        return -1;
+    sp_output_attach(f, fmt, meta);
+    return 0;
+}
+
+void sp_output_attach(FILE *f, enum sp_output_format fmt, const struct sp_output_meta *meta)
+{
+    out = f;
+    out_fmt = fmt;
+    if (meta) {
+        for (int e = 0; e < out_meta.npapi; e++)
+            free((char *)papi_events[e]);
+        // The CSV rows repeat the backend and device, keep a copy of them
+        out_meta = *meta;
+        snprintf(backend, sizeof(backend), "%s", meta->backend);
+        snprintf(device, sizeof(device), "%s", meta->device);
+        out_meta.backend = backend;
+        out_meta.device = device;
+        if (out_meta.npapi > SP_OUTPUT_MAX_EVENTS)
+            out_meta.npapi = SP_OUTPUT_MAX_EVENTS;
+        for (int e = 0; e < out_meta.npapi; e++)
+            papi_events[e] = strdup(meta->papi_events[e]);
+        out_meta.papi_events = papi_events;
+    }
+    meta = &out_meta;
+    if (gethostname(host, sizeof(host)) != 0)
+        strcpy(host, "unknown");
+    host[sizeof(host) - 1] = '\0';
+
+    if (fmt == OUTPUT_JSON) {
+        char date[64];
+        time_t now = time(NULL);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+        fputs("{\"type\":\"meta\",\"version\":", out);
+        json_str(meta->version);
+        fputs(",\"date\":", out);
+        json_str(date);
+        fputs(",\"host\":", out);
+        json_str(host);
+        fputs(",\"compiler\":", out);
+        json_str(meta->compiler);
+        fputs(",\"backend\":", out);
+        json_str(meta->backend);
+        fputs(",\"device\":", out);
+        json_str(meta->device);
+        fputs(",\"simd\":", out);
+        json_str(meta->simd);
+        fprintf(out, ",\"mpi_ranks\":%d,\"papi_events\":[", meta->mpi_ranks);
+        for (int e = 0; e < meta->npapi; e++) {
+            if (e)
+                fputc(',', out);
+            json_str(meta->papi_events[e]);
+        }
+        fputs("]}\n", out);
+    } else {
+        fputs("host,backend,device,config,name,kernel,pattern_len,delta,count,wrap,omp_threads,elem,run,time_s,bytes,bw_mbs", out);
+        for (int e = 0; e < meta->npapi; e++) {
+            fputc(',', out);
+            csv_str(meta->papi_events[e]);
+        }
+        for (int d = 0; d < SP_ENERGY_DOMAINS; d++) {
+            if (sp_energy_available((enum sp_energy_domain)d)) {
+                fputc(',', out);
+                csv_str(sp_energy_name((enum sp_energy_domain)d));
+            }
+        }
+        fputc('\n', out);
+    }
+    fflush(out);
+}
+
+// The config, with the keys of the JSON inputs, from "kernel" on. The
+// baseline of --baseline is matched on these bytes.
+static void json_config(const struct run_config *rc)
+{
+    char elem[32];
+    elem_name(rc, elem, sizeof(elem));
+
+    fputs("\"kernel\":", out);
+    json_str(sp_config_kernel_name(rc));
+
+    if (rc->type == TRACE) {
+        fputs(",\"pattern-file\":", out);
+        json_str(rc->pattern_file);
+        if (rc->graph) {
+            fputs(",\"graph\":", out);
+            json_str(sp_graph_algo_name((enum sp_graph_algo)rc->graph));
+        }
+    } else {
+        json_idx_array("pattern", rc->pattern, rc->pattern_len);
+    }
+    if (rc->pattern_gather_len)
+        json_idx_array("pattern-gather", rc->pattern_gather, rc->pattern_gather_len);
+    if (rc->pattern_scatter_len)
+        json_idx_array("pattern-scatter", rc->pattern_scatter, rc->pattern_scatter_len);
+    if (rc->deltas_len > 1) {
+        fputs(",\"delta\":[", out);
+        for (size_t j = 0; j < rc->deltas_len; j++)
+            fprintf(out, j ? ",%zu" : "%zu", rc->deltas[j]);
+        fputc(']', out);
+    } else {
+        fprintf(out, ",\"delta\":%zd", rc->delta);
+    }
+    if (rc->kernel == GS)
+        fprintf(out, ",\"delta-gather\":%zd,\"delta-scatter\":%zd", rc->delta_gather, rc->delta_scatter);
+    fprintf(out, ",\"count\":%zu,\"wrap\":%zu,\"omp-threads\":%zu,\"op\":\"%s\",\"store\":\"%s\",\"elem\":\"%s\",\"index-bits\":%d",
+            rc->generic_len, rc->wrap, rc->omp_threads, op_name(rc->op),
+            rc->store == STORE_NT ? "nt" : "plain", elem, rc->index_bits ? rc->index_bits : 64);
+    if (rc->prefetch_distance > 0)
+        fprintf(out, ",\"prefetch-distance\":%zu,\"prefetch-hint\":\"%s\",\"prefetch-scope\":\"%s\"", rc->prefetch_distance,
+                rc->prefetch_hint == PREFETCH_NTA ? "nta" : "t0", rc->prefetch_line ? "line" : "pattern");
+    if (rc->random_seed > 0)
+        fprintf(out, ",\"random\":%zu", rc->random_seed);
+    if (rc->gs_tile > 0)
+        fprintf(out, ",\"gs-tile\":%zu", rc->gs_tile);
+    if (rc->cuda_async > 0)
+        fprintf(out, ",\"cuda-async\":%zu", rc->cuda_async);
+    if (rc->random_dist == RANDOM_ZIPF)
+        fprintf(out, ",\"random-dist\":\"zipf:%g\"", rc->random_param[0]);
+    else if (rc->random_dist == RANDOM_HOTSET)
+        fprintf(out, ",\"random-dist\":\"hotset:%g:%g\"", rc->random_param[0], rc->random_param[1]);
+    if (rc->ro_morton)
+        fprintf(out, ",\"morton\":%d,\"roblock\":%d", rc->ro_morton, rc->ro_block);
+    if (rc->ro_hilbert)
+        fprintf(out, ",\"hilbert\":%d,\"roblock\":%d", rc->ro_hilbert, rc->ro_block);
+    if (rc->stride_kernel != -1)
+        fprintf(out, ",\"stride\":%d", rc->stride_kernel);
+    if (rc->kernel == CHASE)
+        fprintf(out, ",\"chains\":%zu", rc->chains);
+}
+
+char *sp_output_config_json(const struct run_config *rc, size_t *len)
+{
+    char *text = NULL;
+    FILE *saved = out;
+    out = open_memstream(&text, len);
+    if (!out) {
+        out = saved;
+        return NULL;
+    }
+    json_config(rc);
+    fclose(out);
+    out = saved;
+    return text;
+}
+
+uint64_t sp_output_hash(const char *s, size_t n)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static void json_run(int idx, const struct run_config *rc, size_t bytes, const struct sp_traffic *tr, const struct sp_pattern_stats *ps,
+        const struct sp_reuse *ru)
+{
+    fprintf(out, "{\"type\":\"run\",\"config\":%d,\"name\":", idx);
+    json_str(rc->name);
+    fputc(',', out);
+    json_config(rc);
+
+    // The results
+    fprintf(out, ",\"bytes\":%zu,\"runs\":%zu,\"warmup_runs\":%zu,", bytes, rc->nruns, rc->warmup_runs);
+    fputs("\"time_s\":[", out);
+    for (size_t i = 0; i < rc->nruns; i++)
+        fprintf(out, i ? ",%.9g" : "%.9g", rc->time_ms[i] / 1000.);
+    fputc(']', out);
+    fputs(",\"bw_mbs\":[", out);
+    for (size_t i = 0; i < rc->nruns; i++)
+        fprintf(out, i ? ",%.9g" : "%.9g", rc->time_ms[i] > 0 ? bytes / rc->time_ms[i] / 1000. : 0);
+    fputc(']', out);
+    if (tr)
+        fprintf(out, ",\"idx_bytes\":%zu,\"line_bytes\":%zu", tr->index, tr->lines);
+    if (ps)
+        fprintf(out, ",\"analysis\":{\"lines\":%.9g,\"sectors\":%.9g,\"warp_lines\":%.9g,\"pages\":%.9g,\"reuse\":%.9g,\"efficiency\":%.9g}",
+                ps->lines, ps->sectors, ps->warp_lines, ps->pages, ps->reuse, ps->efficiency);
+    if (ru && ru->refs > 0) {
+        fprintf(out, ",\"reuse\":{\"refs\":%.9g,\"rate\":%.9g,\"l1_miss\":%.9g,\"l2_miss\":%.9g,\"llc_miss\":%.9g,\"tlb_miss\":%.9g,\"cold\":%.9g,\"hist\":[",
+                ru->refs, ru->rate, ru->miss[REUSE_L1], ru->miss[REUSE_L2], ru->miss[REUSE_LLC], ru->miss[REUSE_TLB], ru->cold);
+        for (int b = 0; b < SP_REUSE_BINS; b++)
+            fprintf(out, b ? ",%.9g" : "%.9g", ru->hist[b]);
+        fputs("]}", out);
+    }
+    if (out_meta.npapi > 0 && rc->papi_ctr) {
+        fputs(",\"papi\":{", out);
+        for (int e = 0; e < out_meta.npapi; e++) {
+            if (e)
+                fputc(',', out);
+            json_str(out_meta.papi_events[e]);
+            fputs(":[", out);
+            for (size_t i = 0; i < rc->nruns; i++)
+                fprintf(out, i ? ",%lld" : "%lld", rc->papi_ctr[i][e]);
+            fputc(']', out);
+        }
+        fputc('}', out);
+    }
+    if (rc->energy) {
+        fputs(",\"energy_j\":{", out);
+        int first = 1;
+        for (int d = 0; d < SP_ENERGY_DOMAINS; d++) {
+            if (!sp_energy_available((enum sp_energy_domain)d))
+                continue;
+            const char *name = sp_energy_name((enum sp_energy_domain)d);
+            fprintf(out, first ? "\"%.*s\":" : ",\"%.*s\":", (int)strcspn(name, "("), name);
+            fputc('[', out);
+            for (size_t i = 0; i < rc->nruns; i++)
+                fprintf(out, i ? ",%.9g" : "%.9g", rc->energy[i].joules[d]);
+            fputc(']', out);
+            first = 0;
+        }
+        fputc('}', out);
+    }
+    fputs("}\n", out);
+}
+
+static void csv_run(int idx, const struct run_config *rc, size_t bytes)
+{
+    char elem[32];
+    elem_name(rc, elem, sizeof(elem));
+    for (size_t i = 0; i < rc->nruns; i++) {
+        csv_str(host);
+        fputc(',', out);
+        csv_str(out_meta.backend);
+        fputc(',', out);
+        csv_str(out_meta.device);
+        fprintf(out, ",%d,", idx);
+        csv_str(rc->name);
+        fprintf(out, ",%s,%zu,%zd,%zu,%zu,%zu,%s,%zu,%.9g,%zu,%.9g", sp_config_kernel_name(rc),
+                rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->omp_threads, elem, i,
+                rc->time_ms[i] / 1000., bytes, rc->time_ms[i] > 0 ? bytes / rc->time_ms[i] / 1000. : 0);
+        for (int e = 0; e < out_meta.npapi && rc->papi_ctr; e++)
+            fprintf(out, ",%lld", rc->papi_ctr[i][e]);
+        for (int d = 0; d < SP_ENERGY_DOMAINS && rc->energy; d++)
+            if (sp_energy_available((enum sp_energy_domain)d))
+                fprintf(out, ",%.9g", rc->energy[i].joules[d]);
+        fputc('\n', out);
+    }
+}
+
+void sp_output_run(int idx, const struct run_config *rc, size_t bytes, const struct sp_traffic *tr, const struct sp_pattern_stats *ps,
+        const struct sp_reuse *ru)
+{
+    if (!out)
+        return;
+    if (out_fmt == OUTPUT_JSON)
+        json_run(idx, rc, bytes, tr, ps, ru);
+    else
+        csv_run(idx, rc, bytes);
+    fflush(out);
+}
+
+void sp_output_error(const char *what)
+{
+    if (!out || out_fmt != OUTPUT_JSON)
+        return;
+    fputs("{\"type\":\"error\",\"message\":", out);
+    json_str(what);
+    fputs("}\n", out);
+    fflush(out);
+}
+
+void sp_output_detach(void)
+{
+    if (out && out != stdout)
+        fclose(out);
+    else if (out)
+        fflush(out);
+    out = NULL;
+}
+
+void sp_output_close(void)
+{
+    sp_output_detach();
+    for (int e = 0; e < out_meta.npapi; e++)
+        free((char *)papi_events[e]);
+    out_meta.npapi = 0;
+    out = NULL;
+    out_fmt = OUTPUT_NONE;
+}
@@ -1,9 +1,20 @@
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
 #include <papi.h>
 #include <stdio.h>
 #include "papi_helper.h"
 
-const char* const papi_ctr_str[] = { "ctr0", "ctr1", "ctr2", "ctr3", 0 };
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+const char* const papi_ctr_str[] = {
+    "ctr0", "ctr1", "ctr2", "ctr3", "ctr4", "ctr5", "ctr6", "ctr7",
+    "ctr8", "ctr9", "ctr10", "ctr11", "ctr12", "ctr13", "ctr14", "ctr15",
+    "ctr16", "ctr17", "ctr18", "ctr19", "ctr20", "ctr21", "ctr22", "ctr23",
+    "ctr24", "ctr25", "ctr26", "ctr27", "ctr28", "ctr29", "ctr30", "ctr31", 0 };
 
 void profile_start(int EventSet, int lineno, char *file) {
     papi_err(PAPI_reset(EventSet), lineno, file);
@@ -21,3 +32,158 @@ void papi_err(int e, int lineno, char *file) {
     }
 }
 
+static unsigned long papi_thread_id(void) {
+    return (unsigned long)pthread_self();
+}
+
+// Create an EventSet of the n events in codes on the calling thread. If
+// they conflict and multiplex is not set yet, it is set and the EventSet
+// created again, multiplexed. Without multiplex a conflict is an error.
+static int create_set(const int *codes, int n, int *multiplex) {
+    int set = PAPI_NULL;
+    papi_err(PAPI_create_eventset(&set), __LINE__, __FILE__);
+    if (multiplex && *multiplex) {
+        papi_err(PAPI_assign_eventset_component(set, 0), __LINE__, __FILE__);
+        papi_err(PAPI_set_multiplex(set), __LINE__, __FILE__);
+    }
+    for (int i = 0; i < n; i++) {
+        int e = PAPI_add_event(set, codes[i]);
+        if (e == PAPI_ECNFLCT && multiplex && !*multiplex) {
+            papi_err(PAPI_cleanup_eventset(set), __LINE__, __FILE__);
+            papi_err(PAPI_destroy_eventset(&set), __LINE__, __FILE__);
+            *multiplex = 1;
+            return create_set(codes, n, multiplex);
+        }
+        papi_err(e, __LINE__, __FILE__);
+    }
+    return set;
+}
+
+void papi_sets_init(struct papi_sets *s, const int *codes, int n, int nthreads) {
+    int thread_codes[PAPI_MAX_COUNTERS];
+    int master_codes[PAPI_MAX_COUNTERS];
+
+    memset(s, 0, sizeof(*s));
+    s->nthreads = nthreads;
+    s->master_set = PAPI_NULL;
+    s->thread_set = (int *)malloc(sizeof(int) * nthreads);
+    s->vals = (long long *)calloc((size_t)nthreads * PAPI_MAX_COUNTERS, sizeof(long long));
+    for (int t = 0; t < nthreads; t++)
+        s->thread_set[t] = PAPI_NULL;
+
+    papi_err(PAPI_thread_init(papi_thread_id), __LINE__, __FILE__);
+    papi_err(PAPI_multiplex_init(), __LINE__, __FILE__);
+
+    for (int i = 0; i < n; i++) {
+        PAPI_event_info_t info;
+        papi_err(PAPI_get_event_info(codes[i], &info), __LINE__, __FILE__);
+        if (info.component_index == 0) {
+            s->thread_ev[s->nthread_ev] = i;
+            thread_codes[s->nthread_ev++] = codes[i];
+        } else {
+            s->master_fp[s->nmaster_ev] = info.data_type == PAPI_DATATYPE_FP64;
+            s->master_ev[s->nmaster_ev] = i;
+            master_codes[s->nmaster_ev++] = codes[i];
+        }
+    }
+
+    if (s->nmaster_ev > 0)
+        s->master_set = create_set(master_codes, s->nmaster_ev, NULL);
+    if (s->nthread_ev == 0)
+        return;
+
+    // The master thread finds out whether to multiplex, the others follow
+    s->thread_set[0] = create_set(thread_codes, s->nthread_ev, &s->multiplex);
+#ifdef USE_OPENMP
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int t = omp_get_thread_num();
+        if (t != 0) {
+            int multiplex = s->multiplex;
+            s->thread_set[t] = create_set(thread_codes, s->nthread_ev, &multiplex);
+        }
+    }
+#endif
+}
+
+void papi_sets_start(struct papi_sets *s, int nthreads) {
+    if (nthreads > s->nthreads)
+        nthreads = s->nthreads;
+    if (s->nmaster_ev > 0)
+        profile_start(s->master_set, __LINE__, __FILE__);
+    if (s->nthread_ev == 0)
+        return;
+#ifdef USE_OPENMP
+    #pragma omp parallel num_threads(nthreads)
+    {
+        profile_start(s->thread_set[omp_get_thread_num()], __LINE__, __FILE__);
+    }
+#else
+    (void)nthreads;
+    profile_start(s->thread_set[0], __LINE__, __FILE__);
+#endif
+}
+
+void papi_sets_stop(struct papi_sets *s, int nthreads, int n, long long *sum, long long *per_thread) {
+    if (nthreads > s->nthreads)
+        nthreads = s->nthreads;
+    if (s->nthread_ev > 0) {
+#ifdef USE_OPENMP
+        #pragma omp parallel num_threads(nthreads)
+        {
+            int t = omp_get_thread_num();
+            profile_stop(s->thread_set[t], &s->vals[t * PAPI_MAX_COUNTERS], __LINE__, __FILE__);
+        }
+#else
+        nthreads = 1;
+        profile_stop(s->thread_set[0], s->vals, __LINE__, __FILE__);
+#endif
+    }
+
+    memset(sum, 0, sizeof(long long) * n);
+    for (int t = 0; t < nthreads && s->nthread_ev > 0; t++) {
+        for (int j = 0; j < s->nthread_ev; j++) {
+            long long v = s->vals[t * PAPI_MAX_COUNTERS + j];
+            sum[s->thread_ev[j]] += v;
+            if (per_thread)
+                per_thread[t * n + s->thread_ev[j]] += v;
+        }
+    }
+
+    if (s->nmaster_ev > 0) {
+        long long vals[PAPI_MAX_COUNTERS];
+        profile_stop(s->master_set, vals, __LINE__, __FILE__);
+        for (int j = 0; j < s->nmaster_ev; j++) {
+            if (s->master_fp[j]) {
+                double d;
+                memcpy(&d, &vals[j], sizeof(d));
+                vals[j] = llround(d);
+            }
+            sum[s->master_ev[j]] = vals[j];
+            if (per_thread)
+                per_thread[s->master_ev[j]] += vals[j];
+        }
+    }
+}
+
+void papi_sets_destroy(struct papi_sets *s) {
+#ifdef USE_OPENMP
+    #pragma omp parallel num_threads(s->nthreads)
+#endif
+    {
+        int t = 0;
+#ifdef USE_OPENMP
+        t = omp_get_thread_num();
+#endif
+        if (t < s->nthreads && s->thread_set[t] != PAPI_NULL) {
+            PAPI_cleanup_eventset(s->thread_set[t]);
+            PAPI_destroy_eventset(&s->thread_set[t]);
+        }
+    }
+    if (s->master_set != PAPI_NULL) {
+        PAPI_cleanup_eventset(s->master_set);
+        PAPI_destroy_eventset(&s->master_set);
+    }
+    free(s->thread_set);
+    free(s->vals);
+}
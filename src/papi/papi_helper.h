@@ -1,10 +1,55 @@
 #ifndef PAPI_HELPER_H
 #define PAPI_HELPER_H
 
-#define PAPI_MAX_COUNTERS 4
+// Events are multiplexed when they do not fit the hardware counters
+#define PAPI_MAX_COUNTERS 32
 
 void profile_start(int EventSet, int lineno, char *file);
 void profile_stop(int EventSet, long long *val, int lineno, char *file);
 void papi_err(int e, int lineno, char* file);
 
+/** @brief The EventSets of the --papi events.
+ *  Events of the CPU component count the thread that started them, so
+ *  every OpenMP thread gets its own EventSet, created by that thread.
+ *  Events of other components (uncore, RAPL, ...) count a whole socket
+ *  and only get an EventSet on the master thread. If the CPU events do
+ *  not fit the counters at once, the thread EventSets are multiplexed.
+ *  Events that count as doubles, such as the percentages of the CUDA
+ *  component, are rounded to integers.
+ */
+struct papi_sets
+{
+    int nthreads;
+    int *thread_set;                    // one per thread, PAPI_NULL without CPU events
+    int master_set;                     // PAPI_NULL without other events
+    int nthread_ev;
+    int nmaster_ev;
+    int thread_ev[PAPI_MAX_COUNTERS];   // position in the --papi list
+    int master_ev[PAPI_MAX_COUNTERS];
+    int master_fp[PAPI_MAX_COUNTERS];   // counts as a double, as the CUDA component's .pct metrics
+    int multiplex;
+    long long *vals;                    // nthreads * PAPI_MAX_COUNTERS
+};
+
+/** @brief Initialize PAPI for threads and create the EventSets of
+ *  nthreads threads (1 without OpenMP) for the n events in codes
+ */
+void papi_sets_init(struct papi_sets *s, const int *codes, int n, int nthreads);
+
+/** @brief Start the counters of the first nthreads threads, from a
+ *  parallel region of that many threads: the kernel that follows must
+ *  run on the same team size so that each thread is counted by its own set
+ */
+void papi_sets_start(struct papi_sets *s, int nthreads);
+
+/** @brief Stop the counters of the first nthreads threads.
+ *  @param sum The count of every event over all threads, in --papi order
+ *  @param per_thread If not NULL, nthreads rows of n events the counts of
+ *                    each thread are added to. Events of the master set
+ *                    are added to the row of thread 0.
+ */
+void papi_sets_stop(struct papi_sets *s, int nthreads, int n, long long *sum, long long *per_thread);
+
+void papi_sets_destroy(struct papi_sets *s);
+
 #endif
@@ -9,8 +9,26 @@
 #include "parse-args.h"
 #include "backend-support-tests.h"
 #include "sp_alloc.h"
+#include "sp_arena.h"
+#include "trace-stream.h"
+#include "mpi-report.h"
+#include "measure.h"
+#include "config-bin.h"
+#include "chase.h"
+#include "sweep.h"
 #include "json.h"
 #include "pcg_basic.h"
+#include "output.h"
+#include "sgtime.h"
+#include "cache-flush.h"
+#include "baseline.h"
+#include "shard.h"
+#include "pin.h"
+#include "noise.h"
+#include "numa-util.h"
+#include "mtx.h"
+#include "graph.h"
+#include "dsa.h"
 #include "argtable3.h"
 
 #ifdef USE_CUDA
@@ -29,6 +47,14 @@
 #include "papi_helper.h"
 int papi_nevents;
 char papi_event_names[PAPI_MAX_COUNTERS][STRING_SIZE];
+// What --papi=gpu counts: DRAM bytes, the L2 hit rate, the sectors and
+// requests of global loads and stores, and the achieved occupancy
+static const char *papi_gpu_metrics[] = {
+    "dram__bytes_read.sum", "dram__bytes_write.sum", "lts__t_sector_hit_rate.pct",
+    "l1tex__t_sectors_pipe_lsu_mem_global_op_ld.sum", "l1tex__t_requests_pipe_lsu_mem_global_op_ld.sum",
+    "l1tex__t_sectors_pipe_lsu_mem_global_op_st.sum", "l1tex__t_requests_pipe_lsu_mem_global_op_st.sum",
+    "sm__warps_active.avg.pct_of_peak_sustained_active", NULL
+};
 #endif
 
 #define INTERACTIVE "INTERACTIVE"
@@ -41,14 +67,58 @@ char jsonfilename[STRING_SIZE];
 char op_string[STRING_SIZE];
 
 int cuda_dev = -1;
+int cuda_devs[SP_MAX_CUDA_DEVICES];
+int cuda_ndevs = 1;
+int cuda_streams = 1;
+int cuda_graph_flag = 0;
+int autotune_flag = 0;
+int compose_flag = 0;
+int inner_stream_flag = 0;
+double min_sample_ms = 0;
+char serve_addr[STRING_SIZE] = "";
+char baseline_file[STRING_SIZE] = "";
+double baseline_tolerance = SP_BASELINE_TOLERANCE;
+struct sp_noise_spec noise_spec = {NOISE_NONE, 0, 0};
+double rate_mgs = 0;
+struct sp_tier source_tier = {0};
+struct sp_tier target_tier = {0};
+enum sp_cache cache_mode = CACHE_WARM;
+enum sg_gpu_mem gpu_mem = GPU_MEM_DEVICE;
+enum sg_gpu_hint gpu_hint = GPU_HINT_NONE;
 int validate_flag = 0;
 int quiet_flag = 0;
 int aggregate_flag = 1;
 int compress_flag = 0;
+size_t compress_page = 4096;
+int resize_flag = 0;
+int sparse_source_flag = 0;
+int traffic_flag = 0;
+int analyze_flag = 0;
+int analyze_reuse_flag = 0;
+int mpi_partition_flag = 0;
+double straggler_threshold = SP_STRAGGLER_THRESHOLD;
+char write_config_file[STRING_SIZE] = "";
 int stride_kernel = -1;
 int atomic_flag = 0;
 
 enum sg_backend backend = INVALID_BACKEND;
+enum sg_simd simd_isa = SIMD_SCALAR;
+enum sg_numa numa_mode = NUMA_DEFAULT;
+enum sg_rma rma_mode = RMA_NONE;
+size_t rma_batch = 64;
+char dsa_wq[STRING_SIZE];
+size_t dsa_submitters = 1;
+enum sg_schedule sched_kind = SCHED_STATIC;
+size_t sched_chunk = 0;
+int busy_flag = 0;
+int corun_flag = 0;
+int energy_flag = 0;
+enum sp_output_format output_format = OUTPUT_NONE;
+char output_file[STRING_SIZE] = "";
+int shard_index = 0;
+int shard_count = 0;
+char resume_file[STRING_SIZE] = "";
+struct sp_thread_sweep thread_sweep;
 
 // These should actually stay global
 int verbose;
@@ -60,12 +130,18 @@ void parse_p(char*, struct run_config *, int mode);
 ssize_t setincludes(size_t key, size_t* set, size_t set_len);
 void xkp_pattern(ssize_t *pat, ptrdiff_t dim);
 void parse_backend(int argc, char **argv);
+static void parse_pattern(char*, struct run_config *, int mode, int strong);
+static void scale_pattern(ssize_t **pattern, spSize_t *pattern_len, int strong);
+static void partition_configs(struct run_config *rc, int nrc);
+static int parse_json_native(json_value *value, struct run_config *rc);
+static void set_kernel_name(char *dest, struct run_config *rc);
 
 void** argtable;
-unsigned int number_of_arguments = 38;
-struct arg_lit *verb, *help, *interactive, *validate, *aggregate, *compress;
-struct arg_str *backend_arg, *cl_platform, *cl_device, *pattern, *pattern_gather, *pattern_scatter, *kernelName, *delta, *delta_gather, *delta_scatter, *name, *papi, *op;
-struct arg_int *atomic, *strong_scale, *boundary, *pattern_size, *count, *wrap, *runs, *omp_threads, *vector_len, *local_work_size, *shared_memory, *morton, *hilbert, *roblock, *stride, *random_arg, *no_print_header;
+unsigned int number_of_arguments = 90;
+struct arg_lit *verb, *help, *interactive, *validate, *aggregate, *resize_buffers, *traffic, *cuda_graph, *mpi_partition, *busy_times, *co_run, *energy, *autotune, *compose, *inner_stream, *analyze, *analyze_reuse, *sparse_source;
+struct arg_str *compress, *simd_arg, *numa_arg, *alloc_arg, *rma_arg, *schedule_arg, *target_ci, *write_config, *devices, *backend_arg, *cl_platform, *cl_device, *pattern, *pattern_gather, *pattern_scatter, *kernelName, *delta, *delta_gather, *delta_scatter, *name, *papi, *op, *store_arg, *prefetch_hint_arg, *prefetch_scope_arg, *elem_arg, *output_arg, *gpu_mem_arg, *timer_arg, *cache_arg, *serve_arg, *baseline_arg, *noise_arg, *tier_arg, *tier_target_arg, *random_dist_arg, *dsa_arg, *shard_arg, *resume_arg, *thread_sweep_arg;
+struct arg_int *atomic, *strong_scale, *boundary, *pattern_size, *count, *wrap, *runs, *omp_threads, *vector_len, *local_work_size, *shared_memory, *morton, *hilbert, *roblock, *stride, *random_arg, *no_print_header, *streams, *rma_batch_arg, *max_runs, *chains_arg, *prefetch_dist_arg, *index_bits_arg, *gs_tile_arg, *cuda_async_arg;
+struct arg_dbl *straggler, *time_budget, *min_sample, *baseline_tol, *rate_arg;
 struct arg_file *kernelFile;
 struct arg_end *end;
 
@@ -79,16 +155,16 @@ void initialize_argtable()
     malloc_argtable[1] = verb            = arg_litn(NULL, "verbose", 0, 1, "Print info about default arguments that you have not overridden.");
     malloc_argtable[2] = no_print_header = arg_intn("q", "no-print-header", "<n>", 0, 1, "Do not print header information.");
     malloc_argtable[3] = interactive     = arg_litn("i", "interactive", 0, 1, "Pick the platform and the device interactively.");
-    malloc_argtable[4] = validate        = arg_litn(NULL, "validate", 0, 1, "Perform extra validation checks to ensure data validity");
+    malloc_argtable[4] = validate        = arg_litn(NULL, "validate", 0, 1, "Check the result of each config against a checksum computed from the source and the pattern.");
     malloc_argtable[5] = aggregate       = arg_litn("a", "aggregate", 0, 1, "Report a minimum time for all runs of a given configuration for 2 or more runs. [Default 1] (Do not use with PAPI)");
-    malloc_argtable[6] = compress        = arg_litn("c", "compress", 0, 1, "TODO");
+    malloc_argtable[6] = compress        = arg_strn("c", "compress", "<page>", 0, 1, "Renumber the pages the patterns touch so that no untouched page lies between them, in pages of 4K, 2M or 1G bytes. [Default: 4K]");
     malloc_argtable[7] = atomic          = arg_intn(NULL, "atomic-writes", "<n>", 0, 1, "Enable atomic scatters (CUDA backend only)");
     // Benchmark Configuration
     malloc_argtable[8] = pattern         = arg_strn("p", "pattern", "<pattern>", 0, 1, "Specify either a built-in pattern (i.e. UNIFORM), a custom pattern (i.e. 1,2,3,4), or a path to a json file with a run-configuration.");
     malloc_argtable[9] = pattern_gather  = arg_strn("g", "pattern-gather", "<pattern>", 0, 1, "Valid wtih [kernel-name: GS, MultiGather]. Specify either a built-in pattern (i.e. UNIFORM), a custom pattern (i.e. 1,2,3,4), or a path to a json file with a run-configuration."); 
     malloc_argtable[10] = pattern_scatter = arg_strn("h", "pattern-scatter", "<pattern>", 0, 1, "Valid with [kernel-name: GS, MultiScatter]. Specify either a built-in pattern (i.e. UNIFORM), a custom pattern (i.e. 1,2,3,4), or a path to a json file with a run-configuration.");
-    malloc_argtable[11] = kernelName      = arg_strn("k", "kernel-name", "<kernel>", 0, 1, "Specify the kernel you want to run. [Default: Gather, Options: Gather, Scatter, GS, MultiGather, MultiScatter]");
-    malloc_argtable[12] = op              = arg_strn("o", "op", "<s>", 0, 1, "TODO");
+    malloc_argtable[11] = kernelName      = arg_strn("k", "kernel-name", "<kernel>", 0, 1, "Specify the kernel you want to run. [Default: Gather, Options: Gather, Scatter, GS, MultiGather, MultiScatter, Chase, Pack, Unpack, Transpose]");
+    malloc_argtable[12] = op              = arg_strn("o", "op", "<s>", 0, 1, "Scatter operation. [Default: COPY, Options: COPY, ACCUM (+=), ATOMIC (omp atomic +=), CONFLICT (+= with AVX-512CD conflict detection)]");
     malloc_argtable[13] = delta           = arg_strn("d", "delta", "<delta[,delta,...]>", 0, 1, "Specify one or more deltas. [Default: 8]");
     malloc_argtable[14] = delta_gather    = arg_strn("x", "delta-gather", "<delta[,delta,...]>", 0, 1, "Specify one or more deltas. [Default: 8]");
     malloc_argtable[15] = delta_scatter   = arg_strn("y", "delta-scatter", "<delta[,delta,...]>", 0, 1, "Specify one or more deltas. [Default: 8]");
@@ -103,22 +179,76 @@ void initialize_argtable()
     malloc_argtable[24] = local_work_size = arg_intn("z", "local-work-size", "<n>", 0, 1, "Numer of Gathers or Scatters performed by each thread on a GPU.");
     malloc_argtable[25] = shared_memory   = arg_intn("m", "shared-memory", "<n>", 0, 1, "Amount of dummy shared memory to allocate on GPUs (used for occupancy control).");
     malloc_argtable[26] = name            = arg_strn("n", "name", "<name>", 0, 1, "Specify and name this configuration in the output.");
-    malloc_argtable[27] = random_arg      = arg_intn("s", "random", "<n>", 0, 1, "Sets the seed, or uses a random one if no seed is specified.");
-    malloc_argtable[28] = backend_arg     = arg_strn("b", "backend", "<backend>", 0, 1, "Specify a backend: OpenCL, OpenMP, CUDA, or Serial.");
+    malloc_argtable[27] = random_arg      = arg_intn("s", "random", "<n>", 0, 1, "Sets the seed, or uses a random one if no seed is specified. The i-th Gather or Scatter goes to a random offset drawn from (seed, i), the same for any thread count.");
+    malloc_argtable[28] = backend_arg     = arg_strn("b", "backend", "<backend>", 0, 1, "Specify a backend: OpenCL, OpenMP, CUDA, HIP, or Serial.");
     malloc_argtable[29] = cl_platform     = arg_strn(NULL, "cl-platform", "<platform>", 0, 1, "Specify platform if using OpenCL (case-insensitive, fuzzy matching).");
     malloc_argtable[30] = cl_device       = arg_strn(NULL, "cl-device", "<device>", 0, 1, "Specify device if using OpenCL (case-insensitive, fuzzy matching).");
     malloc_argtable[31] = kernelFile      = arg_filen("f", "kernel-file", "<FILE>", 0, 1, "Specify the location of an OpenCL kernel file.");    
     // Other Configurations
-    malloc_argtable[32] = morton          = arg_intn(NULL, "morton", "<n>", 0, 1, "TODO");
-    malloc_argtable[33] = hilbert         = arg_intn(NULL, "hilbert", "<n>", 0, 1, "TODO");
-    malloc_argtable[34] = roblock         = arg_intn(NULL, "roblock", "<n>", 0, 1, "TODO");
+    malloc_argtable[32] = morton          = arg_intn(NULL, "morton", "<n>", 0, 1, "Visit the Gathers or Scatters in Z-order over a grid of -l points with n = 1, 2 or 3 dimensions (OpenMP, Serial and CUDA backends).");
+    malloc_argtable[33] = hilbert         = arg_intn(NULL, "hilbert", "<n>", 0, 1, "Visit the Gathers or Scatters in Hilbert order over a grid of -l points with n = 1, 2 or 3 dimensions (OpenMP, Serial and CUDA backends).");
+    malloc_argtable[34] = roblock         = arg_intn(NULL, "roblock", "<n>", 0, 1, "Side of the blocks that --morton or --hilbert order, each visited row by row. [Default: 1]");
     malloc_argtable[35] = stride          = arg_intn(NULL, "stride", "<n>", 0, 1, "TODO");
-    malloc_argtable[36] = papi            = arg_strn(NULL, "papi", "<s>", 0, 1, "TODO");
-    malloc_argtable[37] = end             = arg_end(20);
+    malloc_argtable[36] = papi            = arg_strn(NULL, "papi", "<s>", 0, 1, "Comma-separated PAPI events, counted on every OpenMP thread and multiplexed if they do not fit the counters, or around each CUDA launch (PAPI builds only). gpu stands for the CUDA component metrics of DRAM bytes, L2 hit rate, sectors per request and occupancy. [Up to 32 events]");
+    malloc_argtable[37] = simd_arg        = arg_strn(NULL, "simd", "<isa>", 0, 1, "Use hand-written vector kernels for Gather and Scatter (OpenMP backend). [Default: scalar, Options: auto, scalar, avx2, avx512, sve]");
+    malloc_argtable[38] = numa_arg        = arg_strn(NULL, "numa", "<mode>", 0, 1, "Page placement of the data buffers. [Default: none, Options: firsttouch, interleave, replicate]");
+    malloc_argtable[39] = alloc_arg       = arg_strn(NULL, "alloc", "<pool>", 0, 1, "Allocator for the data buffers. [Default: default, Options: thp, hugetlb-2m, hugetlb-1g, libnuma, memkind]");
+    malloc_argtable[40] = resize_buffers  = arg_litn(NULL, "resize-buffers", 0, 1, "Size the data buffers for each config instead of once for the largest one (OpenMP and Serial backends).");
+    malloc_argtable[41] = write_config    = arg_strn(NULL, "write-config", "<file>", 0, 1, "Write the parsed run-configs to a binary config file (load it with -pFILE=<file>) and exit.");
+    malloc_argtable[42] = traffic         = arg_litn(NULL, "traffic", 0, 1, "Also report index bytes and the estimated cache-line bytes (and DRAM bytes from PAPI CAS_COUNT events) of each config.");
+    malloc_argtable[43] = devices         = arg_strn(NULL, "devices", "<d[,d,...]>", 0, 1, "CUDA devices to split the Gathers or Scatters of each config across (CUDA backend only). [Default: the --cl-device match, or 0]");
+    malloc_argtable[44] = streams         = arg_intn(NULL, "streams", "<n>", 0, 1, "Number of CUDA streams per device (CUDA backend only). [Default: 1]");
+    malloc_argtable[45] = cuda_graph      = arg_litn(NULL, "cuda-graph", 0, 1, "Capture each Gather or Scatter config into a CUDA Graph once and replay it every run (CUDA backend only).");
+    malloc_argtable[46] = mpi_partition   = arg_litn(NULL, "mpi-partition", 0, 1, "Split the Gathers or Scatters of each config (-l) across the MPI ranks, for strong scaling (MPI builds only).");
+    malloc_argtable[47] = straggler       = arg_dbln(NULL, "straggler", "<x>", 0, 1, "Report MPI ranks slower than x times the median rank as stragglers. [Default: 1.2]");
+    malloc_argtable[48] = rma_arg         = arg_strn(NULL, "rma", "<mode>", 0, 1, "Gather from or Scatter to the source buffer of other MPI ranks through an MPI window (MPI builds only). [Options: element, gather, aggregate]");
+    malloc_argtable[49] = rma_batch_arg   = arg_intn(NULL, "rma-batch", "<n>", 0, 1, "Gathers or Scatters per destination rank between flushes of the window, aggregated into one MPI_Get or MPI_Put with --rma=aggregate. [Default: 64]");
+    malloc_argtable[50] = schedule_arg    = arg_strn(NULL, "schedule", "<kind>", 0, 1, "How the Gathers or Scatters of a config are split across the OpenMP threads. [Default: static, Options: dynamic[:<chunk>], guided[:<chunk>], steal[:<chunk>]]");
+    malloc_argtable[51] = busy_times      = arg_litn(NULL, "busy-times", 0, 1, "Report the busy and barrier wait time, CPU, NUMA node and bandwidth of each OpenMP thread, to tell load imbalance apart from bandwidth limits.");
+    malloc_argtable[52] = target_ci       = arg_strn(NULL, "target-ci", "<x%>", 0, 1, "Repeat each config until its times are stable, then until the 95% confidence interval of its bandwidth is within x% (replaces -R).");
+    malloc_argtable[53] = time_budget     = arg_dbln(NULL, "time-budget", "<s>", 0, 1, "Seconds each config may run for with --target-ci. [Default: 10]");
+    malloc_argtable[54] = max_runs        = arg_intn(NULL, "max-runs", "<n>", 0, 1, "Most timed runs of each config with --target-ci. [Default: 1000]");
+    malloc_argtable[55] = chains_arg      = arg_intn(NULL, "chains", "<n>", 0, 1, "Number of interleaved dependent chains each thread follows (CHASE kernel only). [Default: 1]");
+    malloc_argtable[56] = co_run          = arg_litn(NULL, "co-run", 0, 1, "After the usual runs, run all configs at the same time, each on its own team of -t threads, and report their bandwidth under contention next to their standalone bandwidth (OpenMP backend only).");
+    malloc_argtable[57] = store_arg       = arg_strn(NULL, "store", "<s>", 0, 1, "How Gather, Scatter and GS write (OpenMP backend only). nt uses non-temporal stores for the dense side of Gathers and the sparse side of Scatters. [Default: plain, Options: plain, nt]");
+    malloc_argtable[58] = prefetch_dist_arg  = arg_intn(NULL, "prefetch-distance", "<n>", 0, 1, "Software prefetch the sparse side of Gather or Scatter i + n while running Gather or Scatter i (OpenMP, Serial and CUDA backends only). [Default: 0, no prefetch]");
+    malloc_argtable[59] = prefetch_hint_arg  = arg_strn(NULL, "prefetch-hint", "<s>", 0, 1, "Cache hint of the software prefetches. The CUDA backend only supports t0, which prefetches into L2. [Default: t0, Options: t0, nta]");
+    malloc_argtable[60] = prefetch_scope_arg = arg_strn(NULL, "prefetch-scope", "<s>", 0, 1, "Prefetch every cache line of a Gather or Scatter, or only its first line. [Default: pattern, Options: pattern, line]");
+    malloc_argtable[61] = index_bits_arg     = arg_intn(NULL, "index-bits", "<n>", 0, 1, "Width of the pattern indices read by the Gather, Scatter, MultiGather and MultiScatter kernels (OpenMP backend only). [Default: 64, Options: 16, 32, 64]");
+    malloc_argtable[62] = elem_arg           = arg_strn(NULL, "elem", "<s>", 0, 1, "Element type moved by Gather and Scatter (OpenMP, Serial and CUDA backends). bytes:N is an N-byte struct, c64 a complex of two f64. [Default: f64, Options: f32, f64, i32, i64, c64, bytes:N]");
+    malloc_argtable[63] = energy          = arg_litn(NULL, "energy", 0, 1, "Report the joules of each run from RAPL (CPU package and DRAM) and NVML (GPU), and GB/s per watt.");
+    malloc_argtable[64] = output_arg      = arg_strn(NULL, "output", "<fmt:file>", 0, 1, "Stream one record per config to file as it finishes: the config, every timed run, PAPI counters, energy and bandwidth. [Options: json:<file> (JSON Lines), csv:<file> (one row per run)]");
+    malloc_argtable[65] = gpu_mem_arg     = arg_strn(NULL, "gpu-mem", "<mode[:hint]>", 0, 1, "Memory the CUDA backend Gathers from and Scatters to. Hints apply to managed and system memory. [Default: device, Options: device, managed, pinned-host, system; Hints: prefetch, readmostly, host]");
+    malloc_argtable[66] = autotune        = arg_litn(NULL, "autotune", 0, 1, "Sweep threads per block, work per thread and dummy shared memory for each Gather or Scatter config, cache the fastest launch and report it next to the default one (CUDA backend only).");
+    malloc_argtable[67] = compose         = arg_litn(NULL, "compose", 0, 1, "Also run each MultiGather and MultiScatter config with its two patterns composed into one, and report it next to the nested kernel (OpenMP backend only).");
+    malloc_argtable[68] = inner_stream    = arg_litn(NULL, "inner-stream", 0, 1, "Give each MultiGather and MultiScatter a fresh inner pattern, streamed from memory, instead of reusing one (OpenMP backend only).");
+    malloc_argtable[69] = min_sample      = arg_dbln(NULL, "min-sample", "<ms>", 0, 1, "Repeat the kernel inside each timed run until the run lasts at least ms, and report the time of one repetition (OpenMP and Serial backends only).");
+    malloc_argtable[70] = timer_arg       = arg_strn(NULL, "timer", "<s>", 0, 1, "Clock of the timed runs. tsc reads rdtscp on x86-64 with an invariant TSC, or cntvct_el0 on AArch64. [Default: clock, Options: clock, tsc]");
+    malloc_argtable[71] = cache_arg       = arg_strn(NULL, "cache", "<s>", 0, 1, "State of the caches before each timed run. cold streams through a buffer twice the size of the caches, which also replaces the TLB entries, flush flushes the lines of the source and target buffers (OpenMP and Serial backends only). [Default: warm, Options: warm, cold, flush]");
+    malloc_argtable[72] = serve_arg       = arg_strn(NULL, "serve", "<s>", 0, 1, "Allocate the buffers for the configs given once, then read json configs line by line and write a JSON Lines record for each as it finishes (OpenMP and Serial backends only). [Options: stdin, unix:<path>]");
+    malloc_argtable[73] = baseline_arg    = arg_strn(NULL, "baseline", "<file>", 0, 1, "Compare the mean bandwidth of each config with its record in an earlier --output=json file, matched on the config or else its name, and exit with status 2 if one is significantly slower by more than the tolerance.");
+    malloc_argtable[74] = baseline_tol    = arg_dbln(NULL, "baseline-tolerance", "<x%>", 0, 1, "Slowdown against --baseline that fails the run, if it is outside the 95% confidence intervals. [Default: 5]");
+    malloc_argtable[75] = noise_arg       = arg_strn(NULL, "noise", "<k:t[:GB/s]>", 0, 1, "Run a STREAM kernel on t threads pinned to the last CPUs while each config runs, throttled to GB/s in total, and report the bandwidth it reached (OpenMP and Serial backends only). [Options: stream (triad), copy, nt (non-temporal writes)]");
+    malloc_argtable[76] = rate_arg        = arg_dbln(NULL, "rate", "<M/s>", 0, 1, "Issue the Gathers of each thread at this rate, in millions per second, spinning on the tick counter between them, and report the percentiles of the time each Gather took (OpenMP backend and Gather kernel only).");
+    malloc_argtable[77] = tier_arg        = arg_strn(NULL, "tier", "<n:w,...>", 0, 1, "Move the pages of the source to NUMA nodes n in proportion to weights w, page by page, and report the bandwidth of each node (OpenMP and Serial backends only). [Options: interleave, or e.g. 0:70,2:30]");
+    malloc_argtable[78] = tier_target_arg = arg_strn(NULL, "tier-target", "<n:w,...>", 0, 1, "Move the pages of every target to NUMA nodes n in proportion to weights w, as --tier does for the source.");
+    malloc_argtable[79] = random_dist_arg = arg_strn(NULL, "random-dist", "<dist>", 0, 1, "Distribution of the offsets --random draws, over -l bases scattered by the seed (OpenMP, Serial and CUDA backends, Gather and Scatter only). [Default: uniform, Options: uniform, zipf:<s>, hotset:<frac>:<prob>]");
+    malloc_argtable[80] = gs_tile_arg     = arg_intn(NULL, "gs-tile", "<bytes>", 0, 1, "Run GS through a staging tile of this many bytes per thread, gathering the next tile while scattering the current one. Gather and scatter patterns of different lengths always do (OpenMP and Serial backends only). [Default: a quarter of the L1 data cache]");
+    malloc_argtable[81] = dsa_arg         = arg_strn(NULL, "dsa", "<wq[:t]>", 0, 1, "Offload the Gathers and Scatters to an Intel DSA work queue, e.g. /dev/dsa/wq0.0, as batches of memory moves built before the runs and submitted from t threads (DSA builds and OpenMP backend only). [Default threads: 1]");
+    malloc_argtable[82] = cuda_async_arg  = arg_intn(NULL, "cuda-async", "<wpt>", 0, 1, "Stage the loads of each block through double-buffered shared memory with asynchronous copies, over wpt rounds of Gathers or Scatters per block (CUDA backend, Gather and Scatter only). [Default: 0, off]");
+    malloc_argtable[83] = analyze         = arg_litn(NULL, "analyze", 0, 1, "Also report how each pattern maps onto memory: distinct cache lines, 32-byte sectors and pages per Gather or Scatter, 128-byte lines per GPU warp, the lines shared by consecutive Gathers, and the useful fraction of the line bytes.");
+    malloc_argtable[84] = shard_arg       = arg_strn(NULL, "shard", "<i/n>", 0, 1, "Run only share i of n of the configs, from 0, dealt out largest first by pattern length times count so that every share has about the same work.");
+    malloc_argtable[85] = resume_arg      = arg_strn(NULL, "resume", "<file>", 0, 1, "Skip the configs that already have a run record in this --output=json file. If it is also the --output file, the new records are appended to it.");
+    malloc_argtable[86] = thread_sweep_arg = arg_strn(NULL, "thread-sweep", "<n,...[:p]>", 0, 1, "Also run each config with each of these numbers of threads, pinned to the CPUs in the order of policy p, and report the bandwidth of each and the knee, the fewest threads within 10% of the best (OpenMP backend only). max is every CPU, .. continues the progression, e.g. 1,2,..,max. [Default policy: compact, Options: compact (socket by socket), spread (a core of each socket in turn)]");
+    malloc_argtable[87] = analyze_reuse   = arg_litn(NULL, "analyze-reuse", 0, 1, "Also profile the reuse distances of the addresses each config touches, with sampled stack distances, and report their histogram and the miss ratio it predicts for the L1, L2, LLC and TLB of this machine.");
+    malloc_argtable[88] = sparse_source   = arg_litn(NULL, "sparse-source", 0, 1, "Reserve the address space of the source without backing it, and back only the pages each config touches, so that patterns spanning far more than memory run without wrapping their indices (OpenMP and Serial backends).");
+    malloc_argtable[89] = end             = arg_end(20);
 
     // Random has an option to provide an argument. Default its value to -1.
     random_arg->hdr.flag |= ARG_HASOPTVALUE;
     random_arg->ival[0] = -1;
+    compress->hdr.flag |= ARG_HASOPTVALUE;
+    compress->sval[0] = "4K";
 
     // Set default values
     kernelName->sval[0] = "Gather\0";
@@ -149,6 +279,16 @@ void copy_str_ignore_leading_space(char* dest, const char* source)
         safestrcopy(dest, source);
 }
 
+// Upper bound on the number of entries in a delim separated list
+static size_t count_tokens(const char *str, char delim)
+{
+    size_t n = 1;
+    for (; *str; str++)
+        if (*str == delim)
+            n++;
+    return n;
+}
+
 int get_num_configs(json_value* value)
 {
     if (value->type != json_array) {
@@ -160,7 +300,8 @@ int get_num_configs(json_value* value)
 
 void parse_json_kernel(json_object_entry cur, char** argv, int i)
 {
-    if (!strcasecmp(cur.value->u.string.ptr, "SCATTER") || !strcasecmp(cur.value->u.string.ptr, "GATHER") || !strcasecmp(cur.value->u.string.ptr, "GS") || !strcasecmp(cur.value->u.string.ptr, "MULTISCATTER") || !strcasecmp(cur.value->u.string.ptr, "MULTIGATHER"))
+    if (!strcasecmp(cur.value->u.string.ptr, "SCATTER") || !strcasecmp(cur.value->u.string.ptr, "GATHER") || !strcasecmp(cur.value->u.string.ptr, "GS") || !strcasecmp(cur.value->u.string.ptr, "MULTISCATTER") || !strcasecmp(cur.value->u.string.ptr, "MULTIGATHER") || !strcasecmp(cur.value->u.string.ptr, "CHASE") ||
+        !strcasecmp(cur.value->u.string.ptr, "PACK") || !strcasecmp(cur.value->u.string.ptr, "UNPACK") || !strcasecmp(cur.value->u.string.ptr, "TRANSPOSE"))
     {
         error("Ambiguous Kernel Type: Assuming kernel-name option.", WARN);
         snprintf(argv[i], STRING_SIZE, "--kernel-name=%s", cur.value->u.string.ptr);
@@ -201,10 +342,13 @@ void parse_json_array(json_object_entry cur, char** argv, int i, int allocated_s
     }
 }
 
+// Holds the argv strings built for one json config, reset after every config
+static struct sp_arena json_arena;
+
 struct run_config *parse_json_config(json_value *value)
 {
 
-    struct run_config *rc = (struct run_config *)calloc(1,sizeof(struct run_config));
+    struct run_config *rc;
 
     if (!value)
         error ("parse_json_config passed NULL pointer", ERROR);
@@ -213,9 +357,9 @@ struct run_config *parse_json_config(json_value *value)
         error ("parse_json_config should only be passed json_objects", ERROR);
 
     int argc = value->u.object.length + 1;
-    char **argv = (char **)sp_malloc(sizeof(char*), argc, ALIGN_CACHE);
+    char **argv = (char **)sp_arena_alloc(&json_arena, sizeof(char*), argc, ALIGN_CACHE);
 
-    argv[0] = (char *)sp_malloc(1, STRING_SIZE, ALIGN_CACHE);
+    argv[0] = (char *)sp_arena_alloc(&json_arena, 1, STRING_SIZE, 1);
     
     for (int i = 1; i < argc; i++)
     {
@@ -223,7 +367,7 @@ struct run_config *parse_json_config(json_value *value)
 
         if (cur.value->type == json_string)
         {
-	    argv[i] = (char *)sp_malloc(1, STRING_SIZE, ALIGN_CACHE);
+            argv[i] = (char *)sp_arena_alloc(&json_arena, 1, STRING_SIZE, 1);
             if (!strcasecmp(cur.name, "kernel"))
             {
                 parse_json_kernel(cur, argv, i);
@@ -235,13 +379,13 @@ struct run_config *parse_json_config(json_value *value)
         }
         else if (cur.value->type == json_integer)
         {
-            argv[i] = (char *)sp_malloc(1, STRING_SIZE, ALIGN_CACHE);
+            argv[i] = (char *)sp_arena_alloc(&json_arena, 1, STRING_SIZE, 1);
             snprintf(argv[i], STRING_SIZE, "--%s=%zd", cur.name, cur.value->u.integer);
         }
         else if (cur.value->type == json_array)
         {
             int allocated_size = 10 * cur.value->u.array.length;
-            argv[i] = (char *)sp_malloc(sizeof(char), allocated_size, ALIGN_CACHE);
+            argv[i] = (char *)sp_arena_alloc(&json_arena, sizeof(char), allocated_size, 1);
             parse_json_array(cur, argv, i, allocated_size);
             //printf("Pattern Length: %d\n", cur.value->u.array.length);
         }
@@ -272,18 +416,140 @@ struct run_config *parse_json_config(json_value *value)
 
     rc = parse_runs(argc, argv);
 
-    for (int i = 0; i < argc - 1; i++)
-        free(argv[i]);
+    sp_arena_reset(&json_arena);
+
+    return rc;
+}
+
+int parse_json_text(char *text, size_t len, int *nrc, struct run_config **rc)
+{
+    json_value *value = json_parse((json_char*)text, len);
+
+    if (!value)
+        return -1;
+    if (value->type != json_array) {
+        json_value_free(value);
+        return -1;
+    }
+
+    // This is the number of specified runs in the json file.
+    *nrc = get_num_configs(value);
+
+    *rc = (struct run_config*)sp_calloc(sizeof(struct run_config), *nrc, ALIGN_CACHE);
 
-    free(argv);
 
+    // Configs that only use the common keys are filled in straight from
+    // the json tree, the rest still go through argtable one at a time
+    int *legacy = (int *)sp_calloc(sizeof(int), *nrc, ALIGN_CACHE);
+
+#ifdef USE_OPENMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < *nrc; i++)
+        legacy[i] = !parse_json_native(value->u.array.values[i], &rc[0][i]);
+
+    for (int i = 0; i < *nrc; i++){
+        if (!legacy[i])
+            continue;
+        struct run_config *rctemp = parse_json_config(value->u.array.values[i]);
+        rc[0][i] = *rctemp;
+        free(rctemp);
+    }
+
+    if (*nrc > 0 && !legacy[*nrc - 1])
+        set_kernel_name(kernel_name, &rc[0][*nrc - 1]);
+    free(legacy);
+
+    json_value_free(value);
+    sp_arena_destroy(&json_arena);
+    return 0;
+}
+
+// Index of the argument that holds the -p value
+static int find_pattern_arg(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "-p", 2) && strstr(argv[i], pattern->sval[0]))
+            return i;
+        if (!strncmp(argv[i], "--pattern=", 10) && !strcmp(argv[i] + 10, pattern->sval[0]))
+            return i;
+        if (!strcmp(argv[i], pattern->sval[0]) && (!strcmp(argv[i-1], "-p") || !strcmp(argv[i-1], "--pattern")))
+            return i;
+    }
+    error ("MTX: -p argument not found", ERROR);
+    return -1;
+}
+
+// MTX:file[:rowblock[:configs]], one config per recurring block of rows,
+// each parsed from argv with the -p, -d, -l and --name of its block
+static struct run_config *parse_mtx(int argc, char **argv, int parg, int *nrc)
+{
+    char file[STRING_SIZE];
+    size_t num[2] = {1, 0};
+    int nums = 0;
+    safestrcopy(file, pattern->sval[0] + 4);
+
+    // Up to two numbers at the end, the file name is what is left
+    for (char *c; nums < 2 && (c = strrchr(file, ':')) && c[1] && strspn(c + 1, "0123456789") == strlen(c + 1); nums++) {
+        num[1] = num[0];
+        num[0] = strtoull(c + 1, NULL, 10);
+        *c = '\0';
+    }
+    size_t rowblock = num[0];
+    int nconf = nums == 2 ? (int)num[1] : SP_MTX_CONFIGS;
+    if (!file[0])
+        error ("MTX: file not found", ERROR);
+    if (rowblock == 0 || nconf <= 0)
+        error ("MTX: rowblock and configs must be positive", ERROR);
+    if (delta->count > 0 || count->count > 0 || name->count > 0)
+        error ("MTX patterns take -d, -l and --name from the matrix", ERROR);
+
+    struct sp_csr csr;
+    struct sp_mtx_summary sum;
+    sp_mtx_read(file, &csr);
+    struct sp_mtx_config *mc = (struct sp_mtx_config *)calloc(nconf, sizeof(struct sp_mtx_config));
+    *nrc = sp_mtx_configs(&csr, rowblock, nconf, mc, &sum);
+    if (*nrc == 0)
+        error ("MTX: the matrix has no nonzeros", ERROR);
+    printf("Read %s: %zu x %zu, %zu nonzeros, %zu blocks of %zu row(s), %zu distinct (pattern, delta), %d configs cover %.1f%% of the nonzeros.\n",
+            file, csr.nrows, csr.ncols, csr.nnz, sum.blocks, rowblock, sum.distinct, *nrc, 100 * sum.covered);
+
+    // Configs are named after the matrix, without directory or extension
+    char *base = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+    char *ext = strrchr(base, '.');
+    if (ext && ext != base)
+        *ext = '\0';
+
+    struct run_config *rc = (struct run_config*)sp_calloc(sizeof(struct run_config), *nrc, ALIGN_CACHE);
+    for (int k = 0; k < *nrc; k++) {
+        char cname[STRING_SIZE];
+        snprintf(cname, STRING_SIZE, "%.200s:%d", base, k);
+        int cargc = argc;
+        char **cargv = sp_mtx_argv(&cargc, argv, parg, &mc[k], cname);
+        if (arg_parse(cargc, cargv, argtable) > 0)
+        {
+            arg_print_errors(stdout, end, "Spatter");
+            error ("Unable to parse the MTX config", ERROR);
+        }
+        struct run_config *rctemp = parse_runs(cargc, cargv);
+        rc[k] = *rctemp;
+        free(rctemp);
+        sp_mtx_argv_free(cargc, cargv);
+    }
+    sp_mtx_configs_free(mc, *nrc);
+    free(mc);
+    sp_csr_free(&csr);
     return rc;
 }
 
 void parse_args(int argc, char **argv, int *nrc, struct run_config **rc)
 {
     initialize_argtable();
-    int nerrors = arg_parse(argc, argv, argtable);
+
+    // Sweeps are parsed once per point; the first point sets the backend
+    size_t nsweep = sp_sweep_count(argc, argv);
+    char **sweep_argv = nsweep > 1 ? sp_sweep_argv(argc, argv, 0) : argv;
+    int nerrors = arg_parse(argc, sweep_argv, argtable);
 
     if (help->count > 0)
     {
@@ -305,10 +571,15 @@ void parse_args(int argc, char **argv, int *nrc, struct run_config **rc)
 
     // Parse command-line arguments to in case of specified json file.
     int json = 0;
+    int mtx_arg = -1;
 
     if (pattern->count > 0)
     {
-       if (strstr(pattern->sval[0], "FILE"))
+       if (!strncmp(pattern->sval[0], "MTX:", 4))
+       {
+           mtx_arg = find_pattern_arg(argc, argv);
+       }
+       else if (strstr(pattern->sval[0], "FILE"))
        {
            safestrcopy(jsonfilename, strchr(pattern->sval[0], '=') + 1);
            printf("Reading patterns from %s.\n", jsonfilename);
@@ -316,14 +587,22 @@ void parse_args(int argc, char **argv, int *nrc, struct run_config **rc)
        }
     }
 
-    if (json)
+    if (json && nsweep > 1)
+        error ("Sweeps can not be combined with -pFILE", ERROR);
+
+    if (mtx_arg >= 0 && nsweep > 1)
+        error ("Sweeps can not be combined with -pMTX", ERROR);
+
+    if (json && spb_is_binary(jsonfilename))
+    {
+        *nrc = spb_read(jsonfilename, rc);
+    }
+    else if (json)
     {
         FILE *fp;
         struct stat filestatus;
         int file_size;
         char *file_contents;
-        json_char *json;
-        json_value *value;
 
         if (stat(jsonfilename, &filestatus) != 0)
             error ("Json file not found", ERROR);
@@ -342,26 +621,32 @@ void parse_args(int argc, char **argv, int *nrc, struct run_config **rc)
         }
         fclose(fp);
 
-        json = (json_char*)file_contents;
-        value = json_parse(json, file_size);
-
-        if (!value)
+        if (parse_json_text(file_contents, file_size, nrc, rc))
             error ("Unable to parse Json file", ERROR);
-
-        // This is the number of specified runs in the json file.
-        *nrc = get_num_configs(value);
-
+        free(file_contents);
+    }
+    else if (mtx_arg >= 0)
+    {
+        *rc = parse_mtx(argc, argv, mtx_arg, nrc);
+    }
+    else if (nsweep > 1)
+    {
+        *nrc = (int)nsweep;
         *rc = (struct run_config*)sp_calloc(sizeof(struct run_config), *nrc, ALIGN_CACHE);
+        sp_sweep_free(argc, sweep_argv);
 
-
-        for (int i = 0; i < *nrc; i++){
-            struct run_config *rctemp = parse_json_config(value->u.array.values[i]);
-            rc[0][i] = *rctemp;
+        for (size_t k = 0; k < nsweep; k++) {
+            sweep_argv = sp_sweep_argv(argc, argv, k);
+            if (arg_parse(argc, sweep_argv, argtable) > 0)
+            {
+                arg_print_errors(stdout, end, "Spatter");
+                error ("Unable to parse sweep point", ERROR);
+            }
+            struct run_config *rctemp = parse_runs(argc, sweep_argv);
+            rc[0][k] = *rctemp;
             free(rctemp);
+            sp_sweep_free(argc, sweep_argv);
         }
-
-        json_value_free(value);
-        free(file_contents);
     }
     else
     {
@@ -370,18 +655,29 @@ void parse_args(int argc, char **argv, int *nrc, struct run_config **rc)
         *nrc = 1;
     }
 
-    free(argtable);
+    if (write_config_file[0])
+    {
+        spb_write(write_config_file, *rc, *nrc);
+        printf("Wrote %d run-configs to %s.\n", *nrc, write_config_file);
+        exit(0);
+    }
+
+    if (mpi_partition_flag)
+        partition_configs(*rc, *nrc);
+
+    // Every config gets the team of the largest count of the sweep
+    for (int k = 0; thread_sweep.policy != PIN_NONE && k < *nrc; k++)
+        (*rc)[k].omp_threads = thread_sweep.threads[thread_sweep.n - 1];
+
+    // The server still parses configs with argtable after this returns
+    if (!serve_addr[0])
+        free(argtable);
 
     return;
 }
 
-struct run_config *parse_runs(int argc, char **argv)
+static void init_run_config(struct run_config *rc)
 {
-    int pattern_found = 0;
-    int pattern_scatter_found = 0;
-    int pattern_gather_found = 0;
-
-    struct run_config *rc = (struct run_config *)calloc(1, sizeof(struct run_config));
     rc->pattern_size = 0;
     rc->delta = -1;
     rc->delta_gather = -1;
@@ -394,278 +690,228 @@ struct run_config *parse_runs(int argc, char **argv)
 #else
     rc->omp_threads = 1;
 #endif
+    rc->chains = 1;
+    rc->index_bits = 64;
     rc->kernel = INVALID_KERNEL;
     safestrcopy(rc->name,"NONE");
+}
 
-   if (kernelName->count > 0)
-   {
-        copy_str_ignore_leading_space(kernel_name, kernelName->sval[0]);
-        if (!strcasecmp("MULTISCATTER", kernel_name))
-            rc->kernel = MULTISCATTER;
-        else if (!strcasecmp("MULTIGATHER", kernel_name))
-            rc->kernel = MULTIGATHER;
-        else if (!strcasecmp("GS", kernel_name))
-            rc->kernel=GS;
-        else if (!strcasecmp("SCATTER", kernel_name))
-            rc->kernel=SCATTER;
-        else if (!strcasecmp("GATHER", kernel_name))
-            rc->kernel=GATHER;
-        else
-        {
-            char output[STRING_SIZE];
-            sprintf(output, "Invalid kernel %s\n", kernel_name);
-            error(output, ERROR);
-        }
-   }
-
-   if(atomic->count > 0 && atomic->ival[0] > 0) {
-      printf("Atomic CUDA Enabled");
-      atomic_flag++;  
-   } 
-
-   if (op->count > 0)
-   {
-        copy_str_ignore_leading_space(op_string, op->sval[0]);
-        if (!strcasecmp("COPY", op_string))
-            rc->op = OP_COPY;
-        else if (!strcasecmp("ACCUM", op_string))
-            rc->op = OP_ACCUM;
-        else
-            error("Unrecognzied op type", ERROR);
-   }
-
-   if (random_arg->count > 0)
-   {
-        // Parsing the seed parameter
-        // If no argument was passed, use the current time in seconds since the epoch as the random seed
-        if (random_arg->ival[0] == -1)
-            rc->random_seed = time(NULL);
-        else
-            //sscanf(optarg, "%zu", rc->random_seed);
-            rc->random_seed = random_arg->ival[0];
-   }
-
-    if (omp_threads->count > 0)
-        rc->omp_threads = omp_threads->ival[0];
-
-    if (vector_len->count > 0)
+static void set_kernel(struct run_config *rc, const char *kernel)
+{
+    if (!strcasecmp("MULTISCATTER", kernel))
+        rc->kernel = MULTISCATTER;
+    else if (!strcasecmp("MULTIGATHER", kernel))
+        rc->kernel = MULTIGATHER;
+    else if (!strcasecmp("GS", kernel))
+        rc->kernel=GS;
+    else if (!strcasecmp("SCATTER", kernel))
+        rc->kernel=SCATTER;
+    else if (!strcasecmp("GATHER", kernel))
+        rc->kernel=GATHER;
+    else if (!strcasecmp("CHASE", kernel))
+        rc->kernel=CHASE;
+    else if (!strcasecmp("PACK", kernel))
     {
-        rc->vector_len = vector_len->ival[0];
-        if (rc->vector_len < 1)
-            error("Invalid vector len!", ERROR);
+        rc->kernel=GATHER;
+        rc->box_op=BOX_PACK;
     }
-
-    if (runs->count > 0)
-        rc->nruns = runs->ival[0];
-
-    if (wrap->count > 0)
-        rc->wrap = wrap->ival[0];
-
-    if (boundary->count > 0)
-        rc->boundary = (spIdx_t)boundary->ival[0];
-    else
-        rc->boundary = -1;
-
-    if (pattern_size->count > 0)
-        rc->pattern_size = pattern_size->ival[0];
-
-    if (count->count > 0)
-        rc->generic_len = count->ival[0];
-
-    if (local_work_size->count > 0)
-        rc->local_work_size = local_work_size->ival[0];
-
-    if (shared_memory->count > 0)
-        rc->shmem = shared_memory->ival[0];
-
-    if (name->count > 0)
-        copy_str_ignore_leading_space(rc->name, name->sval[0]);
-
-    if (pattern->count > 0)
+    else if (!strcasecmp("UNPACK", kernel))
     {
-        rc->generator = (char *)sp_malloc(sizeof(char), strlen(pattern->sval[0]) + 1, ALIGN_CACHE);
- 
-        copy_str_ignore_leading_space2(rc->generator, pattern->sval[0], strlen(pattern->sval[0]));
-        //char* filePtr = strstr(rc->generator, "FILE");
-        //if (filePtr)
-        //    safestrcopy(rc->generator, filePtr);
-        parse_p(rc->generator, rc, 0);
-        pattern_found = 1;
-        free(rc->generator);
+        rc->kernel=SCATTER;
+        rc->box_op=BOX_UNPACK;
     }
-
-    if (pattern_gather->count > 0)
+    else if (!strcasecmp("TRANSPOSE", kernel))
     {
-        rc->generator = (char *)sp_malloc(1, strlen(pattern_gather->sval[0]), ALIGN_CACHE);
-        copy_str_ignore_leading_space2(rc->generator, pattern_gather->sval[0], strlen(pattern_gather->sval[0]));
-        parse_p(rc->generator, rc, 1);
-        pattern_gather_found = 1;
-        free(rc->generator);
+        rc->kernel=GATHER;
+        rc->box_op=BOX_TRANSPOSE;
     }
-
-    if (pattern_scatter->count > 0)
+    else
     {
-        rc->generator = (char *)sp_malloc(1, strlen(pattern_scatter->sval[0]), ALIGN_CACHE);
-        copy_str_ignore_leading_space2(rc->generator, pattern_scatter->sval[0], strlen(pattern_scatter->sval[0]));
-        parse_p(rc->generator, rc, 2);
-        pattern_scatter_found = 1;
-        free(rc->generator);
+        char output[STRING_SIZE];
+        snprintf(output, STRING_SIZE, "Invalid kernel %s\n", kernel);
+        error(output, ERROR);
     }
+}
 
-    if (delta->count > 0)
-    {
-        char delta_temp[STRING_SIZE];
-        copy_str_ignore_leading_space(delta_temp, delta->sval[0]);
-        char *delim = ",";
-        char *ptr = strtok(delta_temp, delim);
-        if (!ptr)
-            error("Pattern not found", ERROR);
-
-        spIdx_t *mydeltas;
-        spIdx_t *mydeltas_ps;
-
-        mydeltas = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
-        mydeltas_ps = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
-
-        size_t read = 0;
-        if (sscanf(ptr, "%zu", &(mydeltas[read++])) < 1)
-            error("Failed to parse first pattern element in deltas", ERROR);
-
-        while ((ptr = strtok(NULL, delim)) && read < MAX_PATTERN_LEN)
-        {
-            if (sscanf(ptr, "%zu", &(mydeltas[read++])) < 1)
-                error("Failed to parse pattern", ERROR);
-        }
-
-        rc->deltas = mydeltas;
-        rc->deltas_ps = mydeltas_ps;
-        rc->deltas_len = read;
-
-        // rotate
-        for (size_t i = 0; i < rc->deltas_len; i++)
-            rc->deltas_ps[i] = rc->deltas[((i-1)+rc->deltas_len)%rc->deltas_len];
+static void set_op(struct run_config *rc, const char *op_str)
+{
+    if (!strcasecmp("COPY", op_str))
+        rc->op = OP_COPY;
+    else if (!strcasecmp("ACCUM", op_str))
+        rc->op = OP_ACCUM;
+    else if (!strcasecmp("ATOMIC", op_str))
+        rc->op = OP_ACCUM_ATOMIC;
+    else if (!strcasecmp("CONFLICT", op_str))
+        rc->op = OP_ACCUM_CONFLICT;
+    else
+        error("Unrecognzied op type", ERROR);
+}
 
-        // compute prefix-sum
-        for (size_t i = 1; i < rc->deltas_len; i++)
-            rc->deltas_ps[i] += rc->deltas_ps[i-1];
+static void set_store(struct run_config *rc, const char *store_str)
+{
+    if (!strcasecmp("PLAIN", store_str))
+        rc->store = STORE_PLAIN;
+    else if (!strcasecmp("NT", store_str))
+        rc->store = STORE_NT;
+    else
+        error("Unrecognized store type", ERROR);
+}
 
-        // compute max
-        size_t m = rc->deltas_ps[0];
-        for (size_t i = 1; i < rc->deltas_len; i++)
-        {
-            if (rc->deltas_ps[i] > m)
-                m = rc->deltas_ps[i];
-        }
-        rc->delta = m;
+static void set_elem(struct run_config *rc, const char *elem_str)
+{
+    rc->elem_size = 0;
+    if (!strcasecmp("F64", elem_str)) {
+        rc->elem = ELEM_F64;
+    } else if (!strcasecmp("F32", elem_str)) {
+        rc->elem = ELEM_F32;
+        rc->elem_size = sizeof(float);
+    } else if (!strcasecmp("I32", elem_str)) {
+        rc->elem = ELEM_I32;
+        rc->elem_size = sizeof(int32_t);
+    } else if (!strcasecmp("I64", elem_str)) {
+        rc->elem = ELEM_I64;
+        rc->elem_size = sizeof(int64_t);
+    } else if (!strcasecmp("C64", elem_str)) {
+        rc->elem = ELEM_C64;
+        rc->elem_size = sizeof(sgC64_t);
+    } else if (!strncasecmp("BYTES:", elem_str, 6)) {
+        char *end;
+        long n = strtol(elem_str + 6, &end, 10);
+        if (*end || n < 1 || n > SP_MAX_ELEM_BYTES)
+            error("--elem=bytes:N needs 1 <= N <= 4096", ERROR);
+        rc->elem = ELEM_BYTES;
+        rc->elem_size = n;
+    } else {
+        error("Unrecognized element type", ERROR);
     }
+}
 
-   if (delta_gather->count > 0)
-    {
-        char delta_gather_temp[STRING_SIZE];
-        copy_str_ignore_leading_space(delta_gather_temp, delta_gather->sval[0]);
-        char *delim_gather = ",";
-        char *ptr_gather = strtok(delta_gather_temp, delim_gather);
-        if (!ptr_gather)
-            error("Pattern not found", ERROR);
-
-        spIdx_t *mydeltas_gather;
-        spIdx_t *mydeltas_gather_ps;
-
-        mydeltas_gather = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
-        mydeltas_gather_ps = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
-
-        size_t read_gather = 0;
-        if (sscanf(ptr_gather, "%zu", &(mydeltas_gather[read_gather++])) < 1)
-            error("Failed to parse first pattern element in deltas", ERROR);
-
-        while ((ptr_gather = strtok(NULL, delim_gather)) && read_gather < MAX_PATTERN_LEN)
-        {
-            if (sscanf(ptr_gather, "%zu", &(mydeltas_gather[read_gather++])) < 1)
-                error("Failed to parse pattern", ERROR);
-        }
-
-        rc->deltas_gather = mydeltas_gather;
-        rc->deltas_gather_ps = mydeltas_gather_ps;
-        rc->deltas_gather_len = read_gather;
-
-        // rotate
-        for (size_t i = 0; i < rc->deltas_gather_len; i++)
-            rc->deltas_gather_ps[i] = rc->deltas_gather[((i-1)+rc->deltas_gather_len)%rc->deltas_gather_len];
-
-        // compute prefix-sum
-        for (size_t i = 1; i < rc->deltas_gather_len; i++)
-            rc->deltas_gather_ps[i] += rc->deltas_gather_ps[i-1];
-
-        // compute max
-        size_t m = rc->deltas_gather_ps[0];
-        for (size_t i = 1; i < rc->deltas_gather_len; i++)
-        {
-            if (rc->deltas_gather_ps[i] > m)
-                m = rc->deltas_gather_ps[i];
-        }
-        rc->delta_gather = m;
+static void set_random_dist(struct run_config *rc, const char *dist_str)
+{
+    char *end;
+    if (!strcasecmp("UNIFORM", dist_str)) {
+        rc->random_dist = RANDOM_UNIFORM;
+    } else if (!strncasecmp("ZIPF:", dist_str, 5)) {
+        rc->random_dist = RANDOM_ZIPF;
+        rc->random_param[0] = strtod(dist_str + 5, &end);
+        if (end == dist_str + 5 || *end || !(rc->random_param[0] > 0))
+            error("--random-dist=zipf:<s> needs s > 0", ERROR);
+    } else if (!strncasecmp("HOTSET:", dist_str, 7)) {
+        rc->random_dist = RANDOM_HOTSET;
+        rc->random_param[0] = strtod(dist_str + 7, &end);
+        if (end == dist_str + 7 || *end != ':')
+            error("--random-dist=hotset:<frac>:<prob> not parsed", ERROR);
+        const char *prob = end + 1;
+        rc->random_param[1] = strtod(prob, &end);
+        if (end == prob || *end)
+            error("--random-dist=hotset:<frac>:<prob> not parsed", ERROR);
+        if (!(rc->random_param[0] > 0 && rc->random_param[0] < 1) || !(rc->random_param[1] >= 0 && rc->random_param[1] <= 1))
+            error("--random-dist=hotset:<frac>:<prob> needs 0 < frac < 1 and 0 <= prob <= 1", ERROR);
+    } else {
+        error("Unrecognized random distribution", ERROR);
     }
+}
 
-    if (delta_scatter->count > 0)
-    {
-        char delta_scatter_temp[STRING_SIZE];
-        copy_str_ignore_leading_space(delta_scatter_temp, delta_scatter->sval[0]);
-        char *delim_scatter = ",";
-        char *ptr_scatter = strtok(delta_scatter_temp, delim_scatter);
-        if (!ptr_scatter)
-            error("Pattern not found", ERROR);
-
-        spIdx_t *mydeltas_scatter;
-        spIdx_t *mydeltas_scatter_ps;
-
-        mydeltas_scatter = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
-        mydeltas_scatter_ps = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
+static void set_prefetch_hint(struct run_config *rc, const char *hint_str)
+{
+    if (!strcasecmp("T0", hint_str))
+        rc->prefetch_hint = PREFETCH_T0;
+    else if (!strcasecmp("NTA", hint_str))
+        rc->prefetch_hint = PREFETCH_NTA;
+    else
+        error("Unrecognized prefetch hint", ERROR);
+}
 
-        size_t read_scatter = 0;
-        if (sscanf(ptr_scatter, "%zu", &(mydeltas_scatter[read_scatter++])) < 1)
-            error("Failed to parse first pattern element in deltas", ERROR);
+static void set_prefetch_scope(struct run_config *rc, const char *scope_str)
+{
+    if (!strcasecmp("PATTERN", scope_str))
+        rc->prefetch_line = 0;
+    else if (!strcasecmp("LINE", scope_str))
+        rc->prefetch_line = 1;
+    else
+        error("Unrecognized prefetch scope", ERROR);
+}
 
-        while ((ptr_scatter = strtok(NULL, delim_scatter)) && read_scatter < MAX_PATTERN_LEN)
-        {
-            if (sscanf(ptr_scatter, "%zu", &(mydeltas_scatter[read_scatter++])) < 1)
-                error("Failed to parse pattern", ERROR);
-        }
+static void set_kernel_name(char *dest, struct run_config *rc)
+{
+    if (rc->kernel == SCATTER)
+        sprintf(dest, "%s%zu", "scatter", rc->vector_len);
+    else if (rc->kernel == GATHER)
+        sprintf(dest, "%s%zu", "gather", rc->vector_len);
+    else if (rc->kernel == GS)
+        sprintf(dest, "%s%zu", "sg", rc->vector_len);
+    else if (rc->kernel == MULTISCATTER)
+        sprintf(dest, "%s%zu", "multiscatter", rc->vector_len);
+    else if (rc->kernel == MULTIGATHER)
+        sprintf(dest, "%s%zu", "multigather", rc->vector_len);
+    else if (rc->kernel == CHASE)
+        sprintf(dest, "%s%zu", "chase", rc->vector_len);
+}
 
-        rc->deltas_scatter = mydeltas_scatter;
-        rc->deltas_scatter_ps = mydeltas_scatter_ps;
-        rc->deltas_scatter_len = read_scatter;
+// Keep a list of deltas along with its rotated prefix sum (the offset of
+// each gather/scatter) and set delta to the largest offset
+static void set_deltas(size_t *vals, size_t n, size_t **deltas, size_t **deltas_ps, size_t *deltas_len, ssize_t *delta)
+{
+    size_t *ps = sp_malloc(sizeof(size_t), n, ALIGN_CACHE);
 
-        // rotate
-        for (size_t i = 0; i < rc->deltas_scatter_len; i++)
-            rc->deltas_scatter_ps[i] = rc->deltas_scatter[((i-1)+rc->deltas_scatter_len)%rc->deltas_scatter_len];
+    // rotate
+    for (size_t i = 0; i < n; i++)
+        ps[i] = vals[((i-1)+n)%n];
 
-        // compute prefix-sum
-        for (size_t i = 1; i < rc->deltas_scatter_len; i++)
-            rc->deltas_scatter_ps[i] += rc->deltas_scatter_ps[i-1];
+    // compute prefix-sum
+    for (size_t i = 1; i < n; i++)
+        ps[i] += ps[i-1];
 
-        // compute max
-        size_t m = rc->deltas_scatter_ps[0];
-        for (size_t i = 1; i < rc->deltas_scatter_len; i++)
-        {
-            if (rc->deltas_scatter_ps[i] > m)
-                m = rc->deltas_scatter_ps[i];
-        }
-        rc->delta_scatter = m;
+    // compute max
+    size_t m = ps[0];
+    for (size_t i = 1; i < n; i++)
+    {
+        if (ps[i] > m)
+            m = ps[i];
     }
 
+    *deltas = vals;
+    *deltas_ps = ps;
+    *deltas_len = n;
+    *delta = m;
+}
 
-    if (morton->count > 0)
-        rc->ro_morton = morton->ival[0];
-
-    if (hilbert->count > 0)
-        rc->ro_hilbert = hilbert->ival[0];
+static void parse_deltas(const char *str, size_t **deltas, size_t **deltas_ps, size_t *deltas_len, ssize_t *delta)
+{
+    char delta_temp[STRING_SIZE];
+    char *save = NULL;
+    copy_str_ignore_leading_space(delta_temp, str);
+    char *delim = ",";
+    char *ptr = strtok_r(delta_temp, delim, &save);
+    if (!ptr)
+        error("Pattern not found", ERROR);
+
+    size_t ndeltas = count_tokens(str, ',');
+    size_t *mydeltas = sp_malloc(sizeof(size_t), ndeltas, ALIGN_CACHE);
+
+    size_t read = 0;
+    if (sscanf(ptr, "%zu", &(mydeltas[read++])) < 1)
+        error("Failed to parse first pattern element in deltas", ERROR);
+
+    while ((ptr = strtok_r(NULL, delim, &save)) && read < ndeltas)
+    {
+        if (sscanf(ptr, "%zu", &(mydeltas[read++])) < 1)
+            error("Failed to parse pattern", ERROR);
+    }
 
-    if (roblock->count > 0)
-        rc->ro_block = roblock->ival[0];
+    set_deltas(mydeltas, read, deltas, deltas_ps, deltas_len, delta);
+}
 
-    if (stride->count > 0)
-        rc->stride_kernel = stride->ival[0];
+// The pattern lengths the V-templated CUDA kernels are instantiated for
+static int cuda_template_len(size_t len)
+{
+    return len == 8 || len == 73 || (len >= 16 && len <= 4096 && (len & (len - 1)) == 0);
+}
 
+// Checks and defaults shared by the argtable and the json parsers.
+// pattern_str names the config if no name was given.
+static void finalize_run_config(struct run_config *rc, int pattern_found, int pattern_gather_found, int pattern_scatter_found, const char *pattern_str)
+{
     // VALIDATE ARGUMENTS
     if (rc->kernel != GS && !pattern_found)
         error ("Please specify a pattern", ERROR);
@@ -679,9 +925,6 @@ struct run_config *parse_runs(int argc, char **argv)
     if ((rc->kernel == GS && !pattern_scatter_found) || (rc->kernel == GS && !pattern_gather_found))
         error ("Please specify a gather pattern and a scatter pattern for an GS kernel", ERROR);
 
-    if (rc->kernel == GS && (rc->pattern_gather_len != rc->pattern_scatter_len))
-        error ("Gather pattern and scatter pattern must have the same length", ERROR);
-
     if (rc->vector_len == 0)
     {
         error ("Vector length not set. Default is 1", WARN);
@@ -710,33 +953,56 @@ struct run_config *parse_runs(int argc, char **argv)
     {
         error("Kernel unspecified, guess GATHER", WARN);
         rc->kernel = GATHER;
-        safestrcopy(kernel_name, "gather");
     }
 
-    if (rc->kernel == SCATTER)
-        sprintf(kernel_name, "%s%zu", "scatter", rc->vector_len);
-    else if (rc->kernel == GATHER)
-        sprintf(kernel_name, "%s%zu", "gather", rc->vector_len);
-    else if (rc->kernel == GS)
-        sprintf(kernel_name, "%s%zu", "sg", rc->vector_len);
-    else if (rc->kernel == MULTISCATTER)
-        sprintf(kernel_name, "%s%zu", "multiscatter", rc->vector_len);
-    else if (rc->kernel == MULTIGATHER)
-        sprintf(kernel_name, "%s%zu", "multigather", rc->vector_len);
+    if (rc->type == TRACE)
+    {
+        if (rc->kernel != GATHER && rc->kernel != SCATTER)
+            error("TRACE patterns are only supported by the Gather and Scatter kernels", ERROR);
+        if (backend != OPENMP && backend != SERIAL)
+            error("TRACE patterns are only supported by the OpenMP and Serial backends", ERROR);
+        rc->delta = 0;
+        rc->deltas_len = 1;
+    }
 
-    if (pattern_found)
+    if (rc->type == BOX || rc->box_op != BOX_NONE)
     {
+        if (rc->type != BOX || rc->box_op == BOX_NONE)
+            error("-pBOX patterns are only supported by the PACK, UNPACK and TRANSPOSE kernels, which need one", ERROR);
+        if (rc->box_op == BOX_TRANSPOSE && rc->box.face >= 0)
+            error("TRANSPOSE moves the whole box, -pBOX:<nx>:<ny>:<nz>:<cell elements> takes no face", ERROR);
+        if (rc->box_op != BOX_TRANSPOSE && rc->box.face < 0)
+            error("PACK and UNPACK need a face, -pBOX:<nx>:<ny>:<nz>:<cell elements>:<face>", ERROR);
+        if (backend != OPENMP && backend != SERIAL && backend != CUDA)
+            error("PACK, UNPACK and TRANSPOSE are only supported by the OpenMP, Serial and CUDA backends", ERROR);
+        if (rc->pattern_len != sp_box_len(&rc->box) || rc->boundary > 0)
+            error("PACK, UNPACK and TRANSPOSE compute their indices from the box, they can not be strong-scaled or wrapped at --boundary", ERROR);
+        if (rc->op != OP_COPY || rc->store != STORE_PLAIN || rc->prefetch_distance > 0 || rc->index_bits != 64 || rc->elem != ELEM_F64 || rc->cuda_async > 0)
+            error("PACK, UNPACK and TRANSPOSE can not be combined with accumulate ops, --store=nt, --prefetch-distance, --index-bits, --elem or --cuda-async", ERROR);
+        if (rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->stride_kernel != -1 || rc->deltas_len > 1 || numa_mode == NUMA_REPLICATE)
+            error("PACK, UNPACK and TRANSPOSE can not be combined with --random, --morton, --hilbert, --stride, multiple deltas or --numa=replicate", ERROR);
+
+        // Boxes follow each other by default
         if (rc->delta <= -1)
         {
-            error("delta not specified, default is 8\n", WARN);
-            rc->delta = 8;
+            rc->delta = sp_box_elems(&rc->box);
             rc->deltas_len = 1;
         }
     }
 
-    if (pattern_gather_found)
+    if (pattern_found)
     {
-        if (rc->delta_gather <= -1)
+        if (rc->delta <= -1)
+        {
+            error("delta not specified, default is 8\n", WARN);
+            rc->delta = 8;
+            rc->deltas_len = 1;
+        }
+    }
+
+    if (pattern_gather_found)
+    {
+        if (rc->delta_gather <= -1)
         {
             error("delta gather not specified, default is 8\n", WARN);
             rc->delta_gather = 8;
@@ -754,13 +1020,128 @@ struct run_config *parse_runs(int argc, char **argv)
         }
     }
 
-    if (rc->op != OP_COPY)
-        error("OP must be OP_COPY", WARN);
+    if (rc->op != OP_COPY && rc->kernel != SCATTER)
+        error("Accumulate ops are only supported by the Scatter kernel, other kernels copy", WARN);
+
+    if (rc->op != OP_COPY && rc->kernel == SCATTER)
+    {
+        if (backend != OPENMP && backend != SERIAL)
+            error("Accumulate ops are only supported by the OpenMP and Serial backends", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || numa_mode == NUMA_REPLICATE)
+            error("Accumulate ops can not be combined with TRACE patterns, --random or --numa=replicate", ERROR);
+        if (rc->op == OP_ACCUM_CONFLICT && backend == OPENMP && !sg_conflict_support())
+            error("The CONFLICT op needs a CPU with AVX-512CD", ERROR);
+    }
+
+    if (rc->store == STORE_NT)
+    {
+        if (backend != OPENMP)
+            error("--store=nt is only supported by the OpenMP backend", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER && rc->kernel != GS)
+            error("--store=nt is only supported by the Gather, Scatter and GS kernels", ERROR);
+        if (rc->op != OP_COPY && rc->kernel == SCATTER)
+            error("--store=nt can not be combined with accumulate ops, they read the target", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->deltas_len > 1 || numa_mode == NUMA_REPLICATE)
+            error("--store=nt can not be combined with TRACE patterns, --random, --morton, --hilbert, multiple deltas or --numa=replicate", ERROR);
+    }
+
+    if (rc->prefetch_distance > 0)
+    {
+        if (backend != OPENMP && backend != SERIAL && backend != CUDA)
+            error("--prefetch-distance is only supported by the OpenMP, Serial and CUDA backends", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER)
+            error("--prefetch-distance is only supported by the Gather and Scatter kernels", ERROR);
+        if (rc->op != OP_COPY || rc->store != STORE_PLAIN)
+            error("--prefetch-distance can not be combined with accumulate ops or --store=nt", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->stride_kernel != -1 || rc->deltas_len > 1 || numa_mode == NUMA_REPLICATE)
+            error("--prefetch-distance can not be combined with TRACE patterns, --random, --morton, --hilbert, --stride, multiple deltas or --numa=replicate", ERROR);
+        if (backend == CUDA && rc->prefetch_hint != PREFETCH_T0)
+            error("The CUDA backend only supports --prefetch-hint=t0", ERROR);
+#ifdef USE_HIP
+        if (backend == CUDA)
+            error("--prefetch-distance is not supported by the HIP build", ERROR);
+#endif
+    }
+
+    if (rc->gs_tile > 0 && rc->kernel != GS)
+        error("--gs-tile is only supported by the GS kernel", ERROR);
+
+    if (rc->kernel == GS && (rc->gs_tile > 0 || rc->pattern_gather_len != rc->pattern_scatter_len))
+    {
+        if (backend != OPENMP && backend != SERIAL)
+            error("Gather and scatter patterns of different lengths and --gs-tile are only supported by the OpenMP and Serial backends", ERROR);
+        if (rc->store != STORE_PLAIN || rc->ro_morton || rc->ro_hilbert)
+            error("Gather and scatter patterns of different lengths and --gs-tile can not be combined with --store=nt, --morton or --hilbert", ERROR);
+    }
+
+    if (rc->cuda_async > 0)
+    {
+        if (backend != CUDA)
+            error("--cuda-async is only supported by the CUDA backend", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER)
+            error("--cuda-async is only supported by the Gather and Scatter kernels", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->stride_kernel != -1 || rc->deltas_len > 1 || rc->prefetch_distance > 0 || rc->elem != ELEM_F64)
+            error("--cuda-async can not be combined with TRACE patterns, --random, --morton, --hilbert, --stride, multiple deltas, --prefetch-distance or --elem", ERROR);
+        if (!cuda_template_len(rc->pattern_len))
+            error("--cuda-async supports pattern lengths of 8, 16, 32, 64, 73 and powers of two up to 4096", ERROR);
+#ifdef USE_HIP
+        if (backend == CUDA)
+            error("--cuda-async is not supported by the HIP build", ERROR);
+#endif
+    }
+
+    if (rc->index_bits != 64)
+    {
+        if (rc->index_bits != 16 && rc->index_bits != 32)
+            error("--index-bits must be 16, 32 or 64", ERROR);
+        if (backend != OPENMP)
+            error("--index-bits is only supported by the OpenMP backend", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER && rc->kernel != MULTIGATHER && rc->kernel != MULTISCATTER)
+            error("--index-bits is only supported by the Gather, Scatter, MultiGather and MultiScatter kernels", ERROR);
+        if (rc->op != OP_COPY || rc->store != STORE_PLAIN || rc->prefetch_distance > 0)
+            error("--index-bits can not be combined with accumulate ops, --store=nt or --prefetch-distance", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->deltas_len > 1 || numa_mode == NUMA_REPLICATE)
+            error("--index-bits can not be combined with TRACE patterns, --random, --morton, --hilbert, multiple deltas or --numa=replicate", ERROR);
+    }
+
+    if (rc->elem != ELEM_F64)
+    {
+        if (backend != OPENMP && backend != SERIAL && backend != CUDA)
+            error("--elem is only supported by the OpenMP, Serial and CUDA backends", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER)
+            error("--elem is only supported by the Gather and Scatter kernels", ERROR);
+        if (backend == CUDA && rc->elem_size != 4 && rc->elem_size != 8 && rc->elem_size != 16)
+            error("The CUDA backend only supports --elem sizes of 4, 8 and 16 bytes", ERROR);
+        if (rc->op != OP_COPY || rc->store != STORE_PLAIN || rc->prefetch_distance > 0 || rc->index_bits != 64 || rma_mode != RMA_NONE)
+            error("--elem can not be combined with accumulate ops, --store=nt, --prefetch-distance, --index-bits or --rma", ERROR);
+        if (rc->type == TRACE || rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->stride_kernel != -1 || rc->deltas_len > 1 || numa_mode == NUMA_REPLICATE)
+            error("--elem can not be combined with TRACE patterns, --random, --morton, --hilbert, --stride, multiple deltas or --numa=replicate", ERROR);
+    }
+
+    if (rc->random_dist != RANDOM_UNIFORM)
+    {
+        if (rc->random_seed < 1)
+            error("--random-dist needs --random", ERROR);
+        if (backend != OPENMP && backend != SERIAL && backend != CUDA)
+            error("--random-dist is only supported by the OpenMP, Serial and CUDA backends", ERROR);
+        if (rc->kernel != GATHER && rc->kernel != SCATTER)
+            error("--random-dist is only supported by the Gather and Scatter kernels", ERROR);
+        if (rc->generic_len > UINT32_MAX)
+            error("--random-dist supports at most 2^32 - 1 Gathers or Scatters", ERROR);
+    }
+
+    if (rc->ro_morton || rc->ro_hilbert)
+    {
+        if (rc->ro_morton && rc->ro_hilbert)
+            error("--morton and --hilbert can not be combined", ERROR);
+        if (rc->op != OP_COPY)
+            error("--morton and --hilbert can not be combined with accumulate ops", ERROR);
+    }
 
     if (!strcasecmp(rc->name, "NONE"))
     {
         if (rc->type != CUSTOM)
-            safestrcopy(rc->name, pattern->sval[0]);
+            safestrcopy(rc->name, pattern_str);
         else
             safestrcopy(rc->name, "CUSTOM");
     }
@@ -784,6 +1165,19 @@ struct run_config *parse_runs(int argc, char **argv)
         error ("Compiled without OpenMP support but requsted more than 1 thread, using 1 instead", WARN);
 #endif
 
+    if (rc->kernel == CHASE)
+    {
+        if (backend != OPENMP && backend != SERIAL)
+            error("The CHASE kernel is only supported by the OpenMP and Serial backends", ERROR);
+        if (rc->type == TRACE || rc->deltas_len > 1 || rc->delta < 1)
+            error("The CHASE kernel needs a pattern with a single delta of at least 1", ERROR);
+        if (rc->chains < 1 || rc->chains > SP_MAX_CHAINS)
+            error("--chains must be between 1 and 64", ERROR);
+        size_t threads = backend == OPENMP ? rc->omp_threads : 1;
+        if (rc->generic_len < threads * rc->chains)
+            error("The CHASE kernel needs at least one Gather per chain (-l of at least threads * chains)", ERROR);
+    }
+
 #if defined USE_CUDA || defined USE_OPENCL
     if (rc->local_work_size == 0)
     {
@@ -791,9 +1185,474 @@ struct run_config *parse_runs(int argc, char **argv)
         rc->local_work_size = 1024;
     }
 #endif
+}
+
+struct run_config *parse_runs(int argc, char **argv)
+{
+    int pattern_found = 0;
+    int pattern_scatter_found = 0;
+    int pattern_gather_found = 0;
+
+    struct run_config *rc = (struct run_config *)calloc(1, sizeof(struct run_config));
+    init_run_config(rc);
+
+   if (kernelName->count > 0)
+   {
+        copy_str_ignore_leading_space(kernel_name, kernelName->sval[0]);
+        set_kernel(rc, kernel_name);
+   }
+
+   if(atomic->count > 0 && atomic->ival[0] > 0) {
+      printf("Atomic CUDA Enabled");
+      atomic_flag++;  
+   } 
+
+   if (op->count > 0)
+   {
+        copy_str_ignore_leading_space(op_string, op->sval[0]);
+        set_op(rc, op_string);
+   }
+
+   if (store_arg->count > 0)
+   {
+        char store_string[STRING_SIZE];
+        copy_str_ignore_leading_space(store_string, store_arg->sval[0]);
+        set_store(rc, store_string);
+   }
+
+   if (elem_arg->count > 0)
+   {
+        char elem_string[STRING_SIZE];
+        copy_str_ignore_leading_space(elem_string, elem_arg->sval[0]);
+        set_elem(rc, elem_string);
+   }
+
+   if (prefetch_hint_arg->count > 0)
+   {
+        char hint_string[STRING_SIZE];
+        copy_str_ignore_leading_space(hint_string, prefetch_hint_arg->sval[0]);
+        set_prefetch_hint(rc, hint_string);
+   }
+
+   if (prefetch_scope_arg->count > 0)
+   {
+        char scope_string[STRING_SIZE];
+        copy_str_ignore_leading_space(scope_string, prefetch_scope_arg->sval[0]);
+        set_prefetch_scope(rc, scope_string);
+   }
+
+   if (random_arg->count > 0)
+   {
+        // Parsing the seed parameter
+        // If no argument was passed, use the current time in seconds since the epoch as the random seed
+        if (random_arg->ival[0] == -1)
+            rc->random_seed = time(NULL);
+        else
+            //sscanf(optarg, "%zu", rc->random_seed);
+            rc->random_seed = random_arg->ival[0];
+   }
+
+   if (random_dist_arg->count > 0)
+   {
+        char dist_string[STRING_SIZE];
+        copy_str_ignore_leading_space(dist_string, random_dist_arg->sval[0]);
+        set_random_dist(rc, dist_string);
+   }
+
+    if (omp_threads->count > 0)
+        rc->omp_threads = omp_threads->ival[0];
+
+    if (vector_len->count > 0)
+    {
+        rc->vector_len = vector_len->ival[0];
+        if (rc->vector_len < 1)
+            error("Invalid vector len!", ERROR);
+    }
+
+    if (runs->count > 0)
+        rc->nruns = runs->ival[0];
+
+    if (wrap->count > 0)
+        rc->wrap = wrap->ival[0];
+
+    if (boundary->count > 0)
+        rc->boundary = (spIdx_t)boundary->ival[0];
+    else
+        rc->boundary = -1;
+
+    if (pattern_size->count > 0)
+        rc->pattern_size = pattern_size->ival[0];
+
+    if (count->count > 0)
+        rc->generic_len = count->ival[0];
+
+    if (local_work_size->count > 0)
+        rc->local_work_size = local_work_size->ival[0];
+
+    if (shared_memory->count > 0)
+        rc->shmem = shared_memory->ival[0];
+
+    if (name->count > 0)
+        copy_str_ignore_leading_space(rc->name, name->sval[0]);
+
+    if (pattern->count > 0)
+    {
+        rc->generator = (char *)sp_malloc(sizeof(char), strlen(pattern->sval[0]) + 1, ALIGN_CACHE);
+ 
+        copy_str_ignore_leading_space2(rc->generator, pattern->sval[0], strlen(pattern->sval[0]));
+        //char* filePtr = strstr(rc->generator, "FILE");
+        //if (filePtr)
+        //    safestrcopy(rc->generator, filePtr);
+        parse_p(rc->generator, rc, 0);
+        pattern_found = 1;
+        free(rc->generator);
+    }
+
+    if (pattern_gather->count > 0)
+    {
+        rc->generator = (char *)sp_malloc(1, strlen(pattern_gather->sval[0]), ALIGN_CACHE);
+        copy_str_ignore_leading_space2(rc->generator, pattern_gather->sval[0], strlen(pattern_gather->sval[0]));
+        parse_p(rc->generator, rc, 1);
+        pattern_gather_found = 1;
+        free(rc->generator);
+    }
+
+    if (pattern_scatter->count > 0)
+    {
+        rc->generator = (char *)sp_malloc(1, strlen(pattern_scatter->sval[0]), ALIGN_CACHE);
+        copy_str_ignore_leading_space2(rc->generator, pattern_scatter->sval[0], strlen(pattern_scatter->sval[0]));
+        parse_p(rc->generator, rc, 2);
+        pattern_scatter_found = 1;
+        free(rc->generator);
+    }
+
+    if (delta->count > 0)
+        parse_deltas(delta->sval[0], &rc->deltas, &rc->deltas_ps, &rc->deltas_len, &rc->delta);
+
+    if (delta_gather->count > 0)
+        parse_deltas(delta_gather->sval[0], &rc->deltas_gather, &rc->deltas_gather_ps, &rc->deltas_gather_len, &rc->delta_gather);
+
+    if (delta_scatter->count > 0)
+        parse_deltas(delta_scatter->sval[0], &rc->deltas_scatter, &rc->deltas_scatter_ps, &rc->deltas_scatter_len, &rc->delta_scatter);
+
+    if (morton->count > 0)
+        rc->ro_morton = morton->ival[0];
+
+    if (hilbert->count > 0)
+        rc->ro_hilbert = hilbert->ival[0];
+
+    if (roblock->count > 0)
+        rc->ro_block = roblock->ival[0];
+
+    if (stride->count > 0)
+        rc->stride_kernel = stride->ival[0];
+
+    if (chains_arg->count > 0)
+        rc->chains = chains_arg->ival[0];
+
+    if (index_bits_arg->count > 0)
+        rc->index_bits = index_bits_arg->ival[0];
+
+    if (prefetch_dist_arg->count > 0)
+    {
+        if (prefetch_dist_arg->ival[0] < 0)
+            error("--prefetch-distance can not be negative", ERROR);
+        rc->prefetch_distance = prefetch_dist_arg->ival[0];
+    }
+
+    if (gs_tile_arg->count > 0)
+    {
+        if (gs_tile_arg->ival[0] < 0)
+            error("--gs-tile can not be negative", ERROR);
+        rc->gs_tile = gs_tile_arg->ival[0];
+    }
+
+    if (cuda_async_arg->count > 0)
+    {
+        if (cuda_async_arg->ival[0] < 0)
+            error("--cuda-async can not be negative", ERROR);
+        rc->cuda_async = cuda_async_arg->ival[0];
+    }
+
+    finalize_run_config(rc, pattern_found, pattern_gather_found, pattern_scatter_found, pattern->sval[0]);
+
+    set_kernel_name(kernel_name, rc);
+
     return rc;
 }
 
+// Keys that parse_json_native handles itself. Any other key (or an
+// unexpected value type) sends the whole config through argtable instead.
+static const char *json_int_keys[] = {
+    "boundary", "pattern-size", "strong-scale", "count", "wrap", "runs",
+    "omp-threads", "vector-len", "local-work-size", "shared-memory",
+    "random", "morton", "hilbert", "roblock", "stride", "chains",
+    "prefetch-distance", "index-bits", "gs-tile", "cuda-async", NULL
+};
+static const char *json_str_keys[] = { "kernel", "kernel-name", "op", "store", "elem",
+    "prefetch-hint", "prefetch-scope", "random-dist", "name", NULL };
+// Strings or integer arrays, the deltas also take a single integer
+static const char *json_list_keys[] = {
+    "pattern", "pattern-gather", "pattern-scatter",
+    "delta", "delta-gather", "delta-scatter", NULL
+};
+
+static int json_key_in(const char *key, const char **keys)
+{
+    for (int i = 0; keys[i]; i++)
+        if (!strcmp(key, keys[i]))
+            return 1;
+    return 0;
+}
+
+static json_value *json_field(json_value *value, const char *key)
+{
+    for (unsigned int i = 0; i < value->u.object.length; i++)
+        if (!strcmp(value->u.object.values[i].name, key))
+            return value->u.object.values[i].value;
+    return NULL;
+}
+
+static int json_int_array(json_value *v)
+{
+    if (v->type != json_array || v->u.array.length == 0)
+        return 0;
+    for (unsigned int i = 0; i < v->u.array.length; i++)
+        if (v->u.array.values[i]->type != json_integer)
+            return 0;
+    return 1;
+}
+
+static int json_supported(json_value *value)
+{
+    if (value->type != json_object)
+        return 0;
+
+    for (unsigned int i = 0; i < value->u.object.length; i++)
+    {
+        const char *key = value->u.object.values[i].name;
+        json_value *v = value->u.object.values[i].value;
+
+        // argtable rejects repeated options
+        for (unsigned int j = 0; j < i; j++)
+            if (!strcmp(key, value->u.object.values[j].name))
+                return 0;
+
+        if (json_key_in(key, json_int_keys))
+        {
+            if (v->type != json_integer)
+                return 0;
+        }
+        else if (json_key_in(key, json_str_keys))
+        {
+            if (v->type != json_string)
+                return 0;
+        }
+        else if (json_key_in(key, json_list_keys))
+        {
+            if (v->type != json_string && !json_int_array(v) &&
+                !(v->type == json_integer && !strncmp(key, "delta", 5)))
+                return 0;
+        }
+        else
+            return 0;
+    }
+
+    // kernel is ambiguous, only kernel names are handled here
+    json_value *k = json_field(value, "kernel");
+    if (k)
+    {
+        if (strcasecmp(k->u.string.ptr, "SCATTER") && strcasecmp(k->u.string.ptr, "GATHER") && strcasecmp(k->u.string.ptr, "GS") &&
+            strcasecmp(k->u.string.ptr, "MULTISCATTER") && strcasecmp(k->u.string.ptr, "MULTIGATHER") && strcasecmp(k->u.string.ptr, "CHASE") &&
+            strcasecmp(k->u.string.ptr, "PACK") && strcasecmp(k->u.string.ptr, "UNPACK") && strcasecmp(k->u.string.ptr, "TRANSPOSE"))
+            return 0;
+        if (json_field(value, "kernel-name"))
+            return 0;
+    }
+
+    return 1;
+}
+
+static int json_pattern(json_value *v, struct run_config *rc, int mode, int strong)
+{
+    if (!v)
+        return 0;
+
+    if (v->type == json_string)
+    {
+        // parse_pattern tokenises its argument in place
+        char *gen = (char *)sp_malloc(sizeof(char), v->u.string.length + 1, ALIGN_CACHE);
+        copy_str_ignore_leading_space2(gen, v->u.string.ptr, v->u.string.length);
+        parse_pattern(gen, rc, mode, strong);
+        free(gen);
+        return 1;
+    }
+
+    ssize_t **pattern = mode == 0 ? &rc->pattern : mode == 1 ? &rc->pattern_gather : &rc->pattern_scatter;
+    spSize_t *pattern_len = mode == 0 ? &rc->pattern_len : mode == 1 ? &rc->pattern_gather_len : &rc->pattern_scatter_len;
+
+    size_t len = v->u.array.length;
+    if (rc->pattern_size > 0 && rc->pattern_size < len)
+        len = rc->pattern_size;
+
+    rc->type = CUSTOM;
+    *pattern = sp_malloc(sizeof(spIdx_t), len, ALIGN_CACHE);
+    for (size_t i = 0; i < len; i++)
+        (*pattern)[i] = (ssize_t)v->u.array.values[i]->u.integer;
+    *pattern_len = len;
+
+    scale_pattern(pattern, pattern_len, strong);
+    return 1;
+}
+
+static void json_deltas(json_value *v, size_t **deltas, size_t **deltas_ps, size_t *deltas_len, ssize_t *delta)
+{
+    if (!v)
+        return;
+
+    if (v->type == json_string)
+    {
+        parse_deltas(v->u.string.ptr, deltas, deltas_ps, deltas_len, delta);
+        return;
+    }
+
+    size_t n = v->type == json_integer ? 1 : v->u.array.length;
+    size_t *vals = sp_malloc(sizeof(size_t), n, ALIGN_CACHE);
+    if (v->type == json_integer)
+        vals[0] = (size_t)v->u.integer;
+    else
+        for (size_t i = 0; i < n; i++)
+            vals[i] = (size_t)v->u.array.values[i]->u.integer;
+
+    set_deltas(vals, n, deltas, deltas_ps, deltas_len, delta);
+}
+
+// Build a run_config straight from a json object, in the same order as
+// parse_runs. Only reads the json tree and rc, so configs can be parsed
+// concurrently. Returns 0 without touching rc if the object needs argtable.
+static int parse_json_native(json_value *value, struct run_config *rc)
+{
+    json_value *v;
+
+    if (!json_supported(value))
+        return 0;
+
+    init_run_config(rc);
+
+    if ((v = json_field(value, "kernel")))
+        error("Ambiguous Kernel Type: Assuming kernel-name option.", WARN);
+    if (v || (v = json_field(value, "kernel-name")))
+        set_kernel(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "op")))
+        set_op(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "store")))
+        set_store(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "elem")))
+        set_elem(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "prefetch-hint")))
+        set_prefetch_hint(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "prefetch-scope")))
+        set_prefetch_scope(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "random")))
+        rc->random_seed = v->u.integer == -1 ? (size_t)time(NULL) : (size_t)v->u.integer;
+
+    if ((v = json_field(value, "random-dist")))
+        set_random_dist(rc, v->u.string.ptr[0] == ' ' ? v->u.string.ptr + 1 : v->u.string.ptr);
+
+    if ((v = json_field(value, "omp-threads")))
+        rc->omp_threads = v->u.integer;
+
+    if ((v = json_field(value, "vector-len")))
+    {
+        rc->vector_len = v->u.integer;
+        if (v->u.integer < 1)
+            error("Invalid vector len!", ERROR);
+    }
+
+    if ((v = json_field(value, "runs")))
+        rc->nruns = v->u.integer;
+
+    if ((v = json_field(value, "wrap")))
+        rc->wrap = v->u.integer;
+
+    v = json_field(value, "boundary");
+    rc->boundary = v ? (spIdx_t)v->u.integer : -1;
+
+    if ((v = json_field(value, "pattern-size")))
+        rc->pattern_size = v->u.integer;
+
+    if ((v = json_field(value, "count")))
+        rc->generic_len = v->u.integer;
+
+    if ((v = json_field(value, "local-work-size")))
+        rc->local_work_size = v->u.integer;
+
+    if ((v = json_field(value, "shared-memory")))
+        rc->shmem = v->u.integer;
+
+    if ((v = json_field(value, "name")))
+        copy_str_ignore_leading_space(rc->name, v->u.string.ptr);
+
+    v = json_field(value, "strong-scale");
+    int strong = v && v->u.integer > 0;
+
+    json_value *p = json_field(value, "pattern");
+    int pattern_found = json_pattern(p, rc, 0, strong);
+    int pattern_gather_found = json_pattern(json_field(value, "pattern-gather"), rc, 1, strong);
+    int pattern_scatter_found = json_pattern(json_field(value, "pattern-scatter"), rc, 2, strong);
+
+    json_deltas(json_field(value, "delta"), &rc->deltas, &rc->deltas_ps, &rc->deltas_len, &rc->delta);
+    json_deltas(json_field(value, "delta-gather"), &rc->deltas_gather, &rc->deltas_gather_ps, &rc->deltas_gather_len, &rc->delta_gather);
+    json_deltas(json_field(value, "delta-scatter"), &rc->deltas_scatter, &rc->deltas_scatter_ps, &rc->deltas_scatter_len, &rc->delta_scatter);
+
+    if ((v = json_field(value, "morton")))
+        rc->ro_morton = v->u.integer;
+
+    if ((v = json_field(value, "hilbert")))
+        rc->ro_hilbert = v->u.integer;
+
+    if ((v = json_field(value, "roblock")))
+        rc->ro_block = v->u.integer;
+
+    if ((v = json_field(value, "stride")))
+        rc->stride_kernel = v->u.integer;
+
+    if ((v = json_field(value, "chains")))
+        rc->chains = v->u.integer;
+
+    if ((v = json_field(value, "index-bits")))
+        rc->index_bits = v->u.integer;
+
+    if ((v = json_field(value, "prefetch-distance"))) {
+        if (v->u.integer < 0)
+            error("--prefetch-distance can not be negative", ERROR);
+        rc->prefetch_distance = v->u.integer;
+    }
+
+    if ((v = json_field(value, "gs-tile"))) {
+        if (v->u.integer < 0)
+            error("--gs-tile can not be negative", ERROR);
+        rc->gs_tile = v->u.integer;
+    }
+
+    if ((v = json_field(value, "cuda-async"))) {
+        if (v->u.integer < 0)
+            error("--cuda-async can not be negative", ERROR);
+        rc->cuda_async = v->u.integer;
+    }
+
+    finalize_run_config(rc, pattern_found, pattern_gather_found, pattern_scatter_found,
+            !p ? "" : p->type == json_string ? p->u.string.ptr : "CUSTOM");
+
+    return 1;
+}
+
 ssize_t power(int base, int exp) {
     int i, result = 1;
     for (i = 0; i < exp; i++)
@@ -860,89 +1719,430 @@ void static laplacian(int dim, int order, int n, struct run_config *rc, int mode
 
     int max = pos[pos_len-1];
 
-    for (int i = 0; i < *pattern_len; i++) {
-        (*pattern)[i] = 2;
+    for (int i = 0; i < *pattern_len; i++) {
+        (*pattern)[i] = 2;
+    }
+
+    //populate rc->pattern
+    for(int i = 0; i < pos_len; i++) {
+        (*pattern)[i] = (-pos[pos_len - i - 1] + max);
+    }
+
+    (*pattern)[pos_len] = max;
+
+    for(int i = 0; i < pos_len; i++) {
+        (*pattern)[pos_len+1+i] = pos[i] + max;
+    }
+
+    free(pos);
+    return;
+}
+
+// Parse the split of --tier or --tier-target, every node must hold memory
+static void parse_tier(const char *opt, const char *arg, struct sp_tier *tier)
+{
+    char msg[STRING_SIZE];
+    if (sp_tier_parse(arg, tier)) {
+        snprintf(msg, STRING_SIZE, "%s takes interleave or a list of <node>:<weight> with distinct nodes and positive weights", opt);
+        error(msg, ERROR);
+    }
+    for (int i = 0; i < tier->n; i++) {
+        if (tier->node[i] >= sp_numa_num_nodes()) {
+            snprintf(msg, STRING_SIZE, "%s names node %d, but there are %d node(s) with memory", opt, tier->node[i], sp_numa_num_nodes());
+            error(msg, ERROR);
+        }
+    }
+}
+
+void parse_backend(int argc, char **argv)
+{
+    err_file = stderr;
+
+    safestrcopy(platform_string, "NONE");
+    safestrcopy(device_string,   "NONE");
+    safestrcopy(kernel_file,     "NONE");
+    safestrcopy(kernel_name,     "NONE");
+
+   if (backend_arg->count > 0)
+   {
+        if(!strcasecmp("OPENCL", backend_arg->sval[0]))
+            backend = OPENCL;
+        else if(!strcasecmp("OPENMP", backend_arg->sval[0]))
+            backend = OPENMP;
+        else if(!strcasecmp("CUDA", backend_arg->sval[0]))
+            backend = CUDA;
+        // HIP builds run the CUDA backend sources
+        else if(!strcasecmp("HIP", backend_arg->sval[0]))
+            backend = CUDA;
+        else if(!strcasecmp("SERIAL", backend_arg->sval[0]))
+            backend = SERIAL;
+        else
+            error ("Unrecognized Backend", ERROR);
+   }
+
+   if (cl_platform->count > 0)
+        copy_str_ignore_leading_space(platform_string, cl_platform->sval[0]);
+
+    if (cl_device->count > 0)
+        copy_str_ignore_leading_space(device_string, cl_device->sval[0]);
+
+    if (interactive->count > 0)
+    {
+        safestrcopy(platform_string, INTERACTIVE);
+        safestrcopy(device_string, INTERACTIVE);
+    }
+
+    if (kernelFile->count > 0)
+        copy_str_ignore_leading_space(kernel_file, kernelFile->filename[0]);
+
+    if (no_print_header->count > 0)
+        quiet_flag = no_print_header->ival[0];
+
+    if (validate->count > 0)
+        validate_flag++;
+
+    if (aggregate->count > 0)
+        aggregate_flag = 1;
+
+    if (compress->count > 0)
+    {
+        compress_flag = 1;
+        char *suffix;
+        compress_page = strtoull(compress->sval[0], &suffix, 10);
+        if (*suffix == 'K' || *suffix == 'k')
+            compress_page <<= 10;
+        else if (*suffix == 'M' || *suffix == 'm')
+            compress_page <<= 20;
+        else if (*suffix == 'G' || *suffix == 'g')
+            compress_page <<= 30;
+        else if (*suffix != '\0')
+            compress_page = 0;
+        if (*suffix != '\0' && suffix[1] != '\0')
+            compress_page = 0;
+        if (compress_page == 0 || (compress_page & (compress_page - 1)))
+            error("--compress page size must be a power of two, such as 4K, 2M or 1G", ERROR);
+    }
+
+    if (resize_buffers->count > 0)
+        resize_flag = 1;
+
+    if (sparse_source->count > 0)
+        sparse_source_flag = 1;
+
+    if (traffic->count > 0)
+        traffic_flag = 1;
+
+    if (analyze->count > 0)
+        analyze_flag = 1;
+    if (analyze_reuse->count > 0)
+        analyze_reuse_flag = 1;
+
+    if (write_config->count > 0)
+        copy_str_ignore_leading_space(write_config_file, write_config->sval[0]);
+
+    if (cuda_graph->count > 0)
+        cuda_graph_flag = 1;
+
+    if (autotune->count > 0)
+        autotune_flag = 1;
+
+    if (compose->count > 0)
+        compose_flag = 1;
+
+    if (inner_stream->count > 0)
+        inner_stream_flag = 1;
+
+    if (mpi_partition->count > 0)
+        mpi_partition_flag = 1;
+
+    if (busy_times->count > 0)
+        busy_flag = 1;
+
+    if (co_run->count > 0)
+        corun_flag = 1;
+
+    if (energy->count > 0)
+        energy_flag = 1;
+
+    if (output_arg->count > 0)
+    {
+        char out_arg[STRING_SIZE];
+        copy_str_ignore_leading_space(out_arg, output_arg->sval[0]);
+        if (sp_output_parse(out_arg, &output_format, output_file, STRING_SIZE))
+            error("--output must be json:<file> or csv:<file>", ERROR);
+    }
+
+    if (straggler->count > 0)
+    {
+        if (straggler->dval[0] < 1)
+            error("--straggler must be at least 1", ERROR);
+        straggler_threshold = straggler->dval[0];
+    }
+
+    if (devices->count > 0)
+    {
+        char *dev_str = strdup(devices->sval[0]);
+        char *saveptr = NULL;
+        cuda_ndevs = 0;
+        for (char *tok = strtok_r(dev_str, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr))
+        {
+            if (cuda_ndevs == SP_MAX_CUDA_DEVICES)
+                error("Too many devices given to --devices", ERROR);
+            char *end_ptr;
+            long d = strtol(tok, &end_ptr, 10);
+            if (end_ptr == tok || *end_ptr != '\0' || d < 0)
+                error("--devices takes a comma-separated list of CUDA device numbers", ERROR);
+            cuda_devs[cuda_ndevs++] = (int)d;
+        }
+        free(dev_str);
+        if (cuda_ndevs == 0)
+            error("--devices takes a comma-separated list of CUDA device numbers", ERROR);
+    }
+
+    if (gpu_mem_arg->count > 0)
+    {
+        char mem_str[STRING_SIZE];
+        copy_str_ignore_leading_space(mem_str, gpu_mem_arg->sval[0]);
+        char *hint_str = strchr(mem_str, ':');
+        if (hint_str)
+            *hint_str++ = '\0';
+
+        if (!strcasecmp("DEVICE", mem_str))
+            gpu_mem = GPU_MEM_DEVICE;
+        else if (!strcasecmp("MANAGED", mem_str))
+            gpu_mem = GPU_MEM_MANAGED;
+        else if (!strcasecmp("PINNED-HOST", mem_str))
+            gpu_mem = GPU_MEM_PINNED;
+        else if (!strcasecmp("SYSTEM", mem_str))
+            gpu_mem = GPU_MEM_SYSTEM;
+        else
+            error("Unrecognized --gpu-mem mode", ERROR);
+
+        if (!hint_str)
+            gpu_hint = GPU_HINT_NONE;
+        else if (!strcasecmp("PREFETCH", hint_str))
+            gpu_hint = GPU_HINT_PREFETCH;
+        else if (!strcasecmp("READMOSTLY", hint_str))
+            gpu_hint = GPU_HINT_READMOSTLY;
+        else if (!strcasecmp("HOST", hint_str))
+            gpu_hint = GPU_HINT_HOST;
+        else
+            error("Unrecognized --gpu-mem hint", ERROR);
+
+        if (gpu_hint != GPU_HINT_NONE && gpu_mem != GPU_MEM_MANAGED && gpu_mem != GPU_MEM_SYSTEM)
+            error("--gpu-mem hints only apply to managed and system memory", ERROR);
+    }
+
+    if (streams->count > 0)
+    {
+        if (streams->ival[0] < 1)
+            error("--streams must be at least 1", ERROR);
+        cuda_streams = streams->ival[0];
+    }
+
+    if (simd_arg->count > 0)
+    {
+        if (!strcasecmp("AUTO", simd_arg->sval[0]))
+            simd_isa = SIMD_AUTO;
+        else if (!strcasecmp("SCALAR", simd_arg->sval[0]))
+            simd_isa = SIMD_SCALAR;
+        else if (!strcasecmp("AVX2", simd_arg->sval[0]))
+            simd_isa = SIMD_AVX2;
+        else if (!strcasecmp("AVX512", simd_arg->sval[0]))
+            simd_isa = SIMD_AVX512;
+        else if (!strcasecmp("SVE", simd_arg->sval[0]))
+            simd_isa = SIMD_SVE;
+        else
+            error ("Unrecognized SIMD ISA", ERROR);
+
+        simd_isa = sg_simd_resolve(simd_isa);
+        if (!sg_simd_support(simd_isa))
+            error ("Requested SIMD ISA is not supported by this CPU or build", ERROR);
+    }
+
+    if (numa_arg->count > 0)
+    {
+        if (!strcasecmp("FIRSTTOUCH", numa_arg->sval[0]))
+            numa_mode = NUMA_FIRSTTOUCH;
+        else if (!strcasecmp("INTERLEAVE", numa_arg->sval[0]))
+            numa_mode = NUMA_INTERLEAVE;
+        else if (!strcasecmp("REPLICATE", numa_arg->sval[0]))
+            numa_mode = NUMA_REPLICATE;
+        else
+            error ("Unrecognized NUMA mode", ERROR);
+    }
+
+    if (rma_arg->count > 0)
+    {
+        if (!strcasecmp("ELEMENT", rma_arg->sval[0]))
+            rma_mode = RMA_ELEMENT;
+        else if (!strcasecmp("GATHER", rma_arg->sval[0]))
+            rma_mode = RMA_GATHER;
+        else if (!strcasecmp("AGGREGATE", rma_arg->sval[0]))
+            rma_mode = RMA_AGGREGATE;
+        else
+            error ("Unrecognized RMA mode", ERROR);
+    }
+
+    if (schedule_arg->count > 0)
+    {
+        char *kind = strdup(schedule_arg->sval[0]);
+        char *chunk = strchr(kind, ':');
+        if (chunk)
+            *chunk++ = '\0';
+
+        if (!strcasecmp("STATIC", kind))
+            sched_kind = SCHED_STATIC;
+        else if (!strcasecmp("DYNAMIC", kind))
+            sched_kind = SCHED_DYNAMIC;
+        else if (!strcasecmp("GUIDED", kind))
+            sched_kind = SCHED_GUIDED;
+        else if (!strcasecmp("STEAL", kind))
+            sched_kind = SCHED_STEAL;
+        else
+            error ("Unrecognized schedule", ERROR);
+
+        if (chunk) {
+            if (sched_kind == SCHED_STATIC)
+                error("The static schedule does not take a chunk size", ERROR);
+            if (sscanf(chunk, "%zu", &sched_chunk) != 1 || sched_chunk < 1)
+                error("The chunk size of --schedule must be at least 1", ERROR);
+        }
+        free(kind);
     }
 
-    //populate rc->pattern
-    for(int i = 0; i < pos_len; i++) {
-        (*pattern)[i] = (-pos[pos_len - i - 1] + max);
+    if (target_ci->count > 0)
+    {
+        char *unit = NULL;
+        double ci = strtod(target_ci->sval[0], &unit);
+        if (unit == target_ci->sval[0] || (*unit && strcmp(unit, "%")) || ci <= 0 || ci >= 100)
+            error("--target-ci must be a percentage between 0 and 100, e.g. 1%", ERROR);
+
+        double budget = SP_TIME_BUDGET;
+        if (time_budget->count > 0)
+            budget = time_budget->dval[0];
+        if (budget <= 0)
+            error("--time-budget must be positive", ERROR);
+
+        size_t most = SP_MAX_RUNS;
+        if (max_runs->count > 0) {
+            if (max_runs->ival[0] < SP_MIN_RUNS + SP_WARMUP_WINDOW)
+                error("--max-runs is too small to measure a confidence interval", ERROR);
+            most = max_runs->ival[0];
+        }
+        sp_measure_set(ci / 100, budget, most);
     }
+    else if (time_budget->count > 0 || max_runs->count > 0)
+        error("--time-budget and --max-runs only apply with --target-ci, ignoring", WARN);
 
-    (*pattern)[pos_len] = max;
+    if (min_sample->count > 0)
+    {
+        if (min_sample->dval[0] <= 0)
+            error("--min-sample must be positive", ERROR);
+        min_sample_ms = min_sample->dval[0];
+    }
 
-    for(int i = 0; i < pos_len; i++) {
-        (*pattern)[pos_len+1+i] = pos[i] + max;
+    if (timer_arg->count > 0)
+    {
+        enum sg_timer timer = INVALID_TIMER;
+        if (!strcasecmp(timer_arg->sval[0], "clock"))
+            timer = TIMER_CLOCK;
+        else if (!strcasecmp(timer_arg->sval[0], "tsc"))
+            timer = TIMER_TSC;
+        else
+            error("Unrecognized timer, the options are clock and tsc", ERROR);
+        if (!sg_set_timer(timer))
+            error("No invariant TSC or cntvct_el0 on this CPU, --timer=tsc falls back to clock", WARN);
     }
 
-    free(pos);
-    return;
-}
+    if (cache_arg->count > 0)
+    {
+        if (!strcasecmp(cache_arg->sval[0], "warm"))
+            cache_mode = CACHE_WARM;
+        else if (!strcasecmp(cache_arg->sval[0], "cold"))
+            cache_mode = CACHE_COLD;
+        else if (!strcasecmp(cache_arg->sval[0], "flush"))
+            cache_mode = CACHE_FLUSH;
+        else
+            error("Unrecognized cache state, the options are warm, cold and flush", ERROR);
+    }
 
-void parse_backend(int argc, char **argv)
-{
-    err_file = stderr;
+    if (baseline_arg->count > 0)
+        copy_str_ignore_leading_space(baseline_file, baseline_arg->sval[0]);
 
-    safestrcopy(platform_string, "NONE");
-    safestrcopy(device_string,   "NONE");
-    safestrcopy(kernel_file,     "NONE");
-    safestrcopy(kernel_name,     "NONE");
+    if (baseline_tol->count > 0)
+    {
+        if (baseline_tol->dval[0] < 0)
+            error("--baseline-tolerance must not be negative", ERROR);
+        if (baseline_arg->count == 0)
+            error("--baseline-tolerance only applies with --baseline, ignoring", WARN);
+        baseline_tolerance = baseline_tol->dval[0] / 100;
+    }
 
-   if (backend_arg->count > 0)
-   {
-        if(!strcasecmp("OPENCL", backend_arg->sval[0]))
-            backend = OPENCL;
-        else if(!strcasecmp("OPENMP", backend_arg->sval[0]))
-            backend = OPENMP;
-        else if(!strcasecmp("CUDA", backend_arg->sval[0]))
-            backend = CUDA;
-        else if(!strcasecmp("SERIAL", backend_arg->sval[0]))
-            backend = SERIAL;
-        else
-            error ("Unrecognized Backend", ERROR);
-   }
+    if (rate_arg->count > 0)
+    {
+        if (rate_arg->dval[0] <= 0)
+            error("--rate must be positive", ERROR);
+        rate_mgs = rate_arg->dval[0];
+    }
 
-   if (cl_platform->count > 0)
-        copy_str_ignore_leading_space(platform_string, cl_platform->sval[0]);
+    if (noise_arg->count > 0)
+    {
+        if (sp_noise_parse(noise_arg->sval[0], &noise_spec))
+            error("--noise takes <kernel>:<threads>[:<GB/s>], with kernel stream, copy or nt", ERROR);
+    }
 
-    if (cl_device->count > 0)
-        copy_str_ignore_leading_space(device_string, cl_device->sval[0]);
+    if (tier_arg->count > 0)
+        parse_tier("--tier", tier_arg->sval[0], &source_tier);
+    if (tier_target_arg->count > 0)
+        parse_tier("--tier-target", tier_target_arg->sval[0], &target_tier);
 
-    if (interactive->count > 0)
+    if (serve_arg->count > 0)
     {
-        safestrcopy(platform_string, INTERACTIVE);
-        safestrcopy(device_string, INTERACTIVE);
+        if (strcasecmp(serve_arg->sval[0], "stdin") && (strncmp(serve_arg->sval[0], "unix:", 5) || !serve_arg->sval[0][5]))
+            error("Unrecognized --serve address, the options are stdin and unix:<path>", ERROR);
+        safestrcopy(serve_addr, serve_arg->sval[0]);
     }
 
-    if (kernelFile->count > 0)
-        copy_str_ignore_leading_space(kernel_file, kernelFile->filename[0]);
+    if (shard_arg->count > 0)
+    {
+        if (sp_shard_parse(shard_arg->sval[0], &shard_index, &shard_count))
+            error("--shard takes <i>/<n> with 0 <= i < n, e.g. 3/8", ERROR);
+    }
 
-    if (no_print_header->count > 0)
-        quiet_flag = no_print_header->ival[0];
+    if (resume_arg->count > 0)
+        copy_str_ignore_leading_space(resume_file, resume_arg->sval[0]);
 
-    if (validate->count > 0)
-        validate_flag++;
+    if (thread_sweep_arg->count > 0)
+    {
+        if (sp_thread_sweep_parse(thread_sweep_arg->sval[0], &thread_sweep))
+            error("--thread-sweep takes a list of thread counts, max and .., then :compact or :spread, e.g. 1,2,..,max:spread", ERROR);
+        if ((int)thread_sweep.threads[thread_sweep.n - 1] > sp_pin_cpus())
+            error("--thread-sweep has more threads than there are CPUs to pin them to", ERROR);
+    }
 
-    if (aggregate->count > 0)
-        aggregate_flag = 1;
+    if (dsa_arg->count > 0)
+    {
+        if (sp_dsa_parse(dsa_arg->sval[0], dsa_wq, STRING_SIZE, &dsa_submitters))
+            error("--dsa takes <work queue>[:<threads>], e.g. /dev/dsa/wq0.0:2", ERROR);
+    }
 
-    if (compress->count > 0)
-        compress_flag = 1;
+    if (rma_batch_arg->count > 0)
+    {
+        if (rma_batch_arg->ival[0] < 1)
+            error("--rma-batch must be at least 1", ERROR);
+        rma_batch = rma_batch_arg->ival[0];
+    }
 
-    if (papi->count > 0)
+    if (alloc_arg->count > 0)
     {
-        #ifdef USE_PAPI
-        {
-            char *pch = strtok(papi->sval[0], ",");
-            while (pch != NULL)
-            {
-                safestrcopy(papi_event_names[papi_nevents++], pch);
-                pch = strtok (NULL, ",");
-                if (papi_nevents == PAPI_MAX_COUNTERS)
-                    break;
-            }
-        }
-        #endif
+        enum sp_pool pool = SP_NPOOLS;
+        for (int i = 0; i < SP_NPOOLS; i++)
+            if (!strcasecmp(sp_pool_name((enum sp_pool)i), alloc_arg->sval[0]))
+                pool = (enum sp_pool)i;
+        if (pool == SP_NPOOLS)
+            error ("Unrecognized allocator", ERROR);
+        sp_set_data_pool(pool);
     }
 
     /* Check argument coherency */
@@ -1010,28 +2210,290 @@ void parse_backend(int argc, char **argv)
     #ifdef USE_CUDA
     if (backend == CUDA)
     {
-        int dev = find_device_cuda(device_string);
-        if (dev == -1)
+        int dev;
+        if (devices->count > 0)
         {
-            error("Specified CUDA device not found or no device specified. Using device 0", WARN);
-            dev = 0;
+            int ndev_present = 0;
+            cudaGetDeviceCount(&ndev_present);
+            for (int d = 0; d < cuda_ndevs; d++)
+                if (cuda_devs[d] >= ndev_present)
+                    error("A device given to --devices does not exist", ERROR);
+            dev = cuda_devs[0];
+        }
+        else
+        {
+            dev = find_device_cuda(device_string);
+            if (dev == -1)
+            {
+                error("Specified CUDA device not found or no device specified. Using device 0", WARN);
+                dev = 0;
+            }
         }
+        cuda_devs[0] = dev;
         cuda_dev = dev;
         cudaSetDevice(dev);
     }
     #endif
 
+    if ((cuda_ndevs > 1 || cuda_streams > 1) && backend != CUDA) {
+        error("--devices and --streams are only supported by the CUDA backend, ignoring", WARN);
+        cuda_ndevs = 1;
+        cuda_streams = 1;
+    }
+
+    if (papi->count > 0)
+    {
+        #ifdef USE_PAPI
+        {
+            char *pch = strtok(papi->sval[0], ",");
+            while (pch != NULL)
+            {
+                // gpu: the CUDA component metrics of the device the
+                // kernels run on, selected above
+                if (!strcmp(pch, "gpu")) {
+                    for (int g = 0; papi_gpu_metrics[g] && papi_nevents < PAPI_MAX_COUNTERS; g++)
+                        snprintf(papi_event_names[papi_nevents++], STRING_SIZE, "cuda:::%s:device=%d", papi_gpu_metrics[g], cuda_dev < 0 ? 0 : cuda_dev);
+                } else {
+                    safestrcopy(papi_event_names[papi_nevents++], pch);
+                }
+                pch = strtok (NULL, ",");
+                if (papi_nevents == PAPI_MAX_COUNTERS) {
+                    if (pch)
+                        error("Too many PAPI events, only the first 32 are counted", WARN);
+                    break;
+                }
+            }
+        }
+        #endif
+    }
+
+#ifndef USE_MPI
+    if (mpi_partition_flag) {
+        error("--mpi-partition needs an MPI build (-DUSE_MPI=1), ignoring", WARN);
+        mpi_partition_flag = 0;
+    }
+    if (rma_mode != RMA_NONE)
+        error("--rma needs an MPI build (-DUSE_MPI=1)", ERROR);
+#endif
+
+    if (rma_mode != RMA_NONE && backend != OPENMP && backend != SERIAL)
+        error("--rma is only supported with the OpenMP and Serial backends", ERROR);
+
+#ifndef USE_DSA
+    if (dsa_wq[0])
+        error("--dsa needs a DSA build (-DUSE_DSA=1)", ERROR);
+#endif
+    if (dsa_wq[0] && (backend != OPENMP || rma_mode != RMA_NONE))
+        error("--dsa is only supported by the OpenMP backend, without --rma", ERROR);
+    if (dsa_wq[0] && rate_mgs > 0)
+        error("--rate paces the Gathers of the CPU threads and can not be combined with --dsa", ERROR);
+
+    if ((sched_kind != SCHED_STATIC || busy_flag) && (backend != OPENMP || rma_mode != RMA_NONE)) {
+        error("--schedule and --busy-times are only supported by the OpenMP backend without --rma, ignoring", WARN);
+        sched_kind = SCHED_STATIC;
+        sched_chunk = 0;
+        busy_flag = 0;
+    }
+
+    if (corun_flag && (backend != OPENMP || rma_mode != RMA_NONE)) {
+        error("--co-run is only supported by the OpenMP backend without --rma, ignoring", WARN);
+        corun_flag = 0;
+    }
+
+    if (thread_sweep.policy != PIN_NONE && (backend != OPENMP || rma_mode != RMA_NONE || dsa_wq[0] || serve_addr[0])) {
+        error("--thread-sweep is only supported by the OpenMP backend without --rma, --dsa or --serve, ignoring", WARN);
+        thread_sweep.policy = PIN_NONE;
+    }
+
+    if (thread_sweep.policy != PIN_NONE && (corun_flag || rate_mgs > 0))
+        error("--thread-sweep can not be combined with --co-run or --rate, they place their own threads", ERROR);
+
+#ifdef USE_OPENMP
+    if (thread_sweep.policy != PIN_NONE && omp_get_proc_bind() != omp_proc_bind_false)
+        error("--thread-sweep with OMP_PROC_BIND set, the main thread may already be bound to fewer CPUs than the sweep pins to", WARN);
+#endif
+
+    if (cuda_graph_flag && backend != CUDA) {
+        error("--cuda-graph is only supported by the CUDA backend, ignoring", WARN);
+        cuda_graph_flag = 0;
+    }
+
+    if (cuda_graph_flag && (cuda_ndevs > 1 || cuda_streams > 1))
+        error("--cuda-graph can not be combined with --devices or --streams", ERROR);
+
+    if (autotune_flag && backend != CUDA) {
+        error("--autotune is only supported by the CUDA backend, ignoring", WARN);
+        autotune_flag = 0;
+    }
+
+    if (autotune_flag && validate_flag) {
+        error("--autotune does not record the last element for --validate, ignoring", WARN);
+        autotune_flag = 0;
+    }
+
+    if (autotune_flag && (cuda_graph_flag || cuda_ndevs > 1 || cuda_streams > 1))
+        error("--autotune can not be combined with --cuda-graph, --devices or --streams", ERROR);
+
+    if (min_sample_ms > 0 && ((backend != OPENMP && backend != SERIAL) || rma_mode != RMA_NONE)) {
+        error("--min-sample is only supported by the OpenMP and Serial backends without --rma, ignoring", WARN);
+        min_sample_ms = 0;
+    }
+
+    if (min_sample_ms > 0 && (energy_flag || papi->count > 0))
+        error("--min-sample can not be combined with --energy or --papi, they count every repetition of a run", ERROR);
+
+    if (cache_mode != CACHE_WARM && ((backend != OPENMP && backend != SERIAL) || rma_mode != RMA_NONE)) {
+        error("--cache is only supported by the OpenMP and Serial backends without --rma, ignoring", WARN);
+        cache_mode = CACHE_WARM;
+    }
+
+    if (cache_mode != CACHE_WARM && min_sample_ms > 0)
+        error("--cache=cold and --cache=flush can not be combined with --min-sample, only its first repetition would be cold", ERROR);
+
+    if (rate_mgs > 0 && (backend != OPENMP || rma_mode != RMA_NONE || serve_addr[0])) {
+        error("--rate is only supported by the OpenMP backend without --rma or --serve, ignoring", WARN);
+        rate_mgs = 0;
+    }
+
+    if (rate_mgs > 0 && min_sample_ms > 0)
+        error("--rate can not be combined with --min-sample, a paced run is already long", ERROR);
+
+    if (rate_mgs > 0 && sg_tick_ns() <= 0)
+        error("--rate needs an invariant TSC on x86-64 or cntvct_el0 on AArch64", ERROR);
+
+    if (noise_spec.kernel != NOISE_NONE && ((backend != OPENMP && backend != SERIAL) || rma_mode != RMA_NONE || serve_addr[0])) {
+        error("--noise is only supported by the OpenMP and Serial backends without --rma or --serve, ignoring", WARN);
+        noise_spec.kernel = NOISE_NONE;
+    }
+
+    if ((source_tier.n || target_tier.n) && backend != OPENMP && backend != SERIAL) {
+        error("--tier and --tier-target are only supported by the OpenMP and Serial backends, ignoring", WARN);
+        source_tier.n = target_tier.n = 0;
+    }
+
+    if (source_tier.n && (numa_mode == NUMA_INTERLEAVE || numa_mode == NUMA_REPLICATE))
+        error("--tier can not be combined with --numa=interleave or --numa=replicate, they place the source too", ERROR);
+
+    if (serve_addr[0] && backend != OPENMP && backend != SERIAL)
+        error("--serve is only supported by the OpenMP and Serial backends", ERROR);
+
+    if (serve_addr[0] && (output_format != OUTPUT_NONE || rma_mode != RMA_NONE || min_sample_ms > 0 || cache_mode != CACHE_WARM ||
+            energy_flag || papi->count > 0 || baseline_file[0] || shard_count > 0 || resume_file[0]))
+        error("--serve can not be combined with --output, --rma, --min-sample, --cache, --energy, --papi, --baseline, --shard or --resume", ERROR);
+
+    if (resume_file[0] && !strcmp(resume_file, output_file) && output_format != OUTPUT_JSON)
+        error("--resume appends to json output only, give --output=json:<file>", ERROR);
+
+    if ((compose_flag || inner_stream_flag) && (backend != OPENMP || rma_mode != RMA_NONE)) {
+        error("--compose and --inner-stream are only supported by the OpenMP backend without --rma, ignoring", WARN);
+        compose_flag = 0;
+        inner_stream_flag = 0;
+    }
+
+    if (compose_flag && inner_stream_flag)
+        error("--compose can not be combined with --inner-stream, a streamed inner pattern has nothing to compose", ERROR);
+
+    if (gpu_mem != GPU_MEM_DEVICE && backend != CUDA) {
+        error("--gpu-mem is only supported by the CUDA backend, ignoring", WARN);
+        gpu_mem = GPU_MEM_DEVICE;
+        gpu_hint = GPU_HINT_NONE;
+    }
+
+    if (gpu_mem != GPU_MEM_DEVICE && (cuda_ndevs > 1 || cuda_streams > 1))
+        error("--gpu-mem can not be combined with --devices or --streams", ERROR);
+
+    if (numa_mode == NUMA_REPLICATE && backend != OPENMP)
+        error("--numa=replicate is only supported by the OpenMP backend", ERROR);
+
+    if (resize_flag && backend != OPENMP && backend != SERIAL) {
+        error("--resize-buffers is only supported by the OpenMP and Serial backends, ignoring", WARN);
+        resize_flag = 0;
+    }
+
+    if (resize_flag && numa_mode == NUMA_REPLICATE)
+        error("--resize-buffers can not be combined with --numa=replicate", ERROR);
+
+    if (resize_flag && (source_tier.n || target_tier.n))
+        error("--resize-buffers can not be combined with --tier or --tier-target", ERROR);
+
+    if (resize_flag && rma_mode != RMA_NONE)
+        error("--resize-buffers can not be combined with --rma", ERROR);
+
+    if (sparse_source_flag && backend != OPENMP && backend != SERIAL)
+        error("--sparse-source is only supported by the OpenMP and Serial backends", ERROR);
+
+    if (sparse_source_flag && resize_flag) {
+        error("--resize-buffers has no effect with --sparse-source, which backs only the pages of each config, ignoring", WARN);
+        resize_flag = 0;
+    }
+
+    if (sparse_source_flag && (numa_mode == NUMA_REPLICATE || source_tier.n || rma_mode != RMA_NONE || corun_flag ||
+                cache_mode == CACHE_FLUSH || serve_addr[0]))
+        error("--sparse-source can not be combined with --numa=replicate, --tier, --rma, --co-run, --cache=flush or --serve", ERROR);
+
     if (!strcasecmp(kernel_file, "NONE") && backend == OPENCL)
     {
-        error("Kernel file unspecified, guessing kernels/kernels_vector.cl", WARN);
-        safestrcopy(kernel_file, "kernels/kernels_vector.cl");
+        error("Kernel file unspecified, guessing kernels/kernels_smallbuf.cl", WARN);
+        safestrcopy(kernel_file, "kernels/kernels_smallbuf.cl");
     }
 
     return;
 }
 
-void parse_p(char* optarg, struct run_config *rc, int mode)
+// --mpi-partition keeps this rank's share of the Gathers or Scatters
+static void partition_configs(struct run_config *rc, int nrc)
+{
+    int numpes = 1;
+    int pe = 0;
+#ifdef USE_MPI
+    MPI_Comm_rank(MPI_COMM_WORLD, &pe);
+    MPI_Comm_size(MPI_COMM_WORLD, &numpes);
+#endif
+
+    for (int i = 0; i < nrc; i++) {
+        if (rc[i].type == TRACE)
+            error("--mpi-partition does not support TRACE patterns", ERROR);
+        rc[i].generic_len = sp_mpi_share(rc[i].generic_len, pe, numpes);
+        if (rc[i].generic_len == 0)
+            error("--mpi-partition needs a count (-l) of at least one per rank", ERROR);
+    }
+}
+
+// Strong scaling keeps this rank's share of the pattern
+static void scale_pattern(ssize_t **pattern, spSize_t *pattern_len, int strong)
+{
+    if (strong) {
+        printf("Strong Scaling Enabled\n");
+        int numpes = 1;
+        int pe = 0;
+#ifdef USE_MPI
+        MPI_Comm_rank(MPI_COMM_WORLD, &pe);
+        MPI_Comm_size(MPI_COMM_WORLD, &numpes);
+#endif
+
+        size_t partition = *pattern_len / (size_t) numpes;
+	size_t new_length = partition;
+        if (pe == numpes - 1)
+            new_length += *pattern_len % (size_t) numpes;
+
+        ssize_t *trunc_pat = sp_malloc(sizeof(spIdx_t), new_length, ALIGN_CACHE);
+
+        for (size_t i = 0; i < new_length; ++i) {
+            trunc_pat[i] = (*pattern)[pe * partition + i];
+        }
+
+        free(*pattern);
+        *pattern = trunc_pat;
+        *pattern_len = new_length;
+    }
+
+    if (*pattern_len == 0)
+        error("Pattern length of 0", ERROR);
+}
+
+static void parse_pattern(char* optarg, struct run_config *rc, int mode, int strong)
 {
+    char *save = NULL;
     ssize_t **pattern;
     spSize_t *pattern_len;
     ssize_t *delta;
@@ -1080,6 +2542,69 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             rc->type = CONFIG_FILE;
         }
 
+        // Expanded into configs by parse_args before any pattern is parsed
+        else if (!strcmp(optarg, "MTX"))
+        {
+            error("MTX: only supported with -p on the command line", ERROR);
+        }
+
+        // Replay a binary trace of 64-bit indices, streamed in chunks
+        // TRACE:file[:chunk]
+        else if (!strcmp(optarg, "TRACE"))
+        {
+            if (mode != 0)
+                error("TRACE: only supported with -p", ERROR);
+            rc->type = TRACE;
+            rc->trace_chunk = SP_TRACE_CHUNK;
+
+            char *chunk = strrchr(arg, ':');
+            if (chunk && chunk[1] && strspn(chunk + 1, "0123456789") == strlen(chunk + 1))
+            {
+                *chunk = '\0';
+                if (sscanf(chunk + 1, "%zu", &rc->trace_chunk) < 1 || rc->trace_chunk == 0)
+                    error("TRACE: chunk size not parsed", ERROR);
+            }
+            if (!*arg)
+                error("TRACE: file not found", ERROR);
+            safestrcopy(rc->pattern_file, arg);
+
+            // Indices are wrapped to the boundary, which sizes the source.
+            // The single pattern entry only exists so the source is sized
+            // like any other pattern: boundary elements, no delta.
+            if (rc->boundary <= 0)
+                rc->boundary = SP_TRACE_SOURCE_LEN;
+            *pattern_len = 1;
+            *pattern = sp_malloc(sizeof(spIdx_t), *pattern_len, ALIGN_CACHE);
+            (*pattern)[0] = rc->boundary - 1;
+            *delta = 0;
+        }
+
+        // Stream the gathers of a graph kernel, replayed like a trace
+        // GRAPH:file:bfs|pagerank|spmv
+        else if (!strcmp(optarg, "GRAPH"))
+        {
+            if (mode != 0)
+                error("GRAPH: only supported with -p", ERROR);
+            char *algo = strrchr(arg, ':');
+            if (!algo || algo == arg)
+                error("GRAPH: expected GRAPH:<file>:<bfs|pagerank|spmv>", ERROR);
+            *algo++ = '\0';
+            rc->graph = sp_graph_algo_parse(algo);
+            if (rc->graph == GRAPH_NONE)
+                error("GRAPH: algorithm must be bfs, pagerank or spmv", ERROR);
+            rc->type = TRACE;
+            rc->trace_chunk = SP_TRACE_CHUNK;
+            safestrcopy(rc->pattern_file, arg);
+
+            // Vertex ids index the source unless a boundary wraps them
+            if (rc->boundary <= 0)
+                rc->boundary = sp_graph_vertices(arg);
+            *pattern_len = 1;
+            *pattern = sp_malloc(sizeof(spIdx_t), *pattern_len, ALIGN_CACHE);
+            (*pattern)[0] = rc->boundary - 1;
+            *delta = 0;
+        }
+
         // The Exxon Kernel Proxy-derived stencil
         // It used to be called HYDRO so we will accept that too
         // XKP:dim
@@ -1088,7 +2613,7 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             rc->type = XKP;
 
             size_t dim = 0;
-            char *dim_char = strtok(arg, ":");
+            char *dim_char = strtok_r(arg, ":", &save);
             if (!dim_char)
                 error("XKP: size not found", 1);
             if (sscanf(dim_char, "%zu", &dim) < 1)
@@ -1110,6 +2635,39 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             xkp_pattern(*pattern, dim);
         }
 
+        // A face or the whole of a 3D box, for PACK, UNPACK and TRANSPOSE
+        // BOX:nx:ny:nz:cell[:face]
+        else if (!strcmp(optarg, "BOX"))
+        {
+            if (mode != 0)
+                error("BOX: only supported with -p", ERROR);
+            rc->type = BOX;
+
+            for (int d = 0; d < 4; d++)
+            {
+                char *tok = strtok_r(d == 0 ? arg : NULL, ":", &save);
+                size_t *val = d < 3 ? &rc->box.dim[d] : &rc->box.cell;
+                if (!tok)
+                    error("BOX: expected BOX:<nx>:<ny>:<nz>:<cell elements>[:<face>]", ERROR);
+                if (sscanf(tok, "%zu", val) < 1 || *val < 1 || *val > SP_BOX_MAX_DIM)
+                    error("BOX: dimensions and cell elements must be between 1 and 65536", ERROR);
+            }
+
+            if ((double)rc->box.dim[0] * rc->box.dim[1] * rc->box.dim[2] * rc->box.cell > (double)SP_BOX_MAX_ELEMS)
+                error("BOX: more than 2^40 elements per box", ERROR);
+
+            rc->box.face = -1;
+            char *face = strtok_r(NULL, ":", &save);
+            if (face && (rc->box.face = sp_box_face_parse(face)) < 0)
+                error("BOX: face must be x-, x+, y-, y+, z- or z+", ERROR);
+
+            if (sp_box_len(&rc->box) > MAX_PATTERN_LEN)
+                error("BOX: more elements per box than the longest pattern", ERROR);
+            *pattern_len = sp_box_len(&rc->box);
+            *pattern = sp_malloc(sizeof(spIdx_t), *pattern_len, ALIGN_CACHE);
+            sp_box_pattern(&rc->box, *pattern);
+        }
+
         // Parse Uniform Stride Arguments, which are
         // UNIFORM:index_length:stride
         else if (!strcmp(optarg, "UNIFORM"))
@@ -1117,7 +2675,7 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             rc->type = UNIFORM;
 
             // Read the length
-            char *len = strtok(arg,":");
+            char *len = strtok_r(arg, ":", &save);
             if (!len)
                 error("UNIFORM: Index Length not found", 1);
             if (sscanf(len, "%zu", &(*pattern_len)) < 1)
@@ -1126,7 +2684,7 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             *pattern = sp_malloc(sizeof(spIdx_t), *pattern_len, ALIGN_CACHE);
 
             // Read the stride
-            char *stride = strtok(NULL, ":");
+            char *stride = strtok_r(NULL, ":", &save);
             ssize_t strideval = 0;
             if (!stride)
                 error("UNIFORM: Stride not found", 1);
@@ -1137,7 +2695,7 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             for (int i = 0; i < *pattern_len; i++)
                 (*pattern)[i] = i*strideval;
 
-            char *delta2 = strtok(NULL, ":");
+            char *delta2 = strtok_r(NULL, ":", &save);
             if (delta2)
             {
                 if (!*deltas) {
@@ -1169,21 +2727,21 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             rc->type = LAPLACIAN;
 
             // Read the dimension
-            char *dim = strtok(arg,":");
+            char *dim = strtok_r(arg, ":", &save);
             if (!dim)
                 error("LAPLACIAN: Dimension not found", 1);
             if (sscanf(dim, "%d", &dim_val) < 1)
                 error("LAPLACIAN: Dimension not parsed", 1);
 
             // Read the order
-            char *order = strtok(NULL, ":");
+            char *order = strtok_r(NULL, ":", &save);
             if (!order)
                 error("LAPLACIAN: Order not found", 1);
             if (sscanf(order, "%d", &order_val) < 1)
                 error("LAPLACIAN: Order not parsed", 1);
 
             // Read the problem size
-            char *problem_size = strtok(NULL, ":");
+            char *problem_size = strtok_r(NULL, ":", &save);
             if (!problem_size)
                 error("LAPLACIAN: Problem size not found", 1);
             if (sscanf(problem_size, "%d", &problem_size_val) < 1)
@@ -1210,9 +2768,9 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
         {
             rc->type = MS1;
 
-            char *len = strtok(arg,":");
-            char *breaks = strtok(NULL,":");
-            char *gaps = strtok(NULL,":");
+            char *len = strtok_r(arg, ":", &save);
+            char *breaks = strtok_r(NULL, ":", &save);
+            char *gaps = strtok_r(NULL, ":", &save);
 
             size_t *ms1_breaks = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
             size_t *ms1_deltas = sp_malloc(sizeof(size_t), MAX_PATTERN_LEN, ALIGN_CACHE);
@@ -1224,14 +2782,14 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
             *pattern = sp_malloc(sizeof(spIdx_t), *pattern_len, ALIGN_CACHE);
 
             // Parse breaks
-            char *ptr = strtok(breaks, ",");
+            char *ptr = strtok_r(breaks, ",", &save);
             size_t read = 0;
             if (!ptr)
                 error("MS1: Breaks missing", 1);
             if (sscanf(ptr, "%zu", &(ms1_breaks[read++])) < 1)
                 error("MS1: Failed to parse first break", 1);
 
-            while ((ptr = strtok(NULL, ",")) && read < MAX_PATTERN_LEN)
+            while ((ptr = strtok_r(NULL, ",", &save)) && read < MAX_PATTERN_LEN)
             {
                 if (sscanf(ptr, "%zu", &(ms1_breaks[read++])) < 1)
                     error("MS1: Failed to parse breaks", 1);
@@ -1245,14 +2803,14 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
                 error("error", ERROR);
             }
 
-            ptr = strtok(gaps, ",");
+            ptr = strtok_r(gaps, ",", &save);
             read = 0;
             if (ptr)
             {
                 if (sscanf(ptr, "%zu", &(ms1_deltas[read++])) < 1)
                     error("Failed to parse first delta", 1);
 
-                while ((ptr = strtok(NULL, ",")) && read < MAX_PATTERN_LEN)
+                while ((ptr = strtok_r(NULL, ",", &save)) && read < MAX_PATTERN_LEN)
                 {
                     if (sscanf(ptr, "%zu", &(ms1_deltas[read++])) < 1)
                         error("Failed to parse deltas", 1);
@@ -1294,14 +2852,14 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
         strcpy(copy_optarg, optarg);
 
         char *delim = ",";
-        char *ptr = strtok(copy_optarg, delim);
+        char *ptr = strtok_r(copy_optarg, delim, &save);
         if (!ptr)
             error("Pattern not found", 1);
 
         size_t sz = 0;
         while (ptr != NULL) {
           sz++;
-          ptr = strtok(NULL, delim);
+          ptr = strtok_r(NULL, delim, &save);
         }
         free(copy_optarg);
 
@@ -1318,13 +2876,13 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
 
         mypat = sp_malloc(sizeof(spIdx_t), psize, ALIGN_CACHE);
 
-        ptr = strtok(optarg, delim);
+        ptr = strtok_r(optarg, delim, &save);
 
         size_t read = 0;
         if (sscanf(ptr, "%zu", &(mypat[read++])) < 1)
             error("Failed to parse first pattern element in custom mode", 1);
 
-        while ((ptr = strtok(NULL, delim)) && read < psize)
+        while ((ptr = strtok_r(NULL, delim, &save)) && read < psize)
         {
             if (sscanf(ptr, "%zu", &(mypat[read++])) < 1)
                 error("Failed to parse pattern", 1);
@@ -1336,38 +2894,17 @@ void parse_p(char* optarg, struct run_config *rc, int mode)
         *pattern_len = read;
     }
 
-    if (strong_scale->count > 0 && strong_scale->ival[0] > 0) {
-        printf("Strong Scaling Enabled\n");
-        int numpes = 1;
-        int pe = 0;
-#ifdef USE_MPI
-        MPI_Comm_rank(MPI_COMM_WORLD, &pe);
-        MPI_Comm_size(MPI_COMM_WORLD, &numpes);
-#endif
-
-        size_t partition = *pattern_len / (size_t) numpes;
-	size_t new_length = partition;
-        if (pe == numpes - 1)
-            new_length += *pattern_len % (size_t) numpes;
-
-        ssize_t *trunc_pat = sp_malloc(sizeof(spIdx_t), new_length, ALIGN_CACHE);
-
-        for (size_t i = 0; i < new_length; ++i) {
-            trunc_pat[i] = (*pattern)[pe * partition + i];
-        }
-
-        free(*pattern);
-        *pattern = trunc_pat;
-        *pattern_len = new_length;
-    }
-
-    if (*pattern_len == 0)
-        error("Pattern length of 0", ERROR);
+    scale_pattern(pattern, pattern_len, strong);
 
     if (rc->type == INVALID_IDX)
         error("No pattern type set", ERROR);
 }
 
+void parse_p(char* optarg, struct run_config *rc, int mode)
+{
+    parse_pattern(optarg, rc, mode, strong_scale->count > 0 && strong_scale->ival[0] > 0);
+}
+
 ssize_t setincludes(size_t key, size_t* set, size_t set_len)
 {
     for (size_t i = 0; i < set_len; i++)
@@ -0,0 +1,215 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "pin.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+#endif
+
+struct sp_cpu
+{
+    int cpu;
+    int pkg;
+    int core; /**< core_id, then the rank of the core in its package */
+    int smt;  /**< rank of the CPU among the hardware threads of its core */
+};
+
+static int topology_id(int cpu, const char *what, int fallback)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, what);
+    FILE *f = fopen(path, "r");
+    int id;
+    if (!f)
+        return fallback;
+    if (fscanf(f, "%d", &id) != 1)
+        id = fallback;
+    fclose(f);
+    return id;
+}
+
+static int compare_core(const void *a, const void *b)
+{
+    const struct sp_cpu *x = (const struct sp_cpu *)a;
+    const struct sp_cpu *y = (const struct sp_cpu *)b;
+    if (x->pkg != y->pkg)
+        return x->pkg - y->pkg;
+    if (x->core != y->core)
+        return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+static int compare_compact(const void *a, const void *b)
+{
+    const struct sp_cpu *x = (const struct sp_cpu *)a;
+    const struct sp_cpu *y = (const struct sp_cpu *)b;
+    if (x->smt != y->smt)
+        return x->smt - y->smt;
+    return compare_core(a, b);
+}
+
+static int compare_spread(const void *a, const void *b)
+{
+    const struct sp_cpu *x = (const struct sp_cpu *)a;
+    const struct sp_cpu *y = (const struct sp_cpu *)b;
+    if (x->smt != y->smt)
+        return x->smt - y->smt;
+    if (x->core != y->core)
+        return x->core - y->core;
+    return x->pkg - y->pkg;
+}
+
+static int ncpus = -1;
+static int cpus[CPU_SETSIZE];
+static enum sp_pin_policy ordered = PIN_NONE;
+
+int sp_pin_cpus(void)
+{
+    if (ncpus >= 0)
+        return ncpus;
+    ncpus = 0;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &set))
+                cpus[ncpus++] = c;
+    } else {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int c = 0; c < online && c < CPU_SETSIZE; c++)
+            cpus[ncpus++] = c;
+    }
+    return ncpus;
+}
+
+// Sort the CPUs into the order of the policy
+static void order_cpus(enum sp_pin_policy policy)
+{
+    int n = sp_pin_cpus();
+    struct sp_cpu *t = (struct sp_cpu *)malloc(sizeof(struct sp_cpu) * n);
+    for (int i = 0; i < n; i++) {
+        t[i].cpu = cpus[i];
+        t[i].pkg = topology_id(cpus[i], "physical_package_id", 0);
+        t[i].core = topology_id(cpus[i], "core_id", cpus[i]);
+    }
+    qsort(t, n, sizeof(struct sp_cpu), compare_core);
+    // core_id becomes the rank of the core in its package
+    int prev_pkg = -1, prev_id = -1, rank = 0;
+    for (int i = 0; i < n; i++) {
+        int id = t[i].core;
+        if (t[i].pkg != prev_pkg)
+            rank = 0;
+        else if (id != prev_id)
+            rank++;
+        t[i].smt = t[i].pkg == prev_pkg && id == prev_id ? t[i - 1].smt + 1 : 0;
+        t[i].core = rank;
+        prev_pkg = t[i].pkg;
+        prev_id = id;
+    }
+    qsort(t, n, sizeof(struct sp_cpu), policy == PIN_SPREAD ? compare_spread : compare_compact);
+    for (int i = 0; i < n; i++)
+        cpus[i] = t[i].cpu;
+    free(t);
+    ordered = policy;
+}
+
+static int add_count(struct sp_thread_sweep *sweep, long v)
+{
+    if (v < 1 || sweep->n == SP_MAX_THREAD_SWEEP)
+        return -1;
+    sweep->threads[sweep->n++] = (size_t)v;
+    return 0;
+}
+
+static int compare_size(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int sp_thread_sweep_parse(const char *arg, struct sp_thread_sweep *sweep)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", arg);
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->policy = PIN_COMPACT;
+    char *colon = strchr(buf, ':');
+    if (colon) {
+        *colon = '\0';
+        if (!strcasecmp(colon + 1, "spread"))
+            sweep->policy = PIN_SPREAD;
+        else if (strcasecmp(colon + 1, "compact"))
+            return -1;
+    }
+
+    int fill = 0; // a .. waits for the count after it
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (!strcmp(tok, "..")) {
+            if (fill || sweep->n < 2)
+                return -1;
+            fill = 1;
+            continue;
+        }
+        char *end;
+        long v = !strcasecmp(tok, "max") ? sp_pin_cpus() : strtol(tok, &end, 10);
+        if (strcasecmp(tok, "max") && *end)
+            return -1;
+        if (fill) {
+            size_t a = sweep->threads[sweep->n - 2], b = sweep->threads[sweep->n - 1];
+            if (b <= a)
+                return -1;
+            int geometric = b % a == 0 && b / a > 1;
+            for (size_t x = geometric ? b * (b / a) : 2 * b - a; x < (size_t)v; x = geometric ? x * (b / a) : x + b - a)
+                if (add_count(sweep, x))
+                    return -1;
+            fill = 0;
+        }
+        if (add_count(sweep, v))
+            return -1;
+    }
+    if (fill || sweep->n == 0)
+        return -1;
+
+    qsort(sweep->threads, sweep->n, sizeof(size_t), compare_size);
+    int n = 1;
+    for (int i = 1; i < sweep->n; i++)
+        if (sweep->threads[i] != sweep->threads[n - 1])
+            sweep->threads[n++] = sweep->threads[i];
+    sweep->n = n;
+    return 0;
+}
+
+int sp_thread_sweep_knee(const double *mbs, int n)
+{
+    double best = 0;
+    for (int i = 0; i < n; i++)
+        if (mbs[i] > best)
+            best = mbs[i];
+    for (int i = 0; i < n; i++)
+        if (mbs[i] >= SP_KNEE_FRACTION * best)
+            return i;
+    return n - 1;
+}
+
+#ifdef USE_OPENMP
+void sp_pin_team(enum sp_pin_policy policy, int nthreads)
+{
+    if (policy != ordered)
+        order_cpus(policy);
+    #pragma omp parallel num_threads(nthreads)
+    {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[omp_get_thread_num() % ncpus], &one);
+        pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+    }
+}
+#endif
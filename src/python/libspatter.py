@@ -0,0 +1,104 @@
+# ctypes bindings for libspatter (src/include/spatter.h)
+#
+#   import libspatter
+#   sp = libspatter.Spatter('build/libspatter.so')
+#   with sp.suite(['-pUNIFORM:8:1', '-pUNIFORM:8:4', '-l1048576']) as suite:
+#       for k, r in enumerate(suite.run_all()):
+#           print(k, r.min_ms, r.bw_mbs)
+#
+# The buffers of a suite stay allocated and warm between runs, run() can
+# also be called on configs of another suite as long as they fit.
+import ctypes
+import os
+
+# enum sg_backend in parse-args.h
+OPENMP = 1
+SERIAL = 3
+DEFAULT_BACKEND = 4  # INVALID_BACKEND, the one the arguments chose
+
+
+class Result(ctypes.Structure):
+    _fields_ = [('bytes', ctypes.c_size_t),
+                ('runs', ctypes.c_size_t),
+                ('min_ms', ctypes.c_double),
+                ('median_ms', ctypes.c_double),
+                ('max_ms', ctypes.c_double),
+                ('bw_mbs', ctypes.c_double)]
+
+    def __repr__(self):
+        return 'Result(bytes={}, runs={}, min_ms={:g}, median_ms={:g}, max_ms={:g}, bw_mbs={:g})'.format(
+            self.bytes, self.runs, self.min_ms, self.median_ms, self.max_ms, self.bw_mbs)
+
+
+class Spatter:
+    def __init__(self, path=None):
+        if path is None:
+            path = os.environ.get('LIBSPATTER', 'libspatter.so')
+        lib = ctypes.CDLL(path)
+        lib.sp_config_parse.restype = ctypes.c_void_p
+        lib.sp_config_parse.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_char_p)]
+        lib.sp_config_parse_json.restype = ctypes.c_void_p
+        lib.sp_config_parse_json.argtypes = [ctypes.c_char_p]
+        lib.sp_config_count.restype = ctypes.c_int
+        lib.sp_config_count.argtypes = [ctypes.c_void_p]
+        lib.sp_config_free.argtypes = [ctypes.c_void_p]
+        lib.sp_buffers_create.restype = ctypes.c_void_p
+        lib.sp_buffers_create.argtypes = [ctypes.c_void_p]
+        lib.sp_buffers_destroy.argtypes = [ctypes.c_void_p]
+        lib.sp_run.restype = ctypes.c_int
+        lib.sp_run.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.POINTER(Result)]
+        self.lib = lib
+
+    def parse(self, args):
+        """Parse spatter arguments, without argv[0], into a suite handle"""
+        argv = [b'spatter'] + [a.encode() for a in args]
+        c_argv = (ctypes.c_char_p * len(argv))(*argv)
+        suite = self.lib.sp_config_parse(len(argv), c_argv)
+        if not suite:
+            raise ValueError('No run configurations parsed from {}'.format(args))
+        return suite
+
+    def parse_json(self, text):
+        """Parse a json config, or an array of them, into a suite handle"""
+        suite = self.lib.sp_config_parse_json(text.encode())
+        if not suite:
+            raise ValueError('No run configurations parsed from {}'.format(text))
+        return suite
+
+    def suite(self, args):
+        return Suite(self, self.parse(args))
+
+
+class Suite:
+    """Parsed configs with buffers sized for them"""
+
+    def __init__(self, sp, handle):
+        self.sp = sp
+        self.handle = handle
+        self.buffers = sp.lib.sp_buffers_create(handle)
+
+    def __len__(self):
+        return self.sp.lib.sp_config_count(self.handle)
+
+    def run(self, k, backend=DEFAULT_BACKEND, suite=None):
+        """Time config k, of this suite or of suite, on these buffers"""
+        r = Result()
+        handle = suite.handle if suite else self.handle
+        if self.sp.lib.sp_run(self.buffers, handle, k, backend, ctypes.byref(r)) != 0:
+            raise ValueError('Config {} does not fit the buffers or the backend is not built in'.format(k))
+        return r
+
+    def run_all(self, backend=DEFAULT_BACKEND):
+        return [self.run(k, backend) for k in range(len(self))]
+
+    def close(self):
+        if self.handle:
+            self.sp.lib.sp_buffers_destroy(self.buffers)
+            self.sp.lib.sp_config_free(self.handle)
+            self.handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "reuse.h"
+#include "sp-run.h"
+#include "traffic.h"
+#include "cache-flush.h"
+#include "sp_rand.h"
+
+// Bits of the hash compared with the sampling threshold
+#define HASH_BITS 24
+#define FULL_RATE ((uint64_t)1 << HASH_BITS)
+
+// Hash table slots and Fenwick tree times per tracked key
+#define SLOTS_PER_KEY 4
+#define TIMES_PER_KEY 4
+
+#define EMPTY UINT64_MAX
+
+// The dense buffer and the scatter side of GS are apart from the source
+#define DENSE_SPACE ((uint64_t)1 << 56)
+#define SCATTER_SPACE ((uint64_t)2 << 56)
+
+// The tracked keys of one profile, each with the time of its last
+// reference, and a Fenwick tree over the times that has a 1 at the last
+// reference of every key. The keys touched since a time are the sum of the
+// tree after it.
+struct sp_stack
+{
+    uint64_t *key;
+    uint64_t *hash;
+    size_t *last;
+    size_t slots, n;
+    uint64_t threshold; // keys whose hash is below are sampled
+    int64_t *tree;
+    size_t times, now;
+};
+
+struct sp_time_slot
+{
+    size_t last, slot;
+};
+
+static uint64_t key_hash(uint64_t key)
+{
+    return sp_rand_at(0x5ea5, key) >> (64 - HASH_BITS);
+}
+
+static size_t find(const struct sp_stack *s, uint64_t key)
+{
+    size_t x = (size_t)(sp_rand_at(0, key) & (s->slots - 1));
+    while (s->key[x] != EMPTY && s->key[x] != key)
+        x = (x + 1) & (s->slots - 1);
+    return x;
+}
+
+static void tree_add(struct sp_stack *s, size_t t, int64_t v)
+{
+    for (t++; t <= s->times; t += t & -t)
+        s->tree[t] += v;
+}
+
+// Marks at times before t
+static int64_t tree_sum(const struct sp_stack *s, size_t t)
+{
+    int64_t v = 0;
+    for (; t > 0; t -= t & -t)
+        v += s->tree[t];
+    return v;
+}
+
+static void stack_init(struct sp_stack *s)
+{
+    s->slots = SLOTS_PER_KEY * SP_REUSE_TRACKED;
+    s->key = (uint64_t *)malloc(s->slots * sizeof(uint64_t));
+    s->hash = (uint64_t *)malloc(s->slots * sizeof(uint64_t));
+    s->last = (size_t *)malloc(s->slots * sizeof(size_t));
+    for (size_t x = 0; x < s->slots; x++)
+        s->key[x] = EMPTY;
+    s->n = 0;
+    s->threshold = FULL_RATE;
+    s->times = TIMES_PER_KEY * SP_REUSE_TRACKED;
+    s->tree = (int64_t *)calloc(s->times + 1, sizeof(int64_t));
+    s->now = 0;
+}
+
+static void stack_free(struct sp_stack *s)
+{
+    free(s->key);
+    free(s->hash);
+    free(s->last);
+    free(s->tree);
+}
+
+static int compare_time(const void *a, const void *b)
+{
+    size_t x = ((const struct sp_time_slot *)a)->last;
+    size_t y = ((const struct sp_time_slot *)b)->last;
+    return (x > y) - (x < y);
+}
+
+// Out of times: number the last references again from 0, in order
+static void stack_compact(struct sp_stack *s)
+{
+    struct sp_time_slot *ts = (struct sp_time_slot *)malloc(s->n * sizeof(struct sp_time_slot));
+    size_t m = 0;
+    for (size_t x = 0; x < s->slots; x++)
+        if (s->key[x] != EMPTY)
+            ts[m++] = (struct sp_time_slot){s->last[x], x};
+    qsort(ts, m, sizeof(struct sp_time_slot), compare_time);
+    memset(s->tree, 0, (s->times + 1) * sizeof(int64_t));
+    for (size_t t = 0; t < m; t++) {
+        s->last[ts[t].slot] = t;
+        tree_add(s, t, 1);
+    }
+    s->now = m;
+    free(ts);
+}
+
+// Too many keys: halve the rate until they fit, dropping the keys above it
+static void stack_shrink(struct sp_stack *s)
+{
+    while (s->n > SP_REUSE_TRACKED) {
+        s->threshold /= 2;
+        uint64_t *key = s->key, *hash = s->hash;
+        size_t *last = s->last;
+        s->key = (uint64_t *)malloc(s->slots * sizeof(uint64_t));
+        s->hash = (uint64_t *)malloc(s->slots * sizeof(uint64_t));
+        s->last = (size_t *)malloc(s->slots * sizeof(size_t));
+        for (size_t x = 0; x < s->slots; x++)
+            s->key[x] = EMPTY;
+        s->n = 0;
+        for (size_t x = 0; x < s->slots; x++) {
+            if (key[x] == EMPTY)
+                continue;
+            if (hash[x] >= s->threshold) {
+                tree_add(s, last[x], -1);
+                continue;
+            }
+            size_t y = find(s, key[x]);
+            s->key[y] = key[x];
+            s->hash[y] = hash[x];
+            s->last[y] = last[x];
+            s->n++;
+        }
+        free(key);
+        free(hash);
+        free(last);
+    }
+}
+
+// Reuse distance of a reference to key: the keys touched since the last
+// reference to it, scaled up by the rate. -1 for its first reference, -2
+// if key is not sampled.
+static double stack_access(struct sp_stack *s, uint64_t key)
+{
+    uint64_t h = key_hash(key);
+    if (h >= s->threshold)
+        return -2;
+    size_t x = find(s, key);
+    double d = -1;
+    if (s->key[x] == key) {
+        d = (double)(tree_sum(s, s->now) - tree_sum(s, s->last[x] + 1)) * FULL_RATE / s->threshold;
+        tree_add(s, s->last[x], -1);
+    } else {
+        s->key[x] = key;
+        s->hash[x] = h;
+        s->n++;
+    }
+    s->last[x] = s->now;
+    tree_add(s, s->now, 1);
+    if (++s->now == s->times)
+        stack_compact(s);
+    if (s->n > SP_REUSE_TRACKED)
+        stack_shrink(s);
+    return d;
+}
+
+// The sums of a profile, each sampled reference weighted by the inverse
+// of the rate it was sampled at
+struct profile
+{
+    struct sp_stack lines, pages;
+    size_t line, page;
+    size_t cap[SP_REUSE_LEVELS];
+    int record; // the pass that is profiled
+    double refs, weight, page_weight;
+    double hist[SP_REUSE_BINS], cold, miss[SP_REUSE_LEVELS];
+};
+
+static int bin_of(double d)
+{
+    int b = 0;
+    while (d >= 1 && b < SP_REUSE_BINS - 1) {
+        d /= 2;
+        b++;
+    }
+    return b;
+}
+
+// A reference to the element of elem bytes at addr
+static void reference(struct profile *p, uint64_t addr, size_t elem)
+{
+    for (uint64_t l = addr / p->line; l <= (addr + elem - 1) / p->line; l++) {
+        double d = stack_access(&p->lines, l);
+        if (d == -2 || !p->record)
+            continue;
+        double w = (double)FULL_RATE / p->lines.threshold;
+        p->weight += w;
+        if (d < 0)
+            p->cold += w;
+        else
+            p->hist[bin_of(d)] += w;
+        for (int v = REUSE_L1; v <= REUSE_LLC; v++)
+            if (d < 0 || d >= p->cap[v])
+                p->miss[v] += w;
+    }
+    double d = stack_access(&p->pages, addr / p->page);
+    if (d != -2 && p->record) {
+        double w = (double)FULL_RATE / p->pages.threshold;
+        p->page_weight += w;
+        if (d < 0 || d >= p->cap[REUSE_TLB])
+            p->miss[REUSE_TLB] += w;
+    }
+    p->refs += p->record;
+}
+
+size_t sp_reuse_capacity(enum sp_reuse_level level, size_t threads)
+{
+    switch (level) {
+    case REUSE_L1:
+        return sp_l1_size() / sp_line_size();
+    case REUSE_L2:
+        return sp_l2_size() / sp_line_size();
+    case REUSE_LLC:
+        return sp_llc_size() / sp_line_size() / (threads ? threads : 1);
+    default:
+        return SP_TLB_ENTRIES;
+    }
+}
+
+// The j-th index of Gather or Scatter i of a Multi kernel, through the
+// inner pattern or its stream
+static ssize_t multi_index(const struct run_config *rc, const ssize_t *inner, size_t len, size_t i, size_t j)
+{
+    return rc->pattern[rc->inner_stream ? rc->inner_stream[i * len + j] : inner[j]];
+}
+
+// Gathers or Scatters [0, n) of rc, element by element in the order of its
+// kernel: the sparse side and the slot of the dense one of each entry, or
+// both sparse sides of GS
+static void stream(struct profile *p, const struct run_config *rc, size_t n)
+{
+    size_t wrap = rc->wrap ? rc->wrap : 1;
+    size_t es = sp_elem_size(rc);
+    for (size_t i = 0; i < n; i++) {
+        switch (rc->kernel) {
+        case GATHER:
+        case SCATTER: {
+            size_t b = sp_config_base(rc, rc->delta, i, rc->generic_len);
+            for (size_t j = 0; j < rc->pattern_len; j++) {
+                uint64_t dense = DENSE_SPACE + ((i % wrap) * rc->pattern_len + j) * es;
+                if (rc->kernel == SCATTER)
+                    reference(p, dense, es);
+                reference(p, (b + rc->pattern[j]) * es, es);
+                if (rc->kernel == GATHER)
+                    reference(p, dense, es);
+            }
+            break;
+        }
+        case MULTIGATHER:
+        case MULTISCATTER: {
+            int gather = rc->kernel == MULTIGATHER;
+            const ssize_t *inner = gather ? rc->pattern_gather : rc->pattern_scatter;
+            size_t len = gather ? rc->pattern_gather_len : rc->pattern_scatter_len;
+            size_t b = sp_config_base(rc, rc->delta, i, rc->generic_len);
+            for (size_t j = 0; j < len; j++) {
+                uint64_t dense = DENSE_SPACE + ((i % wrap) * len + j) * sizeof(sgData_t);
+                if (!gather)
+                    reference(p, dense, sizeof(sgData_t));
+                reference(p, (b + multi_index(rc, inner, len, i, j)) * sizeof(sgData_t), sizeof(sgData_t));
+                if (gather)
+                    reference(p, dense, sizeof(sgData_t));
+            }
+            break;
+        }
+        case GS: {
+            size_t bg = sp_config_base(rc, rc->delta_gather, i, rc->generic_len);
+            size_t bs = sp_config_base(rc, rc->delta_scatter, i, rc->generic_len);
+            for (size_t j = 0; j < rc->pattern_scatter_len; j++) {
+                reference(p, (bg + rc->pattern_gather[j % rc->pattern_gather_len]) * sizeof(sgData_t), sizeof(sgData_t));
+                reference(p, SCATTER_SPACE + (bs + rc->pattern_scatter[j]) * sizeof(sgData_t), sizeof(sgData_t));
+            }
+            break;
+        }
+        default:
+            return;
+        }
+    }
+}
+
+void sp_reuse_analyze(const struct run_config *rc, struct sp_reuse *r)
+{
+    memset(r, 0, sizeof(*r));
+    if (rc->type == TRACE || rc->kernel == CHASE || rc->generic_len == 0)
+        return;
+    size_t per = rc->kernel == GS ? 2 * rc->pattern_scatter_len :
+        rc->kernel == MULTIGATHER ? 2 * rc->pattern_gather_len :
+        rc->kernel == MULTISCATTER ? 2 * rc->pattern_scatter_len : 2 * rc->pattern_len;
+    if (per == 0)
+        return;
+
+    struct profile *p = (struct profile *)calloc(1, sizeof(struct profile));
+    stack_init(&p->lines);
+    stack_init(&p->pages);
+    p->line = sp_line_size();
+    p->page = (size_t)sysconf(_SC_PAGESIZE);
+    for (int v = 0; v < SP_REUSE_LEVELS; v++)
+        p->cap[v] = sp_reuse_capacity((enum sp_reuse_level)v, rc->omp_threads);
+
+    // A run that fits is profiled warm, after one pass, like the timed runs
+    size_t n = rc->generic_len;
+    if (n * per <= SP_REUSE_REFS) {
+        stream(p, rc, n);
+    } else {
+        n = SP_REUSE_REFS / per;
+        if (n < 1)
+            n = 1;
+    }
+    p->record = 1;
+    stream(p, rc, n);
+
+    r->refs = p->refs;
+    r->rate = (double)p->lines.threshold / FULL_RATE;
+    if (p->weight > 0) {
+        for (int b = 0; b < SP_REUSE_BINS; b++)
+            r->hist[b] = p->hist[b] / p->weight;
+        r->cold = p->cold / p->weight;
+        for (int v = REUSE_L1; v <= REUSE_LLC; v++)
+            r->miss[v] = p->miss[v] / p->weight;
+    }
+    if (p->page_weight > 0)
+        r->miss[REUSE_TLB] = p->miss[REUSE_TLB] / p->page_weight;
+    stack_free(&p->lines);
+    stack_free(&p->pages);
+    free(p);
+}
@@ -1,5 +1,10 @@
 #include "serial-kernels.h"
+#include "sp_rand.h"
+#include "fixed-len.h"
+#include "chase.h"
 #include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
 
 void multigather_smallbuf_serial(
         sgData_t** restrict target,
@@ -45,6 +50,165 @@ void multiscatter_smallbuf_serial(
         }
 }
 
+void multigather_smallbuf_morton_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint32_t *order) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *sl = source + delta * order[i];
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[outer_pat[inner_pat[j]]];
+        }
+    }
+}
+
+void multiscatter_smallbuf_morton_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *tl = target + delta * order[i];
+        sgData_t *sl = source[0] + pat_len*(i%source_len);
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[outer_pat[inner_pat[j]]] = sl[j];
+        }
+    }
+}
+
+void multigather_smallbuf_random_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        long initstate) {
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = sp_rand_bounded(initstate, i, (uint32_t)n);
+        sgData_t *sl = source + delta * r;
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[outer_pat[inner_pat[j]]];
+        }
+    }
+}
+
+void multiscatter_smallbuf_random_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        long initstate) {
+    if (n > 1ll<<32) {printf("n too big for rng, exiting.\n"); exit(1);}
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = sp_rand_bounded(initstate, i, (uint32_t)n);
+        sgData_t *tl = target + delta * r;
+        sgData_t *sl = source[0] + pat_len*(i%source_len);
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[outer_pat[inner_pat[j]]] = sl[j];
+        }
+    }
+}
+
+void multigather_smallbuf_multidelta_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t *delta,
+        size_t n,
+        size_t target_len,
+        size_t delta_len) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *sl = source + (i/delta_len)*delta[delta_len-1] + delta[i%delta_len] - delta[0];
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[outer_pat[inner_pat[j]]];
+        }
+    }
+}
+
+// Gather and scatter specialized on the pattern length, see fixed-len.h
+#define GATHER_SMALLBUF_SERIAL_FIXED(V) \
+static void gather_smallbuf_serial_##V( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    ssize_t p[V]; \
+    for (size_t j = 0; j < V; j++) \
+        p[j] = pat[j]; \
+    for (size_t i = 0; i < n; i++) { \
+        sgData_t *sl = source + delta * i; \
+        sgData_t *tl = target[0] + V*(i%target_len); \
+        SP_UNROLL \
+        for (size_t j = 0; j < V; j++) { \
+            tl[j] = sl[p[j]]; \
+        } \
+    } \
+}
+
+#define SCATTER_SMALLBUF_SERIAL_FIXED(V) \
+static void scatter_smallbuf_serial_##V( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    ssize_t p[V]; \
+    for (size_t j = 0; j < V; j++) \
+        p[j] = pat[j]; \
+    for (size_t i = 0; i < n; i++) { \
+        sgData_t *tl = target + delta * i; \
+        sgData_t *sl = source[0] + V*(i%source_len); \
+        SP_UNROLL \
+        for (size_t j = 0; j < V; j++) { \
+            tl[p[j]] = sl[j]; \
+        } \
+    } \
+}
+
+SP_FOREACH_FIXED_LEN(GATHER_SMALLBUF_SERIAL_FIXED)
+SP_FOREACH_FIXED_LEN(SCATTER_SMALLBUF_SERIAL_FIXED)
+
 //Small index buffer version of gather
 void gather_smallbuf_serial(
         sgData_t** restrict target,
@@ -55,6 +219,17 @@ void gather_smallbuf_serial(
         size_t n,
         size_t target_len) {
 
+    switch (pat_len) {
+#define GATHER_SMALLBUF_SERIAL_CASE(V) \
+    case V: \
+        gather_smallbuf_serial_##V(target, source, pat, delta, n, target_len); \
+        return;
+    SP_FOREACH_FIXED_LEN(GATHER_SMALLBUF_SERIAL_CASE)
+#undef GATHER_SMALLBUF_SERIAL_CASE
+    default:
+        break;
+    }
+
     for (size_t i = 0; i < n; i++) {
            sgData_t *sl = source + delta * i;
            //Pick which 8 elements are written to in a way that 
@@ -80,6 +255,17 @@ void scatter_smallbuf_serial(
         size_t n,
         size_t source_len) {
 
+    switch (pat_len) {
+#define SCATTER_SMALLBUF_SERIAL_CASE(V) \
+    case V: \
+        scatter_smallbuf_serial_##V(target, source, pat, delta, n, source_len); \
+        return;
+    SP_FOREACH_FIXED_LEN(SCATTER_SMALLBUF_SERIAL_CASE)
+#undef SCATTER_SMALLBUF_SERIAL_CASE
+    default:
+        break;
+    }
+
     for (size_t i = 0; i < n; i++) {
            sgData_t *tl = target + delta * i;
            sgData_t *sl = source[0] + pat_len*(i%source_len);
@@ -93,6 +279,403 @@ void scatter_smallbuf_serial(
         }
 }
 
+void gather_smallbuf_morton_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint32_t *order) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *sl = source + delta * order[i];
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+#ifndef __clang__
+        #pragma novector
+#endif
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[pat[j]];
+        }
+    }
+}
+
+void scatter_smallbuf_morton_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *tl = target + delta * order[i];
+        sgData_t *sl = source[0] + pat_len*(i%source_len);
+
+#ifndef __clang__
+        #pragma novector
+#endif
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[pat[j]] = sl[j];
+        }
+    }
+}
+
+void gather_smallbuf_random_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        long initstate,
+        const uint32_t *bases) {
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = bases ? bases[i] : sp_rand_bounded(initstate, i, (uint32_t)n);
+        sgData_t *sl = source + delta * r;
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+#ifndef __clang__
+        #pragma novector
+#endif
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[pat[j]];
+        }
+    }
+}
+
+void scatter_smallbuf_random_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        long initstate,
+        const uint32_t *bases) {
+    if (n > 1ll<<32) {printf("n too big for rng, exiting.\n"); exit(1);}
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = bases ? bases[i] : sp_rand_bounded(initstate, i, (uint32_t)n);
+        sgData_t *tl = target + delta * r;
+        sgData_t *sl = source[0] + pat_len*(i%source_len);
+
+#ifndef __clang__
+        #pragma novector
+#endif
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[pat[j]] = sl[j];
+        }
+    }
+}
+
+void gather_smallbuf_multidelta_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t *delta,
+        size_t n,
+        size_t target_len,
+        size_t delta_len) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *sl = source + (i/delta_len)*delta[delta_len-1] + delta[i%delta_len] - delta[0];
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+
+#ifndef __clang__
+        #pragma novector
+#endif
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[j] = sl[pat[j]];
+        }
+    }
+}
+
+// Software prefetch for --prefetch-distance. __builtin_prefetch needs its
+// write and locality arguments as constants.
+#define SP_PREFETCH(p, rw, nta) \
+    do { \
+        if (nta) \
+            __builtin_prefetch((p), (rw), 0); \
+        else \
+            __builtin_prefetch((p), (rw), 3); \
+    } while (0)
+
+// The pattern indices to prefetch: the first index of every run of the
+// pattern within one 64-byte line, or only pat[0] for --prefetch-scope=line
+static size_t prefetch_offsets_serial(const ssize_t *pat, size_t pat_len, int line_only, ssize_t *pf)
+{
+    const ssize_t elems = 64 / sizeof(sgData_t);
+    size_t m = 0;
+    for (size_t j = 0; j < pat_len; j++) {
+        if (m && line_only)
+            break;
+        if (!m || pat[j] < pf[m - 1] || pat[j] >= pf[m - 1] + elems)
+            pf[m++] = pat[j];
+    }
+    return m;
+}
+
+// Single-core peak: Gather i + distance is prefetched while Gather i runs,
+// four pattern entries at a time so their loads are independent
+void gather_smallbuf_prefetch_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t distance,
+        int line_only,
+        int nta) {
+    ssize_t *pf = (ssize_t *)malloc(sizeof(ssize_t) * (pat_len ? pat_len : 1));
+    size_t pf_len = prefetch_offsets_serial(pat, pat_len, line_only, pf);
+    size_t pat_len4 = pat_len & ~(size_t)3;
+
+    for (size_t i = 0; i < n; i++) {
+        if (i + distance < n) {
+            sgData_t *pl = source + delta * (i + distance);
+            for (size_t k = 0; k < pf_len; k++)
+                SP_PREFETCH(pl + pf[k], 0, nta);
+        }
+        sgData_t *sl = source + delta * i;
+        sgData_t *tl = target[0] + pat_len*(i%target_len);
+        size_t j = 0;
+        for (; j < pat_len4; j += 4) {
+            sgData_t v0 = sl[pat[j]];
+            sgData_t v1 = sl[pat[j+1]];
+            sgData_t v2 = sl[pat[j+2]];
+            sgData_t v3 = sl[pat[j+3]];
+            tl[j] = v0;
+            tl[j+1] = v1;
+            tl[j+2] = v2;
+            tl[j+3] = v3;
+        }
+        for (; j < pat_len; j++) {
+            tl[j] = sl[pat[j]];
+        }
+    }
+    free(pf);
+}
+
+void scatter_smallbuf_prefetch_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t distance,
+        int line_only,
+        int nta) {
+    ssize_t *pf = (ssize_t *)malloc(sizeof(ssize_t) * (pat_len ? pat_len : 1));
+    size_t pf_len = prefetch_offsets_serial(pat, pat_len, line_only, pf);
+    size_t pat_len4 = pat_len & ~(size_t)3;
+
+    for (size_t i = 0; i < n; i++) {
+        if (i + distance < n) {
+            sgData_t *pl = target + delta * (i + distance);
+            for (size_t k = 0; k < pf_len; k++)
+                SP_PREFETCH(pl + pf[k], 1, nta);
+        }
+        sgData_t *tl = target + delta * i;
+        sgData_t *sl = source[0] + pat_len*(i%source_len);
+        size_t j = 0;
+        for (; j < pat_len4; j += 4) {
+            tl[pat[j]] = sl[j];
+            tl[pat[j+1]] = sl[j+1];
+            tl[pat[j+2]] = sl[j+2];
+            tl[pat[j+3]] = sl[j+3];
+        }
+        for (; j < pat_len; j++) {
+            tl[pat[j]] = sl[j];
+        }
+    }
+    free(pf);
+}
+
+// Gather and Scatter of the --elem types, the pattern and delta count
+// elements of T
+#define ELEM_SMALLBUF_SERIAL(T, NAME) \
+static void gather_elem_serial_##NAME( \
+        sgData_t** restrict target, \
+        sgData_t* const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t target_len) { \
+    for (size_t i = 0; i < n; i++) { \
+        const T *sl = (const T *)source + delta * i; \
+        T *tl = (T *)target[0] + pat_len*(i%target_len); \
+        for (size_t j = 0; j < pat_len; j++) \
+            tl[j] = sl[pat[j]]; \
+    } \
+} \
+static void scatter_elem_serial_##NAME( \
+        sgData_t* restrict target, \
+        sgData_t** const restrict source, \
+        ssize_t* const restrict pat, \
+        size_t pat_len, \
+        size_t delta, \
+        size_t n, \
+        size_t source_len) { \
+    for (size_t i = 0; i < n; i++) { \
+        T *tl = (T *)target + delta * i; \
+        const T *sl = (const T *)source[0] + pat_len*(i%source_len); \
+        for (size_t j = 0; j < pat_len; j++) \
+            tl[pat[j]] = sl[j]; \
+    } \
+}
+
+ELEM_SMALLBUF_SERIAL(float, f32)
+ELEM_SMALLBUF_SERIAL(int32_t, i32)
+ELEM_SMALLBUF_SERIAL(int64_t, i64)
+ELEM_SMALLBUF_SERIAL(sgC64_t, c64)
+
+void gather_smallbuf_elem_serial(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    switch (elem) {
+        case ELEM_F32:
+            gather_elem_serial_f32(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_I32:
+            gather_elem_serial_i32(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_I64:
+            gather_elem_serial_i64(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_C64:
+            gather_elem_serial_c64(target, source, pat, pat_len, delta, n, target_len);
+            return;
+        case ELEM_BYTES:
+            for (size_t i = 0; i < n; i++) {
+                const char *sl = (const char *)source + delta * i * elem_size;
+                char *tl = (char *)target[0] + pat_len*(i%target_len) * elem_size;
+                for (size_t j = 0; j < pat_len; j++)
+                    memcpy(tl + j * elem_size, sl + pat[j] * elem_size, elem_size);
+            }
+            return;
+        default:
+            gather_smallbuf_serial(target, source, pat, pat_len, delta, n, target_len);
+            return;
+    }
+}
+
+void scatter_smallbuf_elem_serial(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    switch (elem) {
+        case ELEM_F32:
+            scatter_elem_serial_f32(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_I32:
+            scatter_elem_serial_i32(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_I64:
+            scatter_elem_serial_i64(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_C64:
+            scatter_elem_serial_c64(target, source, pat, pat_len, delta, n, source_len);
+            return;
+        case ELEM_BYTES:
+            for (size_t i = 0; i < n; i++) {
+                char *tl = (char *)target + delta * i * elem_size;
+                const char *sl = (const char *)source[0] + pat_len*(i%source_len) * elem_size;
+                for (size_t j = 0; j < pat_len; j++)
+                    memcpy(tl + pat[j] * elem_size, sl + j * elem_size, elem_size);
+            }
+            return;
+        default:
+            scatter_smallbuf_serial(target, source, pat, pat_len, delta, n, source_len);
+            return;
+    }
+}
+
+// All accumulate ops run this loop, with a single thread there is nothing
+// for atomics or conflict detection to protect
+void scatter_smallbuf_accum_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+
+    for (size_t i = 0; i < n; i++) {
+           sgData_t *tl = target + delta * i;
+           sgData_t *sl = source[0] + pat_len*(i%source_len);
+
+       for (size_t j = 0; j < pat_len; j++) {
+               tl[pat[j]] += sl[j];
+           }
+        }
+}
+
+
+void gather_stream_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t source_len,
+        size_t target_len) {
+    sgData_t *tl = target[0];
+    if ((source_len & (source_len - 1)) == 0) {
+        for (size_t i = 0; i < n; i++) {
+            tl[i % target_len] = source[idx[i] & (source_len - 1)];
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            tl[i % target_len] = source[idx[i] % source_len];
+        }
+    }
+}
+
+void scatter_stream_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t target_len,
+        size_t source_len) {
+    sgData_t *sl = source[0];
+    if ((target_len & (target_len - 1)) == 0) {
+        for (size_t i = 0; i < n; i++) {
+            target[idx[i] & (target_len - 1)] = sl[i % source_len];
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            target[idx[i] % target_len] = sl[i % source_len];
+        }
+    }
+}
 
 void sg_smallbuf_serial(
         sgData_t* restrict gather,
@@ -115,3 +698,173 @@ void sg_smallbuf_serial(
         }
     }
 }
+
+void sg_smallbuf_morton_serial(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t pat_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t wrap,
+        uint32_t *order) {
+
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *tl = scatter + delta_scatter * order[i];
+        sgData_t *sl = gather + delta_gather * order[i];
+
+        #pragma novector
+        for (size_t j = 0; j < pat_len; j++) {
+            tl[scatter_pat[j]] = sl[gather_pat[j]];
+        }
+    }
+}
+
+void sg_smallbuf_staged_serial(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t gather_len,
+        size_t scatter_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t tile) {
+    size_t rows = tile / (gather_len * sizeof(sgData_t));
+    if (rows < 1)
+        rows = 1;
+    sgData_t *cur = (sgData_t *)malloc(2 * rows * gather_len * sizeof(sgData_t));
+    sgData_t *next = cur + rows * gather_len;
+
+    size_t cnt = n < rows ? n : rows;
+    for (size_t r = 0; r < cnt; r++)
+        for (size_t j = 0; j < gather_len; j++)
+            cur[r * gather_len + j] = gather[delta_gather * r + gather_pat[j]];
+
+    for (size_t k = 0; cnt; ) {
+        size_t kn = k + cnt;
+        size_t cntn = kn >= n ? 0 : n - kn < rows ? n - kn : rows;
+        for (size_t r = 0; r < cnt; r++) {
+            if (r < cntn) {
+                const sgData_t *sl = gather + delta_gather * (kn + r);
+                sgData_t *nl = next + r * gather_len;
+                #pragma novector
+                for (size_t j = 0; j < gather_len; j++)
+                    nl[j] = sl[gather_pat[j]];
+            }
+            sgData_t *tl = scatter + delta_scatter * (k + r);
+            const sgData_t *cl = cur + r * gather_len;
+            #pragma novector
+            for (size_t j = 0, g = 0; j < scatter_len; j++, g = g + 1 == gather_len ? 0 : g + 1)
+                tl[scatter_pat[j]] = cl[g];
+        }
+        sgData_t *swap = cur;
+        cur = next;
+        next = swap;
+        k = kn;
+        cnt = cntn;
+    }
+    free(cur < next ? cur : next);
+}
+
+void chase_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t target_len,
+        const size_t* restrict head,
+        const size_t* restrict len,
+        int chains) {
+    size_t b[SP_MAX_CHAINS];
+    size_t hops = 0;
+    for (int c = 0; c < chains; c++) {
+        b[c] = head[c];
+        if (len[c] > hops)
+            hops = len[c];
+    }
+
+    size_t w = 0;
+    for (size_t s = 0; s < hops; s++) {
+        for (int c = 0; c < chains; c++) {
+            if (s >= len[c])
+                continue;
+            sgData_t *sl = source + b[c];
+            sgData_t *tl = target[0] + pat_len*w;
+            if (++w == target_len)
+                w = 0;
+#ifndef __clang__
+            #pragma novector
+#endif
+            for (size_t j = 0; j < pat_len; j++) {
+                tl[j] = sl[pat[j]];
+            }
+            memcpy(&b[c], &sl[pat[0]], sizeof(size_t));
+        }
+    }
+}
+
+void pack_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = r->n2 * r->n1 * r->run;
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *sl = source + delta * i + r->off;
+        sgData_t *tl = target[0] + len*(i%target_len);
+        for (size_t o = 0; o < r->n2; o++) {
+            for (size_t k = 0; k < r->n1; k++) {
+                const sgData_t *row = sl + o * r->s2 + k * r->s1;
+                for (size_t e = 0; e < r->run; e++)
+                    tl[e] = row[e];
+                tl += r->run;
+            }
+        }
+    }
+}
+
+void unpack_smallbuf_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t source_len) {
+    size_t len = r->n2 * r->n1 * r->run;
+    for (size_t i = 0; i < n; i++) {
+        sgData_t *tl = target + delta * i + r->off;
+        const sgData_t *sl = source[0] + len*(i%source_len);
+        for (size_t o = 0; o < r->n2; o++) {
+            for (size_t k = 0; k < r->n1; k++) {
+                sgData_t *row = tl + o * r->s2 + k * r->s1;
+                for (size_t e = 0; e < r->run; e++)
+                    row[e] = sl[e];
+                sl += r->run;
+            }
+        }
+    }
+}
+
+void transpose_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len) {
+    size_t len = cells * cell;
+    for (size_t i = 0; i < n; i++) {
+        const sgData_t *sl = source + delta * i;
+        sgData_t *tl = target[0] + len*(i%target_len);
+        for (size_t e = 0; e < cell; e++)
+            for (size_t c = 0; c < cells; c++)
+                tl[e * cells + c] = sl[c * cell + e];
+    }
+}
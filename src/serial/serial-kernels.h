@@ -2,7 +2,9 @@
 #define SERIAL_KERNELS_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "../include/sgtype.h"
+#include "../include/box.h"
 
 void multigather_smallbuf_serial(
         sgData_t** restrict target,
@@ -24,6 +26,61 @@ void multiscatter_smallbuf_serial(
         size_t n,
         size_t source_len);
 
+void multigather_smallbuf_morton_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint32_t *order);
+
+void multiscatter_smallbuf_morton_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order);
+
+void multigather_smallbuf_random_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        long initstate);
+
+void multiscatter_smallbuf_random_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        long initstate);
+
+void multigather_smallbuf_multidelta_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict outer_pat,
+        ssize_t* const restrict inner_pat,
+        size_t pat_len,
+        size_t *delta,
+        size_t n,
+        size_t target_len,
+        size_t delta_len);
+
 void gather_smallbuf_serial(
         sgData_t** restrict target,
         sgData_t* restrict source,
@@ -42,6 +99,136 @@ void scatter_smallbuf_serial(
         size_t n,
         size_t source_len);
 
+void gather_smallbuf_morton_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        uint32_t *order);
+
+void scatter_smallbuf_morton_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        uint32_t *order);
+
+void gather_smallbuf_random_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        long initstate,
+        const uint32_t *bases);
+
+void scatter_smallbuf_random_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        long initstate,
+        const uint32_t *bases);
+
+void gather_smallbuf_multidelta_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t *delta,
+        size_t n,
+        size_t target_len,
+        size_t delta_len);
+
+/** @brief Single-core Gather and Scatter for --prefetch-distance: the
+ *  pattern is unrolled by four and Gather or Scatter i + distance is
+ *  prefetched while i runs, see gather_smallbuf_prefetch
+ */
+void gather_smallbuf_prefetch_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len,
+        size_t distance,
+        int line_only,
+        int nta);
+
+void scatter_smallbuf_prefetch_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len,
+        size_t distance,
+        int line_only,
+        int nta);
+
+/** @brief gather_smallbuf_serial and scatter_smallbuf_serial for the
+ *  --elem types, see gather_smallbuf_elem
+ */
+void gather_smallbuf_elem_serial(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+
+void scatter_smallbuf_elem_serial(
+        enum sg_elem elem,
+        size_t elem_size,
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+void scatter_smallbuf_accum_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+
+void gather_stream_serial(
+        sgData_t** restrict target,
+        sgData_t* restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t source_len,
+        size_t target_len);
+
+void scatter_stream_serial(
+        sgData_t* restrict target,
+        sgData_t** restrict source,
+        const uint64_t* restrict idx,
+        size_t n,
+        size_t target_len,
+        size_t source_len);
+
 void sg_smallbuf_serial(
         sgData_t* restrict gather,
         sgData_t* restrict scatter,
@@ -52,4 +239,63 @@ void sg_smallbuf_serial(
         size_t delta_scatter,
         size_t n,
         size_t wrap);
+
+void sg_smallbuf_morton_serial(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t pat_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t wrap,
+        uint32_t *order);
+
+/** @brief Serial sg_smallbuf_staged */
+void sg_smallbuf_staged_serial(
+        sgData_t* restrict gather,
+        sgData_t* restrict scatter,
+        ssize_t* const restrict gather_pat,
+        ssize_t* const restrict scatter_pat,
+        size_t gather_len,
+        size_t scatter_len,
+        size_t delta_gather,
+        size_t delta_scatter,
+        size_t n,
+        size_t tile);
+
+void chase_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        ssize_t* const restrict pat,
+        size_t pat_len,
+        size_t target_len,
+        const size_t* restrict head,
+        const size_t* restrict len,
+        int chains);
+
+// PACK, UNPACK and TRANSPOSE of box i at source + delta * i, see box.h
+void pack_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t target_len);
+void unpack_smallbuf_serial(
+        sgData_t* restrict target,
+        sgData_t** const restrict source,
+        const struct sp_box_rows *r,
+        size_t delta,
+        size_t n,
+        size_t source_len);
+void transpose_smallbuf_serial(
+        sgData_t** restrict target,
+        sgData_t* const restrict source,
+        size_t cells,
+        size_t cell,
+        size_t delta,
+        size_t n,
+        size_t target_len);
 #endif
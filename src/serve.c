@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "serve.h"
+
+// Run the configs of every line of in, writing their records to o
+// Returns 1 if a line asked the server to quit
+static int serve_stream(FILE *in, FILE *o, struct sp_buffers *bufs, const struct sp_output_meta *meta, int *seq)
+{
+    char *line = NULL;
+    size_t cap = 0;
+    int quit = 0;
+
+    sp_output_attach(o, OUTPUT_JSON, meta);
+    while (getline(&line, &cap, in) > 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *text = line + strspn(line, " \t");
+        if (!*text)
+            continue;
+        if (!strcmp(text, "quit")) {
+            quit = 1;
+            break;
+        }
+
+        struct sp_suite *suite = sp_config_parse_json(text);
+        if (!suite) {
+            sp_output_error("Unable to parse the line as a json config or array of configs");
+            continue;
+        }
+        for (int k = 0; k < sp_config_count(suite); k++) {
+            struct sp_result r;
+            if (sp_run(bufs, suite, k, INVALID_BACKEND, &r) == 0)
+                sp_output_run((*seq)++, sp_config_get(suite, k), r.bytes, NULL, NULL, NULL);
+            else
+                sp_output_error("The config does not fit the buffers, give a config as large on the command line");
+        }
+        sp_config_free(suite);
+    }
+    free(line);
+    sp_output_detach();
+    return quit;
+}
+
+static int serve_unix(const char *path, struct sp_buffers *bufs, const struct sp_output_meta *meta)
+{
+    struct sockaddr_un sa;
+    struct stat st;
+    int seq = 0;
+
+    if (strlen(path) >= sizeof(sa.sun_path))
+        return -1;
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+
+    // A socket left behind by a server that was killed
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) || listen(fd, 4)) {
+        close(fd);
+        return -1;
+    }
+    printf("Serving on %s\n", path);
+    fflush(stdout);
+
+    for (int quit = 0; !quit;) {
+        int conn = accept(fd, NULL, NULL);
+        if (conn < 0)
+            continue;
+        FILE *in = fdopen(conn, "r");
+        FILE *o = fdopen(dup(conn), "w");
+        quit = serve_stream(in, o, bufs, meta, &seq);
+        fclose(in);
+    }
+    close(fd);
+    unlink(path);
+    return 0;
+}
+
+int sp_serve(const char *addr, const struct sp_suite *sizes, const struct sp_output_meta *meta)
+{
+    struct sp_buffers *bufs = sp_buffers_create(sizes);
+    int err = 0;
+
+    // A client that hangs up early must not take the server with it
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!strcasecmp(addr, "stdin")) {
+        // The records own stdout, everything else printed goes to stderr
+        int seq = 0;
+        fflush(stdout);
+        FILE *o = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        serve_stream(stdin, o, bufs, meta, &seq);
+    } else {
+        err = serve_unix(addr + strlen("unix:"), bufs, meta);
+    }
+
+    sp_output_close();
+    sp_buffers_destroy(bufs);
+    return err;
+}
@@ -1,28 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/types.h>
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 #include "sgtype.h"
 #include "sgbuf.h"
-#include "mt64.h"
+#include "sp_alloc.h"
+#include "sp_rand.h"
 #include "vrand.h"
 
-void random_data(sgData_t *buf, size_t len){
-#ifdef _OPENMP
-    int nt = omp_get_max_threads();
-#else
-    int nt = 1;
-#endif
-#pragma omp parallel for num_threads(nt) schedule(static, 1)
-    for(int i=0; i<nt; i++) {
-        init_genrand64(0x1337ULL + i);
+void random_data(sgData_t *buf, size_t len, int nthreads){
+    sp_rand_fill(buf, len, 0x1337ULL, 10, nthreads);
+}
+
+int sgbuf_reserve(sgDataBuf *buf, size_t size, size_t align){
+    buf->size = size;
+    buf->len = size / sizeof(sgData_t);
+    if (size <= buf->capacity && size * SGBUF_SHRINK_FACTOR >= buf->capacity) {
+        return 0;
     }
-#pragma omp parallel for shared(buf,len) num_threads(nt)
-    for(size_t i = 0; i < len; i++){
-        buf[i] = genrand64_int63() % 10;
+
+    // Free first so the old and new buffers never need to fit at once
+    if (buf->nptrs > 0) {
+        for (size_t i = 0; i < buf->nptrs; i++) {
+            sp_free(buf->host_ptrs[i]);
+            buf->host_ptrs[i] = (sgData_t*) sp_data_malloc(size, 1, align);
+        }
+        buf->host_ptr = buf->host_ptrs[0];
+    } else {
+        sp_free(buf->host_ptr);
+        buf->host_ptr = (sgData_t*) sp_data_malloc(size, 1, align);
     }
+    buf->capacity = size;
+    return 1;
 }
 
 void linear_indices(sgIdx_t *idx, size_t len, size_t worksets, size_t stride, int randomize){
@@ -36,13 +48,8 @@ void linear_indices(sgIdx_t *idx, size_t len, size_t worksets, size_t stride, in
 
     // Fisher-Yates Shuffling
     if(randomize){
-        unsigned long long init[4] = {0x12345ULL, 0x23456ULL,
-                                      0x34567ULL,0x45678ULL};
-        int length = 4;
-        init_by_array64(init, length);
-
         for(size_t i = 0; i < len-2; i++){
-            size_t j = (genrand64_int64() % (len-i)) + i;
+            size_t j = sp_rand_bounded(0x12345ULL, i, (uint32_t)(len-i)) + i;
             for(size_t k = 0; k < worksets; k++) {
                 size_t tmp = idx[k*len+i];
                 idx[k*len+i] = idx[k*len+j];
@@ -203,37 +210,135 @@ size_t trace_indices( sgIdx_t *idx, size_t len, struct trace tr) {
 }
 #endif
 
-void compress_indices( ssize_t *idx, size_t len) {
-    // Pageinate the positive zero-based indicies in idx[].
-    long *pages = NULL, npages = 0;
-    long  page,pidx;
-    long  page_bits = 12; // 12 => 4KiB
-    long  new_idx;
-    for(size_t i = 0; i < len; i++) {
-        // Turn address into page.
-        page = (idx[i]*8) >> page_bits;
-        // Find existing / make new page entry.
-        pidx = -1;
-        for(long p = 0; p < npages; p++) {
-            if( pages[p] == page ) {
-                pidx = p;
-                break;
+// Open-addressed map from a page number to its dense index, kept at most
+// half full
+struct page_map {
+    int64_t *key;
+    long *val;
+    size_t mask;
+    size_t n;
+};
+
+#define PAGE_MAP_EMPTY INT64_MIN
+
+static void page_map_init(struct page_map *m, size_t cap) {
+    m->mask = cap - 1;
+    m->n = 0;
+    m->key = (int64_t*)malloc(cap * sizeof(int64_t));
+    m->val = (long*)malloc(cap * sizeof(long));
+    if (!m->key || !m->val) {
+        fprintf(stderr, "compress_indices(): Failed to allocate a page map of %zu entries.\n", cap);
+        exit(1);
+    }
+    for (size_t i = 0; i < cap; i++)
+        m->key[i] = PAGE_MAP_EMPTY;
+}
+
+static size_t page_map_slot(const struct page_map *m, int64_t page) {
+    size_t h = (size_t)(((uint64_t)page * 0x9e3779b97f4a7c15ULL) >> 20) & m->mask;
+    while (m->key[h] != PAGE_MAP_EMPTY && m->key[h] != page)
+        h = (h + 1) & m->mask;
+    return h;
+}
+
+// Add page with dense index val, returns 0 if it was already there
+static int page_map_insert(struct page_map *m, int64_t page, long val) {
+    if (2 * (m->n + 1) > m->mask + 1) {
+        struct page_map old = *m;
+        page_map_init(m, 2 * (old.mask + 1));
+        for (size_t i = 0; i <= old.mask; i++) {
+            if (old.key[i] != PAGE_MAP_EMPTY) {
+                size_t h = page_map_slot(m, old.key[i]);
+                m->key[h] = old.key[i];
+                m->val[h] = old.val[i];
+                m->n++;
             }
         }
-        if( pidx == -1 ) {
-            pidx = npages;
-            npages++;
-            if( !(pages = realloc(pages,npages*sizeof(long))) ) {
-                fprintf(stderr,"trace_indices(): Failed to allocate new page entry (%ld).\n",npages);
-            }
-            pages[pidx] = page;
+        free(old.key);
+        free(old.val);
+    }
+    size_t h = page_map_slot(m, page);
+    if (m->key[h] == page)
+        return 0;
+    m->key[h] = page;
+    m->val[h] = val;
+    m->n++;
+    return 1;
+}
+
+static void page_map_free(struct page_map *m) {
+    free(m->key);
+    free(m->val);
+}
+
+size_t compress_indices(ssize_t *idx, size_t len, size_t elem, size_t page) {
+    // Pageinate the indices in idx[]: the pages are numbered in the order
+    // of their first access, and each index keeps its offset in its page.
+    if (len == 0)
+        return 0;
+    int page_bits = 0;
+    while (((size_t)1 << page_bits) < page)
+        page_bits++;
+    int64_t offset_mask = (int64_t)page - 1;
+#ifdef _OPENMP
+    int nt = omp_get_max_threads();
+#else
+    int nt = 1;
+#endif
+
+    // Each thread lists the distinct pages of its contiguous part of idx,
+    // in order of first access
+    int64_t **local = (int64_t**)malloc(nt * sizeof(int64_t*));
+    size_t *nlocal = (size_t*)calloc(nt, sizeof(size_t));
+    #pragma omp parallel num_threads(nt)
+    {
+#ifdef _OPENMP
+        int t = omp_get_thread_num();
+#else
+        int t = 0;
+#endif
+        size_t i0 = len * t / nt;
+        size_t i1 = len * (t + 1) / nt;
+        struct page_map m;
+        page_map_init(&m, 64);
+        local[t] = (int64_t*)malloc((i1 - i0 + 1) * sizeof(int64_t));
+        for (size_t i = i0; i < i1; i++) {
+            int64_t pg = (int64_t)idx[i] * (int64_t)elem >> page_bits;
+            if (page_map_insert(&m, pg, 0))
+                local[t][nlocal[t]++] = pg;
         }
-        // Replace sparse page bits in address with dense page index bits.
-        new_idx  = (pidx << page_bits) | ((idx[i]*8) & ((1l<<page_bits)-1l));
-        new_idx /= 8;
-        idx[i] = new_idx;
+        page_map_free(&m);
     }
-    if( npages ) free(pages);
+
+    // Number them in the order of the parts, which is the order of idx
+    size_t total = 0;
+    for (int t = 0; t < nt; t++)
+        total += nlocal[t];
+    struct page_map map;
+    size_t cap = 64;
+    while (cap < 2 * total)
+        cap <<= 1;
+    page_map_init(&map, cap);
+    long npages = 0;
+    for (int t = 0; t < nt; t++) {
+        for (size_t j = 0; j < nlocal[t]; j++) {
+            if (page_map_insert(&map, local[t][j], npages))
+                npages++;
+        }
+        free(local[t]);
+    }
+    free(local);
+    free(nlocal);
+
+    // Replace the sparse page bits of each address with the dense page index
+    #pragma omp parallel for schedule(static) num_threads(nt)
+    for (size_t i = 0; i < len; i++) {
+        int64_t addr = (int64_t)idx[i] * (int64_t)elem;
+        long dense = map.val[page_map_slot(&map, addr >> page_bits)];
+        idx[i] = (((int64_t)dense << page_bits) | (addr & offset_mask)) / (int64_t)elem;
+    }
+    page_map_free(&map);
+    return (size_t)npages;
 }
 
 #ifdef USE_OPENCL
@@ -1,11 +1,38 @@
 #include "sgtime.h"
 #include <stdio.h>
+#include <stdint.h>
+#if defined( __x86_64__ )
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
 
 struct timespec starttime;
 struct timespec endtime;
 
+static enum sg_timer timer = TIMER_CLOCK;
+static uint64_t start_ticks;
+static double ms_per_tick;
+static double overhead_ms = -1;
+
+static inline uint64_t read_ticks(void)
+{
+#if defined( __x86_64__ )
+    unsigned int aux;
+    return __rdtscp(&aux);
+#elif defined( __aarch64__ )
+    uint64_t v;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return v;
+#else
+    return 0;
+#endif
+}
+
 void sg_zero_time(void){
   //clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+  if (timer == TIMER_TSC)
+    start_ticks = read_ticks();
+  else
   clock_gettime(CLOCK_MONOTONIC, &starttime);
 }
 
@@ -38,9 +65,83 @@ if ((endtime.tv_nsec-starttime.tv_nsec)<0) {
 //Returns ms since zero time
 double sg_get_time_ms(void){
   //clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &s);
+  if (timer == TIMER_TSC)
+    return (double)(read_ticks() - start_ticks) * ms_per_tick;
   clock_gettime(CLOCK_MONOTONIC, &endtime);
 
   //Print out for debugging
   //printf("Time is now %llu s and %llu ns for endtime and %llu s and %llu ns for t\n", endtime.tv_sec, endtime.tv_nsec, starttime.tv_sec, starttime.tv_nsec);
   return diff_ms();
 }
+
+// The length of a tick: read from cntfrq_el0 on AArch64, on x86-64 the TSC
+// is counted over 20 ms of CLOCK_MONOTONIC. 0 without a counter that ticks
+// at a constant rate.
+static double calibrate_ms_per_tick(void)
+{
+#if defined( __x86_64__ )
+    unsigned int eax, ebx, ecx, edx;
+    // CPUID 0x80000007 EDX bit 8: invariant TSC
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+        return 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t c0 = read_ticks();
+    double ms;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1000000.0;
+    } while (ms < 20);
+    uint64_t c1 = read_ticks();
+    return c1 > c0 ? ms / (double)(c1 - c0) : 0;
+#elif defined( __aarch64__ )
+    uint64_t freq;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq ? 1000.0 / (double)freq : 0;
+#else
+    return 0;
+#endif
+}
+
+int sg_set_timer(enum sg_timer t)
+{
+    if (t == TIMER_TSC) {
+        ms_per_tick = calibrate_ms_per_tick();
+        if (ms_per_tick <= 0)
+            return 0;
+    }
+    timer = t;
+    overhead_ms = -1;
+    return 1;
+}
+
+uint64_t sg_ticks(void)
+{
+    return read_ticks();
+}
+
+double sg_tick_ns(void)
+{
+    static double tick_ns = -1;
+    if (tick_ns < 0)
+        tick_ns = (ms_per_tick > 0 ? ms_per_tick : calibrate_ms_per_tick()) * 1e6;
+    return tick_ns;
+}
+
+enum sg_timer sg_get_timer(void)
+{
+    return timer;
+}
+
+double sg_timer_overhead_ms(void)
+{
+    if (overhead_ms < 0) {
+        for (int i = 0; i < 1000; i++) {
+            sg_zero_time();
+            double ms = sg_get_time_ms();
+            if (i == 0 || ms < overhead_ms)
+                overhead_ms = ms;
+        }
+    }
+    return overhead_ms;
+}
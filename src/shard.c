@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "shard.h"
+#include "output.h"
+#include "json.h"
+
+int sp_shard_parse(const char *arg, int *shard, int *nshards)
+{
+    int i, n, used = 0;
+    if (sscanf(arg, "%d/%d%n", &i, &n, &used) != 2 || arg[used] || n < 1 || i < 0 || i >= n)
+        return -1;
+    *shard = i;
+    *nshards = n;
+    return 0;
+}
+
+struct sp_shard_cost
+{
+    size_t work;
+    int k;
+};
+
+static size_t config_work(const struct run_config *rc)
+{
+    size_t len = rc->pattern_len;
+    if (rc->pattern_gather_len > len)
+        len = rc->pattern_gather_len;
+    if (rc->pattern_scatter_len > len)
+        len = rc->pattern_scatter_len;
+    return (len ? len : 1) * (rc->generic_len ? rc->generic_len : 1);
+}
+
+// Largest first, then in suite order, so that every job deals the same way
+static int compare_cost(const void *a, const void *b)
+{
+    const struct sp_shard_cost *x = (const struct sp_shard_cost *)a;
+    const struct sp_shard_cost *y = (const struct sp_shard_cost *)b;
+    if (x->work != y->work)
+        return x->work > y->work ? -1 : 1;
+    return x->k - y->k;
+}
+
+void sp_shard_select(const struct run_config *rc, int nrc, int shard, int nshards, char *keep)
+{
+    struct sp_shard_cost *cost = (struct sp_shard_cost *)malloc(sizeof(struct sp_shard_cost) * nrc);
+    size_t *load = (size_t *)calloc(nshards, sizeof(size_t));
+    for (int k = 0; k < nrc; k++) {
+        cost[k].work = config_work(&rc[k]);
+        cost[k].k = k;
+    }
+    qsort(cost, nrc, sizeof(struct sp_shard_cost), compare_cost);
+
+    for (int c = 0; c < nrc; c++) {
+        int least = 0;
+        for (int s = 1; s < nshards; s++)
+            if (load[s] < load[least])
+                least = s;
+        load[least] += cost[c].work;
+        keep[cost[c].k] = least == shard;
+    }
+    free(cost);
+    free(load);
+}
+
+struct sp_done
+{
+    uint64_t key;  /**< hash of the config keys of the record */
+    uint64_t name; /**< hash of its name */
+    int taken;     /**< already matched to a config of the suite */
+};
+
+static struct sp_done *done;
+static int ndone;
+
+static int compare_done(const void *a, const void *b)
+{
+    const struct sp_done *x = (const struct sp_done *)a;
+    const struct sp_done *y = (const struct sp_done *)b;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    if (x->name != y->name)
+        return x->name < y->name ? -1 : 1;
+    return 0;
+}
+
+// One run record: the config keys run from "kernel" up to the results
+static int read_record(char *line, size_t len, struct sp_done *d)
+{
+    char *from = strstr(line, "\"kernel\":");
+    char *to = from ? strstr(from, ",\"bytes\":") : NULL;
+    if (!to)
+        return 0;
+    json_value *rec = json_parse((json_char *)line, len);
+    if (!rec || rec->type != json_object) {
+        json_value_free(rec);
+        return 0;
+    }
+    int ok = 0;
+    for (unsigned int i = 0; i < rec->u.object.length; i++) {
+        const json_value *v = rec->u.object.values[i].value;
+        if (!strcmp(rec->u.object.values[i].name, "name") && v->type == json_string) {
+            d->name = sp_output_hash(v->u.string.ptr, v->u.string.length);
+            ok = 1;
+        }
+    }
+    d->key = sp_output_hash(from, to - from);
+    d->taken = 0;
+    json_value_free(rec);
+    return ok;
+}
+
+int sp_resume_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return errno == ENOENT ? 0 : -1;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int size = 0;
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (strncmp(line, "{\"type\":\"run\"", 13))
+            continue;
+        if (ndone == size) {
+            size = size ? 2 * size : 64;
+            done = (struct sp_done *)realloc(done, sizeof(struct sp_done) * size);
+        }
+        if (read_record(line, len, &done[ndone]))
+            ndone++;
+    }
+    free(line);
+    fclose(f);
+    qsort(done, ndone, sizeof(struct sp_done), compare_done);
+    return ndone;
+}
+
+void sp_resume_free(void)
+{
+    free(done);
+    done = NULL;
+    ndone = 0;
+}
+
+int sp_resume_done(const struct run_config *rc)
+{
+    size_t len;
+    char *text = sp_output_config_json(rc, &len);
+    if (!text)
+        return 0;
+    struct sp_done want = {sp_output_hash(text, len), sp_output_hash(rc->name, strlen(rc->name)), 0};
+    free(text);
+
+    // The first record of the config, then the next one not yet taken
+    int lo = 0, hi = ndone;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (compare_done(&done[mid], &want) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo < ndone && !compare_done(&done[lo], &want); lo++) {
+        if (!done[lo].taken) {
+            done[lo].taken = 1;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include "sp-run.h"
+#include "sp_alloc.h"
+#include "sp_rand.h"
+#include "morton.h"
+#include "hilbert.h"
+#include "numa-util.h"
+#include "traffic.h"
+
+#if defined( USE_OPENMP )
+	#include <omp.h>
+	#include "openmp/openmp_kernels.h"
+	#include "openmp/openmp_simd_kernels.h"
+#endif
+#if defined( USE_SERIAL )
+	#include "serial/serial-kernels.h"
+#endif
+
+extern enum sg_backend backend;
+extern enum sg_simd simd_isa;
+extern enum sg_numa numa_mode;
+extern int validate_flag;
+extern int inner_stream_flag;
+extern int compress_flag;
+extern int sparse_source_flag;
+extern size_t compress_page;
+extern struct sp_tier source_tier;
+extern struct sp_tier target_tier;
+
+// Seed of the values of a sparse source
+#define SP_SPARSE_SEED 0x1337ULL
+
+// With a NUMA policy, each thread first-touches its own target. With
+// --tier-target the touched pages are then moved to their tiers.
+void sp_fill_targets(sgDataBuf *target) {
+    if (numa_mode != NUMA_DEFAULT || target_tier.n) {
+        #pragma omp parallel for schedule(static, 1) num_threads(target->nptrs)
+        for (size_t t = 0; t < target->nptrs; t++) {
+            memset(target->host_ptrs[t], 0, target->size);
+        }
+    }
+    for (size_t t = 0; t < target->nptrs && target_tier.n; t++) {
+        if (sp_numa_split(target->host_ptrs[t], target->size, &target_tier))
+            error("move_pages failed, --tier-target left the targets where they were", WARN);
+    }
+    #ifdef VALIDATE
+    for (size_t i = 0; i < target->nptrs; i++) {
+        if (validate_flag) { // Fill target buffer with data for validation purposes
+            random_data(target->host_ptrs[i], target->len, 1);
+        }
+    }
+    #endif
+}
+
+// Populate the source on host in one pass. For first-touch placement use
+// the same thread count as the kernels, each filling a contiguous part.
+void sp_fill_source(sgDataBuf *source, size_t nthreads) {
+    if (numa_mode == NUMA_INTERLEAVE) {
+        sp_numa_interleave(source->host_ptr, source->size);
+    }
+    int init_threads = 1;
+#ifdef USE_OPENMP
+    init_threads = numa_mode == NUMA_FIRSTTOUCH ? (int)nthreads : omp_get_max_threads();
+#endif
+    random_data(source->host_ptr, source->len, init_threads);
+    if (source_tier.n && sp_numa_split(source->host_ptr, source->size, &source_tier))
+        error("move_pages failed, --tier left the source where it was", WARN);
+}
+
+// Back the words of element p of a sparse source, es bytes each, with
+// values of their position alone: writes of the same element from several
+// threads agree
+static void back_element(sgData_t *src, size_t p, size_t es) {
+    size_t w1 = ((p + 1) * es + sizeof(sgData_t) - 1) / sizeof(sgData_t);
+    for (size_t w = p * es / sizeof(sgData_t); w < w1; w++)
+        src[w] = (sgData_t)(sp_rand_at(SP_SPARSE_SEED, w) % 10);
+}
+
+// Drop the pages of the config before, then write every element rc reads
+// or writes, in the kernels' static schedule so that each page is
+// first-touched by a thread that uses it
+void sp_fill_sparse_source(sgDataBuf *source, const struct run_config *rc, struct sp_trace_stream *trace, size_t nthreads) {
+    sp_reserve_reset(source->host_ptr, source->capacity);
+    if (numa_mode == NUMA_INTERLEAVE) {
+        sp_numa_interleave(source->host_ptr, source->capacity);
+    }
+    int init_threads = 1;
+#ifdef USE_OPENMP
+    init_threads = numa_mode == NUMA_FIRSTTOUCH ? (int)nthreads : omp_get_max_threads();
+#else
+    (void)nthreads;
+#endif
+    (void)init_threads;
+    sgData_t *src = source->host_ptr;
+    size_t n = rc->generic_len;
+
+    if (trace) {
+        const uint64_t *chunk;
+        size_t len;
+        while ((len = sp_trace_next(trace, &chunk))) {
+            #pragma omp parallel for schedule(static) num_threads(init_threads)
+            for (size_t i = 0; i < len; i++)
+                back_element(src, chunk[i] % rc->boundary, sizeof(sgData_t));
+        }
+        sp_trace_rewind(trace);
+    } else if (rc->kernel == MULTIGATHER || rc->kernel == MULTISCATTER) {
+        const ssize_t *inner = rc->kernel == MULTIGATHER ? rc->pattern_gather : rc->pattern_scatter;
+        size_t len = rc->kernel == MULTIGATHER ? rc->pattern_gather_len : rc->pattern_scatter_len;
+        #pragma omp parallel for schedule(static) num_threads(init_threads)
+        for (size_t i = 0; i < n; i++) {
+            size_t b = sp_config_base(rc, rc->delta, i, n);
+            for (size_t j = 0; j < len; j++)
+                back_element(src, b + rc->pattern[rc->inner_stream ? rc->inner_stream[i * len + j] : inner[j]], sizeof(sgData_t));
+        }
+    } else {
+        size_t es = sp_elem_size(rc);
+        #pragma omp parallel for schedule(static) num_threads(init_threads)
+        for (size_t i = 0; i < n; i++) {
+            size_t b = sp_config_base(rc, rc->delta, i, n);
+            for (size_t j = 0; j < rc->pattern_len; j++)
+                back_element(src, b + rc->pattern[j], es);
+        }
+    }
+}
+
+// Replay a whole trace through the stream kernels, returns the number of
+// indices consumed
+static size_t replay_trace(struct sp_trace_stream *trace, sgDataBuf *source, sgDataBuf *target, struct run_config *rc) {
+    const uint64_t *chunk;
+    size_t n;
+    size_t total = 0;
+    while ((n = sp_trace_next(trace, &chunk))) {
+#ifdef USE_OPENMP
+        if (backend == OPENMP) {
+            if (rc->kernel == GATHER)
+                gather_stream(target->host_ptrs, source->host_ptr, chunk, n, rc->boundary, rc->wrap);
+            else
+                scatter_stream(source->host_ptr, target->host_ptrs, chunk, n, rc->boundary, rc->wrap);
+        }
+#endif
+#ifdef USE_SERIAL
+        if (backend == SERIAL) {
+            if (rc->kernel == GATHER)
+                gather_stream_serial(target->host_ptrs, source->host_ptr, chunk, n, rc->boundary, rc->wrap);
+            else
+                scatter_stream_serial(source->host_ptr, target->host_ptrs, chunk, n, rc->boundary, rc->wrap);
+        }
+#endif
+        total += n;
+    }
+    return total;
+}
+
+// An int16_t or int32_t copy of pat for --index-bits
+void *sp_narrow_pattern(const ssize_t *pat, size_t len, int bits) {
+    if (!pat)
+        return NULL;
+    ssize_t lo = bits == 16 ? INT16_MIN : INT32_MIN;
+    ssize_t hi = bits == 16 ? INT16_MAX : INT32_MAX;
+    void *narrow = malloc(len * (bits / 8) + 1);
+    for (size_t j = 0; j < len; j++) {
+        if (pat[j] < lo || pat[j] > hi)
+            error("A pattern index does not fit in --index-bits", ERROR);
+        if (bits == 16)
+            ((int16_t *)narrow)[j] = (int16_t)pat[j];
+        else
+            ((int32_t *)narrow)[j] = (int32_t)pat[j];
+    }
+    return narrow;
+}
+
+#if defined( USE_SERIAL ) || defined( USE_OPENMP )
+// GS through the staging tiles of sg_smallbuf_staged: with --gs-tile, or
+// when the gather and scatter patterns differ in length
+static int gs_staged(const struct run_config *rc) {
+    return rc->gs_tile > 0 || rc->pattern_gather_len != rc->pattern_scatter_len;
+}
+
+// A quarter of L1 by default, so that both tiles of a thread and the lines
+// in flight around them stay in it
+static size_t gs_tile(const struct run_config *rc) {
+    return rc->gs_tile > 0 ? rc->gs_tile : sp_l1_size() / 4;
+}
+#endif
+
+#ifdef USE_SERIAL
+// One run of rc on the Serial backend
+void sp_run_serial_kernel(struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase) {
+    struct sp_box_rows rows;
+    if (rc->box_op == BOX_PACK || rc->box_op == BOX_UNPACK)
+        sp_box_rows(&rc->box, &rows);
+
+    switch (rc->kernel) {
+        case MULTISCATTER:
+            if (rc->random_seed >= 1)
+                multiscatter_smallbuf_random_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed);
+            else if (rc->ro_morton || rc->ro_hilbert)
+                multiscatter_smallbuf_morton_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+            else
+            multiscatter_smallbuf_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap);
+            break;
+        case MULTIGATHER:
+            if (rc->random_seed >= 1)
+                multigather_smallbuf_random_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed);
+            else if (rc->deltas_len > 1)
+                multigather_smallbuf_multidelta_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->deltas_ps, rc->generic_len, rc->wrap, rc->deltas_len);
+            else if (rc->ro_morton || rc->ro_hilbert)
+                multigather_smallbuf_morton_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+            else
+            multigather_smallbuf_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap);
+            break;
+        case SCATTER:
+            if (trace)
+                rc->generic_len = replay_trace(trace, source, target, rc);
+            else if (rc->box_op == BOX_UNPACK)
+                unpack_smallbuf_serial(source->host_ptr, target->host_ptrs, &rows, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->op != OP_COPY)
+                scatter_smallbuf_accum_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->random_seed >= 1)
+                scatter_smallbuf_random_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed, rc->random_bases);
+            else if (rc->ro_morton || rc->ro_hilbert)
+                scatter_smallbuf_morton_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+            else if (rc->elem != ELEM_F64)
+                scatter_smallbuf_elem_serial(rc->elem, rc->elem_size, source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->prefetch_distance > 0)
+                scatter_smallbuf_prefetch_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->prefetch_distance, rc->prefetch_line, rc->prefetch_hint == PREFETCH_NTA);
+            else
+            scatter_smallbuf_serial(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            break;
+        case GATHER:
+            if (trace)
+                rc->generic_len = replay_trace(trace, source, target, rc);
+            else if (rc->box_op == BOX_PACK)
+                pack_smallbuf_serial(target->host_ptrs, source->host_ptr, &rows, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->box_op == BOX_TRANSPOSE)
+                transpose_smallbuf_serial(target->host_ptrs, source->host_ptr, sp_box_cells(&rc->box), rc->box.cell, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->random_seed >= 1)
+                gather_smallbuf_random_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed, rc->random_bases);
+            else if (rc->deltas_len > 1)
+                gather_smallbuf_multidelta_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->deltas_ps, rc->generic_len, rc->wrap, rc->deltas_len);
+            else if (rc->ro_morton || rc->ro_hilbert)
+                gather_smallbuf_morton_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+            else if (rc->elem != ELEM_F64)
+                gather_smallbuf_elem_serial(rc->elem, rc->elem_size, target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            else if (rc->prefetch_distance > 0)
+                gather_smallbuf_prefetch_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->prefetch_distance, rc->prefetch_line, rc->prefetch_hint == PREFETCH_NTA);
+            else
+            gather_smallbuf_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            break;
+        case GS:
+            if (gs_staged(rc))
+                sg_smallbuf_staged_serial(target->host_ptr, source->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->pattern_scatter_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, gs_tile(rc));
+            else if (rc->ro_morton || rc->ro_hilbert)
+                sg_smallbuf_morton_serial(target->host_ptr, source->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, rc->wrap, rc->ro_order);
+            else
+            sg_smallbuf_serial(target->host_ptr, source->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, rc->wrap);
+            break;
+        case CHASE:
+            chase_smallbuf_serial(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->wrap, chase->head, chase->len, chase->chains);
+            break;
+        default:
+            printf("Error: Unable to determine kernel\n");
+            break;
+    }
+}
+#endif
+
+#ifdef USE_OPENMP
+// One run of rc on the OpenMP backend. The source replicas are used if
+// source->host_ptrs is set.
+void sp_run_omp_kernel(struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_trace_stream *trace, struct sp_chase *chase) {
+    struct sp_box_rows rows;
+    if (rc->box_op == BOX_PACK || rc->box_op == BOX_UNPACK)
+        sp_box_rows(&rc->box, &rows);
+
+    switch (rc->kernel) {
+        case MULTISCATTER:
+          if (rc->inner_stream) {
+            multiscatter_smallbuf_stream(source->host_ptr, target->host_ptrs, rc->pattern, rc->inner_stream, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap);
+          }
+          else if (rc->random_seed >= 1) {
+            multiscatter_smallbuf_random(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed);
+          }
+          else if (rc->ro_morton || rc->ro_hilbert) {
+            multiscatter_smallbuf_morton(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+          }
+          else if (rc->index_bits == 32) {
+            multiscatter_smallbuf_i32(source->host_ptr, target->host_ptrs, rc->pattern_narrow, rc->pattern_scatter_narrow, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap);
+          }
+          else if (rc->index_bits == 16) {
+            multiscatter_smallbuf_i16(source->host_ptr, target->host_ptrs, rc->pattern_narrow, rc->pattern_scatter_narrow, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap);
+          }
+          else if (rc->op == OP_COPY) {
+            multiscatter_smallbuf(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_scatter, rc->pattern_scatter_len, rc->delta, rc->generic_len, rc->wrap);
+          }
+          break;
+        case MULTIGATHER:
+          if (rc->inner_stream) {
+            multigather_smallbuf_stream(target->host_ptrs, source->host_ptr, rc->pattern, rc->inner_stream, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap);
+          }
+          else if (rc->random_seed >= 1) {
+            multigather_smallbuf_random(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed);
+          }
+          else if (rc->deltas_len <= 1) {
+            if (rc->ro_morton || rc->ro_hilbert) {
+              multigather_smallbuf_morton(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+            }
+            else if (rc->index_bits == 32) {
+              multigather_smallbuf_i32(target->host_ptrs, source->host_ptr, rc->pattern_narrow, rc->pattern_gather_narrow, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap);
+            }
+            else if (rc->index_bits == 16) {
+              multigather_smallbuf_i16(target->host_ptrs, source->host_ptr, rc->pattern_narrow, rc->pattern_gather_narrow, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap);
+            }
+            else {
+              multigather_smallbuf(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->delta, rc->generic_len, rc->wrap);
+            }
+          }
+          else {
+            multigather_smallbuf_multidelta(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_gather, rc->pattern_gather_len, rc->deltas_ps, rc->generic_len, rc->wrap, rc->deltas_len);
+          }
+          break;
+        case GS:
+            /*
+            if (rc->op == OP_COPY) {
+                //sg_omp (target->host_ptr, ti.host_ptr, source->host_ptr, si.host_ptr,index_len);
+            } else {
+                //sg_accum_omp (target->host_ptr, ti.host_ptr, source->host_ptr, si.host_ptr, index_len);
+            }
+            */
+            if (gs_staged(rc))
+                sg_smallbuf_staged(source->host_ptr, target->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->pattern_scatter_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, gs_tile(rc));
+            else if (rc->ro_morton || rc->ro_hilbert)
+                sg_smallbuf_morton(source->host_ptr, target->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, rc->wrap, rc->ro_order);
+            else if (rc->store == STORE_NT)
+                sg_smallbuf_nt(source->host_ptr, target->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, rc->wrap);
+            else
+            sg_smallbuf(source->host_ptr, target->host_ptr, rc->pattern_gather, rc->pattern_scatter, rc->pattern_gather_len, rc->delta_gather, rc->delta_scatter, rc->generic_len, rc->wrap);
+            break;
+        case SCATTER:
+            if (trace) {
+                rc->generic_len = replay_trace(trace, source, target, rc);
+            }
+            else if (rc->box_op == BOX_UNPACK) {
+                unpack_smallbuf(source->host_ptr, target->host_ptrs, &rows, rc->delta, rc->generic_len, rc->wrap);
+            }
+            else if (rc->random_seed >= 1) {
+                scatter_smallbuf_random(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed, rc->random_bases);
+            }
+            else if (rc->op == OP_COPY) {
+                if (rc->ro_morton || rc->ro_hilbert)
+                    scatter_smallbuf_morton(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+                else if (rc->elem != ELEM_F64)
+                    scatter_smallbuf_elem(rc->elem, rc->elem_size, source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else if (rc->index_bits == 32)
+                    scatter_smallbuf_i32_simd(simd_isa, source->host_ptr, target->host_ptrs, rc->pattern_narrow, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else if (rc->index_bits == 16)
+                    scatter_smallbuf_i16_simd(simd_isa, source->host_ptr, target->host_ptrs, rc->pattern_narrow, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else if (rc->prefetch_distance > 0)
+                    scatter_smallbuf_prefetch(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->prefetch_distance, rc->prefetch_line, rc->prefetch_hint == PREFETCH_NTA);
+                else if (rc->store == STORE_NT)
+                    scatter_smallbuf_nt(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else if (source->host_ptrs)
+                    scatter_smallbuf_replicated(source->host_ptrs, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else
+                scatter_smallbuf_simd(simd_isa, source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                // scatter_omp (target->host_ptr, ti.host_ptr, source->host_ptr, si.host_ptr, index_len);
+            } else {
+                if (rc->op == OP_ACCUM_ATOMIC)
+                    scatter_smallbuf_atomic(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else if (rc->op == OP_ACCUM_CONFLICT)
+                    scatter_smallbuf_conflict(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                else
+                    scatter_smallbuf_accum(source->host_ptr, target->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+            }
+            break;
+        case GATHER:
+            if (trace) {
+                rc->generic_len = replay_trace(trace, source, target, rc);
+            }
+            else if (rc->box_op == BOX_PACK) {
+                pack_smallbuf_simd(simd_isa, target->host_ptrs, source->host_ptr, &rows, rc->delta, rc->generic_len, rc->wrap);
+            }
+            else if (rc->box_op == BOX_TRANSPOSE) {
+                transpose_smallbuf_simd(simd_isa, target->host_ptrs, source->host_ptr, sp_box_cells(&rc->box), rc->box.cell, rc->delta, rc->generic_len, rc->wrap);
+            }
+            else if (rc->random_seed >= 1) {
+                gather_smallbuf_random(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->random_seed, rc->random_bases);
+            }
+            else if (rc->deltas_len <= 1) {
+                if (rc->ro_morton || rc->ro_hilbert) {
+                    gather_smallbuf_morton(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->ro_order);
+                } else {
+                    if (rc->elem != ELEM_F64)
+                        gather_smallbuf_elem(rc->elem, rc->elem_size, target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                    else if (rc->index_bits == 32)
+                        gather_smallbuf_i32_simd(simd_isa, target->host_ptrs, source->host_ptr, rc->pattern_narrow, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                    else if (rc->index_bits == 16)
+                        gather_smallbuf_i16_simd(simd_isa, target->host_ptrs, source->host_ptr, rc->pattern_narrow, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                    else if (rc->prefetch_distance > 0)
+                        gather_smallbuf_prefetch(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap, rc->prefetch_distance, rc->prefetch_line, rc->prefetch_hint == PREFETCH_NTA);
+                    else if (rc->store == STORE_NT)
+                        gather_smallbuf_nt(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                    else if (source->host_ptrs)
+                        gather_smallbuf_replicated(target->host_ptrs, source->host_ptrs, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                    else
+                    gather_smallbuf_simd(simd_isa, target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->delta, rc->generic_len, rc->wrap);
+                }
+            } else {
+                gather_smallbuf_multidelta(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->deltas_ps, rc->generic_len, rc->wrap, rc->deltas_len);
+            }
+            break;
+        case CHASE:
+            chase_smallbuf(target->host_ptrs, source->host_ptr, rc->pattern, rc->pattern_len, rc->wrap, chase->head, chase->len, chase->threads, chase->chains);
+            break;
+        default:
+            printf("Error: Unable to determine kernel\n");
+            break;
+    }
+}
+#endif
+
+// The bases of the generic_len Gathers or Scatters of --random-dist, drawn
+// from an alias table by all threads at once. Ranks go to bases through a
+// shuffle from the seed, so the hot bases are spread over the source like
+// the hot rows of a hashed table, not packed at its start. The kernels read
+// the bases in order, as an embedding lookup reads its indices, rather than
+// the table, whose random reads would cost as much as the skew saves.
+static uint32_t *random_bases(const struct run_config *rc) {
+    size_t n = rc->generic_len;
+    double *w = (double *)malloc(n * sizeof(double));
+    size_t *base = (size_t *)malloc(n * sizeof(size_t));
+    for (size_t k = 0; k < n; k++)
+        base[k] = k;
+    sp_rand_shuffle(base, n, rc->random_seed);
+
+    // Both sets of hotset non-empty, so the weights never all vanish
+    size_t hot = (size_t)(rc->random_param[0] * n);
+    if (hot >= n)
+        hot = n - 1;
+    if (hot < 1)
+        hot = 1;
+    #pragma omp parallel for
+    for (size_t k = 0; k < n; k++) {
+        if (rc->random_dist == RANDOM_ZIPF)
+            w[base[k]] = pow((double)(k + 1), -rc->random_param[0]);
+        else
+            w[base[k]] = k < hot ? rc->random_param[1] / hot : (1 - rc->random_param[1]) / (n - hot);
+    }
+
+    struct sp_alias_entry *t = (struct sp_alias_entry *)malloc(n * sizeof(struct sp_alias_entry));
+    sp_alias_build(t, w, (uint32_t)n);
+    uint32_t *bases = (uint32_t *)sp_malloc(sizeof(uint32_t), n, ALIGN_CACHE);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; i++)
+        bases[i] = sp_rand_alias(t, rc->random_seed, i, (uint32_t)n);
+    free(w);
+    free(base);
+    free(t);
+    return bases;
+}
+
+// Compress and size the buffers of rc and build its orders, narrow patterns and inner
+// stream
+void sp_prepare_config(struct run_config *rc, int nrc, size_t *source_size, size_t *target_size) {
+    // GS sizes its target like its source, CHASE links the whole source
+    if (sparse_source_flag && (rc->kernel == GS || rc->kernel == CHASE))
+        error("--sparse-source can not run GS or pointer-chase configs", ERROR);
+
+    // If indices span many pages, compress them so that there are no
+    // pages in the address space which are never accessed
+    if (compress_flag) {
+        if (rc->box_op != BOX_NONE)
+            error("--compress can not be combined with PACK, UNPACK or TRANSPOSE, their indices come from the box", ERROR);
+        size_t elem = sp_elem_size(rc);
+        if (compress_page % elem)
+            error("--compress page size must be a multiple of the --elem size", ERROR);
+        compress_indices(rc->pattern, rc->pattern_len, elem, compress_page);
+
+        if (rc->kernel == GS || rc->kernel == MULTISCATTER) {
+            compress_indices(rc->pattern_scatter, rc->pattern_scatter_len, elem, compress_page);
+        }
+
+        if (rc->kernel == GS || rc->kernel == MULTIGATHER) {
+            compress_indices(rc->pattern_gather, rc->pattern_gather_len, elem, compress_page);
+        }
+    }
+
+    spIdx_t max_pattern_val;
+    ssize_t pattern_delta;
+
+    if (rc->kernel == MULTISCATTER) {
+        spIdx_t max_pattern_val_outer = remap_pattern(nrc, rc->pattern, rc->pattern_len, rc->boundary);
+        spIdx_t max_pattern_val_inner = remap_pattern(nrc, rc->pattern_scatter, rc->pattern_scatter_len, rc->boundary);
+
+        assert(rc->pattern_len > max_pattern_val_inner);
+
+        max_pattern_val = max_pattern_val_outer >= max_pattern_val_inner ? max_pattern_val_outer : max_pattern_val_inner;
+        pattern_delta = rc->delta >= rc->delta_scatter ? rc->delta : rc->delta_scatter;
+    }
+    else if (rc->kernel == MULTIGATHER) {
+        spIdx_t max_pattern_val_outer = remap_pattern(nrc, rc->pattern, rc->pattern_len, rc->boundary);
+        spIdx_t max_pattern_val_inner = remap_pattern(nrc, rc->pattern_gather, rc->pattern_gather_len, rc->boundary);
+
+        assert(rc->pattern_len > max_pattern_val_inner);
+
+        max_pattern_val = max_pattern_val_outer >= max_pattern_val_inner ? max_pattern_val_outer : max_pattern_val_inner;
+        pattern_delta = rc->delta >= rc->delta_gather ? rc->delta : rc->delta_gather;
+    }
+    else if (rc->kernel == GS) {
+        spIdx_t max_pattern_val_gather = remap_pattern(nrc, rc->pattern_gather, rc->pattern_gather_len, rc->boundary);
+        spIdx_t max_pattern_val_scatter = remap_pattern(nrc, rc->pattern_scatter, rc->pattern_scatter_len, rc->boundary);
+        max_pattern_val = max_pattern_val_gather >= max_pattern_val_scatter ? max_pattern_val_gather : max_pattern_val_scatter;
+    
+        pattern_delta = rc->delta_gather >= rc->delta_scatter ? rc->delta_gather : rc->delta_scatter;
+    }
+    else {
+        max_pattern_val = remap_pattern(nrc, rc->pattern, rc->pattern_len, rc->boundary);
+        
+        pattern_delta = rc->delta;
+    }
+    //printf("count: %zu, delta: %zu, %zu\n", rc->generic_len, rc->delta, rc->generic_len*rc->delta);
+
+    // Sized in elements of --elem, rounded up to whole sgData_t
+    size_t elem = sp_elem_size(rc);
+    size_t cur_source_size = (size_t)(((size_t)max_pattern_val + 1) + (rc->generic_len-1)*pattern_delta) * elem;
+    cur_source_size = (cur_source_size + sizeof(sgData_t) - 1) / sizeof(sgData_t) * sizeof(sgData_t);
+    //printf("max_pattern_val: %zu, source_size %zu\n", max_pattern_val, cur_source_size);
+    //printf("\n");
+    *source_size = cur_source_size;
+
+    size_t cur_target_size;
+    if (rc->kernel == GS) {
+        cur_target_size = ((max_pattern_val + 1) + (rc->generic_len-1)*pattern_delta) * sizeof(sgData_t);
+    }
+    else {
+        cur_target_size = (rc->pattern_len * elem * rc->wrap + sizeof(sgData_t) - 1) / sizeof(sgData_t) * sizeof(sgData_t);
+    }
+    *target_size = cur_target_size;
+
+    // The orders cover dim^2 or dim^3 points, one per Gather or Scatter
+    int ro_dims = rc->ro_morton ? rc->ro_morton : rc->ro_hilbert;
+    if ((ro_dims == 2 && isqrt(rc->generic_len) * isqrt(rc->generic_len) != rc->generic_len) ||
+        (ro_dims == 3 && icbrt(rc->generic_len) * icbrt(rc->generic_len) * icbrt(rc->generic_len) != rc->generic_len)) {
+        error("-l must be a square for --morton=2 or --hilbert=2 and a cube for --morton=3 or --hilbert=3", ERROR);
+    }
+
+    if (rc->ro_morton == 1) {
+        rc->ro_order = z_order_1d(rc->generic_len, rc->ro_block);
+    } else if (rc->ro_morton == 2) {
+        rc->ro_order = z_order_2d(isqrt(rc->generic_len), rc->ro_block);
+    } else if (rc->ro_morton == 3) {
+        rc->ro_order = z_order_3d(icbrt(rc->generic_len), rc->ro_block);
+    }
+
+    if (rc->ro_hilbert == 1) {
+        //yes, use z order function
+        rc->ro_order = z_order_1d(rc->generic_len, rc->ro_block);
+    } else if (rc->ro_hilbert == 2) {
+        rc->ro_order = h_order_2d(isqrt(rc->generic_len), rc->ro_block);
+    } else if (rc->ro_hilbert == 3) {
+        rc->ro_order = h_order_3d(icbrt(rc->generic_len), rc->ro_block);
+    }
+
+    if ((rc->ro_hilbert || rc->ro_morton) && !rc->ro_order) {
+        error("Unable to generate reorder pattern.", ERROR);
+    }
+
+    if (rc->random_dist != RANDOM_UNIFORM && rc->random_seed >= 1 && !rc->random_bases)
+        rc->random_bases = random_bases(rc);
+
+    if (rc->index_bits == 16 || rc->index_bits == 32) {
+        rc->pattern_narrow = sp_narrow_pattern(rc->pattern, rc->pattern_len, rc->index_bits);
+        rc->pattern_gather_narrow = sp_narrow_pattern(rc->pattern_gather, rc->pattern_gather_len, rc->index_bits);
+        rc->pattern_scatter_narrow = sp_narrow_pattern(rc->pattern_scatter, rc->pattern_scatter_len, rc->index_bits);
+    }
+
+    if (inner_stream_flag && (rc->kernel == MULTIGATHER || rc->kernel == MULTISCATTER)) {
+        if (rc->random_seed >= 1 || rc->ro_morton || rc->ro_hilbert || rc->deltas_len > 1 ||
+                rc->index_bits == 16 || rc->index_bits == 32 || rc->op != OP_COPY)
+            error("--inner-stream can not be combined with --random, --morton, --hilbert, --index-bits, accumulate ops or multiple deltas", ERROR);
+        size_t inner_len = rc->kernel == MULTIGATHER ? rc->pattern_gather_len : rc->pattern_scatter_len;
+        rc->inner_stream = (ssize_t*) sp_malloc(sizeof(ssize_t), rc->generic_len * inner_len, ALIGN_CACHE);
+        for (size_t j = 0; j < rc->generic_len * inner_len; j++)
+            rc->inner_stream[j] = sp_rand_bounded(1, j, rc->pattern_len);
+    }
+}
+
+// Offset of the i-th of n Gathers or Scatters, the way the kernels of rc
+// take it. The Multi kernels draw their random offsets without the table
+// of --random-dist, and only Gathers have multiple deltas.
+size_t sp_config_base(const struct run_config *rc, size_t delta, size_t i, size_t n) {
+    int multi = rc->kernel == MULTIGATHER || rc->kernel == MULTISCATTER;
+    if (rc->random_seed >= 1 && rc->kernel != GS)
+        return delta * (rc->random_bases && !multi ? rc->random_bases[i] : sp_rand_bounded(rc->random_seed, i, (uint32_t)n));
+    if (rc->deltas_len > 1 && (rc->kernel == GATHER || rc->kernel == MULTIGATHER))
+        return (i / rc->deltas_len) * rc->deltas_ps[rc->deltas_len - 1] + rc->deltas_ps[i % rc->deltas_len] - rc->deltas_ps[0];
+    if (rc->ro_morton || rc->ro_hilbert)
+        return delta * rc->ro_order[i];
+    return delta * i;
+}
+
+// Bytes one run of rc gathers or scatters
+size_t sp_config_bytes(const struct run_config *rc) {
+    if (rc->kernel == GS)
+        return sizeof(sgData_t) * (rc->pattern_scatter_len + rc->pattern_gather_len) * rc->generic_len;
+    return sp_elem_size(rc) * rc->pattern_len * rc->generic_len;
+}
+
+// From http://www.codecodex.com/wiki/Calculate_an_integer_square_root
+uint64_t isqrt(uint64_t x)
+{
+    uint64_t op, res, one;
+
+    op = x;
+    res = 0;
+
+    /* "one" starts at the highest power of four <= than the argument. */
+    one = 1 << 30;  /* second-to-top bit set */
+    while (one > op) one >>= 2;
+
+    while (one != 0) {
+
+        if (op >= res + one) {
+            op -= res + one;
+            res += one << 1;  // <-- faster than 2 * one
+        }
+        res >>= 1;
+        one >>= 2;
+    }
+    return res;
+}
+
+// From https://gist.github.com/anonymous/729557
+uint64_t icbrt(uint64_t x) {
+    int s;
+    uint64_t y;
+    uint64_t b;
+    y = 0;
+    for (s = 63; s >= 0; s -= 3) {
+        y += y;
+        b = 3*y*((uint64_t) y + 1) + 1;
+        if ((x >> s) >= b) {
+                x -= b << s;
+                y++;
+        }
+    }
+    return y;
+}
+
+// Remap large pattern with heap accesses to fit within Spatter 
+spIdx_t remap_pattern(const int nrc, ssize_t *pattern, const spSize_t pattern_len, ssize_t boundary) {
+    // A sparse source only backs the pages it touches, its span can be
+    // as large as the address space it may reserve
+    if (boundary == -1)
+        boundary = ((((sparse_source_flag ? SP_MAX_RESERVE : SP_MAX_ALLOC) - 1) / sizeof(sgData_t)) / nrc) / 2;
+  
+    // Only write entries that change, patterns may be mapped from a file
+    for (size_t j = 0; j < pattern_len; ++j) {
+        if (pattern[j] >= boundary || pattern[j] <= -boundary)
+            pattern[j] = pattern[j] % boundary;
+    }
+    
+    spIdx_t max_pattern_val = pattern[0];
+    for (size_t j = 0; j < pattern_len; j++) {
+        if (pattern[j] > max_pattern_val) {
+            max_pattern_val = pattern[j];
+        }
+    }
+
+    return max_pattern_val;
+}
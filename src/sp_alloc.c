@@ -8,16 +8,63 @@
 #include "parse-args.h" //error
 #include <stdio.h>
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#define SP_HAVE_HUGEPAGES
+#define SP_HAVE_RESERVE
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#endif
+
+#ifdef USE_LIBNUMA
+#include <numa.h>
+#endif
+
+#ifdef USE_MEMKIND
+#include <memkind.h>
+#endif
+
+#define SP_2M (2ul * 1024 * 1024)
+#define SP_1G (1024ul * 1024 * 1024)
 
 long long total_mem_used = 0;
+long long pool_mem_used[SP_NPOOLS] = {0};
+
+static enum sp_pool data_pool = SP_POOL_DEFAULT;
+
+// Data buffers remember where they came from so that sp_free can hand
+// them back to the right allocator
+struct sp_block {
+    void *ptr;
+    size_t size;
+    enum sp_pool pool;
+    int reserved; /**< from sp_reserve, not counted */
+    struct sp_block *next;
+};
+static struct sp_block *blocks = NULL;
 
 long long get_mem_used() {
     return total_mem_used;
 }
+
+long long get_pool_mem_used(enum sp_pool pool) {
+    return pool_mem_used[pool];
+}
+
 void check_size(size_t size) {
-    total_mem_used += size;
+    long long used;
+    // json configs are parsed concurrently
+    #pragma omp atomic capture
+    used = total_mem_used += size;
     //printf("size: %zu\n", size);
-    if (total_mem_used > SP_MAX_ALLOC) {
+    if (used > SP_MAX_ALLOC) {
         error("Too much memory used.", ERROR);
     }
 }
@@ -35,16 +82,22 @@ void check_safe_mult(size_t a, size_t b) {
 
 }
 
-void *sp_malloc (size_t size, size_t count, size_t align) {
-    check_safe_mult(size, count);
-    check_size(size*count);
+static void *aligned_malloc (size_t size, size_t align) {
 #ifdef USE_POSIX_MEMALIGN
     void *ptr = NULL;
-    int ret = posix_memalign (&ptr,align,size*count);
+    int ret = posix_memalign (&ptr,align,size);
     if (ret!=0) ptr = NULL;
 #else
-    void *ptr = aligned_alloc (align, size*count);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    void *ptr = aligned_alloc (align, (size + align - 1) / align * align);
 #endif
+    return ptr;
+}
+
+void *sp_malloc (size_t size, size_t count, size_t align) {
+    check_safe_mult(size, count);
+    check_size(size*count);
+    void *ptr = aligned_malloc (size*count, align);
     if (!ptr) {
         printf("Attempted to allocate %zu bytes (%zu * %zu)\n", size*count, size , count);
         error("Error: failed to allocate memory", ERROR);
@@ -57,3 +110,203 @@ void *sp_calloc (size_t size, size_t count, size_t align) {
     memset(ptr, 0, size*count);
     return ptr;
 }
+
+const char *sp_pool_name(enum sp_pool pool) {
+    switch (pool) {
+    case SP_POOL_DEFAULT:    return "default";
+    case SP_POOL_THP:        return "thp";
+    case SP_POOL_HUGETLB_2M: return "hugetlb-2m";
+    case SP_POOL_HUGETLB_1G: return "hugetlb-1g";
+    case SP_POOL_LIBNUMA:    return "libnuma";
+    case SP_POOL_MEMKIND:    return "memkind";
+    default:                 return "invalid";
+    }
+}
+
+void sp_set_data_pool(enum sp_pool pool) {
+    switch (pool) {
+    case SP_POOL_DEFAULT:
+        break;
+#ifdef SP_HAVE_HUGEPAGES
+    case SP_POOL_THP:
+    case SP_POOL_HUGETLB_2M:
+    case SP_POOL_HUGETLB_1G:
+        break;
+#endif
+#ifdef USE_LIBNUMA
+    case SP_POOL_LIBNUMA:
+        if (numa_available() < 0)
+            error("libnuma reports that NUMA is not available", ERROR);
+        break;
+#endif
+#ifdef USE_MEMKIND
+    case SP_POOL_MEMKIND:
+        if (memkind_check_available(MEMKIND_HBW) != 0)
+            error("memkind reports that no high-bandwidth memory is available", ERROR);
+        break;
+#endif
+    default:
+        error("Requested allocator is not available in this build", ERROR);
+    }
+    data_pool = pool;
+}
+
+enum sp_pool sp_get_data_pool(void) {
+    return data_pool;
+}
+
+void *sp_data_malloc (size_t size, size_t count, size_t align) {
+    check_safe_mult(size, count);
+    size_t bytes = size * count;
+    void *ptr = NULL;
+
+    switch (data_pool) {
+#ifdef SP_HAVE_HUGEPAGES
+    case SP_POOL_THP:
+        // Align to the huge page size so the whole buffer can be backed by
+        // huge pages, then ask khugepaged/the fault handler to use them
+        bytes = (bytes + SP_2M - 1) / SP_2M * SP_2M;
+        ptr = aligned_malloc(bytes, SP_2M);
+        if (ptr && madvise(ptr, bytes, MADV_HUGEPAGE) != 0)
+            error("madvise(MADV_HUGEPAGE) failed, transparent huge pages may be disabled", WARN);
+        break;
+    case SP_POOL_HUGETLB_2M:
+    case SP_POOL_HUGETLB_1G: {
+        size_t page = data_pool == SP_POOL_HUGETLB_2M ? SP_2M : SP_1G;
+        int flag = data_pool == SP_POOL_HUGETLB_2M ? MAP_HUGE_2MB : MAP_HUGE_1GB;
+        bytes = (bytes + page - 1) / page * page;
+        ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flag, -1, 0);
+        if (ptr == MAP_FAILED) {
+            ptr = NULL;
+            printf("Attempted to map %zu bytes of %s pages\n", bytes, sp_pool_name(data_pool));
+            error("mmap(MAP_HUGETLB) failed, check /proc/sys/vm/nr_hugepages", ERROR);
+        }
+        break;
+    }
+#endif
+#ifdef USE_LIBNUMA
+    case SP_POOL_LIBNUMA:
+        ptr = numa_alloc_local(bytes);
+        break;
+#endif
+#ifdef USE_MEMKIND
+    case SP_POOL_MEMKIND:
+        if (memkind_posix_memalign(MEMKIND_HBW_PREFERRED, &ptr, align, bytes) != 0)
+            ptr = NULL;
+        break;
+#endif
+    default:
+        ptr = aligned_malloc(bytes, align);
+        break;
+    }
+
+    if (!ptr) {
+        printf("Attempted to allocate %zu bytes (%zu * %zu) from %s\n", bytes, size, count, sp_pool_name(data_pool));
+        error("Error: failed to allocate memory", ERROR);
+    }
+
+    check_size(bytes);
+    pool_mem_used[data_pool] += bytes;
+
+    struct sp_block *b = (struct sp_block *)malloc(sizeof(struct sp_block));
+    b->ptr = ptr;
+    b->size = bytes;
+    b->pool = data_pool;
+    b->reserved = 0;
+    b->next = blocks;
+    blocks = b;
+
+    return ptr;
+}
+
+void *sp_reserve (size_t size) {
+    if (size > SP_MAX_RESERVE) {
+        printf("Attempted to reserve %zu bytes\n", size);
+        error("--sparse-source can not reserve that much address space", ERROR);
+    }
+    void *ptr = NULL;
+#ifdef SP_HAVE_RESERVE
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        printf("Attempted to reserve %zu bytes\n", size);
+        error("mmap(MAP_NORESERVE) failed, check /proc/sys/vm/overcommit_memory", ERROR);
+    }
+    madvise(ptr, size, data_pool == SP_POOL_THP ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+    error("--sparse-source needs mmap(MAP_NORESERVE), which this build does not have", ERROR);
+#endif
+
+    struct sp_block *b = (struct sp_block *)malloc(sizeof(struct sp_block));
+    b->ptr = ptr;
+    b->size = size;
+    b->pool = data_pool;
+    b->reserved = 1;
+    b->next = blocks;
+    blocks = b;
+    return ptr;
+}
+
+void sp_reserve_reset (void *ptr, size_t size) {
+#ifdef SP_HAVE_RESERVE
+    if (madvise(ptr, size, MADV_DONTNEED) != 0)
+        error("madvise(MADV_DONTNEED) failed, the sparse source keeps the pages of the last config", WARN);
+#else
+    (void)ptr;
+    (void)size;
+#endif
+}
+
+void sp_free (void *ptr) {
+    if (!ptr)
+        return;
+
+    struct sp_block **prev = &blocks;
+    struct sp_block *b = blocks;
+    while (b && b->ptr != ptr) {
+        prev = &b->next;
+        b = b->next;
+    }
+
+    // Not a data buffer, came from sp_malloc
+    if (!b) {
+        free(ptr);
+        return;
+    }
+
+#ifdef SP_HAVE_RESERVE
+    if (b->reserved) {
+        munmap(ptr, b->size);
+        *prev = b->next;
+        free(b);
+        return;
+    }
+#endif
+
+    switch (b->pool) {
+#ifdef SP_HAVE_HUGEPAGES
+    case SP_POOL_HUGETLB_2M:
+    case SP_POOL_HUGETLB_1G:
+        munmap(ptr, b->size);
+        break;
+#endif
+#ifdef USE_LIBNUMA
+    case SP_POOL_LIBNUMA:
+        numa_free(ptr, b->size);
+        break;
+#endif
+#ifdef USE_MEMKIND
+    case SP_POOL_MEMKIND:
+        memkind_free(MEMKIND_HBW_PREFERRED, ptr);
+        break;
+#endif
+    default:
+        free(ptr);
+        break;
+    }
+
+    total_mem_used -= b->size;
+    pool_mem_used[b->pool] -= b->size;
+    *prev = b->next;
+    free(b);
+}
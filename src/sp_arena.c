@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include "sp_arena.h"
+#include "parse-args.h" //error
+
+static struct sp_arena_chunk *new_chunk(size_t size, struct sp_arena_chunk *next) {
+    struct sp_arena_chunk *c = (struct sp_arena_chunk *)malloc(sizeof(struct sp_arena_chunk) + size);
+    if (!c)
+        error("Error: failed to allocate arena chunk", ERROR);
+    c->next = next;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+void *sp_arena_alloc(struct sp_arena *arena, size_t size, size_t count, size_t align) {
+    if (count && size > SIZE_MAX / count)
+        error("Error: Multiplication would overflow.", ERROR);
+    size_t bytes = size * count;
+    struct sp_arena_chunk *c = arena->head;
+
+    if (c) {
+        uintptr_t cur = (uintptr_t)(c->data + c->used);
+        size_t pad = (align - (cur & (align - 1))) & (align - 1);
+        if (c->used + pad + bytes <= c->size) {
+            c->used += pad + bytes;
+            return (void *)(cur + pad);
+        }
+    }
+
+    // Oversized requests go in their own chunk behind the current one, so
+    // the space left in the current chunk is not wasted
+    if (bytes + align > SP_ARENA_CHUNK && c) {
+        c->next = new_chunk(bytes + align, c->next);
+        c = c->next;
+    } else {
+        size_t chunk = bytes + align > SP_ARENA_CHUNK ? bytes + align : SP_ARENA_CHUNK;
+        c = arena->head = new_chunk(chunk, c);
+    }
+
+    uintptr_t cur = (uintptr_t)c->data;
+    size_t pad = (align - (cur & (align - 1))) & (align - 1);
+    c->used = pad + bytes;
+    return (void *)(cur + pad);
+}
+
+void sp_arena_reset(struct sp_arena *arena) {
+    struct sp_arena_chunk *c = arena->head;
+    if (!c)
+        return;
+
+    // Keep one regular sized chunk for the next round
+    struct sp_arena_chunk *keep = NULL;
+    while (c) {
+        struct sp_arena_chunk *next = c->next;
+        if (!keep && c->size == SP_ARENA_CHUNK) {
+            keep = c;
+        } else {
+            free(c);
+        }
+        c = next;
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->head = keep;
+}
+
+void sp_arena_destroy(struct sp_arena *arena) {
+    struct sp_arena_chunk *c = arena->head;
+    while (c) {
+        struct sp_arena_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    arena->head = NULL;
+}
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include "sp_rand.h"
+#include "pcg_basic.h"
+
+void sp_rand_fill(sgData_t *buf, size_t len, uint64_t seed, uint32_t range, int nthreads)
+{
+    size_t nblocks = (len + SP_RAND_BLOCK - 1) / SP_RAND_BLOCK;
+    (void)nthreads;
+    #pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (size_t b = 0; b < nblocks; b++) {
+        pcg32_random_t rng;
+        pcg32_srandom_r(&rng, seed, b);
+        size_t end = (b + 1) * SP_RAND_BLOCK < len ? (b + 1) * SP_RAND_BLOCK : len;
+        for (size_t i = b * SP_RAND_BLOCK; i < end; i++)
+            buf[i] = pcg32_boundedrand_r(&rng, range);
+    }
+}
+
+void sp_rand_shuffle(size_t *v, size_t n, uint64_t seed)
+{
+    for (size_t k = n; k > 1; k--) {
+        size_t r = sp_rand_bounded(seed, n - k, (uint32_t)k);
+        size_t tmp = v[k - 1];
+        v[k - 1] = v[r];
+        v[r] = tmp;
+    }
+}
+
+void sp_alias_build(struct sp_alias_entry *t, const double *w, uint32_t n)
+{
+    double sum = 0;
+    for (uint32_t j = 0; j < n; j++)
+        sum += w[j];
+
+    // Columns below and above the mean, paired off: a small column keeps its
+    // own share and takes the rest of the mean from a large one
+    double *p = (double *)malloc(n * sizeof(double));
+    uint32_t *small = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint32_t *large = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint32_t ns = 0, nl = 0;
+    for (uint32_t j = 0; j < n; j++) {
+        p[j] = w[j] * n / sum;
+        if (p[j] < 1)
+            small[ns++] = j;
+        else
+            large[nl++] = j;
+    }
+    while (ns && nl) {
+        uint32_t s = small[--ns], l = large[nl - 1];
+        t[s].cut = (uint32_t)(p[s] * 4294967296.0);
+        t[s].alias = l;
+        p[l] -= 1 - p[s];
+        if (p[l] < 1) {
+            nl--;
+            small[ns++] = l;
+        }
+    }
+    // What is left is full, up to rounding
+    while (nl) {
+        uint32_t l = large[--nl];
+        t[l].cut = UINT32_MAX;
+        t[l].alias = l;
+    }
+    while (ns) {
+        uint32_t s = small[--ns];
+        t[s].cut = UINT32_MAX;
+        t[s].alias = s;
+    }
+    free(p);
+    free(small);
+    free(large);
+}
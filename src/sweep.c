@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "sweep.h"
+#include "parse-args.h"
+#include "sp_alloc.h"
+
+struct range
+{
+    unsigned long long start, end, step;
+    int mul;
+};
+
+// A number, or b^e. Sets *base to b for the second form, 0 otherwise.
+static int parse_num(const char **p, const char *end, unsigned long long *v, unsigned long long *base)
+{
+    const char *s = *p;
+    unsigned long long x = 0;
+    *base = 0;
+
+    if (s == end || !isdigit((unsigned char)*s))
+        return 0;
+    while (s < end && isdigit((unsigned char)*s))
+        x = x * 10 + (*s++ - '0');
+
+    if (s < end && *s == '^') {
+        unsigned long long e = 0, b = x;
+        s++;
+        if (s == end || !isdigit((unsigned char)*s))
+            return 0;
+        while (s < end && isdigit((unsigned char)*s))
+            e = e * 10 + (*s++ - '0');
+        if (e > 63)
+            error ("Sweep exponent larger than 63", ERROR);
+        x = 1;
+        for (unsigned long long i = 0; i < e; i++) {
+            if (b > 1 && x > ~0ULL / b)
+                error ("Sweep value is too large", ERROR);
+            x *= b;
+        }
+        *base = b;
+    }
+    *p = s;
+    *v = x;
+    return 1;
+}
+
+static int is_range(const char *g, size_t len)
+{
+    for (size_t i = 0; i + 1 < len; i++)
+        if (g[i] == '.' && g[i + 1] == '.')
+            return 1;
+    return 0;
+}
+
+static void parse_range(const char *g, size_t len, struct range *r)
+{
+    const char *p = g, *end = g + len;
+    unsigned long long b0, b1;
+
+    if (!parse_num(&p, end, &r->start, &b0) || end - p < 2 || p[0] != '.' || p[1] != '.')
+        error ("Sweep ranges are {start..end[:step]}", ERROR);
+    p += 2;
+    if (!parse_num(&p, end, &r->end, &b1))
+        error ("Sweep ranges are {start..end[:step]}", ERROR);
+
+    r->mul = 0;
+    r->step = 1;
+    if (b0 > 1 && b0 == b1) {
+        r->mul = 1;
+        r->step = b0;
+    }
+
+    if (p < end) {
+        unsigned long long b;
+        if (*p++ != ':')
+            error ("Sweep ranges are {start..end[:step]}", ERROR);
+        r->mul = 0;
+        if (p < end && (*p == 'x' || *p == '*')) {
+            r->mul = 1;
+            p++;
+        } else if (p < end && *p == '+') {
+            p++;
+        }
+        if (!parse_num(&p, end, &r->step, &b) || p != end)
+            error ("Sweep steps are +n or xn", ERROR);
+    }
+
+    if (r->start > r->end)
+        error ("Sweep range ends before it starts", ERROR);
+    if (r->mul && (r->step < 2 || r->start == 0))
+        error ("Sweep xn steps need n >= 2 and a start of at least 1", ERROR);
+    if (!r->mul && r->step == 0)
+        error ("Sweep +n steps need n >= 1", ERROR);
+}
+
+static size_t range_count(const struct range *r)
+{
+    if (!r->mul)
+        return (size_t)((r->end - r->start) / r->step + 1);
+
+    size_t n = 1;
+    for (unsigned long long v = r->start; v <= r->end / r->step; v *= r->step)
+        n++;
+    return n;
+}
+
+static unsigned long long range_value(const struct range *r, size_t j)
+{
+    if (!r->mul)
+        return r->start + j * r->step;
+
+    unsigned long long v = r->start;
+    while (j--)
+        v *= r->step;
+    return v;
+}
+
+// The number of items of a list group. If item is not NULL, item j goes
+// to [*item, *item + *item_len), empty if there are fewer items.
+static size_t list_item(const char *g, size_t len, size_t j, const char **item, size_t *item_len)
+{
+    size_t n = 0;
+    const char *s = g, *end = g + len;
+    if (item) {
+        *item = end;
+        *item_len = 0;
+    }
+    for (;;) {
+        const char *c = memchr(s, ',', end - s);
+        const char *e = c ? c : end;
+        if (item && n == j) {
+            *item = s;
+            *item_len = e - s;
+        }
+        n++;
+        if (!c)
+            return n;
+        s = c + 1;
+    }
+}
+
+static size_t group_count(const char *g, size_t len)
+{
+    if (is_range(g, len)) {
+        struct range r;
+        parse_range(g, len, &r);
+        return range_count(&r);
+    }
+    return list_item(g, len, 0, NULL, NULL);
+}
+
+// Writes value j of the group to out and returns its length
+static size_t group_value(const char *g, size_t len, size_t j, char *out)
+{
+    if (is_range(g, len)) {
+        struct range r;
+        parse_range(g, len, &r);
+        return (size_t)sprintf(out, "%llu", range_value(&r, j));
+    }
+
+    const char *item, *p;
+    size_t item_len;
+    unsigned long long v, b;
+    list_item(g, len, j, &item, &item_len);
+    p = item;
+    if (parse_num(&p, item + item_len, &v, &b) && b && p == item + item_len)
+        return (size_t)sprintf(out, "%llu", v);
+    memcpy(out, item, item_len);
+    return item_len;
+}
+
+// The next group at or after s: [*g, *g + *len) is its text between the braces
+static int next_group(const char *s, const char **g, size_t *len)
+{
+    const char *open = strchr(s, '{');
+    if (!open)
+        return 0;
+    const char *close = strchr(open + 1, '}');
+    if (!close)
+        return 0;
+    *g = open + 1;
+    *len = close - open - 1;
+    return 1;
+}
+
+static size_t arg_count(const char *arg)
+{
+    const char *g;
+    size_t len, n = 1;
+    while (next_group(arg, &g, &len)) {
+        n *= group_count(g, len);
+        if (n > SP_MAX_SWEEP)
+            return n;
+        arg = g + len + 1;
+    }
+    return n;
+}
+
+// Value j of a single argument; the last group varies fastest
+static char *arg_value(const char *arg, size_t j)
+{
+    const char *g;
+    size_t len, ngroups = 0, counts[64];
+
+    for (const char *s = arg; next_group(s, &g, &len); s = g + len + 1) {
+        if (ngroups == 64)
+            error ("More than 64 sweep groups in one argument", ERROR);
+        counts[ngroups++] = group_count(g, len);
+    }
+
+    size_t idx[64];
+    for (size_t i = ngroups; i-- > 0; ) {
+        idx[i] = j % counts[i];
+        j /= counts[i];
+    }
+
+    char *out = (char *)sp_malloc(1, strlen(arg) + 24 * ngroups + 1, ALIGN_CACHE);
+    char *o = out;
+    const char *s = arg;
+    for (size_t i = 0; next_group(s, &g, &len); i++) {
+        memcpy(o, s, (g - 1) - s);
+        o += (g - 1) - s;
+        o += group_value(g, len, idx[i], o);
+        s = g + len + 1;
+    }
+    strcpy(o, s);
+    return out;
+}
+
+size_t sp_sweep_count(int argc, char **argv)
+{
+    size_t n = 1;
+    for (int i = 1; i < argc; i++) {
+        n *= arg_count(argv[i]);
+        if (n > SP_MAX_SWEEP)
+            error ("Sweep expands to more than 2^20 configs", ERROR);
+    }
+    return n;
+}
+
+char **sp_sweep_argv(int argc, char **argv, size_t k)
+{
+    char **out = (char **)sp_malloc(sizeof(char *), argc, ALIGN_CACHE);
+    for (int i = argc - 1; i >= 1; i--) {
+        size_t n = arg_count(argv[i]);
+        out[i] = arg_value(argv[i], k % n);
+        k /= n;
+    }
+    out[0] = (char *)sp_malloc(1, strlen(argv[0]) + 1, ALIGN_CACHE);
+    strcpy(out[0], argv[0]);
+    return out;
+}
+
+void sp_sweep_free(int argc, char **argv)
+{
+    for (int i = 0; i < argc; i++)
+        free(argv[i]);
+    free(argv);
+}
@@ -0,0 +1,237 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#include "trace-stream.h"
+#include "sp_alloc.h"
+#include "parse-args.h" //error
+
+struct sp_trace_stream {
+    size_t chunk;
+
+    // Uncompressed traces
+    uint64_t *map;
+    size_t map_bytes;
+    size_t map_len;
+    size_t pos;
+    uintptr_t dropped;
+    int mem; /**< map is an sp_malloc'ed stream, not a file */
+
+#ifdef USE_ZLIB
+    // Gzip'd traces. The helper fills buf[b] while the caller holds the other
+    gzFile gz;
+    pthread_t helper;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t *buf[2];
+    size_t len[2];
+    int full[2];
+    int cur;
+    int held;
+    int done;
+    int stop;
+#endif
+};
+
+#ifdef USE_ZLIB
+static void *trace_helper(void *arg) {
+    struct sp_trace_stream *s = (struct sp_trace_stream *)arg;
+    int b = 0;
+
+    pthread_mutex_lock(&s->lock);
+    while (!s->stop) {
+        while (s->full[b] && !s->stop)
+            pthread_cond_wait(&s->cond, &s->lock);
+        if (s->stop)
+            break;
+        pthread_mutex_unlock(&s->lock);
+
+        int bytes = gzread(s->gz, s->buf[b], sizeof(uint64_t) * s->chunk);
+        if (bytes < 0)
+            error("Failed to decompress trace", ERROR);
+
+        pthread_mutex_lock(&s->lock);
+        s->len[b] = bytes / sizeof(uint64_t);
+        s->full[b] = 1;
+        pthread_cond_broadcast(&s->cond);
+        // An empty buffer marks the end of the trace
+        if (s->len[b] == 0)
+            break;
+        b ^= 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static void trace_start(struct sp_trace_stream *s) {
+    s->full[0] = s->full[1] = 0;
+    s->cur = 0;
+    s->held = -1;
+    s->done = 0;
+    s->stop = 0;
+    if (pthread_create(&s->helper, NULL, trace_helper, s) != 0)
+        error("Unable to start trace decompression thread", ERROR);
+}
+
+static void trace_stop(struct sp_trace_stream *s) {
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->helper, NULL);
+}
+#endif
+
+static int is_gzip(const char *file) {
+    unsigned char magic[2] = {0, 0};
+    FILE *fp = fopen(file, "rb");
+    if (!fp)
+        error("Unable to open trace file", ERROR);
+    size_t n = fread(magic, 1, 2, fp);
+    fclose(fp);
+    return n == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+struct sp_trace_stream *sp_trace_open(const char *file, size_t chunk) {
+    struct sp_trace_stream *s = (struct sp_trace_stream *)calloc(1, sizeof(struct sp_trace_stream));
+    s->chunk = chunk ? chunk : SP_TRACE_CHUNK;
+
+    if (is_gzip(file)) {
+#ifdef USE_ZLIB
+        s->gz = gzopen(file, "rb");
+        if (!s->gz)
+            error("Unable to open trace file", ERROR);
+        gzbuffer(s->gz, 1 << 20);
+        s->buf[0] = (uint64_t *)sp_malloc(sizeof(uint64_t), s->chunk, ALIGN_PAGE);
+        s->buf[1] = (uint64_t *)sp_malloc(sizeof(uint64_t), s->chunk, ALIGN_PAGE);
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->cond, NULL);
+        trace_start(s);
+        return s;
+#else
+        error("Gzip'd traces need a build with zlib", ERROR);
+#endif
+    }
+
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+        error("Unable to open trace file", ERROR);
+    s->map_bytes = st.st_size;
+    s->map_len = st.st_size / sizeof(uint64_t);
+    if (s->map_len == 0)
+        error("Trace file is empty", ERROR);
+    s->map = (uint64_t *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (s->map == MAP_FAILED)
+        error("Unable to mmap trace file", ERROR);
+    madvise(s->map, st.st_size, MADV_SEQUENTIAL);
+    return s;
+}
+
+struct sp_trace_stream *sp_trace_open_mem(uint64_t *idx, size_t len, size_t chunk) {
+    struct sp_trace_stream *s = (struct sp_trace_stream *)calloc(1, sizeof(struct sp_trace_stream));
+    s->chunk = chunk ? chunk : SP_TRACE_CHUNK;
+    s->map = idx;
+    s->map_len = len;
+    s->mem = 1;
+    return s;
+}
+
+size_t sp_trace_next(struct sp_trace_stream *s, const uint64_t **chunk) {
+#ifdef USE_ZLIB
+    if (s->gz) {
+        pthread_mutex_lock(&s->lock);
+        // Hand the previous chunk back to the helper
+        if (s->held >= 0) {
+            s->full[s->held] = 0;
+            s->held = -1;
+            pthread_cond_broadcast(&s->cond);
+        }
+        if (s->done) {
+            pthread_mutex_unlock(&s->lock);
+            return 0;
+        }
+        while (!s->full[s->cur])
+            pthread_cond_wait(&s->cond, &s->lock);
+        size_t n = s->len[s->cur];
+        *chunk = s->buf[s->cur];
+        if (n == 0) {
+            s->done = 1;
+        } else {
+            s->held = s->cur;
+            s->cur ^= 1;
+        }
+        pthread_mutex_unlock(&s->lock);
+        return n;
+    }
+#endif
+    if (s->pos >= s->map_len)
+        return 0;
+    size_t n = s->map_len - s->pos < s->chunk ? s->map_len - s->pos : s->chunk;
+    if (s->mem) {
+        *chunk = s->map + s->pos;
+        s->pos += n;
+        return n;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t base = (uintptr_t)s->map;
+    // Drop the chunk that was just consumed so the mapping never holds more
+    // than a couple of chunks, the data is read back from the file on rewind
+    uintptr_t consumed = (base + sizeof(uint64_t) * s->pos) & ~(uintptr_t)(page - 1);
+    if (consumed > base + s->dropped) {
+        madvise((void *)(base + s->dropped), consumed - base - s->dropped, MADV_DONTNEED);
+        s->dropped = consumed - base;
+    }
+
+    *chunk = s->map + s->pos;
+    s->pos += n;
+    // Start reading the next chunk in while this one is consumed
+    if (s->pos < s->map_len) {
+        uintptr_t next = (base + sizeof(uint64_t) * s->pos) & ~(uintptr_t)(page - 1);
+        madvise((void *)next, sizeof(uint64_t) * s->chunk, MADV_WILLNEED);
+    }
+    return n;
+}
+
+void sp_trace_rewind(struct sp_trace_stream *s) {
+#ifdef USE_ZLIB
+    if (s->gz) {
+        trace_stop(s);
+        gzrewind(s->gz);
+        trace_start(s);
+        return;
+    }
+#endif
+    s->pos = 0;
+    s->dropped = 0;
+}
+
+void sp_trace_close(struct sp_trace_stream *s) {
+#ifdef USE_ZLIB
+    if (s->gz) {
+        trace_stop(s);
+        gzclose(s->gz);
+        free(s->buf[0]);
+        free(s->buf[1]);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->cond);
+    }
+#endif
+    if (s->mem)
+        sp_free(s->map);
+    else if (s->map)
+        munmap(s->map, s->map_bytes);
+    free(s);
+}
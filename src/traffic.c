@@ -0,0 +1,430 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "traffic.h"
+#include "sgtype.h"
+#include "numa-util.h"
+#include "sp-run.h"
+
+size_t sp_line_size(void)
+{
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+    long line = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    if (line > 0)
+        return (size_t)line;
+#endif
+    return 64;
+}
+
+size_t sp_l1_size(void)
+{
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    long size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    if (size > 0)
+        return (size_t)size;
+#endif
+    return 32768;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static size_t count_unique(uint64_t *ids, size_t n)
+{
+    if (n == 0)
+        return 0;
+    qsort(ids, n, sizeof(uint64_t), compare_u64);
+    size_t u = 1;
+    for (size_t i = 1; i < n; i++)
+        if (ids[i] != ids[i-1])
+            u++;
+    return u;
+}
+
+// Offset of gather/scatter i into the sparse buffer, the same way the
+// kernels compute it
+static size_t sparse_base(const size_t *deltas_ps, size_t deltas_len, size_t delta, size_t i)
+{
+    if (deltas_ps && deltas_len > 1)
+        return (i / deltas_len) * deltas_ps[deltas_len-1] + deltas_ps[i % deltas_len] - deltas_ps[0];
+    return delta * i;
+}
+
+// Distinct lines touched by n gathers/scatters of outer (indexed through
+// inner for the Multi kernels, advanced by inner_step per gather for
+// --inner-stream). The first gathers are simulated and the count scaled up
+// to n. Without reuse each gather is counted on its own.
+// Elements of elem bytes count every line they overlap.
+// The inner pattern of the Multi kernels, the stream of them with
+// --inner-stream
+#define INNER(rc, pat) ((rc)->inner_stream ? (rc)->inner_stream : (pat))
+#define INNER_STEP(rc, len) ((rc)->inner_stream ? (len) : 0)
+
+static double sparse_lines(const ssize_t *outer, const ssize_t *inner, size_t inner_step, size_t pat_len,
+        const size_t *deltas_ps, size_t deltas_len, size_t delta, size_t n, int reuse, size_t line, size_t elem)
+{
+    if (n == 0 || pat_len == 0)
+        return 0;
+
+    size_t k = SP_TRAFFIC_SAMPLE / pat_len;
+    if (k < 1)
+        k = 1;
+    if (k > n)
+        k = n;
+
+    size_t span = (elem + line - 2) / line + 1;
+    uint64_t *ids = (uint64_t *)malloc(sizeof(uint64_t) * span * (reuse ? k * pat_len : pat_len));
+    if (!ids)
+        return 0;
+
+    size_t total = 0;
+    size_t m = 0;
+    for (size_t i = 0; i < k; i++) {
+        size_t base = sparse_base(deltas_ps, deltas_len, delta, i);
+        const ssize_t *in = inner ? inner + inner_step * i : NULL;
+        for (size_t j = 0; j < pat_len; j++) {
+            ssize_t idx = in ? outer[in[j]] : outer[j];
+            uint64_t first = (uint64_t)(base + idx) * elem;
+            for (uint64_t l = first / line; l <= (first + elem - 1) / line; l++)
+                ids[m++] = l;
+        }
+        if (!reuse) {
+            total += count_unique(ids, m);
+            m = 0;
+        }
+    }
+    if (reuse)
+        total = count_unique(ids, m);
+
+    free(ids);
+    return (double)total * n / k;
+}
+
+void sp_traffic_model(const struct run_config *rc, struct sp_traffic *t)
+{
+    size_t line = sp_line_size();
+    size_t n = rc->generic_len;
+    int reuse = rc->random_seed < 1;
+    size_t idx = rc->index_bits ? (size_t)rc->index_bits / 8 : sizeof(spIdx_t);
+    double lines = 0;
+
+    if (rc->kernel == GS)
+        t->useful = sizeof(sgData_t) * (rc->pattern_scatter_len + rc->pattern_gather_len) * n;
+    else
+        t->useful = sp_elem_size(rc) * rc->pattern_len * n;
+
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        if (rc->type == TRACE) {
+            t->index = n * sizeof(uint64_t);
+            lines = n;
+        } else {
+            t->index = rc->pattern_len * idx;
+            // The bases --random-dist drew before the runs
+            if (rc->random_dist != RANDOM_UNIFORM)
+                t->index += n * sizeof(uint32_t);
+            // Only Gather has a multi-delta kernel
+            lines = sparse_lines(rc->pattern, NULL, 0, rc->pattern_len,
+                    rc->kernel == GATHER ? rc->deltas_ps : NULL, rc->deltas_len, rc->delta, n, reuse, line, sp_elem_size(rc));
+        }
+        // Streamed Scatters skip the read for ownership, streamed Gathers
+        // send their dense rows to memory
+        if (rc->kernel == SCATTER && rc->store != STORE_NT)
+            lines *= 2;
+        if (rc->kernel == GATHER && rc->store == STORE_NT)
+            lines += (double)t->useful / line;
+        break;
+    case CHASE:
+        // Every slot once per run, in the order of its chain
+        t->index = rc->pattern_len * idx;
+        lines = sparse_lines(rc->pattern, NULL, 0, rc->pattern_len, NULL, 0, rc->delta, n, reuse, line, sizeof(sgData_t));
+        break;
+    case MULTIGATHER:
+        t->index = (rc->pattern_len + rc->pattern_gather_len) * idx;
+        if (rc->inner_stream)
+            t->index += n * rc->pattern_gather_len * sizeof(ssize_t);
+        lines = sparse_lines(rc->pattern, INNER(rc, rc->pattern_gather), INNER_STEP(rc, rc->pattern_gather_len), rc->pattern_gather_len,
+                rc->deltas_ps, rc->deltas_len, rc->delta, n, reuse, line, sizeof(sgData_t));
+        break;
+    case MULTISCATTER:
+        t->index = (rc->pattern_len + rc->pattern_scatter_len) * idx;
+        if (rc->inner_stream)
+            t->index += n * rc->pattern_scatter_len * sizeof(ssize_t);
+        lines = 2 * sparse_lines(rc->pattern, INNER(rc, rc->pattern_scatter), INNER_STEP(rc, rc->pattern_scatter_len), rc->pattern_scatter_len,
+                NULL, 0, rc->delta, n, reuse, line, sizeof(sgData_t));
+        break;
+    case GS:
+        t->index = (rc->pattern_gather_len + rc->pattern_scatter_len) * idx;
+        lines = sparse_lines(rc->pattern_gather, NULL, 0, rc->pattern_gather_len, NULL, 0, rc->delta_gather, n, 1, line, sizeof(sgData_t))
+            + (rc->store == STORE_NT ? 1 : 2) * sparse_lines(rc->pattern_scatter, NULL, 0, rc->pattern_scatter_len, NULL, 0, rc->delta_scatter, n, 1, line, sizeof(sgData_t));
+        break;
+    default:
+        t->index = 0;
+        break;
+    }
+
+    t->lines = (size_t)(lines * line);
+}
+
+double sp_traffic_pages(const struct run_config *rc, size_t page)
+{
+    size_t n = rc->generic_len;
+    int reuse = rc->random_seed < 1;
+
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        if (rc->type == TRACE)
+            return 0;
+        return sparse_lines(rc->pattern, NULL, 0, rc->pattern_len,
+                rc->kernel == GATHER ? rc->deltas_ps : NULL, rc->deltas_len, rc->delta, n, reuse, page, sp_elem_size(rc));
+    case CHASE:
+        return sparse_lines(rc->pattern, NULL, 0, rc->pattern_len, NULL, 0, rc->delta, n, reuse, page, sizeof(sgData_t));
+    case MULTIGATHER:
+        return sparse_lines(rc->pattern, INNER(rc, rc->pattern_gather), INNER_STEP(rc, rc->pattern_gather_len), rc->pattern_gather_len,
+                rc->deltas_ps, rc->deltas_len, rc->delta, n, reuse, page, sizeof(sgData_t));
+    case MULTISCATTER:
+        return sparse_lines(rc->pattern, INNER(rc, rc->pattern_scatter), INNER_STEP(rc, rc->pattern_scatter_len), rc->pattern_scatter_len,
+                NULL, 0, rc->delta, n, reuse, page, sizeof(sgData_t));
+    case GS:
+        return sparse_lines(rc->pattern_gather, NULL, 0, rc->pattern_gather_len, NULL, 0, rc->delta_gather, n, 1, page, sizeof(sgData_t))
+            + sparse_lines(rc->pattern_scatter, NULL, 0, rc->pattern_scatter_len, NULL, 0, rc->delta_scatter, n, 1, page, sizeof(sgData_t));
+    default:
+        return 0;
+    }
+}
+
+#define SECTOR_SIZE 32
+#define WARP_SIZE 32
+#define WARP_LINE_SIZE 128
+
+// Distinct units of unit bytes that the m elements at byte offsets addr
+// overlap, left sorted and without duplicates in ids, which must hold
+// every unit of every element
+static size_t unique_units(const uint64_t *addr, size_t m, size_t elem, size_t unit, uint64_t *ids)
+{
+    size_t u = 0;
+    for (size_t j = 0; j < m; j++)
+        for (uint64_t l = addr[j] / unit; l <= (addr[j] + elem - 1) / unit; l++)
+            ids[u++] = l;
+    if (u == 0)
+        return 0;
+    qsort(ids, u, sizeof(uint64_t), compare_u64);
+    size_t d = 1;
+    for (size_t j = 1; j < u; j++)
+        if (ids[j] != ids[d - 1])
+            ids[d++] = ids[j];
+    return d;
+}
+
+// The sums of sp_pattern_analyze for one side of a config
+struct side_stats
+{
+    double lines, sectors, pages, warp_lines, warps, useful;
+    double reused, paired; // lines also in the one before, lines of all but the first
+    size_t k; // Gathers/Scatters sampled
+};
+
+// The Gathers or Scatters start where sp_config_base puts them for rc,
+// at delta * i if rc is NULL
+static void analyze_side(const struct run_config *rc, const ssize_t *outer, const ssize_t *inner, size_t inner_step,
+        size_t pat_len, size_t delta, size_t n, size_t elem, struct side_stats *st)
+{
+    memset(st, 0, sizeof(*st));
+    if (n == 0 || pat_len == 0)
+        return;
+
+    // At least two, for the reuse between them
+    size_t k = SP_ANALYZE_SAMPLE / pat_len;
+    if (k < 2)
+        k = 2;
+    if (k > n)
+        k = n;
+    st->k = k;
+
+    size_t line = sp_line_size();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t span = (elem + SECTOR_SIZE - 2) / SECTOR_SIZE + 1;
+    uint64_t *addr = (uint64_t *)malloc(sizeof(uint64_t) * k * pat_len);
+    uint64_t *ids = (uint64_t *)malloc(sizeof(uint64_t) * span * (pat_len > WARP_SIZE ? pat_len : WARP_SIZE));
+    uint64_t *prev = (uint64_t *)malloc(sizeof(uint64_t) * span * pat_len);
+    if (!addr || !ids || !prev) {
+        free(addr);
+        free(ids);
+        free(prev);
+        st->k = 0;
+        return;
+    }
+
+    // Byte offsets of every sampled element, as the kernels index them
+    for (size_t i = 0; i < k; i++) {
+        uint64_t base = rc ? sp_config_base(rc, delta, i, n) : delta * i;
+        uint64_t *a = addr + i * pat_len;
+        if (inner) {
+            const ssize_t *in = inner + inner_step * i;
+            for (size_t j = 0; j < pat_len; j++)
+                a[j] = (base + outer[in[j]]) * elem;
+        } else {
+            for (size_t j = 0; j < pat_len; j++)
+                a[j] = (base + outer[j]) * elem;
+        }
+    }
+
+    size_t nprev = 0;
+    for (size_t i = 0; i < k; i++) {
+        const uint64_t *a = addr + i * pat_len;
+        st->sectors += unique_units(a, pat_len, elem, SECTOR_SIZE, ids);
+        st->pages += unique_units(a, pat_len, elem, page, ids);
+        size_t nl = unique_units(a, pat_len, elem, line, ids);
+        st->lines += nl;
+
+        // ids now holds the lines, merge them with those of the last one
+        if (i > 0) {
+            st->paired += nl;
+            size_t x = 0, y = 0;
+            while (x < nprev && y < nl) {
+                uint64_t p = prev[x], c = ids[y];
+                if (p == c)
+                    st->reused++;
+                x += p <= c;
+                y += c <= p;
+            }
+        }
+        memcpy(prev, ids, sizeof(uint64_t) * nl);
+        nprev = nl;
+    }
+
+    // Warps of 32 consecutive (Gather, pattern entry) pairs
+    size_t total = k * pat_len;
+    for (size_t t = 0; t < total; t += WARP_SIZE) {
+        size_t m = total - t < WARP_SIZE ? total - t : WARP_SIZE;
+        st->warp_lines += unique_units(addr + t, m, elem, WARP_LINE_SIZE, ids);
+        st->warps++;
+    }
+
+    st->useful = (double)k * pat_len * elem;
+    free(addr);
+    free(ids);
+    free(prev);
+}
+
+void sp_pattern_analyze(const struct run_config *rc, struct sp_pattern_stats *s)
+{
+    struct side_stats st[2];
+    int sides = 1;
+    memset(s, 0, sizeof(*s));
+    memset(st, 0, sizeof(st));
+
+    size_t n = rc->generic_len;
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        if (rc->type == TRACE)
+            return;
+        analyze_side(rc, rc->pattern, NULL, 0, rc->pattern_len, rc->delta, n, sp_elem_size(rc), &st[0]);
+        break;
+    case CHASE:
+        analyze_side(NULL, rc->pattern, NULL, 0, rc->pattern_len, rc->delta, n, sizeof(sgData_t), &st[0]);
+        break;
+    case MULTIGATHER:
+        analyze_side(rc, rc->pattern, INNER(rc, rc->pattern_gather), INNER_STEP(rc, rc->pattern_gather_len), rc->pattern_gather_len,
+                rc->delta, n, sizeof(sgData_t), &st[0]);
+        break;
+    case MULTISCATTER:
+        analyze_side(rc, rc->pattern, INNER(rc, rc->pattern_scatter), INNER_STEP(rc, rc->pattern_scatter_len), rc->pattern_scatter_len,
+                rc->delta, n, sizeof(sgData_t), &st[0]);
+        break;
+    case GS:
+        analyze_side(rc, rc->pattern_gather, NULL, 0, rc->pattern_gather_len, rc->delta_gather, n, sizeof(sgData_t), &st[0]);
+        analyze_side(rc, rc->pattern_scatter, NULL, 0, rc->pattern_scatter_len, rc->delta_scatter, n, sizeof(sgData_t), &st[1]);
+        sides = 2;
+        break;
+    default:
+        return;
+    }
+
+    double useful = 0, reused = 0, paired = 0, warp_lines = 0, warps = 0;
+    for (int d = 0; d < sides; d++) {
+        if (st[d].k == 0)
+            continue;
+        s->lines += st[d].lines / st[d].k;
+        s->sectors += st[d].sectors / st[d].k;
+        s->pages += st[d].pages / st[d].k;
+        useful += st[d].useful / st[d].k;
+        reused += st[d].reused;
+        paired += st[d].paired;
+        warp_lines += st[d].warp_lines;
+        warps += st[d].warps;
+    }
+    s->warp_lines = warps > 0 ? warp_lines / warps : 0;
+    s->reuse = paired > 0 ? reused / paired : 0;
+    s->efficiency = s->lines > 0 ? useful / (s->lines * sp_line_size()) : 0;
+}
+
+// Add the bytes of n gathers/scatters, sampled evenly, to the node of the
+// page each element is on
+static void sparse_nodes(const ssize_t *outer, const ssize_t *inner, size_t inner_step, size_t pat_len,
+        const size_t *deltas_ps, size_t deltas_len, size_t delta, size_t n, size_t elem,
+        const struct sp_page_map *map, double *bytes)
+{
+    if (n == 0 || pat_len == 0 || !map->node)
+        return;
+
+    size_t k = SP_TRAFFIC_SAMPLE / pat_len;
+    if (k < 1)
+        k = 1;
+    if (k > n)
+        k = n;
+
+    double scale = (double)n / k;
+    for (size_t s = 0; s < k; s++) {
+        size_t i = s * n / k;
+        size_t base = sparse_base(deltas_ps, deltas_len, delta, i);
+        const ssize_t *in = inner ? inner + inner_step * i : NULL;
+        for (size_t j = 0; j < pat_len; j++) {
+            ssize_t idx = in ? outer[in[j]] : outer[j];
+            size_t p = (map->offset + (base + idx) * elem) / map->page;
+            if (p < map->npages && map->node[p] != SP_NUMA_UNKNOWN)
+                bytes[map->node[p]] += elem * scale;
+        }
+    }
+}
+
+void sp_traffic_nodes(const struct run_config *rc, const struct sp_page_map *source, const struct sp_page_map *target, double *bytes)
+{
+    size_t n = rc->generic_len;
+    for (int i = 0; i < SP_MAX_NUMA_NODES; i++)
+        bytes[i] = 0;
+
+    switch (rc->kernel) {
+    case GATHER:
+    case SCATTER:
+        if (rc->type != TRACE)
+            sparse_nodes(rc->pattern, NULL, 0, rc->pattern_len, rc->kernel == GATHER ? rc->deltas_ps : NULL, rc->deltas_len,
+                    rc->delta, n, sp_elem_size(rc), source, bytes);
+        break;
+    case CHASE:
+        sparse_nodes(rc->pattern, NULL, 0, rc->pattern_len, NULL, 0, rc->delta, n, sizeof(sgData_t), source, bytes);
+        break;
+    case MULTIGATHER:
+        sparse_nodes(rc->pattern, INNER(rc, rc->pattern_gather), INNER_STEP(rc, rc->pattern_gather_len), rc->pattern_gather_len,
+                rc->deltas_ps, rc->deltas_len, rc->delta, n, sizeof(sgData_t), source, bytes);
+        break;
+    case MULTISCATTER:
+        sparse_nodes(rc->pattern, INNER(rc, rc->pattern_scatter), INNER_STEP(rc, rc->pattern_scatter_len), rc->pattern_scatter_len,
+                NULL, 0, rc->delta, n, sizeof(sgData_t), source, bytes);
+        break;
+    case GS:
+        sparse_nodes(rc->pattern_gather, NULL, 0, rc->pattern_gather_len, NULL, 0, rc->delta_gather, n, sizeof(sgData_t), source, bytes);
+        sparse_nodes(rc->pattern_scatter, NULL, 0, rc->pattern_scatter_len, NULL, 0, rc->delta_scatter, n, sizeof(sgData_t), target, bytes);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "validate.h"
+#include "sp_alloc.h"
+#include "sp_rand.h"
+#include "output.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+#endif
+
+extern enum sg_backend backend;
+extern int sparse_source_flag;
+
+// Seed of the dense values of a Scatter check
+#define SP_VALIDATE_SEED 0x5eed
+
+// The share of the element e at position p in a checksum. Positions never
+// written hold zeros and add nothing.
+static uint64_t share(size_t p, const char *e, size_t es) {
+    for (size_t b = 0; b < es; b++)
+        if (e[b])
+            return sp_rand_at(sp_output_hash(e, es), p);
+    return 0;
+}
+
+// The element a Scatter check writes to position p: never zero, and with
+// the second bit of every 4-byte word clear, never a NaN of any float type
+// that a copy could change
+static void dense_value(size_t p, char *e, size_t es) {
+    size_t words = (es + 7) / 8;
+    for (size_t b = 0; b < es; b += 8) {
+        uint64_t v = sp_rand_at(SP_VALIDATE_SEED, p * words + b / 8);
+        memcpy(e + b, &v, es - b < 8 ? es - b : 8);
+    }
+    for (size_t b = 3; b < es; b += 4)
+        e[b] &= ~0x40;
+    e[0] |= 1;
+}
+
+// The j-th index of a Gather or Scatter of rc and their number
+static size_t index_of(const struct run_config *rc, size_t j) {
+    if (rc->kernel == MULTIGATHER)
+        return rc->pattern[rc->pattern_gather[j]];
+    if (rc->kernel == MULTISCATTER)
+        return rc->pattern[rc->pattern_scatter[j]];
+    return rc->pattern[j];
+}
+
+static size_t indices(const struct run_config *rc) {
+    if (rc->kernel == MULTIGATHER)
+        return rc->pattern_gather_len;
+    if (rc->kernel == MULTISCATTER)
+        return rc->pattern_scatter_len;
+    return rc->pattern_len;
+}
+
+static int negative_index(const ssize_t *pat, size_t len) {
+    for (size_t j = 0; pat && j < len; j++)
+        if (pat[j] < 0)
+            return 1;
+    return 0;
+}
+
+// Why rc can not be checked, NULL if it can
+static const char *unchecked(const struct run_config *rc) {
+    if (rc->type == TRACE)
+        return "trace";
+    if (rc->kernel == CHASE)
+        return "pointer chase";
+    // The Scatter check clears and scans every element of the span
+    if (sparse_source_flag && (rc->kernel == SCATTER || rc->kernel == MULTISCATTER))
+        return "sparse source";
+    if (rc->op != OP_COPY)
+        return "accumulate op";
+    if (rc->inner_stream)
+        return "inner stream";
+    if (negative_index(rc->pattern, rc->pattern_len) || negative_index(rc->pattern_gather, rc->pattern_gather_len) ||
+            negative_index(rc->pattern_scatter, rc->pattern_scatter_len))
+        return "negative index";
+    return NULL;
+}
+
+// Count of a check run whose dense buffers take bytes per Gather or Scatter
+static size_t check_count(const struct run_config *rc, size_t bytes) {
+    size_t n = SP_VALIDATE_BYTES / bytes;
+    if (n < 1)
+        n = 1;
+    return n < rc->generic_len ? n : rc->generic_len;
+}
+
+static void check_gather(sp_run_fn run, struct run_config *rc, sgDataBuf *source, size_t es, size_t nthreads, struct sp_check *check) {
+    size_t V = indices(rc);
+    size_t n = check_count(rc, V * es * nthreads);
+    size_t bytes = (n * V * es + sizeof(sgData_t) - 1) / sizeof(sgData_t) * sizeof(sgData_t);
+    sgDataBuf src, tgt;
+    memset(&src, 0, sizeof(src));
+    memset(&tgt, 0, sizeof(tgt));
+    src.host_ptr = source->host_ptr;
+    src.len = source->len;
+    src.size = source->size;
+    tgt.nptrs = nthreads;
+    tgt.len = bytes / sizeof(sgData_t);
+    tgt.size = bytes;
+    tgt.host_ptrs = (sgData_t **)malloc(nthreads * sizeof(sgData_t *));
+    for (size_t t = 0; t < nthreads; t++) {
+        tgt.host_ptrs[t] = (sgData_t *)sp_malloc(1, bytes, ALIGN_CACHE);
+        memset(tgt.host_ptrs[t], 0, bytes);
+    }
+    tgt.host_ptr = tgt.host_ptrs[0];
+
+    struct run_config v = *rc;
+    v.generic_len = n;
+    v.wrap = n;
+    run(&v, &src, &tgt, NULL, NULL);
+
+    uint64_t expected = 0, actual = 0;
+    const char *sl = (const char *)source->host_ptr;
+    #pragma omp parallel for reduction(+:expected)
+    for (size_t i = 0; i < n; i++) {
+        size_t b = sp_config_base(&v, v.delta, i, n);
+        for (size_t j = 0; j < V; j++)
+            expected += share(i * V + j, sl + (b + index_of(&v, j)) * es, es);
+    }
+    // Each slot is written by one thread, the others keep it zero
+    for (size_t t = 0; t < nthreads; t++) {
+        const char *tl = (const char *)tgt.host_ptrs[t];
+        #pragma omp parallel for reduction(+:actual)
+        for (size_t s = 0; s < n * V; s++)
+            actual += share(s, tl + s * es, es);
+        sp_free(tgt.host_ptrs[t]);
+    }
+    free(tgt.host_ptrs);
+    check->count = n;
+    check->expected = expected;
+    check->actual = actual;
+}
+
+static void check_scatter(sp_run_fn run, struct run_config *rc, sgDataBuf *source, size_t es, size_t nthreads, struct sp_check *check) {
+    size_t V = indices(rc);
+    size_t n = check_count(rc, V * es);
+    struct run_config v = *rc;
+    v.generic_len = n;
+    v.wrap = n;
+
+    // Positions [0, span) of the source are scattered to
+    size_t span = 0;
+    #pragma omp parallel for reduction(max:span)
+    for (size_t i = 0; i < n; i++) {
+        size_t b = sp_config_base(&v, v.delta, i, n);
+        for (size_t j = 0; j < V; j++)
+            if (b + index_of(&v, j) + 1 > span)
+                span = b + index_of(&v, j) + 1;
+    }
+
+    // One dense buffer, read by every thread
+    size_t bytes = (n * V * es + sizeof(sgData_t) - 1) / sizeof(sgData_t) * sizeof(sgData_t);
+    char *dense = (char *)sp_malloc(1, bytes, ALIGN_CACHE);
+    #pragma omp parallel for
+    for (size_t i = 0; i < n; i++) {
+        size_t b = sp_config_base(&v, v.delta, i, n);
+        for (size_t j = 0; j < V; j++)
+            dense_value(b + index_of(&v, j), dense + (i * V + j) * es, es);
+    }
+    sgDataBuf src, tgt;
+    memset(&src, 0, sizeof(src));
+    memset(&tgt, 0, sizeof(tgt));
+    src.host_ptr = source->host_ptr;
+    src.len = source->len;
+    src.size = source->size;
+    tgt.nptrs = nthreads;
+    tgt.len = bytes / sizeof(sgData_t);
+    tgt.size = bytes;
+    tgt.host_ptrs = (sgData_t **)malloc(nthreads * sizeof(sgData_t *));
+    for (size_t t = 0; t < nthreads; t++)
+        tgt.host_ptrs[t] = (sgData_t *)dense;
+    tgt.host_ptr = (sgData_t *)dense;
+
+    char *sparse = (char *)source->host_ptr;
+    memset(sparse, 0, span * es);
+    run(&v, &src, &tgt, NULL, NULL);
+
+    uint64_t *touched = (uint64_t *)calloc(span / 64 + 1, sizeof(uint64_t));
+    #pragma omp parallel for
+    for (size_t i = 0; i < n; i++) {
+        size_t b = sp_config_base(&v, v.delta, i, n);
+        for (size_t j = 0; j < V; j++) {
+            size_t p = b + index_of(&v, j);
+            #pragma omp atomic
+            touched[p / 64] |= (uint64_t)1 << (p % 64);
+        }
+    }
+    uint64_t expected = 0, actual = 0;
+    #pragma omp parallel for reduction(+:expected,actual)
+    for (size_t p = 0; p < span; p++) {
+        char e[SP_MAX_ELEM_BYTES];
+        if (touched[p / 64] >> (p % 64) & 1) {
+            dense_value(p, e, es);
+            expected += share(p, e, es);
+        }
+        actual += share(p, sparse + p * es, es);
+    }
+
+    // The values do not depend on the thread count, the source is as before
+    random_data(source->host_ptr, (span * es + sizeof(sgData_t) - 1) / sizeof(sgData_t), (int)nthreads);
+    free(touched);
+    free(tgt.host_ptrs);
+    sp_free(dense);
+    check->count = n;
+    check->expected = expected;
+    check->actual = actual;
+}
+
+// GS gathers from the source into the target. Scatters that overlap write
+// different values in any order, they are not checked.
+static void check_gs(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_check *check) {
+    size_t n = rc->generic_len;
+    size_t glen = rc->pattern_gather_len, slen = rc->pattern_scatter_len;
+    size_t es = sizeof(sgData_t);
+
+    size_t span = 0;
+    #pragma omp parallel for reduction(max:span)
+    for (size_t i = 0; i < n; i++) {
+        size_t b = sp_config_base(rc, rc->delta_scatter, i, n);
+        for (size_t j = 0; j < slen; j++)
+            if (b + rc->pattern_scatter[j] + 1 > span)
+                span = b + rc->pattern_scatter[j] + 1;
+    }
+    char *sparse = (char *)target->host_ptr;
+    memset(sparse, 0, span * es);
+
+    sgDataBuf rd, wr;
+    memset(&rd, 0, sizeof(rd));
+    memset(&wr, 0, sizeof(wr));
+    rd.host_ptr = source->host_ptr;
+    rd.len = source->len;
+    rd.size = source->size;
+    wr.host_ptr = target->host_ptr;
+    wr.len = target->len;
+    wr.size = target->size;
+    // The Serial GS kernel gathers from its target and scatters to its
+    // source, so its timed runs left the source with the target's zeros
+    if (backend == SERIAL) {
+        random_data(source->host_ptr, source->len, 1);
+        run(rc, &wr, &rd, NULL, NULL);
+    } else {
+        run(rc, &rd, &wr, NULL, NULL);
+    }
+
+    uint64_t *touched = (uint64_t *)calloc(span / 64 + 1, sizeof(uint64_t));
+    uint64_t expected = 0, actual = 0;
+    int overlap = 0;
+    const char *sl = (const char *)source->host_ptr;
+    #pragma omp parallel for reduction(+:expected) reduction(|:overlap)
+    for (size_t i = 0; i < n; i++) {
+        size_t bs = sp_config_base(rc, rc->delta_scatter, i, n);
+        size_t bg = sp_config_base(rc, rc->delta_gather, i, n);
+        for (size_t j = 0; j < slen; j++) {
+            size_t p = bs + rc->pattern_scatter[j];
+            uint64_t bit = (uint64_t)1 << (p % 64), old;
+            #pragma omp atomic capture
+            { old = touched[p / 64]; touched[p / 64] |= bit; }
+            overlap |= (old & bit) != 0;
+            expected += share(p, sl + (bg + rc->pattern_gather[j % glen]) * es, es);
+        }
+    }
+    #pragma omp parallel for reduction(+:actual)
+    for (size_t p = 0; p < span; p++)
+        actual += share(p, sparse + p * es, es);
+    free(touched);
+
+    check->count = n;
+    check->expected = expected;
+    check->actual = actual;
+    if (overlap)
+        check->why = "overlapping Scatters";
+}
+
+void sp_validate(sp_run_fn run, struct run_config *rc, sgDataBuf *source, sgDataBuf *target, struct sp_check *check) {
+    memset(check, 0, sizeof(*check));
+    check->why = unchecked(rc);
+    if (check->why)
+        return;
+
+    size_t nthreads = 1;
+#ifdef USE_OPENMP
+    if (backend == OPENMP)
+        nthreads = omp_get_max_threads();
+#endif
+    size_t es = rc->kernel == GATHER || rc->kernel == SCATTER ? sp_elem_size(rc) : sizeof(sgData_t);
+    if (rc->kernel == GS)
+        check_gs(run, rc, source, target, check);
+    else if (rc->kernel == GATHER || rc->kernel == MULTIGATHER)
+        check_gather(run, rc, source, es, nthreads, check);
+    else
+        check_scatter(run, rc, source, es, nthreads, check);
+
+    if (!check->why)
+        check->status = check->expected == check->actual ? CHECK_PASSED : CHECK_FAILED;
+}
@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "backend-support-tests.h"
+#include "../src/openmp/openmp_kernels.h"
+#include "../src/openmp/openmp_simd_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (301)
+
+typedef void (*accum_fn)(sgData_t*, sgData_t**, ssize_t*, size_t, size_t, size_t, size_t);
+
+// Patterns that repeat indices, including several times within one vector.
+// The data is small integers so every summation order gives the same result.
+int accum_test(const char *what, accum_fn fn, size_t pat_len, size_t dup, size_t delta)
+{
+    size_t wrap = 3;
+    int nt = 1;
+#ifdef USE_OPENMP
+    nt = omp_get_max_threads();
+#endif
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = (j * 5) % dup;
+
+    size_t len = dup + delta * N;
+    sgData_t *sparse = malloc(sizeof(sgData_t) * len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * len);
+    for (size_t i = 0; i < len; i++)
+        sparse[i] = ref[i] = (sgData_t)(i % 3);
+
+    sgData_t **dense = malloc(sizeof(sgData_t*) * nt);
+    for (int t = 0; t < nt; t++) {
+        dense[t] = malloc(sizeof(sgData_t) * pat_len * wrap);
+        for (size_t i = 0; i < pat_len * wrap; i++)
+            dense[t][i] = (sgData_t)(i % 7) + 1;
+    }
+
+    // Every thread has the same dense buffer, so the reference reads thread 0's
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = 0; j < pat_len; j++)
+            ref[delta * i + pat[j]] += dense[0][pat_len * (i % wrap) + j];
+    fn(sparse, dense, pat, pat_len, delta, N, wrap);
+
+    int rc = EXIT_SUCCESS;
+    if (memcmp(sparse, ref, sizeof(sgData_t) * len)) {
+        printf("Test failure on %s with pattern length %zu, %zu distinct indices, delta %zu\n", what, pat_len, dup, delta);
+        rc = EXIT_FAILURE;
+    }
+
+    for (int t = 0; t < nt; t++)
+        free(dense[t]);
+    free(dense);
+    free(pat);
+    free(sparse);
+    free(ref);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    size_t lens[] = {1, 3, 8, 13, 16, 27, 64};
+    size_t dups[] = {1, 2, 3, 8, 64};
+
+    for (size_t i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+        for (size_t j = 0; j < sizeof(dups)/sizeof(dups[0]); j++) {
+            size_t d = dups[j];
+            // Plain and conflict accumulate are only exact when the scatters
+            // of different iterations do not overlap
+            if (accum_test("ACCUM", scatter_smallbuf_accum, lens[i], d, d) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+            if (accum_test("CONFLICT", scatter_smallbuf_conflict, lens[i], d, d) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+            if (accum_test("ATOMIC", scatter_smallbuf_atomic, lens[i], d, 1) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+            if (accum_test("ATOMIC", scatter_smallbuf_atomic, lens[i], d, 0) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
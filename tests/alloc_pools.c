@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp_alloc.h"
+
+// Every pool that is available on every Linux build (HugeTLB is left out,
+// it needs pages reserved by the administrator)
+int pool_test(enum sp_pool pool) {
+    size_t size = 3 * 1024 * 1024 + 17;
+
+    sp_set_data_pool(pool);
+    long long before = get_mem_used();
+
+    char *buf = (char *)sp_data_malloc(size, 1, ALIGN_PAGE);
+    if ((size_t)buf % ALIGN_PAGE != 0) {
+        printf("Test failure on %s: buffer not page aligned\n", sp_pool_name(pool));
+        return EXIT_FAILURE;
+    }
+    memset(buf, 1, size);
+
+    if (get_pool_mem_used(pool) < (long long)size || get_mem_used() - before < (long long)size) {
+        printf("Test failure on %s: allocation not accounted\n", sp_pool_name(pool));
+        return EXIT_FAILURE;
+    }
+
+    sp_free(buf);
+    if (get_pool_mem_used(pool) != 0 || get_mem_used() != before) {
+        printf("Test failure on %s: free not accounted\n", sp_pool_name(pool));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    enum sp_pool pools[] = {SP_POOL_DEFAULT,
+#ifdef __linux__
+        SP_POOL_THP,
+#endif
+#ifdef USE_LIBNUMA
+        SP_POOL_LIBNUMA,
+#endif
+    };
+
+    for (size_t i = 0; i < sizeof(pools)/sizeof(pools[0]); i++) {
+        if (pool_test(pools[i]) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    sp_set_data_pool(SP_POOL_DEFAULT);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "parse-args.h"
+#include "traffic.h"
+
+static double tol;
+
+static int close_to(double x, double want)
+{
+    return fabs(x - want) <= tol * want + 1e-9;
+}
+
+// Uniform stride patterns of len entries, whose footprint can be worked
+// out by hand for 64-byte lines
+static int analyze_test(size_t len, size_t stride, size_t delta, double lines, double sectors,
+        double warp_lines, double reuse, double efficiency)
+{
+    ssize_t *pat = malloc(sizeof(ssize_t) * len);
+    for (size_t j = 0; j < len; j++)
+        pat[j] = j * stride;
+
+    struct run_config rc = {0};
+    rc.kernel = GATHER;
+    rc.type = UNIFORM;
+    rc.pattern = pat;
+    rc.pattern_len = len;
+    rc.delta = delta;
+    rc.deltas_len = 1;
+    rc.generic_len = 1 << 12;
+
+    struct sp_pattern_stats s;
+    sp_pattern_analyze(&rc, &s);
+    free(pat);
+    if (!close_to(s.lines, lines) || !close_to(s.sectors, sectors) || !close_to(s.warp_lines, warp_lines) ||
+        !close_to(s.pages, 1) || !close_to(s.reuse, reuse) || !close_to(s.efficiency, efficiency)) {
+        printf("Test failure on the analysis of UNIFORM:%zu:%zu delta %zu: %g lines, %g sectors, %g warp lines, %g pages, %g reuse, %g efficiency\n",
+                len, stride, delta, s.lines, s.sectors, s.warp_lines, s.pages, s.reuse, s.efficiency);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (sp_line_size() != 64) {
+        printf("Skipping pattern analysis test for %zu byte cache lines\n", sp_line_size());
+        return EXIT_SUCCESS;
+    }
+
+    // One line per Gather, a warp covers four of them
+    if (analyze_test(8, 1, 8, 1, 2, 2, 0, 1) ||
+        // Every element in its own sector, two to a line
+        analyze_test(16, 4, 64, 8, 16, 8, 0, 0.25))
+        return EXIT_FAILURE;
+    // Gathers one element apart: 7 in 8 straddle two lines, a warp covers
+    // 11 elements, and 14 of the 15 lines of every 8 Gathers were touched
+    // by the one before. Only close, the sample does not end on a cycle
+    // and a few Gathers straddle pages.
+    tol = 0.02;
+    if (analyze_test(8, 1, 1, 1.875, 2.75, 1.5, 14. / 15, 1 / 1.875))
+        return EXIT_FAILURE;
+
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --analyze -q3") != 0 ||
+        system("../spatter -kGS -gUNIFORM:8:1 -hUNIFORM:4:2 -l1024 --analyze --output=json:analyze.json > /dev/null") != 0) {
+        printf("Test failure: an --analyze config did not run\n");
+        return EXIT_FAILURE;
+    }
+    FILE *f = fopen("analyze.json", "r");
+    char buf[8192];
+    int found = 0;
+    while (f && fgets(buf, sizeof(buf), f))
+        found |= strstr(buf, "\"analysis\":{\"lines\":2,") != NULL;
+    if (f)
+        fclose(f);
+    remove("analyze.json");
+    if (!found) {
+        printf("Test failure: the JSON record has no analysis of the GS\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
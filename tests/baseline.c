@@ -0,0 +1,64 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define CONFIG "../spatter -pUNIFORM:8:1 -l4096 -R5 -q3"
+
+// Copy the records of from to to with the times of every run set to t
+static int retime(const char *from, const char *to, const char *t)
+{
+    FILE *in = fopen(from, "r");
+    FILE *out = fopen(to, "w");
+    char line[65536];
+    if (!in || !out)
+        return -1;
+    while (fgets(line, sizeof(line), in)) {
+        char *times = strstr(line, "\"time_s\":[");
+        if (!times) {
+            fputs(line, out);
+            continue;
+        }
+        char *rest = strchr(times, ']');
+        fprintf(out, "%.*s\"time_s\":[%s,%s,%s,%s,%s%s", (int)(times - line), line, t, t, t, t, t, rest);
+    }
+    fclose(in);
+    fclose(out);
+    return 0;
+}
+
+static int status(const char *cmd)
+{
+    int s = system(cmd);
+    return WIFEXITED(s) ? WEXITSTATUS(s) : -1;
+}
+
+// A config far slower than its baseline fails the run with status 2, one
+// far faster passes, and one without a record passes
+int main(int argc, char **argv)
+{
+    if (status(CONFIG " --output=json:baseline_run.json") != 0 ||
+        retime("baseline_run.json", "baseline_fast.json", "1e-9") ||
+        retime("baseline_run.json", "baseline_slow.json", "100")) {
+        printf("Test failure: the baseline was not written\n");
+        return EXIT_FAILURE;
+    }
+    if (status(CONFIG " --baseline=baseline_fast.json") != 2) {
+        printf("Test failure: a regression against the baseline passed\n");
+        return EXIT_FAILURE;
+    }
+    if (status(CONFIG " --baseline=baseline_slow.json") != 0 ||
+        status("../spatter -pUNIFORM:4:1 -l64 --name=other -q3 --baseline=baseline_fast.json") != 0) {
+        printf("Test failure: a faster or unmatched config failed\n");
+        return EXIT_FAILURE;
+    }
+    if (status(CONFIG " --baseline=no_such_file.json > /dev/null 2>&1") == 0 ||
+        status(CONFIG " --baseline=baseline_fast.json --baseline-tolerance=-1 > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --baseline was accepted\n");
+        return EXIT_FAILURE;
+    }
+    remove("baseline_run.json");
+    remove("baseline_fast.json");
+    remove("baseline_slow.json");
+    return EXIT_SUCCESS;
+}
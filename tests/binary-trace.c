@@ -12,6 +12,27 @@ int gz_read_test() {
     return EXIT_SUCCESS;
 }
 
+int trace_replay_test() {
+    const char *traces[] = {"0.0.R.idx.gz:1000", "1.1.W.idx.gz"};
+    const char *kernels[] = {"Gather", "Scatter"};
+
+    for (size_t k = 0; k < 2; k++) {
+        char *command;
+        int ret = asprintf(&command, "../spatter -k%s -pTRACE:%s/%s -e4096 -R2", kernels[k], BINARY_TRACE_DIR, traces[k]);
+        if (ret == -1) {
+            printf("Test failure: unable to build the %s trace command\n", kernels[k]);
+            return EXIT_FAILURE;
+        }
+        ret = system(command);
+        if (ret != EXIT_SUCCESS)
+            printf("Test failure on %s\n", command);
+        free(command);
+        if (ret != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv) {
 #ifndef BINARY_TRACE_DIR
     printf("BINARY TRACE Directory not defined!\n");
@@ -21,6 +42,10 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
+    if (trace_replay_test() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 #endif
 }
@@ -0,0 +1,107 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "box.h"
+
+// Run spatter with --validate, 0 if it ran and every check passed: a
+// failed check exits with SP_EXIT_INVALID
+static int run(const char *args)
+{
+    char *command;
+    int ret = asprintf(&command, "../spatter %s --validate -q3 > /dev/null 2>&1", args);
+    if (ret == -1)
+        return -1;
+    ret = system(command) != EXIT_SUCCESS ? -1 : 0;
+    free(command);
+    return ret;
+}
+
+// Every face of a 3 x 4 x 5 box of 2-element cells against a direct walk
+// of the cells on that face
+static int check_faces(void)
+{
+    struct sp_box b = { { 3, 4, 5 }, 2, 0 };
+    ssize_t pat[64];
+    for (b.face = 0; b.face < 6; b.face++) {
+        int axis = b.face / 2, side = b.face % 2;
+        size_t j = 0;
+        for (size_t z = 0; z < b.dim[2]; z++)
+            for (size_t y = 0; y < b.dim[1]; y++)
+                for (size_t x = 0; x < b.dim[0]; x++) {
+                    size_t at[3] = { x, y, z };
+                    if (at[axis] != (side ? b.dim[axis] - 1 : 0))
+                        continue;
+                    for (size_t e = 0; e < b.cell; e++)
+                        pat[j++] = ((z * b.dim[1] + y) * b.dim[0] + x) * b.cell + e;
+                }
+        if (j != sp_box_len(&b)) {
+            printf("Test failure: face %s has %zu elements, not %zu\n", sp_box_face_name(b.face), sp_box_len(&b), j);
+            return -1;
+        }
+        ssize_t got[64];
+        sp_box_pattern(&b, got);
+        if (memcmp(got, pat, j * sizeof(ssize_t)) != 0) {
+            printf("Test failure: wrong pattern for face %s\n", sp_box_face_name(b.face));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Packs, Unpacks and Transposes of each face and cell width, with and
+// without the vector kernels, agree with --validate
+int main(int argc, char **argv)
+{
+    if (check_faces() != 0)
+        return EXIT_FAILURE;
+
+    struct sp_box b = { { 3, 2, 1 }, 2, -1 };
+    ssize_t soa[12], want[12] = { 0, 2, 4, 6, 8, 10, 1, 3, 5, 7, 9, 11 };
+    sp_box_pattern(&b, soa);
+    if (sp_box_len(&b) != 12 || memcmp(soa, want, sizeof(want)) != 0) {
+        printf("Test failure: wrong SoA pattern for BOX:3:2:1:2\n");
+        return EXIT_FAILURE;
+    }
+
+    const char *boxes[] = {
+        "-kPack -pBOX:8:8:8:3:x- -l1000",
+        "-kPack -pBOX:9:7:5:1:x+ -l1000 -t4",
+        "-kPack -pBOX:8:6:4:2:y+ -l1000",
+        "-kPack -pBOX:5:6:7:2:z- -l1000",
+        "-kPack -pBOX:9:7:5:1:x+ -l1000 -t4 --simd=auto",
+        "-kPack -pBOX:8:8:8:3:x- -l1000 --simd=auto",
+        "-kUnpack -pBOX:8:8:8:3:x+ -l1000 -t4",
+        "-kUnpack -pBOX:4:5:6:2:z+ -l1000",
+        "-kTranspose -pBOX:7:3:5:1 -l1000",
+        "-kTranspose -pBOX:7:3:5:2 -l1000 --simd=auto",
+        "-kTranspose -pBOX:7:3:5:3 -l1000 --simd=auto",
+        "-kTranspose -pBOX:7:3:5:4 -l1000 -t4 --simd=auto",
+        "-kTranspose -pBOX:7:3:5:6 -l1000 --simd=auto",
+    };
+    for (size_t i = 0; i < sizeof(boxes) / sizeof(boxes[0]); i++) {
+        if (run(boxes[i]) != 0) {
+            printf("Test failure: spatter %s did not pass\n", boxes[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const char *rejected[] = {
+        "-kGather -pBOX:4:4:4:1:x-",
+        "-kPack -pUNIFORM:8:1",
+        "-kPack -pBOX:4:4:4:1",
+        "-kTranspose -pBOX:4:4:4:2:x-",
+        "-kPack -pBOX:4:4:4:1:w-",
+        "-kPack -pBOX:4:4:4:1:x- -d8,16",
+    };
+    for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+        if (run(rejected[i]) == 0) {
+            printf("Test failure: spatter %s ran\n", rejected[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "sgbuf.h"
+#include "sp_alloc.h"
+#include "sp_arena.h"
+
+int arena_test() {
+    struct sp_arena arena = {0};
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 1000; i++) {
+            char *s = (char *)sp_arena_alloc(&arena, 1, 1 + i % 300, 1);
+            memset(s, 'a', 1 + i % 300);
+            size_t *v = (size_t *)sp_arena_alloc(&arena, sizeof(size_t), 3, 64);
+            if ((uintptr_t)v % 64 != 0) {
+                printf("Test failure on arena: misaligned allocation\n");
+                return EXIT_FAILURE;
+            }
+        }
+        // Larger than a chunk
+        char *big = (char *)sp_arena_alloc(&arena, 1, 4 * SP_ARENA_CHUNK, 64);
+        memset(big, 'b', 4 * SP_ARENA_CHUNK);
+        sp_arena_reset(&arena);
+        if (arena.head && arena.head->next) {
+            printf("Test failure on arena: reset kept more than one chunk\n");
+            return EXIT_FAILURE;
+        }
+    }
+    sp_arena_destroy(&arena);
+    return EXIT_SUCCESS;
+}
+
+int reserve_test() {
+    sgDataBuf buf = {0};
+    sgData_t *ptrs[2];
+    buf.host_ptrs = ptrs;
+    buf.nptrs = 2;
+    buf.capacity = 4096;
+    buf.size = 4096;
+    for (size_t i = 0; i < buf.nptrs; i++)
+        buf.host_ptrs[i] = (sgData_t *)sp_data_malloc(buf.size, 1, ALIGN_PAGE);
+
+    // Slightly smaller fits in place, much larger or much smaller does not
+    int expect[][2] = {{2048, 0}, {4096, 0}, {1 << 20, 1}, {1 << 19, 0}, {4096, 1}};
+    for (size_t i = 0; i < sizeof(expect)/sizeof(expect[0]); i++) {
+        int moved = sgbuf_reserve(&buf, expect[i][0], ALIGN_PAGE);
+        if (moved != expect[i][1] || buf.size != (size_t)expect[i][0] || buf.capacity < buf.size) {
+            printf("Test failure on reserve of %d bytes\n", expect[i][0]);
+            return EXIT_FAILURE;
+        }
+        memset(buf.host_ptrs[1], 0, buf.size);
+    }
+
+    for (size_t i = 0; i < buf.nptrs; i++)
+        sp_free(buf.host_ptrs[i]);
+    if (get_pool_mem_used(SP_POOL_DEFAULT) != 0) {
+        printf("Test failure on reserve: buffers leaked\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (arena_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (reserve_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (system("../spatter -pUNIFORM:8:1 -l4096 --resize-buffers") != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
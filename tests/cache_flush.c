@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "cache-flush.h"
+
+// Flushing writes the lines back, it must not change the buffer
+int flush_test()
+{
+    size_t n = 100000;
+    double *buf = malloc(sizeof(double) * n);
+    for (size_t i = 0; i < n; i++)
+        buf[i] = (double)i;
+    // Unaligned start and end, so the first and last lines are partial
+    sp_flush_range((char *)buf + 3, sizeof(double) * n - 5);
+    for (size_t i = 0; i < n; i++) {
+        if (buf[i] != (double)i) {
+            printf("Test failure on sp_flush_range: element %zu is %g\n", i, buf[i]);
+            free(buf);
+            return EXIT_FAILURE;
+        }
+    }
+    free(buf);
+    return EXIT_SUCCESS;
+}
+
+// The eviction buffer is larger than the caches it has to evict
+int evict_test()
+{
+    size_t llc = sp_llc_size(), l2 = sp_l2_size();
+    if (llc == 0 || l2 == 0) {
+        printf("Test failure on the cache sizes: LLC %zu, L2 %zu\n", llc, l2);
+        return EXIT_FAILURE;
+    }
+    size_t bytes = sp_evict_init(2);
+    if (bytes < 2 * (llc + 2 * l2)) {
+        printf("Test failure on the eviction buffer: %zu bytes for a %zu byte LLC\n", bytes, llc);
+        return EXIT_FAILURE;
+    }
+    sp_evict();
+    sp_evict_free();
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (flush_test() != EXIT_SUCCESS || evict_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    if (system("../spatter -pUNIFORM:8:1 -l4096 --cache=cold -q3") != EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:8:1 -l4096 --cache=flush -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l4096 --cache=flush -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --cache runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l64 --cache=hot > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -pUNIFORM:8:1 -l64 --cache=cold --min-sample=1 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --cache config was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "parse-args.h"
+#include "chase.h"
+
+#define N 1000
+#define DELTA 3
+
+// Following every chain from its head must visit each slot exactly once
+// and come back to the head
+int link_test(int threads, int chains, size_t seed, uint32_t *order)
+{
+    ssize_t pat[] = {2, 0, 5};
+    struct run_config rc = {0};
+    rc.pattern = pat;
+    rc.pattern_len = 3;
+    rc.delta = DELTA;
+    rc.generic_len = N;
+    rc.chains = chains;
+    rc.random_seed = seed;
+    rc.ro_order = order;
+
+    sgData_t *source = (sgData_t *)calloc(DELTA * (N - 1) + 6, sizeof(sgData_t));
+    int *hits = (int *)calloc(N, sizeof(int));
+    struct sp_chase ch;
+    sp_chase_prepare(&ch, source, &rc, threads);
+
+    size_t total = 0;
+    for (int i = 0; i < threads * chains; i++) {
+        size_t b = ch.head[i];
+        for (size_t s = 0; s < ch.len[i]; s++) {
+            hits[b / DELTA]++;
+            uint64_t next;
+            memcpy(&next, &source[b + pat[0]], sizeof(next));
+            b = next;
+        }
+        if (b != ch.head[i] || ch.len[i] == 0 || ch.len[i] > ch.hops) {
+            printf("Test failure on chase %d threads, %d chains: chain %d is broken\n", threads, chains, i);
+            return EXIT_FAILURE;
+        }
+        total += ch.len[i];
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        if (hits[i] != 1 || total != N) {
+            printf("Test failure on chase %d threads, %d chains, seed %zu: slot %zu visited %d times\n",
+                    threads, chains, seed, i, hits[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    sp_chase_release(&ch);
+    free(hits);
+    free(source);
+    return EXIT_SUCCESS;
+}
+
+int options_test()
+{
+    const char *runs[] = {
+        "../spatter -kChase -pUNIFORM:8:1 -l1024 -q3",
+        "../spatter -kChase -pUNIFORM:8:8 -l1024 --random=7 --chains=4 -q3",
+        "../spatter -kChase -pMS1:8:4:32 -d8 -l1024 --morton=1 --chains=64 -t1 -q3",
+    };
+    for (size_t r = 0; r < sizeof(runs)/sizeof(runs[0]); r++) {
+        if (system(runs[r]) != EXIT_SUCCESS) {
+            printf("Test failure on %s\n", runs[r]);
+            return EXIT_FAILURE;
+        }
+    }
+    // More chains than Gathers
+    if (system("../spatter -kChase -pUNIFORM:8:1 -l16 -t1 --chains=32 -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: CHASE with fewer Gathers than chains was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * N);
+    for (int i = 0; i < N; i++)
+        order[i] = (uint32_t)((i * 7) % N);
+
+    int threads[] = {1, 3, 8};
+    int chains[] = {1, 5, 64};
+    for (int t = 0; t < 3; t++) {
+        for (int c = 0; c < 3; c++) {
+            if (link_test(threads[t], chains[c], 0, NULL) != EXIT_SUCCESS ||
+                link_test(threads[t], chains[c], 42, NULL) != EXIT_SUCCESS ||
+                link_test(threads[t], chains[c], 0, order) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+    free(order);
+
+    if (options_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "../src/openmp/omp-sched.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+
+#define TEAMS 3
+
+// Loops of different lengths scheduled at the same time in nested teams
+// must each hand out their own iterations exactly once
+int nested_test(enum sg_schedule kind, size_t chunk)
+{
+    size_t lens[TEAMS] = {1000, 17, 1 << 15};
+    _Atomic int *hits[TEAMS];
+    for (int k = 0; k < TEAMS; k++)
+        hits[k] = (_Atomic int *)calloc(lens[k], sizeof(_Atomic int));
+
+    int levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+    sp_sched_set(kind, chunk);
+#pragma omp parallel num_threads(TEAMS)
+    {
+        int k = omp_get_thread_num();
+        omp_set_num_threads(k + 2);
+        for (int r = 0; r < 20; r++) {
+            sp_sched_reset(lens[k]);
+#pragma omp parallel
+            {
+                int t = omp_get_thread_num();
+                size_t i0, i1;
+                while (sp_sched_next(t, &i0, &i1))
+                for (size_t i = i0; i < i1; i++)
+                    atomic_fetch_add(&hits[k][i], 1);
+            }
+        }
+    }
+    omp_set_max_active_levels(levels);
+
+    int ret = EXIT_SUCCESS;
+    for (int k = 0; k < TEAMS; k++) {
+        for (size_t i = 0; i < lens[k] && ret == EXIT_SUCCESS; i++) {
+            if (hits[k][i] != 20) {
+                printf("Test failure on nested schedule %s: team %d, iteration %zu ran %d times\n",
+                        sp_sched_name(kind), k, i, (int)hits[k][i]);
+                ret = EXIT_FAILURE;
+            }
+        }
+        free(hits[k]);
+    }
+    return ret;
+}
+
+int options_test()
+{
+    FILE *fp = fopen("co_run.json", "w");
+    if (!fp)
+        return EXIT_FAILURE;
+    fprintf(fp, "[{\"kernel\": \"Gather\", \"pattern\": \"UNIFORM:8:1\", \"count\": 65536},\n"
+                " {\"kernel\": \"Scatter\", \"pattern\": \"UNIFORM:8:4\", \"count\": 8192, \"op\": \"ACCUM\"},\n"
+                " {\"kernel\": \"GS\", \"pattern-gather\": \"UNIFORM:8:1\", \"pattern-scatter\": \"UNIFORM:8:1\", \"count\": 4096},\n"
+                " {\"kernel\": \"MultiGather\", \"pattern\": \"UNIFORM:8:1\", \"pattern-gather\": [0, 2, 4], \"count\": 4096}]\n");
+    fclose(fp);
+
+    const char *runs[] = {
+        "../spatter --co-run -pUNIFORM:8:1 -l4096 -t1",
+        "../spatter --co-run --schedule=steal -pFILE=co_run.json",
+        "../spatter --co-run --busy-times -kChase -pUNIFORM:8:8 -l4096 --random=1",
+    };
+    for (size_t r = 0; r < sizeof(runs)/sizeof(runs[0]); r++) {
+        if (system(runs[r]) != EXIT_SUCCESS) {
+            printf("Test failure on %s\n", runs[r]);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+#if defined( USE_OPENMP )
+    enum sg_schedule kinds[] = {SCHED_STATIC, SCHED_DYNAMIC, SCHED_GUIDED, SCHED_STEAL};
+    for (int k = 0; k < 4; k++)
+        if (nested_test(kinds[k], 3) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+
+    if (options_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#endif
+    return EXIT_SUCCESS;
+}
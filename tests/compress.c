@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "sgbuf.h"
+
+#define LEN 100000
+
+// The linear-scan version compress_indices replaced
+static size_t compress_ref(ssize_t *idx, size_t len, size_t elem, size_t page)
+{
+    long *pages = (long *)malloc(len * sizeof(long));
+    long npages = 0;
+    for (size_t i = 0; i < len; i++) {
+        long addr = idx[i] * (long)elem;
+        long pg = addr / (long)page;
+        long p = 0;
+        while (p < npages && pages[p] != pg)
+            p++;
+        if (p == npages)
+            pages[npages++] = pg;
+        idx[i] = (p * (long)page + addr % (long)page) / (long)elem;
+    }
+    free(pages);
+    return npages;
+}
+
+int check(const ssize_t *in, size_t len, size_t elem, size_t page)
+{
+    ssize_t *a = (ssize_t *)malloc(len * sizeof(ssize_t));
+    ssize_t *b = (ssize_t *)malloc(len * sizeof(ssize_t));
+    memcpy(a, in, len * sizeof(ssize_t));
+    memcpy(b, in, len * sizeof(ssize_t));
+    size_t na = compress_indices(a, len, elem, page);
+    size_t nb = compress_ref(b, len, elem, page);
+    int ok = na == nb && !memcmp(a, b, len * sizeof(ssize_t));
+    if (!ok)
+        printf("Test failure: elem %zu, page %zu: %zu pages, expected %zu\n", elem, page, na, nb);
+    free(a);
+    free(b);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    ssize_t *idx = (ssize_t *)malloc(LEN * sizeof(ssize_t));
+    srand(1);
+    // Sparse: strides of many pages with a random offset, revisited
+    for (size_t i = 0; i < LEN; i++)
+        idx[i] = (ssize_t)((i % 2000) * 100003 + rand() % 64);
+
+    size_t pages[] = {4096, 1 << 21, 1 << 30};
+    size_t elems[] = {4, 8, 16};
+    for (int p = 0; p < 3; p++)
+        for (int e = 0; e < 3; e++)
+            if (!check(idx, LEN, elems[e], pages[p]))
+                return EXIT_FAILURE;
+
+    // An index to the start of every other page lands on consecutive pages
+    ssize_t strided[] = {0, 1024, 2048, 0, 4096 + 3};
+    compress_indices(strided, 5, 8, 4096);
+    if (strided[0] != 0 || strided[1] != 512 || strided[2] != 1024 || strided[3] != 0 || strided[4] != 1536 + 3) {
+        printf("Test failure on strided pages\n");
+        return EXIT_FAILURE;
+    }
+
+    if (system("../spatter -pUNIFORM:8:1024 -l1024 --compress=2M -q3") != EXIT_SUCCESS ||
+            system("../spatter -pUNIFORM:8:1024 -l1024 -c -q3") != EXIT_SUCCESS ||
+            system("../spatter -pUNIFORM:8:1024 -l1024 --compress=3K -q3") == EXIT_SUCCESS ||
+            system("../spatter -pUNIFORM:8:1024 -l1024 --compress=4X -q3") == EXIT_SUCCESS) {
+        printf("Test failure on --compress\n");
+        return EXIT_FAILURE;
+    }
+    free(idx);
+    return EXIT_SUCCESS;
+}
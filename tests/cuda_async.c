@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+int main(int argc, char **argv)
+{
+#if defined( USE_CUDA ) && !defined( USE_HIP )
+    if (system("../spatter -b cuda -pUNIFORM:8:1 -l65536 --cuda-async=1 -q3") != 0 ||
+        system("../spatter -b cuda -kScatter -pUNIFORM:64:2 -l65537 --cuda-async=4 -q3") != 0 ||
+        system("../spatter -b cuda -pUNIFORM:73:1 -l1000 -w7 --cuda-async=3 -q3") != 0) {
+        printf("Test failure: a --cuda-async config did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -b cuda -pUNIFORM:12:1 -l1024 --cuda-async=2 > /dev/null 2>&1") == 0 ||
+        system("../spatter -b cuda -kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -l1024 --cuda-async=2 > /dev/null 2>&1") == 0 ||
+        system("../spatter -b cuda -pUNIFORM:8:1 -l1024 --random=3 --cuda-async=2 > /dev/null 2>&1") == 0 ||
+        system("../spatter -b cuda -pUNIFORM:8:1 -d8,16 -l1024 --cuda-async=2 > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --cuda-async config was accepted\n");
+        return EXIT_FAILURE;
+    }
+#else
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --cuda-async=2 > /dev/null 2>&1") == 0) {
+        printf("Test failure: --cuda-async ran without the CUDA backend\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --cuda-async=-1 > /dev/null 2>&1") == 0) {
+        printf("Test failure: a negative --cuda-async was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "dsa.h"
+
+static int parse(const char *arg, const char *wq, size_t threads)
+{
+    char got[64];
+    size_t t;
+    if (sp_dsa_parse(arg, got, sizeof(got), &t) != 0 || strcmp(got, wq) || t != threads) {
+        printf("Test failure: --dsa=%s not parsed as %s with %zu threads\n", arg, wq, threads);
+        return 1;
+    }
+    return 0;
+}
+
+static int reject(const char *arg)
+{
+    char got[64];
+    size_t t;
+    if (sp_dsa_parse(arg, got, sizeof(got), &t) == 0) {
+        printf("Test failure: --dsa=%s was accepted\n", arg);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse("/dev/dsa/wq0.0", "/dev/dsa/wq0.0", 1) ||
+        parse("/dev/dsa/wq1.3:4", "/dev/dsa/wq1.3", 4) ||
+        reject("") || reject(":2") || reject("/dev/dsa/wq0.0:0") || reject("/dev/dsa/wq0.0:x"))
+        return EXIT_FAILURE;
+
+    // Without a DSA build, or without a work queue, the option is refused
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --dsa=/dev/dsa/wq-none.0 > /dev/null 2>&1") == 0) {
+        printf("Test failure: --dsa ran without a work queue\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --dsa=/dev/dsa/wq-none.0 --rate=1 > /dev/null 2>&1") == 0) {
+        printf("Test failure: --dsa ran with --rate\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "traffic.h"
+#include "backend-support-tests.h"
+#include "../src/openmp/openmp_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (37)
+
+// Gather and Scatter of every element type must move the same bytes as a
+// byte-wise reference that treats the buffers as arrays of size-byte elements
+int elem_test(enum sg_elem elem, size_t size, size_t pat_len)
+{
+    size_t delta = 3;
+    size_t wrap = 2;
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = (j * 7) % (2 * pat_len + 1);
+
+    size_t src_elems = 2 * pat_len + 1 + delta * N;
+    size_t src_bytes = src_elems * size;
+    size_t dense_bytes = pat_len * wrap * size;
+    sgData_t *src = malloc(src_bytes);
+    sgData_t *ref = malloc(src_bytes);
+    sgData_t *dense = calloc(1, dense_bytes);
+    unsigned char *dense_ref = calloc(1, dense_bytes);
+    for (size_t i = 0; i < src_bytes; i++)
+        ((unsigned char *)src)[i] = ((unsigned char *)ref)[i] = (unsigned char)(i * 13 + 1);
+
+    int rc = EXIT_SUCCESS;
+
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = 0; j < pat_len; j++)
+            memcpy(dense_ref + (pat_len * (i % wrap) + j) * size,
+                    (unsigned char *)src + (delta * i + pat[j]) * size, size);
+    gather_smallbuf_elem(elem, size, &dense, src, pat, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, dense_bytes)) {
+        printf("Test failure on %zu-byte gather with pattern length %zu\n", size, pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < dense_bytes; i++)
+        ((unsigned char *)dense)[i] = (unsigned char)(255 - i);
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = 0; j < pat_len; j++)
+            memcpy((unsigned char *)ref + (delta * i + pat[j]) * size,
+                    (unsigned char *)dense + (pat_len * (i % wrap) + j) * size, size);
+    scatter_smallbuf_elem(elem, size, src, &dense, pat, pat_len, delta, N, wrap);
+    if (memcmp(src, ref, src_bytes)) {
+        printf("Test failure on %zu-byte scatter with pattern length %zu\n", size, pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    free(pat);
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+// Useful bytes follow the element size, elements wider than a line count
+// every line they overlap
+int traffic_test()
+{
+    ssize_t pat[4] = {0, 1, 2, 3};
+    struct run_config rc = {0};
+    struct sp_traffic t;
+    rc.kernel = GATHER;
+    rc.pattern = pat;
+    rc.pattern_len = 4;
+    rc.delta = 4;
+    rc.generic_len = 1;
+    rc.random_seed = 0;
+    size_t line = sp_line_size();
+
+    rc.elem = ELEM_BYTES;
+    rc.elem_size = 3 * line;
+    sp_traffic_model(&rc, &t);
+    if (t.useful != 4 * 3 * line || t.lines != 4 * 3 * line) {
+        printf("Test failure on bytes:%zu traffic: %zu useful, %zu line bytes\n", rc.elem_size, t.useful, t.lines);
+        return EXIT_FAILURE;
+    }
+    rc.elem = ELEM_F32;
+    rc.elem_size = 4;
+    sp_traffic_model(&rc, &t);
+    if (t.useful != 16 || t.lines != line) {
+        printf("Test failure on f32 traffic: %zu useful, %zu line bytes\n", t.useful, t.lines);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    enum sg_elem elems[] = {ELEM_F32, ELEM_I32, ELEM_I64, ELEM_C64, ELEM_BYTES, ELEM_BYTES};
+    size_t sizes[] = {4, 4, 8, 16, 40, 3};
+    size_t lens[] = {1, 8, 13};
+
+#ifdef USE_OPENMP
+    int nt = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    for (size_t i = 0; i < sizeof(elems)/sizeof(elems[0]); i++) {
+        for (size_t j = 0; j < sizeof(lens)/sizeof(lens[0]); j++) {
+            if (elem_test(elems[i], sizes[i], lens[j]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+#ifdef USE_OPENMP
+    omp_set_num_threads(nt);
+#endif
+    if (traffic_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+#ifdef USE_OPENMP
+    if (system("../spatter -kGather -pUNIFORM:8:1 -l4096 --elem=f32 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:16:2 -l4096 --elem=c64 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kGather -pUNIFORM:8:1 -l4096 --elem=bytes:40 -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --elem runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kGather -pUNIFORM:8:1 -l64 --elem=bytes:0 -q3 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -kGS -pUNIFORM:8:1 -l64 --elem=f32 -q3 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:8:1 -l64 --elem=f32 --op=ACCUM -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --elem config was accepted\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "energy.h"
+
+// Whatever counters this machine has, every run must use a non-negative
+// amount of energy, and domains that can not be read must report none
+int main(int argc, char **argv)
+{
+    int n = sp_energy_init(NULL, 0);
+    int avail = 0;
+    for (int d = 0; d < SP_ENERGY_DOMAINS; d++)
+        avail += sp_energy_available((enum sp_energy_domain)d);
+    if (n != avail || sp_energy_available(SP_ENERGY_GPU)) {
+        printf("Test failure: %d domains found, %d available\n", n, avail);
+        return EXIT_FAILURE;
+    }
+
+    volatile double x = 0;
+    struct sp_energy e;
+    sp_energy_start();
+    for (int i = 0; i < 10000000; i++)
+        x += i;
+    sp_energy_stop(&e);
+    for (int d = 0; d < SP_ENERGY_DOMAINS; d++) {
+        if (e.joules[d] < 0 || (!sp_energy_available((enum sp_energy_domain)d) && e.joules[d] != 0)) {
+            printf("Test failure on %s: %g J\n", sp_energy_name((enum sp_energy_domain)d), e.joules[d]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (sp_energy_total(&e) < 0) {
+        printf("Test failure: negative total energy\n");
+        return EXIT_FAILURE;
+    }
+    sp_energy_finalize();
+
+    if (system("../spatter -pUNIFORM:8:1 -l4096 --energy -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --energy run\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define TRACE "extract_test.idx"
+
+static char *slurp(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return NULL;
+    char *buf = (char *)calloc(1 << 16, 1);
+    fread(buf, 1, (1 << 16) - 1, f);
+    fclose(f);
+    return buf;
+}
+
+static int run(const char *command)
+{
+    if (system(command) != EXIT_SUCCESS) {
+        printf("Test failure on %s\n", command);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    // 1000 Gathers of [0,5,9,20] 100 apart, then 300 of [3,0,1,2] 4 apart
+    FILE *f = fopen(TRACE, "wb");
+    uint64_t base = 0;
+    for (int i = 0; i < 1000; i++, base += 100) {
+        uint64_t w[4] = {base, base + 5, base + 9, base + 20};
+        fwrite(w, sizeof(uint64_t), 4, f);
+    }
+    for (int i = 0; i < 300; i++, base += 4) {
+        uint64_t w[4] = {base + 3, base, base + 1, base + 2};
+        fwrite(w, sizeof(uint64_t), 4, f);
+    }
+    fclose(f);
+
+    if (!run("../spatter-extract -v4 -n2 -t1 -o extract_t1.json " TRACE) ||
+        !run("../spatter-extract -v4 -n2 -t4 -o extract_t4.json " TRACE))
+        return EXIT_FAILURE;
+
+    char *t1 = slurp("extract_t1.json");
+    char *t4 = slurp("extract_t4.json");
+    if (!t1 || !t4 || strcmp(t1, t4)) {
+        printf("Test failure: the suite depends on the number of threads\n");
+        return EXIT_FAILURE;
+    }
+    // The first window of the trace has no delta
+    if (!strstr(t1, "\"pattern\": [0, 5, 9, 20], \"delta\": 100, \"count\": 999") ||
+        !strstr(t1, "\"pattern\": [3, 0, 1, 2], \"delta\": 4, \"count\": 299") ||
+        strstr(t1, "extract_test:2")) {
+        printf("Test failure: unexpected suite\n%s", t1);
+        return EXIT_FAILURE;
+    }
+    free(t1);
+    free(t4);
+
+    // The suite runs, and the sample traces take their kernel from the name
+    char *command;
+    if (!run("../spatter -pFILE=extract_t1.json -R2") ||
+        asprintf(&command, "../spatter-extract -o extract_gz.json %s/0.0.R.idx.gz %s/1.1.W.idx.gz", BINARY_TRACE_DIR, BINARY_TRACE_DIR) == -1 ||
+        !run(command))
+        return EXIT_FAILURE;
+    free(command);
+    char *gz = slurp("extract_gz.json");
+    if (!gz || !strstr(gz, "\"kernel\": \"Gather\", \"pattern\": [0, 1, 2, 3, 4, 5, 6, 7], \"delta\": 8") ||
+        !strstr(gz, "\"name\": \"1.1.W:0\", \"kernel\": \"Scatter\"")) {
+        printf("Test failure: unexpected suite for the sample traces\n%s", gz ? gz : "");
+        return EXIT_FAILURE;
+    }
+    free(gz);
+
+    remove(TRACE);
+    remove("extract_t1.json");
+    remove("extract_t4.json");
+    remove("extract_gz.json");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "mtx.h"
+#include "graph.h"
+#include "sp_alloc.h"
+
+#define BIG 20000
+
+static void write_csr(const char *file, uint64_t n, const uint64_t *rowptr, const uint64_t *col)
+{
+    FILE *f = fopen(file, "wb");
+    uint64_t h[3] = {n, n, rowptr[n]};
+    fwrite(SP_CSR_MAGIC, 1, 8, f);
+    fwrite(h, sizeof(uint64_t), 3, f);
+    fwrite(rowptr, sizeof(uint64_t), n + 1, f);
+    fwrite(col, sizeof(uint64_t), rowptr[n], f);
+    fclose(f);
+}
+
+static int expect(const char *file, enum sp_graph_algo algo, const uint64_t *want, size_t len)
+{
+    uint64_t *idx;
+    size_t n = sp_graph_stream(file, algo, &idx, NULL);
+    int ok = n == len && !memcmp(idx, want, len * sizeof(uint64_t));
+    if (!ok) {
+        printf("Test failure: %s stream of %s has %zu indices:", sp_graph_algo_name(algo), file, n);
+        for (size_t k = 0; k < n && k < 16; k++)
+            printf(" %lu", (unsigned long)idx[k]);
+        printf("\n");
+    }
+    sp_free(idx);
+    return !ok;
+}
+
+// 0 -> 1 2, 1 -> 3, 2 -> 3 4, 3 -> 0, 5 -> 0. BFS starts from 0, the first
+// vertex of out-degree 2, and never reaches 5.
+static int small_graph(void)
+{
+    uint64_t rowptr[] = {0, 2, 3, 5, 6, 6, 7};
+    uint64_t col[] = {1, 2, 3, 3, 4, 0, 0};
+    write_csr("graph_small.csr", 6, rowptr, col);
+
+    uint64_t bfs[] = {1, 2, 3, 3, 4, 0};
+    uint64_t pagerank[] = {3, 5, 0, 0, 1, 2, 2};
+    struct sp_graph_summary sum;
+    uint64_t *idx;
+    sp_graph_stream("graph_small.csr", GRAPH_BFS, &idx, &sum);
+    sp_free(idx);
+    if (sum.root != 0 || sum.reached != 5 || sum.levels != 3) {
+        printf("Test failure: BFS from %lu reached %zu vertices in %zu levels\n", (unsigned long)sum.root, sum.reached, sum.levels);
+        return 1;
+    }
+    return expect("graph_small.csr", GRAPH_BFS, bfs, 6) ||
+        expect("graph_small.csr", GRAPH_PAGERANK, pagerank, 7) ||
+        expect("graph_small.csr", GRAPH_SPMV, col, 7);
+}
+
+// A random graph, whose BFS stream must match a serial BFS whatever the
+// threads did
+static int big_graph(void)
+{
+    uint64_t *rowptr = (uint64_t *)malloc((BIG + 1) * sizeof(uint64_t));
+    uint64_t *col = (uint64_t *)malloc(BIG * 8 * sizeof(uint64_t));
+    uint64_t x = 88172645463325252ull;
+    rowptr[0] = 0;
+    for (uint64_t v = 0; v < BIG; v++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        uint64_t deg = x % 8;
+        for (uint64_t e = 0; e < deg; e++) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            col[rowptr[v] + e] = x % BIG;
+        }
+        rowptr[v + 1] = rowptr[v] + deg;
+    }
+    write_csr("graph_big.csr", BIG, rowptr, col);
+
+    uint64_t root = 0;
+    for (uint64_t v = 1; v < BIG; v++)
+        if (rowptr[v + 1] - rowptr[v] > rowptr[root + 1] - rowptr[root])
+            root = v;
+    uint64_t *want = (uint64_t *)malloc(rowptr[BIG] * sizeof(uint64_t));
+    uint64_t *queue = (uint64_t *)malloc(BIG * sizeof(uint64_t));
+    char *seen = (char *)calloc(BIG, 1);
+    size_t len = 0, head = 0, tail = 0;
+    queue[tail++] = root;
+    seen[root] = 1;
+    while (head < tail) {
+        uint64_t v = queue[head++];
+        for (uint64_t k = rowptr[v]; k < rowptr[v + 1]; k++) {
+            want[len++] = col[k];
+            if (!seen[col[k]]) {
+                seen[col[k]] = 1;
+                queue[tail++] = col[k];
+            }
+        }
+    }
+    int err = expect("graph_big.csr", GRAPH_BFS, want, len);
+    free(rowptr);
+    free(col);
+    free(want);
+    free(queue);
+    free(seen);
+    return err;
+}
+
+// The command line replays the streams, and rejects what is not a graph
+static int run_test(void)
+{
+    if (system("../spatter -pGRAPH:graph_small.csr:bfs -kGather -q3") != 0 ||
+        system("../spatter -pGRAPH:graph_big.csr:pagerank -kScatter -q3") != 0) {
+        printf("Test failure: a -pGRAPH config did not run\n");
+        return 1;
+    }
+    FILE *f = fopen("graph_bad.csr", "w");
+    fprintf(f, "%%%%MatrixMarket matrix coordinate pattern general\n2 2 1\n1 2\n");
+    fclose(f);
+    if (system("../spatter -pGRAPH:graph_small.csr:dfs > /dev/null 2>&1") == 0 ||
+        system("../spatter -pGRAPH:graph_small.csr > /dev/null 2>&1") == 0 ||
+        system("../spatter -pGRAPH:graph_bad.csr:bfs > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid -pGRAPH was accepted\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int err = small_graph() || big_graph() || run_test();
+    remove("graph_small.csr");
+    remove("graph_big.csr");
+    remove("graph_bad.csr");
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
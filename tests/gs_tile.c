@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "../src/openmp/openmp_kernels.h"
+#include "../src/serial/serial-kernels.h"
+
+#define N (1001)
+
+// The staged GS kernels must write what a plain loop does, for gather
+// patterns longer and shorter than the scatter ones, and tiles that hold
+// less than one GS, a few, or all of them
+static int staged_test(size_t glen, size_t slen, size_t tile)
+{
+    ssize_t *gpat = malloc(sizeof(ssize_t) * glen);
+    ssize_t *spat = malloc(sizeof(ssize_t) * slen);
+    for (size_t j = 0; j < glen; j++)
+        gpat[j] = (j * 7) % (2 * glen + 1);
+    for (size_t j = 0; j < slen; j++)
+        spat[j] = (j * 3) % (2 * slen + 1);
+    size_t dg = 5, ds = 2 * slen + 1;
+
+    size_t src_len = 2 * glen + 1 + dg * N;
+    size_t dst_len = ds * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = calloc(dst_len, sizeof(sgData_t));
+    sgData_t *dst = calloc(dst_len, sizeof(sgData_t));
+    sgData_t *dst_serial = calloc(dst_len, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = (sgData_t)i;
+
+    for (size_t i = 0; i < N; i++)
+        for (size_t j = 0; j < slen; j++)
+            ref[ds * i + spat[j]] = src[dg * i + gpat[j % glen]];
+    sg_smallbuf_staged(src, dst, gpat, spat, glen, slen, dg, ds, N, tile);
+    sg_smallbuf_staged_serial(src, dst_serial, gpat, spat, glen, slen, dg, ds, N, tile);
+
+    int rc = EXIT_SUCCESS;
+    if (memcmp(dst, ref, sizeof(sgData_t) * dst_len) ||
+        memcmp(dst_serial, ref, sizeof(sgData_t) * dst_len)) {
+        printf("Test failure on the staged GS kernel, gather length %zu, scatter length %zu, tile %zu\n", glen, slen, tile);
+        rc = EXIT_FAILURE;
+    }
+
+    free(gpat);
+    free(spat);
+    free(src);
+    free(ref);
+    free(dst);
+    free(dst_serial);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    if (staged_test(8, 3, 64) ||
+        staged_test(3, 8, 8) ||
+        staged_test(5, 5, 1000) ||
+        staged_test(13, 7, 4096) ||
+        staged_test(16, 16, 1 << 20))
+        return EXIT_FAILURE;
+
+    if (system("../spatter -kGS -g0,1,2,3,4,5,6,7 -h0,8,16 -x8 -y24 -l4096 -q3") != 0 ||
+        system("../spatter -kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -x8 -y8 -l4096 --gs-tile=1024 -q3") != 0) {
+        printf("Test failure: a staged GS config did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kGather -pUNIFORM:8:1 -l1024 --gs-tile=1024 > /dev/null 2>&1") == 0 ||
+        system("../spatter -kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -l1024 --gs-tile=-1 > /dev/null 2>&1") == 0 ||
+        system("../spatter -kGS -gUNIFORM:8:1 -hUNIFORM:4:1 -l1024 --store=nt > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid staged GS config was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "parse-args.h"
+#include "traffic.h"
+#include "backend-support-tests.h"
+#include "../src/openmp/openmp_kernels.h"
+#include "../src/openmp/openmp_simd_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (257)
+
+// The narrow index kernels, plain and vectorized, must match the 64-bit
+// kernels for pattern lengths that exercise both the full vectors and the tail
+int narrow_test(enum sg_simd isa, size_t pat_len)
+{
+    size_t delta = 3;
+    size_t wrap = 2;
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    int32_t *pat32 = malloc(sizeof(int32_t) * pat_len);
+    int16_t *pat16 = malloc(sizeof(int16_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = pat32[j] = pat16[j] = (j * 7) % (2 * pat_len + 1);
+
+    size_t src_len = 2 * pat_len + 1 + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *dense_ref = calloc(pat_len * wrap, sizeof(sgData_t));
+    sgData_t *dense = calloc(pat_len * wrap, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    int rc = EXIT_SUCCESS;
+
+    gather_smallbuf(&dense_ref, src, pat, pat_len, delta, N, wrap);
+    gather_smallbuf_i32_simd(isa, &dense, src, pat32, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on %s 32-bit gather with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+    memset(dense, 0, sizeof(sgData_t) * pat_len * wrap);
+    gather_smallbuf_i16_simd(isa, &dense, src, pat16, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on %s 16-bit gather with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < pat_len * wrap; i++)
+        dense[i] = -(sgData_t)i;
+    scatter_smallbuf(ref, &dense, pat, pat_len, delta, N, wrap);
+    scatter_smallbuf_i32_simd(isa, src, &dense, pat32, pat_len, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on %s 32-bit scatter with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < pat_len * wrap; i++)
+        dense[i] = (sgData_t)i + 0.5;
+    scatter_smallbuf(ref, &dense, pat, pat_len, delta, N, wrap);
+    scatter_smallbuf_i16_simd(isa, src, &dense, pat16, pat_len, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on %s 16-bit scatter with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    // The pattern indexes itself as the inner pattern of the Multi kernels
+    ssize_t *inner = malloc(sizeof(ssize_t) * pat_len);
+    int16_t *inner16 = malloc(sizeof(int16_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        inner[j] = inner16[j] = pat_len - 1 - j;
+    multigather_smallbuf(&dense_ref, src, pat, inner, pat_len, delta, N, wrap);
+    multigather_smallbuf_i16(&dense, src, pat16, inner16, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on 16-bit multigather with pattern length %zu\n", pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    free(inner);
+    free(inner16);
+    free(pat);
+    free(pat32);
+    free(pat16);
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+// The traffic model counts index bytes at the configured width
+int traffic_test()
+{
+    ssize_t outer[8] = {0, 2, 4, 6, 8, 10, 12, 14};
+    ssize_t inner[4] = {0, 2, 4, 6};
+    struct run_config rc = {0};
+    struct sp_traffic t;
+    rc.kernel = MULTIGATHER;
+    rc.pattern = outer;
+    rc.pattern_len = 8;
+    rc.pattern_gather = inner;
+    rc.pattern_gather_len = 4;
+    rc.delta = 16;
+    rc.generic_len = 64;
+
+    int bits[] = {64, 32, 16};
+    for (int b = 0; b < 3; b++) {
+        rc.index_bits = bits[b];
+        sp_traffic_model(&rc, &t);
+        if (t.index != 12 * (size_t)bits[b] / 8) {
+            printf("Test failure on %d-bit index traffic: %zu bytes\n", bits[b], t.index);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    enum sg_simd isas[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512, SIMD_SVE};
+    size_t lens[] = {1, 3, 4, 8, 13, 16, 27, 73};
+
+#ifdef USE_OPENMP
+    int nt = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    for (size_t i = 0; i < sizeof(isas)/sizeof(isas[0]); i++) {
+        if (!sg_simd_support(isas[i]))
+            continue;
+        for (size_t j = 0; j < sizeof(lens)/sizeof(lens[0]); j++) {
+            if (narrow_test(isas[i], lens[j]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+#ifdef USE_OPENMP
+    omp_set_num_threads(nt);
+#endif
+    if (traffic_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+#ifdef USE_OPENMP
+    if (system("../spatter -kGather -pUNIFORM:8:4 -l4096 --index-bits=32 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:16:2 -l4096 --index-bits=16 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l4096 --index-bits=16 -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --index-bits runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kGather -pUNIFORM:8:40000 -l64 --index-bits=16 -q3 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -kGather -pUNIFORM:8:1 -l64 --index-bits=24 -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --index-bits config was accepted\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "spatter.h"
+
+// Run a suite in-process twice on the same buffers, and refuse a config
+// that does not fit them
+int main(int argc, char **argv)
+{
+    char *args[] = {"spatter", "-pUNIFORM:8:1", "-l4096", "-R4", "-q3"};
+    struct sp_suite *suite = sp_config_parse(5, args);
+    if (!suite || sp_config_count(suite) != 1) {
+        printf("Test failure: the suite was not parsed\n");
+        return EXIT_FAILURE;
+    }
+    struct sp_buffers *bufs = sp_buffers_create(suite);
+
+    struct sp_result r;
+    for (int pass = 0; pass < 2; pass++) {
+        if (sp_run(bufs, suite, 0, INVALID_BACKEND, &r) != 0 || r.runs != 4 || r.bytes != 8 * 8 * 4096 ||
+                !(r.min_ms > 0 && r.min_ms <= r.median_ms && r.median_ms <= r.max_ms) || r.bw_mbs <= 0) {
+            printf("Test failure on sp_run: %zu runs, %zu bytes, %g/%g/%g ms\n", r.runs, r.bytes, r.min_ms, r.median_ms, r.max_ms);
+            return EXIT_FAILURE;
+        }
+    }
+
+    char *big_args[] = {"spatter", "-pUNIFORM:8:64", "-l4096", "-q3"};
+    struct sp_suite *big = sp_config_parse(4, big_args);
+    if (sp_run(bufs, big, 0, INVALID_BACKEND, &r) != -1 || sp_run(bufs, suite, 1, INVALID_BACKEND, &r) != -1 ||
+            sp_run(bufs, suite, 0, CUDA, &r) != -1) {
+        printf("Test failure: sp_run accepted a config that does not fit, or a missing backend\n");
+        return EXIT_FAILURE;
+    }
+
+    sp_config_free(big);
+    sp_buffers_destroy(bufs);
+    sp_config_free(suite);
+    return EXIT_SUCCESS;
+}
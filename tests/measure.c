@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "parse-args.h"
+#include "measure.h"
+
+// Median, CI and outliers of a hand-made set of times
+int stats_test()
+{
+    double t[] = {2, 1, 1, 1, 1, 1, 1, 10};
+    struct sp_run_stats s;
+
+    sp_run_stats(t, 7, &s);
+    if (s.median_ms != 1 || s.outliers != 1) {
+        printf("Test failure on run stats: median %g, %d outliers\n", s.median_ms, s.outliers);
+        return EXIT_FAILURE;
+    }
+    sp_run_stats(t + 1, 6, &s);
+    if (s.median_ms != 1 || s.ci > 1e-12 || s.outliers != 0) {
+        printf("Test failure on run stats of equal times: median %g, ci %g, %d outliers\n", s.median_ms, s.ci, s.outliers);
+        return EXIT_FAILURE;
+    }
+    sp_run_stats(t, 8, &s);
+    if (s.median_ms != 1 || s.outliers != 1 || s.ci <= 0) {
+        printf("Test failure on run stats: median %g, ci %g, %d outliers\n", s.median_ms, s.ci, s.outliers);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Feed the engine slow warm-up runs followed by stable ones. It has to
+// drop the warm-up and stop after the minimum number of stable runs.
+int engine_test()
+{
+    struct run_config rc = {0};
+    rc.nruns = 10;
+    size_t max = 100;
+    sp_measure_set(0.01, 60, max);
+    rc.time_ms = (double *)malloc(sizeof(double) * sp_measure_slots(&rc));
+
+    double warmup[] = {50, 20, 12};
+    int i;
+    for (i = -1; sp_measure_more(&rc, i); i++) {
+        if (i >= 0)
+            rc.time_ms[i] = i < 3 ? warmup[i] : 10;
+        if (i >= (int)max) {
+            printf("Test failure on adaptive runs: no stop after %d runs\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (rc.warmup_runs != 3 || rc.nruns != SP_MIN_RUNS || rc.time_ms[0] != 10) {
+        printf("Test failure on adaptive runs: %zu warm-up runs, %zu runs\n", rc.warmup_runs, rc.nruns);
+        return EXIT_FAILURE;
+    }
+
+    // The run limit stops a config that never settles
+    rc.nruns = 10;
+    for (i = -1; sp_measure_more(&rc, i); i++)
+        rc.time_ms[i >= 0 ? i : 0] = 10 + 5 * (i % 2);
+    if (rc.nruns + rc.warmup_runs != max) {
+        printf("Test failure on adaptive runs: %zu runs for a limit of %zu\n", rc.nruns + rc.warmup_runs, max);
+        return EXIT_FAILURE;
+    }
+
+    free(rc.time_ms);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (stats_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (engine_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
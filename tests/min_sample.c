@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "sgtime.h"
+#include "../src/openmp/openmp_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (77)
+#define PAT_LEN (8)
+
+// Repeating a Gather or Scatter in one parallel region must leave the same
+// buffers as a single call
+int kernel_test()
+{
+    size_t delta = 3;
+    size_t wrap = 4;
+    ssize_t pat[PAT_LEN];
+    for (size_t j = 0; j < PAT_LEN; j++)
+        pat[j] = (j * 5) % (2 * PAT_LEN + 1);
+
+    size_t src_len = 2 * PAT_LEN + 1 + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *dense = calloc(PAT_LEN * wrap, sizeof(sgData_t));
+    sgData_t *dense_ref = calloc(PAT_LEN * wrap, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    int rc = EXIT_SUCCESS;
+
+    gather_smallbuf(&dense_ref, src, pat, PAT_LEN, delta, N, wrap);
+    gather_smallbuf_reps(&dense, src, pat, PAT_LEN, delta, N, wrap, 5);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * PAT_LEN * wrap)) {
+        printf("Test failure on the repeated Gather\n");
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < PAT_LEN * wrap; i++)
+        dense[i] = -(sgData_t)i;
+    scatter_smallbuf(ref, &dense, pat, PAT_LEN, delta, N, wrap);
+    scatter_smallbuf_reps(src, &dense, pat, PAT_LEN, delta, N, wrap, 5);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on the repeated Scatter\n");
+        rc = EXIT_FAILURE;
+    }
+
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+// Both clocks have to advance, and reading one costs far less than 0.1 ms
+int timer_test()
+{
+    enum sg_timer timers[] = {TIMER_CLOCK, TIMER_TSC};
+    for (int t = 0; t < 2; t++) {
+        if (!sg_set_timer(timers[t]))
+            continue;
+        sg_zero_time();
+        volatile double x = 0;
+        for (int i = 0; i < 1000000; i++)
+            x += i;
+        double ms = sg_get_time_ms();
+        double overhead = sg_timer_overhead_ms();
+        if (ms <= 0 || overhead < 0 || overhead > 0.1) {
+            printf("Test failure on timer %d: %g ms, overhead %g ms\n", t, ms, overhead);
+            return EXIT_FAILURE;
+        }
+    }
+    sg_set_timer(TIMER_CLOCK);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+#ifdef USE_OPENMP
+    omp_set_num_threads(1);
+#endif
+    if (kernel_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (timer_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    if (system("../spatter -pUNIFORM:8:1 -l64 --min-sample=1 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:8:1 -l64 --min-sample=1 --timer=tsc -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l64 --min-sample=1 -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --min-sample runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l64 --min-sample=0 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -pUNIFORM:8:1 -l64 --timer=hpet > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --min-sample or --timer was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "mpi-report.h"
+
+// The shares of every rank must cover n exactly and differ by at most one
+int share_test(size_t n, int nranks)
+{
+    size_t total = 0, min = n, max = 0;
+    for (int r = 0; r < nranks; r++) {
+        size_t s = sp_mpi_share(n, r, nranks);
+        total += s;
+        if (s < min) min = s;
+        if (s > max) max = s;
+    }
+    if (total != n || max - min > 1) {
+        printf("Test failure on --mpi-partition: %zu over %d ranks gave %zu in total, shares %zu to %zu\n", n, nranks, total, min, max);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    size_t counts[] = {1, 7, 1000, 1 << 24, (1 << 24) + 3};
+    int ranks[] = {1, 2, 3, 64, 4096};
+    for (size_t i = 0; i < sizeof(counts)/sizeof(counts[0]); i++)
+        for (size_t j = 0; j < sizeof(ranks)/sizeof(ranks[0]); j++)
+            if (counts[i] >= (size_t)ranks[j] && share_test(counts[i], ranks[j]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+
+    // Ranks 2 and 5 are over 1.2x the median of 1.0
+    double time[] = {1.0, 0.9, 1.5, 1.1, 1.0, 2.0, 0.95};
+    int slow[SP_MAX_STRAGGLERS];
+    double median;
+    int n = sp_find_stragglers(time, 7, 1.2, &median, slow, SP_MAX_STRAGGLERS);
+    if (n != 2 || slow[0] != 2 || slow[1] != 5 || median != 1.0) {
+        printf("Test failure on stragglers: found %d, median %g\n", n, median);
+        return EXIT_FAILURE;
+    }
+
+    // Only max_ranks are listed but all are counted
+    n = sp_find_stragglers(time, 7, 1.2, &median, slow, 1);
+    if (n != 2 || slow[0] != 2) {
+        printf("Test failure on stragglers with one slot: found %d\n", n);
+        return EXIT_FAILURE;
+    }
+
+    // Even number of ranks, median between the middle two
+    double even[] = {1.0, 3.0, 2.0, 10.0};
+    n = sp_find_stragglers(even, 4, 2.0, &median, slow, SP_MAX_STRAGGLERS);
+    if (n != 1 || slow[0] != 3 || median != 2.5) {
+        printf("Test failure on stragglers with even ranks: found %d, median %g\n", n, median);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
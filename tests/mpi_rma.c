@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include "parse-args.h"
+#include "mpi-rma.h"
+
+#define N (1000)
+#define BATCH (64)
+
+// On a single rank every Gather goes to the rank's own window, so the
+// landing buffer of the last batch can be checked against the source
+int rma_test(enum sg_rma mode, sgDataBuf *source, ssize_t *pat, size_t pat_len, size_t delta)
+{
+    struct run_config rc = {0};
+    rc.kernel = GATHER;
+    rc.pattern = pat;
+    rc.pattern_len = pat_len;
+    rc.delta = delta;
+    rc.generic_len = N;
+
+    struct sp_rma rma;
+    sp_rma_create(&rma, source);
+    sp_rma_prepare(&rma, &rc, mode, BATCH);
+    sp_rma_run(&rma, &rc, mode, BATCH);
+
+    int ret = EXIT_SUCCESS;
+    size_t i0 = (N - 1) / BATCH * BATCH;
+    for (size_t i = i0; i < N; i++) {
+        for (size_t j = 0; j < pat_len; j++) {
+            sgData_t got = rma.scratch[(i - i0) * pat_len + j];
+            if (got != source->host_ptr[delta * i + pat[j]]) {
+                printf("Test failure on --rma mode %d: Gather %zu index %zu got %g\n", mode, i, j, got);
+                ret = EXIT_FAILURE;
+                goto out;
+            }
+        }
+    }
+
+    // Scatter the landing buffer back to a zeroed window
+    for (size_t i = 0; i < rma.len; i++)
+        rma.base[i] = 0;
+    rc.kernel = SCATTER;
+    rc.generic_len = BATCH / 2;
+    sp_rma_release(&rma);
+    sp_rma_prepare(&rma, &rc, mode, BATCH);
+    for (size_t i = 0; i < BATCH / 2 * pat_len; i++)
+        rma.scratch[i] = i + 1;
+    sp_rma_run(&rma, &rc, mode, BATCH);
+    MPI_Win_sync(rma.win);
+    for (size_t i = 0; i < BATCH / 2; i++) {
+        for (size_t j = 0; j < pat_len; j++) {
+            if (rma.base[delta * i + pat[j]] != i * pat_len + j + 1) {
+                printf("Test failure on --rma mode %d: Scatter %zu index %zu\n", mode, i, j);
+                ret = EXIT_FAILURE;
+                goto out;
+            }
+        }
+    }
+
+out:
+    sp_rma_release(&rma);
+    sp_rma_destroy(&rma);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    ssize_t pat[] = {0, 3, 5, 6, 12, 13, 20, 31};
+    size_t delta = 16;
+
+    sgDataBuf source;
+    source.len = 32 + delta * N;
+    source.size = source.len * sizeof(sgData_t);
+    source.host_ptr = (sgData_t *)malloc(source.size);
+    for (size_t i = 0; i < source.len; i++)
+        source.host_ptr[i] = i;
+
+    int ret = EXIT_SUCCESS;
+    enum sg_rma modes[] = {RMA_ELEMENT, RMA_GATHER, RMA_AGGREGATE};
+    for (int m = 0; m < 3 && ret == EXIT_SUCCESS; m++)
+        ret = rma_test(modes[m], &source, pat, 8, delta);
+
+    free(source.host_ptr);
+    MPI_Finalize();
+    return ret;
+}
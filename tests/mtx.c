@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "mtx.h"
+
+#define ROWS 5000
+
+// A tridiagonal matrix, its entries written column by column so that
+// they are out of row order and spread over every chunk
+static void write_tridiag(const char *file)
+{
+    FILE *f = fopen(file, "w");
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n%% tridiagonal\n%d %d %d\n", ROWS, ROWS, 3 * ROWS - 2);
+    for (int j = 1; j <= ROWS; j++)
+        for (int i = j - 1; i <= j + 1; i++)
+            if (i >= 1 && i <= ROWS)
+                fprintf(f, "%d %d %g\n", i, j, i == j ? 2.0 : -1.0);
+    fclose(f);
+}
+
+// The same matrix in binary CSR, its lower triangle in a symmetric file
+static void write_variants(const char *csr_file, const char *sym_file)
+{
+    FILE *f = fopen(csr_file, "wb");
+    uint64_t h[3] = {ROWS, ROWS, 3 * ROWS - 2};
+    fwrite(SP_CSR_MAGIC, 1, 8, f);
+    fwrite(h, sizeof(uint64_t), 3, f);
+    for (uint64_t r = 0, off = 0; r <= ROWS; r++) {
+        fwrite(&off, sizeof(uint64_t), 1, f);
+        off += r == 0 || r == ROWS - 1 ? 2 : 3;
+    }
+    for (uint64_t r = 0; r < ROWS; r++)
+        for (uint64_t c = r ? r - 1 : 0; c <= r + 1 && c < ROWS; c++)
+            fwrite(&c, sizeof(uint64_t), 1, f);
+    fclose(f);
+
+    f = fopen(sym_file, "w");
+    fprintf(f, "%%%%MatrixMarket matrix coordinate pattern symmetric\n%d %d %d\n", ROWS, ROWS, 2 * ROWS - 1);
+    for (int i = 1; i <= ROWS; i++) {
+        fprintf(f, "%d %d\n", i, i);
+        if (i > 1)
+            fprintf(f, "%d %d\n", i, i - 1);
+    }
+    fclose(f);
+}
+
+// Every variant reads as the same CSR, and its interior rows are the most
+// frequent block: columns {0, 1, 2} one further on each time
+static int check(const char *file)
+{
+    struct sp_csr csr;
+    sp_mtx_read(file, &csr);
+    if (csr.nrows != ROWS || csr.nnz != 3 * ROWS - 2 || csr.rowptr[1] != 2 || csr.col[2] != 0 || csr.col[4] != 2) {
+        printf("Test failure: %s read as %zu rows, %zu nonzeros\n", file, csr.nrows, csr.nnz);
+        return EXIT_FAILURE;
+    }
+
+    struct sp_mtx_config mc[4];
+    struct sp_mtx_summary sum;
+    int n = sp_mtx_configs(&csr, 1, 4, mc, &sum);
+    if (n != 4 || sum.blocks != ROWS || mc[0].count != ROWS - 3 || mc[0].len != 3 || mc[0].delta != 1 ||
+            mc[0].pattern[0] != 0 || mc[0].pattern[2] != 2) {
+        printf("Test failure: %s gave %d configs, the first %zu blocks of %zu\n", file, n, mc[0].count, mc[0].len);
+        return EXIT_FAILURE;
+    }
+    sp_mtx_configs_free(mc, n);
+
+    // Blocks of two rows cover four columns, two further on each time
+    n = sp_mtx_configs(&csr, 2, 1, mc, &sum);
+    if (n != 1 || mc[0].len != 6 || mc[0].delta != 2 || mc[0].pattern[3] != 1 || mc[0].pattern[5] != 3) {
+        printf("Test failure: %s in blocks of 2 rows gave a block of %zu with delta %zu\n", file, mc[0].len, mc[0].delta);
+        return EXIT_FAILURE;
+    }
+    sp_mtx_configs_free(mc, n);
+    sp_csr_free(&csr);
+    return EXIT_SUCCESS;
+}
+
+// The command line expands a matrix into one config per block
+static int run_test()
+{
+    FILE *p = popen("../spatter -pMTX:mtx_tridiag.mtx:1:2 -q1", "r");
+    char line[4096];
+    int configs = 0;
+    while (p && fgets(line, sizeof(line), p))
+        if (strstr(line, "'name':'mtx_tridiag:"))
+            configs++;
+    if (!p || pclose(p) != 0 || configs != 2) {
+        printf("Test failure: -pMTX ran %d configs, expected 2\n", configs);
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pMTX:mtx_tridiag.mtx -d4 > /dev/null 2>&1") == 0 ||
+        system("../spatter -pMTX:no_such_matrix.mtx > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid -pMTX was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    write_tridiag("mtx_tridiag.mtx");
+    write_variants("mtx_tridiag.csr", "mtx_tridiag_sym.mtx");
+    int err = check("mtx_tridiag.mtx") || check("mtx_tridiag.csr") || check("mtx_tridiag_sym.mtx") || run_test();
+    remove("mtx_tridiag.mtx");
+    remove("mtx_tridiag.csr");
+    remove("mtx_tridiag_sym.mtx");
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
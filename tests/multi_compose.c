@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "traffic.h"
+#include "../src/openmp/openmp_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (129)
+#define OUTER_LEN (24)
+#define INNER_LEN (7)
+
+// The composed pattern run by the single-level kernels, and a stream that
+// repeats one inner pattern, must match the nested Multi kernels
+int kernel_test()
+{
+    size_t delta = 5;
+    size_t wrap = 3;
+
+    ssize_t outer[OUTER_LEN], inner[INNER_LEN], composed[INNER_LEN];
+    for (size_t j = 0; j < OUTER_LEN; j++)
+        outer[j] = (j * 11) % (2 * OUTER_LEN + 1);
+    for (size_t j = 0; j < INNER_LEN; j++) {
+        inner[j] = (j * 5 + 3) % OUTER_LEN;
+        composed[j] = outer[inner[j]];
+    }
+    ssize_t *stream = malloc(sizeof(ssize_t) * N * INNER_LEN);
+    for (size_t i = 0; i < N; i++)
+        memcpy(stream + INNER_LEN * i, inner, sizeof(inner));
+
+    size_t src_len = 2 * OUTER_LEN + 1 + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *dense_ref = calloc(INNER_LEN * wrap, sizeof(sgData_t));
+    sgData_t *dense = calloc(INNER_LEN * wrap, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    int rc = EXIT_SUCCESS;
+
+    multigather_smallbuf(&dense_ref, src, outer, inner, INNER_LEN, delta, N, wrap);
+    gather_smallbuf(&dense, src, composed, INNER_LEN, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * INNER_LEN * wrap)) {
+        printf("Test failure on the composed MultiGather\n");
+        rc = EXIT_FAILURE;
+    }
+    memset(dense, 0, sizeof(sgData_t) * INNER_LEN * wrap);
+    multigather_smallbuf_stream(&dense, src, outer, stream, INNER_LEN, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * INNER_LEN * wrap)) {
+        printf("Test failure on the streamed MultiGather\n");
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < INNER_LEN * wrap; i++)
+        dense[i] = -(sgData_t)i;
+    multiscatter_smallbuf(ref, &dense, outer, inner, INNER_LEN, delta, N, wrap);
+    scatter_smallbuf(src, &dense, composed, INNER_LEN, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on the composed MultiScatter\n");
+        rc = EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < INNER_LEN * wrap; i++)
+        dense[i] = (sgData_t)i + 0.5;
+    multiscatter_smallbuf(ref, &dense, outer, inner, INNER_LEN, delta, N, wrap);
+    multiscatter_smallbuf_stream(src, &dense, outer, stream, INNER_LEN, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on the streamed MultiScatter\n");
+        rc = EXIT_FAILURE;
+    }
+
+    free(stream);
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+// The stream of inner patterns is index traffic of every Gather
+int traffic_test()
+{
+    ssize_t outer[8] = {0, 2, 4, 6, 8, 10, 12, 14};
+    ssize_t inner[4] = {0, 2, 4, 6};
+    ssize_t stream[4 * 64];
+    for (size_t j = 0; j < 4 * 64; j++)
+        stream[j] = inner[j % 4];
+
+    struct run_config rc = {0};
+    struct sp_traffic nested, streamed;
+    rc.kernel = MULTIGATHER;
+    rc.pattern = outer;
+    rc.pattern_len = 8;
+    rc.pattern_gather = inner;
+    rc.pattern_gather_len = 4;
+    rc.delta = 16;
+    rc.generic_len = 64;
+    sp_traffic_model(&rc, &nested);
+    rc.inner_stream = stream;
+    sp_traffic_model(&rc, &streamed);
+
+    if (streamed.index != nested.index + 64 * 4 * sizeof(ssize_t) || streamed.lines != nested.lines) {
+        printf("Test failure on the --inner-stream traffic: %zu index bytes, %zu line bytes\n", streamed.index, streamed.lines);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+#ifdef USE_OPENMP
+    int nt = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    if (kernel_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#ifdef USE_OPENMP
+    omp_set_num_threads(nt);
+#endif
+    if (traffic_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+#ifdef USE_OPENMP
+    if (system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l4096 --compose -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiScatter -pUNIFORM:16:1 -hUNIFORM:8:2 -l4096 --compose -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l4096 --inner-stream -q3") != EXIT_SUCCESS ||
+        system("../spatter -kMultiScatter -pUNIFORM:16:1 -hUNIFORM:8:2 -l4096 --inner-stream -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --compose or --inner-stream runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l64 --compose --inner-stream -q3 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:2 -l64 --inner-stream -s1 -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --inner-stream config was accepted\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "noise.h"
+
+static void sleep_ms(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+int parse_test()
+{
+    struct sp_noise_spec s;
+    if (sp_noise_parse("stream:2:1.5", &s) || s.kernel != NOISE_TRIAD || s.threads != 2 || s.gbs != 1.5 ||
+        sp_noise_parse("nt:1", &s) || s.kernel != NOISE_NT || s.gbs != 0) {
+        printf("Test failure: a valid --noise was not parsed\n");
+        return EXIT_FAILURE;
+    }
+    if (!sp_noise_parse("stream", &s) || !sp_noise_parse("stream:0:1", &s) || !sp_noise_parse("dgemm:1:1", &s) ||
+        !sp_noise_parse("copy:1:-2", &s) || !sp_noise_parse("copy:1x", &s)) {
+        printf("Test failure: an invalid --noise was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// The throttled threads stay at or below their target, and move data at
+// all without one
+int run_test()
+{
+    struct sp_noise_spec s = {NOISE_COPY, 1, 0.25};
+    sp_noise_start(&s);
+    for (int pass = 0; pass < 2; pass++) {
+        sp_noise_begin();
+        sleep_ms(200);
+        double gbs = sp_noise_end();
+        if (gbs <= 0 || gbs > 0.25 * 1.1) {
+            printf("Test failure: throttled noise reached %g GB/s for a target of 0.25\n", gbs);
+            return EXIT_FAILURE;
+        }
+    }
+    sp_noise_stop();
+
+    s.kernel = NOISE_NT;
+    s.gbs = 0;
+    sp_noise_start(&s);
+    sp_noise_begin();
+    sleep_ms(50);
+    double gbs = sp_noise_end();
+    sp_noise_stop();
+    if (gbs <= 0) {
+        printf("Test failure: unthrottled noise moved nothing\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (run_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    if (system("../spatter -pUNIFORM:8:1 -l4096 -R3 --noise=stream:1:1 -q3") != EXIT_SUCCESS) {
+        printf("Test failure on a --noise run\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l64 --noise=stream > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --noise was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
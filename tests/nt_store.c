@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "traffic.h"
+#include "../src/openmp/openmp_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (301)
+
+// The streaming kernels must write exactly what the plain ones do, for
+// dense patterns at every alignment, strided patterns and odd lengths
+int store_test(ssize_t first, ssize_t stride, size_t pat_len)
+{
+    size_t delta = pat_len * stride + 1;
+    size_t wrap = 5;
+    int nt = 1;
+#ifdef USE_OPENMP
+    nt = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = first + j * stride;
+
+    size_t src_len = first + pat_len * stride + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *dense_ref = calloc(pat_len * wrap + 1, sizeof(sgData_t));
+    sgData_t *dense = calloc(pat_len * wrap + 1, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    int rc = EXIT_SUCCESS;
+
+    gather_smallbuf(&dense_ref, src, pat, pat_len, delta, N, wrap);
+    gather_smallbuf_nt(&dense, src, pat, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on nt gather with pattern %zd:%zd:%zu\n", first, stride, pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    // An odd offset into the dense buffer for the unaligned first store
+    sgData_t *row = dense + 1;
+    for (size_t i = 0; i < pat_len * wrap; i++)
+        row[i] = -(sgData_t)i;
+    scatter_smallbuf(ref, &row, pat, pat_len, delta, N, wrap);
+    scatter_smallbuf_nt(src, &row, pat, pat_len, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on nt scatter with pattern %zd:%zd:%zu\n", first, stride, pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    sgData_t *sg = malloc(sizeof(sgData_t) * src_len);
+    for (size_t i = 0; i < src_len; i++)
+        sg[i] = (sgData_t)i / 2;
+    sg_smallbuf(sg, ref, pat, pat, pat_len, delta, delta, N, wrap);
+    sg_smallbuf_nt(sg, src, pat, pat, pat_len, delta, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on nt GS with pattern %zd:%zd:%zu\n", first, stride, pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+#ifdef USE_OPENMP
+    omp_set_num_threads(nt);
+#endif
+    free(sg);
+    free(pat);
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+// Streamed Scatters move each line once, streamed Gathers add their rows
+int traffic_test()
+{
+    ssize_t pat[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    struct run_config rc = {0};
+    struct sp_traffic plain, nt;
+    rc.pattern = pat;
+    rc.pattern_len = 8;
+    rc.delta = 8;
+    rc.generic_len = 1 << 12;
+
+    rc.kernel = SCATTER;
+    sp_traffic_model(&rc, &plain);
+    rc.store = STORE_NT;
+    sp_traffic_model(&rc, &nt);
+    if (plain.lines != 2 * nt.lines) {
+        printf("Test failure on nt traffic: Scatter moves %zu bytes, %zu plain\n", nt.lines, plain.lines);
+        return EXIT_FAILURE;
+    }
+
+    rc.kernel = GATHER;
+    sp_traffic_model(&rc, &nt);
+    rc.store = STORE_PLAIN;
+    sp_traffic_model(&rc, &plain);
+    if (nt.lines != plain.lines + nt.useful) {
+        printf("Test failure on nt traffic: Gather moves %zu bytes, %zu plain\n", nt.lines, plain.lines);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    size_t lens[] = {1, 2, 7, 8, 16};
+    for (int l = 0; l < 5; l++) {
+        if (store_test(0, 1, lens[l]) != EXIT_SUCCESS ||
+            store_test(3, 1, lens[l]) != EXIT_SUCCESS ||
+            store_test(1, 4, lens[l]) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    if (traffic_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+#ifdef USE_OPENMP
+    if (system("../spatter -kScatter -pUNIFORM:8:1 -l4096 --store=nt -q3") != EXIT_SUCCESS ||
+        system("../spatter -kGather -pUNIFORM:8:2 -l4096 -w4096 --store=nt --schedule=steal -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --store=nt runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kScatter -pUNIFORM:8:1 -l64 -oACCUM --store=nt -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: --store=nt with an accumulate op was accepted\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+int numa_mode_test() {
+    const char *modes[] = {"firsttouch", "interleave",
+#ifdef USE_OPENMP
+        "replicate",
+#endif
+    };
+    const char *kernels[] = {"Gather", "Scatter"};
+
+    for (size_t m = 0; m < sizeof(modes)/sizeof(modes[0]); m++) {
+        for (size_t k = 0; k < 2; k++) {
+            char *command;
+            int ret = asprintf(&command, "../spatter --numa=%s -k%s -pUNIFORM:8:1 -l1024", modes[m], kernels[k]);
+            if (ret == -1 || system(command) != EXIT_SUCCESS) {
+                printf("Test failure on %s", command);
+                return EXIT_FAILURE;
+            }
+            free(command);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (numa_mode_test() != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
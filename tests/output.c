@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "output.h"
+
+static int count_lines(const char *path, const char *has, int *matching)
+{
+    char line[4096];
+    int n = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+    *matching = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        n++;
+        if (strstr(line, has))
+            (*matching)++;
+    }
+    fclose(fp);
+    return n;
+}
+
+// --output writes a meta record and one record per config as JSON Lines,
+// or a header and one row per timed run as CSV
+int main(int argc, char **argv)
+{
+    enum sp_output_format fmt;
+    char path[STRING_SIZE];
+    if (sp_output_parse("json:a.json", &fmt, path, sizeof(path)) || fmt != OUTPUT_JSON || strcmp(path, "a.json") ||
+            sp_output_parse("CSV:b.csv", &fmt, path, sizeof(path)) || fmt != OUTPUT_CSV || strcmp(path, "b.csv") ||
+            !sp_output_parse("xml:c.xml", &fmt, path, sizeof(path)) ||
+            !sp_output_parse("json", &fmt, path, sizeof(path)) ||
+            !sp_output_parse("json:", &fmt, path, sizeof(path)) ||
+            !sp_output_parse("jsonl:d", &fmt, path, sizeof(path))) {
+        printf("Test failure on sp_output_parse\n");
+        return EXIT_FAILURE;
+    }
+
+    int match;
+    if (system("../spatter -pUNIFORM:8:1 -l1024 -R3 -k Gather --output=json:output_test.json -q3") != EXIT_SUCCESS ||
+            count_lines("output_test.json", "\"kernel\":\"Gather\"", &match) != 2 || match != 1) {
+        printf("Test failure on --output=json\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l1024 -R3 -k MultiScatter -h UNIFORM:4:1 --output=json:output_test.json -q3") != EXIT_SUCCESS ||
+            count_lines("output_test.json", "\"kernel\":\"MultiScatter\"", &match) != 2 || match != 1) {
+        printf("Test failure on --output=json with MultiScatter\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l1024 -R4 -k Scatter --output=csv:output_test.csv -q3") != EXIT_SUCCESS ||
+            count_lines("output_test.csv", ",Scatter,", &match) != 5 || match != 4) {
+        printf("Test failure on --output=csv\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 --output=xml:output_test.xml -q3") == EXIT_SUCCESS) {
+        printf("Test failure: --output=xml was accepted\n");
+        return EXIT_FAILURE;
+    }
+    remove("output_test.json");
+    remove("output_test.csv");
+    return EXIT_SUCCESS;
+}
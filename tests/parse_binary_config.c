@@ -0,0 +1,102 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "config-bin.h"
+
+#define SPB_FILE "parse_binary_config.spb"
+
+int compare_configs(struct run_config *a, struct run_config *b, int nrc)
+{
+    for (int i = 0; i < nrc; i++)
+    {
+        if (a[i].kernel != b[i].kernel || a[i].generic_len != b[i].generic_len ||
+            a[i].delta != b[i].delta || a[i].wrap != b[i].wrap || a[i].nruns != b[i].nruns ||
+            strcmp(a[i].name, b[i].name))
+        {
+            printf("Test failure on binary config: run_config %d does not match its JSON source.\n", i);
+            return EXIT_FAILURE;
+        }
+
+        if (a[i].deltas_len != b[i].deltas_len || a[i].delta_gather != b[i].delta_gather ||
+            a[i].deltas_gather_len != b[i].deltas_gather_len || a[i].delta_scatter != b[i].delta_scatter ||
+            a[i].deltas_scatter_len != b[i].deltas_scatter_len)
+        {
+            printf("Test failure on binary config: deltas of run_config %d do not match its source.\n", i);
+            return EXIT_FAILURE;
+        }
+
+        if (a[i].pattern_len != b[i].pattern_len ||
+            memcmp(a[i].pattern, b[i].pattern, sizeof(ssize_t) * a[i].pattern_len))
+        {
+            printf("Test failure on binary config: pattern of run_config %d does not match its JSON source.\n", i);
+            return EXIT_FAILURE;
+        }
+
+        if (!b[i].pattern_mapped)
+        {
+            printf("Test failure on binary config: pattern of run_config %d was copied instead of mapped.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main ()
+{
+#ifndef JSON_SRC
+    printf("JSON SRC Directory not defined!\n");
+    return EXIT_FAILURE;
+#else
+    char *argv_[2];
+    int nrc_json = 0, nrc_bin = 0;
+    struct run_config *rc_json = NULL, *rc_bin = NULL;
+
+    asprintf(&argv_[0], "./spatter");
+    asprintf(&argv_[1], "-pFILE=%s", JSON_SRC);
+    parse_args(2, argv_, &nrc_json, &rc_json);
+    spb_write(SPB_FILE, rc_json, nrc_json);
+    free(argv_[1]);
+
+    if (!spb_is_binary(SPB_FILE) || spb_is_binary(JSON_SRC))
+    {
+        printf("Test failure on binary config: file type not detected.\n");
+        return EXIT_FAILURE;
+    }
+
+    asprintf(&argv_[1], "-pFILE=%s", SPB_FILE);
+    parse_args(2, argv_, &nrc_bin, &rc_bin);
+
+    if (nrc_bin != nrc_json)
+    {
+        printf("Test failure on binary config: expected %d run_configs, got %d.\n", nrc_json, nrc_bin);
+        return EXIT_FAILURE;
+    }
+
+    if (compare_configs(rc_json, rc_bin, nrc_json) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    // A built-in pattern keeps its single default delta without a list
+    int nrc_uni = 0, nrc_uni_bin = 0;
+    struct run_config *rc_uni = NULL, *rc_uni_bin = NULL;
+    char *argv_uni[3] = { argv_[0], "-pUNIFORM:8:1", "-l100" };
+    parse_args(3, argv_uni, &nrc_uni, &rc_uni);
+    spb_write(SPB_FILE, rc_uni, nrc_uni);
+    parse_args(2, argv_, &nrc_uni_bin, &rc_uni_bin);
+    if (nrc_uni_bin != 1 || rc_uni_bin[0].delta != 8 || rc_uni_bin[0].deltas_len != 1)
+    {
+        printf("Test failure on binary config: UNIFORM config lost its delta.\n");
+        return EXIT_FAILURE;
+    }
+    if (compare_configs(rc_uni, rc_uni_bin, 1) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    remove(SPB_FILE);
+    free(argv_[0]);
+    free(argv_[1]);
+    return EXIT_SUCCESS;
+#endif
+}
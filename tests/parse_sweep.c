@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "sweep.h"
+
+// Every value of a single argument, in order, joined with spaces
+int expand_test(const char *arg, size_t count, const char *gold)
+{
+    char *argv[2] = {"./spatter", (char *)arg};
+    char out[1024] = "";
+    size_t n = sp_sweep_count(2, argv);
+
+    for (size_t k = 0; k < n; k++) {
+        char **v = sp_sweep_argv(2, argv, k);
+        if (k)
+            strcat(out, " ");
+        strcat(out, v[1]);
+        sp_sweep_free(2, v);
+    }
+    if (n != count || strcmp(out, gold)) {
+        printf("Test failure on sweep %s: expected %zu values \"%s\", got %zu values \"%s\"\n", arg, count, gold, n, out);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (expand_test("-l1024", 1, "-l1024") ||
+        expand_test("-l{1..4}", 4, "-l1 -l2 -l3 -l4") ||
+        expand_test("-l{1..10:+3}", 4, "-l1 -l4 -l7 -l10") ||
+        expand_test("-l{3..11:4}", 3, "-l3 -l7 -l11") ||
+        expand_test("-l{1..100:x3}", 5, "-l1 -l3 -l9 -l27 -l81") ||
+        expand_test("-l{2^2..2^5}", 4, "-l4 -l8 -l16 -l32") ||
+        expand_test("-l{2^2..2^5:+8}", 4, "-l4 -l12 -l20 -l28") ||
+        expand_test("-l{2^4,100,3^2}", 3, "-l16 -l100 -l9") ||
+        expand_test("-k{Gather,Scatter}", 2, "-kGather -kScatter") ||
+        expand_test("-pUNIFORM:{4,8}:{1..2}", 4, "-pUNIFORM:4:1 -pUNIFORM:4:2 -pUNIFORM:8:1 -pUNIFORM:8:2") ||
+        expand_test("-p1,2,{", 1, "-p1,2,{"))
+        return EXIT_FAILURE;
+
+    // One config per point, the last argument varying fastest
+    char *args[] = {"./spatter", "-pUNIFORM:8:{1..128:x2}", "-l{2^10..2^12}", "-k{Gather,Scatter}", "-d{8}"};
+    int nrc = 0;
+    struct run_config *rc;
+    parse_args(5, args, &nrc, &rc);
+
+    if (nrc != 8 * 3 * 2) {
+        printf("Test failure on sweep: expected 48 configs, got %d\n", nrc);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < nrc; i++) {
+        size_t stride = (size_t)1 << (i / 6);
+        size_t len = (size_t)1024 << (i / 2 % 3);
+        enum sg_kernel kernel = i % 2 ? SCATTER : GATHER;
+        if (rc[i].pattern_len != 8 || rc[i].pattern[1] != (ssize_t)stride ||
+            rc[i].generic_len != len || rc[i].kernel != kernel || rc[i].delta != 8) {
+            printf("Test failure on sweep config %d: stride %zd, count %zu, kernel %d\n",
+                    i, rc[i].pattern[1], (size_t)rc[i].generic_len, rc[i].kernel);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
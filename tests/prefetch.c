@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "../src/openmp/openmp_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (257)
+
+// Prefetching must not change what the kernels read or write, at any
+// distance (including past the last Gather), scope and hint
+int prefetch_test(ssize_t stride, size_t pat_len, size_t distance, int line_only, int nta)
+{
+    size_t delta = pat_len * stride;
+    size_t wrap = 3;
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = j * stride;
+
+    size_t src_len = pat_len * stride + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    sgData_t *dense = calloc(pat_len * wrap, sizeof(sgData_t));
+    sgData_t *dense_ref = calloc(pat_len * wrap, sizeof(sgData_t));
+
+    int rc = EXIT_SUCCESS;
+
+    gather_smallbuf(&dense_ref, src, pat, pat_len, delta, N, wrap);
+    gather_smallbuf_prefetch(&dense, src, pat, pat_len, delta, N, wrap, distance, line_only, nta);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on prefetch gather with stride %zd, length %zu, distance %zu\n", stride, pat_len, distance);
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t j = 0; j < pat_len * wrap; j++)
+        dense[j] = -(sgData_t)j;
+    scatter_smallbuf(ref, &dense, pat, pat_len, delta, N, wrap);
+    scatter_smallbuf_prefetch(src, &dense, pat, pat_len, delta, N, wrap, distance, line_only, nta);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on prefetch scatter with stride %zd, length %zu, distance %zu\n", stride, pat_len, distance);
+        rc = EXIT_FAILURE;
+    }
+
+    free(dense);
+    free(dense_ref);
+    free(pat);
+    free(src);
+    free(ref);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+#ifdef USE_OPENMP
+    omp_set_num_threads(1);
+#endif
+    size_t lens[] = {1, 8, 13};
+    size_t dists[] = {1, 16, N + 5};
+    for (int l = 0; l < 3; l++) {
+        for (int d = 0; d < 3; d++) {
+            if (prefetch_test(1, lens[l], dists[d], 0, 0) != EXIT_SUCCESS ||
+                prefetch_test(24, lens[l], dists[d], 1, 1) != EXIT_SUCCESS ||
+                prefetch_test(24, lens[l], dists[d], 0, 1) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+
+#ifdef USE_OPENMP
+    if (system("../spatter -kGather -pUNIFORM:8:16 -d256 -l4096 --prefetch-distance=8 -q3") != EXIT_SUCCESS ||
+        system("../spatter -kScatter -pUNIFORM:8:16 -d256 -l4096 --prefetch-distance=4 --prefetch-hint=nta --prefetch-scope=line -q3") != EXIT_SUCCESS) {
+        printf("Test failure on --prefetch-distance runs\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -kGather -pUNIFORM:8:1 -l64 --prefetch-distance=8 --random=1 -q3 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -kGather -pUNIFORM:8:1 -l64 --prefetch-distance=8 --prefetch-hint=t1 -q3 > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --prefetch-distance config was accepted\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sgbuf.h"
+#include "sp_rand.h"
+
+#define LEN (3 * SP_RAND_BLOCK + 123)
+
+// The random data must be the same whatever the number of threads filling
+// it, within range, and not constant
+int main(int argc, char **argv)
+{
+    sgData_t *a = (sgData_t *)malloc(LEN * sizeof(sgData_t));
+    sgData_t *b = (sgData_t *)malloc(LEN * sizeof(sgData_t));
+    random_data(a, LEN, 1);
+    for (int t = 2; t <= 8; t *= 2) {
+        random_data(b, LEN, t);
+        if (memcmp(a, b, LEN * sizeof(sgData_t))) {
+            printf("Test failure: random_data differs between 1 and %d threads\n", t);
+            return EXIT_FAILURE;
+        }
+    }
+    int hist[10] = {0};
+    for (size_t i = 0; i < LEN; i++) {
+        if (a[i] < 0 || a[i] >= 10 || a[i] != (int)a[i]) {
+            printf("Test failure: value %g at %zu out of range\n", a[i], i);
+            return EXIT_FAILURE;
+        }
+        hist[(int)a[i]]++;
+    }
+    for (int v = 0; v < 10; v++) {
+        if (hist[v] < LEN / 20) {
+            printf("Test failure: value %d drawn %d times\n", v, hist[v]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The counter-based values only depend on the seed and the counter:
+    // drawn again in reverse, after other seeds, they are the same
+    uint64_t saved[1000];
+    for (uint64_t i = 0; i < 1000; i++)
+        saved[i] = sp_rand_at(7, i);
+    for (uint64_t i = 1000; i-- > 0;) {
+        if (sp_rand_at(8, i) == saved[i] || sp_rand_at(7, i) != saved[i] || sp_rand_bounded(7, i, 13) >= 13 ||
+                (i > 0 && saved[i] == saved[i - 1])) {
+            printf("Test failure on sp_rand_at at %llu\n", (unsigned long long)i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // A shuffle is a permutation
+    size_t v[1000];
+    int seen[1000] = {0};
+    for (size_t i = 0; i < 1000; i++)
+        v[i] = i;
+    sp_rand_shuffle(v, 1000, 42);
+    int moved = 0;
+    for (size_t i = 0; i < 1000; i++) {
+        if (v[i] >= 1000 || seen[v[i]]++) {
+            printf("Test failure: shuffle is not a permutation\n");
+            return EXIT_FAILURE;
+        }
+        moved += v[i] != i;
+    }
+    if (moved < 900) {
+        printf("Test failure: shuffle moved only %d of 1000\n", moved);
+        return EXIT_FAILURE;
+    }
+    free(a);
+    free(b);
+    return EXIT_SUCCESS;
+}
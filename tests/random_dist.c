@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "sp_rand.h"
+
+#define N 1000
+#define DRAWS 2000000
+
+// Draws from an alias table follow its weights: a Zipf law over N values
+// and one that puts nothing on every other value
+static int check_table(const char *what, const double *w)
+{
+    struct sp_alias_entry t[N];
+    static size_t hits[N];
+    double sum = 0;
+    for (int j = 0; j < N; j++) {
+        sum += w[j];
+        hits[j] = 0;
+    }
+    sp_alias_build(t, w, N);
+    for (size_t i = 0; i < DRAWS; i++)
+        hits[sp_rand_alias(t, 7, i, N)]++;
+
+    for (int j = 0; j < N; j++) {
+        double want = DRAWS * w[j] / sum;
+        // Five standard deviations of a binomial count
+        if (fabs(hits[j] - want) > 5 * sqrt(want) + 1) {
+            printf("Test failure: %s value %d drawn %zu times, expected %.0f\n", what, j, hits[j], want);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int status(const char *cmd)
+{
+    return system(cmd);
+}
+
+int main(int argc, char **argv)
+{
+    double w[N];
+    for (int j = 0; j < N; j++)
+        w[j] = pow(j + 1, -1.2);
+    if (check_table("zipf", w))
+        return EXIT_FAILURE;
+    for (int j = 0; j < N; j++)
+        w[j] = j % 2 ? 0 : 1 + j % 7;
+    if (check_table("sparse", w))
+        return EXIT_FAILURE;
+
+    if (status("../spatter -pUNIFORM:8:1 -l65536 --random=3 --random-dist=zipf:0.99 -q3") != 0 ||
+        status("../spatter -kScatter -pUNIFORM:8:1 -l65536 --random=3 --random-dist=hotset:0.01:0.9 -q3") != 0) {
+        printf("Test failure: a --random-dist config did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (status("../spatter -pUNIFORM:8:1 -l1024 --random=3 --random-dist=zipf:0 > /dev/null 2>&1") == 0 ||
+        status("../spatter -pUNIFORM:8:1 -l1024 --random=3 --random-dist=hotset:1.5:0.5 > /dev/null 2>&1") == 0 ||
+        status("../spatter -pUNIFORM:8:1 -l1024 --random=3 --random-dist=pareto > /dev/null 2>&1") == 0 ||
+        status("../spatter -pUNIFORM:8:1 -l1024 --random-dist=zipf:1 > /dev/null 2>&1") == 0 ||
+        status("../spatter -kMultiGather -pUNIFORM:8:1 -g0,1 -l1024 --random=3 --random-dist=zipf:1 > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --random-dist was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include "lat-hist.h"
+
+// Every value lands in a bucket whose middle is within 3% of it, and the
+// quantiles of a merged histogram are those of both
+int hist_test()
+{
+    for (uint64_t v = 1; v < ((uint64_t)1 << 40); v += v / 7 + 1) {
+        struct sp_hist h;
+        sp_hist_clear(&h);
+        sp_hist_add(&h, v);
+        sp_hist_add(&h, v + 1000000000000ULL);
+        double q = (double)sp_hist_quantile(&h, 0.25);
+        if (sp_hist_bucket(v) >= SP_HIST_BUCKETS || q < v * 0.97 || q > v * 1.03) {
+            printf("Test failure: %llu reads back as %g\n", (unsigned long long)v, q);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct sp_hist a, b;
+    sp_hist_clear(&a);
+    sp_hist_clear(&b);
+    for (uint64_t v = 0; v < 900; v++)
+        sp_hist_add(&a, 10);
+    for (uint64_t v = 0; v < 100; v++)
+        sp_hist_add(&b, 5000);
+    sp_hist_merge(&a, &b);
+    uint64_t p50 = sp_hist_quantile(&a, 0.5), p99 = sp_hist_quantile(&a, 0.99);
+    if (a.n != 1000 || a.max != 5000 || p50 != 10 || p99 < 4850 || p99 > 5000) {
+        printf("Test failure: merged histogram gives p50 %llu p99 %llu\n", (unsigned long long)p50, (unsigned long long)p99);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+#ifdef USE_OPENMP
+static int status(const char *cmd)
+{
+    int s = system(cmd);
+    return WIFEXITED(s) ? WEXITSTATUS(s) : -1;
+}
+
+// A paced run prints its percentiles, and kernels it can not pace are refused
+int run_test()
+{
+    FILE *p = popen("../spatter -pUNIFORM:8:1 -l4096 -t1 --rate=1", "r");
+    char line[4096];
+    int table = 0;
+    while (p && fgets(line, sizeof(line), p))
+        if (strstr(line, "p99.9(ns)"))
+            table = 1;
+    if (!p || pclose(p) != 0 || !table) {
+        printf("Test failure: a paced run did not report its percentiles\n");
+        return EXIT_FAILURE;
+    }
+    if (status("../spatter -kScatter -pUNIFORM:8:1 -l4096 --rate=1 > /dev/null 2>&1") == 0 ||
+        status("../spatter -pUNIFORM:8:1 -l4096 --rate=0 > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --rate was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    if (hist_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#ifdef USE_OPENMP
+    if (run_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#endif
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include "hilbert.h"
+#include "morton.h"
+
+// order is a permutation of the dim^n points, and with adjacent set every
+// step moves to a neighbour
+static int check_order(const uint32_t *order, uint64_t dim, int n, int adjacent)
+{
+    uint64_t total = n == 2 ? dim * dim : dim * dim * dim;
+    char *seen = (char *)calloc(total, 1);
+    for (uint64_t i = 0; i < total; i++) {
+        if (order[i] >= total || seen[order[i]]++) {
+            printf("Test failure: the %dd order of side %llu is not a permutation\n", n, (unsigned long long)dim);
+            return 0;
+        }
+        if (adjacent && i > 0) {
+            uint64_t a = order[i-1], b = order[i], dist = 0;
+            for (int d = 0; d < n; d++, a /= dim, b /= dim)
+                dist += a % dim > b % dim ? a % dim - b % dim : b % dim - a % dim;
+            if (dist != 1) {
+                printf("Test failure: the %dd Hilbert order of side %llu jumps at %llu\n", n, (unsigned long long)dim, (unsigned long long)i);
+                return 0;
+            }
+        }
+    }
+    free(seen);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    // Powers of two give a continuous curve, other sides a permutation
+    uint64_t sides[] = {1, 2, 4, 16, 64, 3, 12, 100};
+    for (int s = 0; s < 8; s++) {
+        int pow2 = !(sides[s] & (sides[s] - 1));
+        uint32_t *o2 = h_order_2d(sides[s], 1);
+        uint32_t *o3 = h_order_3d(sides[s], 1);
+        if (!o2 || !o3 || !check_order(o2, sides[s], 2, pow2) || !check_order(o3, sides[s], 3, pow2))
+            return EXIT_FAILURE;
+        free(o2);
+        free(o3);
+    }
+
+    // Blocked orders are still permutations
+    uint32_t *b2 = h_order_2d(48, 4);
+    uint32_t *b3 = h_order_3d(16, 2);
+    if (!b2 || !b3 || !check_order(b2, 48, 2, 0) || !check_order(b3, 16, 3, 0))
+        return EXIT_FAILURE;
+    free(b2);
+    free(b3);
+
+    if (h_order_2d(10, 3)) {
+        printf("Test failure: a block that does not divide the side was accepted\n");
+        return EXIT_FAILURE;
+    }
+
+    // Every reordered kernel runs and validates
+    const char *args[] = {
+        "-kGather -pUNIFORM:8:1 -l4096 --hilbert=2",
+        "-kScatter -pUNIFORM:8:1 -l4096 --hilbert=2 --roblock=4",
+        "-kScatter -pUNIFORM:8:1 -l4096 --morton=3",
+        "-kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -l4096 --hilbert=3",
+        "-kMultiScatter -pUNIFORM:16:1 -hUNIFORM:8:1 -l4096 --hilbert=2",
+        "-kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:1 -l4096 --hilbert=1",
+    };
+    for (int i = 0; i < 6; i++) {
+        char *command;
+        int ret = asprintf(&command, "../spatter --validate %s", args[i]);
+        if (ret == -1 || system(command) != EXIT_SUCCESS) {
+            printf("Test failure on %s\n", command);
+            return EXIT_FAILURE;
+        }
+        free(command);
+    }
+
+    // -l has to fill the square
+    if (system("../spatter -kScatter -pUNIFORM:8:1 -l4000 --hilbert=2 2>/dev/null") == EXIT_SUCCESS) {
+        printf("Test failure: --hilbert=2 accepted a -l that is not a square\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "parse-args.h"
+#include "reuse.h"
+#include "traffic.h"
+
+// A uniform Gather of 8 elements, one line each, over count lines
+static void profile(size_t count, struct sp_reuse *r)
+{
+    ssize_t pat[8];
+    for (size_t j = 0; j < 8; j++)
+        pat[j] = j;
+
+    struct run_config rc = {0};
+    rc.kernel = GATHER;
+    rc.type = UNIFORM;
+    rc.pattern = pat;
+    rc.pattern_len = 8;
+    rc.delta = 8;
+    rc.deltas_len = 1;
+    rc.generic_len = count;
+    rc.wrap = 1;
+    rc.omp_threads = 1;
+    sp_reuse_analyze(&rc, r);
+}
+
+int main(int argc, char **argv)
+{
+    if (sp_line_size() != 64) {
+        printf("Skipping reuse profile test for %zu byte cache lines\n", sp_line_size());
+        return EXIT_SUCCESS;
+    }
+
+    // 4096 lines and the dense one are tracked in full. Each element of a
+    // line is read one reference to the dense line after the one before,
+    // and the first is read after every other line of the run.
+    struct sp_reuse r;
+    profile(4096, &r);
+    double l1 = sp_reuse_capacity(REUSE_L1, 1) <= 4096 ? 1 / 16. : 0;
+    if (r.rate != 1 || r.refs != 4096 * 16 || r.cold != 0 || fabs(r.hist[1] - 15 / 16.) > 1e-9 ||
+        fabs(r.hist[13] - 1 / 16.) > 1e-9 || fabs(r.miss[REUSE_L1] - l1) > 1e-9) {
+        printf("Test failure: the profile of 4096 lines has rate %g, %g refs, %g cold, %g at 1 and %g at 4096-8191, L1 miss ratio %g\n",
+                r.rate, r.refs, r.cold, r.hist[1], r.hist[13], r.miss[REUSE_L1]);
+        return EXIT_FAILURE;
+    }
+
+    // Too many lines to track, the sample still puts the first element of
+    // each line about one run apart
+    profile(1 << 18, &r);
+    double first = 0, sum = r.cold;
+    for (int b = 0; b < SP_REUSE_BINS; b++) {
+        sum += r.hist[b];
+        if (b >= 17)
+            first += r.hist[b];
+    }
+    if (r.rate >= 1 || fabs(sum - 1) > 1e-9 || first < 1 / 20. || first > 1 / 7.) {
+        printf("Test failure: the sampled profile of 2^18 lines has rate %g, sums to %g, %g at 2^16 lines or more\n", r.rate, sum, first);
+        return EXIT_FAILURE;
+    }
+
+    if (system("../spatter -pUNIFORM:8:1 -l4096 --analyze-reuse -q3 --output=json:reuse.json") != 0) {
+        printf("Test failure: --analyze-reuse did not run\n");
+        return EXIT_FAILURE;
+    }
+    FILE *f = fopen("reuse.json", "r");
+    char line[8192];
+    int found = 0;
+    while (f && fgets(line, sizeof(line), f))
+        found |= strstr(line, "\"reuse\":{\"refs\":") != NULL;
+    if (f)
+        fclose(f);
+    remove("reuse.json");
+    if (!found) {
+        printf("Test failure: the JSON record has no reuse profile\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "../src/openmp/omp-sched.h"
+
+#if defined( USE_OPENMP )
+#include <omp.h>
+#else
+#define omp_get_thread_num() 0
+#define omp_get_max_threads() 1
+#endif
+
+// Every schedule must hand out each of the n iterations exactly once
+int cover_test(enum sg_schedule kind, size_t chunk, size_t n)
+{
+    _Atomic int *hits = (_Atomic int *)calloc(n + 1, sizeof(_Atomic int));
+
+    sp_sched_set(kind, chunk);
+    sp_sched_reset(n);
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        size_t i0, i1;
+        while (sp_sched_next(t, &i0, &i1))
+        for (size_t i = i0; i < i1; i++)
+            atomic_fetch_add(&hits[i], 1);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (hits[i] != 1) {
+            printf("Test failure on schedule %s:%zu, n %zu: iteration %zu ran %d times\n",
+                    sp_sched_name(kind), chunk, n, i, (int)hits[i]);
+            free(hits);
+            return EXIT_FAILURE;
+        }
+    }
+    free(hits);
+    return EXIT_SUCCESS;
+}
+
+// The per-thread iterations of two instrumented loops add up to 2n
+int stats_test()
+{
+    size_t n = 1000;
+    _Atomic int *hits = (_Atomic int *)calloc(n, sizeof(_Atomic int));
+    struct sp_thread_stats *st = (struct sp_thread_stats *)malloc(sizeof(struct sp_thread_stats) * omp_get_max_threads());
+
+    sp_sched_instrument(1);
+    sp_thread_stats_reset();
+    sp_sched_set(SCHED_STEAL, 3);
+    for (int r = 0; r < 2; r++) {
+        sp_sched_reset(n);
+#pragma omp parallel
+        {
+            int t = omp_get_thread_num();
+            size_t i0, i1;
+            while (sp_sched_next(t, &i0, &i1))
+            for (size_t i = i0; i < i1; i++)
+                atomic_fetch_add(&hits[i], 1);
+        }
+    }
+
+    int nt = sp_thread_stats(st, omp_get_max_threads());
+    size_t iters = 0;
+    for (int t = 0; t < nt; t++) {
+        iters += st[t].iters;
+        if (st[t].busy_ms < 0 || st[t].wait_ms < 0) {
+            printf("Test failure on thread stats: negative time on thread %d\n", t);
+            return EXIT_FAILURE;
+        }
+    }
+    sp_sched_instrument(0);
+    free(hits);
+    free(st);
+    if (nt != omp_get_max_threads() || iters != 2 * n) {
+        printf("Test failure on thread stats: %d threads, %zu iterations\n", nt, iters);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int options_test()
+{
+    const char *schedules[] = {"static", "dynamic", "dynamic:16", "guided:4", "steal", "steal:1"};
+    for (size_t s = 0; s < sizeof(schedules)/sizeof(schedules[0]); s++) {
+        char *command;
+        int ret = asprintf(&command, "../spatter --schedule=%s --busy-times -pUNIFORM:8:1 -l1024 --validate", schedules[s]);
+        if (ret == -1 || system(command) != EXIT_SUCCESS) {
+            printf("Test failure on %s", command);
+            return EXIT_FAILURE;
+        }
+        free(command);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    enum sg_schedule kinds[] = {SCHED_STATIC, SCHED_DYNAMIC, SCHED_GUIDED, SCHED_STEAL};
+    size_t chunks[] = {0, 1, 7, 1000};
+    size_t lens[] = {0, 1, 5, 1000, 1 << 16};
+
+    for (int k = 0; k < 4; k++)
+        for (int c = 0; c < 4; c++)
+            for (int l = 0; l < 5; l++)
+                if (cover_test(kinds[k], chunks[c], lens[l]) != EXIT_SUCCESS)
+                    return EXIT_FAILURE;
+
+    if (stats_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+#if defined( USE_OPENMP )
+    if (options_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "morton.h"
+#include "sp_rand.h"
+#include "../src/openmp/openmp_kernels.h"
+#include "../src/serial/serial-kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (256)
+#define PAT_LEN (13)
+#define INNER_LEN (6)
+#define WRAP (3)
+#define SEED (7)
+
+static ssize_t pat[PAT_LEN], inner[INNER_LEN];
+static size_t deltas_ps[3] = {4, 10, 22};
+static sgData_t *src, *src_ref, *dense, *dense_ref;
+static size_t src_len;
+
+static void reset(void)
+{
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = src_ref[i] = (sgData_t)i;
+    for (size_t i = 0; i < src_len; i++)
+        dense[i] = dense_ref[i] = -(sgData_t)i;
+}
+
+static int check(const char *name)
+{
+    if (memcmp(src, src_ref, sizeof(sgData_t) * src_len) ||
+        memcmp(dense, dense_ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on the serial %s kernel\n", name);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Each serial variant must move the same data as its OpenMP counterpart on
+// one thread
+int main(int argc, char **argv)
+{
+#ifdef USE_OPENMP
+    omp_set_num_threads(1);
+#endif
+    size_t delta = 5;
+    for (size_t j = 0; j < PAT_LEN; j++)
+        pat[j] = (j * 7) % (2 * PAT_LEN + 1);
+    for (size_t j = 0; j < INNER_LEN; j++)
+        inner[j] = (j * 5 + 2) % PAT_LEN;
+    src_len = 2 * PAT_LEN + 1 + 22 * N;
+    src = malloc(sizeof(sgData_t) * src_len);
+    src_ref = malloc(sizeof(sgData_t) * src_len);
+    dense = malloc(sizeof(sgData_t) * src_len);
+    dense_ref = malloc(sizeof(sgData_t) * src_len);
+    uint32_t *order = z_order_2d(16, 1);
+
+    int rc = EXIT_SUCCESS;
+
+    reset();
+    gather_smallbuf_morton(&dense_ref, src_ref, pat, PAT_LEN, delta, N, WRAP, order);
+    gather_smallbuf_morton_serial(&dense, src, pat, PAT_LEN, delta, N, WRAP, order);
+    rc |= check("Gather morton");
+    reset();
+    scatter_smallbuf_morton(src_ref, &dense_ref, pat, PAT_LEN, delta, N, WRAP, order);
+    scatter_smallbuf_morton_serial(src, &dense, pat, PAT_LEN, delta, N, WRAP, order);
+    rc |= check("Scatter morton");
+    reset();
+    gather_smallbuf_random(&dense_ref, src_ref, pat, PAT_LEN, delta, N, WRAP, SEED, NULL);
+    gather_smallbuf_random_serial(&dense, src, pat, PAT_LEN, delta, N, WRAP, SEED, NULL);
+    rc |= check("Gather random");
+    reset();
+    scatter_smallbuf_random(src_ref, &dense_ref, pat, PAT_LEN, delta, N, WRAP, SEED, NULL);
+    scatter_smallbuf_random_serial(src, &dense, pat, PAT_LEN, delta, N, WRAP, SEED, NULL);
+    rc |= check("Scatter random");
+    struct sp_alias_entry alias[N];
+    uint32_t bases[N];
+    double w[N];
+    for (size_t i = 0; i < N; i++)
+        w[i] = 1.0 / (i + 1);
+    sp_alias_build(alias, w, N);
+    for (size_t i = 0; i < N; i++)
+        bases[i] = sp_rand_alias(alias, SEED, i, N);
+    reset();
+    gather_smallbuf_random(&dense_ref, src_ref, pat, PAT_LEN, delta, N, WRAP, SEED, bases);
+    gather_smallbuf_random_serial(&dense, src, pat, PAT_LEN, delta, N, WRAP, SEED, bases);
+    rc |= check("Gather random-dist");
+    reset();
+    scatter_smallbuf_random(src_ref, &dense_ref, pat, PAT_LEN, delta, N, WRAP, SEED, bases);
+    scatter_smallbuf_random_serial(src, &dense, pat, PAT_LEN, delta, N, WRAP, SEED, bases);
+    rc |= check("Scatter random-dist");
+    reset();
+    gather_smallbuf_multidelta(&dense_ref, src_ref, pat, PAT_LEN, deltas_ps, N, WRAP, 3);
+    gather_smallbuf_multidelta_serial(&dense, src, pat, PAT_LEN, deltas_ps, N, WRAP, 3);
+    rc |= check("Gather multidelta");
+    reset();
+    gather_smallbuf(&dense_ref, src_ref, pat, PAT_LEN, delta, N, WRAP);
+    gather_smallbuf_prefetch_serial(&dense, src, pat, PAT_LEN, delta, N, WRAP, 4, 0, 0);
+    rc |= check("Gather prefetch");
+    reset();
+    scatter_smallbuf(src_ref, &dense_ref, pat, PAT_LEN, delta, N, WRAP);
+    scatter_smallbuf_prefetch_serial(src, &dense, pat, PAT_LEN, delta, N, WRAP, 4, 1, 1);
+    rc |= check("Scatter prefetch");
+
+    reset();
+    multigather_smallbuf_morton(&dense_ref, src_ref, pat, inner, INNER_LEN, delta, N, WRAP, order);
+    multigather_smallbuf_morton_serial(&dense, src, pat, inner, INNER_LEN, delta, N, WRAP, order);
+    rc |= check("MultiGather morton");
+    reset();
+    multiscatter_smallbuf_morton(src_ref, &dense_ref, pat, inner, INNER_LEN, delta, N, WRAP, order);
+    multiscatter_smallbuf_morton_serial(src, &dense, pat, inner, INNER_LEN, delta, N, WRAP, order);
+    rc |= check("MultiScatter morton");
+    reset();
+    multigather_smallbuf_random(&dense_ref, src_ref, pat, inner, INNER_LEN, delta, N, WRAP, SEED);
+    multigather_smallbuf_random_serial(&dense, src, pat, inner, INNER_LEN, delta, N, WRAP, SEED);
+    rc |= check("MultiGather random");
+    reset();
+    multiscatter_smallbuf_random(src_ref, &dense_ref, pat, inner, INNER_LEN, delta, N, WRAP, SEED);
+    multiscatter_smallbuf_random_serial(src, &dense, pat, inner, INNER_LEN, delta, N, WRAP, SEED);
+    rc |= check("MultiScatter random");
+    reset();
+    multigather_smallbuf_multidelta(&dense_ref, src_ref, pat, inner, INNER_LEN, deltas_ps, N, WRAP, 3);
+    multigather_smallbuf_multidelta_serial(&dense, src, pat, inner, INNER_LEN, deltas_ps, N, WRAP, 3);
+    rc |= check("MultiGather multidelta");
+
+    reset();
+    sg_smallbuf_morton(src_ref, dense_ref, pat, pat, PAT_LEN, delta, 1, N, WRAP, order);
+    sg_smallbuf_morton_serial(src, dense, pat, pat, PAT_LEN, delta, 1, N, WRAP, order);
+    rc |= check("GS morton");
+
+    free(order);
+    free(src);
+    free(src_ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "spatter.h"
+
+// Parse single json configs and arrays of them, and reject anything else
+int parse_test()
+{
+    struct sp_suite *one = sp_config_parse_json("{\"pattern\":\"UNIFORM:8:1\",\"count\":64}");
+    struct sp_suite *two = sp_config_parse_json("[{\"pattern\":[0,1,2,3],\"count\":64},{\"kernel\":\"Scatter\",\"pattern\":\"UNIFORM:4:2\",\"count\":64}]");
+    if (sp_config_count(one) != 1 || sp_config_count(two) != 2 || sp_config_get(two, 1)->kernel != SCATTER ||
+            sp_config_get(two, 0)->pattern_len != 4) {
+        printf("Test failure: json configs were not parsed\n");
+        return EXIT_FAILURE;
+    }
+    if (sp_config_parse_json("not json") || sp_config_parse_json("42") || sp_config_parse_json("[]")) {
+        printf("Test failure: a line that is not a config was parsed\n");
+        return EXIT_FAILURE;
+    }
+    sp_config_free(one);
+    sp_config_free(two);
+    return EXIT_SUCCESS;
+}
+
+// Every line gets a record, a run or an error, after the meta record
+int serve_test()
+{
+    FILE *p = popen("printf '%s\\n' '{\"pattern\":\"UNIFORM:8:1\",\"count\":1024}' 'not json' "
+                    "'[{\"pattern\":[0,1,2,3],\"count\":100},{\"pattern\":\"UNIFORM:8:1\",\"count\":100000000}]' "
+                    "| ../spatter -pUNIFORM:8:1 -l4096 --serve=stdin 2>/dev/null", "r");
+    if (!p)
+        return EXIT_FAILURE;
+    char line[8192];
+    int meta = 0, runs = 0, errors = 0;
+    while (fgets(line, sizeof(line), p)) {
+        meta += !strncmp(line, "{\"type\":\"meta\"", 14);
+        runs += !strncmp(line, "{\"type\":\"run\"", 13);
+        errors += !strncmp(line, "{\"type\":\"error\"", 15);
+    }
+    if (pclose(p) != 0 || meta != 1 || runs != 2 || errors != 2) {
+        printf("Test failure on --serve=stdin: %d meta, %d run and %d error records\n", meta, runs, errors);
+        return EXIT_FAILURE;
+    }
+
+    if (system("../spatter -pUNIFORM:8:1 -l64 --serve=tcp:8080 > /dev/null 2>&1") == EXIT_SUCCESS ||
+        system("../spatter -pUNIFORM:8:1 -l64 --serve=stdin --cache=cold < /dev/null > /dev/null 2>&1") == EXIT_SUCCESS) {
+        printf("Test failure: an invalid --serve was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (serve_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NCONFIGS 7
+
+// Count the run records of each config in a JSON Lines file
+static int count_records(const char *file, int *seen)
+{
+    FILE *f = fopen(file, "r");
+    char line[65536];
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f)) {
+        int k;
+        if (sscanf(line, "{\"type\":\"run\",\"config\":%d", &k) == 1 && k >= 0 && k < NCONFIGS)
+            seen[k]++;
+    }
+    fclose(f);
+    return 0;
+}
+
+static int check_once(const int *seen, const char *what)
+{
+    for (int k = 0; k < NCONFIGS; k++) {
+        if (seen[k] != 1) {
+            printf("Test failure: %s ran config %d %d times\n", what, k, seen[k]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The shards of a suite run every config once between them, and a resumed
+// job runs only the configs its file has no record of, a repeated config
+// as many times as it is listed
+int main(int argc, char **argv)
+{
+    FILE *f = fopen("shard_suite.json", "w");
+    fprintf(f, "[{\"kernel\":\"Gather\",\"pattern\":\"UNIFORM:8:1\",\"count\":1000,\"name\":\"a\"},\n"
+            " {\"kernel\":\"Gather\",\"pattern\":\"UNIFORM:16:1\",\"count\":100000,\"name\":\"b\"},\n"
+            " {\"kernel\":\"Scatter\",\"pattern\":\"UNIFORM:4:1\",\"count\":50,\"name\":\"c\"},\n"
+            " {\"kernel\":\"Gather\",\"pattern\":\"UNIFORM:8:2\",\"count\":70000,\"name\":\"d\"},\n"
+            " {\"kernel\":\"Gather\",\"pattern\":\"UNIFORM:8:1\",\"count\":1000,\"name\":\"a\"},\n"
+            " {\"kernel\":\"Scatter\",\"pattern\":\"UNIFORM:8:4\",\"count\":20000,\"name\":\"e\"},\n"
+            " {\"kernel\":\"Gather\",\"pattern\":\"UNIFORM:8:1\",\"count\":1000,\"name\":\"f\"}]\n");
+    fclose(f);
+
+    int seen[NCONFIGS] = {0};
+    remove("shard_out.json");
+    if (system("../spatter -pFILE=shard_suite.json --shard=0/3 -q3 --output=json:shard_0.json") != 0 ||
+        system("../spatter -pFILE=shard_suite.json --shard=1/3 -q3 --output=json:shard_1.json") != 0 ||
+        system("../spatter -pFILE=shard_suite.json --shard=2/3 -q3 --output=json:shard_2.json") != 0 ||
+        count_records("shard_0.json", seen) || count_records("shard_1.json", seen) || count_records("shard_2.json", seen)) {
+        printf("Test failure: a --shard job did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (check_once(seen, "the shards"))
+        return EXIT_FAILURE;
+
+    memset(seen, 0, sizeof(seen));
+    if (system("../spatter -pFILE=shard_suite.json --shard=1/2 -q3 --resume=shard_out.json --output=json:shard_out.json") != 0 ||
+        system("../spatter -pFILE=shard_suite.json -q3 --resume=shard_out.json --output=json:shard_out.json") != 0 ||
+        system("../spatter -pFILE=shard_suite.json -q3 --resume=shard_out.json --output=json:shard_out.json") != 0 ||
+        count_records("shard_out.json", seen)) {
+        printf("Test failure: a --resume job did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (check_once(seen, "the resumed jobs"))
+        return EXIT_FAILURE;
+
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --shard=2/2 > /dev/null 2>&1") == 0 ||
+        system("../spatter -pUNIFORM:8:1 -l1024 --shard=1 > /dev/null 2>&1") == 0 ||
+        system("../spatter -pUNIFORM:8:1 -l1024 --resume=shard_out.csv --output=csv:shard_out.csv > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --shard or --resume was accepted\n");
+        return EXIT_FAILURE;
+    }
+
+    remove("shard_suite.json");
+    remove("shard_0.json");
+    remove("shard_1.json");
+    remove("shard_2.json");
+    remove("shard_out.json");
+    return EXIT_SUCCESS;
+}
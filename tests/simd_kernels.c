@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "parse-args.h"
+#include "backend-support-tests.h"
+#include "../src/openmp/openmp_kernels.h"
+#include "../src/openmp/openmp_simd_kernels.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define N (257)
+
+// Compare every vector kernel that this machine supports against the scalar
+// kernel, for pattern lengths that exercise both the full vectors and the tail.
+int simd_test(enum sg_simd isa, size_t pat_len)
+{
+    size_t delta = 3;
+    size_t wrap = 2;
+    int nt = 1;
+#ifdef USE_OPENMP
+    nt = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+
+    ssize_t *pat = malloc(sizeof(ssize_t) * pat_len);
+    for (size_t j = 0; j < pat_len; j++)
+        pat[j] = (j * 7) % (2 * pat_len + 1);
+
+    size_t src_len = 2 * pat_len + 1 + delta * N;
+    sgData_t *src = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *ref = malloc(sizeof(sgData_t) * src_len);
+    sgData_t *dense_ref = calloc(pat_len * wrap, sizeof(sgData_t));
+    sgData_t *dense = calloc(pat_len * wrap, sizeof(sgData_t));
+    for (size_t i = 0; i < src_len; i++)
+        src[i] = ref[i] = (sgData_t)i;
+
+    int rc = EXIT_SUCCESS;
+
+    gather_smallbuf(&dense_ref, src, pat, pat_len, delta, N, wrap);
+    gather_smallbuf_simd(isa, &dense, src, pat, pat_len, delta, N, wrap);
+    if (memcmp(dense, dense_ref, sizeof(sgData_t) * pat_len * wrap)) {
+        printf("Test failure on %s gather with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < pat_len * wrap; i++)
+        dense[i] = -(sgData_t)i;
+    scatter_smallbuf(ref, &dense, pat, pat_len, delta, N, wrap);
+    scatter_smallbuf_simd(isa, src, &dense, pat, pat_len, delta, N, wrap);
+    if (memcmp(src, ref, sizeof(sgData_t) * src_len)) {
+        printf("Test failure on %s scatter with pattern length %zu\n", sg_simd_name(isa), pat_len);
+        rc = EXIT_FAILURE;
+    }
+
+#ifdef USE_OPENMP
+    omp_set_num_threads(nt);
+#endif
+    free(pat);
+    free(src);
+    free(ref);
+    free(dense);
+    free(dense_ref);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    enum sg_simd isas[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512, SIMD_SVE};
+    size_t lens[] = {1, 3, 4, 8, 13, 16, 27, 32, 64, 73};
+
+    for (size_t i = 0; i < sizeof(isas)/sizeof(isas[0]); i++) {
+        if (!sg_simd_support(isas[i]))
+            continue;
+        for (size_t j = 0; j < sizeof(lens)/sizeof(lens[0]); j++) {
+            if (simd_test(isas[i], lens[j]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
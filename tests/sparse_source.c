@@ -0,0 +1,46 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+
+// Run spatter with --sparse-source --validate, 0 if it ran and every
+// check passed: a failed check exits with SP_EXIT_INVALID
+static int run(const char *args)
+{
+    char *command;
+    int ret = asprintf(&command, "../spatter %s --sparse-source --validate -q3 > /dev/null 2>&1", args);
+    if (ret == -1)
+        return -1;
+    ret = system(command) != EXIT_SUCCESS ? -1 : 0;
+    free(command);
+    return ret;
+}
+
+// Sources spanning a TiB, or with an index far beyond the boundary a dense
+// source wraps to, run and gather what they should from the pages they back
+int main(int argc, char **argv)
+{
+    const char *sparse[] = {
+        "-pUNIFORM:8:1 -d134217728 -l1024",
+        "-kScatter -pUNIFORM:8:1 -d134217728 -l1024",
+        "-p0,1,1099511627776,7 -l1024",
+        "-kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:1 -d134217728 -l1024",
+        "-pUNIFORM:8:1 -d134217728 -l1024 --random=5",
+        "-pUNIFORM:8:1 -d134217728 -l1024 --elem=f32",
+        "-pUNIFORM:8:1 -l65536",
+    };
+    for (size_t i = 0; i < sizeof(sparse) / sizeof(sparse[0]); i++) {
+        if (run(sparse[i]) != 0) {
+            printf("Test failure: spatter %s --sparse-source did not pass\n", sparse[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (run("-kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -l1024") == 0) {
+        printf("Test failure: --sparse-source ran a GS config\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
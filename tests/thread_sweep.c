@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "pin.h"
+
+static int expect(const char *arg, const size_t *want, int n, enum sp_pin_policy policy)
+{
+    struct sp_thread_sweep sweep;
+    int ok = !sp_thread_sweep_parse(arg, &sweep) && sweep.n == n && sweep.policy == policy &&
+        !memcmp(sweep.threads, want, n * sizeof(size_t));
+    if (!ok)
+        printf("Test failure: --thread-sweep=%s was not parsed as expected\n", arg);
+    return !ok;
+}
+
+// The .. of a sweep continues a doubling or a constant step, the counts
+// are sorted and repeated ones dropped, and the knee is the first count
+// within SP_KNEE_FRACTION of the best
+int main(int argc, char **argv)
+{
+    size_t pow2[] = {1, 2, 4, 8, 16};
+    size_t step[] = {3, 5, 7, 9, 10};
+    size_t list[] = {2, 4, 6};
+    if (expect("1,2,..,16", pow2, 5, PIN_COMPACT) ||
+        expect("3,5,..,10:spread", step, 5, PIN_SPREAD) ||
+        expect("6,2,4,4:compact", list, 3, PIN_COMPACT))
+        return EXIT_FAILURE;
+
+    const char *bad[] = {"..", "1,..,4", "0", "4,2,..,8", "1,2,..", "1,2:close", "2,x"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        struct sp_thread_sweep sweep;
+        if (sp_thread_sweep_parse(bad[i], &sweep) == 0) {
+            printf("Test failure: --thread-sweep=%s was accepted\n", bad[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    double mbs[] = {100, 170, 195, 200, 190};
+    if (sp_thread_sweep_knee(mbs, 5) != 2) {
+        printf("Test failure: the knee of the sweep is at %d\n", sp_thread_sweep_knee(mbs, 5));
+        return EXIT_FAILURE;
+    }
+
+    if (system("../spatter -pUNIFORM:8:1 -l65536 --thread-sweep=1,max -q3") != 0 ||
+        system("../spatter -kScatter -pUNIFORM:8:4 -l65536 --thread-sweep=max:spread -q3") != 0) {
+        printf("Test failure: a --thread-sweep config did not run\n");
+        return EXIT_FAILURE;
+    }
+    if (system("../spatter -pUNIFORM:8:1 -l1024 --thread-sweep=100000 > /dev/null 2>&1") == 0 ||
+        system("../spatter -pUNIFORM:8:1 -l1024 --thread-sweep=1,max:close > /dev/null 2>&1") == 0 ||
+        system("../spatter -pUNIFORM:8:1 -l1024 --thread-sweep=max --co-run > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --thread-sweep was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include "numa-util.h"
+#include "traffic.h"
+
+int parse_test()
+{
+    struct sp_tier t;
+    if (sp_tier_parse("0:70,2:30", &t) || t.n != 2 || t.node[0] != 0 || t.weight[0] != 70 || t.node[1] != 2 || t.weight[1] != 30 ||
+        sp_tier_parse("interleave", &t) || t.n != sp_numa_num_nodes() || t.weight[0] != 1) {
+        printf("Test failure: a valid --tier was not parsed\n");
+        return EXIT_FAILURE;
+    }
+    const char *bad[] = {"", "0", "0:", "0:-1", "0:0", "0:1,0:2", "0:1,", "0:1;1:1", "-1:5", "fast"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        if (!sp_tier_parse(bad[i], &t)) {
+            printf("Test failure: --tier=%s was accepted\n", bad[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// A Gather over pages that alternate between two nodes reads half of its
+// bytes from each, and pages of unknown node count nowhere
+int nodes_test()
+{
+    ssize_t pat[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    struct run_config rc = {0};
+    rc.kernel = GATHER;
+    rc.pattern = pat;
+    rc.pattern_len = 8;
+    rc.delta = 8;
+    rc.generic_len = 1 << 12;
+
+    unsigned char node[64];
+    for (int p = 0; p < 64; p++)
+        node[p] = p % 2;
+    struct sp_page_map map = {node, 64, 4096, 0};
+    double bytes[SP_MAX_NUMA_NODES];
+    sp_traffic_nodes(&rc, &map, &map, bytes);
+    double half = 8. * 8 * 4096 / 2;
+    if (bytes[0] != half || bytes[1] != half || bytes[2] != 0) {
+        printf("Test failure: nodes 0 and 1 served %g and %g bytes, expected %g each\n", bytes[0], bytes[1], half);
+        return EXIT_FAILURE;
+    }
+
+    memset(node, SP_NUMA_UNKNOWN, sizeof(node));
+    sp_traffic_nodes(&rc, &map, &map, bytes);
+    for (int n = 0; n < SP_MAX_NUMA_NODES; n++) {
+        if (bytes[n] != 0) {
+            printf("Test failure: node %d served %g bytes from unknown pages\n", n, bytes[n]);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static int status(const char *cmd)
+{
+    int s = system(cmd);
+    return WIFEXITED(s) ? WEXITSTATUS(s) : -1;
+}
+
+// Every machine has a node 0, a split onto it runs and reports the node
+int run_test()
+{
+    FILE *p = popen("../spatter -pUNIFORM:8:4 -l4096 --tier=0:1 --tier-target=interleave", "r");
+    char line[4096];
+    int table = 0;
+    while (p && fgets(line, sizeof(line), p))
+        if (strstr(line, "node0(MB/s)"))
+            table = 1;
+    if (!p || pclose(p) != 0 || !table) {
+        printf("Test failure: a tiered run did not report the bandwidth of its nodes\n");
+        return EXIT_FAILURE;
+    }
+    if (status("../spatter -pUNIFORM:8:4 -l4096 --tier=64:1 > /dev/null 2>&1") == 0 ||
+        status("../spatter -pUNIFORM:8:4 -l4096 --tier=0:1 --numa=interleave > /dev/null 2>&1") == 0) {
+        printf("Test failure: an invalid --tier was accepted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (nodes_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    if (run_test() != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "parse-args.h"
+#include "traffic.h"
+
+// Check the cache-line estimate of uniform stride patterns, which can be
+// worked out by hand: lines per gather times the number of gathers.
+int traffic_test(enum sg_kernel kernel, size_t stride, size_t delta, size_t n, size_t expected_lines, int random)
+{
+    size_t line = sp_line_size() / sizeof(sgData_t);
+    ssize_t pat[8];
+    for (int j = 0; j < 8; j++)
+        pat[j] = j * stride;
+
+    struct run_config rc = {0};
+    rc.kernel = kernel;
+    rc.type = UNIFORM;
+    rc.pattern = pat;
+    rc.pattern_len = 8;
+    rc.delta = delta;
+    rc.deltas_len = 1;
+    rc.generic_len = n;
+    rc.random_seed = random;
+
+    struct sp_traffic t;
+    sp_traffic_model(&rc, &t);
+
+    size_t expected = expected_lines * line * sizeof(sgData_t);
+    if (kernel == SCATTER)
+        expected *= 2;
+
+    if (t.useful != 8 * n * sizeof(sgData_t) || t.index != 8 * sizeof(spIdx_t) || t.lines != expected) {
+        printf("Test failure on traffic model: stride %zu delta %zu n %zu gave %zu/%zu/%zu, expected %zu line bytes\n",
+                stride, delta, n, t.useful, t.index, t.lines, expected);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    size_t line = sp_line_size() / sizeof(sgData_t);
+    if (line != 8) {
+        printf("Skipping traffic model test for %zu byte cache lines\n", line * sizeof(sgData_t));
+        return EXIT_SUCCESS;
+    }
+
+    size_t n = 1 << 12;
+
+    // Stride 1, no overlap: one line per gather
+    if (traffic_test(GATHER, 1, 8, n, n, 0) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    // Stride 8, every element in its own line
+    if (traffic_test(GATHER, 8, 64, n, 8 * n, 0) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    // Delta 1: consecutive gathers share lines, n + 7 elements in total
+    if (traffic_test(GATHER, 1, 1, n, (n + 7 + 7) / 8, 0) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    // Scatters also read every line before writing it back
+    if (traffic_test(SCATTER, 8, 64, n, 8 * n, 0) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+    // Random configs do not reuse lines between gathers
+    if (traffic_test(GATHER, 1, 1, 64, 64 + 56, 1) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    // Pages are counted like lines: gathers 512 bytes apart fill 4 KiB
+    // pages eight at a time
+    ssize_t pat[8] = {0, 8, 16, 24, 32, 40, 48, 56};
+    struct run_config rc = {0};
+    rc.kernel = GATHER;
+    rc.pattern = pat;
+    rc.pattern_len = 8;
+    rc.delta = 64;
+    rc.deltas_len = 1;
+    rc.generic_len = n;
+    double pages = sp_traffic_pages(&rc, 4096);
+    if (pages != n / 8) {
+        printf("Test failure on traffic pages: %g, expected %zu\n", pages, n / 8);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Run spatter with --validate and count the configs whose check passed,
+// -1 if one failed or the run did
+static int passed(const char *args)
+{
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "../spatter %s --validate -q3 > validate_out.txt", args);
+    if (system(cmd) != 0) {
+        printf("Test failure: spatter %s --validate did not pass\n", args);
+        return -1;
+    }
+    FILE *f = fopen("validate_out.txt", "r");
+    char line[1024];
+    int n = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (strstr(line, "FAILED")) {
+            printf("Test failure: %s", line);
+            n = -1;
+            break;
+        }
+        n += strstr(line, " passed") != NULL;
+    }
+    if (f)
+        fclose(f);
+    return n;
+}
+
+// Every kernel and offset order the checksums cover passes, on any thread
+// count. Accumulate ops and overlapping GS Scatters are skipped, not failed.
+int main(int argc, char **argv)
+{
+    const char *checked[] = {
+        "-pUNIFORM:8:1 -l65536",
+        "-kScatter -pUNIFORM:8:4 -l65536 -w16",
+        "-kScatter -pUNIFORM:8:1 -d2 -l65536",
+        "-pUNIFORM:8:1 -l4096 --random=7",
+        "-kScatter -pUNIFORM:8:1 -l4096 --random=7 --random-dist=zipf:1.1",
+        "-pUNIFORM:8:1 -l4096 --morton=1",
+        "-kScatter -pUNIFORM:8:1 -l4096 --hilbert=2",
+        "-pUNIFORM:8:1 -l10000 -d4,8",
+        "-pUNIFORM:8:1 -l10000 --elem=f32",
+        "-kScatter -pUNIFORM:8:1 -l10000 --elem=bytes:12",
+        "-pUNIFORM:8:1 -l10000 --index-bits=16",
+        "-kScatter -pUNIFORM:8:1 -l10000 --store=nt",
+        "-kGS -gUNIFORM:8:1 -hUNIFORM:8:2 -l10000 -x16 -y16",
+        "-kGS -gUNIFORM:8:1 -hUNIFORM:4:1 -l10000 -x8 -y8",
+        "-kMultiGather -pUNIFORM:16:1 -gUNIFORM:8:1 -l10000",
+        "-kMultiScatter -pUNIFORM:16:1 -hUNIFORM:8:1 -l10000 --random=3",
+    };
+    for (size_t i = 0; i < sizeof(checked) / sizeof(checked[0]); i++) {
+        int n = passed(checked[i]);
+        if (n < 0)
+            return EXIT_FAILURE;
+#if defined( USE_OPENMP ) || defined( USE_SERIAL )
+        if (n != 1) {
+            printf("Test failure: spatter %s --validate did not check its config\n", checked[i]);
+            return EXIT_FAILURE;
+        }
+#endif
+    }
+
+    if (passed("-kScatter -pUNIFORM:8:1 -l10000 -oACCUM") != 0 ||
+        passed("-kGS -gUNIFORM:8:1 -hUNIFORM:8:1 -l10000 -y2") != 0)
+        return EXIT_FAILURE;
+
+    remove("validate_out.txt");
+    return EXIT_SUCCESS;
+}